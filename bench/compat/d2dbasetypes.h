@@ -0,0 +1,41 @@
+#ifndef COMPAT_D2DBASETYPES_H
+#define COMPAT_D2DBASETYPES_H
+
+#include <windows.h>
+
+typedef struct D2D_POINT_2F {
+    FLOAT x;
+    FLOAT y;
+} D2D_POINT_2F;
+
+typedef struct D2D_RECT_F {
+    FLOAT left;
+    FLOAT top;
+    FLOAT right;
+    FLOAT bottom;
+} D2D_RECT_F;
+
+typedef struct D2D_SIZE_F {
+    FLOAT width;
+    FLOAT height;
+} D2D_SIZE_F;
+
+typedef struct D2D_SIZE_U {
+    UINT32 width;
+    UINT32 height;
+} D2D_SIZE_U;
+
+typedef struct D2D_MATRIX_3X2_F {
+    FLOAT _11, _12;
+    FLOAT _21, _22;
+    FLOAT _31, _32;
+} D2D_MATRIX_3X2_F;
+
+typedef struct D3DCOLORVALUE {
+    FLOAT r;
+    FLOAT g;
+    FLOAT b;
+    FLOAT a;
+} D3DCOLORVALUE, D2D_COLOR_F;
+
+#endif  /* COMPAT_D2DBASETYPES_H */
@@ -0,0 +1,8 @@
+#ifndef COMPAT_D2DERR_H
+#define COMPAT_D2DERR_H
+
+#include <windows.h>
+
+#define D2DERR_RECREATE_TARGET      ((HRESULT) 0x8899000C)
+
+#endif  /* COMPAT_D2DERR_H */
@@ -0,0 +1,9 @@
+#ifndef COMPAT_MALLOC_H
+#define COMPAT_MALLOC_H
+
+#include <stdlib.h>
+
+#define _malloca    malloc
+#define _freea      free
+
+#endif  /* COMPAT_MALLOC_H */
@@ -0,0 +1,68 @@
+#ifndef COMPAT_OBJIDL_H
+#define COMPAT_OBJIDL_H
+
+#include <unknwn.h>
+
+typedef struct IStream IStream;
+typedef struct IStreamVtbl IStreamVtbl;
+
+typedef union _ULARGE_INTEGER {
+    ULONGLONG QuadPart;
+} ULARGE_INTEGER;
+
+typedef struct tagSTATSTG STATSTG;
+struct tagSTATSTG {
+    WCHAR* pwcsName;
+    DWORD type;
+    ULARGE_INTEGER cbSize;
+    DWORD grfMode;
+    DWORD grfLocksSupported;
+    CLSID clsid;
+    DWORD grfStateBits;
+};
+
+#define STGTY_STREAM            2
+#define STGM_READ               0x00000000
+
+#define STG_E_INVALIDFUNCTION   ((HRESULT) 0x80030001L)
+#define STG_E_ACCESSDENIED      ((HRESULT) 0x80030005L)
+#define STG_E_INVALIDPARAMETER  ((HRESULT) 0x80030057L)
+
+extern const IID IID_IDispatch;
+extern const IID IID_ISequentialStream;
+extern const IID IID_IStream;
+
+struct IStreamVtbl {
+    STDMETHOD(QueryInterface)(IStream*, REFIID, void**);
+    STDMETHOD_(ULONG, AddRef)(IStream*);
+    STDMETHOD_(ULONG, Release)(IStream*);
+    STDMETHOD(Read)(IStream*, void*, ULONG, ULONG*);
+    STDMETHOD(Write)(IStream*, const void*, ULONG, ULONG*);
+    STDMETHOD(Seek)(IStream*, LARGE_INTEGER, DWORD, ULARGE_INTEGER*);
+    STDMETHOD(SetSize)(IStream*, ULARGE_INTEGER);
+    STDMETHOD(CopyTo)(IStream*, IStream*, ULARGE_INTEGER, ULARGE_INTEGER*, ULARGE_INTEGER*);
+    STDMETHOD(Commit)(IStream*, DWORD);
+    STDMETHOD(Revert)(IStream*);
+    STDMETHOD(LockRegion)(IStream*, ULARGE_INTEGER, ULARGE_INTEGER, DWORD);
+    STDMETHOD(UnlockRegion)(IStream*, ULARGE_INTEGER, ULARGE_INTEGER, DWORD);
+    STDMETHOD(Stat)(IStream*, STATSTG*, DWORD);
+    STDMETHOD(Clone)(IStream*, IStream**);
+};
+
+struct IStream {
+    IStreamVtbl* lpVtbl;
+};
+
+#define IStream_AddRef(self)            (self)->lpVtbl->AddRef(self)
+#define IStream_Release(self)           (self)->lpVtbl->Release(self)
+#define IStream_Read(self,a,b,c)        (self)->lpVtbl->Read(self,a,b,c)
+#define IStream_Write(self,a,b,c)       (self)->lpVtbl->Write(self,a,b,c)
+#define IStream_Seek(self,a,b,c)        (self)->lpVtbl->Seek(self,a,b,c)
+
+#define STREAM_SEEK_SET     0
+#define STREAM_SEEK_CUR     1
+#define STREAM_SEEK_END     2
+
+IStream* SHCreateMemStream(const BYTE* init, UINT size);
+
+#endif  /* COMPAT_OBJIDL_H */
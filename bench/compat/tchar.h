@@ -0,0 +1,18 @@
+#ifndef COMPAT_TCHAR_H
+#define COMPAT_TCHAR_H
+
+#include <windows.h>
+
+#ifdef UNICODE
+    #define _T(x)       L##x
+    #define _tcslen     wcslen
+    #define _tcscmp     wcscmp
+    #define _tcstoul    wcstoul
+#else
+    #define _T(x)       x
+    #define _tcslen     strlen
+    #define _tcscmp     strcmp
+    #define _tcstoul    strtoul
+#endif
+
+#endif  /* COMPAT_TCHAR_H */
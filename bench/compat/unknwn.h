@@ -0,0 +1,29 @@
+#ifndef COMPAT_UNKNWN_H
+#define COMPAT_UNKNWN_H
+
+#include <windows.h>
+
+typedef struct IUnknown IUnknown;
+typedef struct IUnknownVtbl IUnknownVtbl;
+
+struct IUnknownVtbl {
+    STDMETHOD(QueryInterface)(IUnknown*, REFIID, void**);
+    STDMETHOD_(ULONG, AddRef)(IUnknown*);
+    STDMETHOD_(ULONG, Release)(IUnknown*);
+};
+
+struct IUnknown {
+    IUnknownVtbl* lpVtbl;
+};
+
+#define IUnknown_QueryInterface(self,a,b)   (self)->lpVtbl->QueryInterface(self,a,b)
+#define IUnknown_AddRef(self)               (self)->lpVtbl->AddRef(self)
+#define IUnknown_Release(self)              (self)->lpVtbl->Release(self)
+
+extern const IID IID_IUnknown;
+
+HRESULT CoInitialize(void* reserved);
+void CoUninitialize(void);
+HRESULT CoCreateInstance(REFCLSID clsid, IUnknown* outer, DWORD ctx, REFIID iid, void** obj);
+
+#endif  /* COMPAT_UNKNWN_H */
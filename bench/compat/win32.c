@@ -0,0 +1,725 @@
+/* Implementation of the few Win32 functions used by WinDrawLib on top of
+ * POSIX. GDI handles are just unique dummy pointers; LoadLibrary() and
+ * GetProcAddress() route the back-end DLLs to the recording stand-ins. */
+
+#include <windows.h>
+#include <unknwn.h>
+#include <objidl.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <wctype.h>
+
+#include "../standin.h"
+
+
+/*****************
+ ***  Kernel  ***
+ *****************/
+
+static __thread DWORD win32_last_error = 0;
+
+DWORD
+GetLastError(void)
+{
+    return win32_last_error;
+}
+
+void
+SetLastError(DWORD err)
+{
+    win32_last_error = err;
+}
+
+DWORD
+GetCurrentThreadId(void)
+{
+    static DWORD counter = 0;
+    static __thread DWORD id = 0;
+
+    if(id == 0)
+        id = __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED);
+    return id;
+}
+
+DWORD
+GetCurrentProcessId(void)
+{
+    return (DWORD) getpid();
+}
+
+void
+OutputDebugStringA(const char* str)
+{
+    fputs(str, stderr);
+}
+
+BOOL
+QueryPerformanceCounter(LARGE_INTEGER* counter)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    counter->QuadPart = (LONGLONG) ts.tv_sec * 1000000000 + ts.tv_nsec;
+    return TRUE;
+}
+
+BOOL
+QueryPerformanceFrequency(LARGE_INTEGER* freq)
+{
+    freq->QuadPart = 1000000000;
+    return TRUE;
+}
+
+LONG
+InterlockedIncrement(LONG volatile* ptr)
+{
+    return __atomic_add_fetch(ptr, 1, __ATOMIC_SEQ_CST);
+}
+
+LONG
+InterlockedDecrement(LONG volatile* ptr)
+{
+    return __atomic_sub_fetch(ptr, 1, __ATOMIC_SEQ_CST);
+}
+
+void*
+InterlockedCompareExchangePointer(void* volatile* ptr, void* val, void* cmp)
+{
+    __atomic_compare_exchange_n(ptr, &cmp, val, FALSE,
+                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return cmp;
+}
+
+void
+InitializeCriticalSection(CRITICAL_SECTION* cs)
+{
+    pthread_mutexattr_t attr;
+
+    /* Win32 critical sections are recursive. */
+    cs->impl = malloc(sizeof(pthread_mutex_t));
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init((pthread_mutex_t*) cs->impl, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void
+DeleteCriticalSection(CRITICAL_SECTION* cs)
+{
+    pthread_mutex_destroy((pthread_mutex_t*) cs->impl);
+    free(cs->impl);
+    cs->impl = NULL;
+}
+
+void
+EnterCriticalSection(CRITICAL_SECTION* cs)
+{
+    pthread_mutex_lock((pthread_mutex_t*) cs->impl);
+}
+
+void
+LeaveCriticalSection(CRITICAL_SECTION* cs)
+{
+    pthread_mutex_unlock((pthread_mutex_t*) cs->impl);
+}
+
+DWORD
+TlsAlloc(void)
+{
+    pthread_key_t key;
+
+    if(pthread_key_create(&key, NULL) != 0)
+        return TLS_OUT_OF_INDEXES;
+    return (DWORD) key;
+}
+
+BOOL
+TlsFree(DWORD index)
+{
+    return (pthread_key_delete((pthread_key_t) index) == 0);
+}
+
+void*
+TlsGetValue(DWORD index)
+{
+    return pthread_getspecific((pthread_key_t) index);
+}
+
+BOOL
+TlsSetValue(DWORD index, void* value)
+{
+    return (pthread_setspecific((pthread_key_t) index, value) == 0);
+}
+
+
+/*****************************
+ ***  Modules and loading  ***
+ *****************************/
+
+static char win32_kernel32;
+static char win32_comctl32;
+static char win32_d2d1;
+static char win32_dwrite;
+static char win32_gdiplus;
+
+static const struct {
+    const WCHAR* name;
+    void* module;
+} win32_modules[] = {
+    { L"KERNEL32.DLL",  &win32_kernel32 },
+    { L"COMCTL32.DLL",  &win32_comctl32 },
+    { L"D2D1.DLL",      &win32_d2d1 },
+    { L"DWRITE.DLL",    &win32_dwrite },
+    { L"GDIPLUS.DLL",   &win32_gdiplus }
+};
+
+static void* win32_comctl32_proc(const char* name);
+
+/* Matches by the base name, case-insensitively, so that full system paths
+ * resolve as well. */
+static HMODULE
+win32_find_module(const WCHAR* name)
+{
+    const WCHAR* base;
+    int i, j;
+
+    base = wcsrchr(name, L'\\');
+    base = (base != NULL ? base + 1 : name);
+
+    for(i = 0; i < (int) (sizeof(win32_modules) / sizeof(win32_modules[0])); i++) {
+        const WCHAR* mod_name = win32_modules[i].name;
+
+        for(j = 0; base[j] != L'\0'; j++) {
+            if(towupper(base[j]) != mod_name[j])
+                break;
+        }
+        if(base[j] == L'\0'  &&  mod_name[j] == L'\0')
+            return (HMODULE) win32_modules[i].module;
+    }
+
+    SetLastError(ERROR_MOD_NOT_FOUND);
+    return NULL;
+}
+
+static void
+win32_AddDllDirectory(void)
+{
+    /* Only used as a canary by wd_load_system_dll(). */
+}
+
+HMODULE
+GetModuleHandleW(const WCHAR* name)
+{
+    return win32_find_module(name);
+}
+
+HMODULE
+LoadLibraryW(const WCHAR* name)
+{
+    return win32_find_module(name);
+}
+
+HMODULE
+LoadLibraryExW(const WCHAR* name, HANDLE file, DWORD flags)
+{
+    return win32_find_module(name);
+}
+
+BOOL
+FreeLibrary(HMODULE dll)
+{
+    return TRUE;
+}
+
+void*
+GetProcAddress(HMODULE dll, const char* name)
+{
+    void* proc = NULL;
+
+    if((void*) dll == &win32_kernel32) {
+        if(strcmp(name, "AddDllDirectory") == 0)
+            proc = (void*) win32_AddDllDirectory;
+    } else if((void*) dll == &win32_comctl32) {
+        proc = win32_comctl32_proc(name);
+    } else if((void*) dll == &win32_d2d1) {
+        proc = standin_d2d_proc(name);
+    } else if((void*) dll == &win32_dwrite) {
+        proc = standin_dwrite_proc(name);
+    } else if((void*) dll == &win32_gdiplus) {
+        proc = standin_gdix_proc(name);
+    }
+
+    if(proc == NULL)
+        SetLastError(ERROR_PROC_NOT_FOUND);
+    return proc;
+}
+
+UINT
+GetSystemDirectoryW(WCHAR* buffer, UINT size)
+{
+    static const WCHAR sysdir[] = L"C:\\Windows\\System32";
+    UINT len = (UINT) wcslen(sysdir);
+
+    if(size <= len)
+        return len + 1;
+    memcpy(buffer, sysdir, (len + 1) * sizeof(WCHAR));
+    return len;
+}
+
+BOOL
+GetVersionExW(OSVERSIONINFOW* info)
+{
+    info->dwMajorVersion = 10;
+    info->dwMinorVersion = 0;
+    info->dwBuildNumber = 19045;
+    info->dwPlatformId = 2;
+    info->szCSDVersion[0] = L'\0';
+    return TRUE;
+}
+
+int
+GetUserDefaultLocaleName(WCHAR* buffer, int size)
+{
+    static const WCHAR locale[] = L"en-US";
+    int len = (int) wcslen(locale);
+
+    if(size <= len)
+        return 0;
+    memcpy(buffer, locale, (len + 1) * sizeof(WCHAR));
+    return len + 1;
+}
+
+BOOL
+SystemParametersInfoW(UINT action, UINT param, void* pv, UINT win_ini)
+{
+    if(action == SPI_GETNONCLIENTMETRICS) {
+        NONCLIENTMETRICSW* metrics = (NONCLIENTMETRICSW*) pv;
+        UINT size = metrics->cbSize;
+
+        memset(metrics, 0, size);
+        metrics->cbSize = size;
+        metrics->lfMessageFont.lfHeight = -12;
+        metrics->lfMessageFont.lfWeight = FW_NORMAL;
+        wcscpy(metrics->lfMessageFont.lfFaceName, L"Segoe UI");
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+
+/*******************
+ ***  Resources  ***
+ *******************/
+
+/* There are no resources in this world. */
+
+HRSRC
+FindResourceW(HMODULE module, const WCHAR* name, const WCHAR* type)
+{
+    SetLastError(ERROR_MOD_NOT_FOUND);
+    return NULL;
+}
+
+HGLOBAL
+LoadResource(HMODULE module, HRSRC res)
+{
+    return NULL;
+}
+
+void*
+LockResource(HGLOBAL data)
+{
+    return NULL;
+}
+
+DWORD
+SizeofResource(HMODULE module, HRSRC res)
+{
+    return 0;
+}
+
+BOOL
+FreeResource(HGLOBAL data)
+{
+    return FALSE;
+}
+
+
+/*************
+ ***  GDI  ***
+ *************/
+
+static char win32_dc;
+static char win32_bitmap;
+static char win32_stock_font;
+static char win32_region;
+
+#define WIN32_CLIENT_WIDTH      640
+#define WIN32_CLIENT_HEIGHT     480
+
+typedef LRESULT (CALLBACK* WIN32_SUBCLASSPROC)(HWND, UINT, WPARAM, LPARAM, UINT_PTR, DWORD_PTR);
+
+typedef struct win32_subclass_tag win32_subclass_t;
+struct win32_subclass_tag {
+    WIN32_SUBCLASSPROC proc;    /* NULL when removed. */
+    UINT_PTR id;
+    DWORD_PTR data;
+};
+
+/* Windows which have been resized, subclassed or destroyed. The windows are
+ * used by a single thread at a time (as on Windows), so there is no lock. */
+typedef struct win32_window_tag win32_window_t;
+struct win32_window_tag {
+    HWND win;
+    int width;
+    int height;
+    BOOL destroyed;
+    win32_subclass_t subclasses[4];
+    int subclass_count;
+    int dispatch_index;         /* Of the subclass handling a message. */
+};
+
+static win32_window_t win32_windows[64];
+static int win32_window_count = 0;
+
+static win32_window_t*
+win32_window(HWND win, BOOL create)
+{
+    win32_window_t* w;
+    int i;
+
+    for(i = 0; i < win32_window_count; i++) {
+        if(win32_windows[i].win == win)
+            return &win32_windows[i];
+    }
+
+    if(!create  ||  win32_window_count >= (int) (sizeof(win32_windows) / sizeof(win32_windows[0])))
+        return NULL;
+
+    w = &win32_windows[win32_window_count++];
+    memset(w, 0, sizeof(win32_window_t));
+    w->win = win;
+    w->width = WIN32_CLIENT_WIDTH;
+    w->height = WIN32_CLIENT_HEIGHT;
+    return w;
+}
+
+BOOL
+GetClientRect(HWND win, RECT* rect)
+{
+    win32_window_t* w = win32_window(win, FALSE);
+
+    rect->left = 0;
+    rect->top = 0;
+    rect->right = (w != NULL ? w->width : WIN32_CLIENT_WIDTH);
+    rect->bottom = (w != NULL ? w->height : WIN32_CLIENT_HEIGHT);
+    return TRUE;
+}
+
+BOOL
+IsWindow(HWND win)
+{
+    win32_window_t* w = win32_window(win, FALSE);
+
+    return (win != NULL  &&  (w == NULL  ||  !w->destroyed));
+}
+
+BOOL
+MoveWindow(HWND win, int x, int y, int width, int height, BOOL repaint)
+{
+    win32_window_t* w = win32_window(win, TRUE);
+
+    if(w == NULL  ||  w->destroyed)
+        return FALSE;
+    w->width = width;
+    w->height = height;
+    return TRUE;
+}
+
+/* Calls the subclass procedures below the one currently handling the
+ * message, the most recently installed first. */
+static LRESULT
+win32_dispatch(win32_window_t* w, UINT msg, WPARAM wp, LPARAM lp)
+{
+    while(--w->dispatch_index >= 0) {
+        win32_subclass_t* s = &w->subclasses[w->dispatch_index];
+        if(s->proc != NULL)
+            return s->proc(w->win, msg, wp, lp, s->id, s->data);
+    }
+    return 0;
+}
+
+BOOL
+DestroyWindow(HWND win)
+{
+    win32_window_t* w = win32_window(win, TRUE);
+
+    if(w == NULL  ||  w->destroyed)
+        return FALSE;
+
+    w->dispatch_index = w->subclass_count;
+    win32_dispatch(w, WM_NCDESTROY, 0, 0);
+    w->destroyed = TRUE;
+    w->subclass_count = 0;
+    return TRUE;
+}
+
+static BOOL WINAPI
+win32_SetWindowSubclass(HWND win, WIN32_SUBCLASSPROC proc, UINT_PTR id, DWORD_PTR data)
+{
+    win32_window_t* w = win32_window(win, TRUE);
+    int i;
+
+    if(w == NULL  ||  w->destroyed)
+        return FALSE;
+
+    for(i = 0; i < w->subclass_count; i++) {
+        if(w->subclasses[i].proc == proc  &&  w->subclasses[i].id == id) {
+            w->subclasses[i].data = data;
+            return TRUE;
+        }
+    }
+
+    if(w->subclass_count >= (int) (sizeof(w->subclasses) / sizeof(w->subclasses[0])))
+        return FALSE;
+    w->subclasses[w->subclass_count].proc = proc;
+    w->subclasses[w->subclass_count].id = id;
+    w->subclasses[w->subclass_count].data = data;
+    w->subclass_count++;
+    return TRUE;
+}
+
+static BOOL WINAPI
+win32_RemoveWindowSubclass(HWND win, WIN32_SUBCLASSPROC proc, UINT_PTR id)
+{
+    win32_window_t* w = win32_window(win, FALSE);
+    int i;
+
+    if(w == NULL)
+        return FALSE;
+
+    for(i = 0; i < w->subclass_count; i++) {
+        if(w->subclasses[i].proc == proc  &&  w->subclasses[i].id == id) {
+            w->subclasses[i].proc = NULL;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static LRESULT WINAPI
+win32_DefSubclassProc(HWND win, UINT msg, WPARAM wp, LPARAM lp)
+{
+    win32_window_t* w = win32_window(win, FALSE);
+
+    return (w != NULL ? win32_dispatch(w, msg, wp, lp) : 0);
+}
+
+static void*
+win32_comctl32_proc(const char* name)
+{
+    if(strcmp(name, "SetWindowSubclass") == 0)
+        return (void*) win32_SetWindowSubclass;
+    if(strcmp(name, "RemoveWindowSubclass") == 0)
+        return (void*) win32_RemoveWindowSubclass;
+    if(strcmp(name, "DefSubclassProc") == 0)
+        return (void*) win32_DefSubclassProc;
+    return NULL;
+}
+
+HDC
+GetDC(HWND win)
+{
+    return (HDC) &win32_dc;
+}
+
+HDC
+GetDCEx(HWND win, HRGN clip, DWORD flags)
+{
+    return (HDC) &win32_dc;
+}
+
+int
+ReleaseDC(HWND win, HDC dc)
+{
+    return 1;
+}
+
+HICON
+CopyIcon(HICON icon)
+{
+    return icon;
+}
+
+BOOL
+DestroyIcon(HICON icon)
+{
+    return (icon != NULL);
+}
+
+HDC
+CreateCompatibleDC(HDC dc)
+{
+    return (HDC) &win32_dc;
+}
+
+BOOL
+DeleteDC(HDC dc)
+{
+    return TRUE;
+}
+
+HBITMAP
+CreateCompatibleBitmap(HDC dc, int cx, int cy)
+{
+    return (HBITMAP) &win32_bitmap;
+}
+
+HGDIOBJ
+SelectObject(HDC dc, HGDIOBJ obj)
+{
+    return (HGDIOBJ) &win32_bitmap;
+}
+
+BOOL
+DeleteObject(HGDIOBJ obj)
+{
+    return TRUE;
+}
+
+HGDIOBJ
+GetStockObject(int obj)
+{
+    return (HGDIOBJ) &win32_stock_font;
+}
+
+int
+GetObjectW(HANDLE obj, int size, void* buffer)
+{
+    if(obj == (HANDLE) &win32_stock_font  &&  size >= (int) sizeof(LOGFONTW)) {
+        LOGFONTW* lf = (LOGFONTW*) buffer;
+
+        memset(lf, 0, sizeof(LOGFONTW));
+        lf->lfHeight = -12;
+        lf->lfWeight = FW_NORMAL;
+        wcscpy(lf->lfFaceName, L"Segoe UI");
+        return sizeof(LOGFONTW);
+    }
+
+    return 0;
+}
+
+int
+GetDIBits(HDC dc, HBITMAP bmp, UINT start, UINT lines, void* bits,
+          BITMAPINFO* info, UINT usage)
+{
+    return 0;
+}
+
+BOOL
+BitBlt(HDC dst, int x, int y, int cx, int cy, HDC src, int x1, int y1, DWORD rop)
+{
+    return TRUE;
+}
+
+int
+SetDIBitsToDevice(HDC dc, int x, int y, DWORD cx, DWORD cy, int x1, int y1,
+                  UINT start, UINT lines, const void* bits, const BITMAPINFO* info, UINT usage)
+{
+    return (int) lines;
+}
+
+DWORD
+SetLayout(HDC dc, DWORD layout)
+{
+    return 0;
+}
+
+DWORD
+GetLayout(HDC dc)
+{
+    return 0;
+}
+
+int
+GetClipBox(HDC dc, RECT* rect)
+{
+    GetClientRect(NULL, rect);
+    return SIMPLEREGION;
+}
+
+BOOL
+SetViewportOrgEx(HDC dc, int x, int y, POINT* old)
+{
+    if(old != NULL) {
+        old->x = 0;
+        old->y = 0;
+    }
+    return TRUE;
+}
+
+int
+SaveDC(HDC dc)
+{
+    return 1;
+}
+
+BOOL
+RestoreDC(HDC dc, int saved)
+{
+    return TRUE;
+}
+
+HRGN
+CreateRectRgn(int x0, int y0, int x1, int y1)
+{
+    return (HRGN) &win32_region;
+}
+
+int
+CombineRgn(HRGN dst, HRGN src1, HRGN src2, int mode)
+{
+    return SIMPLEREGION;
+}
+
+int
+ExtSelectClipRgn(HDC dc, HRGN rgn, int mode)
+{
+    return SIMPLEREGION;
+}
+
+
+/*************
+ ***  COM  ***
+ *************/
+
+const IID IID_IUnknown =
+        {0x00000000,0x0000,0x0000,{0xc0,0x00,0x00,0x00,0x00,0x00,0x00,0x46}};
+const IID IID_IDispatch =
+        {0x00020400,0x0000,0x0000,{0xc0,0x00,0x00,0x00,0x00,0x00,0x00,0x46}};
+const IID IID_ISequentialStream =
+        {0x0c733a30,0x2a1c,0x11ce,{0xad,0xe5,0x00,0xaa,0x00,0x44,0x77,0x3d}};
+const IID IID_IStream =
+        {0x0000000c,0x0000,0x0000,{0xc0,0x00,0x00,0x00,0x00,0x00,0x00,0x46}};
+
+HRESULT
+CoInitialize(void* reserved)
+{
+    return S_OK;
+}
+
+void
+CoUninitialize(void)
+{
+}
+
+HRESULT
+CoCreateInstance(REFCLSID clsid, IUnknown* outer, DWORD ctx, REFIID iid, void** obj)
+{
+    /* WinDrawLib only ever asks for the WIC imaging factory. */
+    return standin_wic_create_factory(obj);
+}
@@ -0,0 +1,189 @@
+/* Minimal stand-in for <wincodec.h>.
+ *
+ * Only the WIC methods WinDrawLib actually calls are declared. The vtables
+ * are therefore NOT binary compatible with the real WIC; they only have to
+ * agree with the recording stand-in (standin-wic.c).
+ */
+
+#ifndef COMPAT_WINCODEC_H
+#define COMPAT_WINCODEC_H
+
+#include <windows.h>
+#include <unknwn.h>
+#include <objidl.h>
+
+
+typedef GUID WICPixelFormatGUID;
+typedef UINT32 WICColor;
+
+typedef struct WICRect_tag WICRect;
+struct WICRect_tag {
+    INT X;
+    INT Y;
+    INT Width;
+    INT Height;
+};
+
+typedef enum WICBitmapAlphaChannelOption_tag {
+    WICBitmapUseAlpha = 0,
+    WICBitmapUsePremultipliedAlpha = 1,
+    WICBitmapIgnoreAlpha = 2
+} WICBitmapAlphaChannelOption;
+
+typedef enum WICBitmapCreateCacheOption_tag {
+    WICBitmapNoCache = 0,
+    WICBitmapCacheOnDemand = 1,
+    WICBitmapCacheOnLoad = 2
+} WICBitmapCreateCacheOption;
+
+typedef enum WICDecodeOptions_tag {
+    WICDecodeMetadataCacheOnDemand = 0,
+    WICDecodeMetadataCacheOnLoad = 1
+} WICDecodeOptions;
+
+typedef enum WICBitmapDitherType_tag {
+    WICBitmapDitherTypeNone = 0
+} WICBitmapDitherType;
+
+typedef enum WICBitmapPaletteType_tag {
+    WICBitmapPaletteTypeCustom = 0,
+    WICBitmapPaletteTypeMedianCut = 1
+} WICBitmapPaletteType;
+
+typedef enum WICBitmapLockFlags_tag {
+    WICBitmapLockRead = 1,
+    WICBitmapLockWrite = 2
+} WICBitmapLockFlags;
+
+
+typedef struct IWICPalette IWICPalette;
+typedef struct IWICBitmapSource IWICBitmapSource;
+typedef struct IWICBitmapLock IWICBitmapLock;
+typedef struct IWICBitmap IWICBitmap;
+typedef struct IWICFormatConverter IWICFormatConverter;
+typedef struct IWICBitmapFrameDecode IWICBitmapFrameDecode;
+typedef struct IWICBitmapDecoder IWICBitmapDecoder;
+typedef struct IWICImagingFactory IWICImagingFactory;
+
+
+/* IWICBitmapSource and the interfaces derived from it share the vtable
+ * prefix, as in the real COM layout. */
+#define COMPAT_IWICBITMAPSOURCE_METHODS(iface)                                  \
+    STDMETHOD(QueryInterface)(iface*, REFIID, void**);                          \
+    STDMETHOD_(ULONG, AddRef)(iface*);                                          \
+    STDMETHOD_(ULONG, Release)(iface*);                                         \
+    STDMETHOD(GetSize)(iface*, UINT*, UINT*);                                   \
+    STDMETHOD(GetPixelFormat)(iface*, WICPixelFormatGUID*);                     \
+    STDMETHOD(CopyPixels)(iface*, const WICRect*, UINT, UINT, BYTE*);
+
+typedef struct IWICBitmapSourceVtbl_tag IWICBitmapSourceVtbl;
+struct IWICBitmapSourceVtbl_tag {
+    COMPAT_IWICBITMAPSOURCE_METHODS(IWICBitmapSource)
+};
+struct IWICBitmapSource {
+    IWICBitmapSourceVtbl* lpVtbl;
+};
+
+typedef struct IWICBitmapLockVtbl_tag IWICBitmapLockVtbl;
+struct IWICBitmapLockVtbl_tag {
+    STDMETHOD(QueryInterface)(IWICBitmapLock*, REFIID, void**);
+    STDMETHOD_(ULONG, AddRef)(IWICBitmapLock*);
+    STDMETHOD_(ULONG, Release)(IWICBitmapLock*);
+    STDMETHOD(GetSize)(IWICBitmapLock*, UINT*, UINT*);
+    STDMETHOD(GetStride)(IWICBitmapLock*, UINT*);
+    STDMETHOD(GetDataPointer)(IWICBitmapLock*, UINT*, BYTE**);
+};
+struct IWICBitmapLock {
+    IWICBitmapLockVtbl* lpVtbl;
+};
+
+typedef struct IWICBitmapVtbl_tag IWICBitmapVtbl;
+struct IWICBitmapVtbl_tag {
+    COMPAT_IWICBITMAPSOURCE_METHODS(IWICBitmap)
+    STDMETHOD(Lock)(IWICBitmap*, const WICRect*, DWORD, IWICBitmapLock**);
+};
+struct IWICBitmap {
+    IWICBitmapVtbl* lpVtbl;
+};
+
+typedef struct IWICFormatConverterVtbl_tag IWICFormatConverterVtbl;
+struct IWICFormatConverterVtbl_tag {
+    COMPAT_IWICBITMAPSOURCE_METHODS(IWICFormatConverter)
+    STDMETHOD(Initialize)(IWICFormatConverter*, IWICBitmapSource*,
+                          REFGUID, WICBitmapDitherType, IWICPalette*,
+                          double, WICBitmapPaletteType);
+};
+struct IWICFormatConverter {
+    IWICFormatConverterVtbl* lpVtbl;
+};
+
+typedef struct IWICBitmapFrameDecodeVtbl_tag IWICBitmapFrameDecodeVtbl;
+struct IWICBitmapFrameDecodeVtbl_tag {
+    COMPAT_IWICBITMAPSOURCE_METHODS(IWICBitmapFrameDecode)
+};
+struct IWICBitmapFrameDecode {
+    IWICBitmapFrameDecodeVtbl* lpVtbl;
+};
+
+typedef struct IWICBitmapDecoderVtbl_tag IWICBitmapDecoderVtbl;
+struct IWICBitmapDecoderVtbl_tag {
+    STDMETHOD(QueryInterface)(IWICBitmapDecoder*, REFIID, void**);
+    STDMETHOD_(ULONG, AddRef)(IWICBitmapDecoder*);
+    STDMETHOD_(ULONG, Release)(IWICBitmapDecoder*);
+    STDMETHOD(GetFrame)(IWICBitmapDecoder*, UINT, IWICBitmapFrameDecode**);
+};
+struct IWICBitmapDecoder {
+    IWICBitmapDecoderVtbl* lpVtbl;
+};
+
+typedef struct IWICImagingFactoryVtbl_tag IWICImagingFactoryVtbl;
+struct IWICImagingFactoryVtbl_tag {
+    STDMETHOD(QueryInterface)(IWICImagingFactory*, REFIID, void**);
+    STDMETHOD_(ULONG, AddRef)(IWICImagingFactory*);
+    STDMETHOD_(ULONG, Release)(IWICImagingFactory*);
+    STDMETHOD(CreateDecoderFromFilename)(IWICImagingFactory*, const WCHAR*,
+                          const GUID*, DWORD, WICDecodeOptions, IWICBitmapDecoder**);
+    STDMETHOD(CreateDecoderFromStream)(IWICImagingFactory*, IStream*,
+                          const GUID*, WICDecodeOptions, IWICBitmapDecoder**);
+    STDMETHOD(CreateFormatConverter)(IWICImagingFactory*, IWICFormatConverter**);
+    STDMETHOD(CreateBitmap)(IWICImagingFactory*, UINT, UINT,
+                          REFGUID, WICBitmapCreateCacheOption, IWICBitmap**);
+    STDMETHOD(CreateBitmapFromHBITMAP)(IWICImagingFactory*, HBITMAP, HPALETTE,
+                          WICBitmapAlphaChannelOption, IWICBitmap**);
+    STDMETHOD(CreateBitmapFromHICON)(IWICImagingFactory*, HICON, IWICBitmap**);
+};
+struct IWICImagingFactory {
+    IWICImagingFactoryVtbl* lpVtbl;
+};
+
+
+#define IWICBitmapSource_AddRef(self)                   (self)->lpVtbl->AddRef(self)
+#define IWICBitmapSource_Release(self)                  (self)->lpVtbl->Release(self)
+#define IWICBitmapSource_GetSize(self,a,b)              (self)->lpVtbl->GetSize(self,a,b)
+#define IWICBitmapSource_GetPixelFormat(self,a)         (self)->lpVtbl->GetPixelFormat(self,a)
+#define IWICBitmapSource_CopyPixels(self,a,b,c,d)       (self)->lpVtbl->CopyPixels(self,a,b,c,d)
+
+#define IWICBitmapLock_Release(self)                    (self)->lpVtbl->Release(self)
+#define IWICBitmapLock_GetStride(self,a)                (self)->lpVtbl->GetStride(self,a)
+#define IWICBitmapLock_GetDataPointer(self,a,b)         (self)->lpVtbl->GetDataPointer(self,a,b)
+
+#define IWICBitmap_Release(self)                        (self)->lpVtbl->Release(self)
+#define IWICBitmap_Lock(self,a,b,c)                     (self)->lpVtbl->Lock(self,a,b,c)
+
+#define IWICFormatConverter_Release(self)               (self)->lpVtbl->Release(self)
+#define IWICFormatConverter_Initialize(self,a,b,c,d,e,f) (self)->lpVtbl->Initialize(self,a,b,c,d,e,f)
+
+#define IWICBitmapFrameDecode_Release(self)             (self)->lpVtbl->Release(self)
+
+#define IWICBitmapDecoder_Release(self)                 (self)->lpVtbl->Release(self)
+#define IWICBitmapDecoder_GetFrame(self,a,b)            (self)->lpVtbl->GetFrame(self,a,b)
+
+#define IWICImagingFactory_Release(self)                (self)->lpVtbl->Release(self)
+#define IWICImagingFactory_CreateDecoderFromFilename(self,a,b,c,d,e) (self)->lpVtbl->CreateDecoderFromFilename(self,a,b,c,d,e)
+#define IWICImagingFactory_CreateDecoderFromStream(self,a,b,c,d)     (self)->lpVtbl->CreateDecoderFromStream(self,a,b,c,d)
+#define IWICImagingFactory_CreateFormatConverter(self,a)             (self)->lpVtbl->CreateFormatConverter(self,a)
+#define IWICImagingFactory_CreateBitmap(self,a,b,c,d,e)              (self)->lpVtbl->CreateBitmap(self,a,b,c,d,e)
+#define IWICImagingFactory_CreateBitmapFromHBITMAP(self,a,b,c,d)     (self)->lpVtbl->CreateBitmapFromHBITMAP(self,a,b,c,d)
+#define IWICImagingFactory_CreateBitmapFromHICON(self,a,b)           (self)->lpVtbl->CreateBitmapFromHICON(self,a,b)
+
+#endif  /* COMPAT_WINCODEC_H */
@@ -0,0 +1,413 @@
+/* Minimal stand-in for <windows.h>, just enough to build WinDrawLib sources
+ * on non-Windows systems for the headless benchmarks.
+ * The functions are implemented in compat/win32.c; they do nothing useful
+ * except LoadLibrary()/GetProcAddress(), which resolve to the back-end
+ * stand-ins (see standin.h).
+ *
+ * Note WCHAR is wchar_t here, i.e. 32-bit. The library never depends on its
+ * size.
+ */
+
+#ifndef COMPAT_WINDOWS_H
+#define COMPAT_WINDOWS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+
+/**********************
+ ***  Basic Types  ***
+ **********************/
+
+#define WINAPI
+#define CALLBACK
+#define STDMETHODCALLTYPE
+#define __stdcall
+#define CONST           const
+#define PURE
+
+typedef int             BOOL;
+typedef unsigned char   BYTE;
+typedef unsigned short  WORD;
+typedef uint32_t        DWORD;
+typedef int             INT;
+typedef unsigned int    UINT;
+typedef int32_t         LONG;
+typedef uint32_t        ULONG;
+typedef int16_t         INT16;
+typedef uint16_t        UINT16;
+typedef int32_t         INT32;
+typedef uint32_t        UINT32;
+typedef int64_t         INT64;
+typedef uint64_t        UINT64;
+typedef int64_t         LONGLONG;
+typedef uint64_t        ULONGLONG;
+typedef float           FLOAT;
+typedef char            CHAR;
+typedef wchar_t         WCHAR;
+typedef intptr_t        INT_PTR;
+typedef uintptr_t       UINT_PTR;
+typedef intptr_t        LONG_PTR;
+typedef uintptr_t       ULONG_PTR;
+typedef uintptr_t       DWORD_PTR;
+typedef size_t          SIZE_T;
+typedef void            VOID;
+typedef void*           PVOID;
+typedef void*           LPVOID;
+typedef const void*     LPCVOID;
+typedef BYTE*           LPBYTE;
+typedef DWORD*          LPDWORD;
+typedef char*           LPSTR;
+typedef const char*     LPCSTR;
+typedef WCHAR*          LPWSTR;
+typedef const WCHAR*    LPCWSTR;
+typedef LONG            HRESULT;
+typedef DWORD           COLORREF;
+typedef WORD            LANGID;
+typedef UINT_PTR        WPARAM;
+typedef LONG_PTR        LPARAM;
+typedef LONG_PTR        LRESULT;
+
+#ifdef UNICODE
+    typedef WCHAR       TCHAR;
+#else
+    typedef char        TCHAR;
+#endif
+typedef TCHAR*          LPTSTR;
+typedef const TCHAR*    LPCTSTR;
+
+#define TRUE            1
+#define FALSE           0
+#define MAX_PATH        260
+
+#define DECLARE_HANDLE(name)    typedef struct name##__* name
+DECLARE_HANDLE(HWND);
+DECLARE_HANDLE(HDC);
+DECLARE_HANDLE(HINSTANCE);
+DECLARE_HANDLE(HBITMAP);
+DECLARE_HANDLE(HICON);
+DECLARE_HANDLE(HFONT);
+DECLARE_HANDLE(HRSRC);
+DECLARE_HANDLE(HRGN);
+DECLARE_HANDLE(HBRUSH);
+DECLARE_HANDLE(HPALETTE);
+typedef HINSTANCE       HMODULE;
+typedef void*           HANDLE;
+typedef HANDLE          HGLOBAL;
+typedef HANDLE          HGDIOBJ;
+
+typedef union _LARGE_INTEGER {
+    struct { DWORD LowPart; LONG HighPart; } u;
+    LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+
+/*****************************
+ ***  Errors and HRESULTs  ***
+ *****************************/
+
+#define S_OK                        ((HRESULT) 0)
+#define S_FALSE                     ((HRESULT) 1)
+#define E_NOTIMPL                   ((HRESULT) 0x80004001)
+#define E_NOINTERFACE               ((HRESULT) 0x80004002)
+#define E_POINTER                   ((HRESULT) 0x80004003)
+#define E_FAIL                      ((HRESULT) 0x80004005)
+#define E_OUTOFMEMORY               ((HRESULT) 0x8007000E)
+#define E_INVALIDARG                ((HRESULT) 0x80070057)
+
+#define HRESULT_FROM_WIN32(x)       ((HRESULT) (x) <= 0 ? (HRESULT) (x) : \
+                                    (HRESULT) (((x) & 0x0000FFFF) | 0x80070000))
+
+#define GENERIC_READ                0x80000000L
+
+#define SUCCEEDED(hr)               (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)                  (((HRESULT)(hr)) < 0)
+
+#define ERROR_SUCCESS               0
+#define ERROR_NOT_ENOUGH_MEMORY     8
+#define ERROR_OUTOFMEMORY           14
+#define ERROR_BUFFER_OVERFLOW       111
+#define ERROR_PROC_NOT_FOUND        127
+#define ERROR_MOD_NOT_FOUND         126
+
+
+/*************
+ ***  COM  ***
+ *************/
+
+typedef struct _GUID {
+    DWORD Data1;
+    WORD Data2;
+    WORD Data3;
+    BYTE Data4[8];
+} GUID;
+
+typedef GUID            IID;
+typedef GUID            CLSID;
+typedef const GUID*     REFGUID;
+typedef const IID*      REFIID;
+typedef const CLSID*    REFCLSID;
+
+#define IsEqualGUID(a, b)       (memcmp((a), (b), sizeof(GUID)) == 0)
+#define IsEqualIID(a, b)        IsEqualGUID((a), (b))
+
+#define STDMETHOD(method)           HRESULT (STDMETHODCALLTYPE *method)
+#define STDMETHOD_(type, method)    type (STDMETHODCALLTYPE *method)
+
+#define CLSCTX_INPROC_SERVER        0x1
+
+
+/**************
+ ***  Misc  ***
+ **************/
+
+#define LOWORD(l)           ((WORD)((DWORD_PTR)(l) & 0xffff))
+#define HIWORD(l)           ((WORD)((DWORD_PTR)(l) >> 16))
+#define MAKEINTRESOURCEW(i) ((LPWSTR)(ULONG_PTR)((WORD)(i)))
+
+#define RGB(r,g,b)          ((COLORREF)(((BYTE)(r)) | ((WORD)((BYTE)(g)) << 8) | (((DWORD)(BYTE)(b)) << 16)))
+#define GetRValue(rgb)      ((BYTE)(rgb))
+#define GetGValue(rgb)      ((BYTE)(((WORD)(rgb)) >> 8))
+#define GetBValue(rgb)      ((BYTE)((rgb) >> 16))
+
+#define TLS_OUT_OF_INDEXES  ((DWORD) 0xFFFFFFFF)
+
+#define LOAD_WITH_ALTERED_SEARCH_PATH   0x00000008
+
+#define _vsnprintf          vsnprintf
+
+#define LANG_NEUTRAL            0x00
+#define LOCALE_NAME_MAX_LENGTH  85
+
+
+/*************
+ ***  GDI  ***
+ *************/
+
+typedef struct tagPOINT {
+    LONG x;
+    LONG y;
+} POINT;
+
+typedef struct tagSIZE {
+    LONG cx;
+    LONG cy;
+} SIZE;
+
+typedef struct tagRECT {
+    LONG left;
+    LONG top;
+    LONG right;
+    LONG bottom;
+} RECT, *LPRECT;
+
+typedef struct tagPAINTSTRUCT {
+    HDC hdc;
+    BOOL fErase;
+    RECT rcPaint;
+    BOOL fRestore;
+    BOOL fIncUpdate;
+    BYTE rgbReserved[32];
+} PAINTSTRUCT;
+
+typedef struct tagBITMAP {
+    LONG bmType;
+    LONG bmWidth;
+    LONG bmHeight;
+    LONG bmWidthBytes;
+    WORD bmPlanes;
+    WORD bmBitsPixel;
+    LPVOID bmBits;
+} BITMAP;
+
+typedef struct tagBITMAPINFOHEADER {
+    DWORD biSize;
+    LONG biWidth;
+    LONG biHeight;
+    WORD biPlanes;
+    WORD biBitCount;
+    DWORD biCompression;
+    DWORD biSizeImage;
+    LONG biXPelsPerMeter;
+    LONG biYPelsPerMeter;
+    DWORD biClrUsed;
+    DWORD biClrImportant;
+} BITMAPINFOHEADER;
+
+typedef struct tagRGBQUAD {
+    BYTE rgbBlue;
+    BYTE rgbGreen;
+    BYTE rgbRed;
+    BYTE rgbReserved;
+} RGBQUAD;
+
+typedef struct tagBITMAPINFO {
+    BITMAPINFOHEADER bmiHeader;
+    RGBQUAD bmiColors[1];
+} BITMAPINFO;
+
+#define LF_FACESIZE         32
+
+typedef struct tagLOGFONTW {
+    LONG lfHeight;
+    LONG lfWidth;
+    LONG lfEscapement;
+    LONG lfOrientation;
+    LONG lfWeight;
+    BYTE lfItalic;
+    BYTE lfUnderline;
+    BYTE lfStrikeOut;
+    BYTE lfCharSet;
+    BYTE lfOutPrecision;
+    BYTE lfClipPrecision;
+    BYTE lfQuality;
+    BYTE lfPitchAndFamily;
+    WCHAR lfFaceName[LF_FACESIZE];
+} LOGFONTW;
+
+typedef struct tagNONCLIENTMETRICSW {
+    UINT cbSize;
+    int iBorderWidth;
+    int iScrollWidth;
+    int iScrollHeight;
+    int iCaptionWidth;
+    int iCaptionHeight;
+    LOGFONTW lfCaptionFont;
+    int iSmCaptionWidth;
+    int iSmCaptionHeight;
+    LOGFONTW lfSmCaptionFont;
+    int iMenuWidth;
+    int iMenuHeight;
+    LOGFONTW lfMenuFont;
+    LOGFONTW lfStatusFont;
+    LOGFONTW lfMessageFont;
+} NONCLIENTMETRICSW;
+
+typedef struct _OSVERSIONINFOW {
+    DWORD dwOSVersionInfoSize;
+    DWORD dwMajorVersion;
+    DWORD dwMinorVersion;
+    DWORD dwBuildNumber;
+    DWORD dwPlatformId;
+    WCHAR szCSDVersion[128];
+} OSVERSIONINFOW, OSVERSIONINFO;
+
+#define BI_RGB              0
+#define DIB_RGB_COLORS      0
+#define SRCCOPY             ((DWORD) 0x00CC0020)
+#define LAYOUT_RTL          0x00000001
+#define ERROR               0
+#define NULLREGION          1
+#define SIMPLEREGION        2
+#define COMPLEXREGION       3
+#define RGN_AND             1
+#define RGN_OR              2
+#define DCX_CACHE           0x00000002
+#define FW_NORMAL           400
+#define FW_BOLD             700
+#define SYSTEM_FONT         13
+#define DEFAULT_GUI_FONT    17
+#define SPI_GETNONCLIENTMETRICS 0x0029
+
+
+/*****************************
+ ***  Synchronization etc.  ***
+ *****************************/
+
+typedef struct _CRITICAL_SECTION {
+    void* impl;
+} CRITICAL_SECTION;
+
+
+/*******************
+ ***  Functions  ***
+ *******************/
+
+DWORD GetLastError(void);
+void SetLastError(DWORD err);
+DWORD GetCurrentThreadId(void);
+DWORD GetCurrentProcessId(void);
+void OutputDebugStringA(const char* str);
+BOOL QueryPerformanceCounter(LARGE_INTEGER* counter);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* freq);
+
+LONG InterlockedIncrement(LONG volatile* ptr);
+LONG InterlockedDecrement(LONG volatile* ptr);
+void* InterlockedCompareExchangePointer(void* volatile* ptr, void* val, void* cmp);
+
+void InitializeCriticalSection(CRITICAL_SECTION* cs);
+void DeleteCriticalSection(CRITICAL_SECTION* cs);
+void EnterCriticalSection(CRITICAL_SECTION* cs);
+void LeaveCriticalSection(CRITICAL_SECTION* cs);
+
+DWORD TlsAlloc(void);
+BOOL TlsFree(DWORD index);
+void* TlsGetValue(DWORD index);
+BOOL TlsSetValue(DWORD index, void* value);
+
+HMODULE GetModuleHandleW(const WCHAR* name);
+HMODULE LoadLibraryW(const WCHAR* name);
+HMODULE LoadLibraryExW(const WCHAR* name, HANDLE file, DWORD flags);
+BOOL FreeLibrary(HMODULE dll);
+void* GetProcAddress(HMODULE dll, const char* name);
+UINT GetSystemDirectoryW(WCHAR* buffer, UINT size);
+BOOL GetVersionExW(OSVERSIONINFOW* info);
+int GetUserDefaultLocaleName(WCHAR* buffer, int size);
+BOOL SystemParametersInfoW(UINT action, UINT param, void* pv, UINT win_ini);
+
+#define GetModuleHandle         GetModuleHandleW
+#define LoadLibrary             LoadLibraryW
+#define LoadLibraryEx           LoadLibraryExW
+#define GetSystemDirectory      GetSystemDirectoryW
+#define GetVersionEx            GetVersionExW
+
+HRSRC FindResourceW(HMODULE module, const WCHAR* name, const WCHAR* type);
+HGLOBAL LoadResource(HMODULE module, HRSRC res);
+void* LockResource(HGLOBAL data);
+DWORD SizeofResource(HMODULE module, HRSRC res);
+BOOL FreeResource(HGLOBAL data);
+#define UnlockResource(data)    ((void)(data), 0)
+
+/* Any non-NULL HWND is a window with a 640 x 480 client area until it is
+ * resized with MoveWindow(). DestroyWindow() only sends WM_NCDESTROY to the
+ * subclass procedures (see SetWindowSubclass()); IsWindow() fails then. */
+#define WM_NCDESTROY            0x0082
+
+BOOL GetClientRect(HWND win, RECT* rect);
+BOOL IsWindow(HWND win);
+BOOL MoveWindow(HWND win, int x, int y, int width, int height, BOOL repaint);
+BOOL DestroyWindow(HWND win);
+HDC GetDC(HWND win);
+HDC GetDCEx(HWND win, HRGN clip, DWORD flags);
+int ReleaseDC(HWND win, HDC dc);
+
+/* Icons are only passed to the WIC stand-in, so a copy is the same handle. */
+HICON CopyIcon(HICON icon);
+BOOL DestroyIcon(HICON icon);
+HDC CreateCompatibleDC(HDC dc);
+BOOL DeleteDC(HDC dc);
+HBITMAP CreateCompatibleBitmap(HDC dc, int cx, int cy);
+HGDIOBJ SelectObject(HDC dc, HGDIOBJ obj);
+BOOL DeleteObject(HGDIOBJ obj);
+HGDIOBJ GetStockObject(int obj);
+int GetObjectW(HANDLE obj, int size, void* buffer);
+#define GetObject               GetObjectW
+int GetDIBits(HDC dc, HBITMAP bmp, UINT start, UINT lines, void* bits, BITMAPINFO* info, UINT usage);
+BOOL BitBlt(HDC dst, int x, int y, int cx, int cy, HDC src, int x1, int y1, DWORD rop);
+int SetDIBitsToDevice(HDC dc, int x, int y, DWORD cx, DWORD cy, int x1, int y1,
+                      UINT start, UINT lines, const void* bits, const BITMAPINFO* info, UINT usage);
+DWORD SetLayout(HDC dc, DWORD layout);
+DWORD GetLayout(HDC dc);
+int GetClipBox(HDC dc, RECT* rect);
+BOOL SetViewportOrgEx(HDC dc, int x, int y, POINT* old);
+int SaveDC(HDC dc);
+BOOL RestoreDC(HDC dc, int saved);
+HRGN CreateRectRgn(int x0, int y0, int x1, int y1);
+int CombineRgn(HRGN dst, HRGN src1, HRGN src2, int mode);
+int ExtSelectClipRgn(HDC dc, HRGN rgn, int mode);
+
+
+#endif  /* COMPAT_WINDOWS_H */
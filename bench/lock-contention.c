@@ -0,0 +1,156 @@
+/*
+ * Measures contention on the lock passed to wdPreInitialize() when many
+ * threads create Direct2D factory resources at once.
+ *
+ * Usage: lock-contention [shared|mt|perthread] [THREADS] [ITERATIONS]
+ *
+ * The output is one line per lock site in the form
+ *   <mode> <site> <acquisitions> <wait_us> <wait_us_per_acquisition>
+ * followed by the total wall time.
+ */
+
+#include <tchar.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <windows.h>
+
+#include <wdl.h>
+
+
+static CRITICAL_SECTION lock;
+static UINT nIterations = 10000;
+
+static const char* siteNames[WD_LOCKSITE_COUNT] = {
+    "init",
+    "CreatePathGeometry",
+    "CreateStrokeStyle",
+    "CreateHwndRenderTarget",
+    "CreateDCRenderTarget",
+    "GdiplusPool",
+    "CanvasCache",
+    "DisplayList"
+};
+
+
+static void
+Lock(void)
+{
+    EnterCriticalSection(&lock);
+}
+
+static void
+Unlock(void)
+{
+    LeaveCriticalSection(&lock);
+}
+
+static DWORD WINAPI
+WorkerProc(void* param)
+{
+    static const WD_POINT points[4] = {
+        { 0.0f, 0.0f }, { 100.0f, 0.0f }, { 100.0f, 100.0f }, { 0.0f, 100.0f }
+    };
+    RECT rect = { 0, 0, 64, 64 };
+    HDC hdcScreen;
+    HDC hdcMem;
+    HBITMAP hBmp;
+    HBITMAP hOldBmp;
+    UINT i;
+
+    hdcScreen = GetDC(NULL);
+    hdcMem = CreateCompatibleDC(hdcScreen);
+    hBmp = CreateCompatibleBitmap(hdcScreen, rect.right, rect.bottom);
+    hOldBmp = SelectObject(hdcMem, hBmp);
+    ReleaseDC(NULL, hdcScreen);
+
+    for(i = 0; i < nIterations; i++) {
+        WD_HCANVAS hCanvas;
+        WD_HPATH hPath;
+        WD_HSTROKESTYLE hStrokeStyle;
+
+        /* Resources with paths are not canvas-specific on D2D. Only every
+         * 16th iteration creates a canvas, as apps usually do per paint. */
+        if(i % 16 == 0) {
+            hCanvas = wdCreateCanvasWithHDC(hdcMem, &rect, 0);
+            if(hCanvas != NULL)
+                wdDestroyCanvas(hCanvas);
+        }
+
+        hPath = wdCreatePolygonPath(NULL, points, 4);
+        if(hPath != NULL)
+            wdDestroyPath(hPath);
+
+        hStrokeStyle = wdCreateStrokeStyle(WD_DASHSTYLE_DASH, WD_LINECAP_ROUND, WD_LINEJOIN_ROUND);
+        if(hStrokeStyle != NULL)
+            wdDestroyStrokeStyle(hStrokeStyle);
+    }
+
+    SelectObject(hdcMem, hOldBmp);
+    DeleteObject(hBmp);
+    DeleteDC(hdcMem);
+    return 0;
+}
+
+int
+_tmain(int argc, TCHAR** argv)
+{
+    const TCHAR* pszMode = _T("shared");
+    const char* pszModeA = "shared";
+    DWORD dwFlags = 0;
+    UINT nThreads = 8;
+    HANDLE* hThreads;
+    LARGE_INTEGER freq, t0, t1;
+    UINT i;
+
+    if(argc > 1)
+        pszMode = argv[1];
+    if(argc > 2)
+        nThreads = _tcstoul(argv[2], NULL, 10);
+    if(argc > 3)
+        nIterations = _tcstoul(argv[3], NULL, 10);
+
+    if(_tcscmp(pszMode, _T("mt")) == 0) {
+        dwFlags = WD_D2D_MULTITHREADED;
+        pszModeA = "mt";
+    } else if(_tcscmp(pszMode, _T("perthread")) == 0) {
+        dwFlags = WD_D2D_PERTHREADFACTORY;
+        pszModeA = "perthread";
+    }
+
+    InitializeCriticalSection(&lock);
+    wdPreInitialize(Lock, Unlock, dwFlags);
+    if(!wdInitialize(0)) {
+        fprintf(stderr, "wdInitialize() failed.\n");
+        return 1;
+    }
+    wdResetLockStats();
+
+    hThreads = (HANDLE*) malloc(nThreads * sizeof(HANDLE));
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t0);
+    for(i = 0; i < nThreads; i++)
+        hThreads[i] = CreateThread(NULL, 0, WorkerProc, NULL, 0, NULL);
+    for(i = 0; i < nThreads; i++) {
+        WaitForSingleObject(hThreads[i], INFINITE);
+        CloseHandle(hThreads[i]);
+    }
+    QueryPerformanceCounter(&t1);
+    free(hThreads);
+
+    for(i = 0; i < WD_LOCKSITE_COUNT; i++) {
+        WD_LOCKSTATS stats;
+
+        wdGetLockStats(i, &stats);
+        printf("%s %s %I64u %I64u %.3f\n", pszModeA, siteNames[i],
+               stats.uAcquisitions, stats.uWaitMicroseconds,
+               (stats.uAcquisitions > 0)
+                    ? (double) stats.uWaitMicroseconds / (double) stats.uAcquisitions
+                    : 0.0);
+    }
+    printf("%s wall_ms %.3f\n", pszModeA,
+           (double) (t1.QuadPart - t0.QuadPart) * 1000.0 / (double) freq.QuadPart);
+
+    wdTerminate(0);
+    DeleteCriticalSection(&lock);
+    return 0;
+}
@@ -0,0 +1,407 @@
+/*
+ * Null custom back-end. See nullbackend.h.
+ */
+
+#include <stdlib.h>
+#include <windows.h>
+
+#include "nullbackend.h"
+
+/* With the stand-ins linked in, calls into the null back-end are counted
+ * as the back-end calls too. */
+#ifdef WDBENCH_STANDIN
+    #include "standin.h"
+    #define NULL_RECORD()   STANDIN_RECORD()
+#else
+    #define NULL_RECORD()   do { } while(0)
+#endif
+
+
+/* Objects without any state all share this one. */
+static int null_object;
+#define NULL_OBJECT     ((void*) &null_object)
+
+typedef struct NULL_IMAGE_tag NULL_IMAGE;
+struct NULL_IMAGE_tag {
+    UINT w;
+    UINT h;
+};
+
+typedef struct NULL_FONT_tag NULL_FONT;
+struct NULL_FONT_tag {
+    float size;
+};
+
+
+/****************
+ ***  Canvas  ***
+ ****************/
+
+static void*
+null_create_canvas(HDC dc, UINT width, UINT height, DWORD flags)
+{
+    NULL_RECORD();
+    return NULL_OBJECT;
+}
+
+static void
+null_canvas(void* canvas)
+{
+    NULL_RECORD();
+}
+
+static BOOL
+null_end_paint(void* canvas)
+{
+    NULL_RECORD();
+    return TRUE;
+}
+
+static BOOL
+null_resize_canvas(void* canvas, UINT width, UINT height)
+{
+    NULL_RECORD();
+    return TRUE;
+}
+
+static void
+null_clear(void* canvas, WD_COLOR color)
+{
+    NULL_RECORD();
+}
+
+static void
+null_set_transform(void* canvas, const WD_MATRIX* matrix)
+{
+    NULL_RECORD();
+}
+
+static void
+null_push_clip(void* canvas, const WD_RECT* rect, void* path)
+{
+    NULL_RECORD();
+}
+
+
+/***********************************
+ ***  Brushes and Stroke Styles  ***
+ ***********************************/
+
+static void*
+null_create_solid_brush(void* canvas, WD_COLOR color)
+{
+    NULL_RECORD();
+    return NULL_OBJECT;
+}
+
+static void*
+null_create_linear_brush(void* canvas, float x0, float y0, float x1, float y1,
+                         const WD_COLOR* colors, const float* offsets, UINT n)
+{
+    NULL_RECORD();
+    return NULL_OBJECT;
+}
+
+static void*
+null_create_radial_brush(void* canvas, float cx, float cy, float r, float fx, float fy,
+                         const WD_COLOR* colors, const float* offsets, UINT n)
+{
+    NULL_RECORD();
+    return NULL_OBJECT;
+}
+
+static void
+null_set_brush_color(void* brush, WD_COLOR color)
+{
+    NULL_RECORD();
+}
+
+static void*
+null_create_stroke_style(const float* dashes, UINT n, UINT cap, UINT join)
+{
+    NULL_RECORD();
+    return NULL_OBJECT;
+}
+
+static void
+null_destroy(void* obj)
+{
+    NULL_RECORD();
+}
+
+
+/***************
+ ***  Paths  ***
+ ***************/
+
+static void*
+null_create_path(void* canvas)
+{
+    NULL_RECORD();
+    return NULL_OBJECT;
+}
+
+static void*
+null_open_sink(void* path)
+{
+    NULL_RECORD();
+    return path;
+}
+
+static void
+null_begin_figure(void* sink, float x, float y)
+{
+    NULL_RECORD();
+}
+
+static void
+null_end_figure(void* sink, BOOL close)
+{
+    NULL_RECORD();
+}
+
+static void
+null_add_arc(void* sink, float cx, float cy, float r, float base, float sweep)
+{
+    NULL_RECORD();
+}
+
+static void
+null_add_bezier(void* sink, float x0, float y0, float x1, float y1, float x2, float y2)
+{
+    NULL_RECORD();
+}
+
+
+/****************
+ ***  Images  ***
+ ****************/
+
+/* Images remember their size as wdGetImageSize() and wdBitBltImage() need
+ * it. The pixels are dropped. */
+static void*
+null_create_image(UINT w, UINT h, UINT stride, const BYTE* bits)
+{
+    NULL_IMAGE* img;
+
+    NULL_RECORD();
+    img = (NULL_IMAGE*) malloc(sizeof(NULL_IMAGE));
+    if(img != NULL) {
+        img->w = w;
+        img->h = h;
+    }
+    return img;
+}
+
+static void
+null_free(void* obj)
+{
+    NULL_RECORD();
+    free(obj);
+}
+
+static void
+null_get_image_size(void* image, UINT* w, UINT* h)
+{
+    NULL_RECORD();
+    *w = ((NULL_IMAGE*) image)->w;
+    *h = ((NULL_IMAGE*) image)->h;
+}
+
+static void*
+null_create_cached_image(void* canvas, void* image)
+{
+    NULL_RECORD();
+    return NULL_OBJECT;
+}
+
+
+/***************
+ ***  Fonts  ***
+ ***************/
+
+static void*
+null_create_font(const LOGFONTW* lf)
+{
+    NULL_FONT* font;
+
+    NULL_RECORD();
+    font = (NULL_FONT*) malloc(sizeof(NULL_FONT));
+    if(font != NULL)
+        font->size = (float) (lf->lfHeight < 0 ? -lf->lfHeight : lf->lfHeight);
+    return font;
+}
+
+static void
+null_font_metrics(void* font, WD_FONTMETRICS* metrics)
+{
+    float size = ((NULL_FONT*) font)->size;
+
+    NULL_RECORD();
+    metrics->fEmHeight = size;
+    metrics->fAscent = size * 0.8f;
+    metrics->fDescent = size * 0.2f;
+    metrics->fLeading = size * 1.2f;
+}
+
+
+/******************
+ ***  Painting  ***
+ ******************/
+
+static void
+null_draw_arc(void* canvas, void* brush, float cx, float cy, float rx, float ry,
+              float base, float sweep, float width, void* style)
+{
+    NULL_RECORD();
+}
+
+static void
+null_draw_ellipse(void* canvas, void* brush, float cx, float cy, float rx, float ry,
+                  float width, void* style)
+{
+    NULL_RECORD();
+}
+
+static void
+null_draw_line(void* canvas, void* brush, float x0, float y0, float x1, float y1,
+               float width, void* style)
+{
+    NULL_RECORD();
+}
+
+static void
+null_draw_path(void* canvas, void* brush, void* path, float width, void* style)
+{
+    NULL_RECORD();
+}
+
+static void
+null_fill_ellipse(void* canvas, void* brush, float cx, float cy, float rx, float ry)
+{
+    NULL_RECORD();
+}
+
+static void
+null_fill_pie(void* canvas, void* brush, float cx, float cy, float rx, float ry,
+              float base, float sweep)
+{
+    NULL_RECORD();
+}
+
+static void
+null_fill_path(void* canvas, void* brush, void* path)
+{
+    NULL_RECORD();
+}
+
+static void
+null_fill_rect(void* canvas, void* brush, float x0, float y0, float x1, float y1)
+{
+    NULL_RECORD();
+}
+
+static void
+null_bitblt_image(void* canvas, void* image, const WD_RECT* dest, const WD_RECT* src)
+{
+    NULL_RECORD();
+}
+
+static void
+null_bitblt_cached_image(void* canvas, void* cached_image, float x, float y)
+{
+    NULL_RECORD();
+}
+
+static void
+null_draw_string(void* canvas, void* font, const WD_RECT* rect, const WCHAR* text,
+                 int len, void* brush, DWORD flags)
+{
+    NULL_RECORD();
+}
+
+/* Pretend every character is half of the em square wide. */
+static void
+null_measure_string(void* canvas, void* font, const WD_RECT* rect, const WCHAR* text,
+                    int len, WD_RECT* result, DWORD flags)
+{
+    float size = ((NULL_FONT*) font)->size;
+
+    NULL_RECORD();
+    if(len < 0)
+        len = (int) wcslen(text);
+    result->x0 = rect->x0;
+    result->y0 = rect->y0;
+    result->x1 = rect->x0 + (float) len * size * 0.5f;
+    result->y1 = rect->y0 + size * 1.2f;
+}
+
+
+const WD_BACKEND_OPS null_backend_ops = {
+    sizeof(WD_BACKEND_OPS),
+
+    NULL,                           /* fnInitialize */
+    NULL,                           /* fnTerminate */
+
+    null_create_canvas,
+    null_canvas,                    /* fnDestroyCanvas */
+    null_canvas,                    /* fnBeginPaint */
+    null_end_paint,
+    null_resize_canvas,
+    NULL,                           /* fnStartGdi */
+    NULL,                           /* fnEndGdi */
+    null_clear,
+    null_set_transform,
+    null_push_clip,
+    null_canvas,                    /* fnPopClip */
+
+    null_create_solid_brush,
+    null_create_linear_brush,
+    null_create_radial_brush,
+    null_destroy,                   /* fnDestroyBrush */
+    null_set_brush_color,
+    null_create_stroke_style,
+    null_destroy,                   /* fnDestroyStrokeStyle */
+
+    null_create_path,
+    null_destroy,                   /* fnDestroyPath */
+    null_open_sink,
+    null_destroy,                   /* fnClosePathSink */
+    null_begin_figure,
+    null_end_figure,
+    null_begin_figure,              /* fnAddLine */
+    null_add_arc,
+    null_add_bezier,
+
+    null_create_image,
+    NULL,                           /* fnLoadImageFromFile */
+    NULL,                           /* fnLoadImageFromIStream */
+    null_free,                      /* fnDestroyImage */
+    null_get_image_size,
+    null_create_cached_image,
+    null_destroy,                   /* fnDestroyCachedImage */
+
+    null_create_font,
+    null_free,                      /* fnDestroyFont */
+    null_font_metrics,
+
+    null_draw_arc,                  /* fnDrawEllipseArc */
+    null_draw_arc,                  /* fnDrawEllipsePie */
+    null_draw_ellipse,
+    null_draw_line,
+    null_draw_path,
+    null_draw_line,                 /* fnDrawRect */
+    null_fill_ellipse,
+    null_fill_pie,
+    null_fill_path,
+    null_fill_rect,
+    null_bitblt_image,
+    null_bitblt_cached_image,
+    null_draw_string,
+    null_measure_string,
+
+    NULL,                           /* fnEndPaintRects */
+    NULL,                           /* fnRebindCanvas */
+    NULL,                           /* fnSetStrokeStyleMiterLimit */
+    NULL                            /* fnSetPathFillMode */
+};
@@ -0,0 +1,20 @@
+/*
+ * Null custom back-end (see wdInitializeWithBackend()).
+ *
+ * It implements every WD_BACKEND_OPS member as a no-op, so a benchmark or
+ * a replay run against it measures only the cost of WinDrawLib itself: the
+ * API dispatch, the transformation and state bookkeeping, culling and the
+ * statistics. Unlike the stand-ins (see standin.h), it needs no emulation
+ * of the system libraries, so it works the same way everywhere.
+ */
+
+#ifndef WDBENCH_NULLBACKEND_H
+#define WDBENCH_NULLBACKEND_H
+
+#include <wdl.h>
+
+
+extern const WD_BACKEND_OPS null_backend_ops;
+
+
+#endif  /* WDBENCH_NULLBACKEND_H */
@@ -0,0 +1,613 @@
+/*
+ * Recording stand-in for D2D1.DLL.
+ *
+ * Implements just the methods WinDrawLib calls, over the vtable layouts from
+ * src/dummy/d2d1.h. All objects are static singletons (reference counting
+ * is not emulated), except bitmaps which have to remember their size.
+ */
+
+#include "standin.h"
+#include "backend-d2d.h"
+
+
+#define STANDIN_OBJECT(type, vtbl)      { (type##Vtbl*) &(vtbl) }
+
+
+/* The derived render target interfaces only extend ID2D1RenderTarget, so
+ * compose their vtables from the base one. (The dummy headers spell them
+ * out in full, but with the inherited methods as untyped placeholders.) */
+typedef struct target_dc_vtbl_tag target_dc_vtbl_t;
+struct target_dc_vtbl_tag {
+    dummy_ID2D1RenderTargetVtbl base;
+    STDMETHOD(BindDC)(dummy_ID2D1DCRenderTarget*, const HDC, const RECT*);
+};
+
+typedef struct target_hwnd_vtbl_tag target_hwnd_vtbl_t;
+struct target_hwnd_vtbl_tag {
+    dummy_ID2D1RenderTargetVtbl base;
+    STDMETHOD(dummy_CheckWindowState)(void);
+    STDMETHOD(Resize)(dummy_ID2D1HwndRenderTarget*, const dummy_D2D1_SIZE_U*);
+    STDMETHOD(dummy_GetHwnd)(void);
+};
+
+/* Compile-time check the composed layouts match the dummy headers. */
+typedef char target_dc_vtbl_check[
+        sizeof(target_dc_vtbl_t) == sizeof(dummy_ID2D1DCRenderTargetVtbl) ? 1 : -1];
+typedef char target_hwnd_vtbl_check[
+        sizeof(target_hwnd_vtbl_t) == sizeof(dummy_ID2D1HwndRenderTargetVtbl) ? 1 : -1];
+
+
+/* IUnknown boilerplate, shared by all the interfaces. The `this` pointer is
+ * not used, so the one implementation serves all of them. */
+static HRESULT STDMETHODCALLTYPE
+unknown_QueryInterface(void* self, REFIID riid, void** obj)
+{
+    STANDIN_RECORD();
+    *obj = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG STDMETHODCALLTYPE
+unknown_AddRef(void* self)
+{
+    STANDIN_RECORD();
+    return 1;
+}
+
+static ULONG STDMETHODCALLTYPE
+unknown_Release(void* self)
+{
+    STANDIN_RECORD();
+    return 0;
+}
+
+#define UNKNOWN_METHODS(iface)                                                 \
+    .QueryInterface = (HRESULT (STDMETHODCALLTYPE*)(iface*, REFIID, void**))   \
+                                unknown_QueryInterface,                        \
+    .AddRef = (ULONG (STDMETHODCALLTYPE*)(iface*)) unknown_AddRef,             \
+    .Release = (ULONG (STDMETHODCALLTYPE*)(iface*)) unknown_Release
+
+
+/*************************************
+ ***  Simple resources and brushes  ***
+ *************************************/
+
+static dummy_ID2D1StrokeStyleVtbl stroke_vtbl = {
+    UNKNOWN_METHODS(dummy_ID2D1StrokeStyle)
+};
+static dummy_ID2D1StrokeStyle stroke = STANDIN_OBJECT(dummy_ID2D1StrokeStyle, stroke_vtbl);
+
+static dummy_ID2D1LayerVtbl layer_vtbl = {
+    UNKNOWN_METHODS(dummy_ID2D1Layer)
+};
+static dummy_ID2D1Layer layer = STANDIN_OBJECT(dummy_ID2D1Layer, layer_vtbl);
+
+static dummy_ID2D1GradientStopCollectionVtbl stops_vtbl = {
+    UNKNOWN_METHODS(dummy_ID2D1GradientStopCollection)
+};
+static dummy_ID2D1GradientStopCollection stops =
+        STANDIN_OBJECT(dummy_ID2D1GradientStopCollection, stops_vtbl);
+
+static void STDMETHODCALLTYPE
+solid_SetColor(dummy_ID2D1SolidColorBrush* self, const dummy_D2D1_COLOR_F* color)
+{
+    STANDIN_RECORD();
+}
+
+static dummy_ID2D1SolidColorBrushVtbl solid_vtbl = {
+    UNKNOWN_METHODS(dummy_ID2D1SolidColorBrush),
+    .SetColor = solid_SetColor
+};
+static dummy_ID2D1SolidColorBrush solid = STANDIN_OBJECT(dummy_ID2D1SolidColorBrush, solid_vtbl);
+
+static dummy_ID2D1LinearGradientBrushVtbl linear_vtbl = {
+    UNKNOWN_METHODS(dummy_ID2D1LinearGradientBrush)
+};
+static dummy_ID2D1LinearGradientBrush linear =
+        STANDIN_OBJECT(dummy_ID2D1LinearGradientBrush, linear_vtbl);
+
+static dummy_ID2D1RadialGradientBrushVtbl radial_vtbl = {
+    UNKNOWN_METHODS(dummy_ID2D1RadialGradientBrush)
+};
+static dummy_ID2D1RadialGradientBrush radial =
+        STANDIN_OBJECT(dummy_ID2D1RadialGradientBrush, radial_vtbl);
+
+
+/*****************
+ ***  Bitmaps  ***
+ *****************/
+
+typedef struct bitmap_tag bitmap_t;
+struct bitmap_tag {
+    dummy_ID2D1Bitmap iface;    /* Must be first. */
+    dummy_D2D1_SIZE_U size;
+};
+
+static ULONG STDMETHODCALLTYPE
+bitmap_Release(dummy_ID2D1Bitmap* self)
+{
+    STANDIN_RECORD();
+    free(self);
+    return 0;
+}
+
+static void STDMETHODCALLTYPE
+bitmap_GetPixelSize(dummy_ID2D1Bitmap* self, dummy_D2D1_SIZE_U* size)
+{
+    STANDIN_RECORD();
+    *size = ((bitmap_t*) self)->size;
+}
+
+static dummy_ID2D1BitmapVtbl bitmap_vtbl = {
+    .QueryInterface = (HRESULT (STDMETHODCALLTYPE*)(dummy_ID2D1Bitmap*, REFIID, void**))
+                                unknown_QueryInterface,
+    .AddRef = (ULONG (STDMETHODCALLTYPE*)(dummy_ID2D1Bitmap*)) unknown_AddRef,
+    .Release = bitmap_Release,
+    .GetPixelSize = bitmap_GetPixelSize
+};
+
+
+/**************************
+ ***  Geometry (paths)  ***
+ **************************/
+
+static void STDMETHODCALLTYPE
+sink_SetFillMode(dummy_ID2D1GeometrySink* self, dummy_D2D1_FILL_MODE mode)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+sink_BeginFigure(dummy_ID2D1GeometrySink* self, dummy_D2D1_POINT_2F pt,
+                 dummy_D2D1_FIGURE_BEGIN begin)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+sink_EndFigure(dummy_ID2D1GeometrySink* self, dummy_D2D1_FIGURE_END end)
+{
+    STANDIN_RECORD();
+}
+
+static HRESULT STDMETHODCALLTYPE
+sink_Close(dummy_ID2D1GeometrySink* self)
+{
+    STANDIN_RECORD();
+    return S_OK;
+}
+
+static void STDMETHODCALLTYPE
+sink_AddLine(dummy_ID2D1GeometrySink* self, dummy_D2D1_POINT_2F pt)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+sink_AddLines(dummy_ID2D1GeometrySink* self, const dummy_D2D1_POINT_2F* pts, UINT32 count)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+sink_AddBezier(dummy_ID2D1GeometrySink* self, const dummy_D2D1_BEZIER_SEGMENT* seg)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+sink_AddBeziers(dummy_ID2D1GeometrySink* self, const dummy_D2D1_BEZIER_SEGMENT* segs, UINT32 count)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+sink_AddArc(dummy_ID2D1GeometrySink* self, const dummy_D2D1_ARC_SEGMENT* seg)
+{
+    STANDIN_RECORD();
+}
+
+static dummy_ID2D1GeometrySinkVtbl sink_vtbl = {
+    UNKNOWN_METHODS(dummy_ID2D1GeometrySink),
+    .SetFillMode = sink_SetFillMode,
+    .BeginFigure = sink_BeginFigure,
+    .EndFigure = sink_EndFigure,
+    .Close = sink_Close,
+    .AddLine = sink_AddLine,
+    .AddLines = sink_AddLines,
+    .AddBezier = sink_AddBezier,
+    .AddBeziers = sink_AddBeziers,
+    .AddArc = sink_AddArc
+};
+static dummy_ID2D1GeometrySink sink = STANDIN_OBJECT(dummy_ID2D1GeometrySink, sink_vtbl);
+
+static HRESULT STDMETHODCALLTYPE
+path_Open(dummy_ID2D1PathGeometry* self, dummy_ID2D1GeometrySink** p_sink)
+{
+    STANDIN_RECORD();
+    *p_sink = &sink;
+    return S_OK;
+}
+
+static dummy_ID2D1PathGeometryVtbl path_vtbl = {
+    UNKNOWN_METHODS(dummy_ID2D1PathGeometry),
+    .Open = path_Open
+};
+static dummy_ID2D1PathGeometry path = STANDIN_OBJECT(dummy_ID2D1PathGeometry, path_vtbl);
+
+
+/***********************
+ ***  Render target  ***
+ ***********************/
+
+static HRESULT STDMETHODCALLTYPE
+interop_GetDC(dummy_ID2D1GdiInteropRenderTarget* self,
+              dummy_D2D1_DC_INITIALIZE_MODE mode, HDC* p_dc)
+{
+    STANDIN_RECORD();
+    *p_dc = GetDC(NULL);
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+interop_ReleaseDC(dummy_ID2D1GdiInteropRenderTarget* self, const RECT* update)
+{
+    STANDIN_RECORD();
+    return S_OK;
+}
+
+static dummy_ID2D1GdiInteropRenderTargetVtbl interop_vtbl = {
+    UNKNOWN_METHODS(dummy_ID2D1GdiInteropRenderTarget),
+    .GetDC = interop_GetDC,
+    .ReleaseDC = interop_ReleaseDC
+};
+static dummy_ID2D1GdiInteropRenderTarget interop =
+        STANDIN_OBJECT(dummy_ID2D1GdiInteropRenderTarget, interop_vtbl);
+
+static HRESULT STDMETHODCALLTYPE
+target_QueryInterface(dummy_ID2D1RenderTarget* self, REFIID riid, void** obj)
+{
+    STANDIN_RECORD();
+    if(IsEqualIID(riid, &dummy_IID_ID2D1GdiInteropRenderTarget)) {
+        *obj = &interop;
+        return S_OK;
+    }
+
+    *obj = NULL;
+    return E_NOINTERFACE;
+}
+
+static HRESULT STDMETHODCALLTYPE
+target_CreateBitmapFromWicBitmap(dummy_ID2D1RenderTarget* self,
+            IWICBitmapSource* source, const dummy_D2D1_BITMAP_PROPERTIES* props,
+            dummy_ID2D1Bitmap** p_bitmap)
+{
+    bitmap_t* b;
+
+    STANDIN_RECORD();
+    b = (bitmap_t*) malloc(sizeof(bitmap_t));
+    if(b == NULL)
+        return E_OUTOFMEMORY;
+    b->iface.vtbl = &bitmap_vtbl;
+    standin_wic_get_size(source, &b->size.width, &b->size.height);
+
+    *p_bitmap = &b->iface;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+target_CreateSolidColorBrush(dummy_ID2D1RenderTarget* self,
+            const dummy_D2D1_COLOR_F* color, const void* props,
+            dummy_ID2D1SolidColorBrush** p_brush)
+{
+    STANDIN_RECORD();
+    *p_brush = &solid;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+target_CreateGradientStopCollection(dummy_ID2D1RenderTarget* self,
+            const dummy_D2D1_GRADIENT_STOP* stop_list, UINT32 n,
+            dummy_D2D1_GAMMA gamma, dummy_D2D1_EXTEND_MODE extend,
+            dummy_ID2D1GradientStopCollection** p_stops)
+{
+    STANDIN_RECORD();
+    *p_stops = &stops;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+target_CreateLinearGradientBrush(dummy_ID2D1RenderTarget* self,
+            const dummy_D2D1_LINEAR_GRADIENT_BRUSH_PROPERTIES* gradient_props,
+            const dummy_D2D1_BRUSH_PROPERTIES* props,
+            dummy_ID2D1GradientStopCollection* stop_collection,
+            dummy_ID2D1LinearGradientBrush** p_brush)
+{
+    STANDIN_RECORD();
+    *p_brush = &linear;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+target_CreateRadialGradientBrush(dummy_ID2D1RenderTarget* self,
+            const dummy_D2D1_RADIAL_GRADIENT_BRUSH_PROPERTIES* gradient_props,
+            const dummy_D2D1_BRUSH_PROPERTIES* props,
+            dummy_ID2D1GradientStopCollection* stop_collection,
+            dummy_ID2D1RadialGradientBrush** p_brush)
+{
+    STANDIN_RECORD();
+    *p_brush = &radial;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+target_CreateLayer(dummy_ID2D1RenderTarget* self, const dummy_D2D1_SIZE_F* size,
+                   dummy_ID2D1Layer** p_layer)
+{
+    STANDIN_RECORD();
+    *p_layer = &layer;
+    return S_OK;
+}
+
+static void STDMETHODCALLTYPE
+target_DrawLine(dummy_ID2D1RenderTarget* self, dummy_D2D1_POINT_2F p0,
+                dummy_D2D1_POINT_2F p1, dummy_ID2D1Brush* brush, FLOAT width,
+                dummy_ID2D1StrokeStyle* style)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_DrawRectangle(dummy_ID2D1RenderTarget* self, const dummy_D2D1_RECT_F* rect,
+                     dummy_ID2D1Brush* brush, FLOAT width, dummy_ID2D1StrokeStyle* style)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_FillRectangle(dummy_ID2D1RenderTarget* self, const dummy_D2D1_RECT_F* rect,
+                     dummy_ID2D1Brush* brush)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_DrawEllipse(dummy_ID2D1RenderTarget* self, const dummy_D2D1_ELLIPSE* ellipse,
+                   dummy_ID2D1Brush* brush, FLOAT width, dummy_ID2D1StrokeStyle* style)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_FillEllipse(dummy_ID2D1RenderTarget* self, const dummy_D2D1_ELLIPSE* ellipse,
+                   dummy_ID2D1Brush* brush)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_DrawGeometry(dummy_ID2D1RenderTarget* self, dummy_ID2D1Geometry* geometry,
+                    dummy_ID2D1Brush* brush, FLOAT width, dummy_ID2D1StrokeStyle* style)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_FillGeometry(dummy_ID2D1RenderTarget* self, dummy_ID2D1Geometry* geometry,
+                    dummy_ID2D1Brush* brush, dummy_ID2D1Brush* opacity_brush)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_DrawBitmap(dummy_ID2D1RenderTarget* self, dummy_ID2D1Bitmap* bitmap,
+                  const dummy_D2D1_RECT_F* dst, FLOAT opacity,
+                  dummy_D2D1_BITMAP_INTERPOLATION_MODE mode,
+                  const dummy_D2D1_RECT_F* src)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_DrawTextLayout(dummy_ID2D1RenderTarget* self, dummy_D2D1_POINT_2F origin,
+                      dummy_IDWriteTextLayout* layout, dummy_ID2D1Brush* brush,
+                      unsigned options)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_SetTransform(dummy_ID2D1RenderTarget* self, const dummy_D2D1_MATRIX_3X2_F* m)
+{
+    STANDIN_RECORD();
+}
+
+static HRESULT STDMETHODCALLTYPE
+target_SetTextAntialiasMode(dummy_ID2D1RenderTarget* self,
+                            dummy_D2D1_TEXT_ANTIALIAS_MODE mode)
+{
+    STANDIN_RECORD();
+    return S_OK;
+}
+
+static void STDMETHODCALLTYPE
+target_PushLayer(dummy_ID2D1RenderTarget* self,
+                 const dummy_D2D1_LAYER_PARAMETERS* params, dummy_ID2D1Layer* l)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_PopLayer(dummy_ID2D1RenderTarget* self)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_PushAxisAlignedClip(dummy_ID2D1RenderTarget* self,
+                           const dummy_D2D1_RECT_F* rect, dummy_D2D1_ANTIALIAS_MODE mode)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_PopAxisAlignedClip(dummy_ID2D1RenderTarget* self)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_Clear(dummy_ID2D1RenderTarget* self, const dummy_D2D1_COLOR_F* color)
+{
+    STANDIN_RECORD();
+}
+
+static void STDMETHODCALLTYPE
+target_BeginDraw(dummy_ID2D1RenderTarget* self)
+{
+    STANDIN_RECORD();
+}
+
+static HRESULT STDMETHODCALLTYPE
+target_EndDraw(dummy_ID2D1RenderTarget* self, void* tag1, void* tag2)
+{
+    STANDIN_RECORD();
+    return S_OK;
+}
+
+static void STDMETHODCALLTYPE
+target_SetDpi(dummy_ID2D1RenderTarget* self, FLOAT dpi_x, FLOAT dpi_y)
+{
+    STANDIN_RECORD();
+}
+
+#define TARGET_METHODS                                                         \
+    .QueryInterface = target_QueryInterface,                                   \
+    .AddRef = (ULONG (STDMETHODCALLTYPE*)(dummy_ID2D1RenderTarget*)) unknown_AddRef, \
+    .Release = (ULONG (STDMETHODCALLTYPE*)(dummy_ID2D1RenderTarget*)) unknown_Release, \
+    .CreateBitmapFromWicBitmap = target_CreateBitmapFromWicBitmap,             \
+    .CreateSolidColorBrush = target_CreateSolidColorBrush,                     \
+    .CreateGradientStopCollection = target_CreateGradientStopCollection,       \
+    .CreateLinearGradientBrush = target_CreateLinearGradientBrush,             \
+    .CreateRadialGradientBrush = target_CreateRadialGradientBrush,             \
+    .CreateLayer = target_CreateLayer,                                         \
+    .DrawLine = target_DrawLine,                                               \
+    .DrawRectangle = target_DrawRectangle,                                     \
+    .FillRectangle = target_FillRectangle,                                     \
+    .DrawEllipse = target_DrawEllipse,                                         \
+    .FillEllipse = target_FillEllipse,                                         \
+    .DrawGeometry = target_DrawGeometry,                                       \
+    .FillGeometry = target_FillGeometry,                                       \
+    .DrawBitmap = target_DrawBitmap,                                           \
+    .DrawTextLayout = target_DrawTextLayout,                                   \
+    .SetTransform = target_SetTransform,                                       \
+    .SetTextAntialiasMode = target_SetTextAntialiasMode,                       \
+    .PushLayer = target_PushLayer,                                             \
+    .PopLayer = target_PopLayer,                                               \
+    .PushAxisAlignedClip = target_PushAxisAlignedClip,                         \
+    .PopAxisAlignedClip = target_PopAxisAlignedClip,                           \
+    .Clear = target_Clear,                                                     \
+    .BeginDraw = target_BeginDraw,                                             \
+    .EndDraw = target_EndDraw,                                                 \
+    .SetDpi = target_SetDpi
+
+static HRESULT STDMETHODCALLTYPE
+target_BindDC(dummy_ID2D1DCRenderTarget* self, const HDC dc, const RECT* rect)
+{
+    STANDIN_RECORD();
+    return S_OK;
+}
+
+static target_dc_vtbl_t target_dc_vtbl = {
+    .base = { TARGET_METHODS },
+    .BindDC = target_BindDC
+};
+static dummy_ID2D1DCRenderTarget target_dc =
+        STANDIN_OBJECT(dummy_ID2D1DCRenderTarget, target_dc_vtbl);
+
+static HRESULT STDMETHODCALLTYPE
+target_Resize(dummy_ID2D1HwndRenderTarget* self, const dummy_D2D1_SIZE_U* size)
+{
+    STANDIN_RECORD();
+    return S_OK;
+}
+
+static target_hwnd_vtbl_t target_hwnd_vtbl = {
+    .base = { TARGET_METHODS },
+    .Resize = target_Resize
+};
+static dummy_ID2D1HwndRenderTarget target_hwnd =
+        STANDIN_OBJECT(dummy_ID2D1HwndRenderTarget, target_hwnd_vtbl);
+
+#undef TARGET_METHODS
+
+
+/*****************
+ ***  Factory  ***
+ *****************/
+
+static HRESULT STDMETHODCALLTYPE
+factory_CreatePathGeometry(dummy_ID2D1Factory* self, dummy_ID2D1PathGeometry** p_path)
+{
+    STANDIN_RECORD();
+    *p_path = &path;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+factory_CreateStrokeStyle(dummy_ID2D1Factory* self,
+            const dummy_D2D1_STROKE_STYLE_PROPERTIES* props,
+            const FLOAT* dashes, UINT32 n, dummy_ID2D1StrokeStyle** p_style)
+{
+    STANDIN_RECORD();
+    *p_style = &stroke;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+factory_CreateHwndRenderTarget(dummy_ID2D1Factory* self,
+            const dummy_D2D1_RENDER_TARGET_PROPERTIES* props,
+            const dummy_D2D1_HWND_RENDER_TARGET_PROPERTIES* hwnd_props,
+            dummy_ID2D1HwndRenderTarget** p_target)
+{
+    STANDIN_RECORD();
+    *p_target = &target_hwnd;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+factory_CreateDCRenderTarget(dummy_ID2D1Factory* self,
+            const dummy_D2D1_RENDER_TARGET_PROPERTIES* props,
+            dummy_ID2D1DCRenderTarget** p_target)
+{
+    STANDIN_RECORD();
+    *p_target = &target_dc;
+    return S_OK;
+}
+
+static dummy_ID2D1FactoryVtbl factory_vtbl = {
+    UNKNOWN_METHODS(dummy_ID2D1Factory),
+    .CreatePathGeometry = factory_CreatePathGeometry,
+    .CreateStrokeStyle = factory_CreateStrokeStyle,
+    .CreateHwndRenderTarget = factory_CreateHwndRenderTarget,
+    .CreateDCRenderTarget = factory_CreateDCRenderTarget
+};
+static dummy_ID2D1Factory factory = STANDIN_OBJECT(dummy_ID2D1Factory, factory_vtbl);
+
+static HRESULT WINAPI
+D2D1CreateFactory(dummy_D2D1_FACTORY_TYPE type, REFIID riid,
+                  const dummy_D2D1_FACTORY_OPTIONS* options, void** p_factory)
+{
+    STANDIN_RECORD();
+    *p_factory = &factory;
+    return S_OK;
+}
+
+
+void*
+standin_d2d_proc(const char* name)
+{
+    if(strcmp(name, "D2D1CreateFactory") == 0)
+        return (void*) D2D1CreateFactory;
+    return NULL;
+}
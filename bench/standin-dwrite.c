@@ -0,0 +1,372 @@
+/*
+ * Recording stand-in for DWRITE.DLL.
+ *
+ * Text formats and layouts are real allocations, as the real ones are, and
+ * they remember just enough (font size, text length) to answer the queries
+ * WinDrawLib makes. The font metrics are those of a typical sans-serif font.
+ */
+
+#include "standin.h"
+#include "backend-dwrite.h"
+
+
+#define STANDIN_OBJECT(type, vtbl)      { &(vtbl) }
+
+#define STANDIN_FAMILY_NAME     L"Segoe UI"
+
+
+static HRESULT STDMETHODCALLTYPE
+unknown_QueryInterface(void* self, REFIID riid, void** obj)
+{
+    STANDIN_RECORD();
+    *obj = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG STDMETHODCALLTYPE
+unknown_AddRef(void* self)
+{
+    STANDIN_RECORD();
+    return 1;
+}
+
+static ULONG STDMETHODCALLTYPE
+unknown_Release(void* self)
+{
+    STANDIN_RECORD();
+    return 0;
+}
+
+/* For the objects we really allocate. Reference counting is not emulated:
+ * WinDrawLib never adds references to these. */
+static ULONG STDMETHODCALLTYPE
+unknown_ReleaseAndFree(void* self)
+{
+    STANDIN_RECORD();
+    free(self);
+    return 0;
+}
+
+#define UNKNOWN_METHODS(iface, release)                                        \
+    .QueryInterface = (HRESULT (STDMETHODCALLTYPE*)(iface*, REFIID, void**))   \
+                                unknown_QueryInterface,                        \
+    .AddRef = (ULONG (STDMETHODCALLTYPE*)(iface*)) unknown_AddRef,             \
+    .Release = (ULONG (STDMETHODCALLTYPE*)(iface*)) release
+
+
+/*******************************
+ ***  Font family and names  ***
+ *******************************/
+
+static HRESULT STDMETHODCALLTYPE
+names_GetStringLength(dummy_IDWriteLocalizedStrings* self, UINT32 index, UINT32* len)
+{
+    STANDIN_RECORD();
+    *len = (UINT32) wcslen(STANDIN_FAMILY_NAME);
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+names_GetString(dummy_IDWriteLocalizedStrings* self, UINT32 index,
+                WCHAR* buffer, UINT32 size)
+{
+    STANDIN_RECORD();
+    if(size <= wcslen(STANDIN_FAMILY_NAME))
+        return E_INVALIDARG;
+    wcscpy(buffer, STANDIN_FAMILY_NAME);
+    return S_OK;
+}
+
+static dummy_IDWriteLocalizedStringsVtbl names_vtbl = {
+    UNKNOWN_METHODS(dummy_IDWriteLocalizedStrings, unknown_Release),
+    .GetStringLength = names_GetStringLength,
+    .GetString = names_GetString
+};
+static dummy_IDWriteLocalizedStrings names = STANDIN_OBJECT(dummy_IDWriteLocalizedStrings, names_vtbl);
+
+static HRESULT STDMETHODCALLTYPE
+family_GetFamilyNames(dummy_IDWriteFontFamily* self,
+                      dummy_IDWriteLocalizedStrings** p_names)
+{
+    STANDIN_RECORD();
+    *p_names = &names;
+    return S_OK;
+}
+
+static dummy_IDWriteFontFamilyVtbl family_vtbl = {
+    UNKNOWN_METHODS(dummy_IDWriteFontFamily, unknown_Release),
+    .GetFamilyNames = family_GetFamilyNames
+};
+static dummy_IDWriteFontFamily family = STANDIN_OBJECT(dummy_IDWriteFontFamily, family_vtbl);
+
+
+/**************
+ ***  Font  ***
+ **************/
+
+static HRESULT STDMETHODCALLTYPE
+font_GetFontFamily(dummy_IDWriteFont* self, dummy_IDWriteFontFamily** p_family)
+{
+    STANDIN_RECORD();
+    *p_family = &family;
+    return S_OK;
+}
+
+static dummy_DWRITE_FONT_WEIGHT STDMETHODCALLTYPE
+font_GetWeight(dummy_IDWriteFont* self)
+{
+    STANDIN_RECORD();
+    return dummy_DWRITE_FONT_WEIGHT_NORMAL;
+}
+
+static dummy_DWRITE_FONT_STRETCH STDMETHODCALLTYPE
+font_GetStretch(dummy_IDWriteFont* self)
+{
+    STANDIN_RECORD();
+    return dummy_DWRITE_FONT_STRETCH_NORMAL;
+}
+
+static dummy_DWRITE_FONT_STYLE STDMETHODCALLTYPE
+font_GetStyle(dummy_IDWriteFont* self)
+{
+    STANDIN_RECORD();
+    return dummy_DWRITE_FONT_STYLE_NORMAL;
+}
+
+static void STDMETHODCALLTYPE
+font_GetMetrics(dummy_IDWriteFont* self, dummy_DWRITE_FONT_METRICS* metrics)
+{
+    STANDIN_RECORD();
+    memset(metrics, 0, sizeof(dummy_DWRITE_FONT_METRICS));
+    metrics->designUnitsPerEm = 2048;
+    metrics->ascent = 2210;
+    metrics->descent = 514;
+    metrics->lineGap = 0;
+    metrics->capHeight = 1434;
+    metrics->xHeight = 1024;
+    metrics->underlinePosition = -190;
+    metrics->underlineThickness = 100;
+    metrics->strikethroughPosition = 530;
+    metrics->strikethroughThickness = 100;
+}
+
+static dummy_IDWriteFontVtbl font_vtbl = {
+    UNKNOWN_METHODS(dummy_IDWriteFont, unknown_Release),
+    .GetFontFamily = font_GetFontFamily,
+    .GetWeight = font_GetWeight,
+    .GetStretch = font_GetStretch,
+    .GetStyle = font_GetStyle,
+    .GetMetrics = font_GetMetrics
+};
+static dummy_IDWriteFont font = STANDIN_OBJECT(dummy_IDWriteFont, font_vtbl);
+
+static HRESULT STDMETHODCALLTYPE
+interop_CreateFontFromLOGFONT(dummy_IDWriteGdiInterop* self,
+                              const LOGFONTW* lf, dummy_IDWriteFont** p_font)
+{
+    STANDIN_RECORD();
+    *p_font = &font;
+    return S_OK;
+}
+
+static dummy_IDWriteGdiInteropVtbl interop_vtbl = {
+    UNKNOWN_METHODS(dummy_IDWriteGdiInterop, unknown_Release),
+    .CreateFontFromLOGFONT = interop_CreateFontFromLOGFONT
+};
+static dummy_IDWriteGdiInterop interop = STANDIN_OBJECT(dummy_IDWriteGdiInterop, interop_vtbl);
+
+static dummy_IDWriteInlineObjectVtbl ellipsis_vtbl = {
+    UNKNOWN_METHODS(dummy_IDWriteInlineObject, unknown_Release)
+};
+static dummy_IDWriteInlineObject ellipsis = STANDIN_OBJECT(dummy_IDWriteInlineObject, ellipsis_vtbl);
+
+
+/*****************************
+ ***  Text format, layout  ***
+ *****************************/
+
+typedef struct text_format_tag text_format_t;
+struct text_format_tag {
+    dummy_IDWriteTextFormat iface;  /* Must be first. */
+    FLOAT font_size;
+};
+
+static FLOAT STDMETHODCALLTYPE
+format_GetFontSize(dummy_IDWriteTextFormat* self)
+{
+    STANDIN_RECORD();
+    return ((text_format_t*) self)->font_size;
+}
+
+static dummy_IDWriteTextFormatVtbl format_vtbl = {
+    UNKNOWN_METHODS(dummy_IDWriteTextFormat, unknown_ReleaseAndFree),
+    .GetFontSize = format_GetFontSize
+};
+
+typedef struct text_layout_tag text_layout_t;
+struct text_layout_tag {
+    dummy_IDWriteTextLayout iface;  /* Must be first. */
+    UINT32 len;
+    FLOAT font_size;
+    FLOAT max_width;
+    FLOAT max_height;
+};
+
+static HRESULT STDMETHODCALLTYPE
+layout_SetTextAlignment(dummy_IDWriteTextLayout* self,
+                        dummy_DWRITE_TEXT_ALIGNMENT align)
+{
+    STANDIN_RECORD();
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+layout_SetParagraphAlignment(dummy_IDWriteTextLayout* self,
+                             dummy_DWRITE_PARAGRAPH_ALIGNMENT align)
+{
+    STANDIN_RECORD();
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+layout_SetWordWrapping(dummy_IDWriteTextLayout* self,
+                       dummy_DWRITE_WORD_WRAPPING wrapping)
+{
+    STANDIN_RECORD();
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+layout_SetReadingDirection(dummy_IDWriteTextLayout* self,
+                           dummy_DWRITE_READING_DIRECTION dir)
+{
+    STANDIN_RECORD();
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+layout_SetTrimming(dummy_IDWriteTextLayout* self,
+                   const dummy_DWRITE_TRIMMING* trimming,
+                   dummy_IDWriteInlineObject* sign)
+{
+    STANDIN_RECORD();
+    return S_OK;
+}
+
+/* Pretend every glyph is about half an em wide, on a single line. */
+static HRESULT STDMETHODCALLTYPE
+layout_GetMetrics(dummy_IDWriteTextLayout* self, dummy_DWRITE_TEXT_METRICS* metrics)
+{
+    text_layout_t* l = (text_layout_t*) self;
+    FLOAT width = 0.55f * l->font_size * (FLOAT) l->len;
+
+    STANDIN_RECORD();
+    metrics->left = 0.0f;
+    metrics->top = 0.0f;
+    metrics->width = width;
+    metrics->widthIncludingTrailingWhitespace = width;
+    metrics->height = 1.33f * l->font_size;
+    metrics->layoutWidth = l->max_width;
+    metrics->layoutHeight = l->max_height;
+    metrics->maxBidiReorderingDepth = 1;
+    metrics->lineCount = 1;
+    return S_OK;
+}
+
+static dummy_IDWriteTextLayoutVtbl layout_vtbl = {
+    UNKNOWN_METHODS(dummy_IDWriteTextLayout, unknown_ReleaseAndFree),
+    .SetTextAlignment = layout_SetTextAlignment,
+    .SetParagraphAlignment = layout_SetParagraphAlignment,
+    .SetWordWrapping = layout_SetWordWrapping,
+    .SetReadingDirection = layout_SetReadingDirection,
+    .SetTrimming = layout_SetTrimming,
+    .GetMetrics = layout_GetMetrics
+};
+
+
+/*****************
+ ***  Factory  ***
+ *****************/
+
+static HRESULT STDMETHODCALLTYPE
+factory_CreateTextFormat(dummy_IDWriteFactory* self, WCHAR const* family_name,
+            void* collection, dummy_DWRITE_FONT_WEIGHT weight,
+            dummy_DWRITE_FONT_STYLE style, dummy_DWRITE_FONT_STRETCH stretch,
+            FLOAT size, WCHAR const* locale, dummy_IDWriteTextFormat** p_format)
+{
+    text_format_t* f;
+
+    STANDIN_RECORD();
+    f = (text_format_t*) malloc(sizeof(text_format_t));
+    if(f == NULL)
+        return E_OUTOFMEMORY;
+    f->iface.vtbl = &format_vtbl;
+    f->font_size = size;
+
+    *p_format = &f->iface;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+factory_GetGdiInterop(dummy_IDWriteFactory* self, dummy_IDWriteGdiInterop** p_interop)
+{
+    STANDIN_RECORD();
+    *p_interop = &interop;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+factory_CreateTextLayout(dummy_IDWriteFactory* self, WCHAR const* str, UINT32 len,
+            dummy_IDWriteTextFormat* format, FLOAT max_width, FLOAT max_height,
+            dummy_IDWriteTextLayout** p_layout)
+{
+    text_layout_t* l;
+
+    STANDIN_RECORD();
+    l = (text_layout_t*) malloc(sizeof(text_layout_t));
+    if(l == NULL)
+        return E_OUTOFMEMORY;
+    l->iface.vtbl = &layout_vtbl;
+    l->len = len;
+    l->font_size = ((text_format_t*) format)->font_size;
+    l->max_width = max_width;
+    l->max_height = max_height;
+
+    *p_layout = &l->iface;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+factory_CreateEllipsisTrimmingSign(dummy_IDWriteFactory* self,
+            dummy_IDWriteTextFormat* format, dummy_IDWriteInlineObject** p_sign)
+{
+    STANDIN_RECORD();
+    *p_sign = &ellipsis;
+    return S_OK;
+}
+
+static dummy_IDWriteFactoryVtbl factory_vtbl = {
+    UNKNOWN_METHODS(dummy_IDWriteFactory, unknown_Release),
+    .CreateTextFormat = factory_CreateTextFormat,
+    .GetGdiInterop = factory_GetGdiInterop,
+    .CreateTextLayout = factory_CreateTextLayout,
+    .CreateEllipsisTrimmingSign = factory_CreateEllipsisTrimmingSign
+};
+static dummy_IDWriteFactory factory = STANDIN_OBJECT(dummy_IDWriteFactory, factory_vtbl);
+
+static HRESULT WINAPI
+DWriteCreateFactory(int type, REFIID riid, void** p_factory)
+{
+    STANDIN_RECORD();
+    *p_factory = &factory;
+    return S_OK;
+}
+
+
+void*
+standin_dwrite_proc(const char* name)
+{
+    if(strcmp(name, "DWriteCreateFactory") == 0)
+        return (void*) DWriteCreateFactory;
+    return NULL;
+}
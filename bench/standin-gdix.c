@@ -0,0 +1,481 @@
+/*
+ * Recording stand-in for GDIPLUS.DLL.
+ *
+ * Provides every Gdip* entry point gdix_init() resolves. Object handles are
+ * all the same dummy object except bitmaps, which own real pixel memory so
+ * that the pixel conversion code in wdCreateImageFromBuffer() does real work.
+ */
+
+#include "standin.h"
+#include "backend-gdix.h"
+
+
+UINT64 standin_calls = 0;
+
+static BYTE gp_object[64];
+
+
+typedef struct gp_bitmap_tag gp_bitmap_t;
+struct gp_bitmap_tag {
+    UINT width;
+    UINT height;
+    INT stride;
+    dummy_GpPixelFormat format;
+    BYTE* bits;
+};
+
+static int
+gp_alloc_bitmap(UINT width, UINT height, dummy_GpPixelFormat format,
+                dummy_GpBitmap** p_bitmap)
+{
+    gp_bitmap_t* b;
+    UINT bpp = (format == dummy_PixelFormat24bppRGB ? 3 : 4);
+
+    b = (gp_bitmap_t*) malloc(sizeof(gp_bitmap_t));
+    if(b == NULL)
+        return 3;   /* OutOfMemory */
+
+    b->width = width;
+    b->height = height;
+    b->stride = ((width * bpp) + 3) & ~3;
+    b->format = format;
+    b->bits = (BYTE*) malloc((size_t) b->stride * height);
+    if(b->bits == NULL) {
+        free(b);
+        return 3;
+    }
+
+    *p_bitmap = (dummy_GpBitmap*) b;
+    return 0;
+}
+
+
+/* Most of the API is just recorded and otherwise ignored. */
+#define GP_STUB(name, params)                                                  \
+    static int WINAPI                                                          \
+    gp_##name params                                                           \
+    {                                                                          \
+        STANDIN_RECORD();                                                      \
+        return 0;                                                              \
+    }
+
+/* Constructors hand out the dummy object. */
+#define GP_CREATE(name, params, out)                                           \
+    static int WINAPI                                                          \
+    gp_##name params                                                           \
+    {                                                                          \
+        STANDIN_RECORD();                                                      \
+        *(out) = (void*) gp_object;                                            \
+        return 0;                                                              \
+    }
+
+
+static int WINAPI
+gp_Startup(ULONG_PTR* token, const dummy_GpStartupInput* input, void* output)
+{
+    STANDIN_RECORD();
+    *token = (ULONG_PTR) gp_object;
+    return 0;
+}
+
+static void WINAPI
+gp_Shutdown(ULONG_PTR token)
+{
+    STANDIN_RECORD();
+}
+
+/* Graphics functions */
+GP_CREATE(CreateFromHDC, (HDC dc, dummy_GpGraphics** g), g)
+GP_STUB(DeleteGraphics, (dummy_GpGraphics* g))
+GP_STUB(GraphicsClear, (dummy_GpGraphics* g, dummy_ARGB color))
+GP_CREATE(GetDC, (dummy_GpGraphics* g, HDC* dc), dc)
+GP_STUB(ReleaseDC, (dummy_GpGraphics* g, HDC dc))
+GP_STUB(ResetClip, (dummy_GpGraphics* g))
+GP_STUB(SaveGraphics, (dummy_GpGraphics* g, dummy_GpGraphicsState* state))
+GP_STUB(RestoreGraphics, (dummy_GpGraphics* g, dummy_GpGraphicsState state))
+GP_STUB(ResetWorldTransform, (dummy_GpGraphics* g))
+GP_STUB(RotateWorldTransform, (dummy_GpGraphics* g, float angle, dummy_GpMatrixOrder order))
+GP_STUB(ScaleWorldTransform, (dummy_GpGraphics* g, float sx, float sy, dummy_GpMatrixOrder order))
+GP_STUB(SetClipPath, (dummy_GpGraphics* g, dummy_GpPath* path, dummy_GpCombineMode mode))
+GP_STUB(SetClipRect, (dummy_GpGraphics* g, float x, float y, float w, float h, dummy_GpCombineMode mode))
+GP_STUB(SetPageUnit, (dummy_GpGraphics* g, dummy_GpUnit unit))
+GP_STUB(SetPixelOffsetMode, (dummy_GpGraphics* g, dummy_GpPixelOffsetMode mode))
+GP_STUB(SetSmoothingMode, (dummy_GpGraphics* g, dummy_GpSmoothingMode mode))
+GP_STUB(TranslateWorldTransform, (dummy_GpGraphics* g, float dx, float dy, dummy_GpMatrixOrder order))
+GP_STUB(MultiplyWorldTransform, (dummy_GpGraphics* g, dummy_GpMatrix* m, dummy_GpMatrixOrder order))
+GP_STUB(SetWorldTransform, (dummy_GpGraphics* g, dummy_GpMatrix* m))
+GP_CREATE(CreateMatrix2, (float m11, float m12, float m21, float m22, float dx, float dy, dummy_GpMatrix** m), m)
+GP_STUB(DeleteMatrix, (dummy_GpMatrix* m))
+GP_STUB(SetMatrixElements, (dummy_GpMatrix* m, float m11, float m12, float m21, float m22, float dx, float dy))
+
+/* Brush functions */
+GP_CREATE(CreateSolidFill, (dummy_ARGB color, dummy_GpSolidFill** brush), brush)
+GP_STUB(DeleteBrush, (dummy_GpBrush* brush))
+GP_STUB(SetSolidFillColor, (dummy_GpSolidFill* brush, dummy_ARGB color))
+GP_CREATE(CreateLineBrush, (const dummy_GpPointF* p0, const dummy_GpPointF* p1, dummy_ARGB c0, dummy_ARGB c1, dummy_GpWrapMode mode, dummy_GpLineGradient** brush), brush)
+GP_CREATE(CreatePathGradientFromPath, (const dummy_GpPath* path, dummy_GpPathGradient** brush), brush)
+GP_STUB(SetLinePresetBlend, (dummy_GpLineGradient* brush, const dummy_ARGB* colors, const float* offsets, INT count))
+GP_STUB(SetPathGradientPresetBlend, (dummy_GpPathGradient* brush, const dummy_ARGB* colors, const float* offsets, INT count))
+GP_STUB(SetPathGradientCenterPoint, (dummy_GpPathGradient* brush, const dummy_GpPointF* pt))
+
+/* Pen functions */
+GP_CREATE(CreatePen1, (DWORD color, float width, dummy_GpUnit unit, dummy_GpPen** pen), pen)
+GP_STUB(DeletePen, (dummy_GpPen* pen))
+GP_STUB(SetPenBrushFill, (dummy_GpPen* pen, dummy_GpBrush* brush))
+GP_STUB(SetPenWidth, (dummy_GpPen* pen, float width))
+GP_STUB(SetPenStartCap, (dummy_GpPen* pen, dummy_GpLineCap cap))
+GP_STUB(SetPenEndCap, (dummy_GpPen* pen, dummy_GpLineCap cap))
+GP_STUB(SetPenLineJoin, (dummy_GpPen* pen, dummy_GpLineJoin join))
+GP_STUB(SetPenMiterLimit, (dummy_GpPen* pen, float limit))
+GP_STUB(SetPenDashStyle, (dummy_GpPen* pen, dummy_GpDashStyle style))
+GP_STUB(SetPenDashArray, (dummy_GpPen* pen, const float* dashes, INT count))
+
+/* Path functions */
+GP_CREATE(CreatePath, (dummy_GpFillMode mode, dummy_GpPath** path), path)
+GP_STUB(DeletePath, (dummy_GpPath* path))
+GP_STUB(ClosePathFigure, (dummy_GpPath* path))
+GP_STUB(StartPathFigure, (dummy_GpPath* path))
+GP_STUB(AddPathArc, (dummy_GpPath* path, float x, float y, float w, float h, float start, float sweep))
+GP_STUB(AddPathLine, (dummy_GpPath* path, float x0, float y0, float x1, float y1))
+GP_STUB(AddPathBezier, (dummy_GpPath* path, float x0, float y0, float x1, float y1, float x2, float y2, float x3, float y3))
+GP_STUB(AddPathLine2, (dummy_GpPath* path, const dummy_GpPointF* points, INT count))
+GP_STUB(AddPathBeziers, (dummy_GpPath* path, const dummy_GpPointF* points, INT count))
+
+static int WINAPI
+gp_GetPathLastPoint(dummy_GpPath* path, dummy_GpPointF* pt)
+{
+    STANDIN_RECORD();
+    pt->x = 0.0f;
+    pt->y = 0.0f;
+    return 0;
+}
+
+/* Font functions. The metrics are those of a typical sans-serif font. */
+GP_CREATE(CreateFontFromLogfontW, (HDC dc, const LOGFONTW* lf, dummy_GpFont** font), font)
+GP_STUB(DeleteFont, (dummy_GpFont* font))
+GP_STUB(DeleteFontFamily, (dummy_GpFont* family))
+GP_CREATE(GetFamily, (dummy_GpFont* font, void** family), family)
+
+static int WINAPI
+gp_GetCellAscent(const dummy_GpFont* family, int style, UINT16* ascent)
+{
+    STANDIN_RECORD();
+    *ascent = 1854;
+    return 0;
+}
+
+static int WINAPI
+gp_GetCellDescent(const dummy_GpFont* family, int style, UINT16* descent)
+{
+    STANDIN_RECORD();
+    *descent = 434;
+    return 0;
+}
+
+static int WINAPI
+gp_GetEmHeight(const dummy_GpFont* family, int style, UINT16* height)
+{
+    STANDIN_RECORD();
+    *height = 2048;
+    return 0;
+}
+
+static int WINAPI
+gp_GetLineSpacing(const dummy_GpFont* family, int style, UINT16* spacing)
+{
+    STANDIN_RECORD();
+    *spacing = 2355;
+    return 0;
+}
+
+static int WINAPI
+gp_GetFontSize(dummy_GpFont* font, float* size)
+{
+    STANDIN_RECORD();
+    *size = 12.0f;
+    return 0;
+}
+
+static int WINAPI
+gp_GetFontStyle(dummy_GpFont* font, int* style)
+{
+    STANDIN_RECORD();
+    *style = 0;
+    return 0;
+}
+
+/* Image & bitmap functions */
+static int WINAPI
+gp_LoadImageFromFile(const WCHAR* path, dummy_GpImage** image)
+{
+    STANDIN_RECORD();
+    return 10;  /* FileNotFound */
+}
+
+static int WINAPI
+gp_LoadImageFromStream(IStream* stream, dummy_GpImage** image)
+{
+    STANDIN_RECORD();
+    return 2;   /* InvalidParameter */
+}
+
+static int WINAPI
+gp_CreateBitmapFromHBITMAP(HBITMAP bmp, HPALETTE palette, dummy_GpBitmap** bitmap)
+{
+    STANDIN_RECORD();
+    return gp_alloc_bitmap(1, 1, dummy_PixelFormat32bppARGB, bitmap);
+}
+
+static int WINAPI
+gp_CreateBitmapFromHICON(HICON icon, dummy_GpBitmap** bitmap)
+{
+    STANDIN_RECORD();
+    return gp_alloc_bitmap(1, 1, dummy_PixelFormat32bppARGB, bitmap);
+}
+
+static int WINAPI
+gp_CreateBitmapFromGdiDib(const BITMAPINFO* info, void* bits, dummy_GpBitmap** bitmap)
+{
+    STANDIN_RECORD();
+    return gp_alloc_bitmap(info->bmiHeader.biWidth, abs(info->bmiHeader.biHeight),
+                           dummy_PixelFormat32bppARGB, bitmap);
+}
+
+static int WINAPI
+gp_CreateBitmapFromScan0(UINT width, UINT height, INT stride,
+                         dummy_GpPixelFormat format, BYTE* scan0,
+                         dummy_GpBitmap** bitmap)
+{
+    STANDIN_RECORD();
+    return gp_alloc_bitmap(width, height, format, bitmap);
+}
+
+static int WINAPI
+gp_DisposeImage(dummy_GpImage* image)
+{
+    gp_bitmap_t* b = (gp_bitmap_t*) image;
+
+    STANDIN_RECORD();
+    free(b->bits);
+    free(b);
+    return 0;
+}
+
+static int WINAPI
+gp_GetImageWidth(dummy_GpImage* image, UINT* width)
+{
+    STANDIN_RECORD();
+    *width = ((gp_bitmap_t*) image)->width;
+    return 0;
+}
+
+static int WINAPI
+gp_GetImageHeight(dummy_GpImage* image, UINT* height)
+{
+    STANDIN_RECORD();
+    *height = ((gp_bitmap_t*) image)->height;
+    return 0;
+}
+
+static int WINAPI
+gp_BitmapLockBits(dummy_GpBitmap* bitmap, const dummy_GpRectI* rect, UINT mode,
+                  dummy_GpPixelFormat format, dummy_GpBitmapData* data)
+{
+    gp_bitmap_t* b = (gp_bitmap_t*) bitmap;
+
+    STANDIN_RECORD();
+    data->width = b->width;
+    data->height = b->height;
+    data->Stride = b->stride;
+    data->PixelFormat = b->format;
+    data->Scan0 = b->bits;
+    data->Reserved = 0;
+    return 0;
+}
+
+GP_STUB(BitmapUnlockBits, (dummy_GpBitmap* bitmap, dummy_GpBitmapData* data))
+
+/* Cached bitmap functions */
+GP_CREATE(CreateCachedBitmap, (dummy_GpBitmap* bitmap, dummy_GpGraphics* g, dummy_GpCachedBitmap** cached), cached)
+GP_STUB(DeleteCachedBitmap, (dummy_GpCachedBitmap* cached))
+GP_STUB(DrawCachedBitmap, (dummy_GpGraphics* g, dummy_GpCachedBitmap* cached, INT x, INT y))
+
+/* String format functions */
+GP_CREATE(CreateStringFormat, (int flags, LANGID lang, dummy_GpStringFormat** format), format)
+GP_STUB(DeleteStringFormat, (dummy_GpStringFormat* format))
+GP_STUB(SetStringFormatAlign, (dummy_GpStringFormat* format, dummy_GpStringAlignment align))
+GP_STUB(SetStringFormatLineAlign, (dummy_GpStringFormat* format, dummy_GpStringAlignment align))
+GP_STUB(SetStringFormatFlags, (dummy_GpStringFormat* format, int flags))
+GP_STUB(SetStringFormatTrimming, (dummy_GpStringFormat* format, dummy_GpStringTrimming trimming))
+
+/* Draw/fill functions */
+GP_STUB(DrawArc, (dummy_GpGraphics* g, dummy_GpPen* pen, float x, float y, float w, float h, float start, float sweep))
+GP_STUB(DrawImageRectRect, (dummy_GpGraphics* g, dummy_GpImage* image, float dx, float dy, float dw, float dh, float sx, float sy, float sw, float sh, dummy_GpUnit unit, const void* attrs, void* callback, void* data))
+GP_STUB(DrawEllipse, (dummy_GpGraphics* g, dummy_GpPen* pen, float x, float y, float w, float h))
+GP_STUB(DrawLine, (dummy_GpGraphics* g, dummy_GpPen* pen, float x0, float y0, float x1, float y1))
+GP_STUB(DrawLines, (dummy_GpGraphics* g, dummy_GpPen* pen, const dummy_GpPointF* points, INT count))
+GP_STUB(DrawPath, (dummy_GpGraphics* g, dummy_GpPen* pen, dummy_GpPath* path))
+GP_STUB(DrawPie, (dummy_GpGraphics* g, dummy_GpPen* pen, float x, float y, float w, float h, float start, float sweep))
+GP_STUB(DrawRectangle, (dummy_GpGraphics* g, void* pen, float x, float y, float w, float h))
+GP_STUB(DrawRectangles, (dummy_GpGraphics* g, void* pen, const dummy_GpRectF* rects, INT count))
+GP_STUB(DrawString, (dummy_GpGraphics* g, const WCHAR* str, int len, const dummy_GpFont* font, const dummy_GpRectF* rect, const dummy_GpStringFormat* format, const dummy_GpBrush* brush))
+GP_STUB(FillEllipse, (dummy_GpGraphics* g, dummy_GpBrush* brush, float x, float y, float w, float h))
+GP_STUB(FillPath, (dummy_GpGraphics* g, dummy_GpBrush* brush, dummy_GpPath* path))
+GP_STUB(FillPie, (dummy_GpGraphics* g, dummy_GpBrush* brush, float x, float y, float w, float h, float start, float sweep))
+GP_STUB(FillRectangle, (dummy_GpGraphics* g, void* brush, float x, float y, float w, float h))
+GP_STUB(FillRectangles, (dummy_GpGraphics* g, void* brush, const dummy_GpRectF* rects, INT count))
+
+static int WINAPI
+gp_MeasureString(dummy_GpGraphics* g, const WCHAR* str, int len,
+                 const dummy_GpFont* font, const dummy_GpRectF* rect,
+                 const dummy_GpStringFormat* format, dummy_GpRectF* bounds,
+                 int* codepoints_fitted, int* lines_filled)
+{
+    STANDIN_RECORD();
+    if(len < 0)
+        len = (int) wcslen(str);
+    bounds->x = rect->x;
+    bounds->y = rect->y;
+    bounds->w = 7.0f * (float) len;
+    bounds->h = 16.0f;
+    if(codepoints_fitted != NULL)
+        *codepoints_fitted = len;
+    if(lines_filled != NULL)
+        *lines_filled = 1;
+    return 0;
+}
+
+#undef GP_STUB
+#undef GP_CREATE
+
+
+#define GP_PROC(name)       { "Gdip"#name, (void*) gp_##name }
+
+static const struct {
+    const char* name;
+    void* proc;
+} gp_procs[] = {
+    { "GdiplusStartup", (void*) gp_Startup },
+    { "GdiplusShutdown", (void*) gp_Shutdown },
+
+    GP_PROC(CreateFromHDC),
+    GP_PROC(DeleteGraphics),
+    GP_PROC(GraphicsClear),
+    GP_PROC(GetDC),
+    GP_PROC(ReleaseDC),
+    GP_PROC(ResetClip),
+    GP_PROC(SaveGraphics),
+    GP_PROC(RestoreGraphics),
+    GP_PROC(ResetWorldTransform),
+    GP_PROC(RotateWorldTransform),
+    GP_PROC(ScaleWorldTransform),
+    GP_PROC(SetClipPath),
+    GP_PROC(SetClipRect),
+    GP_PROC(SetPageUnit),
+    GP_PROC(SetPixelOffsetMode),
+    GP_PROC(SetSmoothingMode),
+    GP_PROC(TranslateWorldTransform),
+    GP_PROC(MultiplyWorldTransform),
+    GP_PROC(SetWorldTransform),
+    GP_PROC(CreateMatrix2),
+    GP_PROC(DeleteMatrix),
+    GP_PROC(SetMatrixElements),
+
+    GP_PROC(CreateSolidFill),
+    GP_PROC(DeleteBrush),
+    GP_PROC(SetSolidFillColor),
+    GP_PROC(CreateLineBrush),
+    GP_PROC(CreatePathGradientFromPath),
+    GP_PROC(SetLinePresetBlend),
+    GP_PROC(SetPathGradientPresetBlend),
+    GP_PROC(SetPathGradientCenterPoint),
+
+    GP_PROC(CreatePen1),
+    GP_PROC(DeletePen),
+    GP_PROC(SetPenBrushFill),
+    GP_PROC(SetPenWidth),
+    GP_PROC(SetPenStartCap),
+    GP_PROC(SetPenEndCap),
+    GP_PROC(SetPenLineJoin),
+    GP_PROC(SetPenMiterLimit),
+    GP_PROC(SetPenDashStyle),
+    GP_PROC(SetPenDashArray),
+
+    GP_PROC(CreatePath),
+    GP_PROC(DeletePath),
+    GP_PROC(ClosePathFigure),
+    GP_PROC(StartPathFigure),
+    GP_PROC(GetPathLastPoint),
+    GP_PROC(AddPathArc),
+    GP_PROC(AddPathLine),
+    GP_PROC(AddPathBezier),
+    GP_PROC(AddPathLine2),
+    GP_PROC(AddPathBeziers),
+
+    GP_PROC(CreateFontFromLogfontW),
+    GP_PROC(DeleteFont),
+    GP_PROC(DeleteFontFamily),
+    GP_PROC(GetCellAscent),
+    GP_PROC(GetCellDescent),
+    GP_PROC(GetEmHeight),
+    GP_PROC(GetFamily),
+    GP_PROC(GetFontSize),
+    GP_PROC(GetFontStyle),
+    GP_PROC(GetLineSpacing),
+
+    GP_PROC(LoadImageFromFile),
+    GP_PROC(LoadImageFromStream),
+    GP_PROC(CreateBitmapFromHBITMAP),
+    GP_PROC(CreateBitmapFromHICON),
+    GP_PROC(DisposeImage),
+    GP_PROC(GetImageWidth),
+    GP_PROC(GetImageHeight),
+    GP_PROC(CreateBitmapFromScan0),
+    GP_PROC(BitmapLockBits),
+    GP_PROC(BitmapUnlockBits),
+    GP_PROC(CreateBitmapFromGdiDib),
+
+    GP_PROC(CreateCachedBitmap),
+    GP_PROC(DeleteCachedBitmap),
+    GP_PROC(DrawCachedBitmap),
+
+    GP_PROC(CreateStringFormat),
+    GP_PROC(DeleteStringFormat),
+    GP_PROC(SetStringFormatAlign),
+    GP_PROC(SetStringFormatLineAlign),
+    GP_PROC(SetStringFormatFlags),
+    GP_PROC(SetStringFormatTrimming),
+
+    GP_PROC(DrawArc),
+    GP_PROC(DrawImageRectRect),
+    GP_PROC(DrawEllipse),
+    GP_PROC(DrawLine),
+    GP_PROC(DrawLines),
+    GP_PROC(DrawPath),
+    GP_PROC(DrawPie),
+    GP_PROC(DrawRectangle),
+    GP_PROC(DrawRectangles),
+    GP_PROC(DrawString),
+    GP_PROC(FillEllipse),
+    GP_PROC(FillPath),
+    GP_PROC(FillPie),
+    GP_PROC(FillRectangle),
+    GP_PROC(FillRectangles),
+    GP_PROC(MeasureString)
+};
+
+#undef GP_PROC
+
+
+void*
+standin_gdix_proc(const char* name)
+{
+    int i;
+
+    for(i = 0; i < (int) WD_SIZEOF_ARRAY(gp_procs); i++) {
+        if(strcmp(gp_procs[i].name, name) == 0)
+            return gp_procs[i].proc;
+    }
+
+    return NULL;
+}
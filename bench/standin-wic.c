@@ -0,0 +1,374 @@
+/*
+ * Recording stand-in for the WIC imaging factory.
+ *
+ * Bitmaps own real pixel memory, so that wdCreateImageFromBuffer() converts
+ * into a real buffer. Format converters only remember the size and the
+ * target format; nothing ever reads their pixels here. Decoding from files
+ * or streams is not supported.
+ */
+
+#include "standin.h"
+
+
+typedef struct wic_bitmap_tag wic_bitmap_t;
+struct wic_bitmap_tag {
+    void* vtbl;             /* IWICBitmapVtbl or IWICFormatConverterVtbl */
+    IWICBitmapLock lock;
+    LONG refs;
+    UINT width;
+    UINT height;
+    UINT stride;
+    GUID format;
+    BYTE* bits;
+};
+
+#define WIC_BITMAP_FROM_LOCK(l)     \
+        ((wic_bitmap_t*) ((BYTE*) (l) - offsetof(wic_bitmap_t, lock)))
+
+/* GUID_WICPixelFormat32bppBGRA, i.e. what GDI objects give us. */
+static const GUID wic_format_bgra =
+        {0x6fddc324,0x4e03,0x4bfe,{0xb1,0x85,0x3d,0x77,0x76,0x8d,0xc9,0x0f}};
+
+static IWICBitmapVtbl wic_bitmap_vtbl;
+static IWICFormatConverterVtbl wic_converter_vtbl;
+static IWICBitmapLockVtbl wic_lock_vtbl;
+
+
+static wic_bitmap_t*
+wic_bitmap_alloc(void* vtbl, UINT width, UINT height, REFGUID format, BOOL with_bits)
+{
+    wic_bitmap_t* b;
+
+    b = (wic_bitmap_t*) malloc(sizeof(wic_bitmap_t));
+    if(b == NULL)
+        return NULL;
+
+    b->vtbl = vtbl;
+    b->lock.lpVtbl = &wic_lock_vtbl;
+    b->refs = 1;
+    b->width = width;
+    b->height = height;
+    b->stride = width * 4;
+    b->format = *format;
+    b->bits = NULL;
+    if(with_bits) {
+        b->bits = (BYTE*) malloc((size_t) b->stride * height);
+        if(b->bits == NULL) {
+            free(b);
+            return NULL;
+        }
+    }
+
+    return b;
+}
+
+
+/**********************************************
+ ***  IWICBitmap, IWICFormatConverter etc.  ***
+ **********************************************/
+
+static HRESULT STDMETHODCALLTYPE
+bitmap_QueryInterface(IWICBitmap* self, REFIID riid, void** obj)
+{
+    STANDIN_RECORD();
+    *obj = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG STDMETHODCALLTYPE
+bitmap_AddRef(IWICBitmap* self)
+{
+    wic_bitmap_t* b = (wic_bitmap_t*) self;
+
+    STANDIN_RECORD();
+    return ++b->refs;
+}
+
+static ULONG STDMETHODCALLTYPE
+bitmap_Release(IWICBitmap* self)
+{
+    wic_bitmap_t* b = (wic_bitmap_t*) self;
+    ULONG refs;
+
+    STANDIN_RECORD();
+    refs = --b->refs;
+    if(refs == 0) {
+        free(b->bits);
+        free(b);
+    }
+    return refs;
+}
+
+static HRESULT STDMETHODCALLTYPE
+bitmap_GetSize(IWICBitmap* self, UINT* width, UINT* height)
+{
+    STANDIN_RECORD();
+    standin_wic_get_size((IWICBitmapSource*) self, width, height);
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+bitmap_GetPixelFormat(IWICBitmap* self, WICPixelFormatGUID* format)
+{
+    STANDIN_RECORD();
+    *format = ((wic_bitmap_t*) self)->format;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+bitmap_CopyPixels(IWICBitmap* self, const WICRect* rect, UINT stride,
+                  UINT size, BYTE* buffer)
+{
+    STANDIN_RECORD();
+    return E_NOTIMPL;
+}
+
+static HRESULT STDMETHODCALLTYPE
+bitmap_Lock(IWICBitmap* self, const WICRect* rect, DWORD flags,
+            IWICBitmapLock** p_lock)
+{
+    STANDIN_RECORD();
+    *p_lock = &((wic_bitmap_t*) self)->lock;
+    return S_OK;
+}
+
+#define BITMAP_SOURCE_METHODS(iface)                                           \
+    .QueryInterface = (HRESULT (STDMETHODCALLTYPE*)(iface*, REFIID, void**))   \
+                                bitmap_QueryInterface,                         \
+    .AddRef = (ULONG (STDMETHODCALLTYPE*)(iface*)) bitmap_AddRef,              \
+    .Release = (ULONG (STDMETHODCALLTYPE*)(iface*)) bitmap_Release,            \
+    .GetSize = (HRESULT (STDMETHODCALLTYPE*)(iface*, UINT*, UINT*))            \
+                                bitmap_GetSize,                                \
+    .GetPixelFormat = (HRESULT (STDMETHODCALLTYPE*)(iface*, WICPixelFormatGUID*)) \
+                                bitmap_GetPixelFormat,                         \
+    .CopyPixels = (HRESULT (STDMETHODCALLTYPE*)(iface*, const WICRect*, UINT, UINT, BYTE*)) \
+                                bitmap_CopyPixels
+
+static IWICBitmapVtbl wic_bitmap_vtbl = {
+    BITMAP_SOURCE_METHODS(IWICBitmap),
+    .Lock = bitmap_Lock
+};
+
+static HRESULT STDMETHODCALLTYPE
+converter_Initialize(IWICFormatConverter* self, IWICBitmapSource* source,
+                     REFGUID format, WICBitmapDitherType dither,
+                     IWICPalette* palette, double alpha_threshold,
+                     WICBitmapPaletteType palette_type)
+{
+    wic_bitmap_t* c = (wic_bitmap_t*) self;
+    wic_bitmap_t* s = (wic_bitmap_t*) source;
+
+    STANDIN_RECORD();
+    c->width = s->width;
+    c->height = s->height;
+    c->stride = s->width * 4;
+    c->format = *format;
+    return S_OK;
+}
+
+static IWICFormatConverterVtbl wic_converter_vtbl = {
+    BITMAP_SOURCE_METHODS(IWICFormatConverter),
+    .Initialize = converter_Initialize
+};
+
+#undef BITMAP_SOURCE_METHODS
+
+
+/************************
+ ***  IWICBitmapLock  ***
+ ************************/
+
+static HRESULT STDMETHODCALLTYPE
+lock_QueryInterface(IWICBitmapLock* self, REFIID riid, void** obj)
+{
+    STANDIN_RECORD();
+    *obj = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG STDMETHODCALLTYPE
+lock_AddRef(IWICBitmapLock* self)
+{
+    STANDIN_RECORD();
+    return 1;
+}
+
+static ULONG STDMETHODCALLTYPE
+lock_Release(IWICBitmapLock* self)
+{
+    STANDIN_RECORD();
+    return 0;
+}
+
+static HRESULT STDMETHODCALLTYPE
+lock_GetSize(IWICBitmapLock* self, UINT* width, UINT* height)
+{
+    wic_bitmap_t* b = WIC_BITMAP_FROM_LOCK(self);
+
+    STANDIN_RECORD();
+    *width = b->width;
+    *height = b->height;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+lock_GetStride(IWICBitmapLock* self, UINT* stride)
+{
+    STANDIN_RECORD();
+    *stride = WIC_BITMAP_FROM_LOCK(self)->stride;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+lock_GetDataPointer(IWICBitmapLock* self, UINT* size, BYTE** data)
+{
+    wic_bitmap_t* b = WIC_BITMAP_FROM_LOCK(self);
+
+    STANDIN_RECORD();
+    *size = b->stride * b->height;
+    *data = b->bits;
+    return S_OK;
+}
+
+static IWICBitmapLockVtbl wic_lock_vtbl = {
+    .QueryInterface = lock_QueryInterface,
+    .AddRef = lock_AddRef,
+    .Release = lock_Release,
+    .GetSize = lock_GetSize,
+    .GetStride = lock_GetStride,
+    .GetDataPointer = lock_GetDataPointer
+};
+
+
+/****************************
+ ***  IWICImagingFactory  ***
+ ****************************/
+
+static HRESULT STDMETHODCALLTYPE
+factory_QueryInterface(IWICImagingFactory* self, REFIID riid, void** obj)
+{
+    STANDIN_RECORD();
+    *obj = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG STDMETHODCALLTYPE
+factory_AddRef(IWICImagingFactory* self)
+{
+    STANDIN_RECORD();
+    return 1;
+}
+
+static ULONG STDMETHODCALLTYPE
+factory_Release(IWICImagingFactory* self)
+{
+    STANDIN_RECORD();
+    return 0;
+}
+
+static HRESULT STDMETHODCALLTYPE
+factory_CreateDecoderFromFilename(IWICImagingFactory* self, const WCHAR* path,
+            const GUID* vendor, DWORD access, WICDecodeOptions options,
+            IWICBitmapDecoder** p_decoder)
+{
+    STANDIN_RECORD();
+    *p_decoder = NULL;
+    return HRESULT_FROM_WIN32(2);   /* ERROR_FILE_NOT_FOUND */
+}
+
+static HRESULT STDMETHODCALLTYPE
+factory_CreateDecoderFromStream(IWICImagingFactory* self, IStream* stream,
+            const GUID* vendor, WICDecodeOptions options,
+            IWICBitmapDecoder** p_decoder)
+{
+    STANDIN_RECORD();
+    *p_decoder = NULL;
+    return E_NOTIMPL;
+}
+
+static HRESULT STDMETHODCALLTYPE
+factory_CreateFormatConverter(IWICImagingFactory* self,
+            IWICFormatConverter** p_converter)
+{
+    wic_bitmap_t* c;
+
+    STANDIN_RECORD();
+    c = wic_bitmap_alloc(&wic_converter_vtbl, 0, 0, &wic_format_bgra, FALSE);
+    if(c == NULL)
+        return E_OUTOFMEMORY;
+
+    *p_converter = (IWICFormatConverter*) c;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+factory_CreateBitmap(IWICImagingFactory* self, UINT width, UINT height,
+            REFGUID format, WICBitmapCreateCacheOption option,
+            IWICBitmap** p_bitmap)
+{
+    wic_bitmap_t* b;
+
+    STANDIN_RECORD();
+    b = wic_bitmap_alloc(&wic_bitmap_vtbl, width, height, format, TRUE);
+    if(b == NULL)
+        return E_OUTOFMEMORY;
+
+    *p_bitmap = (IWICBitmap*) b;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+factory_CreateBitmapFromHBITMAP(IWICImagingFactory* self, HBITMAP bmp,
+            HPALETTE palette, WICBitmapAlphaChannelOption option,
+            IWICBitmap** p_bitmap)
+{
+    wic_bitmap_t* b;
+
+    STANDIN_RECORD();
+    b = wic_bitmap_alloc(&wic_bitmap_vtbl, 1, 1, &wic_format_bgra, TRUE);
+    if(b == NULL)
+        return E_OUTOFMEMORY;
+
+    *p_bitmap = (IWICBitmap*) b;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE
+factory_CreateBitmapFromHICON(IWICImagingFactory* self, HICON icon,
+            IWICBitmap** p_bitmap)
+{
+    return factory_CreateBitmapFromHBITMAP(self, NULL, NULL,
+                WICBitmapUseAlpha, p_bitmap);
+}
+
+static IWICImagingFactoryVtbl wic_factory_vtbl = {
+    .QueryInterface = factory_QueryInterface,
+    .AddRef = factory_AddRef,
+    .Release = factory_Release,
+    .CreateDecoderFromFilename = factory_CreateDecoderFromFilename,
+    .CreateDecoderFromStream = factory_CreateDecoderFromStream,
+    .CreateFormatConverter = factory_CreateFormatConverter,
+    .CreateBitmap = factory_CreateBitmap,
+    .CreateBitmapFromHBITMAP = factory_CreateBitmapFromHBITMAP,
+    .CreateBitmapFromHICON = factory_CreateBitmapFromHICON
+};
+
+static IWICImagingFactory wic_factory_object = { &wic_factory_vtbl };
+
+
+HRESULT
+standin_wic_create_factory(void** obj)
+{
+    STANDIN_RECORD();
+    *obj = &wic_factory_object;
+    return S_OK;
+}
+
+void
+standin_wic_get_size(IWICBitmapSource* source, UINT* width, UINT* height)
+{
+    wic_bitmap_t* b = (wic_bitmap_t*) source;
+
+    *width = b->width;
+    *height = b->height;
+}
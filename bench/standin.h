@@ -0,0 +1,37 @@
+/*
+ * Recording stand-ins for the back-end libraries (D2D1.DLL, DWRITE.DLL,
+ * GDIPLUS.DLL and the WIC imaging factory).
+ *
+ * They let the whole library run headless, without any real rendering, so
+ * the benchmarks measure just WinDrawLib's own overhead. Every stand-in
+ * method records itself by bumping standin_calls; the benchmarks report it
+ * per operation, so a change in the number of back-end round-trips shows up
+ * right next to the timing change it causes.
+ *
+ * The stand-ins are implemented against the interface declarations in
+ * src/dummy/ and the gdix_vtable_t layout; compat/win32.c hands them out
+ * from GetProcAddress() and CoCreateInstance().
+ */
+
+#ifndef WDBENCH_STANDIN_H
+#define WDBENCH_STANDIN_H
+
+#include <windows.h>
+#include <wincodec.h>
+
+
+extern UINT64 standin_calls;
+
+#define STANDIN_RECORD()    (standin_calls++)
+
+
+void* standin_d2d_proc(const char* name);
+void* standin_dwrite_proc(const char* name);
+void* standin_gdix_proc(const char* name);
+HRESULT standin_wic_create_factory(void** obj);
+
+/* Size of a stand-in WIC bitmap, without recording it as a call. */
+void standin_wic_get_size(IWICBitmapSource* source, UINT* width, UINT* height);
+
+
+#endif  /* WDBENCH_STANDIN_H */
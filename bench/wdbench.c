@@ -0,0 +1,823 @@
+/*
+ * Headless micro-benchmarks of WinDrawLib.
+ *
+ * Each benchmark runs against both back-ends (D2D and GDI+). On Windows the
+ * real system libraries are used; elsewhere the library is linked with the
+ * recording stand-ins (see standin.h), so only WinDrawLib's own overhead is
+ * measured and the number of back-end calls per operation is reported too.
+ * Then each benchmark runs against the software back-end (see backend-sw.h),
+ * which really rasterizes on all platforms, and finally against the null
+ * custom back-end (see nullbackend.h), which shows the library overhead on
+ * Windows as well.
+ *
+ * Library built for a single back-end (see WINDRAWLIB_BACKEND) is measured
+ * with that back-end only.
+ *
+ * Usage: wdbench [FILTER] [SAMPLES]
+ *
+ * FILTER is a substring of the benchmark names to run (default: all).
+ *
+ * The output is one JSON object per line and back-end:
+ *   {"name":..., "backend":..., "build":..., "samples":..., "batch":...,
+ *    "min_ns":..., "p50_ns":..., "p90_ns":..., "p99_ns":..., "max_ns":...,
+ *    "backend_calls_per_op":...}
+ * All times are nanoseconds per operation. build is the WINDRAWLIB_BACKEND
+ * the library has been built with. backend_calls_per_op is -1 when the
+ * stand-ins are not linked in.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+
+#include <wdl.h>
+
+#include "nullbackend.h"
+
+#if defined WD_D2D_ONLY
+    #define BUILD       "d2d"
+#elif defined WD_GDIPLUS_ONLY
+    #define BUILD       "gdiplus"
+#else
+    #define BUILD       "both"
+#endif
+
+#ifdef WDBENCH_STANDIN
+    #include "standin.h"
+    #define CALLS()     ((INT64) standin_calls)
+#else
+    #define CALLS()     ((INT64) -1)
+#endif
+
+
+#define IMAGE_W         64
+#define IMAGE_H         64
+#define BATCH           64
+#define ITEMS           256     /* Per call of the batch APIs. */
+#define SPATIAL_ITEMS   100000  /* In the spatial index. */
+#define SERIES_POINTS   65536   /* Of the decimated polyline. */
+
+static UINT nSamples = 200;
+
+static HDC hDC;
+static WD_HCANVAS hCanvas;
+static WD_HBRUSH hBrush;
+static WD_HFONT hFont;
+static WD_HDISPLAYLIST hList;
+static WD_HPATH hHitPath;
+static WD_HPATH hCurvePath;
+static WD_HREALIZEDFILL hRealized;
+static WD_HSTROKESTYLE hDashStyle;
+static WD_HPATH hWidePath;
+static WD_HSPATIALINDEX hIndex;
+static BYTE pixels[IMAGE_W * IMAGE_H * 4];
+static BYTE palettePixels[IMAGE_W * IMAGE_H];
+static COLORREF palette[256];
+static WD_RECT rects[ITEMS];
+static WD_POINT points[ITEMS];
+static UINT spatialIds[SPATIAL_ITEMS];
+static WD_RECT spatialRects[SPATIAL_ITEMS];
+static UINT spatialHits[1024];
+static WD_POINT series[SERIES_POINTS];
+
+
+/********************
+ ***  Benchmarks  ***
+ ********************/
+
+static void
+bench_image_rgba(void)
+{
+    WD_HIMAGE img = wdCreateImageFromBuffer(IMAGE_W, IMAGE_H, IMAGE_W * 4,
+                pixels, WD_PIXELFORMAT_R8G8B8A8, NULL, 0);
+    if(img != NULL)
+        wdDestroyImage(img);
+}
+
+static void
+bench_image_bgra(void)
+{
+    WD_HIMAGE img = wdCreateImageFromBuffer(IMAGE_W, IMAGE_H, IMAGE_W * 4,
+                pixels, WD_PIXELFORMAT_B8G8R8A8, NULL, 0);
+    if(img != NULL)
+        wdDestroyImage(img);
+}
+
+static void
+bench_image_palette(void)
+{
+    WD_HIMAGE img = wdCreateImageFromBuffer(IMAGE_W, IMAGE_H, IMAGE_W,
+                palettePixels, WD_PIXELFORMAT_PALETTE, palette, 256);
+    if(img != NULL)
+        wdDestroyImage(img);
+}
+
+static void
+bench_path_build(void)
+{
+    WD_HPATH path;
+    WD_PATHSINK sink;
+
+    path = wdCreatePath(NULL);
+    if(path == NULL)
+        return;
+    if(wdOpenPathSink(&sink, path)) {
+        wdBeginFigure(&sink, 10.0f, 10.0f);
+        wdAddLine(&sink, 100.0f, 10.0f);
+        wdAddBezier(&sink, 120.0f, 20.0f, 120.0f, 80.0f, 100.0f, 100.0f);
+        wdAddArc(&sink, 55.0f, 100.0f, 90.0f);
+        wdAddLine(&sink, 10.0f, 100.0f);
+        wdEndFigure(&sink, TRUE);
+        wdClosePathSink(&sink);
+    }
+    wdDestroyPath(path);
+}
+
+static void
+bench_path_polygon(void)
+{
+    WD_HPATH path;
+
+    path = wdCreatePolygonPath(NULL, points, ITEMS);
+    if(path != NULL)
+        wdDestroyPath(path);
+}
+
+/* Probes around the vertices of hHitPath; some hit, some miss. */
+static const WD_POINT*
+hit_probe(void)
+{
+    static UINT n = 0;
+    static WD_POINT pt;
+
+    pt.x = points[n % ITEMS].x + (float) (n % 7) - 3.0f;
+    pt.y = points[n % ITEMS].y + (float) (n % 5) - 2.0f;
+    n++;
+    return &pt;
+}
+
+static void
+bench_hittest_fill(void)
+{
+    const WD_POINT* pt = hit_probe();
+    wdPathFillContainsPoint(hHitPath, pt->x, pt->y, WD_FILL_ALTERNATE);
+}
+
+static void
+bench_hittest_stroke(void)
+{
+    const WD_POINT* pt = hit_probe();
+    wdPathStrokeContainsPoint(hHitPath, pt->x, pt->y, 3.0f, NULL);
+}
+
+static void
+bench_hittest_miss(void)
+{
+    /* Outside of the bounds. */
+    wdPathFillContainsPoint(hHitPath, -100.0f, -100.0f, WD_FILL_ALTERNATE);
+}
+
+static BOOL
+flatten_callback(void* data, const WD_POINT* points, UINT count, BOOL closed)
+{
+    return TRUE;
+}
+
+/* 85 Bezier curves through the points. */
+static void
+bench_flatten_path(void)
+{
+    wdFlattenPath(hCurvePath, 0.25f, NULL, flatten_callback, NULL);
+}
+
+/* The same, zoomed in four times. */
+static void
+bench_flatten_zoom(void)
+{
+    static const WD_MATRIX zoom = { 4.0f, 0.0f, 0.0f, 4.0f, 0.0f, 0.0f };
+    wdFlattenPath(hCurvePath, 0.25f, &zoom, flatten_callback, NULL);
+}
+
+/* Filling the curves again and again, scrolled by whole pixels. */
+static void
+bench_realize_fillpath(void)
+{
+    static UINT frame;
+
+    wdBeginPaint(hCanvas);
+    wdResetWorld(hCanvas);
+    wdTranslateWorld(hCanvas, (float) (frame++ % 8), 0.0f);
+    wdFillPath(hCanvas, hBrush, hCurvePath);
+    wdEndPaint(hCanvas);
+}
+
+static void
+bench_realize_fill(void)
+{
+    static UINT frame;
+
+    wdBeginPaint(hCanvas);
+    wdResetWorld(hCanvas);
+    wdTranslateWorld(hCanvas, (float) (frame++ % 8), 0.0f);
+    wdFillRealizedPath(hCanvas, hBrush, hRealized);
+    wdEndPaint(hCanvas);
+}
+
+/* The curves stroked 6 units wide, dashed, with round caps and joins. */
+static void
+bench_widen_build(void)
+{
+    WD_HPATH path = wdWidenPath(hCanvas, hCurvePath, 6.0f, hDashStyle, 0.0f);
+    if(path != NULL)
+        wdDestroyPath(path);
+}
+
+static void
+bench_widen_drawpath(void)
+{
+    wdBeginPaint(hCanvas);
+    wdDrawPathStyled(hCanvas, hBrush, hCurvePath, 6.0f, hDashStyle);
+    wdEndPaint(hCanvas);
+}
+
+static void
+bench_widen_fill(void)
+{
+    wdBeginPaint(hCanvas);
+    wdFillPath(hCanvas, hBrush, hWidePath);
+    wdEndPaint(hCanvas);
+}
+
+/* A large scrollable document: 100k small items scattered over a world of
+ * 20000 x 20000, with a 640 x 480 viewport moving over it. */
+static const WD_POINT*
+spatial_probe(void)
+{
+    static UINT n = 0;
+    static WD_POINT pt;
+
+    pt.x = (float) ((n * 7919) % 19000);
+    pt.y = (float) ((n * 104729) % 19000);
+    n++;
+    return &pt;
+}
+
+static void
+bench_spatial_build(void)
+{
+    /* Only part of the items, so the case takes a while, not forever. */
+    WD_HSPATIALINDEX index = wdCreateSpatialIndex(spatialIds, spatialRects, 4096);
+    if(index != NULL)
+        wdDestroySpatialIndex(index);
+}
+
+static void
+bench_spatial_point(void)
+{
+    const WD_POINT* pt = spatial_probe();
+    wdQuerySpatialIndexPoint(hIndex, pt->x, pt->y, spatialHits, 1024);
+}
+
+static void
+bench_spatial_rect(void)
+{
+    const WD_POINT* pt = spatial_probe();
+    WD_RECT rect = { pt->x, pt->y, pt->x + 640.0f, pt->y + 480.0f };
+    wdQuerySpatialIndexRect(hIndex, &rect, spatialHits, 1024);
+}
+
+/* What wdQuerySpatialIndexRect() saves us from. */
+static void
+bench_spatial_linear(void)
+{
+    const WD_POINT* pt = spatial_probe();
+    WD_RECT rect = { pt->x, pt->y, pt->x + 640.0f, pt->y + 480.0f };
+    UINT i, n = 0;
+
+    for(i = 0; i < SPATIAL_ITEMS; i++) {
+        const WD_RECT* r = &spatialRects[i];
+        if(r->x0 <= rect.x1  &&  rect.x0 <= r->x1  &&  r->y0 <= rect.y1  &&  rect.y0 <= r->y1) {
+            if(n < 1024)
+                spatialHits[n] = spatialIds[i];
+            n++;
+        }
+    }
+}
+
+static void
+bench_spatial_visible(void)
+{
+    const WD_POINT* pt = spatial_probe();
+
+    wdBeginPaint(hCanvas);
+    wdResetWorld(hCanvas);
+    wdTranslateWorld(hCanvas, -pt->x, -pt->y);
+    wdQuerySpatialIndexVisible(hIndex, hCanvas, spatialHits, 1024);
+    wdEndPaint(hCanvas);
+}
+
+/* An item moving around: the index absorbs the churn and rebuilds itself
+ * from time to time. */
+static void
+bench_spatial_update(void)
+{
+    static UINT n = 0;
+    UINT i = (n * 7919) % SPATIAL_ITEMS;
+
+    wdRemoveSpatialIndexItem(hIndex, spatialIds[i], &spatialRects[i]);
+    spatialRects[i].x0 += 1.0f;
+    spatialRects[i].x1 += 1.0f;
+    wdInsertSpatialIndexItem(hIndex, spatialIds[i], &spatialRects[i]);
+    wdQuerySpatialIndexPoint(hIndex, spatialRects[i].x0, spatialRects[i].y0, spatialHits, 1024);
+    n++;
+}
+
+static void
+bench_brush_solid(void)
+{
+    WD_HBRUSH b = wdCreateSolidBrush(hCanvas, WD_RGB(255,0,0));
+    if(b != NULL)
+        wdDestroyBrush(b);
+}
+
+static void
+bench_brush_linear(void)
+{
+    WD_HBRUSH b = wdCreateLinearGradientBrush(hCanvas, 0.0f, 0.0f,
+                WD_RGB(255,0,0), 100.0f, 100.0f, WD_RGB(0,0,255));
+    if(b != NULL)
+        wdDestroyBrush(b);
+}
+
+static void
+bench_stroke_style(void)
+{
+    WD_HSTROKESTYLE s = wdCreateStrokeStyle(WD_DASHSTYLE_DASH,
+                WD_LINECAP_ROUND, WD_LINEJOIN_ROUND);
+    if(s != NULL)
+        wdDestroyStrokeStyle(s);
+}
+
+static void
+bench_stroke_style_custom(void)
+{
+    static const float dashes[] = { 4.0f, 2.0f, 1.0f, 2.0f };
+    WD_HSTROKESTYLE s = wdCreateStrokeStyleCustom(dashes, 4,
+                WD_LINECAP_FLAT, WD_LINEJOIN_MITER);
+    if(s != NULL)
+        wdDestroyStrokeStyle(s);
+}
+
+static void
+bench_text_measure(void)
+{
+    static const WCHAR text[] = L"The quick brown fox jumps over the lazy dog.";
+    WD_RECT rect = { 0.0f, 0.0f, 400.0f, 100.0f };
+    WD_RECT result;
+
+    wdMeasureString(hCanvas, hFont, &rect, text, -1, &result, 0);
+}
+
+static void
+bench_draw_dispatch(void)
+{
+    wdBeginPaint(hCanvas);
+    wdFillRect(hCanvas, hBrush, 10.0f, 10.0f, 90.0f, 90.0f);
+    wdDrawLine(hCanvas, hBrush, 0.0f, 0.0f, 100.0f, 100.0f, 1.0f);
+    wdFillEllipse(hCanvas, hBrush, 50.0f, 50.0f, 20.0f, 10.0f);
+    wdEndPaint(hCanvas);
+}
+
+/* The canvas life cycle of a typical WM_PAINT handler. */
+static void
+bench_canvas_doublebuffer(void)
+{
+    RECT rect = { 0, 0, 640, 480 };
+    WD_HCANVAS c;
+
+    c = wdCreateCanvasWithHDC(hDC, &rect, WD_CANVAS_DOUBLEBUFFER);
+    if(c != NULL) {
+        wdBeginPaint(c);
+        wdFillRect(c, hBrush, 10.0f, 10.0f, 90.0f, 90.0f);
+        wdEndPaint(c);
+        wdDestroyCanvas(c);
+    }
+}
+
+/* A bar chart the slow way, then with the batch API. */
+static void
+bench_batch_loop(void)
+{
+    UINT i;
+
+    wdBeginPaint(hCanvas);
+    for(i = 0; i < ITEMS; i++)
+        wdFillRect(hCanvas, hBrush, rects[i].x0, rects[i].y0, rects[i].x1, rects[i].y1);
+    wdEndPaint(hCanvas);
+}
+
+static void
+bench_batch_rects(void)
+{
+    wdBeginPaint(hCanvas);
+    wdFillRects(hCanvas, hBrush, rects, ITEMS);
+    wdEndPaint(hCanvas);
+}
+
+static void
+bench_batch_polyline(void)
+{
+    wdBeginPaint(hCanvas);
+    wdDrawPolyline(hCanvas, hBrush, points, ITEMS, 1.0f);
+    wdEndPaint(hCanvas);
+}
+
+/* A sparkline 160 pixels wide, with about 400 points per pixel column. */
+static void
+bench_decimate_minmax(void)
+{
+    wdBeginPaint(hCanvas);
+    wdDrawPolylineDecimated(hCanvas, hBrush, series, SERIES_POINTS, 1.0f, WD_DECIMATE_MINMAX);
+    wdEndPaint(hCanvas);
+}
+
+static void
+bench_decimate_rdp(void)
+{
+    wdBeginPaint(hCanvas);
+    wdDrawPolylineDecimated(hCanvas, hBrush, series, SERIES_POINTS, 1.0f, WD_DECIMATE_RDP);
+    wdEndPaint(hCanvas);
+}
+
+/* A static part of a UI: a grid of labeled cells. */
+static void
+paint_scene(WD_HCANVAS c)
+{
+    static const WCHAR text[] = L"Label";
+    WD_RECT rect;
+    int i;
+
+    for(i = 0; i < 64; i++) {
+        rect.x0 = (float) ((i % 8) * 80);
+        rect.y0 = (float) ((i / 8) * 60);
+        rect.x1 = rect.x0 + 76.0f;
+        rect.y1 = rect.y0 + 56.0f;
+
+        wdSetSolidBrushColor(hBrush, WD_RGB(0, 4 * i, 0));
+        wdFillRect(c, hBrush, rect.x0, rect.y0, rect.x1, rect.y1);
+        wdSetSolidBrushColor(hBrush, WD_RGB(0, 0, 0));
+        wdDrawRect(c, hBrush, rect.x0, rect.y0, rect.x1, rect.y1, 1.0f);
+        wdDrawString(c, hFont, &rect, text, -1, hBrush, WD_STR_NOWRAP);
+    }
+}
+
+static void
+bench_dlist_direct(void)
+{
+    wdBeginPaint(hCanvas);
+    paint_scene(hCanvas);
+    wdEndPaint(hCanvas);
+}
+
+static void
+bench_dlist_record(void)
+{
+    WD_HDISPLAYLIST list;
+
+    wdBeginRecording(hCanvas);
+    paint_scene(hCanvas);
+    list = wdEndRecording(hCanvas);
+    if(list != NULL)
+        wdDestroyDisplayList(list);
+}
+
+static void
+bench_dlist_replay(void)
+{
+    wdBeginPaint(hCanvas);
+    wdReplay(hCanvas, hList, NULL);
+    wdEndPaint(hCanvas);
+}
+
+
+
+typedef struct BENCH_tag BENCH;
+struct BENCH_tag {
+    const char* name;
+    void (*fn)(void);
+};
+
+static const BENCH benchmarks[] = {
+    { "image.r8g8b8a8",         bench_image_rgba },
+    { "image.b8g8r8a8",         bench_image_bgra },
+    { "image.palette",          bench_image_palette },
+    { "path.build",             bench_path_build },
+    { "path.polygon",           bench_path_polygon },
+    { "hittest.fill",           bench_hittest_fill },
+    { "hittest.stroke",         bench_hittest_stroke },
+    { "hittest.miss",           bench_hittest_miss },
+    { "flatten.path",           bench_flatten_path },
+    { "flatten.zoom",           bench_flatten_zoom },
+    { "realize.fillpath",       bench_realize_fillpath },
+    { "realize.fill",           bench_realize_fill },
+    { "widen.build",            bench_widen_build },
+    { "widen.drawpath",         bench_widen_drawpath },
+    { "widen.fill",             bench_widen_fill },
+    { "spatial.build",          bench_spatial_build },
+    { "spatial.point",          bench_spatial_point },
+    { "spatial.rect",           bench_spatial_rect },
+    { "spatial.linear",         bench_spatial_linear },
+    { "spatial.visible",        bench_spatial_visible },
+    { "spatial.update",         bench_spatial_update },
+    { "brush.solid",            bench_brush_solid },
+    { "brush.linear",           bench_brush_linear },
+    { "strokestyle.dash",       bench_stroke_style },
+    { "strokestyle.custom",     bench_stroke_style_custom },
+    { "text.measure",           bench_text_measure },
+    { "draw.dispatch",          bench_draw_dispatch },
+    { "canvas.doublebuffer",    bench_canvas_doublebuffer },
+    { "batch.loop",             bench_batch_loop },
+    { "batch.rects",            bench_batch_rects },
+    { "batch.polyline",         bench_batch_polyline },
+    { "decimate.minmax",        bench_decimate_minmax },
+    { "decimate.rdp",           bench_decimate_rdp },
+    { "dlist.direct",           bench_dlist_direct },
+    { "dlist.record",           bench_dlist_record },
+    { "dlist.replay",           bench_dlist_replay }
+};
+
+
+/****************
+ ***  Runner  ***
+ ****************/
+
+static LARGE_INTEGER freq;
+
+static int
+cmp_double(const void* a, const void* b)
+{
+    double da = *(const double*) a;
+    double db = *(const double*) b;
+    return (da < db) ? -1 : (da > db) ? +1 : 0;
+}
+
+static double
+percentile(const double* sorted, UINT n, UINT p)
+{
+    UINT i = (UINT) (((UINT64) (n - 1) * p + 50) / 100);
+    return sorted[i];
+}
+
+static void
+run_bench(const BENCH* bench, const char* backend)
+{
+    double* samples;
+    LARGE_INTEGER t0, t1;
+    INT64 calls0, calls1;
+    UINT i, j;
+
+    samples = (double*) malloc(nSamples * sizeof(double));
+    if(samples == NULL) {
+        fprintf(stderr, "wdbench: out of memory\n");
+        exit(1);
+    }
+
+    /* Warm up caches and any lazily created back-end resources. */
+    for(j = 0; j < BATCH; j++)
+        bench->fn();
+
+    calls0 = CALLS();
+    for(i = 0; i < nSamples; i++) {
+        QueryPerformanceCounter(&t0);
+        for(j = 0; j < BATCH; j++)
+            bench->fn();
+        QueryPerformanceCounter(&t1);
+        samples[i] = (double) (t1.QuadPart - t0.QuadPart) * 1e9 /
+                     (double) freq.QuadPart / (double) BATCH;
+    }
+    calls1 = CALLS();
+
+    qsort(samples, nSamples, sizeof(double), cmp_double);
+
+    printf("{\"name\":\"%s\",\"backend\":\"%s\",\"build\":\"" BUILD "\","
+           "\"samples\":%u,\"batch\":%u,"
+           "\"min_ns\":%.1f,\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,"
+           "\"max_ns\":%.1f,\"backend_calls_per_op\":%.2f}\n",
+           bench->name, backend, nSamples, (UINT) BATCH,
+           samples[0], percentile(samples, nSamples, 50),
+           percentile(samples, nSamples, 90), percentile(samples, nSamples, 99),
+           samples[nSamples - 1],
+           (calls0 < 0) ? -1.0 :
+                (double) (calls1 - calls0) / ((double) nSamples * BATCH));
+    fflush(stdout);
+    free(samples);
+}
+
+/* Either dwPreInitFlags select the built-in back-end, or pOps is
+ * the custom one. */
+static int
+run_backend(const char* backend, DWORD dwPreInitFlags, const WD_BACKEND_OPS* pOps,
+            const char* filter)
+{
+    static const DWORD initFlags = WD_INIT_IMAGEAPI | WD_INIT_STRINGAPI;
+    LOGFONTW lf;
+    WD_PATHSINK sink;
+    RECT rect = { 0, 0, 640, 480 };
+    UINT i;
+    int ret = 0;
+
+    if(pOps != NULL) {
+        if(!wdInitializeWithBackend(pOps)) {
+            fprintf(stderr, "wdbench: wdInitializeWithBackend() failed for %s\n", backend);
+            return -1;
+        }
+    } else {
+        wdPreInitialize(NULL, NULL, dwPreInitFlags);
+    }
+    if(!wdInitialize(initFlags)) {
+        fprintf(stderr, "wdbench: wdInitialize() failed for %s\n", backend);
+        ret = -1;
+        goto err_init;
+    }
+
+    hDC = GetDC(NULL);
+    hCanvas = wdCreateCanvasWithHDC(hDC, &rect, 0);
+    if(hCanvas == NULL) {
+        fprintf(stderr, "wdbench: wdCreateCanvasWithHDC() failed for %s\n", backend);
+        ret = -1;
+        goto err_canvas;
+    }
+
+    hList = NULL;
+    hHitPath = NULL;
+    hCurvePath = NULL;
+    hRealized = NULL;
+    hDashStyle = NULL;
+    hWidePath = NULL;
+    hIndex = NULL;
+    hBrush = wdCreateSolidBrush(hCanvas, WD_RGB(0,128,0));
+    memset(&lf, 0, sizeof(LOGFONTW));
+    lf.lfHeight = -12;
+    wcscpy(lf.lfFaceName, L"Segoe UI");
+    hFont = wdCreateFont(&lf);
+    if(hBrush == NULL  ||  hFont == NULL) {
+        fprintf(stderr, "wdbench: resource creation failed for %s\n", backend);
+        ret = -1;
+        goto err_resources;
+    }
+
+    if(wdBeginRecording(hCanvas)) {
+        paint_scene(hCanvas);
+        hList = wdEndRecording(hCanvas);
+    }
+    if(hList == NULL) {
+        fprintf(stderr, "wdbench: display list recording failed for %s\n", backend);
+        ret = -1;
+        goto err_resources;
+    }
+
+    hHitPath = wdCreatePolygonPath(hCanvas, points, ITEMS);
+    if(hHitPath == NULL) {
+        fprintf(stderr, "wdbench: path creation failed for %s\n", backend);
+        ret = -1;
+        goto err_resources;
+    }
+
+    hCurvePath = wdCreatePath(hCanvas);
+    if(hCurvePath == NULL  ||  !wdOpenPathSink(&sink, hCurvePath)) {
+        fprintf(stderr, "wdbench: path creation failed for %s\n", backend);
+        ret = -1;
+        goto err_resources;
+    }
+    wdBeginFigure(&sink, points[0].x, points[0].y);
+    wdAddBeziers(&sink, points + 1, (ITEMS - 1) / 3);
+    wdEndFigure(&sink, FALSE);
+    wdClosePathSink(&sink);
+
+    hRealized = wdRealizePathFill(hCanvas, hCurvePath, 0.0f);
+    if(hRealized == NULL) {
+        fprintf(stderr, "wdbench: path realization failed for %s\n", backend);
+        ret = -1;
+        goto err_resources;
+    }
+
+    hDashStyle = wdCreateStrokeStyle(WD_DASHSTYLE_DASH, WD_LINECAP_ROUND, WD_LINEJOIN_ROUND);
+    if(hDashStyle != NULL)
+        hWidePath = wdWidenPath(hCanvas, hCurvePath, 6.0f, hDashStyle, 0.0f);
+    if(hWidePath == NULL) {
+        fprintf(stderr, "wdbench: path widening failed for %s\n", backend);
+        ret = -1;
+        goto err_resources;
+    }
+
+    hIndex = wdCreateSpatialIndex(spatialIds, spatialRects, SPATIAL_ITEMS);
+    if(hIndex == NULL) {
+        fprintf(stderr, "wdbench: spatial index creation failed for %s\n", backend);
+        ret = -1;
+        goto err_resources;
+    }
+
+    for(i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        if(filter != NULL  &&  strstr(benchmarks[i].name, filter) == NULL)
+            continue;
+        run_bench(&benchmarks[i], backend);
+    }
+
+err_resources:
+    if(hIndex != NULL)
+        wdDestroySpatialIndex(hIndex);
+    if(hWidePath != NULL)
+        wdDestroyPath(hWidePath);
+    if(hDashStyle != NULL)
+        wdDestroyStrokeStyle(hDashStyle);
+    if(hRealized != NULL)
+        wdDestroyRealizedFill(hRealized);
+    if(hCurvePath != NULL)
+        wdDestroyPath(hCurvePath);
+    if(hHitPath != NULL)
+        wdDestroyPath(hHitPath);
+    if(hList != NULL)
+        wdDestroyDisplayList(hList);
+    if(hFont != NULL)
+        wdDestroyFont(hFont);
+    if(hBrush != NULL)
+        wdDestroyBrush(hBrush);
+    wdDestroyCanvas(hCanvas);
+err_canvas:
+    ReleaseDC(NULL, hDC);
+    wdTerminate(initFlags);
+err_init:
+    if(pOps != NULL)
+        wdTerminate(WD_INIT_COREAPI);
+    return ret;
+}
+
+int
+main(int argc, char** argv)
+{
+    const char* filter = NULL;
+    UINT seed = 1;
+    int ret = 0;
+    UINT i;
+
+    if(argc > 1  &&  strcmp(argv[1], "all") != 0)
+        filter = argv[1];
+    if(argc > 2)
+        nSamples = (UINT) atoi(argv[2]);
+    if(nSamples < 1)
+        nSamples = 1;
+
+    QueryPerformanceFrequency(&freq);
+
+    for(i = 0; i < sizeof(pixels); i++)
+        pixels[i] = (BYTE) (i * 7);
+    for(i = 0; i < sizeof(palettePixels); i++)
+        palettePixels[i] = (BYTE) i;
+    for(i = 0; i < 256; i++)
+        palette[i] = RGB(i, 255 - i, i / 2);
+    for(i = 0; i < ITEMS; i++) {
+        rects[i].x0 = (float) ((i % 16) * 40);
+        rects[i].y0 = (float) ((i / 16) * 30);
+        rects[i].x1 = rects[i].x0 + 30.0f;
+        rects[i].y1 = rects[i].y0 + 20.0f;
+        points[i].x = (float) i * 2.5f;
+        points[i].y = (float) ((i * 37) % 480);
+    }
+    for(i = 0; i < SERIES_POINTS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        series[i].x = (float) i * (160.0f / SERIES_POINTS);
+        series[i].y = 240.0f + 200.0f * sinf((float) i * 0.0005f) +
+                      (float) ((seed >> 8) % 8u) - 4.0f;
+    }
+    for(i = 0; i < SPATIAL_ITEMS; i++) {
+        float w = (float) (4 + (i * 13) % 60);
+        float h = (float) (4 + (i * 29) % 40);
+
+        seed = seed * 1103515245u + 12345u;
+        spatialIds[i] = i;
+        spatialRects[i].x0 = (float) ((seed >> 8) % 20000u);
+        seed = seed * 1103515245u + 12345u;
+        spatialRects[i].y0 = (float) ((seed >> 8) % 20000u);
+        spatialRects[i].x1 = spatialRects[i].x0 + w;
+        spatialRects[i].y1 = spatialRects[i].y0 + h;
+    }
+
+#ifndef WD_GDIPLUS_ONLY
+    if(run_backend("d2d", 0, NULL, filter) != 0)
+        ret = 1;
+#endif
+#ifndef WD_D2D_ONLY
+    if(run_backend("gdiplus", WD_DISABLE_D2D, NULL, filter) != 0)
+        ret = 1;
+#endif
+#if !defined WD_D2D_ONLY  &&  !defined WD_GDIPLUS_ONLY
+    if(run_backend("software", WD_USE_SOFTWARE, NULL, filter) != 0)
+        ret = 1;
+    if(run_backend("null", 0, &null_backend_ops, filter) != 0)
+        ret = 1;
+#endif
+
+    return ret;
+}
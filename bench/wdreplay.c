@@ -0,0 +1,1662 @@
+/*
+ * Replay of WinDrawLib API captures (see wdStartCapture()).
+ *
+ * The capture is re-executed call by call against the chosen back-end, and
+ * the time spent in each call is measured. On Windows the real system
+ * libraries are used; elsewhere the library is linked with the recording
+ * stand-ins (see standin.h), which makes it a null back-end: the numbers
+ * then show only WinDrawLib's own overhead. The "null" back-end (see
+ * nullbackend.h) does the same everywhere, while the "software" one really
+ * rasterizes (see backend-sw.h).
+ *
+ * Usage: wdreplay [--backend d2d|gdiplus|software|null] [--repeat N] FILE
+ *
+ * By default, the back-end of the capturing process is used (the null one
+ * if that was a custom back-end), and the capture is replayed once. Objects still alive at the end of each pass are
+ * destroyed before the next one.
+ *
+ * Canvases are replayed on memory DCs of the captured size. Icons painted by
+ * wdBitBltHICON() are not part of the capture, so those calls are skipped.
+ *
+ * The output is one JSON object per line for each API function called:
+ *   {"name":..., "backend":..., "calls":..., "total_ms":...,
+ *    "mean_ns":..., "p50_ns":..., "p99_ns":..., "max_ns":...}
+ * and one summarizing the painted frames (wdBeginPaint() ... wdEndPaint()),
+ * comparing the durations in the capture with the replayed ones:
+ *   {"name":"frame", "backend":..., "frames":...,
+ *    "captured_mean_us":..., "captured_p50_us":..., "captured_p99_us":...,
+ *    "replayed_mean_us":..., "replayed_p50_us":..., "replayed_p99_us":...}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+
+#include <wdl.h>
+
+#include "capture.h"
+#include "memstream.h"
+#include "nullbackend.h"
+
+
+static const char* const op_names[WD_CAP_COUNT] = {
+    NULL,
+    NULL,                           /* WD_CAP_BLOB */
+    "wdCreateCanvas",
+    "wdDestroyCanvas",
+    "wdBeginPaint",
+    "wdEndPaint",
+    "wdResizeCanvas",
+    "wdStartGdi",
+    "wdEndGdi",
+    "wdClear",
+    "wdSetClip",
+    "wdPushClipRect",
+    "wdPushClipPath",
+    "wdPopClip",
+    "wdRotateWorld",
+    "wdTranslateWorld",
+    "wdTransformWorld",
+    "wdResetWorld",
+    "wdSetWorldTransform",
+    "wdSaveState",
+    "wdRestoreState",
+    "wdCreateImageFromBuffer",
+    "wdLoadImageFromIStream",
+    "wdDestroyImage",
+    "wdCreateCachedImage",
+    "wdDestroyCachedImage",
+    "wdCreateSolidBrush",
+    "wdCreateLinearGradientBrushEx",
+    "wdCreateRadialGradientBrushEx",
+    "wdDestroyBrush",
+    "wdSetSolidBrushColor",
+    "wdCreateStrokeStyle",
+    "wdCreateStrokeStyleCustom",
+    "wdDestroyStrokeStyle",
+    "wdCreatePath",
+    "wdDestroyPath",
+    "wdOpenPathSink",
+    "wdClosePathSink",
+    "wdBeginFigure",
+    "wdEndFigure",
+    "wdAddLine",
+    "wdAddArc",
+    "wdAddBezier",
+    "wdCreateFont",
+    "wdDestroyFont",
+    "wdFontMetrics",
+    "wdDrawEllipseArcStyled",
+    "wdDrawEllipsePieStyled",
+    "wdDrawEllipseStyled",
+    "wdDrawLineStyled",
+    "wdDrawPathStyled",
+    "wdDrawRectStyled",
+    "wdFillEllipse",
+    "wdFillEllipsePie",
+    "wdFillPath",
+    "wdFillRect",
+    "wdBitBltImage",
+    "wdBitBltCachedImage",
+    "wdBitBltHICON",
+    "wdDrawString",
+    "wdMeasureString",
+    "wdAddDirtyRect",
+    "wdSetDirtyRegion",
+    "wdRebindCanvasToHDC",
+    "wdDrawRectsStyled",
+    "wdDrawLinesStyled",
+    "wdDrawPolylineStyled",
+    "wdFillRects",
+    "wdFillEllipses",
+    "wdAddLines",
+    "wdAddBeziers",
+    "wdGetPathBounds",
+    "wdClonePath",
+    "wdTransformPath",
+    "wdPathFillContainsPoint",
+    "wdPathStrokeContainsPoint",
+    "wdFlattenPath",
+    "wdDrawPolylineDecimated",
+    "wdRealizePathFill",
+    "wdDestroyRealizedFill",
+    "wdFillRealizedPath",
+    "wdCreateStrokeStyleEx",
+    "wdWidenPath"
+};
+
+
+/*****************************
+ ***  Growable Arrays      ***
+ *****************************/
+
+typedef struct SAMPLES_tag SAMPLES;
+struct SAMPLES_tag {
+    double* values;
+    UINT n;
+    UINT alloc;
+};
+
+static void
+samples_add(SAMPLES* s, double value)
+{
+    if(s->n == s->alloc) {
+        s->alloc = (s->alloc > 0 ? s->alloc * 2 : 64);
+        s->values = (double*) realloc(s->values, s->alloc * sizeof(double));
+        if(s->values == NULL) {
+            fprintf(stderr, "wdreplay: out of memory\n");
+            exit(1);
+        }
+    }
+    s->values[s->n++] = value;
+}
+
+static int
+cmp_double(const void* a, const void* b)
+{
+    double da = *(const double*) a;
+    double db = *(const double*) b;
+    return (da < db) ? -1 : (da > db) ? +1 : 0;
+}
+
+/* Sorts the samples and returns their sum. */
+static double
+samples_sort(SAMPLES* s)
+{
+    double sum = 0.0;
+    UINT i;
+
+    qsort(s->values, s->n, sizeof(double), cmp_double);
+    for(i = 0; i < s->n; i++)
+        sum += s->values[i];
+    return sum;
+}
+
+static double
+percentile(const SAMPLES* s, UINT p)
+{
+    UINT i = (UINT) (((UINT64) (s->n - 1) * p + 50) / 100);
+    return s->values[i];
+}
+
+
+/*********************
+ ***  The Objects  ***
+ *********************/
+
+static LARGE_INTEGER freq;
+static LARGE_INTEGER t0, t1;
+
+/* Measures the time spent in the API call. */
+#define TIMED(stmt)                                                         \
+        do {                                                                \
+            QueryPerformanceCounter(&t0);                                   \
+            stmt;                                                           \
+            QueryPerformanceCounter(&t1);                                   \
+        } while(0)
+
+/* Objects are identified by the handle IDs of the capture. */
+typedef struct OBJECT_tag OBJECT;
+struct OBJECT_tag {
+    BYTE op;            /* The WD_CAP_xxx which has created it; 0 if none. */
+    void* handle;
+
+    /* Canvases only: */
+    HDC dc;
+    HBITMAP bmp;
+    HGDIOBJ old_bmp;
+    HDC gdi_dc;
+    BOOL painting;
+    LARGE_INTEGER frame_start;
+    UINT64 frame_captured_start;
+};
+
+static OBJECT* objects = NULL;
+static UINT n_objects = 0;
+
+static OBJECT*
+object(UINT id)
+{
+    if(id >= n_objects) {
+        UINT n = WD_MAX(id + 1, n_objects * 2);
+
+        objects = (OBJECT*) realloc(objects, n * sizeof(OBJECT));
+        if(objects == NULL) {
+            fprintf(stderr, "wdreplay: out of memory\n");
+            exit(1);
+        }
+        memset(objects + n_objects, 0, (n - n_objects) * sizeof(OBJECT));
+        n_objects = n;
+    }
+    return &objects[id];
+}
+
+/* Only the API call itself is timed. */
+static void
+object_destroy(OBJECT* obj)
+{
+    switch(obj->op) {
+        case WD_CAP_CREATECANVAS:
+            if(obj->gdi_dc != NULL)
+                wdEndGdi((WD_HCANVAS) obj->handle, obj->gdi_dc);
+            if(obj->painting)
+                wdEndPaint((WD_HCANVAS) obj->handle);
+            TIMED(wdDestroyCanvas((WD_HCANVAS) obj->handle));
+            SelectObject(obj->dc, obj->old_bmp);
+            DeleteObject(obj->bmp);
+            DeleteDC(obj->dc);
+            break;
+
+        case WD_CAP_IMAGEFROMBUFFER:
+        case WD_CAP_IMAGEFROMENCODED:
+            TIMED(wdDestroyImage((WD_HIMAGE) obj->handle));
+            break;
+
+        case WD_CAP_CREATECACHEDIMAGE:
+            TIMED(wdDestroyCachedImage((WD_HCACHEDIMAGE) obj->handle));
+            break;
+
+        case WD_CAP_CREATESOLIDBRUSH:
+        case WD_CAP_CREATELINEARBRUSH:
+        case WD_CAP_CREATERADIALBRUSH:
+            TIMED(wdDestroyBrush((WD_HBRUSH) obj->handle));
+            break;
+
+        case WD_CAP_CREATESTROKESTYLE:
+        case WD_CAP_CREATESTROKESTYLECUSTOM:
+        case WD_CAP_CREATESTROKESTYLEEX:
+            TIMED(wdDestroyStrokeStyle((WD_HSTROKESTYLE) obj->handle));
+            break;
+
+        case WD_CAP_CREATEPATH:
+            TIMED(wdDestroyPath((WD_HPATH) obj->handle));
+            break;
+
+        case WD_CAP_OPENPATHSINK:
+            TIMED(wdClosePathSink((WD_PATHSINK*) obj->handle));
+            free(obj->handle);
+            break;
+
+        case WD_CAP_CREATEFONT:
+            TIMED(wdDestroyFont((WD_HFONT) obj->handle));
+            break;
+
+        case WD_CAP_REALIZEPATHFILL:
+            TIMED(wdDestroyRealizedFill((WD_HREALIZEDFILL) obj->handle));
+            break;
+    }
+
+    memset(obj, 0, sizeof(OBJECT));
+}
+
+/* Destroys whatever the capture has left alive. Newer objects go first, as
+ * they may depend on the older ones (e.g. a path sink on its path). */
+static void
+objects_cleanup(void)
+{
+    UINT i;
+
+    for(i = n_objects; i > 0; i--) {
+        if(objects[i-1].op != 0)
+            object_destroy(&objects[i-1]);
+    }
+}
+
+
+/*******************
+ ***  The Blobs  ***
+ *******************/
+
+typedef struct BLOB_tag BLOB;
+struct BLOB_tag {
+    UINT64 hash;
+    const BYTE* data;
+    size_t size;
+};
+
+static BLOB* blobs = NULL;
+static UINT n_blobs = 0;
+
+static void
+blob_add(UINT64 hash, const BYTE* data, size_t size)
+{
+    if((n_blobs & (n_blobs - 1)) == 0) {
+        blobs = (BLOB*) realloc(blobs, WD_MAX(2 * n_blobs, 16) * sizeof(BLOB));
+        if(blobs == NULL) {
+            fprintf(stderr, "wdreplay: out of memory\n");
+            exit(1);
+        }
+    }
+    blobs[n_blobs].hash = hash;
+    blobs[n_blobs].data = data;
+    blobs[n_blobs].size = size;
+    n_blobs++;
+}
+
+static const BLOB*
+blob_find(UINT64 hash)
+{
+    UINT i;
+
+    for(i = 0; i < n_blobs; i++) {
+        if(blobs[i].hash == hash)
+            return &blobs[i];
+    }
+    return NULL;
+}
+
+
+/**********************************
+ ***  Decoding of the Payload   ***
+ **********************************/
+
+typedef struct READER_tag READER;
+struct READER_tag {
+    const BYTE* pos;
+    const BYTE* end;
+    BOOL bad;
+};
+
+static UINT64
+rd_varint(READER* r)
+{
+    UINT64 v = 0;
+    int shift = 0;
+
+    while(r->pos < r->end  &&  shift < 64) {
+        BYTE b = *r->pos++;
+        v |= (UINT64) (b & 0x7f) << shift;
+        if(!(b & 0x80))
+            return v;
+        shift += 7;
+    }
+
+    r->bad = TRUE;
+    return 0;
+}
+
+static UINT
+rd_u(READER* r)
+{
+    return (UINT) rd_varint(r);
+}
+
+static int
+rd_i(READER* r)
+{
+    UINT v = rd_u(r);
+    return (int) (v >> 1) ^ -(int) (v & 1);
+}
+
+static DWORD
+rd_le32(READER* r)
+{
+    DWORD v;
+
+    if(r->end - r->pos < 4) {
+        r->bad = TRUE;
+        r->pos = r->end;
+        return 0;
+    }
+    v = (DWORD) r->pos[0] | ((DWORD) r->pos[1] << 8) |
+        ((DWORD) r->pos[2] << 16) | ((DWORD) r->pos[3] << 24);
+    r->pos += 4;
+    return v;
+}
+
+static float
+rd_f(READER* r)
+{
+    DWORD v = rd_le32(r);
+    float f;
+
+    memcpy(&f, &v, sizeof(float));
+    return f;
+}
+
+static WD_COLOR
+rd_c(READER* r)
+{
+    return (WD_COLOR) rd_le32(r);
+}
+
+static void
+rd_rect(READER* r, WD_RECT* rect)
+{
+    rect->x0 = rd_f(r);
+    rect->y0 = rd_f(r);
+    rect->x1 = rd_f(r);
+    rect->y1 = rd_f(r);
+}
+
+/* Returns rect, or NULL if the captured one has been NULL. */
+static WD_RECT*
+rd_rect_opt(READER* r, WD_RECT* rect)
+{
+    if(rd_u(r) == 0)
+        return NULL;
+    rd_rect(r, rect);
+    return rect;
+}
+
+static void
+rd_matrix(READER* r, WD_MATRIX* m)
+{
+    m->m11 = rd_f(r);
+    m->m12 = rd_f(r);
+    m->m21 = rd_f(r);
+    m->m22 = rd_f(r);
+    m->dx = rd_f(r);
+    m->dy = rd_f(r);
+}
+
+static WD_MATRIX*
+rd_matrix_opt(READER* r, WD_MATRIX* m)
+{
+    if(rd_u(r) == 0)
+        return NULL;
+    rd_matrix(r, m);
+    return m;
+}
+
+/* Returns the string in a buffer valid until the next call. */
+static const WCHAR*
+rd_s(READER* r, int* p_len)
+{
+    static WCHAR* buffer = NULL;
+    static UINT alloc = 0;
+    UINT len = rd_u(r);
+    UINT i;
+
+    if((size_t) (r->end - r->pos) < 2 * (size_t) len) {
+        r->bad = TRUE;
+        len = 0;
+    }
+
+    if(len + 1 > alloc) {
+        alloc = len + 1;
+        buffer = (WCHAR*) realloc(buffer, alloc * sizeof(WCHAR));
+        if(buffer == NULL) {
+            fprintf(stderr, "wdreplay: out of memory\n");
+            exit(1);
+        }
+    }
+
+    for(i = 0; i < len; i++) {
+        buffer[i] = (WCHAR) (r->pos[0] | (r->pos[1] << 8));
+        r->pos += 2;
+    }
+    buffer[len] = L'\0';
+
+    *p_len = (int) len;
+    return buffer;
+}
+
+static UINT64
+rd_x(READER* r)
+{
+    UINT64 lo = rd_le32(r);
+    UINT64 hi = rd_le32(r);
+    return lo | (hi << 32);
+}
+
+static const BLOB*
+rd_blob(READER* r)
+{
+    return blob_find(rd_x(r));
+}
+
+/* Returns the object of an existing handle, or NULL. */
+static OBJECT*
+rd_obj(READER* r)
+{
+    UINT id = rd_u(r);
+
+    if(id == 0  ||  id >= n_objects  ||  objects[id].op == 0)
+        return NULL;
+    return &objects[id];
+}
+
+static void*
+rd_h(READER* r)
+{
+    OBJECT* obj = rd_obj(r);
+    return (obj != NULL ? obj->handle : NULL);
+}
+
+/* Returns the slot for a newly created object, or NULL when the captured
+ * creation has failed. */
+static OBJECT*
+rd_h_new(READER* r)
+{
+    UINT id = rd_u(r);
+    return (id != 0 ? object(id) : NULL);
+}
+
+
+/*********************
+ ***  The Replay   ***
+ *********************/
+
+static SAMPLES op_samples[WD_CAP_COUNT];
+static SAMPLES frames_captured;
+static SAMPLES frames_replayed;
+
+static UINT n_skipped;
+
+#define CALL(stmt)                                                          \
+        do {                                                                \
+            TIMED(stmt);                                                    \
+            timed = TRUE;                                                   \
+        } while(0)
+
+#define NEW(slot, op_, stmt)                                                \
+        do {                                                                \
+            void* handle_;                                                  \
+            CALL(handle_ = (void*) (stmt));                                 \
+            if((slot) != NULL) {                                            \
+                (slot)->op = ((handle_ != NULL) ? (op_) : 0);               \
+                (slot)->handle = handle_;                                   \
+            } else if(handle_ != NULL) {                                    \
+                /* The capture says this failed; keep the replay the same. */ \
+                OBJECT tmp_;                                                \
+                memset(&tmp_, 0, sizeof(OBJECT));                           \
+                tmp_.op = (op_);                                            \
+                tmp_.handle = handle_;                                      \
+                object_destroy(&tmp_);                                      \
+            }                                                               \
+        } while(0)
+
+/* The application's callback of wdFlattenPath() is not captured. */
+static BOOL
+flatten_callback(void* data, const WD_POINT* points, UINT count, BOOL closed)
+{
+    return TRUE;
+}
+
+static void
+replay_record(BYTE op, UINT64 now_captured, READER* r)
+{
+    BOOL timed = FALSE;
+    WD_RECT rect, rect2;
+    WD_RECT* pr;
+    WD_RECT* pr2;
+    WD_MATRIX m;
+    OBJECT* slot;
+    OBJECT* obj;
+    void* a;
+    void* b;
+    void* c;
+    void* d;
+    float f[9];
+    UINT u[4];
+    const WCHAR* str;
+    int len;
+    int i;
+
+    switch(op) {
+        case WD_CAP_CREATECANVAS:
+        {
+            RECT area = { 0, 0, 0, 0 };
+            HDC screen_dc;
+
+            slot = rd_h_new(r);
+            u[0] = rd_u(r);
+            area.right = (LONG) rd_u(r);
+            area.bottom = (LONG) rd_u(r);
+            if(slot == NULL)
+                break;
+
+            screen_dc = GetDC(NULL);
+            slot->dc = CreateCompatibleDC(screen_dc);
+            slot->bmp = CreateCompatibleBitmap(screen_dc,
+                        WD_MAX(area.right, 1), WD_MAX(area.bottom, 1));
+            slot->old_bmp = SelectObject(slot->dc, slot->bmp);
+            ReleaseDC(NULL, screen_dc);
+
+            CALL(slot->handle = wdCreateCanvasWithHDC(slot->dc, &area, u[0]));
+            if(slot->handle != NULL) {
+                slot->op = WD_CAP_CREATECANVAS;
+            } else {
+                SelectObject(slot->dc, slot->old_bmp);
+                DeleteObject(slot->bmp);
+                DeleteDC(slot->dc);
+                memset(slot, 0, sizeof(OBJECT));
+            }
+            break;
+        }
+
+        case WD_CAP_DESTROYCANVAS:
+        case WD_CAP_DESTROYIMAGE:
+        case WD_CAP_DESTROYCACHEDIMAGE:
+        case WD_CAP_DESTROYBRUSH:
+        case WD_CAP_DESTROYSTROKESTYLE:
+        case WD_CAP_DESTROYPATH:
+        case WD_CAP_CLOSEPATHSINK:
+        case WD_CAP_DESTROYFONT:
+        case WD_CAP_DESTROYREALIZEDFILL:
+            obj = rd_obj(r);
+            if(obj == NULL)
+                break;
+            object_destroy(obj);
+            timed = TRUE;
+            break;
+
+        case WD_CAP_BEGINPAINT:
+            obj = rd_obj(r);
+            if(obj == NULL)
+                break;
+            CALL(wdBeginPaint((WD_HCANVAS) obj->handle));
+            obj->painting = TRUE;
+            obj->frame_start = t0;
+            obj->frame_captured_start = now_captured;
+            break;
+
+        case WD_CAP_ENDPAINT:
+            obj = rd_obj(r);
+            if(obj == NULL)
+                break;
+            CALL(wdEndPaint((WD_HCANVAS) obj->handle));
+            if(obj->painting) {
+                samples_add(&frames_captured,
+                        (double) (now_captured - obj->frame_captured_start));
+                samples_add(&frames_replayed,
+                        (double) (t1.QuadPart - obj->frame_start.QuadPart) * 1e6 /
+                        (double) freq.QuadPart);
+                obj->painting = FALSE;
+            }
+            break;
+
+        case WD_CAP_RESIZECANVAS:
+            a = rd_h(r);
+            u[0] = rd_u(r);
+            u[1] = rd_u(r);
+            if(a != NULL)
+                CALL(wdResizeCanvas((WD_HCANVAS) a, u[0], u[1]));
+            break;
+
+        case WD_CAP_STARTGDI:
+            obj = rd_obj(r);
+            u[0] = rd_u(r);
+            if(obj == NULL)
+                break;
+            CALL(obj->gdi_dc = wdStartGdi((WD_HCANVAS) obj->handle, u[0]));
+            break;
+
+        case WD_CAP_ENDGDI:
+            obj = rd_obj(r);
+            if(obj == NULL  ||  obj->gdi_dc == NULL)
+                break;
+            CALL(wdEndGdi((WD_HCANVAS) obj->handle, obj->gdi_dc));
+            obj->gdi_dc = NULL;
+            break;
+
+        case WD_CAP_CLEAR:
+            a = rd_h(r);
+            u[0] = rd_c(r);
+            if(a != NULL)
+                CALL(wdClear((WD_HCANVAS) a, u[0]));
+            break;
+
+        case WD_CAP_SETCLIP:
+            a = rd_h(r);
+            pr = rd_rect_opt(r, &rect);
+            b = rd_h(r);
+            if(a != NULL)
+                CALL(wdSetClip((WD_HCANVAS) a, pr, (WD_HPATH) b));
+            break;
+
+        case WD_CAP_PUSHCLIPRECT:
+            a = rd_h(r);
+            pr = rd_rect_opt(r, &rect);
+            if(a != NULL)
+                CALL(wdPushClipRect((WD_HCANVAS) a, pr));
+            break;
+
+        case WD_CAP_PUSHCLIPPATH:
+            a = rd_h(r);
+            b = rd_h(r);
+            pr = rd_rect_opt(r, &rect);
+            if(a != NULL)
+                CALL(wdPushClipPath((WD_HCANVAS) a, (WD_HPATH) b, pr));
+            break;
+
+        case WD_CAP_POPCLIP:
+            a = rd_h(r);
+            if(a != NULL)
+                CALL(wdPopClip((WD_HCANVAS) a));
+            break;
+
+        case WD_CAP_ROTATEWORLD:
+            a = rd_h(r);
+            for(i = 0; i < 3; i++)
+                f[i] = rd_f(r);
+            if(a != NULL)
+                CALL(wdRotateWorld((WD_HCANVAS) a, f[0], f[1], f[2]));
+            break;
+
+        case WD_CAP_TRANSLATEWORLD:
+            a = rd_h(r);
+            f[0] = rd_f(r);
+            f[1] = rd_f(r);
+            if(a != NULL)
+                CALL(wdTranslateWorld((WD_HCANVAS) a, f[0], f[1]));
+            break;
+
+        case WD_CAP_TRANSFORMWORLD:
+        case WD_CAP_SETWORLDTRANSFORM:
+            a = rd_h(r);
+            rd_matrix(r, &m);
+            if(a == NULL)
+                break;
+            if(op == WD_CAP_TRANSFORMWORLD)
+                CALL(wdTransformWorld((WD_HCANVAS) a, &m));
+            else
+                CALL(wdSetWorldTransform((WD_HCANVAS) a, &m));
+            break;
+
+        case WD_CAP_RESETWORLD:
+            a = rd_h(r);
+            if(a != NULL)
+                CALL(wdResetWorld((WD_HCANVAS) a));
+            break;
+
+        case WD_CAP_SAVESTATE:
+            a = rd_h(r);
+            if(a != NULL)
+                CALL(wdSaveState((WD_HCANVAS) a));
+            break;
+
+        case WD_CAP_RESTORESTATE:
+            a = rd_h(r);
+            if(a != NULL)
+                CALL(wdRestoreState((WD_HCANVAS) a));
+            break;
+
+        case WD_CAP_IMAGEFROMBUFFER:
+        {
+            const BLOB* pixels;
+            COLORREF* palette = NULL;
+
+            slot = rd_h_new(r);
+            for(i = 0; i < 4; i++)
+                u[i] = rd_u(r);
+            pixels = rd_blob(r);
+            len = (int) rd_u(r);
+            if(len > 0  &&  r->end - r->pos >= 4 * (ptrdiff_t) len) {
+                palette = (COLORREF*) malloc(len * sizeof(COLORREF));
+                if(palette == NULL) {
+                    fprintf(stderr, "wdreplay: out of memory\n");
+                    exit(1);
+                }
+                for(i = 0; i < len; i++)
+                    palette[i] = (COLORREF) rd_c(r);
+            }
+            if(pixels != NULL  &&  pixels->size > 0) {
+                NEW(slot, WD_CAP_IMAGEFROMBUFFER, wdCreateImageFromBuffer(
+                        u[0], u[1], u[2], pixels->data, (int) u[3],
+                        palette, (palette != NULL ? (UINT) len : 0)));
+            }
+            free(palette);
+            break;
+        }
+
+        case WD_CAP_IMAGEFROMENCODED:
+        {
+            const BLOB* file;
+            IStream* stream;
+
+            slot = rd_h_new(r);
+            file = rd_blob(r);
+            if(file == NULL  ||  file->size == 0)
+                break;
+            if(FAILED(memstream_create(file->data, (ULONG) file->size, &stream)))
+                break;
+            NEW(slot, WD_CAP_IMAGEFROMENCODED, wdLoadImageFromIStream(stream));
+            IStream_Release(stream);
+            break;
+        }
+
+        case WD_CAP_CREATECACHEDIMAGE:
+            slot = rd_h_new(r);
+            a = rd_h(r);
+            b = rd_h(r);
+            if(a != NULL  &&  b != NULL)
+                NEW(slot, op, wdCreateCachedImage((WD_HCANVAS) a, (WD_HIMAGE) b));
+            break;
+
+        case WD_CAP_CREATESOLIDBRUSH:
+            slot = rd_h_new(r);
+            a = rd_h(r);
+            u[0] = rd_c(r);
+            if(a != NULL)
+                NEW(slot, op, wdCreateSolidBrush((WD_HCANVAS) a, u[0]));
+            break;
+
+        case WD_CAP_CREATELINEARBRUSH:
+        case WD_CAP_CREATERADIALBRUSH:
+        {
+            WD_COLOR* colors;
+            float* offsets;
+            int n_params = (op == WD_CAP_CREATELINEARBRUSH ? 4 : 5);
+
+            slot = rd_h_new(r);
+            a = rd_h(r);
+            for(i = 0; i < n_params; i++)
+                f[i] = rd_f(r);
+            len = (int) rd_u(r);
+            if(r->end - r->pos < 8 * (ptrdiff_t) len) {
+                r->bad = TRUE;
+                break;
+            }
+            colors = (WD_COLOR*) malloc((len + 1) * sizeof(WD_COLOR));
+            offsets = (float*) malloc((len + 1) * sizeof(float));
+            if(colors == NULL  ||  offsets == NULL) {
+                fprintf(stderr, "wdreplay: out of memory\n");
+                exit(1);
+            }
+            for(i = 0; i < len; i++) {
+                colors[i] = rd_c(r);
+                offsets[i] = rd_f(r);
+            }
+            if(a != NULL) {
+                if(op == WD_CAP_CREATELINEARBRUSH) {
+                    NEW(slot, op, wdCreateLinearGradientBrushEx((WD_HCANVAS) a,
+                            f[0], f[1], f[2], f[3], colors, offsets, (UINT) len));
+                } else {
+                    NEW(slot, op, wdCreateRadialGradientBrushEx((WD_HCANVAS) a,
+                            f[0], f[1], f[2], f[3], f[4], colors, offsets, (UINT) len));
+                }
+            }
+            free(colors);
+            free(offsets);
+            break;
+        }
+
+        case WD_CAP_SETSOLIDBRUSHCOLOR:
+            a = rd_h(r);
+            u[0] = rd_c(r);
+            if(a != NULL)
+                CALL(wdSetSolidBrushColor((WD_HBRUSH) a, u[0]));
+            break;
+
+        case WD_CAP_CREATESTROKESTYLE:
+            slot = rd_h_new(r);
+            for(i = 0; i < 3; i++)
+                u[i] = rd_u(r);
+            NEW(slot, op, wdCreateStrokeStyle(u[0], u[1], u[2]));
+            break;
+
+        case WD_CAP_CREATESTROKESTYLECUSTOM:
+        case WD_CAP_CREATESTROKESTYLEEX:
+        {
+            float* dashes;
+
+            slot = rd_h_new(r);
+            len = (int) rd_u(r);
+            if(r->end - r->pos < 4 * (ptrdiff_t) len) {
+                r->bad = TRUE;
+                break;
+            }
+            dashes = (float*) malloc((len + 1) * sizeof(float));
+            if(dashes == NULL) {
+                fprintf(stderr, "wdreplay: out of memory\n");
+                exit(1);
+            }
+            for(i = 0; i < len; i++)
+                dashes[i] = rd_f(r);
+            u[0] = rd_u(r);
+            u[1] = rd_u(r);
+            if(op == WD_CAP_CREATESTROKESTYLEEX) {
+                f[0] = rd_f(r);
+                NEW(slot, op, wdCreateStrokeStyleEx(dashes, (UINT) len, u[0], u[1], f[0]));
+            } else {
+                NEW(slot, op, wdCreateStrokeStyleCustom(dashes, (UINT) len, u[0], u[1]));
+            }
+            free(dashes);
+            break;
+        }
+
+        case WD_CAP_CREATEPATH:
+            slot = rd_h_new(r);
+            a = rd_h(r);
+            NEW(slot, op, wdCreatePath((WD_HCANVAS) a));
+            break;
+
+        case WD_CAP_CLONEPATH:
+            slot = rd_h_new(r);
+            a = rd_h(r);
+            b = rd_h(r);
+            if(b != NULL)
+                NEW(slot, WD_CAP_CREATEPATH, wdClonePath((WD_HCANVAS) a, (WD_HPATH) b));
+            break;
+
+        case WD_CAP_WIDENPATH:
+            slot = rd_h_new(r);
+            a = rd_h(r);
+            b = rd_h(r);
+            f[0] = rd_f(r);
+            c = rd_h(r);
+            f[1] = rd_f(r);
+            if(b != NULL) {
+                NEW(slot, WD_CAP_CREATEPATH, wdWidenPath((WD_HCANVAS) a, (WD_HPATH) b,
+                        f[0], (WD_HSTROKESTYLE) c, f[1]));
+            }
+            break;
+
+        case WD_CAP_GETPATHBOUNDS:
+        {
+            WD_RECT rect;
+
+            a = rd_h(r);
+            if(a != NULL)
+                CALL(wdGetPathBounds((WD_HPATH) a, &rect));
+            break;
+        }
+
+        case WD_CAP_TRANSFORMPATH:
+        {
+            WD_MATRIX m;
+
+            a = rd_h(r);
+            rd_matrix(r, &m);
+            if(a != NULL)
+                CALL(wdTransformPath((WD_HPATH) a, &m));
+            break;
+        }
+
+        case WD_CAP_FILLCONTAINSPOINT:
+            a = rd_h(r);
+            f[0] = rd_f(r);
+            f[1] = rd_f(r);
+            u[0] = rd_u(r);
+            if(a != NULL)
+                CALL(wdPathFillContainsPoint((WD_HPATH) a, f[0], f[1], u[0]));
+            break;
+
+        case WD_CAP_STROKECONTAINSPOINT:
+            a = rd_h(r);
+            f[0] = rd_f(r);
+            f[1] = rd_f(r);
+            f[2] = rd_f(r);
+            b = rd_h(r);
+            if(a != NULL)
+                CALL(wdPathStrokeContainsPoint((WD_HPATH) a, f[0], f[1], f[2], (WD_HSTROKESTYLE) b));
+            break;
+
+        case WD_CAP_FLATTENPATH:
+        {
+            WD_MATRIX m;
+            WD_MATRIX* pm;
+
+            a = rd_h(r);
+            f[0] = rd_f(r);
+            pm = rd_matrix_opt(r, &m);
+            if(a != NULL)
+                CALL(wdFlattenPath((WD_HPATH) a, f[0], pm, flatten_callback, NULL));
+            break;
+        }
+
+        case WD_CAP_REALIZEPATHFILL:
+            slot = rd_h_new(r);
+            a = rd_h(r);
+            b = rd_h(r);
+            f[0] = rd_f(r);
+            if(b != NULL)
+                NEW(slot, op, wdRealizePathFill((WD_HCANVAS) a, (WD_HPATH) b, f[0]));
+            break;
+
+        case WD_CAP_OPENPATHSINK:
+        {
+            WD_PATHSINK* sink;
+            BOOL ok;
+
+            slot = rd_h_new(r);
+            a = rd_h(r);
+            if(slot == NULL  ||  a == NULL)
+                break;
+            sink = (WD_PATHSINK*) malloc(sizeof(WD_PATHSINK));
+            if(sink == NULL) {
+                fprintf(stderr, "wdreplay: out of memory\n");
+                exit(1);
+            }
+            CALL(ok = wdOpenPathSink(sink, (WD_HPATH) a));
+            if(ok) {
+                slot->op = WD_CAP_OPENPATHSINK;
+                slot->handle = sink;
+            } else {
+                free(sink);
+            }
+            break;
+        }
+
+        case WD_CAP_BEGINFIGURE:
+        case WD_CAP_ADDLINE:
+            a = rd_h(r);
+            f[0] = rd_f(r);
+            f[1] = rd_f(r);
+            if(a == NULL)
+                break;
+            if(op == WD_CAP_BEGINFIGURE)
+                CALL(wdBeginFigure((WD_PATHSINK*) a, f[0], f[1]));
+            else
+                CALL(wdAddLine((WD_PATHSINK*) a, f[0], f[1]));
+            break;
+
+        case WD_CAP_ENDFIGURE:
+            a = rd_h(r);
+            u[0] = rd_u(r);
+            if(a != NULL)
+                CALL(wdEndFigure((WD_PATHSINK*) a, u[0]));
+            break;
+
+        case WD_CAP_ADDARC:
+            a = rd_h(r);
+            for(i = 0; i < 3; i++)
+                f[i] = rd_f(r);
+            if(a != NULL)
+                CALL(wdAddArc((WD_PATHSINK*) a, f[0], f[1], f[2]));
+            break;
+
+        case WD_CAP_ADDBEZIER:
+            a = rd_h(r);
+            for(i = 0; i < 6; i++)
+                f[i] = rd_f(r);
+            if(a != NULL)
+                CALL(wdAddBezier((WD_PATHSINK*) a, f[0], f[1], f[2], f[3], f[4], f[5]));
+            break;
+
+        case WD_CAP_ADDLINES:
+        case WD_CAP_ADDBEZIERS:
+        {
+            int n_points;
+            WD_POINT* points = NULL;
+
+            a = rd_h(r);
+            len = (int) rd_u(r);
+            n_points = (op == WD_CAP_ADDBEZIERS) ? 3 * len : len;
+            if(n_points > 0  &&  r->end - r->pos >= 8 * (ptrdiff_t) n_points) {
+                points = (WD_POINT*) malloc(n_points * sizeof(WD_POINT));
+                if(points == NULL) {
+                    fprintf(stderr, "wdreplay: out of memory\n");
+                    exit(1);
+                }
+                for(i = 0; i < n_points; i++) {
+                    points[i].x = rd_f(r);
+                    points[i].y = rd_f(r);
+                }
+            }
+            if(a != NULL  &&  points != NULL) {
+                if(op == WD_CAP_ADDBEZIERS)
+                    CALL(wdAddBeziers((WD_PATHSINK*) a, points, (UINT) len));
+                else
+                    CALL(wdAddLines((WD_PATHSINK*) a, points, (UINT) len));
+            }
+            free(points);
+            break;
+        }
+
+        case WD_CAP_CREATEFONT:
+        {
+            LOGFONTW lf;
+
+            memset(&lf, 0, sizeof(LOGFONTW));
+            slot = rd_h_new(r);
+            lf.lfHeight = rd_i(r);
+            lf.lfWidth = rd_i(r);
+            lf.lfEscapement = rd_i(r);
+            lf.lfOrientation = rd_i(r);
+            lf.lfWeight = rd_i(r);
+            lf.lfItalic = (BYTE) rd_u(r);
+            lf.lfUnderline = (BYTE) rd_u(r);
+            lf.lfStrikeOut = (BYTE) rd_u(r);
+            lf.lfCharSet = (BYTE) rd_u(r);
+            lf.lfOutPrecision = (BYTE) rd_u(r);
+            lf.lfClipPrecision = (BYTE) rd_u(r);
+            lf.lfQuality = (BYTE) rd_u(r);
+            lf.lfPitchAndFamily = (BYTE) rd_u(r);
+            str = rd_s(r, &len);
+            len = WD_MIN(len, LF_FACESIZE - 1);
+            memcpy(lf.lfFaceName, str, len * sizeof(WCHAR));
+            NEW(slot, op, wdCreateFont(&lf));
+            break;
+        }
+
+        case WD_CAP_FONTMETRICS:
+        {
+            WD_FONTMETRICS metrics;
+
+            a = rd_h(r);
+            if(a != NULL)
+                CALL(wdFontMetrics((WD_HFONT) a, &metrics));
+            break;
+        }
+
+        case WD_CAP_DRAWELLIPSEARC:
+        case WD_CAP_DRAWELLIPSEPIE:
+            a = rd_h(r);
+            b = rd_h(r);
+            for(i = 0; i < 7; i++)
+                f[i] = rd_f(r);
+            c = rd_h(r);
+            if(a == NULL  ||  b == NULL)
+                break;
+            if(op == WD_CAP_DRAWELLIPSEARC) {
+                CALL(wdDrawEllipseArcStyled((WD_HCANVAS) a, (WD_HBRUSH) b,
+                        f[0], f[1], f[2], f[3], f[4], f[5], f[6], (WD_HSTROKESTYLE) c));
+            } else {
+                CALL(wdDrawEllipsePieStyled((WD_HCANVAS) a, (WD_HBRUSH) b,
+                        f[0], f[1], f[2], f[3], f[4], f[5], f[6], (WD_HSTROKESTYLE) c));
+            }
+            break;
+
+        case WD_CAP_DRAWELLIPSE:
+        case WD_CAP_DRAWLINE:
+        case WD_CAP_DRAWRECT:
+            a = rd_h(r);
+            b = rd_h(r);
+            for(i = 0; i < 5; i++)
+                f[i] = rd_f(r);
+            c = rd_h(r);
+            if(a == NULL  ||  b == NULL)
+                break;
+            if(op == WD_CAP_DRAWELLIPSE) {
+                CALL(wdDrawEllipseStyled((WD_HCANVAS) a, (WD_HBRUSH) b,
+                        f[0], f[1], f[2], f[3], f[4], (WD_HSTROKESTYLE) c));
+            } else if(op == WD_CAP_DRAWLINE) {
+                CALL(wdDrawLineStyled((WD_HCANVAS) a, (WD_HBRUSH) b,
+                        f[0], f[1], f[2], f[3], f[4], (WD_HSTROKESTYLE) c));
+            } else {
+                CALL(wdDrawRectStyled((WD_HCANVAS) a, (WD_HBRUSH) b,
+                        f[0], f[1], f[2], f[3], f[4], (WD_HSTROKESTYLE) c));
+            }
+            break;
+
+        case WD_CAP_DRAWPATH:
+            a = rd_h(r);
+            b = rd_h(r);
+            c = rd_h(r);
+            f[0] = rd_f(r);
+            d = rd_h(r);
+            if(a != NULL  &&  b != NULL  &&  c != NULL) {
+                CALL(wdDrawPathStyled((WD_HCANVAS) a, (WD_HBRUSH) b, (WD_HPATH) c,
+                        f[0], (WD_HSTROKESTYLE) d));
+            }
+            break;
+
+        case WD_CAP_FILLELLIPSE:
+        case WD_CAP_FILLRECT:
+            a = rd_h(r);
+            b = rd_h(r);
+            for(i = 0; i < 4; i++)
+                f[i] = rd_f(r);
+            if(a == NULL  ||  b == NULL)
+                break;
+            if(op == WD_CAP_FILLELLIPSE)
+                CALL(wdFillEllipse((WD_HCANVAS) a, (WD_HBRUSH) b, f[0], f[1], f[2], f[3]));
+            else
+                CALL(wdFillRect((WD_HCANVAS) a, (WD_HBRUSH) b, f[0], f[1], f[2], f[3]));
+            break;
+
+        case WD_CAP_FILLELLIPSEPIE:
+            a = rd_h(r);
+            b = rd_h(r);
+            for(i = 0; i < 6; i++)
+                f[i] = rd_f(r);
+            if(a != NULL  &&  b != NULL) {
+                CALL(wdFillEllipsePie((WD_HCANVAS) a, (WD_HBRUSH) b,
+                        f[0], f[1], f[2], f[3], f[4], f[5]));
+            }
+            break;
+
+        case WD_CAP_FILLPATH:
+            a = rd_h(r);
+            b = rd_h(r);
+            c = rd_h(r);
+            if(a != NULL  &&  b != NULL  &&  c != NULL)
+                CALL(wdFillPath((WD_HCANVAS) a, (WD_HBRUSH) b, (WD_HPATH) c));
+            break;
+
+        case WD_CAP_FILLREALIZEDPATH:
+            a = rd_h(r);
+            b = rd_h(r);
+            c = rd_h(r);
+            if(a != NULL  &&  b != NULL  &&  c != NULL)
+                CALL(wdFillRealizedPath((WD_HCANVAS) a, (WD_HBRUSH) b, (WD_HREALIZEDFILL) c));
+            break;
+
+        case WD_CAP_BITBLTIMAGE:
+            a = rd_h(r);
+            b = rd_h(r);
+            pr = rd_rect_opt(r, &rect);
+            pr2 = rd_rect_opt(r, &rect2);
+            if(a != NULL  &&  b != NULL  &&  pr != NULL)
+                CALL(wdBitBltImage((WD_HCANVAS) a, (WD_HIMAGE) b, pr, pr2));
+            break;
+
+        case WD_CAP_BITBLTCACHEDIMAGE:
+            a = rd_h(r);
+            b = rd_h(r);
+            f[0] = rd_f(r);
+            f[1] = rd_f(r);
+            if(a != NULL  &&  b != NULL)
+                CALL(wdBitBltCachedImage((WD_HCANVAS) a, (WD_HCACHEDIMAGE) b, f[0], f[1]));
+            break;
+
+        case WD_CAP_BITBLTHICON:
+            n_skipped++;
+            break;
+
+        case WD_CAP_DRAWSTRING:
+            a = rd_h(r);
+            b = rd_h(r);
+            rd_rect(r, &rect);
+            str = rd_s(r, &len);
+            c = rd_h(r);
+            u[0] = rd_u(r);
+            if(a != NULL  &&  b != NULL  &&  c != NULL) {
+                CALL(wdDrawString((WD_HCANVAS) a, (WD_HFONT) b, &rect,
+                        str, len, (WD_HBRUSH) c, u[0]));
+            }
+            break;
+
+        case WD_CAP_MEASURESTRING:
+            a = rd_h(r);
+            b = rd_h(r);
+            rd_rect(r, &rect);
+            str = rd_s(r, &len);
+            u[0] = rd_u(r);
+            if(a != NULL  &&  b != NULL) {
+                CALL(wdMeasureString((WD_HCANVAS) a, (WD_HFONT) b, &rect,
+                        str, len, &rect2, u[0]));
+            }
+            break;
+
+        case WD_CAP_ADDDIRTYRECT:
+        {
+            RECT rc;
+
+            a = rd_h(r);
+            rc.left = rd_i(r);
+            rc.top = rd_i(r);
+            rc.right = rd_i(r);
+            rc.bottom = rd_i(r);
+            if(a != NULL)
+                CALL(wdAddDirtyRect((WD_HCANVAS) a, &rc));
+            break;
+        }
+
+        case WD_CAP_SETDIRTYREGION:
+        {
+            RECT* rects = NULL;
+
+            a = rd_h(r);
+            len = (int) rd_u(r);
+            if(len > 0  &&  r->end - r->pos >= 4 * (ptrdiff_t) len) {
+                rects = (RECT*) malloc(len * sizeof(RECT));
+                if(rects == NULL) {
+                    fprintf(stderr, "wdreplay: out of memory\n");
+                    exit(1);
+                }
+                for(i = 0; i < len; i++) {
+                    rects[i].left = rd_i(r);
+                    rects[i].top = rd_i(r);
+                    rects[i].right = rd_i(r);
+                    rects[i].bottom = rd_i(r);
+                }
+            }
+            if(a != NULL)
+                CALL(wdSetDirtyRegion((WD_HCANVAS) a, rects, (rects != NULL ? (UINT) len : 0)));
+            free(rects);
+            break;
+        }
+
+        case WD_CAP_REBINDCANVAS:
+        {
+            RECT area = { 0, 0, 0, 0 };
+            HDC screen_dc;
+            HBITMAP bmp;
+            int x, y;
+
+            obj = rd_obj(r);
+            x = rd_i(r);
+            y = rd_i(r);
+            area.right = rd_i(r) - x;
+            area.bottom = rd_i(r) - y;
+            if(obj == NULL  ||  obj->dc == NULL)
+                break;
+
+            /* Give the canvas a new target of the recorded size. */
+            screen_dc = GetDC(NULL);
+            bmp = CreateCompatibleBitmap(screen_dc,
+                        WD_MAX(area.right, 1), WD_MAX(area.bottom, 1));
+            ReleaseDC(NULL, screen_dc);
+            SelectObject(obj->dc, bmp);
+            DeleteObject(obj->bmp);
+            obj->bmp = bmp;
+
+            CALL(wdRebindCanvasToHDC((WD_HCANVAS) obj->handle, obj->dc, &area));
+            break;
+        }
+
+        case WD_CAP_DRAWRECTS:
+        case WD_CAP_DRAWLINES:
+        case WD_CAP_DRAWPOLYLINE:
+        case WD_CAP_DRAWPOLYLINEDECIMATED:
+        case WD_CAP_FILLRECTS:
+        case WD_CAP_FILLELLIPSES:
+        {
+            /* The items are all made of floats: 4 per rect, line or ellipse,
+             * 2 per point of the polyline. */
+            int item_floats = (op == WD_CAP_DRAWPOLYLINE  ||
+                               op == WD_CAP_DRAWPOLYLINEDECIMATED) ? 2 : 4;
+            float* items = NULL;
+
+            a = rd_h(r);
+            b = rd_h(r);
+            len = (int) rd_u(r);
+            if(len > 0  &&  r->end - r->pos >= 4 * (ptrdiff_t) len * item_floats) {
+                items = (float*) malloc(len * item_floats * sizeof(float));
+                if(items == NULL) {
+                    fprintf(stderr, "wdreplay: out of memory\n");
+                    exit(1);
+                }
+                for(i = 0; i < len * item_floats; i++)
+                    items[i] = rd_f(r);
+            }
+            if(op == WD_CAP_DRAWPOLYLINEDECIMATED) {
+                f[0] = rd_f(r);
+                u[0] = rd_u(r);
+                c = NULL;
+            } else if(op != WD_CAP_FILLRECTS  &&  op != WD_CAP_FILLELLIPSES) {
+                f[0] = rd_f(r);
+                c = rd_h(r);
+            } else {
+                c = NULL;
+            }
+            if(a != NULL  &&  b != NULL  &&  items != NULL) {
+                switch(op) {
+                    case WD_CAP_DRAWRECTS:
+                        CALL(wdDrawRectsStyled((WD_HCANVAS) a, (WD_HBRUSH) b,
+                                (const WD_RECT*) items, (UINT) len, f[0], (WD_HSTROKESTYLE) c));
+                        break;
+                    case WD_CAP_DRAWLINES:
+                        CALL(wdDrawLinesStyled((WD_HCANVAS) a, (WD_HBRUSH) b,
+                                (const WD_POINT*) items, (UINT) len, f[0], (WD_HSTROKESTYLE) c));
+                        break;
+                    case WD_CAP_DRAWPOLYLINE:
+                        CALL(wdDrawPolylineStyled((WD_HCANVAS) a, (WD_HBRUSH) b,
+                                (const WD_POINT*) items, (UINT) len, f[0], (WD_HSTROKESTYLE) c));
+                        break;
+                    case WD_CAP_DRAWPOLYLINEDECIMATED:
+                        CALL(wdDrawPolylineDecimated((WD_HCANVAS) a, (WD_HBRUSH) b,
+                                (const WD_POINT*) items, (UINT) len, f[0], u[0]));
+                        break;
+                    case WD_CAP_FILLRECTS:
+                        CALL(wdFillRects((WD_HCANVAS) a, (WD_HBRUSH) b,
+                                (const WD_RECT*) items, (UINT) len));
+                        break;
+                    case WD_CAP_FILLELLIPSES:
+                        CALL(wdFillEllipses((WD_HCANVAS) a, (WD_HBRUSH) b,
+                                (const WD_ELLIPSE*) items, (UINT) len));
+                        break;
+                }
+            }
+            free(items);
+            break;
+        }
+
+        default:
+            /* Unknown record (from a newer library version?). */
+            n_skipped++;
+            break;
+    }
+
+    if(timed) {
+        samples_add(&op_samples[op], (double) (t1.QuadPart - t0.QuadPart) *
+                    1e9 / (double) freq.QuadPart);
+    }
+}
+
+/* Replays the records; or, if collect_blobs is set, only collects the blobs.
+ * Returns 0 on success, -1 if the file is malformed. */
+static int
+replay_pass(const BYTE* data, size_t size, size_t header_size, BOOL collect_blobs)
+{
+    READER file = { data + header_size, data + size, FALSE };
+    UINT64 now_captured = 0;
+
+    while(file.pos < file.end) {
+        BYTE op = *file.pos++;
+        UINT64 dt = rd_varint(&file);
+        UINT64 len = rd_varint(&file);
+        READER payload;
+
+        if(file.bad  ||  len > (UINT64) (file.end - file.pos)) {
+            fprintf(stderr, "wdreplay: truncated record at offset %lu\n",
+                    (unsigned long) (file.pos - data));
+            return -1;
+        }
+        payload.pos = file.pos;
+        payload.end = file.pos + len;
+        payload.bad = FALSE;
+        file.pos += len;
+        now_captured += dt;
+
+        if(op == WD_CAP_BLOB) {
+            if(collect_blobs) {
+                UINT64 hash = rd_x(&payload);
+                if(!payload.bad)
+                    blob_add(hash, payload.pos, (size_t) (payload.end - payload.pos));
+            }
+            continue;
+        }
+
+        if(collect_blobs)
+            continue;
+
+        replay_record(op, now_captured, &payload);
+        if(payload.bad) {
+            fprintf(stderr, "wdreplay: malformed %s record\n",
+                    (op < WD_CAP_COUNT && op_names[op] != NULL) ? op_names[op] : "unknown");
+        }
+    }
+
+    return 0;
+}
+
+
+/****************
+ ***  Output  ***
+ ****************/
+
+static void
+print_results(const char* backend)
+{
+    UINT op;
+
+    for(op = 0; op < WD_CAP_COUNT; op++) {
+        SAMPLES* s = &op_samples[op];
+        double sum;
+
+        if(s->n == 0)
+            continue;
+
+        sum = samples_sort(s);
+        printf("{\"name\":\"%s\",\"backend\":\"%s\",\"calls\":%u,\"total_ms\":%.3f,"
+               "\"mean_ns\":%.1f,\"p50_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f}\n",
+               op_names[op], backend, s->n, sum / 1e6, sum / (double) s->n,
+               percentile(s, 50), percentile(s, 99), s->values[s->n - 1]);
+    }
+
+    if(frames_replayed.n > 0) {
+        double sum_captured = samples_sort(&frames_captured);
+        double sum_replayed = samples_sort(&frames_replayed);
+
+        printf("{\"name\":\"frame\",\"backend\":\"%s\",\"frames\":%u,"
+               "\"captured_mean_us\":%.1f,\"captured_p50_us\":%.1f,\"captured_p99_us\":%.1f,"
+               "\"replayed_mean_us\":%.1f,\"replayed_p50_us\":%.1f,\"replayed_p99_us\":%.1f}\n",
+               backend, frames_replayed.n,
+               sum_captured / (double) frames_captured.n,
+               percentile(&frames_captured, 50), percentile(&frames_captured, 99),
+               sum_replayed / (double) frames_replayed.n,
+               percentile(&frames_replayed, 50), percentile(&frames_replayed, 99));
+    }
+
+    fflush(stdout);
+}
+
+
+/**************
+ ***  Main  ***
+ **************/
+
+static BYTE*
+read_file(const char* path, size_t* p_size)
+{
+    FILE* f;
+    BYTE* data = NULL;
+    long size;
+
+    f = fopen(path, "rb");
+    if(f == NULL)
+        return NULL;
+
+    if(fseek(f, 0, SEEK_END) == 0  &&  (size = ftell(f)) >= 0  &&
+       fseek(f, 0, SEEK_SET) == 0)
+    {
+        data = (BYTE*) malloc(size > 0 ? size : 1);
+        if(data != NULL  &&  fread(data, 1, size, f) != (size_t) size) {
+            free(data);
+            data = NULL;
+        }
+        *p_size = (size_t) size;
+    }
+
+    fclose(f);
+    return data;
+}
+
+static void
+usage(void)
+{
+    fprintf(stderr, "Usage: wdreplay [--backend d2d|gdiplus|software|null] [--repeat N] FILE\n");
+    exit(2);
+}
+
+int
+main(int argc, char** argv)
+{
+    static const DWORD initFlags = WD_INIT_IMAGEAPI | WD_INIT_STRINGAPI;
+    const char* path = NULL;
+    const char* backend_name = NULL;
+    int backend;
+    UINT repeat = 1;
+    BYTE* data;
+    size_t size;
+    READER hdr;
+    UINT i;
+    int ret = 0;
+
+    for(i = 1; i < (UINT) argc; i++) {
+        if(strcmp(argv[i], "--backend") == 0  &&  i + 1 < (UINT) argc)
+            backend_name = argv[++i];
+        else if(strcmp(argv[i], "--repeat") == 0  &&  i + 1 < (UINT) argc)
+            repeat = (UINT) atoi(argv[++i]);
+        else if(argv[i][0] == '-'  ||  path != NULL)
+            usage();
+        else
+            path = argv[i];
+    }
+    if(path == NULL)
+        usage();
+    if(repeat < 1)
+        repeat = 1;
+
+    data = read_file(path, &size);
+    if(data == NULL) {
+        fprintf(stderr, "wdreplay: cannot read %s\n", path);
+        return 1;
+    }
+
+    hdr.pos = data + 8;
+    hdr.end = data + size;
+    hdr.bad = FALSE;
+    if(size < 8  ||  memcmp(data, WD_CAP_MAGIC, 8) != 0) {
+        fprintf(stderr, "wdreplay: %s is not a capture file\n", path);
+        return 1;
+    }
+    if(rd_u(&hdr) != WD_CAP_VERSION) {
+        fprintf(stderr, "wdreplay: unsupported version of the capture format\n");
+        return 1;
+    }
+    backend = (int) rd_u(&hdr);
+    if(hdr.bad) {
+        fprintf(stderr, "wdreplay: truncated header\n");
+        return 1;
+    }
+
+    if(backend_name != NULL) {
+        if(strcmp(backend_name, "d2d") == 0)
+            backend = WD_BACKEND_D2D;
+        else if(strcmp(backend_name, "gdiplus") == 0)
+            backend = WD_BACKEND_GDIPLUS;
+        else if(strcmp(backend_name, "software") == 0)
+            backend = WD_BACKEND_SOFTWARE;
+        else if(strcmp(backend_name, "null") == 0)
+            backend = WD_BACKEND_CUSTOM;
+        else
+            usage();
+    }
+    switch(backend) {
+        case WD_BACKEND_GDIPLUS:    backend_name = "gdiplus"; break;
+        case WD_BACKEND_SOFTWARE:   backend_name = "software"; break;
+        case WD_BACKEND_CUSTOM:     backend_name = "null"; break;
+        default:                    backend_name = "d2d"; break;
+    }
+
+    QueryPerformanceFrequency(&freq);
+
+    if(backend == WD_BACKEND_CUSTOM) {
+        if(!wdInitializeWithBackend(&null_backend_ops)) {
+            fprintf(stderr, "wdreplay: wdInitializeWithBackend() failed\n");
+            return 1;
+        }
+    } else if(backend == WD_BACKEND_SOFTWARE) {
+        wdPreInitialize(NULL, NULL, WD_USE_SOFTWARE);
+    } else {
+        wdPreInitialize(NULL, NULL,
+                (backend == WD_BACKEND_GDIPLUS ? WD_DISABLE_D2D : WD_DISABLE_GDIPLUS));
+    }
+    if(!wdInitialize(initFlags)) {
+        fprintf(stderr, "wdreplay: wdInitialize() failed for %s\n", backend_name);
+        return 1;
+    }
+
+    if(replay_pass(data, size, hdr.pos - data, TRUE) != 0) {
+        ret = 1;
+    } else {
+        for(i = 0; i < repeat; i++) {
+            if(replay_pass(data, size, hdr.pos - data, FALSE) != 0) {
+                ret = 1;
+                break;
+            }
+            objects_cleanup();
+        }
+    }
+
+    objects_cleanup();
+    wdTerminate(initFlags);
+    if(backend == WD_BACKEND_CUSTOM)
+        wdTerminate(WD_INIT_COREAPI);
+
+    print_results(backend_name);
+    if(n_skipped > 0)
+        fprintf(stderr, "wdreplay: %u records skipped\n", n_skipped);
+
+    free(blobs);
+    free(objects);
+    free(data);
+    return ret;
+}
@@ -44,14 +44,185 @@ extern "C" {
     #define WD_INLINE   static
 #endif
 
+
+/*********************
+ ***  Basic Types  ***
+ *********************/
+
+/* 32-bit integer type representing a color.
+ *
+ * The color is made of four 8-bit components: alpha, red, green and blue.
+ * Alpha ranges from fully transparent (0) to fully opaque (255).
+ */
+typedef DWORD WD_COLOR;
+
+#define WD_ARGB(a,r,g,b)                                                        \
+        ((((WD_COLOR)(a) & 0xff) << 24) | (((WD_COLOR)(r) & 0xff) << 16) |      \
+         (((WD_COLOR)(g) & 0xff) << 8)  | (((WD_COLOR)(b) & 0xff)))
+#define WD_RGB(r,g,b)       WD_ARGB(255, (r), (g), (b))
+
+#define WD_AVALUE(color)    (((WD_COLOR)(color) & 0xff000000U) >> 24)
+#define WD_RVALUE(color)    (((WD_COLOR)(color) & 0x00ff0000U) >> 16)
+#define WD_GVALUE(color)    (((WD_COLOR)(color) & 0x0000ff00U) >> 8)
+#define WD_BVALUE(color)    (((WD_COLOR)(color) & 0x000000ffU))
+
+typedef struct WD_POINT_tag WD_POINT;
+struct WD_POINT_tag {
+    float x;
+    float y;
+};
+
+typedef struct WD_RECT_tag WD_RECT;
+struct WD_RECT_tag {
+    float x0;
+    float y0;
+    float x1;
+    float y1;
+};
+
+typedef struct WD_ELLIPSE_tag WD_ELLIPSE;
+struct WD_ELLIPSE_tag {
+    float cx;
+    float cy;
+    float rx;
+    float ry;
+};
+
+/* Affine transformation. The point (x, y) is transformed into
+ * (x*m11 + y*m21 + dx, x*m12 + y*m22 + dy). */
+typedef struct WD_MATRIX_tag WD_MATRIX;
+struct WD_MATRIX_tag {
+    float m11;
+    float m12;
+    float m21;
+    float m22;
+    float dx;
+    float dy;
+};
+
+/* Opaque handles. */
+typedef struct WD_CANVAS_tag*       WD_HCANVAS;
+typedef struct WD_BRUSH_tag*        WD_HBRUSH;
+typedef struct WD_STROKESTYLE_tag*  WD_HSTROKESTYLE;
+typedef struct WD_PATH_tag*         WD_HPATH;
+typedef struct WD_FONT_tag*         WD_HFONT;
+typedef struct WD_IMAGE_tag*        WD_HIMAGE;
+typedef struct WD_CACHEDIMAGE_tag*  WD_HCACHEDIMAGE;
+typedef struct WD_DISPLAYLIST_tag*  WD_HDISPLAYLIST;
+typedef struct WD_SPATIALINDEX_tag* WD_HSPATIALINDEX;
+typedef struct WD_REALIZEDFILL_tag* WD_HREALIZEDFILL;
+
 /* Returns the current backend. 
  * Returns -1 if there is none.
  */
 #define WD_BACKEND_D2D          1
 #define WD_BACKEND_GDIPLUS      2
+#define WD_BACKEND_CUSTOM       3   /* See wdInitializeWithBackend(). */
+#define WD_BACKEND_SOFTWARE     4   /* Built-in software rasterizer. */
 
 int wdBackend(void);
 
+
+/********************************
+ ***  Library Initialization  ***
+ ********************************/
+
+/* Optional flags for wdPreInitialize().
+ *
+ * WD_DISABLE_D2D, WD_DISABLE_GDIPLUS: Prevent the library from using the
+ * respective back-end. When neither is available, wdInitialize() fails.
+ *
+ * WD_USE_SOFTWARE: Use the library's own software rasterizer
+ * (WD_BACKEND_SOFTWARE) instead of Direct2D or GDI+. (Not in the single
+ * back-end builds, where wdInitialize() then fails.) It paints everything except text: wdDrawString() does nothing and
+ * wdMeasureString() only estimates the extents. Images can only be created
+ * from raw buffers then.
+ *
+ * WD_D2D_MULTITHREADED: Create the Direct2D factory as multi-threaded. The
+ * factory then serializes itself internally and the lock provided to
+ * wdPreInitialize() is not taken around factory calls anymore.
+ *
+ * WD_D2D_PERTHREADFACTORY: Every thread gets its own single-threaded Direct2D
+ * factory (lazily created and kept in a thread-local storage). No locking is
+ * needed at all, but any resource (canvas, path, stroke style) can then only
+ * be used by the thread which has created it.
+ */
+#define WD_DISABLE_D2D              0x0001
+#define WD_DISABLE_GDIPLUS          0x0002
+#define WD_D2D_MULTITHREADED        0x0004
+#define WD_D2D_PERTHREADFACTORY     0x0008
+#define WD_USE_SOFTWARE             0x0010
+
+/* If the library is used by multiple threads, the application should call
+ * wdPreInitialize() before wdInitialize() and provide a lock which protects
+ * the shared state of the library (the Direct2D factory and the module
+ * reference counters).
+ */
+void wdPreInitialize(void (*fnLock)(void), void (*fnUnlock)(void), DWORD dwFlags);
+
+/* Flags for wdInitialize() and wdTerminate(). */
+#define WD_INIT_COREAPI             0x0000
+#define WD_INIT_IMAGEAPI            0x0001
+#define WD_INIT_STRINGAPI           0x0002
+#define WD_INIT_DRAWSTRINGAPI       WD_INIT_STRINGAPI
+
+BOOL wdInitialize(DWORD dwFlags);
+void wdTerminate(DWORD dwFlags);
+
+/* Statistics of the lock provided via wdPreInitialize(), collected for each
+ * place the library takes it. This allows to find out which API suffers the
+ * most from the lock contention when the library is used by many threads.
+ *
+ * Nothing is collected if no lock has been provided, or if the lock is not
+ * needed due to WD_D2D_MULTITHREADED or WD_D2D_PERTHREADFACTORY.
+ */
+#define WD_LOCKSITE_INIT                    0  /* wdInitialize(), wdTerminate() */
+#define WD_LOCKSITE_CREATEPATHGEOMETRY      1  /* wdCreatePath(), arcs, pies, polylines */
+#define WD_LOCKSITE_CREATESTROKESTYLE       2  /* wdCreateStrokeStyle() */
+#define WD_LOCKSITE_CREATEHWNDRENDERTARGET  3  /* wdCreateCanvasWithPaintStruct() */
+#define WD_LOCKSITE_CREATEDCRENDERTARGET    4  /* wdCreateCanvasWithHDC() */
+#define WD_LOCKSITE_GDIXPOOL                5  /* GDI+ canvas creation/destruction */
+#define WD_LOCKSITE_CANVASCACHE             6  /* WD_CANVAS_CACHED */
+#define WD_LOCKSITE_DISPLAYLIST             7  /* Resources kept by display lists */
+#define WD_LOCKSITE_COUNT                   8
+
+typedef struct WD_LOCKSTATS_tag WD_LOCKSTATS;
+struct WD_LOCKSTATS_tag {
+    UINT64 uAcquisitions;       /* How many times the lock has been taken. */
+    UINT64 uWaitMicroseconds;   /* Total time spent waiting for the lock. */
+};
+
+void wdGetLockStats(UINT uSite, WD_LOCKSTATS* pStats);
+void wdResetLockStats(void);
+
+/* Event tracing. When enabled, each thread records begin/end events of the
+ * painting functions and of the expensive back-end calls into its own ring
+ * buffer (only the last few thousand events per thread are kept).
+ * wdDumpTrace() writes them in the Chrome trace event format, so they can be
+ * viewed in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Tracing is disabled by default. When disabled, it costs a single branch
+ * per event.
+ */
+void wdEnableTrace(BOOL bEnable);
+void wdResetTrace(void);
+BOOL wdDumpTrace(const WCHAR* pszPath);
+
+/* API capture. While capturing, every call to the public functions which
+ * create, destroy or modify objects, or which paint or measure, is
+ * serialized with its arguments into the given binary file. Image pixels
+ * (or the encoded image files) are stored once per content and referred to
+ * by a content hash. Objects created before the capture has started are
+ * recorded as NULL, so the capture should be started before the application
+ * creates its resources.
+ *
+ * The file can be re-executed with the wdreplay tool (see bench/), which
+ * reports timing of each call and of each painted frame.
+ */
+BOOL wdStartCapture(const WCHAR* pszPath);
+BOOL wdStopCapture(void);
+
+
 /***************************
  ***  Canvas Management  ***
  ***************************/
@@ -62,7 +233,9 @@ int wdBackend(void);
  *
  * WD_CANVAS_DOUBLEBUFFER: Enforces double-buffering. Note that Direct2D is
  * implicitly double-buffering so this option actually changes only behavior
- * of the GDI+ back-end.
+ * of the GDI+ back-end. The back buffers are recycled from canvas to canvas.
+ * (With WD_CANVAS_CACHED, canvases of wdCreateCanvasWithPaintStruct() get one
+ * of the client area size, so they may be cached; see wdEndPaint().)
  *
  * WD_CANVAS_NOGDICOMPAT: Disables GDI compatibility of the canvas. The canvas
  * can save some work at the cost the application cannot safely call
@@ -72,15 +245,48 @@ int wdBackend(void);
  * origin in the left top corner of the device context or window it is created
  * for. However with this flag the canvas shall have origin located in right
  * top corner and the x-coordinate shall grow to the left from it.
+ *
+ * WD_CANVAS_CULLING: Drawing and filling functions, wdBitBlt*() and
+ * wdDrawString() check bounds of the painted primitive against the clipping
+ * and the canvas area, and return early if it cannot be visible. This saves
+ * the per-call cost of the back-end for scenes with many invisible shapes.
+ * (Paths are never culled as their bounds are not known.)
+ *
+ * WD_CANVAS_CACHED: Only for wdCreateCanvasWithPaintStruct(). The library
+ * keeps the canvas of each window after wdDestroyCanvas() and hands it out
+ * again on the next WM_PAINT, resized to the client area if needed. It is
+ * really destroyed only if its wdEndPaint() fails (e.g. the Direct2D target
+ * has to be recreated), when the window is destroyed, or by wdTerminate().
+ * (The library subclasses the window with SetWindowSubclass() to see its
+ * WM_NCDESTROY. When COMCTL32.DLL does not provide it, the canvas of a
+ * destroyed window is only destroyed by a later WM_PAINT of any cached
+ * window, or by wdTerminate().) Hence the application gets the benefits of caching (see wdEndPaint())
+ * while it creates and destroys the canvas in every WM_PAINT as usual. With
+ * the GDI+ back-end, this implies WD_CANVAS_DOUBLEBUFFER. It is ignored by
+ * custom back-ends.
  */
 #define WD_CANVAS_DOUBLEBUFFER      0x0001
 #define WD_CANVAS_NOGDICOMPAT       0x0002
 #define WD_CANVAS_LAYOUTRTL         0x0004
+#define WD_CANVAS_CULLING           0x0008
+#define WD_CANVAS_CACHED            0x0010
 
 WD_HCANVAS wdCreateCanvasWithPaintStruct(HWND hWnd, PAINTSTRUCT* pPS, DWORD dwFlags);
 WD_HCANVAS wdCreateCanvasWithHDC(HDC hDC, const RECT* pRect, DWORD dwFlags);
 void wdDestroyCanvas(WD_HCANVAS hCanvas);
 
+/* Creates a canvas painting directly into the caller-provided buffer of
+ * 32-bit pre-multiplied BGRA pixels (top-down, uStride bytes per row). The
+ * buffer must not be freed before the canvas is destroyed, and the canvas
+ * cannot be resized.
+ *
+ * Only supported by the software back-end (WD_BACKEND_SOFTWARE); returns
+ * NULL otherwise. Canvas flags other than WD_CANVAS_LAYOUTRTL and
+ * WD_CANVAS_CULLING are ignored.
+ */
+WD_HCANVAS wdCreateCanvasWithBuffer(void* pBits, UINT uWidth, UINT uHeight,
+                UINT uStride, DWORD dwFlags);
+
 /* All drawing, filling and bit-blitting operations to it should be only
  * performed between wdBeginPaint() and wdEndPaint() calls.
  *
@@ -94,10 +300,36 @@ void wdDestroyCanvas(WD_HCANVAS hCanvas);
  * The cached canvas retains all the contents; so on the next WM_PAINT,
  * the application can repaint only those arts of the canvas which need
  * to present something new/different.
+ *
+ * With the GDI+ back-end, only canvases created with WD_CANVAS_CACHED can be
+ * cached. They present the whole buffer unless told otherwise with
+ * wdAddDirtyRect().
  */
 void wdBeginPaint(WD_HCANVAS hCanvas);
 BOOL wdEndPaint(WD_HCANVAS hCanvas);
 
+/* Dirty rectangles. By default, wdEndPaint() presents everything painted
+ * (for GDI+ double-buffered canvases, the whole buffer). If only some parts
+ * of the canvas have been repainted, the application may tell so between
+ * wdBeginPaint() and wdEndPaint(), either by calling wdAddDirtyRect() for
+ * each of them, or by wdSetDirtyRegion() replacing any rectangles given so
+ * far. wdEndPaint() then presents only those rectangles and forgets them.
+ *
+ * The rectangles are in pixels of the canvas (mirrored with
+ * WD_CANVAS_LAYOUTRTL the same way as painting), unaffected by the world
+ * transformation. Painting itself is not clipped by them. Overlapping
+ * rectangles get merged, and too many are merged into fewer bigger ones.
+ * wdSetDirtyRegion() with uCount == 0 restores presenting everything.
+ *
+ * This is honored by GDI+ canvases with WD_CANVAS_DOUBLEBUFFER (only the
+ * rectangles are blitted), Direct2D canvases created with
+ * wdCreateCanvasWithHDC() (the DC is clipped while the target is copied to
+ * it) and the software back-end. ID2D1HwndRenderTarget (Direct2D canvases of
+ * wdCreateCanvasWithPaintStruct()) always presents the whole window.
+ */
+void wdAddDirtyRect(WD_HCANVAS hCanvas, const RECT* pRect);
+void wdSetDirtyRegion(WD_HCANVAS hCanvas, const RECT* pRects, UINT uCount);
+
 /* This is supposed to be called to resize cached canvas (see above), if it
  * needs to be resized, typically as a response to WM_SIZE message.
  *
@@ -105,6 +337,21 @@ BOOL wdEndPaint(WD_HCANVAS hCanvas);
  */
 BOOL wdResizeCanvas(WD_HCANVAS hCanvas, UINT uWidth, UINT uHeight);
 
+/* Binds a canvas created with wdCreateCanvasWithHDC() to another DC and
+ * rectangle, as if it has been created for them. Unlike creating a new
+ * canvas, this keeps the Direct2D render target, so brushes, cached images
+ * and other resources created with the canvas stay valid; with GDI+, the
+ * back buffer (if big enough), the pen and the string format are reused.
+ * This makes a single canvas cheap to use for many small DCs, e.g. for
+ * owner-drawn list items or when printing.
+ *
+ * It must not be called between wdBeginPaint() and wdEndPaint(). The
+ * transformation is kept, but the painted contents is not. Canvases of
+ * wdCreateCanvasWithPaintStruct() and wdCreateCanvasWithBuffer() cannot be
+ * rebound.
+ */
+BOOL wdRebindCanvasToHDC(WD_HCANVAS hCanvas, HDC hDC, const RECT* pRect);
+
 /* Unless you create the canvas with the WD_CANVAS_NOGDICOMPAT flag, you may
  * also use GDI to paint on it. To do so, call wdStartGdi() to acquire HDC.
  * When done, release the HDC with wdEndGdi(). (Note that between those two
@@ -121,6 +368,65 @@ void wdClear(WD_HCANVAS hCanvas, WD_COLOR color);
  * clipped at all. */
 void wdSetClip(WD_HCANVAS hCanvas, const WD_RECT* pRect, const WD_HPATH hPath);
 
+/* Clip stack. wdPushClipRect() and wdPushClipPath() intersect the current
+ * clipping with the given rectangle or path (and, for wdPushClipPath(), also
+ * with the optional pRect). wdPopClip() reverts the most recent push.
+ *
+ * The rectangle of wdPushClipRect() is required: with NULL, nothing gets
+ * pushed (so a following wdPopClip() reverts an older push).
+ *
+ * Pushing a rectangle is much cheaper than pushing a path, so prefer it
+ * whenever the clip is axis-aligned.
+ *
+ * wdSetClip() discards the whole stack, and then (unless both pRect and hPath
+ * are NULL) behaves as a single push. All pushes are discarded also by
+ * wdEndPaint().
+ */
+void wdPushClipRect(WD_HCANVAS hCanvas, const WD_RECT* pRect);
+void wdPushClipPath(WD_HCANVAS hCanvas, const WD_HPATH hPath, const WD_RECT* pRect);
+void wdPopClip(WD_HCANVAS hCanvas);
+
+/* Counters of WD_CANVAS_CULLING: How many painting calls have been tested,
+ * and how many of them have been skipped as invisible. */
+typedef struct WD_CULLSTATS_tag WD_CULLSTATS;
+struct WD_CULLSTATS_tag {
+    UINT uTested;
+    UINT uCulled;
+};
+
+void wdGetCullStats(WD_HCANVAS hCanvas, WD_CULLSTATS* pStats);
+void wdResetCullStats(WD_HCANVAS hCanvas);
+
+/* Per-canvas performance counters. They are always on. Batches (like
+ * wdFillRects()) count each of their items. */
+#define WD_PRIMITIVE_RECT           0   /* wdFillRect(), wdDrawRect() */
+#define WD_PRIMITIVE_ELLIPSE        1   /* wdFillEllipse(), wdDrawEllipse(), ... */
+#define WD_PRIMITIVE_PIE            2   /* wdFillEllipsePie(), wdDrawEllipseArc(), ... */
+#define WD_PRIMITIVE_LINE           3   /* wdDrawLine(), wdDrawPolyline() */
+#define WD_PRIMITIVE_PATH           4   /* wdFillPath(), wdDrawPath() */
+#define WD_PRIMITIVE_IMAGE          5   /* wdBitBltImage(), wdBitBltCachedImage(), ... */
+#define WD_PRIMITIVE_STRING         6   /* wdDrawString() */
+#define WD_PRIMITIVE_COUNT          7
+
+typedef struct WD_CANVAS_STATS_tag WD_CANVAS_STATS;
+struct WD_CANVAS_STATS_tag {
+    UINT uDrawCalls[WD_PRIMITIVE_COUNT];    /* Including the culled ones. */
+    UINT uCulledCalls;              /* See WD_CANVAS_CULLING. */
+    UINT uBitmapUploads;            /* Images uploaded to the GPU. */
+    UINT64 uBitmapUploadBytes;
+    UINT uGeometriesCreated;        /* Paths and arc/pie geometries. */
+    UINT uLayersCreated;            /* See wdPushClipPath(). */
+    UINT uTextLayoutsCreated;
+    UINT64 uLockAcquisitions;       /* See wdPreInitialize(). */
+    UINT64 uLockWaitMicroseconds;
+    UINT uPaintCount;               /* Number of wdBeginPaint()/wdEndPaint() pairs. */
+    UINT64 uBeginPaintMicroseconds; /* Time spent inside wdBeginPaint(). */
+    UINT64 uEndPaintMicroseconds;   /* Time spent inside wdEndPaint(). */
+};
+
+void wdGetCanvasStats(WD_HCANVAS hCanvas, WD_CANVAS_STATS* pStats);
+void wdResetCanvasStats(WD_HCANVAS hCanvas);
+
 /* The painting is by default measured in pixel units: 1.0f corresponds to
  * the pixel width or height, depending on the current axis.
  *
@@ -136,6 +442,19 @@ void wdTranslateWorld(WD_HCANVAS hCanvas, float dx, float dy);
 void wdTransformWorld(WD_HCANVAS hCanvas, const WD_MATRIX* pMatrix);
 void wdResetWorld(WD_HCANVAS hCanvas);
 
+/* Get or replace the current transformation as a whole. Passing NULL to
+ * wdSetWorldTransform() is the same as wdResetWorld(). */
+void wdGetWorldTransform(WD_HCANVAS hCanvas, WD_MATRIX* pMatrix);
+void wdSetWorldTransform(WD_HCANVAS hCanvas, const WD_MATRIX* pMatrix);
+
+/* wdSaveState() remembers the current transformation and the depth of the
+ * clip stack (see wdPushClipRect()). wdRestoreState() reverts both to what
+ * they were at the matching wdSaveState(). Calls may be nested; all saved
+ * states are discarded by wdEndPaint().
+ */
+void wdSaveState(WD_HCANVAS hCanvas);
+void wdRestoreState(WD_HCANVAS hCanvas);
+
 
 /**************************
  ***  Image Management  ***
@@ -249,6 +568,15 @@ WD_HSTROKESTYLE wdCreateStrokeStyle(UINT dashStyle, UINT lineCap, UINT lineJoin)
 WD_HSTROKESTYLE wdCreateStrokeStyleCustom(const float* dashes, UINT dashesCount, UINT lineCap, UINT lineJoin);
 void wdDestroyStrokeStyle(WD_HSTROKESTYLE hStrokeStyle);
 
+/* Miter joins longer than the miter limit (in the units of half the stroke
+ * width) get cut off. The functions above use WD_MITER_LIMIT, the default of
+ * D2D and GDI+; wdCreateStrokeStyleEx() is wdCreateStrokeStyleCustom() with
+ * the limit given explicitly (dashesCount may be zero for solid lines). */
+#define WD_MITER_LIMIT 10.0f
+
+WD_HSTROKESTYLE wdCreateStrokeStyleEx(const float* dashes, UINT dashesCount,
+                UINT lineCap, UINT lineJoin, float fMiterLimit);
+
 
 /*************************
  ***  Path Management  ***
@@ -279,6 +607,98 @@ void wdAddLine(WD_PATHSINK* pSink, float x, float y);
 void wdAddArc(WD_PATHSINK* pSink, float cx, float cy, float fSweepAngle);
 void wdAddBezier(WD_PATHSINK* pSink, float x0, float y0, float x1, float y1, float x2, float y2);
 
+/* Bulk variants of wdAddLine() and wdAddBezier(). wdAddLines() adds a line to
+ * each of the uCount points. wdAddBeziers() adds uCount Bezier curves, each
+ * described by three consecutive points of pPoints (i.e. 3 * uCount points
+ * in total) in the order of wdAddBezier() arguments. */
+void wdAddLines(WD_PATHSINK* pSink, const WD_POINT* pPoints, UINT uCount);
+void wdAddBeziers(WD_PATHSINK* pSink, const WD_POINT* pPoints, UINT uCount);
+
+/* Each path also keeps the commands it has been built from (with arcs turned
+ * into Bezier curves), so the functions below run on the CPU.
+ *
+ * wdGetPathBounds() gets the exact bounding box of the path. For an empty
+ * path, it returns FALSE and sets all the rectangle members to zero.
+ *
+ * wdClonePath() creates a copy of the path for the given canvas.
+ *
+ * wdTransformPath() applies the matrix to the path. It must not be called
+ * while a sink is open on the path. */
+BOOL wdGetPathBounds(WD_HPATH hPath, WD_RECT* pRect);
+WD_HPATH wdClonePath(WD_HCANVAS hCanvas, WD_HPATH hPath);
+BOOL wdTransformPath(WD_HPATH hPath, const WD_MATRIX* pMatrix);
+
+/* Hit testing (on the CPU as well). The point is in the coordinates of the
+ * path; curves are flattened with the tolerance of 0.25 of that unit.
+ *
+ * wdPathFillContainsPoint() tells whether the point is inside the path filled
+ * with the given rule (wdFillPath() uses WD_FILL_ALTERNATE).
+ *
+ * wdPathStrokeContainsPoint() tells whether the point is on the path stroked
+ * with the given width and style (which may be NULL).
+ *
+ * Both keep what they compute with the path, so hit testing the same path
+ * again and again (e.g. on every mouse move) is cheap. Hence they must not be
+ * called for the same path from multiple threads at once. */
+#define WD_FILL_ALTERNATE   0   /* Even-odd rule */
+#define WD_FILL_WINDING     1   /* Non-zero rule */
+
+BOOL wdPathFillContainsPoint(WD_HPATH hPath, float x, float y, UINT fillRule);
+BOOL wdPathStrokeContainsPoint(WD_HPATH hPath, float x, float y,
+            float fStrokeWidth, WD_HSTROKESTYLE hStrokeStyle);
+
+/* wdFlattenPath() approximates the curves and arcs of the path with straight
+ * segments which stay within fTolerance of them, and hands each figure over
+ * to the callback as a polyline. (A closed figure does not repeat its first
+ * point at the end unless the path does so.)
+ *
+ * If pMatrix is not NULL, the path is transformed by it before flattening,
+ * so the tolerance (and the points) are in the transformed space. With the
+ * canvas' world transformation, the segment count then follows how large
+ * the curves really are on the screen.
+ *
+ * The callback may return FALSE to stop the flattening, and wdFlattenPath()
+ * then returns FALSE as well, as it does on a failure. */
+typedef BOOL (*WD_FLATTENPATHCALLBACK)(void* pUserData, const WD_POINT* pPoints,
+            UINT uCount, BOOL bClosed);
+
+BOOL wdFlattenPath(WD_HPATH hPath, float fTolerance, const WD_MATRIX* pMatrix,
+            WD_FLATTENPATHCALLBACK fnCallback, void* pUserData);
+
+/* wdWidenPath() creates a new path (for the given canvas) whose fill covers
+ * what wdDrawPath() would paint with the given width and stroke style (which
+ * may be NULL), caps, joins and dashes included. Stroking stays expensive
+ * while filling is cheap, so a stroke which does not change can be widened
+ * once and then filled on every repaint.
+ *
+ * Curves and round caps and joins are approximated with straight segments
+ * within fTolerance (zero or less for the default of 0.25), in the units of
+ * the path. The outline consists of overlapping pieces: the new path is
+ * filled with the non-zero rule (use WD_FILL_WINDING when hit testing it).
+ * The computation does not depend on the back-end. */
+WD_HPATH wdWidenPath(WD_HCANVAS hCanvas, WD_HPATH hPath, float fStrokeWidth,
+            WD_HSTROKESTYLE hStrokeStyle, float fTolerance);
+
+/* wdRealizePathFill() does the expensive part of wdFillPath() once, for a
+ * complex path which is filled again and again (e.g. a map or a glyph outline
+ * painted on every frame). The curves are flattened for the current world
+ * transformation of the canvas, with the tolerance given in device pixels
+ * (zero or less for the default of 0.2, the tolerance wdFillPath() uses with
+ * the software back-end). With the software back-end, the coverage of all
+ * the pixels is computed as well.
+ *
+ * wdFillRealizedPath() then fills the realized path as wdFillPath() would.
+ * As long as the world transformation differs from the one at the time of
+ * the realization only by whole device pixels of translation, the software
+ * back-end just paints the kept coverage. Otherwise (and with the other
+ * back-ends always), the flattened path is filled, so under zoom the
+ * segments may become visible: realize the path again then.
+ *
+ * Like the path, the realized fill can only be used for the canvas it has
+ * been created for, and the path may be destroyed after the realization. */
+WD_HREALIZEDFILL wdRealizePathFill(WD_HCANVAS hCanvas, WD_HPATH hPath, float fTolerance);
+void wdDestroyRealizedFill(WD_HREALIZEDFILL hFill);
+
 /*************************
  ***  Font Management  ***
  *************************/
@@ -334,6 +754,54 @@ void wdDrawRectStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
                 float x0, float y0, float x1, float y1, float fStrokeWidth,
                 WD_HSTROKESTYLE hStrokeStyle);
 
+/* Batches: wdDrawRectsStyled() paints as many rectangles as wdDrawRectStyled()
+ * would, and wdDrawLinesStyled() uCount lines, each from pPoints[2*i] to
+ * pPoints[2*i+1]; but they pay the per-call overhead only once.
+ *
+ * wdDrawPolylineStyled() connects the uCount points with lines, using the
+ * stroke style's line join at the inner points (unlike wdDrawLinesStyled()).
+ */
+void wdDrawRectsStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
+                const WD_RECT* pRects, UINT uCount, float fStrokeWidth,
+                WD_HSTROKESTYLE hStrokeStyle);
+void wdDrawLinesStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
+                const WD_POINT* pPoints, UINT uCount, float fStrokeWidth,
+                WD_HSTROKESTYLE hStrokeStyle);
+void wdDrawPolylineStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
+                const WD_POINT* pPoints, UINT uCount, float fStrokeWidth,
+                WD_HSTROKESTYLE hStrokeStyle);
+
+/* wdDrawPolylineDecimated() paints a polyline with (many) more points than
+ * there are pixels on its way, e.g. a long time series, only through the
+ * points which make a difference on the screen with the current
+ * transformation:
+ *
+ * WD_DECIMATE_MINMAX keeps the first, the last, the lowest and the highest
+ * point of each run of points in the same column, a quarter of a pixel wide.
+ * As long as x does not go back, the lowest and the highest point painted in
+ * each column stay the same. With at most four points per pixel (in x),
+ * nothing changes at all. With more, the segments inside the columns differ
+ * and so do the anti-aliased pixels along them, often fully: Painting all the
+ * points darkens these pixels, as the coverage of the overlapping segments
+ * adds up, while the decimated polyline is about as close to the exact shape
+ * on average.
+ *
+ * WD_DECIMATE_RDP further drops the points which stay within a quarter of
+ * a pixel from the simplified polyline (Ramer-Douglas-Peucker), which also
+ * helps sparse but smooth data. The polyline moves by a quarter of a pixel
+ * at most, so a pixel changes by about a quarter of its intensity (64 of
+ * 255).
+ *
+ * If recorded into a display list, the polyline is decimated for the
+ * transformation the canvas has at the time of the recording.
+ */
+#define WD_DECIMATE_MINMAX      0
+#define WD_DECIMATE_RDP         1
+
+void wdDrawPolylineDecimated(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
+                const WD_POINT* pPoints, UINT uCount, float fStrokeWidth,
+                UINT uMode);
+
 WD_INLINE void wdDrawArcStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
                 float cx, float cy, float r,
                 float fBaseAngle, float fSweepAngle, float fStrokeWidth,
@@ -422,6 +890,24 @@ WD_INLINE void wdDrawRect(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
     wdDrawRectStyled(hCanvas, hBrush, x0, y0, x1, y1, fStrokeWidth, NULL);
 }
 
+WD_INLINE void wdDrawRects(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
+                const WD_RECT* pRects, UINT uCount, float fStrokeWidth)
+{
+    wdDrawRectsStyled(hCanvas, hBrush, pRects, uCount, fStrokeWidth, NULL);
+}
+
+WD_INLINE void wdDrawLines(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
+                const WD_POINT* pPoints, UINT uCount, float fStrokeWidth)
+{
+    wdDrawLinesStyled(hCanvas, hBrush, pPoints, uCount, fStrokeWidth, NULL);
+}
+
+WD_INLINE void wdDrawPolyline(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
+                const WD_POINT* pPoints, UINT uCount, float fStrokeWidth)
+{
+    wdDrawPolylineStyled(hCanvas, hBrush, pPoints, uCount, fStrokeWidth, NULL);
+}
+
 
 /*************************
  ***  Fill Operations  ***
@@ -433,9 +919,17 @@ void wdFillEllipsePie(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
                 float cx, float cy, float rx, float ry,
                 float fBaseAngle, float fSweepAngle);
 void wdFillPath(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, const WD_HPATH hPath);
+void wdFillRealizedPath(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, WD_HREALIZEDFILL hFill);
 void wdFillRect(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
                 float x0, float y0, float x1, float y1);
 
+/* Batches of wdFillRect() and wdFillEllipse() calls, paying the per-call
+ * overhead only once. */
+void wdFillRects(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
+                const WD_RECT* pRects, UINT uCount);
+void wdFillEllipses(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
+                const WD_ELLIPSE* pEllipses, UINT uCount);
+
 WD_INLINE void wdFillCircle(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
                 float cx, float cy, float r)
 {
@@ -520,6 +1014,258 @@ void wdMeasureString(WD_HCANVAS hCanvas, WD_HFONT hFont, const WD_RECT* pRect,
 float wdStringWidth(WD_HCANVAS hCanvas, WD_HFONT hFont, const WCHAR* pszText);
 float wdStringHeight(WD_HFONT hFont, const WCHAR* pszText);
 
+
+/***********************
+ ***  Display Lists  ***
+ ***********************/
+
+/* Between wdBeginRecording() and wdEndRecording(), the painting functions
+ * and the functions changing the clipping, the transformation or the saved
+ * state of the canvas do not do anything but append themselves to a display
+ * list. Any call to wdSetSolidBrushColor() made by the recording thread is
+ * recorded as well (and it also changes the color right away).
+ *
+ * wdReplay() then repeats the recorded calls on a canvas, with pMatrix (if
+ * not NULL) applied before the current transformation. wdResetWorld() and
+ * wdSetWorldTransform() in the list are relative to that. The clipping of
+ * the canvas stays in effect: wdSetClip() in the list only replaces what the
+ * list itself has pushed (and intersects with the clipping of the canvas),
+ * and wdPopClip() never pops more than that. The transformation and the clip
+ * stack are reverted when it returns, even if the list has not been
+ * balanced.
+ *
+ * Only one canvas may be recorded by a thread at a time. wdBeginRecording()
+ * fails if a recording is already in progress on the thread.
+ *
+ * The list keeps the brushes, paths, realized fills, images, cached images,
+ * fonts and stroke styles it uses: the application may destroy them any
+ * time, and they are really destroyed together with the last display list
+ * using them. (Still, wdSetSolidBrushColor() on a brush used by the list
+ * affects its replay.) Icons and the text of wdDrawString() are copied. All
+ * display lists have to be destroyed before wdTerminate().
+ *
+ * Also note the functions querying the canvas (like wdGetWorldTransform())
+ * are not affected by the recording, and they see the canvas as it is.
+ */
+BOOL wdBeginRecording(WD_HCANVAS hCanvas);
+WD_HDISPLAYLIST wdEndRecording(WD_HCANVAS hCanvas);
+void wdDestroyDisplayList(WD_HDISPLAYLIST hList);
+
+void wdReplay(WD_HCANVAS hCanvas, WD_HDISPLAYLIST hList, const WD_MATRIX* pMatrix);
+
+/*************************
+ ***  Spatial Indexes  ***
+ *************************/
+
+/* Spatial index keeps application-defined item IDs with their bounding
+ * rectangles (in world coordinates) and finds the items which may need
+ * painting or hit testing, without asking every one of them. It is pure
+ * in-memory structure: it needs no canvas and no initialized library.
+ *
+ * wdCreateSpatialIndex() builds the index from uCount items at once, which
+ * is much faster (and makes the index better) than inserting them one by
+ * one. Both pIds and pRects may be NULL if uCount is zero.
+ *
+ * The rectangles have to be finite: wdCreateSpatialIndex() returns NULL and
+ * wdInsertSpatialIndexItem() returns FALSE if any coordinate is infinite or
+ * NaN.
+ *
+ * wdRemoveSpatialIndexItem() has to be given the same rectangle as it has
+ * been inserted with. It returns FALSE if there is no such item. (IDs need
+ * not be unique; only one matching item is removed.)
+ *
+ * The queries write IDs of the items whose rectangle touches the point, the
+ * rectangle, or the area of the canvas which can be painted (respecting its
+ * clipping and transformation), respectively. They return the count of all
+ * such items, even if only first uMaxIds of them fit into pIds. The IDs are
+ * not in any particular order.
+ *
+ * Items inserted or removed since the index has been built are handled
+ * cheaply, and the index rebuilds itself during a query when they get too
+ * many. Hence no two functions may be called for the same index from
+ * multiple threads at once, not even the queries.
+ */
+WD_HSPATIALINDEX wdCreateSpatialIndex(const UINT* pIds, const WD_RECT* pRects, UINT uCount);
+void wdDestroySpatialIndex(WD_HSPATIALINDEX hIndex);
+
+BOOL wdInsertSpatialIndexItem(WD_HSPATIALINDEX hIndex, UINT uId, const WD_RECT* pRect);
+BOOL wdRemoveSpatialIndexItem(WD_HSPATIALINDEX hIndex, UINT uId, const WD_RECT* pRect);
+
+UINT wdQuerySpatialIndexPoint(WD_HSPATIALINDEX hIndex, float x, float y,
+            UINT* pIds, UINT uMaxIds);
+UINT wdQuerySpatialIndexRect(WD_HSPATIALINDEX hIndex, const WD_RECT* pRect,
+            UINT* pIds, UINT uMaxIds);
+UINT wdQuerySpatialIndexVisible(WD_HSPATIALINDEX hIndex, WD_HCANVAS hCanvas,
+            UINT* pIds, UINT uMaxIds);
+
+/*************************
+ ***  Custom Back-end  ***
+ *************************/
+
+/* Instead of Direct2D or GDI+, the library may paint through a table of
+ * functions provided by the application (e.g. a software rasterizer, or
+ * a recording or remote renderer). wdInitializeWithBackend() installs the
+ * table and initializes the library core; pair it with
+ * wdTerminate(WD_INIT_COREAPI). (The single back-end builds of the library
+ * do not support it: it always fails there.) The image and string APIs are then provided
+ * by the table too, so wdInitialize() with WD_INIT_IMAGEAPI or
+ * WD_INIT_STRINGAPI is accepted but does nothing more.
+ *
+ * The library still takes care of the world transformation, the state stack
+ * (wdSaveState()), culling and the statistics; every back-end object it gets
+ * or returns is an opaque pointer of the back-end's own. Unless stated
+ * otherwise, all members have to be set:
+ *
+ * fnInitialize, fnTerminate: Optional. Called when the core API gets first
+ * initialized and finally terminated.
+ *
+ * fnCreateCanvas: hDC is the DC the canvas is created for (may be NULL for
+ * canvases not bound to any DC).
+ *
+ * fnSetTransform: Sets the complete transformation matrix (including the
+ * mirroring of WD_CANVAS_LAYOUTRTL). Called only when it has changed since
+ * the last painting or clipping operation.
+ *
+ * fnPushClip: Intersects the current clip with the rectangle and/or the path
+ * (either may be NULL); fnPopClip() undoes the last fnPushClip().
+ *
+ * fnStartGdi, fnEndGdi: Optional. Without them, wdStartGdi() fails.
+ *
+ * fnCreateStrokeStyle: dashesCount is zero for solid lines. Dash and space
+ * lengths are in the units of the stroke width.
+ *
+ * fnAddArc: The arc starts at fBaseAngle (in degrees) on the circle with
+ * the center (cx, cy) and the radius r.
+ *
+ * fnCreateImage: Pixels are always 32-bit pre-multiplied BGRA, top-down.
+ *
+ * fnLoadImageFromFile, fnLoadImageFromIStream: Optional. Without them, the
+ * library can only create images from raw buffers.
+ *
+ * fnBitBltImage: pSourceRect is never NULL.
+ *
+ * fnMeasureString: pCanvas may be NULL.
+ *
+ * fnEndPaintRects: Optional. Called instead of fnEndPaint when only the
+ * given rectangles (in device pixels; possibly none) need to be presented
+ * (see wdAddDirtyRect()).
+ *
+ * fnRebindCanvas: Optional. Binds the canvas to another DC, possibly with
+ * a different size (see wdRebindCanvasToHDC()). Without it, canvases cannot
+ * be rebound.
+ *
+ * fnSetStrokeStyleMiterLimit: Optional. Called right after fnCreateStrokeStyle
+ * if the miter limit is not WD_MITER_LIMIT (see wdCreateStrokeStyleEx()).
+ *
+ * fnSetPathFillMode: Optional. Called right after fnCreatePath for paths to
+ * be filled with the non-zero rule (uFillMode is WD_FILL_WINDING; see
+ * wdWidenPath()). Without it, such paths get filled with the even-odd rule.
+ */
+typedef struct WD_BACKEND_OPS_tag WD_BACKEND_OPS;
+struct WD_BACKEND_OPS_tag {
+    UINT cbSize;    /* sizeof(WD_BACKEND_OPS) */
+
+    BOOL (*fnInitialize)(void);
+    void (*fnTerminate)(void);
+
+    /* Canvas */
+    void* (*fnCreateCanvas)(HDC hDC, UINT uWidth, UINT uHeight, DWORD dwFlags);
+    void (*fnDestroyCanvas)(void* pCanvas);
+    void (*fnBeginPaint)(void* pCanvas);
+    BOOL (*fnEndPaint)(void* pCanvas);
+    BOOL (*fnResizeCanvas)(void* pCanvas, UINT uWidth, UINT uHeight);
+    HDC (*fnStartGdi)(void* pCanvas, BOOL bKeepContents);
+    void (*fnEndGdi)(void* pCanvas, HDC hDC);
+    void (*fnClear)(void* pCanvas, WD_COLOR color);
+    void (*fnSetTransform)(void* pCanvas, const WD_MATRIX* pMatrix);
+    void (*fnPushClip)(void* pCanvas, const WD_RECT* pRect, void* pPath);
+    void (*fnPopClip)(void* pCanvas);
+
+    /* Brushes and stroke styles */
+    void* (*fnCreateSolidBrush)(void* pCanvas, WD_COLOR color);
+    void* (*fnCreateLinearGradientBrush)(void* pCanvas, float x0, float y0,
+                float x1, float y1, const WD_COLOR* colors, const float* offsets,
+                UINT numStops);
+    void* (*fnCreateRadialGradientBrush)(void* pCanvas, float cx, float cy,
+                float r, float fx, float fy, const WD_COLOR* colors,
+                const float* offsets, UINT numStops);
+    void (*fnDestroyBrush)(void* pBrush);
+    void (*fnSetSolidBrushColor)(void* pBrush, WD_COLOR color);
+    void* (*fnCreateStrokeStyle)(const float* dashes, UINT dashesCount,
+                UINT lineCap, UINT lineJoin);
+    void (*fnDestroyStrokeStyle)(void* pStrokeStyle);
+
+    /* Paths */
+    void* (*fnCreatePath)(void* pCanvas);
+    void (*fnDestroyPath)(void* pPath);
+    void* (*fnOpenPathSink)(void* pPath);
+    void (*fnClosePathSink)(void* pSink);
+    void (*fnBeginFigure)(void* pSink, float x, float y);
+    void (*fnEndFigure)(void* pSink, BOOL bCloseFigure);
+    void (*fnAddLine)(void* pSink, float x, float y);
+    void (*fnAddArc)(void* pSink, float cx, float cy, float r,
+                float fBaseAngle, float fSweepAngle);
+    void (*fnAddBezier)(void* pSink, float x0, float y0, float x1, float y1,
+                float x2, float y2);
+
+    /* Images */
+    void* (*fnCreateImage)(UINT uWidth, UINT uHeight, UINT uStride, const BYTE* pBits);
+    void* (*fnLoadImageFromFile)(const WCHAR* pszPath);
+    void* (*fnLoadImageFromIStream)(IStream* pStream);
+    void (*fnDestroyImage)(void* pImage);
+    void (*fnGetImageSize)(void* pImage, UINT* puWidth, UINT* puHeight);
+    void* (*fnCreateCachedImage)(void* pCanvas, void* pImage);
+    void (*fnDestroyCachedImage)(void* pCachedImage);
+
+    /* Fonts */
+    void* (*fnCreateFont)(const LOGFONTW* pLogFont);
+    void (*fnDestroyFont)(void* pFont);
+    void (*fnFontMetrics)(void* pFont, WD_FONTMETRICS* pMetrics);
+
+    /* Painting */
+    void (*fnDrawEllipseArc)(void* pCanvas, void* pBrush, float cx, float cy,
+                float rx, float ry, float fBaseAngle, float fSweepAngle,
+                float fStrokeWidth, void* pStrokeStyle);
+    void (*fnDrawEllipsePie)(void* pCanvas, void* pBrush, float cx, float cy,
+                float rx, float ry, float fBaseAngle, float fSweepAngle,
+                float fStrokeWidth, void* pStrokeStyle);
+    void (*fnDrawEllipse)(void* pCanvas, void* pBrush, float cx, float cy,
+                float rx, float ry, float fStrokeWidth, void* pStrokeStyle);
+    void (*fnDrawLine)(void* pCanvas, void* pBrush, float x0, float y0,
+                float x1, float y1, float fStrokeWidth, void* pStrokeStyle);
+    void (*fnDrawPath)(void* pCanvas, void* pBrush, void* pPath,
+                float fStrokeWidth, void* pStrokeStyle);
+    void (*fnDrawRect)(void* pCanvas, void* pBrush, float x0, float y0,
+                float x1, float y1, float fStrokeWidth, void* pStrokeStyle);
+    void (*fnFillEllipse)(void* pCanvas, void* pBrush, float cx, float cy,
+                float rx, float ry);
+    void (*fnFillEllipsePie)(void* pCanvas, void* pBrush, float cx, float cy,
+                float rx, float ry, float fBaseAngle, float fSweepAngle);
+    void (*fnFillPath)(void* pCanvas, void* pBrush, void* pPath);
+    void (*fnFillRect)(void* pCanvas, void* pBrush, float x0, float y0,
+                float x1, float y1);
+    void (*fnBitBltImage)(void* pCanvas, void* pImage, const WD_RECT* pDestRect,
+                const WD_RECT* pSourceRect);
+    void (*fnBitBltCachedImage)(void* pCanvas, void* pCachedImage, float x, float y);
+    void (*fnDrawString)(void* pCanvas, void* pFont, const WD_RECT* pRect,
+                const WCHAR* pszText, int iTextLength, void* pBrush, DWORD dwFlags);
+    void (*fnMeasureString)(void* pCanvas, void* pFont, const WD_RECT* pRect,
+                const WCHAR* pszText, int iTextLength, WD_RECT* pResult,
+                DWORD dwFlags);
+
+    /* Presentation */
+    BOOL (*fnEndPaintRects)(void* pCanvas, const RECT* pRects, UINT uCount);
+
+    /* Rebinding */
+    BOOL (*fnRebindCanvas)(void* pCanvas, HDC hDC, UINT uWidth, UINT uHeight);
+
+    /* Miter limits and fill modes */
+    void (*fnSetStrokeStyleMiterLimit)(void* pStrokeStyle, float fMiterLimit);
+    void (*fnSetPathFillMode)(void* pPath, UINT uFillMode);
+};
+
+BOOL wdInitializeWithBackend(const WD_BACKEND_OPS* pOps);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
@@ -1,8 +1,550 @@
 #include "backend-d2d.h"
 #include "lock.h"
 
+
+static HMODULE d2d_dll = NULL;
+
+static HRESULT (WINAPI* d2d_CreateFactory)(dummy_D2D1_FACTORY_TYPE, REFIID,
+            const dummy_D2D1_FACTORY_OPTIONS*, void**) = NULL;
+
+dummy_ID2D1Factory* d2d_factory = NULL;
+int d2d_factory_mode = D2D_FACTORYMODE_SHARED;
+
+/* For D2D_FACTORYMODE_PERTHREAD: TLS slot holding the factory of the current
+ * thread, and a list of all such factories so d2d_fini() can release them. */
+typedef struct d2d_thread_factory_tag d2d_thread_factory_t;
+struct d2d_thread_factory_tag {
+    dummy_ID2D1Factory* factory;
+    d2d_thread_factory_t* next;
+};
+
+static DWORD d2d_tls_index = TLS_OUT_OF_INDEXES;
+static CRITICAL_SECTION d2d_thread_factories_lock;
+static d2d_thread_factory_t* d2d_thread_factories = NULL;
+
+
+static HRESULT
+d2d_create_factory(dummy_D2D1_FACTORY_TYPE type, dummy_ID2D1Factory** p_factory)
+{
+    static const dummy_D2D1_FACTORY_OPTIONS factory_options = { dummy_D2D1_DEBUG_LEVEL_NONE };
+
+    return d2d_CreateFactory(type, &dummy_IID_ID2D1Factory,
+                &factory_options, (void**) p_factory);
+}
+
+int
+d2d_init(DWORD preinit_flags)
+{
+    dummy_D2D1_FACTORY_TYPE factory_type;
+    HRESULT hr;
+
+    d2d_dll = wd_load_system_dll(_T("D2D1.DLL"));
+    if(d2d_dll == NULL) {
+        WD_TRACE_ERR("d2d_init: wd_load_system_dll(D2D1.DLL) failed.");
+        goto err_LoadLibrary;
+    }
+
+    d2d_CreateFactory = (HRESULT (WINAPI*)(dummy_D2D1_FACTORY_TYPE, REFIID,
+                                const dummy_D2D1_FACTORY_OPTIONS*, void**))
+                GetProcAddress(d2d_dll, "D2D1CreateFactory");
+    if(d2d_CreateFactory == NULL) {
+        WD_TRACE_ERR("d2d_init: GetProcAddress(D2D1CreateFactory) failed.");
+        goto err_GetProcAddress;
+    }
+
+    if(preinit_flags & WD_D2D_PERTHREADFACTORY) {
+        d2d_tls_index = TlsAlloc();
+        if(d2d_tls_index == TLS_OUT_OF_INDEXES) {
+            WD_TRACE_ERR("d2d_init: TlsAlloc() failed.");
+            goto err_TlsAlloc;
+        }
+        InitializeCriticalSection(&d2d_thread_factories_lock);
+        d2d_factory_mode = D2D_FACTORYMODE_PERTHREAD;
+    } else if(preinit_flags & WD_D2D_MULTITHREADED) {
+        d2d_factory_mode = D2D_FACTORYMODE_MULTITHREADED;
+    } else {
+        d2d_factory_mode = D2D_FACTORYMODE_SHARED;
+    }
+
+    /* In D2D_FACTORYMODE_SHARED, we use a single-threaded factory, and
+     * serialize all its calls with wd_lock(); resources created from it are
+     * used only by the thread which owns the canvas anyway.
+     *
+     * In D2D_FACTORYMODE_PERTHREAD, the global factory is only a fallback
+     * for threads which fail to get their own one; and as such it may be
+     * used by many threads at once, so it has to be multi-threaded. */
+    if(d2d_factory_mode == D2D_FACTORYMODE_SHARED)
+        factory_type = dummy_D2D1_FACTORY_TYPE_SINGLE_THREADED;
+    else
+        factory_type = dummy_D2D1_FACTORY_TYPE_MULTI_THREADED;
+
+    hr = d2d_create_factory(factory_type, &d2d_factory);
+    if(FAILED(hr)) {
+        WD_TRACE_HR("d2d_init: D2D1CreateFactory() failed.");
+        goto err_CreateFactory;
+    }
+
+    /* Success */
+    return 0;
+
+    /* Error path */
+err_CreateFactory:
+    if(d2d_factory_mode == D2D_FACTORYMODE_PERTHREAD) {
+        DeleteCriticalSection(&d2d_thread_factories_lock);
+        TlsFree(d2d_tls_index);
+        d2d_tls_index = TLS_OUT_OF_INDEXES;
+    }
+err_TlsAlloc:
+    d2d_factory_mode = D2D_FACTORYMODE_SHARED;
+err_GetProcAddress:
+    FreeLibrary(d2d_dll);
+    d2d_dll = NULL;
+err_LoadLibrary:
+    return -1;
+}
+
+void
+d2d_fini(void)
+{
+    if(d2d_factory_mode == D2D_FACTORYMODE_PERTHREAD) {
+        while(d2d_thread_factories != NULL) {
+            d2d_thread_factory_t* tf = d2d_thread_factories;
+
+            d2d_thread_factories = tf->next;
+            dummy_ID2D1Factory_Release(tf->factory);
+            free(tf);
+        }
+
+        DeleteCriticalSection(&d2d_thread_factories_lock);
+        TlsFree(d2d_tls_index);
+        d2d_tls_index = TLS_OUT_OF_INDEXES;
+    }
+
+    dummy_ID2D1Factory_Release(d2d_factory);
+    d2d_factory = NULL;
+    d2d_factory_mode = D2D_FACTORYMODE_SHARED;
+
+    FreeLibrary(d2d_dll);
+    d2d_dll = NULL;
+}
+
+dummy_ID2D1Factory*
+d2d_thread_factory(void)
+{
+    d2d_thread_factory_t* tf;
+    HRESULT hr;
+
+    tf = (d2d_thread_factory_t*) TlsGetValue(d2d_tls_index);
+    if(tf != NULL)
+        return tf->factory;
+
+    tf = (d2d_thread_factory_t*) malloc(sizeof(d2d_thread_factory_t));
+    if(tf == NULL) {
+        WD_TRACE("d2d_thread_factory: malloc() failed.");
+        return d2d_factory;
+    }
+
+    hr = d2d_create_factory(dummy_D2D1_FACTORY_TYPE_SINGLE_THREADED, &tf->factory);
+    if(FAILED(hr)) {
+        WD_TRACE_HR("d2d_thread_factory: D2D1CreateFactory() failed.");
+        free(tf);
+        return d2d_factory;
+    }
+
+    /* Note the factory lives until d2d_fini(), even if the thread exits
+     * sooner: Resources created by the thread may still be alive. */
+    EnterCriticalSection(&d2d_thread_factories_lock);
+    tf->next = d2d_thread_factories;
+    d2d_thread_factories = tf;
+    LeaveCriticalSection(&d2d_thread_factories_lock);
+
+    TlsSetValue(d2d_tls_index, tf);
+    return tf->factory;
+}
+
+void
+d2d_init_color(dummy_D2D1_COLOR_F* c, WD_COLOR color)
+{
+    c->r = WD_RVALUE(color) / 255.0f;
+    c->g = WD_GVALUE(color) / 255.0f;
+    c->b = WD_BVALUE(color) / 255.0f;
+    c->a = WD_AVALUE(color) / 255.0f;
+}
+
+void
+d2d_matrix_mult(dummy_D2D1_MATRIX_3X2_F* res,
+                const dummy_D2D1_MATRIX_3X2_F* a, const dummy_D2D1_MATRIX_3X2_F* b)
+{
+    res->_11 = a->_11 * b->_11 + a->_12 * b->_21;
+    res->_12 = a->_11 * b->_12 + a->_12 * b->_22;
+    res->_21 = a->_21 * b->_11 + a->_22 * b->_21;
+    res->_22 = a->_21 * b->_12 + a->_22 * b->_22;
+    res->_31 = a->_31 * b->_11 + a->_32 * b->_21 + b->_31;
+    res->_32 = a->_31 * b->_12 + a->_32 * b->_22 + b->_32;
+}
+
+d2d_canvas_t*
+d2d_canvas_alloc(dummy_ID2D1RenderTarget* target, WORD type,
+                 UINT width, UINT height, DWORD flags)
+{
+    d2d_canvas_t* c;
+
+    c = (d2d_canvas_t*) malloc(sizeof(d2d_canvas_t));
+    if(c == NULL) {
+        WD_TRACE("d2d_canvas_alloc: malloc() failed.");
+        return NULL;
+    }
+
+    memset(c, 0, sizeof(d2d_canvas_t));
+
+    c->type = type;
+    if(flags & WD_CANVAS_LAYOUTRTL)
+        c->flags |= D2D_CANVASFLAG_RTL;
+    if(flags & WD_CANVAS_CULLING)
+        c->flags |= D2D_CANVASFLAG_CULLING;
+    c->width = width;
+    c->height = height;
+    c->target = target;
+
+    /* We use raw pixels as units. D2D by default works with DIPs (1/96 per
+     * inch) so we just tell it the DPI is 96. */
+    dummy_ID2D1RenderTarget_SetDpi(c->target, 96.0f, 96.0f);
+
+    d2d_reset_transform(c);
+
+    return c;
+}
+
+void
+d2d_canvas_free(d2d_canvas_t* c)
+{
+    UINT i;
+
+    for(i = 0; i < c->layer_pool_count; i++)
+        dummy_ID2D1Layer_Release(c->layer_pool[i]);
+    free(c->layer_pool);
+    free(c->clip_stack);
+    free(c->state_stack);
+
+    dummy_ID2D1RenderTarget_Release(c->target);
+    free(c);
+}
+
+/* The base transformation maps our coordinates into the pixel grid of D2D:
+ * It shifts by D2D_BASEDELTA_X/Y (D2D puts pixel centers at half-integers)
+ * and, for WD_CANVAS_LAYOUTRTL, mirrors the X axis. */
+static void
+d2d_base_transform(d2d_canvas_t* c, dummy_D2D1_MATRIX_3X2_F* m, BOOL inverse)
+{
+    float s;
+    float tx;
+
+    if(c->flags & D2D_CANVASFLAG_RTL) {
+        s = -1.0f;
+        tx = (float) c->width - D2D_BASEDELTA_X;
+    } else {
+        s = 1.0f;
+        tx = D2D_BASEDELTA_X;
+    }
+
+    m->_11 = s;         m->_12 = 0.0f;
+    m->_21 = 0.0f;      m->_22 = 1.0f;
+    if(inverse) {
+        m->_31 = -s * tx;
+        m->_32 = -D2D_BASEDELTA_Y;
+    } else {
+        m->_31 = tx;
+        m->_32 = D2D_BASEDELTA_Y;
+    }
+}
+
+void
+d2d_reset_transform(d2d_canvas_t* c)
+{
+    d2d_base_transform(c, &c->matrix, FALSE);
+    c->flags |= D2D_CANVASFLAG_MATRIXDIRTY;
+}
+
+void
+d2d_apply_transform(d2d_canvas_t* c, const dummy_D2D1_MATRIX_3X2_F* matrix)
+{
+    dummy_D2D1_MATRIX_3X2_F old_matrix;
+
+    memcpy(&old_matrix, &c->matrix, sizeof(dummy_D2D1_MATRIX_3X2_F));
+    d2d_matrix_mult(&c->matrix, matrix, &old_matrix);
+    c->flags |= D2D_CANVASFLAG_MATRIXDIRTY;
+}
+
+void
+d2d_get_user_transform(d2d_canvas_t* c, dummy_D2D1_MATRIX_3X2_F* matrix)
+{
+    dummy_D2D1_MATRIX_3X2_F base_inv;
+
+    d2d_base_transform(c, &base_inv, TRUE);
+    d2d_matrix_mult(matrix, &c->matrix, &base_inv);
+}
+
+void
+d2d_set_user_transform(d2d_canvas_t* c, const dummy_D2D1_MATRIX_3X2_F* matrix)
+{
+    dummy_D2D1_MATRIX_3X2_F base;
+
+    d2d_base_transform(c, &base, FALSE);
+    d2d_matrix_mult(&c->matrix, matrix, &base);
+    c->flags |= D2D_CANVASFLAG_MATRIXDIRTY;
+}
+
+int
+d2d_save_state(d2d_canvas_t* c)
+{
+    d2d_state_t* state;
+
+    if(c->state_count >= c->state_capacity) {
+        UINT capacity = (c->state_capacity > 0 ? c->state_capacity * 2 : 4);
+        d2d_state_t* stack;
+
+        stack = (d2d_state_t*) realloc(c->state_stack, capacity * sizeof(d2d_state_t));
+        if(stack == NULL) {
+            WD_TRACE("d2d_save_state: realloc() failed.");
+            return -1;
+        }
+
+        c->state_stack = stack;
+        c->state_capacity = capacity;
+    }
+
+    state = &c->state_stack[c->state_count++];
+    memcpy(&state->matrix, &c->matrix, sizeof(dummy_D2D1_MATRIX_3X2_F));
+    state->clip_count = c->clip_count;
+    return 0;
+}
+
+void
+d2d_restore_state(d2d_canvas_t* c)
+{
+    d2d_state_t* state;
+
+    if(c->state_count == 0) {
+        WD_TRACE("d2d_restore_state: Logical error: State stack underflow.");
+        return;
+    }
+
+    state = &c->state_stack[--c->state_count];
+
+    /* Only compare, to not make the matrix dirty if nothing has changed. */
+    if(memcmp(&c->matrix, &state->matrix, sizeof(dummy_D2D1_MATRIX_3X2_F)) != 0) {
+        memcpy(&c->matrix, &state->matrix, sizeof(dummy_D2D1_MATRIX_3X2_F));
+        c->flags |= D2D_CANVASFLAG_MATRIXDIRTY;
+    }
+
+    while(c->clip_count > state->clip_count)
+        d2d_pop_clip(c);
+}
+
+void
+d2d_reset_state(d2d_canvas_t* c)
+{
+    c->state_count = 0;
+    d2d_reset_clip(c);
+}
+
 void
-d2d_disable_rtl_transform(d2d_canvas_t* c, dummy_D2D1_MATRIX_3X2_F* old_matrix)
+d2d_visible_bounds(d2d_canvas_t* c, WD_RECT* bounds)
+{
+    if(c->clip_count > 0) {
+        memcpy(bounds, &c->clip_stack[c->clip_count-1].bounds, sizeof(WD_RECT));
+    } else {
+        bounds->x0 = 0.0f;
+        bounds->y0 = 0.0f;
+        bounds->x1 = (float) c->width;
+        bounds->y1 = (float) c->height;
+    }
+}
+
+/* Computes bounds of the rectangle transformed by the current transformation,
+ * i.e. in the device space, and intersects them with the current clip. */
+static void
+d2d_clip_bounds(d2d_canvas_t* c, const WD_RECT* rect, WD_RECT* bounds)
+{
+    WD_RECT visible;
+    WD_RECT rect_bounds;
+
+    d2d_visible_bounds(c, &visible);
+    if(rect == NULL) {
+        memcpy(bounds, &visible, sizeof(WD_RECT));
+        return;
+    }
+
+    wd_bounds_transform((const WD_MATRIX*) &c->matrix, rect, &rect_bounds);
+    wd_bounds_intersect(bounds, &visible, &rect_bounds);
+}
+
+static d2d_clip_t*
+d2d_clip_stack_push(d2d_canvas_t* c)
+{
+    if(c->clip_count >= c->clip_capacity) {
+        UINT capacity = (c->clip_capacity > 0 ? c->clip_capacity * 2 : 4);
+        d2d_clip_t* stack;
+
+        stack = (d2d_clip_t*) realloc(c->clip_stack, capacity * sizeof(d2d_clip_t));
+        if(stack == NULL) {
+            WD_TRACE("d2d_clip_stack_push: realloc() failed.");
+            return NULL;
+        }
+
+        c->clip_stack = stack;
+        c->clip_capacity = capacity;
+    }
+
+    return &c->clip_stack[c->clip_count++];
+}
+
+static dummy_ID2D1Layer*
+d2d_get_layer(d2d_canvas_t* c)
+{
+    dummy_ID2D1Layer* layer;
+    HRESULT hr;
+
+    if(c->layer_pool_count > 0)
+        return c->layer_pool[--c->layer_pool_count];
+
+    WD_EVENT_BEGIN("ID2D1RenderTarget::CreateLayer");
+    hr = dummy_ID2D1RenderTarget_CreateLayer(c->target, NULL, &layer);
+    WD_EVENT_END("ID2D1RenderTarget::CreateLayer");
+    if(FAILED(hr)) {
+        WD_TRACE_HR("d2d_get_layer: ID2D1RenderTarget::CreateLayer() failed.");
+        return NULL;
+    }
+
+    c->stats.layers++;
+
+    return layer;
+}
+
+static void
+d2d_put_layer(d2d_canvas_t* c, dummy_ID2D1Layer* layer)
+{
+    if(c->layer_pool_count >= c->layer_pool_capacity) {
+        UINT capacity = (c->layer_pool_capacity > 0 ? c->layer_pool_capacity * 2 : 2);
+        dummy_ID2D1Layer** pool;
+
+        pool = (dummy_ID2D1Layer**) realloc(c->layer_pool, capacity * sizeof(dummy_ID2D1Layer*));
+        if(pool == NULL) {
+            WD_TRACE("d2d_put_layer: realloc() failed.");
+            dummy_ID2D1Layer_Release(layer);
+            return;
+        }
+
+        c->layer_pool = pool;
+        c->layer_pool_capacity = capacity;
+    }
+
+    c->layer_pool[c->layer_pool_count++] = layer;
+}
+
+int
+d2d_push_clip_rect(d2d_canvas_t* c, const WD_RECT* rect)
+{
+    d2d_clip_t* clip;
+    WD_RECT bounds;
+
+    /* A rectangle inside a rectangle (or inside anything) never needs a layer.
+     * D2D intersects nested axis-aligned clips on its own; we only track the
+     * intersection on CPU side so the effective clip bounds are known without
+     * asking the render target. */
+    d2d_clip_bounds(c, rect, &bounds);
+
+    clip = d2d_clip_stack_push(c);
+    if(clip == NULL)
+        return -1;
+
+    clip->layer = NULL;
+    memcpy(&clip->bounds, &bounds, sizeof(WD_RECT));
+    d2d_sync_transform(c);
+    dummy_ID2D1RenderTarget_PushAxisAlignedClip(c->target,
+            (const dummy_D2D1_RECT_F*) rect, dummy_D2D1_ANTIALIAS_MODE_PER_PRIMITIVE);
+    return 0;
+}
+
+int
+d2d_push_clip_path(d2d_canvas_t* c, dummy_ID2D1Geometry* geometry, const WD_RECT* rect)
+{
+    dummy_D2D1_LAYER_PARAMETERS layer_params;
+    dummy_ID2D1Layer* layer;
+    d2d_clip_t* clip;
+    WD_RECT bounds;
+
+    d2d_clip_bounds(c, rect, &bounds);
+
+    layer = d2d_get_layer(c);
+    if(layer == NULL)
+        return -1;
+
+    clip = d2d_clip_stack_push(c);
+    if(clip == NULL) {
+        d2d_put_layer(c, layer);
+        return -1;
+    }
+
+    clip->layer = layer;
+    memcpy(&clip->bounds, &bounds, sizeof(WD_RECT));
+
+    if(rect != NULL) {
+        layer_params.contentBounds.left = rect->x0;
+        layer_params.contentBounds.top = rect->y0;
+        layer_params.contentBounds.right = rect->x1;
+        layer_params.contentBounds.bottom = rect->y1;
+    } else {
+        layer_params.contentBounds.left = -FLT_MAX;
+        layer_params.contentBounds.top = -FLT_MAX;
+        layer_params.contentBounds.right = FLT_MAX;
+        layer_params.contentBounds.bottom = FLT_MAX;
+    }
+    layer_params.geometricMask = geometry;
+    layer_params.maskAntialiasMode = dummy_D2D1_ANTIALIAS_MODE_PER_PRIMITIVE;
+    layer_params.maskTransform._11 = 1.0f;
+    layer_params.maskTransform._12 = 0.0f;
+    layer_params.maskTransform._21 = 0.0f;
+    layer_params.maskTransform._22 = 1.0f;
+    layer_params.maskTransform._31 = 0.0f;
+    layer_params.maskTransform._32 = 0.0f;
+    layer_params.opacity = 1.0f;
+    layer_params.opacityBrush = NULL;
+    layer_params.layerOptions = dummy_D2D1_LAYER_OPTIONS_NONE;
+
+    d2d_sync_transform(c);
+    dummy_ID2D1RenderTarget_PushLayer(c->target, &layer_params, layer);
+    return 0;
+}
+
+void
+d2d_pop_clip(d2d_canvas_t* c)
+{
+    d2d_clip_t* clip;
+
+    if(c->clip_count == 0) {
+        WD_TRACE("d2d_pop_clip: Logical error: Clip stack underflow.");
+        return;
+    }
+
+    clip = &c->clip_stack[--c->clip_count];
+    if(clip->layer != NULL) {
+        dummy_ID2D1RenderTarget_PopLayer(c->target);
+        d2d_put_layer(c, clip->layer);
+    } else {
+        dummy_ID2D1RenderTarget_PopAxisAlignedClip(c->target);
+    }
+}
+
+void
+d2d_reset_clip(d2d_canvas_t* c)
+{
+    while(c->clip_count > 0)
+        d2d_pop_clip(c);
+}
+
+void
+d2d_disable_rtl_transform(d2d_canvas_t* c)
 {
     dummy_D2D1_MATRIX_3X2_F r;    /* Reflection + transition for WD_CANVAS_LAYOUTRTL. */
     dummy_D2D1_MATRIX_3X2_F ur;   /* R * user's transformation. */
@@ -12,9 +554,7 @@ d2d_disable_rtl_transform(d2d_canvas_t* c, dummy_D2D1_MATRIX_3X2_F* old_matrix)
     r._21 = 0.0f;				r._22 = 1.0f;
     r._31 = (float) c->width;	r._32 = 0.0f;
 
-    dummy_ID2D1RenderTarget_GetTransform(c->target, &ur);
-    if(old_matrix != NULL)
-        memcpy(old_matrix, &ur, sizeof(dummy_D2D1_MATRIX_3X2_F));
+    memcpy(&ur, &c->matrix, sizeof(dummy_D2D1_MATRIX_3X2_F));
     ur._31 += D2D_BASEDELTA_X;
     ur._32 -= D2D_BASEDELTA_Y;
 
@@ -22,6 +562,7 @@ d2d_disable_rtl_transform(d2d_canvas_t* c, dummy_D2D1_MATRIX_3X2_F* old_matrix)
     d2d_matrix_mult(&u, &ur, &r);
 
     dummy_ID2D1RenderTarget_SetTransform(c->target, &u);
+    c->flags |= D2D_CANVASFLAG_MATRIXDIRTY;
 }
 
 void
@@ -63,6 +604,7 @@ dummy_ID2D1Geometry*
 d2d_create_arc_geometry(float cx, float cy, float rx, float ry,
                         float base_angle, float sweep_angle, BOOL pie)
 {
+    dummy_ID2D1Factory* factory;
     dummy_ID2D1PathGeometry* g = NULL;
     dummy_ID2D1GeometrySink* s;
     HRESULT hr;
@@ -70,9 +612,11 @@ d2d_create_arc_geometry(float cx, float cy, float rx, float ry,
     dummy_D2D1_POINT_2F pt;
     dummy_D2D1_ARC_SEGMENT arc_seg;
 
-    wd_lock();
-    hr = dummy_ID2D1Factory_CreatePathGeometry(d2d_factory, &g);
-    wd_unlock();
+    WD_EVENT_BEGIN("ID2D1Factory::CreatePathGeometry");
+    factory = d2d_lock_factory(WD_LOCKSITE_CREATEPATHGEOMETRY);
+    hr = dummy_ID2D1Factory_CreatePathGeometry(factory, &g);
+    d2d_unlock_factory();
+    WD_EVENT_END("ID2D1Factory::CreatePathGeometry");
     if(FAILED(hr)) {
         WD_TRACE_HR("d2d_create_arc_geometry: "
                     "ID2D1Factory::CreatePathGeometry() failed.");
@@ -106,3 +650,42 @@ d2d_create_arc_geometry(float cx, float cy, float rx, float ry,
 
     return (dummy_ID2D1Geometry*) g;
 }
+
+dummy_ID2D1Geometry*
+d2d_create_polyline_geometry(const WD_POINT* points, UINT count)
+{
+    dummy_ID2D1Factory* factory;
+    dummy_ID2D1PathGeometry* g = NULL;
+    dummy_ID2D1GeometrySink* s;
+    HRESULT hr;
+    dummy_D2D1_POINT_2F pt;
+
+    WD_EVENT_BEGIN("ID2D1Factory::CreatePathGeometry");
+    factory = d2d_lock_factory(WD_LOCKSITE_CREATEPATHGEOMETRY);
+    hr = dummy_ID2D1Factory_CreatePathGeometry(factory, &g);
+    d2d_unlock_factory();
+    WD_EVENT_END("ID2D1Factory::CreatePathGeometry");
+    if(FAILED(hr)) {
+        WD_TRACE_HR("d2d_create_polyline_geometry: "
+                    "ID2D1Factory::CreatePathGeometry() failed.");
+        return NULL;
+    }
+    hr = dummy_ID2D1PathGeometry_Open(g, &s);
+    if(FAILED(hr)) {
+        WD_TRACE_HR("d2d_create_polyline_geometry: ID2D1PathGeometry::Open() failed.");
+        dummy_ID2D1PathGeometry_Release(g);
+        return NULL;
+    }
+
+    pt.x = points[0].x;
+    pt.y = points[0].y;
+    dummy_ID2D1GeometrySink_BeginFigure(s, pt, dummy_D2D1_FIGURE_BEGIN_HOLLOW);
+    /* WD_POINT and D2D1_POINT_2F are binary compatible. */
+    dummy_ID2D1GeometrySink_AddLines(s, (const dummy_D2D1_POINT_2F*) (points + 1), count - 1);
+    dummy_ID2D1GeometrySink_EndFigure(s, dummy_D2D1_FIGURE_END_OPEN);
+
+    dummy_ID2D1GeometrySink_Close(s);
+    dummy_ID2D1GeometrySink_Release(s);
+
+    return (dummy_ID2D1Geometry*) g;
+}
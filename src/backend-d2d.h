@@ -2,17 +2,198 @@
 #define WD_BACKEND_D2D_H
 
 #include "misc.h"
+#include "dirty.h"
+#include "lock.h"
+#include "stats.h"
 #include "dummy/d2d1.h"
 
 
+extern dummy_ID2D1Factory* d2d_factory;
+
+/* Single back-end builds (see WINDRAWLIB_BACKEND in CMakeLists.txt)
+ * make this a constant, so the compiler drops the other code paths of every
+ * "if(d2d_enabled()) ... else ..." dispatch. */
+#if defined WD_D2D_ONLY
+    #define d2d_enabled()       TRUE
+#elif defined WD_GDIPLUS_ONLY
+    #define d2d_enabled()       FALSE
+#else
+static inline BOOL
+d2d_enabled(void)
+{
+    return (d2d_factory != NULL);
+}
+#endif
+
+
+/* How the ID2D1Factory is shared among threads (see WD_D2D_MULTITHREADED and
+ * WD_D2D_PERTHREADFACTORY). */
+#define D2D_FACTORYMODE_SHARED          0   /* Single-threaded, guarded by wd_lock(). */
+#define D2D_FACTORYMODE_MULTITHREADED   1   /* Multi-threaded, D2D locks itself. */
+#define D2D_FACTORYMODE_PERTHREAD       2   /* One single-threaded factory per thread. */
+
+extern int d2d_factory_mode;
+
+int d2d_init(DWORD preinit_flags);
+void d2d_fini(void);
+
+dummy_ID2D1Factory* d2d_thread_factory(void);
+
+/* Every call to a method of ID2D1Factory has to be wrapped in this pair.
+ * Depending on the factory mode, it takes the global lock (and accounts it
+ * to the given WD_LOCKSITE_xxx) and returns the factory the calling thread
+ * should use. */
+static inline dummy_ID2D1Factory*
+d2d_lock_factory(int site)
+{
+    switch(d2d_factory_mode) {
+        case D2D_FACTORYMODE_MULTITHREADED:
+            return d2d_factory;
+
+        case D2D_FACTORYMODE_PERTHREAD:
+            return d2d_thread_factory();
+
+        default:
+            wd_lock(site);
+            return d2d_factory;
+    }
+}
+
+static inline void
+d2d_unlock_factory(void)
+{
+    if(d2d_factory_mode == D2D_FACTORYMODE_SHARED)
+        wd_unlock();
+}
+
+
+#define D2D_CANVASTYPE_BITMAP       0
+#define D2D_CANVASTYPE_DC           1
+#define D2D_CANVASTYPE_HWND         2
+
+#define D2D_CANVASFLAG_RTL          0x1
+#define D2D_CANVASFLAG_MATRIXDIRTY  0x2     /* d2d_canvas_t::matrix not yet set to the target. */
+#define D2D_CANVASFLAG_CULLING      0x4     /* WD_CANVAS_CULLING */
+
+#define D2D_BASEDELTA_X             0.5f
+#define D2D_BASEDELTA_Y             0.5f
+
+
+/* One level of the clip stack (see wdPushClipRect() and wdPushClipPath()). */
+typedef struct d2d_clip_tag d2d_clip_t;
+struct d2d_clip_tag {
+    dummy_ID2D1Layer* layer;    /* NULL for PushAxisAlignedClip() level. */
+    WD_RECT bounds;             /* Device-space bounds of the effective clip. */
+};
+
+/* One level of the state stack (see wdSaveState()). */
+typedef struct d2d_state_tag d2d_state_t;
+struct d2d_state_tag {
+    dummy_D2D1_MATRIX_3X2_F matrix;
+    UINT clip_count;
+};
+
+typedef struct d2d_canvas_tag d2d_canvas_t;
+struct d2d_canvas_tag {
+    WORD type;
+    WORD flags;
+    UINT width;
+    UINT height;
+    union {
+        dummy_ID2D1RenderTarget* target;
+        dummy_ID2D1BitmapRenderTarget* bmp_target;
+        dummy_ID2D1HwndRenderTarget* hwnd_target;
+    };
+    dummy_ID2D1GdiInteropRenderTarget* gdi_interop;
+
+    /* D2D_CANVASTYPE_DC: The DC the target is bound to, and the origin of
+     * the target in it. */
+    HDC dc;
+    POINT dc_origin;
+
+    /* Current transformation (including the base one, see
+     * d2d_reset_transform()). The render target gets it only when something
+     * is about to be painted, see d2d_sync_transform(). */
+    dummy_D2D1_MATRIX_3X2_F matrix;
+
+    d2d_state_t* state_stack;
+    UINT state_count;
+    UINT state_capacity;
+
+    d2d_clip_t* clip_stack;
+    UINT clip_count;
+    UINT clip_capacity;
+
+    /* For WD_CANVAS_CULLING (see wd_cull()). */
+    UINT cull_tested;
+    UINT cull_culled;
+
+    /* See wdAddDirtyRect(). */
+    wd_dirty_t dirty;
+    BYTE cache_state;   /* See wd_canvas_cache_state(). */
+
+    wd_stats_t stats;
+
+    /* Layers are bound to the render target which created them, but they
+     * can be reused for any PushLayer() on it. Hence we keep those popped
+     * from the clip stack for the next path clip. */
+    dummy_ID2D1Layer** layer_pool;
+    UINT layer_pool_count;
+    UINT layer_pool_capacity;
+};
+
+
+static inline void
+d2d_sync_transform(d2d_canvas_t* c)
+{
+    if(c->flags & D2D_CANVASFLAG_MATRIXDIRTY) {
+        dummy_ID2D1RenderTarget_SetTransform(c->target, &c->matrix);
+        c->flags &= ~D2D_CANVASFLAG_MATRIXDIRTY;
+    }
+}
+
+/* Counts an image uploaded to the GPU for wdGetCanvasStats(). */
+static inline void
+d2d_stats_upload(d2d_canvas_t* c, dummy_ID2D1Bitmap* b)
+{
+    dummy_D2D1_SIZE_U sz;
+
+    dummy_ID2D1Bitmap_GetPixelSize(b, &sz);
+    c->stats.bitmap_uploads++;
+    c->stats.bitmap_upload_bytes += (UINT64) sz.width * sz.height * 4;
+}
+
+
+d2d_canvas_t* d2d_canvas_alloc(dummy_ID2D1RenderTarget* target, WORD type,
+                               UINT width, UINT height, DWORD flags);
+void d2d_canvas_free(d2d_canvas_t* c);
+
+void d2d_init_color(dummy_D2D1_COLOR_F* c, WD_COLOR color);
+void d2d_matrix_mult(dummy_D2D1_MATRIX_3X2_F* res,
+                     const dummy_D2D1_MATRIX_3X2_F* a, const dummy_D2D1_MATRIX_3X2_F* b);
+
+int d2d_push_clip_rect(d2d_canvas_t* c, const WD_RECT* rect);
+int d2d_push_clip_path(d2d_canvas_t* c, dummy_ID2D1Geometry* geometry, const WD_RECT* rect);
+void d2d_pop_clip(d2d_canvas_t* c);
 void d2d_reset_clip(d2d_canvas_t* c);
 
+/* Device-space bounds of the visible area, i.e. the canvas size intersected
+ * with the current clip. */
+void d2d_visible_bounds(d2d_canvas_t* c, WD_RECT* bounds);
+
 void d2d_reset_transform(d2d_canvas_t* c);
 void d2d_apply_transform(d2d_canvas_t* c, const dummy_D2D1_MATRIX_3X2_F* matrix);
+void d2d_get_user_transform(d2d_canvas_t* c, dummy_D2D1_MATRIX_3X2_F* matrix);
+void d2d_set_user_transform(d2d_canvas_t* c, const dummy_D2D1_MATRIX_3X2_F* matrix);
+
+int d2d_save_state(d2d_canvas_t* c);
+void d2d_restore_state(d2d_canvas_t* c);
+void d2d_reset_state(d2d_canvas_t* c);
 
-/* Note: Can be called only if D2D_CANVASFLAG_RTL, and have to reinstall
- * the original transformation then-after. */
-void d2d_disable_rtl_transform(d2d_canvas_t* c, dummy_D2D1_MATRIX_3X2_F* old_matrix);
+/* Note: Can be called only if D2D_CANVASFLAG_RTL. It sets the target's
+ * transformation directly, bypassing d2d_canvas_t::matrix, which is then
+ * reinstalled by the next d2d_sync_transform(). */
+void d2d_disable_rtl_transform(d2d_canvas_t* c);
 
 void d2d_setup_arc_segment(dummy_D2D1_ARC_SEGMENT* arc_seg,
                            float cx, float cy, float rx, float ry,
@@ -22,6 +203,7 @@ void d2d_setup_bezier_segment(dummy_D2D1_BEZIER_SEGMENT* bezier_seg,
                               float x2, float y2);
 dummy_ID2D1Geometry* d2d_create_arc_geometry(float cx, float cy, float rx, float ry,
                     float base_angle, float sweep_angle, BOOL pie);
+dummy_ID2D1Geometry* d2d_create_polyline_geometry(const WD_POINT* points, UINT count);
 
 
 #endif  /* WD_BACKEND_D2D_H */
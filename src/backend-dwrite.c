@@ -1,6 +1,71 @@
 #include "backend-dwrite.h"
 
 
+static HMODULE dwrite_dll = NULL;
+
+dummy_IDWriteFactory* dwrite_factory = NULL;
+
+
+int
+dwrite_init(void)
+{
+    HRESULT (WINAPI* fn_DWriteCreateFactory)(int, REFIID, void**);
+    HRESULT hr;
+
+    dwrite_dll = wd_load_system_dll(_T("DWRITE.DLL"));
+    if(dwrite_dll == NULL) {
+        WD_TRACE_ERR("dwrite_init: wd_load_system_dll(DWRITE.DLL) failed.");
+        goto err_LoadLibrary;
+    }
+
+    fn_DWriteCreateFactory = (HRESULT (WINAPI*)(int, REFIID, void**))
+                GetProcAddress(dwrite_dll, "DWriteCreateFactory");
+    if(fn_DWriteCreateFactory == NULL) {
+        WD_TRACE_ERR("dwrite_init: GetProcAddress(DWriteCreateFactory) failed.");
+        goto err_GetProcAddress;
+    }
+
+    /* The shared factory is thread-safe on its own. */
+    hr = fn_DWriteCreateFactory(dummy_DWRITE_FACTORY_TYPE_SHARED,
+                &dummy_IID_IDWriteFactory, (void**) &dwrite_factory);
+    if(FAILED(hr)) {
+        WD_TRACE_HR("dwrite_init: DWriteCreateFactory() failed.");
+        goto err_CreateFactory;
+    }
+
+    /* Success */
+    return 0;
+
+    /* Error path */
+err_CreateFactory:
+err_GetProcAddress:
+    FreeLibrary(dwrite_dll);
+    dwrite_dll = NULL;
+err_LoadLibrary:
+    return -1;
+}
+
+void
+dwrite_fini(void)
+{
+    dummy_IDWriteFactory_Release(dwrite_factory);
+    dwrite_factory = NULL;
+
+    FreeLibrary(dwrite_dll);
+    dwrite_dll = NULL;
+}
+
+void
+dwrite_default_user_locale(WCHAR buffer[LOCALE_NAME_MAX_LENGTH])
+{
+    if(GetUserDefaultLocaleName(buffer, LOCALE_NAME_MAX_LENGTH) == 0) {
+        WD_TRACE_ERR("dwrite_default_user_locale: "
+                     "GetUserDefaultLocaleName() failed.");
+        buffer[0] = L'\0';
+    }
+}
+
+
 dummy_IDWriteTextFormat*
 dwrite_create_text_format(const WCHAR* locale_name, const LOGFONTW* logfont,
                           dummy_DWRITE_FONT_METRICS* metrics)
@@ -3,6 +3,11 @@
 
 extern dummy_IDWriteFactory* dwrite_factory;
 
+int dwrite_init(void);
+void dwrite_fini(void);
+
+void dwrite_default_user_locale(WCHAR buffer[LOCALE_NAME_MAX_LENGTH]);
+
 typedef struct dwrite_font_tag dwrite_font_t;
 struct dwrite_font_tag {
     dummy_IDWriteTextFormat* tf;
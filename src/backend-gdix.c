@@ -22,6 +22,8 @@
  */
 
 #include "backend-gdix.h"
+#include "capture.h"
+#include "lock.h"
 
 
 #ifdef _MSC_VER
@@ -38,6 +40,227 @@ static void (WINAPI* gdix_Shutdown)(ULONG_PTR);
 gdix_vtable_t* gdix_vtable = NULL;
 
 
+/* Canvases are usually created and destroyed for every WM_PAINT. To avoid
+ * creating the back buffer (a memory DC with a bitmap of the painted size),
+ * the pen and the string format each time, gdix_canvas_free() puts them into
+ * these small pools, and gdix_canvas_alloc() takes them from there.
+ *
+ * None of the objects is bound to a thread (as long as no two threads use it
+ * at the same time), so the pools are shared by all threads. */
+#define GDIX_POOL_SIZE      4
+
+typedef struct gdix_tools_tag gdix_tools_t;
+struct gdix_tools_tag {
+    dummy_GpPen* pen;
+    dummy_GpStringFormat* string_format;
+};
+
+static gdix_buffer_t gdix_buffer_pool[GDIX_POOL_SIZE];
+static UINT gdix_buffer_pool_count = 0;
+
+static gdix_tools_t gdix_tools_pool[GDIX_POOL_SIZE];
+static UINT gdix_tools_pool_count = 0;
+
+static inline UINT64
+gdix_buffer_area(const gdix_buffer_t* buf)
+{
+    return (UINT64) buf->cx * (UINT64) buf->cy;
+}
+
+static int
+gdix_buffer_create(gdix_buffer_t* buf, HDC dc, int cx, int cy)
+{
+    buf->dc = CreateCompatibleDC(dc);
+    if(buf->dc == NULL) {
+        WD_TRACE_ERR("gdix_buffer_create: CreateCompatibleDC() failed.");
+        return -1;
+    }
+
+    buf->bmp = CreateCompatibleBitmap(dc, cx, cy);
+    if(buf->bmp == NULL) {
+        WD_TRACE_ERR("gdix_buffer_create: CreateCompatibleBitmap() failed.");
+        DeleteDC(buf->dc);
+        return -1;
+    }
+
+    buf->orig_bmp = SelectObject(buf->dc, buf->bmp);
+    buf->cx = cx;
+    buf->cy = cy;
+    return 0;
+}
+
+static void
+gdix_buffer_destroy(gdix_buffer_t* buf)
+{
+    SelectObject(buf->dc, buf->orig_bmp);
+    DeleteObject(buf->bmp);
+    DeleteDC(buf->dc);
+}
+
+/* Gets a back buffer of at least cx x cy pixels: The smallest fitting one from
+ * the pool if any. Otherwise the biggest pooled one is replaced by a new one
+ * which is grown geometrically, so a window being resized by the user does
+ * not need a new buffer for every paint. */
+static int
+gdix_buffer_get(gdix_buffer_t* buf, HDC dc, int cx, int cy)
+{
+    gdix_buffer_t old;
+    int best = -1;
+    UINT i;
+
+    old.dc = NULL;
+
+    wd_lock(WD_LOCKSITE_GDIXPOOL);
+    for(i = 0; i < gdix_buffer_pool_count; i++) {
+        const gdix_buffer_t* b = &gdix_buffer_pool[i];
+
+        if(b->cx >= cx  &&  b->cy >= cy) {
+            if(best < 0  ||  gdix_buffer_area(b) < gdix_buffer_area(&gdix_buffer_pool[best]))
+                best = i;
+        }
+    }
+    if(best >= 0) {
+        *buf = gdix_buffer_pool[best];
+        gdix_buffer_pool[best] = gdix_buffer_pool[--gdix_buffer_pool_count];
+        wd_unlock();
+        return 0;
+    }
+    if(gdix_buffer_pool_count > 0) {
+        best = 0;
+        for(i = 1; i < gdix_buffer_pool_count; i++) {
+            if(gdix_buffer_area(&gdix_buffer_pool[i]) > gdix_buffer_area(&gdix_buffer_pool[best]))
+                best = i;
+        }
+        old = gdix_buffer_pool[best];
+        gdix_buffer_pool[best] = gdix_buffer_pool[--gdix_buffer_pool_count];
+    }
+    wd_unlock();
+
+    if(old.dc != NULL) {
+        cx = (cx > old.cx) ? WD_MAX(cx, old.cx + old.cx / 2) : old.cx;
+        cy = (cy > old.cy) ? WD_MAX(cy, old.cy + old.cy / 2) : old.cy;
+        gdix_buffer_destroy(&old);
+    }
+
+    return gdix_buffer_create(buf, dc, cx, cy);
+}
+
+/* Returns the back buffer into the pool. If the pool is full, the smallest
+ * buffer is destroyed. */
+static void
+gdix_buffer_put(gdix_buffer_t* buf)
+{
+    gdix_buffer_t victim = *buf;
+    UINT i;
+
+    /* Undo what the canvas has set up. */
+    SetViewportOrgEx(buf->dc, 0, 0, NULL);
+
+    wd_lock(WD_LOCKSITE_GDIXPOOL);
+    if(gdix_buffer_pool_count < GDIX_POOL_SIZE) {
+        gdix_buffer_pool[gdix_buffer_pool_count++] = *buf;
+        victim.dc = NULL;
+    } else {
+        UINT smallest = 0;
+
+        for(i = 1; i < GDIX_POOL_SIZE; i++) {
+            if(gdix_buffer_area(&gdix_buffer_pool[i]) < gdix_buffer_area(&gdix_buffer_pool[smallest]))
+                smallest = i;
+        }
+        if(gdix_buffer_area(&gdix_buffer_pool[smallest]) < gdix_buffer_area(buf)) {
+            victim = gdix_buffer_pool[smallest];
+            gdix_buffer_pool[smallest] = *buf;
+        }
+    }
+    wd_unlock();
+
+    if(victim.dc != NULL)
+        gdix_buffer_destroy(&victim);
+}
+
+static int
+gdix_tools_get(gdix_tools_t* tools)
+{
+    int status;
+
+    wd_lock(WD_LOCKSITE_GDIXPOOL);
+    if(gdix_tools_pool_count > 0) {
+        *tools = gdix_tools_pool[--gdix_tools_pool_count];
+        wd_unlock();
+        return 0;
+    }
+    wd_unlock();
+
+    /* GDI+ has, unlike D2D, a concept of pens, which are used for "draw"
+     * operations, while brushes are used for "fill" operations.
+     *
+     * Our interface works only with brushes as D2D does. Hence we create
+     * a pen as part of GDI+ canvas and we update it with GdipSetPenBrushFill()
+     * and GdipSetPenWidth() every time whenever we need to use a pen. */
+    status = gdix_vtable->fn_CreatePen1(0, 1.0f, dummy_UnitPixel, &tools->pen);
+    if(status != 0) {
+        WD_TRACE_ERR_("gdix_tools_get: GdipCreatePen1() failed.", status);
+        return -1;
+    }
+
+    /* Needed for wdDrawString() and wdMeasureString() */
+    status = gdix_vtable->fn_CreateStringFormat(0, LANG_NEUTRAL, &tools->string_format);
+    if(status != 0) {
+        WD_TRACE("gdix_tools_get: "
+                 "GdipCreateStringFormat() failed. [%d]", status);
+        gdix_vtable->fn_DeletePen(tools->pen);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void
+gdix_tools_destroy(gdix_tools_t* tools)
+{
+    gdix_vtable->fn_DeleteStringFormat(tools->string_format);
+    gdix_vtable->fn_DeletePen(tools->pen);
+}
+
+static void
+gdix_tools_put(gdix_tools_t* tools)
+{
+    /* gdix_setpen() leaves the stroke style in place when painting without
+     * one. Do not let it leak into another canvas. (The string format is
+     * fully set up by gdix_canvas_apply_string_flags() on every use.) */
+    gdix_vtable->fn_SetPenDashStyle(tools->pen, dummy_DashStyleSolid);
+    gdix_vtable->fn_SetPenStartCap(tools->pen, dummy_LineCapFlat);
+    gdix_vtable->fn_SetPenEndCap(tools->pen, dummy_LineCapFlat);
+    gdix_vtable->fn_SetPenLineJoin(tools->pen, dummy_LineJoinMiter);
+    gdix_vtable->fn_SetPenMiterLimit(tools->pen, WD_MITER_LIMIT);
+
+    wd_lock(WD_LOCKSITE_GDIXPOOL);
+    if(gdix_tools_pool_count < GDIX_POOL_SIZE) {
+        gdix_tools_pool[gdix_tools_pool_count++] = *tools;
+        wd_unlock();
+        return;
+    }
+    wd_unlock();
+
+    gdix_tools_destroy(tools);
+}
+
+static void
+gdix_pool_fini(void)
+{
+    UINT i;
+
+    for(i = 0; i < gdix_buffer_pool_count; i++)
+        gdix_buffer_destroy(&gdix_buffer_pool[i]);
+    gdix_buffer_pool_count = 0;
+
+    for(i = 0; i < gdix_tools_pool_count; i++)
+        gdix_tools_destroy(&gdix_tools_pool[i]);
+    gdix_tools_pool_count = 0;
+}
+
+
+
 int
 gdix_init(void)
 {
@@ -104,6 +327,8 @@ gdix_init(void)
     GPA(GetDC, (dummy_GpGraphics*, HDC*));
     GPA(ReleaseDC, (dummy_GpGraphics*, HDC));
     GPA(ResetClip, (dummy_GpGraphics*));
+    GPA(SaveGraphics, (dummy_GpGraphics*, dummy_GpGraphicsState*));
+    GPA(RestoreGraphics, (dummy_GpGraphics*, dummy_GpGraphicsState));
     GPA(ResetWorldTransform, (dummy_GpGraphics*));
     GPA(RotateWorldTransform, (dummy_GpGraphics*, float, dummy_GpMatrixOrder));
     GPA(ScaleWorldTransform, (dummy_GpGraphics*, float, float, dummy_GpMatrixOrder));
@@ -114,8 +339,10 @@ gdix_init(void)
     GPA(SetSmoothingMode, (dummy_GpGraphics*, dummy_GpSmoothingMode));
     GPA(TranslateWorldTransform, (dummy_GpGraphics*, float, float, dummy_GpMatrixOrder));
     GPA(MultiplyWorldTransform, (dummy_GpGraphics*, dummy_GpMatrix*, dummy_GpMatrixOrder));
+    GPA(SetWorldTransform, (dummy_GpGraphics*, dummy_GpMatrix*));
     GPA(CreateMatrix2, (float, float, float, float, float, float, dummy_GpMatrix**));
     GPA(DeleteMatrix, (dummy_GpMatrix*));
+    GPA(SetMatrixElements, (dummy_GpMatrix*, float, float, float, float, float, float));
 
     /* Brush functions */
     GPA(CreateSolidFill, (dummy_ARGB, dummy_GpSolidFill**));
@@ -148,6 +375,8 @@ gdix_init(void)
     GPA(AddPathArc, (dummy_GpPath*, float, float, float, float, float, float));
     GPA(AddPathLine, (dummy_GpPath*, float, float, float, float));
     GPA(AddPathBezier, (dummy_GpPath*, float, float, float, float, float, float, float, float));
+    GPA(AddPathLine2, (dummy_GpPath*, const dummy_GpPointF*, INT));
+    GPA(AddPathBeziers, (dummy_GpPath*, const dummy_GpPointF*, INT));
 
     /* Font functions */
     GPA(CreateFontFromLogfontW, (HDC, const LOGFONTW*, dummy_GpFont**));
@@ -192,14 +421,17 @@ gdix_init(void)
     GPA(DrawImageRectRect, (dummy_GpGraphics*, dummy_GpImage*, float, float, float, float, float, float, float, float, dummy_GpUnit, const void*, void*, void*));
     GPA(DrawEllipse, (dummy_GpGraphics*, dummy_GpPen*, float, float, float, float));
     GPA(DrawLine, (dummy_GpGraphics*, dummy_GpPen*, float, float, float, float));
+    GPA(DrawLines, (dummy_GpGraphics*, dummy_GpPen*, const dummy_GpPointF*, INT));
     GPA(DrawPath, (dummy_GpGraphics*, dummy_GpPen*, dummy_GpPath*));
     GPA(DrawPie, (dummy_GpGraphics*, dummy_GpPen*, float, float, float, float, float, float));
     GPA(DrawRectangle, (dummy_GpGraphics*, void*, float, float, float, float));
+    GPA(DrawRectangles, (dummy_GpGraphics*, void*, const dummy_GpRectF*, INT));
     GPA(DrawString, (dummy_GpGraphics*, const WCHAR*, int, const dummy_GpFont*, const dummy_GpRectF*, const dummy_GpStringFormat*, const dummy_GpBrush*));
     GPA(FillEllipse, (dummy_GpGraphics*, dummy_GpBrush*, float, float, float, float));
     GPA(FillPath, (dummy_GpGraphics*, dummy_GpBrush*, dummy_GpPath*));
     GPA(FillPie, (dummy_GpGraphics*, dummy_GpBrush*, float, float, float, float, float, float));
     GPA(FillRectangle, (dummy_GpGraphics*, void*, float, float, float, float));
+    GPA(FillRectangles, (dummy_GpGraphics*, void*, const dummy_GpRectF*, INT));
     GPA(MeasureString, (dummy_GpGraphics*, const WCHAR*, int, const dummy_GpFont*, const dummy_GpRectF*, const dummy_GpStringFormat*, dummy_GpRectF*, int*, int*));
 
 #undef GPA
@@ -230,6 +462,8 @@ err_LoadLibrary:
 void
 gdix_fini(void)
 {
+    gdix_pool_fini();
+
     free(gdix_vtable);
     gdix_vtable = NULL;
 
@@ -239,11 +473,72 @@ gdix_fini(void)
     gdix_dll = NULL;
 }
 
+static int
+gdix_create_graphics(HDC dc, dummy_GpGraphics** p_graphics)
+{
+    dummy_GpGraphics* graphics;
+    int status;
+
+    status = gdix_vtable->fn_CreateFromHDC(dc, &graphics);
+    if(status != 0) {
+        WD_TRACE_ERR_("gdix_create_graphics: GdipCreateFromHDC() failed.", status);
+        return -1;
+    }
+
+    status = gdix_vtable->fn_SetPageUnit(graphics, dummy_UnitPixel);
+    if(status != 0) {
+        WD_TRACE_ERR_("gdix_create_graphics: GdipSetPageUnit() failed.", status);
+        gdix_vtable->fn_DeleteGraphics(graphics);
+        return -1;
+    }
+
+    status = gdix_vtable->fn_SetSmoothingMode(graphics,         /* GDI+ 1.1 */
+                dummy_SmoothingModeAntiAlias8x8);
+    if(status != 0) {
+        gdix_vtable->fn_SetSmoothingMode(graphics,              /* GDI+ 1.0 */
+                    dummy_SmoothingModeHighQuality);
+    }
+
+    *p_graphics = graphics;
+    return 0;
+}
+
+/* Anything outside the DC clip box (e.g. outside the invalidated rect of
+ * WM_PAINT) can never be visible. (Used for WD_CANVAS_CULLING.) The back
+ * buffer may be bigger than needed, so use the painted rect instead. */
+static void
+gdix_canvas_init_viewport(gdix_canvas_t* c)
+{
+    RECT clip_box;
+    int region_type;
+
+    if(c->buffer.dc != NULL) {
+        c->viewport.x0 = (float) c->x;
+        c->viewport.y0 = (float) c->y;
+        c->viewport.x1 = (float) (c->x + c->cx);
+        c->viewport.y1 = (float) (c->y + c->cy);
+        return;
+    }
+
+    region_type = GetClipBox(c->dc, &clip_box);
+    if(region_type == SIMPLEREGION  ||  region_type == COMPLEXREGION) {
+        c->viewport.x0 = (float) clip_box.left;
+        c->viewport.y0 = (float) clip_box.top;
+        c->viewport.x1 = (float) clip_box.right;
+        c->viewport.y1 = (float) clip_box.bottom;
+    } else {
+        c->viewport.x0 = -FLT_MAX;
+        c->viewport.y0 = -FLT_MAX;
+        c->viewport.x1 = FLT_MAX;
+        c->viewport.y1 = FLT_MAX;
+    }
+}
+
 gdix_canvas_t*
-gdix_canvas_alloc(HDC dc, const RECT* doublebuffer_rect, UINT width, BOOL rtl)
+gdix_canvas_alloc(HDC dc, const RECT* doublebuffer_rect, UINT width, DWORD flags)
 {
     gdix_canvas_t* c;
-    int status;
+    gdix_tools_t tools;
 
     c = (gdix_canvas_t*) malloc(sizeof(gdix_canvas_t));
     if(c == NULL) {
@@ -253,38 +548,29 @@ gdix_canvas_alloc(HDC dc, const RECT* doublebuffer_rect, UINT width, BOOL rtl)
 
     memset(c, 0, sizeof(gdix_canvas_t));
     c->width = width;
-    c->rtl = (rtl ? TRUE : FALSE);
+    c->rtl = ((flags & WD_CANVAS_LAYOUTRTL) ? TRUE : FALSE);
+    c->culling = ((flags & WD_CANVAS_CULLING) ? TRUE : FALSE);
 
     if(doublebuffer_rect != NULL) {
         int cx = doublebuffer_rect->right - doublebuffer_rect->left;
         int cy = doublebuffer_rect->bottom - doublebuffer_rect->top;
-        HDC mem_dc;
-        HBITMAP mem_bmp;
 
-        mem_dc = CreateCompatibleDC(dc);
-        if(mem_dc == NULL) {
-            WD_TRACE_ERR("gdix_canvas_alloc: CreateCompatibleDC() failed.");
-            DeleteDC(mem_dc);
-            goto no_doublebuffer;
-        }
-        SetLayout(mem_dc, 0);
-        mem_bmp = CreateCompatibleBitmap(dc, cx, cy);
-        if(mem_bmp == NULL) {
-            DeleteObject(mem_dc);
-            WD_TRACE_ERR("gdix_canvas_alloc: CreateCompatibleBitmap() failed.");
+        if(gdix_buffer_get(&c->buffer, dc, cx, cy) != 0) {
+            WD_TRACE("gdix_canvas_alloc: gdix_buffer_get() failed.");
+            c->buffer.dc = NULL;
             goto no_doublebuffer;
         }
 
-        c->dc = mem_dc;
+        SetLayout(c->buffer.dc, 0);
+        c->dc = c->buffer.dc;
         c->real_dc = dc;
-        c->orig_bmp = SelectObject(mem_dc, mem_bmp);
         c->x = (GetLayout(dc) & LAYOUT_RTL)
                  ? width - 1 - doublebuffer_rect->right
                  : doublebuffer_rect->left;
         c->y = doublebuffer_rect->top;
-        c->cx = doublebuffer_rect->right - doublebuffer_rect->left;
-        c->cy = doublebuffer_rect->bottom - doublebuffer_rect->top;
-        SetViewportOrgEx(mem_dc, -c->x, -c->y, NULL);
+        c->cx = cx;
+        c->cy = cy;
+        SetViewportOrgEx(c->dc, -c->x, -c->y, NULL);
     } else {
 no_doublebuffer:
         c->dc = dc;
@@ -303,60 +589,29 @@ no_doublebuffer:
      */
     c->dc_layout = SetLayout(dc, 0);
 
-    status = gdix_vtable->fn_CreateFromHDC(c->dc, &c->graphics);
-    if(status != 0) {
-        WD_TRACE_ERR_("gdix_canvas_alloc: GdipCreateFromHDC() failed.", status);
-        goto err_creategraphics;
-    }
-
-    status = gdix_vtable->fn_SetPageUnit(c->graphics, dummy_UnitPixel);
-    if(status != 0) {
-        WD_TRACE_ERR_("gdix_canvas_alloc: GdipSetPageUnit() failed.", status);
-        goto err_setpageunit;
-    }
-
-    status = gdix_vtable->fn_SetSmoothingMode(c->graphics,      /* GDI+ 1.1 */
-                dummy_SmoothingModeAntiAlias8x8);
-    if(status != 0) {
-        gdix_vtable->fn_SetSmoothingMode(c->graphics,           /* GDI+ 1.0 */
-                    dummy_SmoothingModeHighQuality);
-    }
+    gdix_canvas_init_viewport(c);
 
-    /* GDI+ has, unlike D2D, a concept of pens, which are used for "draw"
-     * operations, while brushes are used for "fill" operations.
-     *
-     * Our interface works only with brushes as D2D does. Hence we create
-     * a pen as part of GDI+ canvas and we update it with GdipSetPenBrushFill()
-     * and GdipSetPenWidth() every time whenever we need to use a pen. */
-    status = gdix_vtable->fn_CreatePen1(0, 1.0f, dummy_UnitPixel, &c->pen);
-    if(status != 0) {
-        WD_TRACE_ERR_("gdix_canvas_alloc: GdipCreatePen1() failed.", status);
-        goto err_createpen;
+    if(gdix_create_graphics(c->dc, &c->graphics) != 0) {
+        WD_TRACE("gdix_canvas_alloc: gdix_create_graphics() failed.");
+        goto err_creategraphics;
     }
 
-    /* Needed for wdDrawString() and wdMeasureString() */
-    status = gdix_vtable->fn_CreateStringFormat(0, LANG_NEUTRAL, &c->string_format);
-    if(status != 0) {
-        WD_TRACE("gdix_canvas_alloc: "
-                 "GdipCreateStringFormat() failed. [%d]", status);
-        goto err_createstringformat;
+    if(gdix_tools_get(&tools) != 0) {
+        WD_TRACE("gdix_canvas_alloc: gdix_tools_get() failed.");
+        goto err_tools_get;
     }
+    c->pen = tools.pen;
+    c->string_format = tools.string_format;
 
     gdix_reset_transform(c);
     return c;
 
     /* Error path */
-err_createstringformat:
-    gdix_vtable->fn_DeletePen(c->pen);
-err_createpen:
-err_setpageunit:
+err_tools_get:
     gdix_vtable->fn_DeleteGraphics(c->graphics);
 err_creategraphics:
-    if(c->real_dc != NULL) {
-        HBITMAP mem_bmp = SelectObject(c->dc, c->orig_bmp);
-        DeleteObject(mem_bmp);
-        DeleteDC(c->dc);
-    }
+    if(c->buffer.dc != NULL)
+        gdix_buffer_put(&c->buffer);
     SetLayout(dc, c->dc_layout);
     free(c);
 err_malloc:
@@ -366,34 +621,287 @@ err_malloc:
 void
 gdix_canvas_free(gdix_canvas_t* c)
 {
-    gdix_vtable->fn_DeleteStringFormat(c->string_format);
-    gdix_vtable->fn_DeletePen(c->pen);
+    gdix_tools_t tools;
+
+    if(c->clip_count > 0)
+        WD_TRACE("gdix_canvas_free: Logical error: Canvas has dangling clip.");
+    if(c->state_count > 0)
+        WD_TRACE("gdix_canvas_free: Logical error: Unpaired wdSaveState()/wdRestoreState().");
+    free(c->clip_stack);
+    free(c->state_stack);
+    if(c->gp_matrix != NULL)
+        gdix_delete_matrix(c->gp_matrix);
+
+    tools.pen = c->pen;
+    tools.string_format = c->string_format;
+    gdix_tools_put(&tools);
     gdix_vtable->fn_DeleteGraphics(c->graphics);
 
-    if(c->real_dc != NULL) {
-        HBITMAP mem_bmp;
+    if(c->buffer.dc != NULL)
+        gdix_buffer_put(&c->buffer);
+
+    free(c);
+}
+
+int
+gdix_canvas_resize(gdix_canvas_t* c, UINT width, UINT height)
+{
+    WD_MATRIX user;
+
+    /* Only the cached canvas owns a buffer of the window size. */
+    if(c->hwnd == NULL) {
+        WD_TRACE("gdix_canvas_resize: Not supported (not a cached canvas).");
+        return -1;
+    }
 
-        mem_bmp = SelectObject(c->dc, c->orig_bmp);
-        DeleteObject(mem_bmp);
-        DeleteObject(c->dc);
+    /* The buffer and the graphics are kept as long as the buffer fits. */
+    if((int) width > c->buffer.cx  ||  (int) height > c->buffer.cy) {
+        gdix_buffer_t buffer;
+        dummy_GpGraphics* graphics;
+
+        /* The current buffer is compatible with the window. */
+        if(gdix_buffer_get(&buffer, c->buffer.dc, width, height) != 0) {
+            WD_TRACE("gdix_canvas_resize: gdix_buffer_get() failed.");
+            return -1;
+        }
+        SetLayout(buffer.dc, 0);
+        SetViewportOrgEx(buffer.dc, -c->x, -c->y, NULL);
+
+        if(gdix_create_graphics(buffer.dc, &graphics) != 0) {
+            WD_TRACE("gdix_canvas_resize: gdix_create_graphics() failed.");
+            gdix_buffer_put(&buffer);
+            return -1;
+        }
+
+        gdix_vtable->fn_DeleteGraphics(c->graphics);
+        gdix_buffer_put(&c->buffer);
+        c->buffer = buffer;
+        c->dc = buffer.dc;
+        c->graphics = graphics;
+        c->matrix_dirty = TRUE;
     }
 
-    free(c);
+    /* In RTL mode, the base transformation depends on the width. */
+    gdix_get_user_transform(c, &user);
+    c->width = width;
+    gdix_set_user_transform(c, &user);
+
+    c->cx = width;
+    c->cy = height;
+    c->viewport.x1 = (float) (c->x + c->cx);
+    c->viewport.y1 = (float) (c->y + c->cy);
+    return 0;
+}
+
+int
+gdix_canvas_rebind(gdix_canvas_t* c, HDC dc, const RECT* rect)
+{
+    int cx = rect->right - rect->left;
+    int cy = rect->bottom - rect->top;
+    gdix_buffer_t buffer = c->buffer;
+    dummy_GpGraphics* graphics;
+    WD_MATRIX user;
+    int dc_layout;
+    int x = 0;
+
+    if(c->hwnd != NULL) {
+        WD_TRACE("gdix_canvas_rebind: Not supported (canvas of a window).");
+        return -1;
+    }
+
+    /* Give the previous DC its layout back (see gdix_canvas_alloc()). */
+    SetLayout((c->real_dc != NULL) ? c->real_dc : c->dc, c->dc_layout);
+
+    if(buffer.dc != NULL) {
+        if(cx > buffer.cx  ||  cy > buffer.cy) {
+            if(gdix_buffer_get(&buffer, dc, cx, cy) != 0) {
+                WD_TRACE("gdix_canvas_rebind: gdix_buffer_get() failed.");
+                return -1;
+            }
+            SetLayout(buffer.dc, 0);
+        }
+
+        x = (GetLayout(dc) & LAYOUT_RTL) ? cx - 1 - rect->right : rect->left;
+        SetViewportOrgEx(buffer.dc, -x, -rect->top, NULL);
+    }
+
+    dc_layout = SetLayout(dc, 0);
+
+    /* The graphics has to be recreated: It is bound to the DC and it would
+     * not notice the viewport origin of the back buffer has changed. */
+    if(gdix_create_graphics((buffer.dc != NULL) ? buffer.dc : dc, &graphics) != 0) {
+        WD_TRACE("gdix_canvas_rebind: gdix_create_graphics() failed.");
+        SetLayout(dc, dc_layout);
+        if(buffer.dc != c->buffer.dc)
+            gdix_buffer_put(&buffer);
+        else if(buffer.dc != NULL)
+            SetViewportOrgEx(buffer.dc, -c->x, -c->y, NULL);
+        return -1;
+    }
+
+    gdix_vtable->fn_DeleteGraphics(c->graphics);
+    if(buffer.dc != c->buffer.dc)
+        gdix_buffer_put(&c->buffer);
+
+    c->graphics = graphics;
+    c->buffer = buffer;
+    c->dc_layout = dc_layout;
+    if(buffer.dc != NULL) {
+        c->dc = buffer.dc;
+        c->real_dc = dc;
+        c->x = x;
+        c->y = rect->top;
+        c->cx = cx;
+        c->cy = cy;
+    } else {
+        c->dc = dc;
+    }
+
+    /* In RTL mode, the base transformation depends on the width. */
+    gdix_get_user_transform(c, &user);
+    c->width = cx;
+    gdix_set_user_transform(c, &user);
+
+    gdix_canvas_init_viewport(c);
+    return 0;
+}
+
+/* For WD_CANVAS_LAYOUTRTL, the base transformation mirrors the X axis.
+ * Note the mirroring is inverse to itself. */
+static void
+gdix_base_transform(gdix_canvas_t* c, WD_MATRIX* m)
+{
+    m->m11 = (c->rtl ? -1.0f : 1.0f);
+    m->m12 = 0.0f;
+    m->m21 = 0.0f;
+    m->m22 = 1.0f;
+    m->dx = (c->rtl ? (float)(c->width-1) : 0.0f);
+    m->dy = 0.0f;
 }
 
 void
 gdix_rtl_transform(gdix_canvas_t* c)
 {
-    gdix_vtable->fn_ScaleWorldTransform(c->graphics, -1.0f, 1.0f, dummy_MatrixOrderAppend);
-    gdix_vtable->fn_TranslateWorldTransform(c->graphics, (float)(c->width-1), 0.0f, dummy_MatrixOrderAppend);
+    WD_MATRIX r;
+
+    gdix_base_transform(c, &r);
+    wd_matrix_mult(&c->matrix, &c->matrix, &r);
+    c->matrix_dirty = TRUE;
 }
 
 void
 gdix_reset_transform(gdix_canvas_t* c)
 {
-    gdix_vtable->fn_ResetWorldTransform(c->graphics);
-    if(c->rtl)
-        gdix_rtl_transform(c);
+    gdix_base_transform(c, &c->matrix);
+    c->matrix_dirty = TRUE;
+}
+
+void
+gdix_apply_transform(gdix_canvas_t* c, const WD_MATRIX* matrix)
+{
+    wd_matrix_mult(&c->matrix, matrix, &c->matrix);
+    c->matrix_dirty = TRUE;
+}
+
+void
+gdix_get_user_transform(gdix_canvas_t* c, WD_MATRIX* matrix)
+{
+    WD_MATRIX base;
+
+    gdix_base_transform(c, &base);
+    wd_matrix_mult(matrix, &c->matrix, &base);
+}
+
+void
+gdix_set_user_transform(gdix_canvas_t* c, const WD_MATRIX* matrix)
+{
+    WD_MATRIX base;
+
+    gdix_base_transform(c, &base);
+    wd_matrix_mult(&c->matrix, matrix, &base);
+    c->matrix_dirty = TRUE;
+}
+
+void
+gdix_sync_transform_(gdix_canvas_t* c)
+{
+    const WD_MATRIX* m = &c->matrix;
+    int status;
+
+    /* Reuse a single GpMatrix for the canvas lifetime. */
+    if(c->gp_matrix == NULL) {
+        status = gdix_vtable->fn_CreateMatrix2(m->m11, m->m12, m->m21, m->m22,
+                    m->dx, m->dy, &c->gp_matrix);
+        if(status != 0) {
+            WD_TRACE_ERR_("gdix_sync_transform_: GdipCreateMatrix2() failed.", status);
+            c->gp_matrix = NULL;
+            return;
+        }
+    } else {
+        gdix_vtable->fn_SetMatrixElements(c->gp_matrix, m->m11, m->m12,
+                    m->m21, m->m22, m->dx, m->dy);
+    }
+
+    status = gdix_vtable->fn_SetWorldTransform(c->graphics, c->gp_matrix);
+    if(status != 0) {
+        WD_TRACE_ERR_("gdix_sync_transform_: GdipSetWorldTransform() failed.", status);
+        return;
+    }
+
+    c->matrix_dirty = FALSE;
+}
+
+int
+gdix_save_state(gdix_canvas_t* c)
+{
+    gdix_state_t* state;
+
+    if(c->state_count >= c->state_capacity) {
+        UINT capacity = (c->state_capacity > 0 ? c->state_capacity * 2 : 4);
+        gdix_state_t* stack;
+
+        stack = (gdix_state_t*) realloc(c->state_stack, capacity * sizeof(gdix_state_t));
+        if(stack == NULL) {
+            WD_TRACE("gdix_save_state: realloc() failed.");
+            return -1;
+        }
+
+        c->state_stack = stack;
+        c->state_capacity = capacity;
+    }
+
+    state = &c->state_stack[c->state_count++];
+    memcpy(&state->matrix, &c->matrix, sizeof(WD_MATRIX));
+    state->clip_count = c->clip_count;
+    return 0;
+}
+
+void
+gdix_restore_state(gdix_canvas_t* c)
+{
+    gdix_state_t* state;
+
+    if(c->state_count == 0) {
+        WD_TRACE("gdix_restore_state: Logical error: State stack underflow.");
+        return;
+    }
+
+    state = &c->state_stack[--c->state_count];
+
+    if(memcmp(&c->matrix, &state->matrix, sizeof(WD_MATRIX)) != 0) {
+        memcpy(&c->matrix, &state->matrix, sizeof(WD_MATRIX));
+        c->matrix_dirty = TRUE;
+    }
+
+    while(c->clip_count > state->clip_count)
+        gdix_restore_clip(c);
+}
+
+void
+gdix_reset_state(gdix_canvas_t* c)
+{
+    c->state_count = 0;
+    gdix_reset_clip(c);
 }
 
 void
@@ -406,6 +914,91 @@ gdix_delete_matrix(dummy_GpMatrix* m)
     }
 }
 
+void
+gdix_visible_bounds(gdix_canvas_t* c, WD_RECT* bounds)
+{
+    if(c->clip_count > 0)
+        memcpy(bounds, &c->clip_stack[c->clip_count-1].bounds, sizeof(WD_RECT));
+    else
+        memcpy(bounds, &c->viewport, sizeof(WD_RECT));
+}
+
+int
+gdix_save_clip(gdix_canvas_t* c, const WD_RECT* rect)
+{
+    gdix_clip_t* clip;
+    WD_RECT visible;
+    int status;
+
+    if(c->clip_count >= c->clip_capacity) {
+        UINT capacity = (c->clip_capacity > 0 ? c->clip_capacity * 2 : 4);
+        gdix_clip_t* stack;
+
+        stack = (gdix_clip_t*) realloc(c->clip_stack, capacity * sizeof(gdix_clip_t));
+        if(stack == NULL) {
+            WD_TRACE("gdix_save_clip: realloc() failed.");
+            return -1;
+        }
+
+        c->clip_stack = stack;
+        c->clip_capacity = capacity;
+    }
+
+    gdix_visible_bounds(c, &visible);
+    clip = &c->clip_stack[c->clip_count];
+
+    status = gdix_vtable->fn_SaveGraphics(c->graphics, &clip->state);
+    if(status != 0) {
+        WD_TRACE_ERR_("gdix_save_clip: GdipSaveGraphics() failed.", status);
+        return -1;
+    }
+
+    if(rect != NULL) {
+        WD_RECT rect_bounds;
+
+        wd_bounds_transform(&c->matrix, rect, &rect_bounds);
+        wd_bounds_intersect(&clip->bounds, &visible, &rect_bounds);
+    } else {
+        memcpy(&clip->bounds, &visible, sizeof(WD_RECT));
+    }
+
+    c->clip_count++;
+    return 0;
+}
+
+/* GdipRestoreGraphics() restores whole graphics state, including the world
+ * transformation. But the clip stack should not interfere with it, so we just
+ * make gdix_sync_transform() reinstall the current transformation. */
+static void
+gdix_restore_clip_state(gdix_canvas_t* c, dummy_GpGraphicsState state)
+{
+    gdix_vtable->fn_RestoreGraphics(c->graphics, state);
+    c->matrix_dirty = TRUE;
+}
+
+void
+gdix_restore_clip(gdix_canvas_t* c)
+{
+    if(c->clip_count == 0) {
+        WD_TRACE("gdix_restore_clip: Logical error: Clip stack underflow.");
+        return;
+    }
+
+    c->clip_count--;
+    gdix_restore_clip_state(c, c->clip_stack[c->clip_count].state);
+}
+
+void
+gdix_reset_clip(gdix_canvas_t* c)
+{
+    /* Restoring the bottom-most state discards all the states saved after
+     * it as well. */
+    if(c->clip_count > 0) {
+        gdix_restore_clip_state(c, c->clip_stack[0].state);
+        c->clip_count = 0;
+    }
+}
+
 void
 gdix_canvas_apply_string_flags(gdix_canvas_t* c, DWORD flags)
 {
@@ -460,12 +1053,26 @@ gdix_setpen(dummy_GpPen* pen, dummy_GpBrush* brush, float width, gdix_strokestyl
         gdix_vtable->fn_SetPenStartCap(pen, style->lineCap);
         gdix_vtable->fn_SetPenEndCap(pen, style->lineCap);
         gdix_vtable->fn_SetPenLineJoin(pen, style->lineJoin);
+        gdix_vtable->fn_SetPenMiterLimit(pen, style->miterLimit);
     }
 
     gdix_vtable->fn_SetPenBrushFill(pen, brush);
     gdix_vtable->fn_SetPenWidth(pen, width);
 }
 
+void
+gdix_init_rects(dummy_GpRectF* gp_rects, const WD_RECT* rects, UINT count)
+{
+    UINT i;
+
+    for(i = 0; i < count; i++) {
+        gp_rects[i].x = WD_MIN(rects[i].x0, rects[i].x1);
+        gp_rects[i].y = WD_MIN(rects[i].y0, rects[i].y1);
+        gp_rects[i].w = WD_ABS(rects[i].x1 - rects[i].x0);
+        gp_rects[i].h = WD_ABS(rects[i].y1 - rects[i].y0);
+    }
+}
+
 dummy_GpBitmap*
 gdix_bitmap_from_HBITMAP_with_alpha(HBITMAP bmp, BOOL has_premultiplied_alpha)
 {
@@ -505,8 +1112,11 @@ gdix_bitmap_from_HBITMAP_with_alpha(HBITMAP bmp, BOOL has_premultiplied_alpha)
     else
         pixel_format = WD_PIXELFORMAT_B8G8R8A8;
 
+    /* wdCreateImageFromHBITMAPWithAlpha() is captured as a whole. */
+    WD_CAPTURE_SUSPEND();
     b = (dummy_GpBitmap*) wdCreateImageFromBuffer(bmp_desc.bmWidth, bmp_desc.bmHeight,
                                                   stride, bits, pixel_format, NULL, 0);
+    WD_CAPTURE_RESUME();
 
     free(bits);
     return b;
@@ -25,6 +25,8 @@
 #define WD_BACKEND_GDIX_H
 
 #include "misc.h"
+#include "dirty.h"
+#include "stats.h"
 #include "dummy/gdiplus.h"
 
 
@@ -32,11 +34,38 @@ typedef struct gdix_strokestyle_tag gdix_strokestyle_t;
 struct gdix_strokestyle_tag {
   dummy_GpLineCap lineCap;
   dummy_GpLineJoin lineJoin;
+  float miterLimit;
   dummy_GpDashStyle dashStyle;
   UINT dashesCount;
   float dashes[1];
 };
 
+/* One level of the clip stack: Graphics state saved before the clipping was
+ * applied, and device-space bounds of the clip. */
+typedef struct gdix_clip_tag gdix_clip_t;
+struct gdix_clip_tag {
+    dummy_GpGraphicsState state;
+    WD_RECT bounds;
+};
+
+/* One level of the state stack (see wdSaveState()). */
+typedef struct gdix_state_tag gdix_state_t;
+struct gdix_state_tag {
+    WD_MATRIX matrix;
+    UINT clip_count;
+};
+
+/* Back buffer for double buffering. As the buffers are recycled (see
+ * gdix_buffer_get()), it may be bigger than the canvas. */
+typedef struct gdix_buffer_tag gdix_buffer_t;
+struct gdix_buffer_tag {
+    HDC dc;
+    HBITMAP bmp;
+    HBITMAP orig_bmp;
+    int cx;
+    int cy;
+};
+
 typedef struct gdix_canvas_tag gdix_canvas_t;
 struct gdix_canvas_tag {
     HDC dc;
@@ -44,15 +73,47 @@ struct gdix_canvas_tag {
     dummy_GpPen* pen;
     dummy_GpStringFormat* string_format;
     int dc_layout;
-    UINT width  : 31;
-    UINT rtl    :  1;
+    UINT width          : 28;
+    UINT rtl            :  1;
+    UINT matrix_dirty   :  1;   /* matrix not yet set to the graphics. */
+    UINT culling        :  1;   /* WD_CANVAS_CULLING */
+    UINT own_real_dc    :  1;   /* real_dc from GetDC(hwnd). */
 
-    HDC real_dc;        /* non-NULL if double buffering is enabled. */
-    HBITMAP orig_bmp;
+    /* If double buffering is enabled, real_dc is the target of the buffer.
+     * For a cached canvas, it is only valid during the painting. */
+    HDC real_dc;
+    gdix_buffer_t buffer;
+    HWND hwnd;          /* non-NULL if the canvas may be cached. */
     int x;
     int y;
     int cx;
     int cy;
+
+    /* Current transformation (including the RTL one, see
+     * gdix_reset_transform()). The graphics gets it only when something is
+     * about to be painted, see gdix_sync_transform(). */
+    WD_MATRIX matrix;
+    dummy_GpMatrix* gp_matrix;      /* Scratch object for gdix_sync_transform(). */
+
+    gdix_state_t* state_stack;
+    UINT state_count;
+    UINT state_capacity;
+
+    /* Clip stack (see wdPushClipRect()). */
+    gdix_clip_t* clip_stack;
+    UINT clip_count;
+    UINT clip_capacity;
+
+    /* For WD_CANVAS_CULLING (see wd_cull()). */
+    WD_RECT viewport;
+    UINT cull_tested;
+    UINT cull_culled;
+
+    /* See wdAddDirtyRect(). */
+    wd_dirty_t dirty;
+    BYTE cache_state;   /* See wd_canvas_cache_state(). */
+
+    wd_stats_t stats;
 };
 
 
@@ -65,6 +126,8 @@ struct gdix_vtable_tag {
     int (WINAPI* fn_GetDC)(dummy_GpGraphics*, HDC*);
     int (WINAPI* fn_ReleaseDC)(dummy_GpGraphics*, HDC);
     int (WINAPI* fn_ResetClip)(dummy_GpGraphics*);
+    int (WINAPI* fn_SaveGraphics)(dummy_GpGraphics*, dummy_GpGraphicsState*);
+    int (WINAPI* fn_RestoreGraphics)(dummy_GpGraphics*, dummy_GpGraphicsState);
     int (WINAPI* fn_ResetWorldTransform)(dummy_GpGraphics*);
     int (WINAPI* fn_RotateWorldTransform)(dummy_GpGraphics*, float, dummy_GpMatrixOrder);
     int (WINAPI* fn_ScaleWorldTransform)(dummy_GpGraphics*, float, float, dummy_GpMatrixOrder);
@@ -75,8 +138,10 @@ struct gdix_vtable_tag {
     int (WINAPI* fn_SetSmoothingMode)(dummy_GpGraphics*, dummy_GpSmoothingMode);
     int (WINAPI* fn_TranslateWorldTransform)(dummy_GpGraphics*, float, float, dummy_GpMatrixOrder);
     int (WINAPI* fn_MultiplyWorldTransform)(dummy_GpGraphics*, dummy_GpMatrix*, dummy_GpMatrixOrder);
+    int (WINAPI* fn_SetWorldTransform)(dummy_GpGraphics*, dummy_GpMatrix*);
     int (WINAPI* fn_CreateMatrix2)(float, float, float, float, float, float, dummy_GpMatrix**);
     int (WINAPI* fn_DeleteMatrix)(dummy_GpMatrix*);
+    int (WINAPI* fn_SetMatrixElements)(dummy_GpMatrix*, float, float, float, float, float, float);
 
     /* Brush functions */
     int (WINAPI* fn_CreateSolidFill)(dummy_ARGB, dummy_GpSolidFill**);
@@ -109,6 +174,8 @@ struct gdix_vtable_tag {
     int (WINAPI* fn_AddPathArc)(dummy_GpPath*, float, float, float, float, float, float);
     int (WINAPI* fn_AddPathBezier)(dummy_GpPath*, float, float, float, float, float, float, float, float);
     int (WINAPI* fn_AddPathLine)(dummy_GpPath*, float, float, float, float);
+    int (WINAPI* fn_AddPathLine2)(dummy_GpPath*, const dummy_GpPointF*, INT);
+    int (WINAPI* fn_AddPathBeziers)(dummy_GpPath*, const dummy_GpPointF*, INT);
 
     /* Font functions */
     int (WINAPI* fn_CreateFontFromLogfontW)(HDC, const LOGFONTW*, dummy_GpFont**);
@@ -153,15 +220,18 @@ struct gdix_vtable_tag {
     int (WINAPI* fn_DrawImageRectRect)(dummy_GpGraphics*, dummy_GpImage*, float, float, float, float, float, float, float, float, dummy_GpUnit, const void*, void*, void*);
     int (WINAPI* fn_DrawEllipse)(dummy_GpGraphics*, dummy_GpPen*, float, float, float, float);
     int (WINAPI* fn_DrawLine)(dummy_GpGraphics*, dummy_GpPen*, float, float, float, float);
+    int (WINAPI* fn_DrawLines)(dummy_GpGraphics*, dummy_GpPen*, const dummy_GpPointF*, INT);
     int (WINAPI* fn_DrawBezier)(dummy_GpGraphics*, dummy_GpPen*, float, float, float, float, float, float, float, float);
     int (WINAPI* fn_DrawPath)(dummy_GpGraphics*, dummy_GpPen*, dummy_GpPath*);
     int (WINAPI* fn_DrawPie)(dummy_GpGraphics*, dummy_GpPen*, float, float, float, float, float, float);
     int (WINAPI* fn_DrawRectangle)(dummy_GpGraphics*, void*, float, float, float, float);
+    int (WINAPI* fn_DrawRectangles)(dummy_GpGraphics*, void*, const dummy_GpRectF*, INT);
     int (WINAPI* fn_DrawString)(dummy_GpGraphics*, const WCHAR*, int, const dummy_GpFont*, const dummy_GpRectF*, const dummy_GpStringFormat*, const dummy_GpBrush*);
     int (WINAPI* fn_FillEllipse)(dummy_GpGraphics*, dummy_GpBrush*, float, float, float, float);
     int (WINAPI* fn_FillPath)(dummy_GpGraphics*, dummy_GpBrush*, dummy_GpPath*);
     int (WINAPI* fn_FillPie)(dummy_GpGraphics*, dummy_GpBrush*, float, float, float, float, float, float);
     int (WINAPI* fn_FillRectangle)(dummy_GpGraphics*, void*, float, float, float, float);
+    int (WINAPI* fn_FillRectangles)(dummy_GpGraphics*, void*, const dummy_GpRectF*, INT);
     int (WINAPI* fn_MeasureString)(dummy_GpGraphics*, const WCHAR*, int, const dummy_GpFont*, const dummy_GpRectF*, const dummy_GpStringFormat*, dummy_GpRectF*, int*, int*);
 };
 
@@ -180,14 +250,44 @@ void gdix_fini(void);
 
 
 /* Helpers */
-gdix_canvas_t* gdix_canvas_alloc(HDC dc, const RECT* doublebuffer_rect, UINT width, BOOL rtl);
+gdix_canvas_t* gdix_canvas_alloc(HDC dc, const RECT* doublebuffer_rect, UINT width, DWORD flags);
 void gdix_canvas_free(gdix_canvas_t* c);
+int gdix_canvas_resize(gdix_canvas_t* c, UINT width, UINT height);
+int gdix_canvas_rebind(gdix_canvas_t* c, HDC dc, const RECT* rect);
 void gdix_rtl_transform(gdix_canvas_t* c);
 void gdix_reset_transform(gdix_canvas_t* c);
+void gdix_apply_transform(gdix_canvas_t* c, const WD_MATRIX* matrix);
+void gdix_get_user_transform(gdix_canvas_t* c, WD_MATRIX* matrix);
+void gdix_set_user_transform(gdix_canvas_t* c, const WD_MATRIX* matrix);
+void gdix_sync_transform_(gdix_canvas_t* c);
 void gdix_delete_matrix(dummy_GpMatrix* m);
+int gdix_save_state(gdix_canvas_t* c);
+void gdix_restore_state(gdix_canvas_t* c);
+void gdix_reset_state(gdix_canvas_t* c);
+int gdix_save_clip(gdix_canvas_t* c, const WD_RECT* rect);
+void gdix_restore_clip(gdix_canvas_t* c);
+void gdix_reset_clip(gdix_canvas_t* c);
+void gdix_visible_bounds(gdix_canvas_t* c, WD_RECT* bounds);
 void gdix_canvas_apply_string_flags(gdix_canvas_t* c, DWORD flags);
 void gdix_setpen(dummy_GpPen* pen, dummy_GpBrush* brush, float width, gdix_strokestyle_t* style);
+
+/* GdipFillRectangles() and GdipDrawRectangles() get the rectangles converted
+ * in chunks of this size on the stack. */
+#define GDIX_RECT_CHUNK     64
+void gdix_init_rects(dummy_GpRectF* gp_rects, const WD_RECT* rects, UINT count);
+
+/* GdipAddPathLine2() and GdipAddPathBeziers() get the points in chunks of this
+ * size (a multiple of 3, so no Bezier curve is split), prefixed with the end
+ * point of the previous chunk. */
+#define GDIX_PATH_CHUNK     63
 dummy_GpBitmap* gdix_bitmap_from_HBITMAP_with_alpha(HBITMAP hBmp, BOOL has_premultiplied_alpha);
 
+static inline void
+gdix_sync_transform(gdix_canvas_t* c)
+{
+    if(c->matrix_dirty)
+        gdix_sync_transform_(c);
+}
+
 
 #endif  /* WD_BACKEND_GDIX_H */
@@ -0,0 +1,281 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "backend-ops.h"
+
+
+const WD_BACKEND_OPS* wd_backend_ops = NULL;
+
+
+int
+ops_init(const WD_BACKEND_OPS* ops)
+{
+    if(ops->fnInitialize != NULL  &&  !ops->fnInitialize()) {
+        WD_TRACE("ops_init: WD_BACKEND_OPS::fnInitialize() failed.");
+        return -1;
+    }
+
+    wd_backend_ops = ops;
+    return 0;
+}
+
+void
+ops_fini(void)
+{
+    if(wd_backend_ops->fnTerminate != NULL)
+        wd_backend_ops->fnTerminate();
+
+    wd_backend_ops = NULL;
+}
+
+ops_canvas_t*
+ops_canvas_alloc(HDC dc, UINT width, UINT height, DWORD flags)
+{
+    void* canvas;
+
+    canvas = wd_backend_ops->fnCreateCanvas(dc, width, height, flags);
+    if(canvas == NULL) {
+        WD_TRACE("ops_canvas_alloc: WD_BACKEND_OPS::fnCreateCanvas() failed.");
+        return NULL;
+    }
+
+    return ops_canvas_wrap(canvas, width, height, flags);
+}
+
+ops_canvas_t*
+ops_canvas_wrap(void* canvas, UINT width, UINT height, DWORD flags)
+{
+    ops_canvas_t* c;
+
+    c = (ops_canvas_t*) malloc(sizeof(ops_canvas_t));
+    if(c == NULL) {
+        WD_TRACE("ops_canvas_wrap: malloc() failed.");
+        wd_backend_ops->fnDestroyCanvas(canvas);
+        return NULL;
+    }
+
+    memset(c, 0, sizeof(ops_canvas_t));
+
+    c->canvas = canvas;
+    c->width = width;
+    c->rtl = ((flags & WD_CANVAS_LAYOUTRTL) ? TRUE : FALSE);
+    c->culling = ((flags & WD_CANVAS_CULLING) ? TRUE : FALSE);
+
+    c->viewport.x0 = 0.0f;
+    c->viewport.y0 = 0.0f;
+    c->viewport.x1 = (float) width;
+    c->viewport.y1 = (float) height;
+
+    ops_reset_transform(c);
+    return c;
+}
+
+void
+ops_canvas_free(ops_canvas_t* c)
+{
+    /* Check for common logical errors. */
+    if(c->clip_count > 0)
+        WD_TRACE("ops_canvas_free: Logical error: Canvas has dangling clip.");
+    if(c->state_count > 0)
+        WD_TRACE("ops_canvas_free: Logical error: Unpaired wdSaveState()/wdRestoreState().");
+
+    wd_backend_ops->fnDestroyCanvas(c->canvas);
+
+    free(c->clip_stack);
+    free(c->state_stack);
+    free(c);
+}
+
+/* For WD_CANVAS_LAYOUTRTL, the base transformation mirrors the X axis.
+ * Note the mirroring is inverse to itself. */
+static void
+ops_base_transform(ops_canvas_t* c, WD_MATRIX* m)
+{
+    m->m11 = (c->rtl ? -1.0f : 1.0f);
+    m->m12 = 0.0f;
+    m->m21 = 0.0f;
+    m->m22 = 1.0f;
+    m->dx = (c->rtl ? (float) c->width : 0.0f);
+    m->dy = 0.0f;
+}
+
+void
+ops_rtl_transform(ops_canvas_t* c)
+{
+    WD_MATRIX r;
+
+    ops_base_transform(c, &r);
+    wd_matrix_mult(&c->matrix, &c->matrix, &r);
+    c->matrix_dirty = TRUE;
+}
+
+void
+ops_reset_transform(ops_canvas_t* c)
+{
+    ops_base_transform(c, &c->matrix);
+    c->matrix_dirty = TRUE;
+}
+
+void
+ops_apply_transform(ops_canvas_t* c, const WD_MATRIX* matrix)
+{
+    wd_matrix_mult(&c->matrix, matrix, &c->matrix);
+    c->matrix_dirty = TRUE;
+}
+
+void
+ops_get_user_transform(ops_canvas_t* c, WD_MATRIX* matrix)
+{
+    WD_MATRIX base;
+
+    ops_base_transform(c, &base);
+    wd_matrix_mult(matrix, &c->matrix, &base);
+}
+
+void
+ops_set_user_transform(ops_canvas_t* c, const WD_MATRIX* matrix)
+{
+    WD_MATRIX base;
+
+    ops_base_transform(c, &base);
+    wd_matrix_mult(&c->matrix, matrix, &base);
+    c->matrix_dirty = TRUE;
+}
+
+int
+ops_save_state(ops_canvas_t* c)
+{
+    ops_state_t* state;
+
+    if(c->state_count >= c->state_capacity) {
+        UINT capacity = (c->state_capacity > 0 ? c->state_capacity * 2 : 4);
+        ops_state_t* stack;
+
+        stack = (ops_state_t*) realloc(c->state_stack, capacity * sizeof(ops_state_t));
+        if(stack == NULL) {
+            WD_TRACE("ops_save_state: realloc() failed.");
+            return -1;
+        }
+
+        c->state_stack = stack;
+        c->state_capacity = capacity;
+    }
+
+    state = &c->state_stack[c->state_count++];
+    memcpy(&state->matrix, &c->matrix, sizeof(WD_MATRIX));
+    state->clip_count = c->clip_count;
+    return 0;
+}
+
+void
+ops_restore_state(ops_canvas_t* c)
+{
+    ops_state_t* state;
+
+    if(c->state_count == 0) {
+        WD_TRACE("ops_restore_state: Logical error: State stack underflow.");
+        return;
+    }
+
+    state = &c->state_stack[--c->state_count];
+
+    if(memcmp(&c->matrix, &state->matrix, sizeof(WD_MATRIX)) != 0) {
+        memcpy(&c->matrix, &state->matrix, sizeof(WD_MATRIX));
+        c->matrix_dirty = TRUE;
+    }
+
+    while(c->clip_count > state->clip_count)
+        ops_pop_clip(c);
+}
+
+void
+ops_reset_state(ops_canvas_t* c)
+{
+    c->state_count = 0;
+    ops_reset_clip(c);
+}
+
+void
+ops_visible_bounds(ops_canvas_t* c, WD_RECT* bounds)
+{
+    if(c->clip_count > 0)
+        memcpy(bounds, &c->clip_stack[c->clip_count-1], sizeof(WD_RECT));
+    else
+        memcpy(bounds, &c->viewport, sizeof(WD_RECT));
+}
+
+void
+ops_push_clip(ops_canvas_t* c, const WD_RECT* rect, void* path)
+{
+    WD_RECT visible;
+    WD_RECT* bounds;
+
+    if(c->clip_count >= c->clip_capacity) {
+        UINT capacity = (c->clip_capacity > 0 ? c->clip_capacity * 2 : 4);
+        WD_RECT* stack;
+
+        stack = (WD_RECT*) realloc(c->clip_stack, capacity * sizeof(WD_RECT));
+        if(stack == NULL) {
+            WD_TRACE("ops_push_clip: realloc() failed.");
+            return;
+        }
+
+        c->clip_stack = stack;
+        c->clip_capacity = capacity;
+    }
+
+    ops_visible_bounds(c, &visible);
+    bounds = &c->clip_stack[c->clip_count];
+
+    if(rect != NULL) {
+        WD_RECT rect_bounds;
+
+        wd_bounds_transform(&c->matrix, rect, &rect_bounds);
+        wd_bounds_intersect(bounds, &visible, &rect_bounds);
+    } else {
+        memcpy(bounds, &visible, sizeof(WD_RECT));
+    }
+
+    ops_sync_transform(c);
+    wd_backend_ops->fnPushClip(c->canvas, rect, path);
+    c->clip_count++;
+}
+
+void
+ops_pop_clip(ops_canvas_t* c)
+{
+    if(c->clip_count == 0) {
+        WD_TRACE("ops_pop_clip: Logical error: Clip stack underflow.");
+        return;
+    }
+
+    wd_backend_ops->fnPopClip(c->canvas);
+    c->clip_count--;
+}
+
+void
+ops_reset_clip(ops_canvas_t* c)
+{
+    while(c->clip_count > 0)
+        ops_pop_clip(c);
+}
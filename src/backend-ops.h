@@ -0,0 +1,135 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef WD_BACKEND_OPS_H
+#define WD_BACKEND_OPS_H
+
+#include "misc.h"
+#include "dirty.h"
+#include "stats.h"
+
+
+/* Custom back-end installed by wdInitializeWithBackend(), or NULL. */
+extern const WD_BACKEND_OPS* wd_backend_ops;
+
+/* Single back-end builds (see WINDRAWLIB_BACKEND in CMakeLists.txt) have
+ * neither custom back-ends nor the software one, so the compiler drops the
+ * "if(ops_enabled()) ..." branch of every dispatch (see d2d_enabled()). */
+#if defined WD_D2D_ONLY  ||  defined WD_GDIPLUS_ONLY
+    #define ops_enabled()       FALSE
+#else
+static inline BOOL
+ops_enabled(void)
+{
+    return (wd_backend_ops != NULL);
+}
+#endif
+
+int ops_init(const WD_BACKEND_OPS* ops);
+void ops_fini(void);
+
+
+/* One level of the state stack (see wdSaveState()). */
+typedef struct ops_state_tag ops_state_t;
+struct ops_state_tag {
+    WD_MATRIX matrix;
+    UINT clip_count;
+};
+
+/* The back-end only paints. The canvas bookkeeping (transformation, state
+ * and clip stacks, culling and statistics) is ours, the same way as for
+ * the GDI+ back-end. */
+typedef struct ops_canvas_tag ops_canvas_t;
+struct ops_canvas_tag {
+    void* canvas;       /* The back-end's canvas. */
+    UINT width          : 30;
+    UINT rtl            :  1;
+    UINT culling        :  1;   /* WD_CANVAS_CULLING */
+    BOOL matrix_dirty;          /* matrix not yet set to the back-end. */
+
+    /* Current transformation (including the RTL one, see
+     * ops_reset_transform()). */
+    WD_MATRIX matrix;
+
+    ops_state_t* state_stack;
+    UINT state_count;
+    UINT state_capacity;
+
+    /* Device-space bounds of each clip level (see wdPushClipRect()). */
+    WD_RECT* clip_stack;
+    UINT clip_count;
+    UINT clip_capacity;
+
+    /* For WD_CANVAS_CULLING (see wd_cull()). */
+    WD_RECT viewport;
+    UINT cull_tested;
+    UINT cull_culled;
+
+    /* See wdAddDirtyRect(). */
+    wd_dirty_t dirty;
+    BYTE cache_state;   /* See wd_canvas_cache_state(). */
+
+    wd_stats_t stats;
+};
+
+ops_canvas_t* ops_canvas_alloc(HDC dc, UINT width, UINT height, DWORD flags);
+/* Like ops_canvas_alloc() but for an already created back-end canvas.
+ * On failure, the back-end canvas gets destroyed. */
+ops_canvas_t* ops_canvas_wrap(void* canvas, UINT width, UINT height, DWORD flags);
+void ops_canvas_free(ops_canvas_t* c);
+
+/* The back-end's canvas of a possibly NULL handle. */
+static inline void*
+ops_canvas(WD_HCANVAS hCanvas)
+{
+    return (hCanvas != NULL ? ((ops_canvas_t*) hCanvas)->canvas : NULL);
+}
+
+void ops_rtl_transform(ops_canvas_t* c);
+void ops_reset_transform(ops_canvas_t* c);
+void ops_apply_transform(ops_canvas_t* c, const WD_MATRIX* matrix);
+void ops_get_user_transform(ops_canvas_t* c, WD_MATRIX* matrix);
+void ops_set_user_transform(ops_canvas_t* c, const WD_MATRIX* matrix);
+
+/* Hands the current transformation over to the back-end before anything
+ * is painted or clipped, if it has changed. */
+static inline void
+ops_sync_transform(ops_canvas_t* c)
+{
+    if(c->matrix_dirty) {
+        wd_backend_ops->fnSetTransform(c->canvas, &c->matrix);
+        c->matrix_dirty = FALSE;
+    }
+}
+
+int ops_save_state(ops_canvas_t* c);
+void ops_restore_state(ops_canvas_t* c);
+void ops_reset_state(ops_canvas_t* c);
+
+void ops_visible_bounds(ops_canvas_t* c, WD_RECT* bounds);
+void ops_push_clip(ops_canvas_t* c, const WD_RECT* rect, void* path);
+void ops_pop_clip(ops_canvas_t* c);
+void ops_reset_clip(ops_canvas_t* c);
+
+
+#endif  /* WD_BACKEND_OPS_H */
@@ -0,0 +1,1478 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "backend-sw.h"
+#include "swrast.h"
+
+
+#define SW_LUT_SIZE         256     /* Gradient color table. */
+
+/* Exact x / 255 (rounded) for x <= 255 * 255. */
+#define SW_DIV255(x)        ((((x) + 128) + (((x) + 128) >> 8)) >> 8)
+
+
+/* One level of the clip stack. */
+typedef struct sw_clip_tag sw_clip_t;
+struct sw_clip_tag {
+    int x0;             /* Clip box in device pixels. */
+    int y0;
+    int x1;
+    int y1;
+    BYTE* mask;         /* Coverage of all canvas pixels, or NULL if the box
+                         * is all there is to the clip. */
+    BOOL own_mask;      /* Set if the mask belongs to this level (and is not
+                         * inherited from the outer one). */
+};
+
+typedef struct sw_canvas_tag sw_canvas_t;
+struct sw_canvas_tag {
+    BYTE* bits;
+    UINT width;
+    UINT height;
+    UINT stride;
+    BOOL own_bits;
+
+    /* Where fnEndPaint presents the buffer (none if dc is NULL). */
+    HDC dc;
+    int dc_x;
+    int dc_y;
+
+    WD_MATRIX matrix;
+
+    sw_clip_t clip;
+    sw_clip_t* clip_stack;
+    UINT clip_count;
+    UINT clip_capacity;
+
+    /* Scratch buffers, reused from call to call. */
+    sw_path_t path;
+    sw_poly_t poly;
+    sw_poly_t outline;
+    sw_poly_t dashes;
+    sw_rast_t rast;
+    UINT32* span;       /* One row of brush or image pixels. */
+    BYTE* coverage;     /* One row of coverage (see sw_canvas_fill_spans()). */
+};
+
+#define SW_BRUSH_SOLID      0
+#define SW_BRUSH_LINEAR     1
+#define SW_BRUSH_RADIAL     2
+
+typedef struct sw_brush_tag sw_brush_t;
+struct sw_brush_tag {
+    int type;
+    UINT32 color;       /* SW_BRUSH_SOLID (pre-multiplied). */
+    WD_POINT p0;        /* Start point (linear) or center (radial). */
+    WD_POINT p1;        /* End point (linear) or focus (radial). */
+    float r;            /* Radius (radial). */
+    UINT32 lut[1];      /* SW_LUT_SIZE pre-multiplied colors (gradients). */
+};
+
+typedef struct sw_strokestyle_tag sw_strokestyle_t;
+struct sw_strokestyle_tag {
+    UINT line_cap;
+    UINT line_join;
+    float miter_limit;
+    UINT dash_count;
+    float dashes[1];
+};
+
+typedef struct sw_image_tag sw_image_t;
+struct sw_image_tag {
+    UINT width;
+    UINT height;
+    UINT32 pixels[1];
+};
+
+typedef struct sw_font_tag sw_font_t;
+struct sw_font_tag {
+    float size;
+};
+
+
+static inline BOOL
+sw_is_integral(float x)
+{
+    return (WD_ABS(x - floorf(x + 0.5f)) < (1.0f / 256.0f));
+}
+
+/* Flattening tolerance in the user space, for the current transformation. */
+static float
+sw_tolerance(const sw_canvas_t* c)
+{
+    const WD_MATRIX* m = &c->matrix;
+    float sx = m->m11 * m->m11 + m->m12 * m->m12;
+    float sy = m->m21 * m->m21 + m->m22 * m->m22;
+    float scale = sqrtf(WD_MAX(sx, sy));
+
+    return (scale > 1e-6f ? SW_TOLERANCE / scale : SW_TOLERANCE);
+}
+
+static inline BOOL
+sw_clip_empty(const sw_clip_t* clip)
+{
+    return (clip->x0 >= clip->x1  ||  clip->y0 >= clip->y1);
+}
+
+static void
+sw_apply_mask(BYTE* coverage, const BYTE* mask, int n)
+{
+    int i;
+
+    for(i = 0; i < n; i++) {
+        UINT k = coverage[i] * mask[i];
+        coverage[i] = (BYTE) SW_DIV255(k);
+    }
+}
+
+
+/***************
+ ***  Spans  ***
+ ***************/
+
+/* What sw_paint_span() paints with. */
+typedef struct sw_paint_tag sw_paint_t;
+struct sw_paint_tag {
+    sw_canvas_t* c;
+    const sw_brush_t* brush;    /* NULL when painting an image. */
+    const sw_image_t* image;
+    WD_MATRIX inv;              /* Device space --> brush (or image) space. */
+
+    /* Images only: */
+    BOOL copy;                  /* inv is an integral translation. */
+    float sx0;                  /* Sampled pixels (the source rectangle). */
+    float sy0;
+    float sx1;
+    float sy1;
+};
+
+static inline UINT32
+sw_lut_lookup(const sw_brush_t* b, float t)
+{
+    if(t <= 0.0f)
+        return b->lut[0];
+    if(t >= 1.0f)
+        return b->lut[SW_LUT_SIZE - 1];
+    return b->lut[(int) (t * (float) (SW_LUT_SIZE - 1) + 0.5f)];
+}
+
+static void
+sw_fetch_gradient(const sw_paint_t* p, int y, int x0, int n, UINT32* span)
+{
+    const sw_brush_t* b = p->brush;
+    const WD_MATRIX* m = &p->inv;
+    float px = (float) x0 + 0.5f;
+    float py = (float) y + 0.5f;
+    float ux = px * m->m11 + py * m->m21 + m->dx;
+    float uy = px * m->m12 + py * m->m22 + m->dy;
+    int i;
+
+    if(b->type == SW_BRUSH_LINEAR) {
+        float dx = b->p1.x - b->p0.x;
+        float dy = b->p1.y - b->p0.y;
+        float len2 = dx * dx + dy * dy;
+        float t, dt;
+
+        if(len2 < 1e-12f) {
+            for(i = 0; i < n; i++)
+                span[i] = b->lut[SW_LUT_SIZE - 1];
+            return;
+        }
+
+        /* Project on the gradient line. */
+        t = ((ux - b->p0.x) * dx + (uy - b->p0.y) * dy) / len2;
+        dt = (m->m11 * dx + m->m12 * dy) / len2;
+        for(i = 0; i < n; i++) {
+            span[i] = sw_lut_lookup(b, t);
+            t += dt;
+        }
+    } else {
+        /* Find t such that the point lies on the circle of the radius t*r
+         * and the center focus + t*(center - focus), i.e. solve
+         * (e.e - r^2) t^2 - 2 (d.e) t + d.d = 0 with d = point - focus and
+         * e = center - focus. */
+        float ex = b->p0.x - b->p1.x;
+        float ey = b->p0.y - b->p1.y;
+        float a = ex * ex + ey * ey - b->r * b->r;
+
+        for(i = 0; i < n; i++) {
+            float dx = ux - b->p1.x;
+            float dy = uy - b->p1.y;
+            float de = dx * ex + dy * ey;
+            float dd = dx * dx + dy * dy;
+            float t;
+
+            if(WD_ABS(a) < 1e-6f) {
+                t = (de != 0.0f ? dd / (2.0f * de) : 0.0f);
+            } else {
+                float disc = de * de - a * dd;
+                t = (de - sqrtf(WD_MAX(disc, 0.0f))) / a;
+            }
+
+            span[i] = sw_lut_lookup(b, t);
+            ux += m->m11;
+            uy += m->m12;
+        }
+    }
+}
+
+/* Weighted average of two pixels, w in 0 ... 256. */
+static inline UINT32
+sw_lerp(UINT32 a, UINT32 b, UINT w)
+{
+    UINT32 rb = ((a & 0x00ff00ff) * (256 - w) + (b & 0x00ff00ff) * w) >> 8;
+    UINT32 ag = ((a >> 8) & 0x00ff00ff) * (256 - w) + ((b >> 8) & 0x00ff00ff) * w;
+
+    return (rb & 0x00ff00ff) | (ag & 0xff00ff00);
+}
+
+static void
+sw_fetch_image(const sw_paint_t* p, int y, int x0, int n, UINT32* span)
+{
+    const sw_image_t* img = p->image;
+    const WD_MATRIX* m = &p->inv;
+    float px = (float) x0 + 0.5f;
+    float py = (float) y + 0.5f;
+    float sx = px * m->m11 + py * m->m21 + m->dx;
+    float sy = px * m->m12 + py * m->m22 + m->dy;
+    int i;
+
+    if(p->copy) {
+        /* Pixel centers map onto pixel centers: No filtering needed. */
+        int ix0 = (int) ceilf(p->sx0);
+        int ix1 = (int) floorf(p->sx1);
+        int ix = (int) floorf(sx);
+        int iy = (int) floorf(sy);
+        const UINT32* row;
+
+        iy = WD_MAX(iy, (int) ceilf(p->sy0));
+        iy = WD_MIN(iy, (int) floorf(p->sy1));
+        row = img->pixels + iy * img->width;
+        for(i = 0; i < n; i++) {
+            int k = WD_MIN(WD_MAX(ix + i, ix0), ix1);
+            span[i] = row[k];
+        }
+        return;
+    }
+
+    /* Bilinear filtering. */
+    for(i = 0; i < n; i++) {
+        float fx = WD_MIN(WD_MAX(sx - 0.5f, p->sx0), p->sx1);
+        float fy = WD_MIN(WD_MAX(sy - 0.5f, p->sy0), p->sy1);
+        int ix = (int) fx;
+        int iy = (int) fy;
+        int ix1 = WD_MIN(ix + 1, (int) img->width - 1);
+        int iy1 = WD_MIN(iy + 1, (int) img->height - 1);
+        UINT wx = (UINT) ((fx - (float) ix) * 256.0f);
+        UINT wy = (UINT) ((fy - (float) iy) * 256.0f);
+        const UINT32* row0 = img->pixels + iy * img->width;
+        const UINT32* row1 = img->pixels + iy1 * img->width;
+
+        span[i] = sw_lerp(sw_lerp(row0[ix], row0[ix1], wx),
+                          sw_lerp(row1[ix], row1[ix1], wx), wy);
+        sx += m->m11;
+        sy += m->m12;
+    }
+}
+
+static void
+sw_paint_span(void* ctx, int y, int x0, int x1, BYTE* coverage)
+{
+    sw_paint_t* p = (sw_paint_t*) ctx;
+    sw_canvas_t* c = p->c;
+    UINT32* dst = (UINT32*) (c->bits + y * c->stride) + x0;
+    int n = x1 - x0;
+
+    if(c->clip.mask != NULL)
+        sw_apply_mask(coverage, c->clip.mask + y * c->width + x0, n);
+
+    if(p->image != NULL) {
+        sw_fetch_image(p, y, x0, n, c->span);
+        sw_blend_span(dst, c->span, coverage, n);
+    } else if(p->brush->type == SW_BRUSH_SOLID) {
+        sw_blend_solid(dst, p->brush->color, coverage, n);
+    } else {
+        sw_fetch_gradient(p, y, x0, n, c->span);
+        sw_blend_span(dst, c->span, coverage, n);
+    }
+}
+
+static BOOL
+sw_paint_init(sw_paint_t* p, sw_canvas_t* c, const sw_brush_t* b)
+{
+    p->c = c;
+    p->brush = b;
+    p->image = NULL;
+
+    /* Gradients are evaluated in the user space. */
+    if(b->type != SW_BRUSH_SOLID  &&  !wd_matrix_invert(&c->matrix, &p->inv))
+        return FALSE;
+    return TRUE;
+}
+
+/* Paints the polygon (in device space) clipped by the current clip. */
+static void
+sw_paint_poly(sw_canvas_t* c, const sw_poly_t* poly, int fill_rule, sw_paint_t* p)
+{
+    if(poly->error) {
+        WD_TRACE("sw_paint_poly: Out of memory.");
+        return;
+    }
+
+    if(sw_clip_empty(&c->clip))
+        return;
+
+    if(sw_rasterize(&c->rast, poly, fill_rule, c->clip.x0, c->clip.y0,
+                c->clip.x1, c->clip.y1, sw_paint_span, p) != 0)
+        WD_TRACE("sw_paint_poly: sw_rasterize() failed.");
+}
+
+static void
+sw_fill_path(sw_canvas_t* c, void* brush, const sw_path_t* path)
+{
+    sw_paint_t paint;
+
+    if(!sw_paint_init(&paint, c, (sw_brush_t*) brush))
+        return;
+
+    sw_poly_reset(&c->poly);
+    sw_poly_flatten(&c->poly, path, sw_tolerance(c));
+    sw_poly_transform(&c->poly, &c->matrix);
+    sw_paint_poly(c, &c->poly, path->fill_rule, &paint);
+}
+
+static void
+sw_stroke_path(sw_canvas_t* c, void* brush, const sw_path_t* path,
+               float width, void* style)
+{
+    sw_strokestyle_t* s = (sw_strokestyle_t*) style;
+    sw_paint_t paint;
+    sw_stroke_t stroke;
+    float tolerance;
+
+    if(width <= 0.0f)
+        return;
+    if(!sw_paint_init(&paint, c, (sw_brush_t*) brush))
+        return;
+
+    stroke.width = width;
+    if(s != NULL) {
+        stroke.line_cap = s->line_cap;
+        stroke.line_join = s->line_join;
+        stroke.miter_limit = s->miter_limit;
+        stroke.dashes = s->dashes;
+        stroke.dash_count = s->dash_count;
+    } else {
+        stroke.line_cap = WD_LINECAP_FLAT;
+        stroke.line_join = WD_LINEJOIN_MITER;
+        stroke.miter_limit = WD_MITER_LIMIT;
+        stroke.dashes = NULL;
+        stroke.dash_count = 0;
+    }
+
+    tolerance = sw_tolerance(c);
+    sw_poly_reset(&c->poly);
+    sw_poly_flatten(&c->poly, path, tolerance);
+    sw_poly_reset(&c->outline);
+    sw_poly_stroke(&c->outline, &c->poly, &stroke, tolerance, &c->dashes);
+    sw_poly_transform(&c->outline, &c->matrix);
+    sw_paint_poly(c, &c->outline, SW_FILL_WINDING, &paint);
+}
+
+
+/****************
+ ***  Canvas  ***
+ ****************/
+
+static sw_canvas_t*
+sw_canvas_alloc(BYTE* bits, UINT width, UINT height, UINT stride, BOOL own_bits)
+{
+    sw_canvas_t* c;
+
+    c = (sw_canvas_t*) malloc(sizeof(sw_canvas_t));
+    if(c == NULL) {
+        WD_TRACE("sw_canvas_alloc: malloc() failed.");
+        return NULL;
+    }
+
+    memset(c, 0, sizeof(sw_canvas_t));
+
+    c->span = (UINT32*) malloc(WD_MAX(width, 1) * sizeof(UINT32));
+    c->coverage = (BYTE*) malloc(WD_MAX(width, 1));
+    if(c->span == NULL  ||  c->coverage == NULL) {
+        WD_TRACE("sw_canvas_alloc: malloc() failed.");
+        free(c->span);
+        free(c->coverage);
+        free(c);
+        return NULL;
+    }
+
+    c->bits = bits;
+    c->width = width;
+    c->height = height;
+    c->stride = stride;
+    c->own_bits = own_bits;
+
+    c->matrix.m11 = 1.0f;
+    c->matrix.m22 = 1.0f;
+
+    c->clip.x1 = (int) width;
+    c->clip.y1 = (int) height;
+
+    sw_path_init(&c->path);
+    sw_poly_init(&c->poly);
+    sw_poly_init(&c->outline);
+    sw_poly_init(&c->dashes);
+    sw_rast_init(&c->rast);
+    return c;
+}
+
+static void*
+sw_create_canvas(HDC dc, UINT width, UINT height, DWORD flags)
+{
+    sw_canvas_t* c;
+    BYTE* bits;
+
+    bits = (BYTE*) calloc(WD_MAX(width * height, 1), 4);
+    if(bits == NULL) {
+        WD_TRACE("sw_create_canvas: calloc() failed.");
+        return NULL;
+    }
+
+    c = sw_canvas_alloc(bits, width, height, width * 4, TRUE);
+    if(c == NULL) {
+        WD_TRACE("sw_create_canvas: sw_canvas_alloc() failed.");
+        free(bits);
+        return NULL;
+    }
+
+    c->dc = dc;
+    return c;
+}
+
+void*
+sw_canvas_create_with_buffer(void* bits, UINT width, UINT height, UINT stride)
+{
+    return sw_canvas_alloc((BYTE*) bits, width, height, stride, FALSE);
+}
+
+void
+sw_canvas_set_origin(void* canvas, int x, int y)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    c->dc_x = x;
+    c->dc_y = y;
+}
+
+static void
+sw_pop_clip(void* canvas)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    if(c->clip_count == 0)
+        return;
+
+    if(c->clip.own_mask)
+        free(c->clip.mask);
+    c->clip = c->clip_stack[--c->clip_count];
+}
+
+static void
+sw_destroy_canvas(void* canvas)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    while(c->clip_count > 0)
+        sw_pop_clip(c);
+
+    sw_rast_fini(&c->rast);
+    sw_poly_fini(&c->dashes);
+    sw_poly_fini(&c->outline);
+    sw_poly_fini(&c->poly);
+    sw_path_fini(&c->path);
+    free(c->clip_stack);
+    free(c->span);
+    free(c->coverage);
+    if(c->own_bits)
+        free(c->bits);
+    free(c);
+}
+
+static void
+sw_begin_paint(void* canvas)
+{
+    /* noop */
+}
+
+/* Copies the rectangle of the buffer to the DC. */
+static BOOL
+sw_present(sw_canvas_t* c, int x0, int y0, int x1, int y1)
+{
+    BITMAPINFO bmi;
+
+    x0 = WD_MAX(x0, 0);
+    y0 = WD_MAX(y0, 0);
+    x1 = WD_MIN(x1, (int) c->width);
+    y1 = WD_MIN(y1, (int) c->height);
+    if(x0 >= x1  ||  y0 >= y1)
+        return TRUE;
+
+    /* Describe just the rows to copy as a top-down DIB. */
+    memset(&bmi, 0, sizeof(BITMAPINFO));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = (LONG) c->width;
+    bmi.bmiHeader.biHeight = -(LONG) (y1 - y0);
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    if(SetDIBitsToDevice(c->dc, c->dc_x + x0, c->dc_y + y0, x1 - x0, y1 - y0,
+                x0, 0, 0, y1 - y0, c->bits + y0 * c->stride, &bmi, DIB_RGB_COLORS) == 0) {
+        WD_TRACE_ERR("sw_present: SetDIBitsToDevice() failed.");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static BOOL
+sw_end_paint(void* canvas)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    if(c->dc == NULL)
+        return TRUE;
+
+    return sw_present(c, 0, 0, (int) c->width, (int) c->height);
+}
+
+static BOOL
+sw_end_paint_rects(void* canvas, const RECT* rects, UINT count)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+    BOOL ret = TRUE;
+    UINT i;
+
+    if(c->dc == NULL)
+        return TRUE;
+
+    for(i = 0; i < count; i++) {
+        if(!sw_present(c, rects[i].left, rects[i].top, rects[i].right, rects[i].bottom))
+            ret = FALSE;
+    }
+
+    return ret;
+}
+
+static BOOL
+sw_resize_canvas(void* canvas, UINT width, UINT height)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+    BYTE* bits;
+    UINT32* span;
+    BYTE* coverage;
+
+    if(!c->own_bits) {
+        WD_TRACE("sw_resize_canvas: Cannot resize a canvas of a foreign buffer.");
+        return FALSE;
+    }
+
+    if(c->clip_count > 0) {
+        WD_TRACE("sw_resize_canvas: Logical error: Canvas has dangling clip.");
+        return FALSE;
+    }
+
+    bits = (BYTE*) calloc(WD_MAX(width * height, 1), 4);
+    span = (UINT32*) malloc(WD_MAX(width, 1) * sizeof(UINT32));
+    coverage = (BYTE*) malloc(WD_MAX(width, 1));
+    if(bits == NULL  ||  span == NULL  ||  coverage == NULL) {
+        WD_TRACE("sw_resize_canvas: Out of memory.");
+        free(bits);
+        free(span);
+        free(coverage);
+        return FALSE;
+    }
+
+    free(c->bits);
+    free(c->span);
+    free(c->coverage);
+    c->bits = bits;
+    c->span = span;
+    c->coverage = coverage;
+    c->width = width;
+    c->height = height;
+    c->stride = width * 4;
+    c->clip.x0 = 0;
+    c->clip.y0 = 0;
+    c->clip.x1 = (int) width;
+    c->clip.y1 = (int) height;
+    return TRUE;
+}
+
+/* The pixels are kept if the size does not change. (The origin in the DC is
+ * set by sw_canvas_set_origin().) */
+static BOOL
+sw_rebind_canvas(void* canvas, HDC dc, UINT width, UINT height)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    if(width != c->width  ||  height != c->height) {
+        if(!sw_resize_canvas(canvas, width, height))
+            return FALSE;
+    }
+
+    c->dc = dc;
+    return TRUE;
+}
+
+static void
+sw_clear(void* canvas, WD_COLOR color)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+    UINT32 px = sw_premultiply(color);
+    int x, y;
+
+    for(y = c->clip.y0; y < c->clip.y1; y++) {
+        UINT32* row = (UINT32*) (c->bits + y * c->stride);
+
+        if(c->clip.mask != NULL) {
+            sw_blend_copy(row + c->clip.x0, px,
+                    c->clip.mask + y * c->width + c->clip.x0,
+                    c->clip.x1 - c->clip.x0);
+        } else {
+            for(x = c->clip.x0; x < c->clip.x1; x++)
+                row[x] = px;
+        }
+    }
+}
+
+static void
+sw_set_transform(void* canvas, const WD_MATRIX* matrix)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    memcpy(&c->matrix, matrix, sizeof(WD_MATRIX));
+}
+
+
+/* sw_rasterize() callback building the mask of a new clip level. */
+typedef struct sw_mask_tag sw_mask_t;
+struct sw_mask_tag {
+    sw_canvas_t* c;
+    BYTE* mask;
+    int x0;             /* Bounds of non-zero coverage. */
+    int y0;
+    int x1;
+    int y1;
+};
+
+static void
+sw_mask_span(void* ctx, int y, int x0, int x1, BYTE* coverage)
+{
+    sw_mask_t* m = (sw_mask_t*) ctx;
+    sw_canvas_t* c = m->c;
+    int n = x1 - x0;
+    int i0, i1;
+
+    if(c->clip.mask != NULL)
+        sw_apply_mask(coverage, c->clip.mask + y * c->width + x0, n);
+    memcpy(m->mask + y * c->width + x0, coverage, n);
+
+    for(i0 = 0; i0 < n  &&  coverage[i0] == 0; i0++);
+    if(i0 == n)
+        return;
+    for(i1 = n; coverage[i1 - 1] == 0; i1--);
+
+    m->x0 = WD_MIN(m->x0, x0 + i0);
+    m->x1 = WD_MAX(m->x1, x0 + i1);
+    m->y0 = WD_MIN(m->y0, y);
+    m->y1 = WD_MAX(m->y1, y + 1);
+}
+
+/* Intersects the current clip with the polygon (in device space). */
+static void
+sw_clip_poly(sw_canvas_t* c, const sw_poly_t* poly, int fill_rule)
+{
+    sw_mask_t m;
+
+    if(sw_clip_empty(&c->clip))
+        return;
+
+    if(poly->error) {
+        WD_TRACE("sw_clip_poly: Out of memory.");
+        return;
+    }
+
+    m.c = c;
+    m.mask = (BYTE*) calloc(c->width, c->height);
+    if(m.mask == NULL) {
+        WD_TRACE("sw_clip_poly: calloc() failed.");
+        return;
+    }
+    m.x0 = c->clip.x1;
+    m.y0 = c->clip.y1;
+    m.x1 = c->clip.x0;
+    m.y1 = c->clip.y0;
+
+    if(sw_rasterize(&c->rast, poly, fill_rule, c->clip.x0, c->clip.y0,
+                c->clip.x1, c->clip.y1, sw_mask_span, &m) != 0) {
+        WD_TRACE("sw_clip_poly: sw_rasterize() failed.");
+        free(m.mask);
+        return;
+    }
+
+    if(c->clip.own_mask)
+        free(c->clip.mask);
+    c->clip.mask = m.mask;
+    c->clip.own_mask = TRUE;
+    c->clip.x0 = m.x0;
+    c->clip.y0 = m.y0;
+    c->clip.x1 = WD_MAX(m.x1, m.x0);
+    c->clip.y1 = WD_MAX(m.y1, m.y0);
+}
+
+static void
+sw_clip_path(sw_canvas_t* c, const sw_path_t* path)
+{
+    sw_poly_reset(&c->poly);
+    sw_poly_flatten(&c->poly, path, sw_tolerance(c));
+    sw_poly_transform(&c->poly, &c->matrix);
+    sw_clip_poly(c, &c->poly, path->fill_rule);
+}
+
+static void
+sw_clip_rect(sw_canvas_t* c, const WD_RECT* rect)
+{
+    const WD_MATRIX* m = &c->matrix;
+
+    /* Pixel-aligned rectangles just shrink the clip box. Anything else
+     * needs a mask. */
+    if(m->m12 == 0.0f  &&  m->m21 == 0.0f) {
+        float x0 = rect->x0 * m->m11 + m->dx;
+        float y0 = rect->y0 * m->m22 + m->dy;
+        float x1 = rect->x1 * m->m11 + m->dx;
+        float y1 = rect->y1 * m->m22 + m->dy;
+
+        if(sw_is_integral(x0) && sw_is_integral(y0) &&
+           sw_is_integral(x1) && sw_is_integral(y1))
+        {
+            int ix0 = (int) floorf(WD_MIN(x0, x1) + 0.5f);
+            int iy0 = (int) floorf(WD_MIN(y0, y1) + 0.5f);
+            int ix1 = (int) floorf(WD_MAX(x0, x1) + 0.5f);
+            int iy1 = (int) floorf(WD_MAX(y0, y1) + 0.5f);
+
+            c->clip.x0 = WD_MAX(c->clip.x0, ix0);
+            c->clip.y0 = WD_MAX(c->clip.y0, iy0);
+            c->clip.x1 = WD_MAX(WD_MIN(c->clip.x1, ix1), c->clip.x0);
+            c->clip.y1 = WD_MAX(WD_MIN(c->clip.y1, iy1), c->clip.y0);
+            return;
+        }
+    }
+
+    sw_path_reset(&c->path);
+    sw_path_rect(&c->path, rect->x0, rect->y0, rect->x1, rect->y1);
+    sw_clip_path(c, &c->path);
+}
+
+static void
+sw_push_clip(void* canvas, const WD_RECT* rect, void* path)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    if(c->clip_count >= c->clip_capacity) {
+        UINT capacity = (c->clip_capacity > 0 ? 2 * c->clip_capacity : 8);
+        sw_clip_t* stack;
+
+        stack = (sw_clip_t*) realloc(c->clip_stack, capacity * sizeof(sw_clip_t));
+        if(stack == NULL) {
+            WD_TRACE("sw_push_clip: realloc() failed.");
+            return;
+        }
+        c->clip_stack = stack;
+        c->clip_capacity = capacity;
+    }
+
+    /* The new level starts as a copy of the current one. */
+    c->clip_stack[c->clip_count++] = c->clip;
+    c->clip.own_mask = FALSE;
+
+    if(rect != NULL)
+        sw_clip_rect(c, rect);
+    if(path != NULL)
+        sw_clip_path(c, (sw_path_t*) path);
+}
+
+
+/***********************************
+ ***  Brushes and Stroke Styles  ***
+ ***********************************/
+
+static sw_brush_t*
+sw_brush_alloc(int type, UINT lut_size)
+{
+    sw_brush_t* b;
+
+    b = (sw_brush_t*) malloc(sizeof(sw_brush_t) + (WD_MAX(lut_size, 1) - 1) * sizeof(UINT32));
+    if(b == NULL) {
+        WD_TRACE("sw_brush_alloc: malloc() failed.");
+        return NULL;
+    }
+
+    memset(b, 0, WD_OFFSETOF(sw_brush_t, lut));
+    b->type = type;
+    return b;
+}
+
+static void*
+sw_create_solid_brush(void* canvas, WD_COLOR color)
+{
+    sw_brush_t* b;
+
+    b = sw_brush_alloc(SW_BRUSH_SOLID, 0);
+    if(b != NULL)
+        b->color = sw_premultiply(color);
+    return b;
+}
+
+static WD_COLOR
+sw_mix_colors(WD_COLOR a, WD_COLOR b, float t)
+{
+    UINT ca = (UINT) ((float) WD_AVALUE(a) + t * ((float) WD_AVALUE(b) - (float) WD_AVALUE(a)) + 0.5f);
+    UINT cr = (UINT) ((float) WD_RVALUE(a) + t * ((float) WD_RVALUE(b) - (float) WD_RVALUE(a)) + 0.5f);
+    UINT cg = (UINT) ((float) WD_GVALUE(a) + t * ((float) WD_GVALUE(b) - (float) WD_GVALUE(a)) + 0.5f);
+    UINT cb = (UINT) ((float) WD_BVALUE(a) + t * ((float) WD_BVALUE(b) - (float) WD_BVALUE(a)) + 0.5f);
+
+    return WD_ARGB(ca, cr, cg, cb);
+}
+
+/* Samples the gradient stops into the color table. */
+static void
+sw_gradient_lut(UINT32* lut, const WD_COLOR* colors, const float* offsets, UINT n)
+{
+    UINT i;
+    UINT k = 0;
+
+    for(i = 0; i < SW_LUT_SIZE; i++) {
+        float t = (float) i / (float) (SW_LUT_SIZE - 1);
+        WD_COLOR color;
+
+        while(k + 1 < n  &&  offsets[k + 1] < t)
+            k++;
+
+        if(t <= offsets[0]) {
+            color = colors[0];
+        } else if(k + 1 >= n) {
+            color = colors[n - 1];
+        } else {
+            float d = offsets[k + 1] - offsets[k];
+            color = (d > 0.0f ? sw_mix_colors(colors[k], colors[k + 1],
+                                (t - offsets[k]) / d) : colors[k + 1]);
+        }
+
+        lut[i] = sw_premultiply(color);
+    }
+}
+
+static void*
+sw_create_linear_gradient_brush(void* canvas, float x0, float y0, float x1, float y1,
+                const WD_COLOR* colors, const float* offsets, UINT n)
+{
+    sw_brush_t* b;
+
+    b = sw_brush_alloc(SW_BRUSH_LINEAR, SW_LUT_SIZE);
+    if(b == NULL)
+        return NULL;
+
+    b->p0.x = x0;
+    b->p0.y = y0;
+    b->p1.x = x1;
+    b->p1.y = y1;
+    sw_gradient_lut(b->lut, colors, offsets, n);
+    return b;
+}
+
+static void*
+sw_create_radial_gradient_brush(void* canvas, float cx, float cy, float r,
+                float fx, float fy, const WD_COLOR* colors, const float* offsets, UINT n)
+{
+    sw_brush_t* b;
+
+    b = sw_brush_alloc(SW_BRUSH_RADIAL, SW_LUT_SIZE);
+    if(b == NULL)
+        return NULL;
+
+    b->p0.x = cx;
+    b->p0.y = cy;
+    b->p1.x = fx;
+    b->p1.y = fy;
+    b->r = r;
+    sw_gradient_lut(b->lut, colors, offsets, n);
+    return b;
+}
+
+static void
+sw_destroy_brush(void* brush)
+{
+    free(brush);
+}
+
+static void
+sw_set_solid_brush_color(void* brush, WD_COLOR color)
+{
+    ((sw_brush_t*) brush)->color = sw_premultiply(color);
+}
+
+static void*
+sw_create_stroke_style(const float* dashes, UINT dash_count, UINT line_cap, UINT line_join)
+{
+    sw_strokestyle_t* s;
+
+    s = (sw_strokestyle_t*) malloc(sizeof(sw_strokestyle_t) +
+                (WD_MAX(dash_count, 1) - 1) * sizeof(float));
+    if(s == NULL) {
+        WD_TRACE("sw_create_stroke_style: malloc() failed.");
+        return NULL;
+    }
+
+    s->line_cap = line_cap;
+    s->line_join = line_join;
+    s->miter_limit = WD_MITER_LIMIT;
+    s->dash_count = dash_count;
+    if(dash_count > 0)
+        memcpy(s->dashes, dashes, dash_count * sizeof(float));
+    return s;
+}
+
+static void
+sw_destroy_stroke_style(void* style)
+{
+    free(style);
+}
+
+static void
+sw_set_stroke_style_miter_limit(void* style, float miter_limit)
+{
+    ((sw_strokestyle_t*) style)->miter_limit = miter_limit;
+}
+
+
+/***************
+ ***  Paths  ***
+ ***************/
+
+/* The path is its own sink. */
+
+static void*
+sw_create_path(void* canvas)
+{
+    sw_path_t* path;
+
+    path = (sw_path_t*) malloc(sizeof(sw_path_t));
+    if(path == NULL) {
+        WD_TRACE("sw_create_path: malloc() failed.");
+        return NULL;
+    }
+
+    sw_path_init(path);
+    return path;
+}
+
+static void
+sw_destroy_path(void* path)
+{
+    sw_path_fini((sw_path_t*) path);
+    free(path);
+}
+
+static void
+sw_set_path_fill_mode(void* path, UINT fill_mode)
+{
+    ((sw_path_t*) path)->fill_rule = (fill_mode == WD_FILL_WINDING ? SW_FILL_WINDING : SW_FILL_ALTERNATE);
+}
+
+static void*
+sw_open_path_sink(void* path)
+{
+    return path;
+}
+
+static void
+sw_close_path_sink(void* sink)
+{
+    if(((sw_path_t*) sink)->error)
+        WD_TRACE("sw_close_path_sink: Out of memory.");
+}
+
+static void
+sw_begin_figure(void* sink, float x, float y)
+{
+    sw_path_move_to((sw_path_t*) sink, x, y);
+}
+
+static void
+sw_end_figure(void* sink, BOOL close)
+{
+    if(close)
+        sw_path_close((sw_path_t*) sink);
+}
+
+static void
+sw_add_line(void* sink, float x, float y)
+{
+    sw_path_line_to((sw_path_t*) sink, x, y);
+}
+
+static void
+sw_add_arc(void* sink, float cx, float cy, float r, float base_angle, float sweep_angle)
+{
+    sw_path_arc((sw_path_t*) sink, cx, cy, r, r, base_angle, sweep_angle, FALSE);
+}
+
+static void
+sw_add_bezier(void* sink, float x0, float y0, float x1, float y1, float x2, float y2)
+{
+    sw_path_cubic_to((sw_path_t*) sink, x0, y0, x1, y1, x2, y2);
+}
+
+
+/****************
+ ***  Images  ***
+ ****************/
+
+static sw_image_t*
+sw_image_alloc(UINT width, UINT height)
+{
+    sw_image_t* img;
+
+    img = (sw_image_t*) malloc(sizeof(sw_image_t) +
+                (WD_MAX(width * height, 1) - 1) * sizeof(UINT32));
+    if(img == NULL) {
+        WD_TRACE("sw_image_alloc: malloc() failed.");
+        return NULL;
+    }
+
+    img->width = width;
+    img->height = height;
+    return img;
+}
+
+static void*
+sw_create_image(UINT width, UINT height, UINT stride, const BYTE* bits)
+{
+    sw_image_t* img;
+    UINT y;
+
+    img = sw_image_alloc(width, height);
+    if(img == NULL)
+        return NULL;
+
+    for(y = 0; y < height; y++)
+        memcpy(img->pixels + y * width, bits + y * stride, width * sizeof(UINT32));
+    return img;
+}
+
+static void
+sw_destroy_image(void* image)
+{
+    free(image);
+}
+
+static void
+sw_get_image_size(void* image, UINT* width, UINT* height)
+{
+    sw_image_t* img = (sw_image_t*) image;
+
+    *width = img->width;
+    *height = img->height;
+}
+
+static void*
+sw_create_cached_image(void* canvas, void* image)
+{
+    sw_image_t* img = (sw_image_t*) image;
+
+    return sw_create_image(img->width, img->height,
+                img->width * sizeof(UINT32), (const BYTE*) img->pixels);
+}
+
+
+/***************
+ ***  Fonts  ***
+ ***************/
+
+/* There is no font rasterizer in the software back-end. Fonts only remember
+ * their size so strings can be measured (roughly), and wdDrawString()
+ * paints nothing. */
+
+static void*
+sw_create_font(const LOGFONTW* logfont)
+{
+    sw_font_t* font;
+
+    font = (sw_font_t*) malloc(sizeof(sw_font_t));
+    if(font == NULL) {
+        WD_TRACE("sw_create_font: malloc() failed.");
+        return NULL;
+    }
+
+    if(logfont->lfHeight < 0)
+        font->size = (float) -logfont->lfHeight;
+    else if(logfont->lfHeight > 0)
+        font->size = 0.8f * (float) logfont->lfHeight;    /* Minus internal leading. */
+    else
+        font->size = 12.0f;
+    return font;
+}
+
+static void
+sw_destroy_font(void* font)
+{
+    free(font);
+}
+
+static void
+sw_font_metrics(void* font, WD_FONTMETRICS* metrics)
+{
+    float size = ((sw_font_t*) font)->size;
+
+    metrics->fEmHeight = size;
+    metrics->fAscent = size;
+    metrics->fDescent = 0.25f * size;
+    metrics->fLeading = 1.25f * size;
+}
+
+
+/******************
+ ***  Painting  ***
+ ******************/
+
+static void
+sw_draw_ellipse_arc(void* canvas, void* brush, float cx, float cy, float rx, float ry,
+                float base_angle, float sweep_angle, float width, void* style)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    sw_path_reset(&c->path);
+    sw_path_arc(&c->path, cx, cy, rx, ry, base_angle, sweep_angle, TRUE);
+    sw_stroke_path(c, brush, &c->path, width, style);
+}
+
+static void
+sw_draw_ellipse_pie(void* canvas, void* brush, float cx, float cy, float rx, float ry,
+                float base_angle, float sweep_angle, float width, void* style)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    sw_path_reset(&c->path);
+    sw_path_arc(&c->path, cx, cy, rx, ry, base_angle, sweep_angle, TRUE);
+    sw_path_line_to(&c->path, cx, cy);
+    sw_path_close(&c->path);
+    sw_stroke_path(c, brush, &c->path, width, style);
+}
+
+static void
+sw_draw_ellipse(void* canvas, void* brush, float cx, float cy, float rx, float ry,
+                float width, void* style)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    sw_path_reset(&c->path);
+    sw_path_ellipse(&c->path, cx, cy, rx, ry);
+    sw_stroke_path(c, brush, &c->path, width, style);
+}
+
+static void
+sw_draw_line(void* canvas, void* brush, float x0, float y0, float x1, float y1,
+                float width, void* style)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    sw_path_reset(&c->path);
+    sw_path_move_to(&c->path, x0, y0);
+    sw_path_line_to(&c->path, x1, y1);
+    sw_stroke_path(c, brush, &c->path, width, style);
+}
+
+static void
+sw_draw_path(void* canvas, void* brush, void* path, float width, void* style)
+{
+    sw_stroke_path((sw_canvas_t*) canvas, brush, (sw_path_t*) path, width, style);
+}
+
+static void
+sw_draw_rect(void* canvas, void* brush, float x0, float y0, float x1, float y1,
+                float width, void* style)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    sw_path_reset(&c->path);
+    sw_path_rect(&c->path, x0, y0, x1, y1);
+    sw_stroke_path(c, brush, &c->path, width, style);
+}
+
+static void
+sw_fill_ellipse(void* canvas, void* brush, float cx, float cy, float rx, float ry)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    sw_path_reset(&c->path);
+    sw_path_ellipse(&c->path, cx, cy, rx, ry);
+    sw_fill_path(c, brush, &c->path);
+}
+
+static void
+sw_fill_ellipse_pie(void* canvas, void* brush, float cx, float cy, float rx, float ry,
+                float base_angle, float sweep_angle)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    sw_path_reset(&c->path);
+    sw_path_arc(&c->path, cx, cy, rx, ry, base_angle, sweep_angle, TRUE);
+    sw_path_line_to(&c->path, cx, cy);
+    sw_path_close(&c->path);
+    sw_fill_path(c, brush, &c->path);
+}
+
+static void
+sw_fill_path_(void* canvas, void* brush, void* path)
+{
+    sw_fill_path((sw_canvas_t*) canvas, brush, (sw_path_t*) path);
+}
+
+static void
+sw_fill_rect(void* canvas, void* brush, float x0, float y0, float x1, float y1)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+
+    sw_path_reset(&c->path);
+    sw_path_rect(&c->path, x0, y0, x1, y1);
+    sw_fill_path(c, brush, &c->path);
+}
+
+void
+sw_canvas_fill_spans(void* canvas, void* brush, const sw_spans_t* spans, int dx, int dy)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+    sw_paint_t paint;
+    UINT i;
+
+    if(sw_clip_empty(&c->clip))
+        return;
+    if(!sw_paint_init(&paint, c, (sw_brush_t*) brush))
+        return;
+
+    /* The spans are sorted by y, so the rows above and below the clip box
+     * are skipped quickly. */
+    for(i = 0; i < spans->span_count; i++) {
+        const sw_span_t* span = &spans->spans[i];
+        int y = span->y + dy;
+        int x0, x1;
+
+        if(y < c->clip.y0)
+            continue;
+        if(y >= c->clip.y1)
+            break;
+
+        x0 = WD_MAX(span->x0 + dx, c->clip.x0);
+        x1 = WD_MIN(span->x1 + dx, c->clip.x1);
+        if(x0 >= x1)
+            continue;
+
+        /* sw_paint_span() may apply the clip mask on the coverage. */
+        memcpy(c->coverage, spans->coverage + span->offset + (x0 - dx - span->x0), x1 - x0);
+        sw_paint_span(&paint, y, x0, x1, c->coverage);
+    }
+}
+
+static void
+sw_bitblt_image(void* canvas, void* image, const WD_RECT* dst, const WD_RECT* src)
+{
+    sw_canvas_t* c = (sw_canvas_t*) canvas;
+    sw_image_t* img = (sw_image_t*) image;
+    sw_paint_t paint;
+    WD_MATRIX inv;
+    WD_MATRIX m;
+    float w, h;
+
+    if(dst->x0 == dst->x1  ||  dst->y0 == dst->y1  ||  img->width == 0  ||  img->height == 0)
+        return;
+    if(!wd_matrix_invert(&c->matrix, &inv))
+        return;
+
+    /* Map the destination rectangle (user space) onto the source one
+     * (image pixels). */
+    m.m11 = (src->x1 - src->x0) / (dst->x1 - dst->x0);
+    m.m12 = 0.0f;
+    m.m21 = 0.0f;
+    m.m22 = (src->y1 - src->y0) / (dst->y1 - dst->y0);
+    m.dx = src->x0 - dst->x0 * m.m11;
+    m.dy = src->y0 - dst->y0 * m.m22;
+
+    paint.c = c;
+    paint.brush = NULL;
+    paint.image = img;
+    wd_matrix_mult(&paint.inv, &inv, &m);
+    paint.copy = (WD_ABS(paint.inv.m11 - 1.0f) < 1e-6f  &&  WD_ABS(paint.inv.m22 - 1.0f) < 1e-6f  &&
+                  paint.inv.m12 == 0.0f  &&  paint.inv.m21 == 0.0f  &&
+                  sw_is_integral(paint.inv.dx)  &&  sw_is_integral(paint.inv.dy));
+
+    /* Sample only pixels of the source rectangle. */
+    w = (float) (img->width - 1);
+    h = (float) (img->height - 1);
+    paint.sx0 = WD_MIN(WD_MAX(WD_MIN(src->x0, src->x1), 0.0f), w);
+    paint.sy0 = WD_MIN(WD_MAX(WD_MIN(src->y0, src->y1), 0.0f), h);
+    paint.sx1 = WD_MAX(WD_MIN(WD_MAX(src->x0, src->x1) - 1.0f, w), paint.sx0);
+    paint.sy1 = WD_MAX(WD_MIN(WD_MAX(src->y0, src->y1) - 1.0f, h), paint.sy0);
+
+    sw_path_reset(&c->path);
+    sw_path_rect(&c->path, dst->x0, dst->y0, dst->x1, dst->y1);
+    sw_poly_reset(&c->poly);
+    sw_poly_flatten(&c->poly, &c->path, sw_tolerance(c));
+    sw_poly_transform(&c->poly, &c->matrix);
+    sw_paint_poly(c, &c->poly, SW_FILL_ALTERNATE, &paint);
+}
+
+static void
+sw_bitblt_cached_image(void* canvas, void* image, float x, float y)
+{
+    sw_image_t* img = (sw_image_t*) image;
+    WD_RECT dst;
+    WD_RECT src;
+
+    dst.x0 = x;
+    dst.y0 = y;
+    dst.x1 = x + (float) img->width;
+    dst.y1 = y + (float) img->height;
+    src.x0 = 0.0f;
+    src.y0 = 0.0f;
+    src.x1 = (float) img->width;
+    src.y1 = (float) img->height;
+    sw_bitblt_image(canvas, image, &dst, &src);
+}
+
+static void
+sw_draw_string(void* canvas, void* font, const WD_RECT* rect, const WCHAR* text,
+                int len, void* brush, DWORD flags)
+{
+    /* noop (see sw_create_font()) */
+}
+
+static void
+sw_measure_string(void* canvas, void* font, const WD_RECT* rect, const WCHAR* text,
+                int len, WD_RECT* result, DWORD flags)
+{
+    float size = ((sw_font_t*) font)->size;
+    float w, h;
+
+    if(len < 0)
+        len = (int) wcslen(text);
+
+    /* An average glyph is about half as wide as high. */
+    w = 0.5f * size * (float) len;
+    h = 1.25f * size;
+
+    switch(flags & WD_STR_ALIGNMASK) {
+        case WD_STR_CENTERALIGN:    result->x0 = 0.5f * (rect->x0 + rect->x1 - w); break;
+        case WD_STR_RIGHTALIGN:     result->x0 = rect->x1 - w; break;
+        default:                    result->x0 = rect->x0; break;
+    }
+    switch(flags & WD_STR_VALIGNMASK) {
+        case WD_STR_MIDDLEALIGN:    result->y0 = 0.5f * (rect->y0 + rect->y1 - h); break;
+        case WD_STR_BOTTOMALIGN:    result->y0 = rect->y1 - h; break;
+        default:                    result->y0 = rect->y0; break;
+    }
+    result->x1 = result->x0 + w;
+    result->y1 = result->y0 + h;
+}
+
+
+const WD_BACKEND_OPS sw_backend_ops = {
+    sizeof(WD_BACKEND_OPS),
+
+    NULL,                           /* fnInitialize */
+    NULL,                           /* fnTerminate */
+
+    sw_create_canvas,
+    sw_destroy_canvas,
+    sw_begin_paint,
+    sw_end_paint,
+    sw_resize_canvas,
+    NULL,                           /* fnStartGdi */
+    NULL,                           /* fnEndGdi */
+    sw_clear,
+    sw_set_transform,
+    sw_push_clip,
+    sw_pop_clip,
+
+    sw_create_solid_brush,
+    sw_create_linear_gradient_brush,
+    sw_create_radial_gradient_brush,
+    sw_destroy_brush,
+    sw_set_solid_brush_color,
+    sw_create_stroke_style,
+    sw_destroy_stroke_style,
+
+    sw_create_path,
+    sw_destroy_path,
+    sw_open_path_sink,
+    sw_close_path_sink,
+    sw_begin_figure,
+    sw_end_figure,
+    sw_add_line,
+    sw_add_arc,
+    sw_add_bezier,
+
+    sw_create_image,
+    NULL,                           /* fnLoadImageFromFile */
+    NULL,                           /* fnLoadImageFromIStream */
+    sw_destroy_image,
+    sw_get_image_size,
+    sw_create_cached_image,
+    sw_destroy_image,               /* fnDestroyCachedImage */
+
+    sw_create_font,
+    sw_destroy_font,
+    sw_font_metrics,
+
+    sw_draw_ellipse_arc,
+    sw_draw_ellipse_pie,
+    sw_draw_ellipse,
+    sw_draw_line,
+    sw_draw_path,
+    sw_draw_rect,
+    sw_fill_ellipse,
+    sw_fill_ellipse_pie,
+    sw_fill_path_,
+    sw_fill_rect,
+    sw_bitblt_image,
+    sw_bitblt_cached_image,
+    sw_draw_string,
+    sw_measure_string,
+
+    sw_end_paint_rects,
+    sw_rebind_canvas,
+
+    sw_set_stroke_style_miter_limit,
+    sw_set_path_fill_mode
+};
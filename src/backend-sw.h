@@ -0,0 +1,64 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef WD_BACKEND_SW_H
+#define WD_BACKEND_SW_H
+
+#include "misc.h"
+#include "backend-ops.h"
+#include "swrast.h"
+
+
+/* The software back-end (WD_BACKEND_SOFTWARE) paints with the rasterizer
+ * of swrast.h into 32-bit pre-multiplied BGRA memory buffers. It is plugged
+ * in through the same WD_BACKEND_OPS table as custom back-ends, so all the
+ * canvas bookkeeping is done by backend-ops.c.
+ *
+ * It is used when neither Direct2D nor GDI+ is available (or both have been
+ * disabled by wdPreInitialize()), and it is the only back-end which can
+ * paint into a caller-provided buffer (wdCreateCanvasWithBuffer()). */
+extern const WD_BACKEND_OPS sw_backend_ops;
+
+#if defined WD_D2D_ONLY  ||  defined WD_GDIPLUS_ONLY
+    #define sw_enabled()        FALSE
+#else
+static inline BOOL
+sw_enabled(void)
+{
+    return (wd_backend_ops == &sw_backend_ops);
+}
+#endif
+
+/* Creates a canvas painting directly into the buffer (which must outlive
+ * the canvas). */
+void* sw_canvas_create_with_buffer(void* bits, UINT width, UINT height, UINT stride);
+
+/* Where in the DC the canvas gets presented by fnEndPaint. */
+void sw_canvas_set_origin(void* canvas, int x, int y);
+
+/* Paints the recorded coverage (see wdFillRealizedPath()), shifted by whole
+ * pixels, with the brush and the current clip. */
+void sw_canvas_fill_spans(void* canvas, void* brush, const sw_spans_t* spans, int dx, int dy);
+
+
+#endif  /* WD_BACKEND_SW_H */
@@ -0,0 +1,80 @@
+#include "backend-wic.h"
+
+
+/* We define these ourselves: mingw-w64 headers and import libraries do not
+ * provide them all reliably. */
+static const GUID wic_CLSID_WICImagingFactory =
+        {0xcacaf262,0x9370,0x4615,{0xa1,0x3b,0x9f,0x55,0x39,0xda,0x4c,0x0a}};
+static const GUID wic_IID_IWICImagingFactory =
+        {0xec5ec8a9,0xc395,0x4314,{0x9c,0x77,0x54,0xd7,0xa9,0x35,0xff,0x70}};
+
+/* GUID_WICPixelFormat32bppPBGRA */
+const GUID wic_pixel_format =
+        {0x6fddc324,0x4e03,0x4bfe,{0xb1,0x85,0x3d,0x77,0x76,0x8d,0xc9,0x10}};
+
+IWICImagingFactory* wic_factory = NULL;
+
+
+IWICBitmapSource*
+wic_convert_bitmap(IWICBitmapSource* bitmap)
+{
+    GUID pixel_format;
+    IWICFormatConverter* converter;
+    HRESULT hr;
+
+    hr = IWICBitmapSource_GetPixelFormat(bitmap, &pixel_format);
+    if(FAILED(hr)) {
+        WD_TRACE_HR("wic_convert_bitmap: "
+                    "IWICBitmapSource::GetPixelFormat() failed.");
+        return NULL;
+    }
+
+    if(IsEqualGUID(&pixel_format, &wic_pixel_format)) {
+        /* No conversion needed. */
+        IWICBitmapSource_AddRef(bitmap);
+        return bitmap;
+    }
+
+    hr = IWICImagingFactory_CreateFormatConverter(wic_factory, &converter);
+    if(FAILED(hr)) {
+        WD_TRACE_HR("wic_convert_bitmap: "
+                    "IWICImagingFactory::CreateFormatConverter() failed.");
+        return NULL;
+    }
+
+    hr = IWICFormatConverter_Initialize(converter, bitmap, &wic_pixel_format,
+                WICBitmapDitherTypeNone, NULL, 0.0f, WICBitmapPaletteTypeMedianCut);
+    if(FAILED(hr)) {
+        WD_TRACE_HR("wic_convert_bitmap: "
+                    "IWICFormatConverter::Initialize() failed.");
+        IWICFormatConverter_Release(converter);
+        return NULL;
+    }
+
+    return (IWICBitmapSource*) converter;
+}
+
+
+int
+wic_init(void)
+{
+    HRESULT hr;
+
+    hr = CoCreateInstance(&wic_CLSID_WICImagingFactory, NULL,
+                CLSCTX_INPROC_SERVER, &wic_IID_IWICImagingFactory,
+                (void**) &wic_factory);
+    if(FAILED(hr)) {
+        WD_TRACE_HR("wic_init: "
+                    "CoCreateInstance(CLSID_WICImagingFactory) failed.");
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+wic_fini(void)
+{
+    IWICImagingFactory_Release(wic_factory);
+    wic_factory = NULL;
+}
@@ -6,3 +6,5 @@ extern const GUID wic_pixel_format;
 
 int wic_init(void);
 void wic_fini(void);
+
+IWICBitmapSource* wic_convert_bitmap(IWICBitmapSource* bitmap);
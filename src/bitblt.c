@@ -22,9 +22,13 @@
  */
 
 #include "misc.h"
+#include "backend-ops.h"
 #include "backend-d2d.h"
 #include "backend-wic.h"
 #include "backend-gdix.h"
+#include "canvas.h"
+#include "capture.h"
+#include "dlist.h"
 #include "lock.h"
 
 
@@ -32,7 +36,48 @@ void
 wdBitBltImage(WD_HCANVAS hCanvas, const WD_HIMAGE hImage,
                const WD_RECT* pDestRect, const WD_RECT* pSourceRect)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_BITBLTIMAGE);
+        wd_dlist_h(hImage);
+        wd_dlist_rect_opt(pDestRect);
+        wd_dlist_rect_opt(pSourceRect);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_BITBLTIMAGE);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hImage);
+        wd_capture_rect_opt(pDestRect);
+        wd_capture_rect_opt(pSourceRect);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_IMAGE);
+
+    if(wd_cull(hCanvas, pDestRect->x0, pDestRect->y0, pDestRect->x1, pDestRect->y1, 0.0f))
+        return;
+
+    WD_EVENT_BEGIN("wdBitBltImage");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        WD_RECT src;
+
+        if(pSourceRect == NULL) {
+            UINT w, h;
+
+            wd_backend_ops->fnGetImageSize((void*) hImage, &w, &h);
+            src.x0 = 0.0f;
+            src.y0 = 0.0f;
+            src.x1 = (float) w;
+            src.y1 = (float) h;
+            pSourceRect = &src;
+        }
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnBitBltImage(c->canvas, (void*) hImage, pDestRect, pSourceRect);
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         IWICBitmapSource* bitmap = (IWICBitmapSource*) hImage;
         dummy_ID2D1Bitmap* b;
@@ -49,13 +94,18 @@ wdBitBltImage(WD_HCANVAS hCanvas, const WD_HIMAGE hImage,
                 pDestRect->y1 - D2D_BASEDELTA_Y
         };
 
+        WD_EVENT_BEGIN("ID2D1RenderTarget::CreateBitmapFromWicBitmap");
         hr = dummy_ID2D1RenderTarget_CreateBitmapFromWicBitmap(c->target, bitmap, NULL, &b);
+        WD_EVENT_END("ID2D1RenderTarget::CreateBitmapFromWicBitmap");
         if(FAILED(hr)) {
             WD_TRACE_HR("wdBitBltImage: "
                         "ID2D1RenderTarget::CreateBitmapFromWicBitmap() failed.");
+            WD_EVENT_END("wdBitBltImage");
             return;
         }
+        d2d_stats_upload(c, b);
 
+        d2d_sync_transform(c);
         dummy_ID2D1RenderTarget_DrawBitmap(c->target, b, &dest, 1.0f,
                 dummy_D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, (dummy_D2D1_RECT_F*) pSourceRect);
         dummy_ID2D1Bitmap_Release(b);
@@ -87,16 +137,45 @@ wdBitBltImage(WD_HCANVAS hCanvas, const WD_HIMAGE hImage,
             sh = (float) h;
         }
 
+        gdix_sync_transform(c);
         gdix_vtable->fn_DrawImageRectRect(c->graphics, b, dx, dy, dw, dh,
                  sx, sy, sw, sh, dummy_UnitPixel, NULL, NULL, NULL);
     }
+
+    WD_EVENT_END("wdBitBltImage");
 }
 
 void
 wdBitBltCachedImage(WD_HCANVAS hCanvas, const WD_HCACHEDIMAGE hCachedImage,
                     float x, float y)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_BITBLTCACHEDIMAGE);
+        wd_dlist_h(hCachedImage);
+        wd_dlist_f(x);
+        wd_dlist_f(y);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_BITBLTCACHEDIMAGE);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hCachedImage);
+        wd_capture_f(x);
+        wd_capture_f(y);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_IMAGE);
+
+    WD_EVENT_BEGIN("wdBitBltCachedImage");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnBitBltCachedImage(c->canvas, (void*) hCachedImage, x, y);
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1Bitmap* b = (dummy_ID2D1Bitmap*) hCachedImage;
         dummy_D2D1_SIZE_U sz;
@@ -104,26 +183,67 @@ wdBitBltCachedImage(WD_HCANVAS hCanvas, const WD_HCACHEDIMAGE hCachedImage,
 
         dummy_ID2D1Bitmap_GetPixelSize(b, &sz);
 
+        if(wd_cull(hCanvas, x, y, x + sz.width, y + sz.height, 0.0f)) {
+            WD_EVENT_END("wdBitBltCachedImage");
+            return;
+        }
+
         dest.left = x - D2D_BASEDELTA_X;
         dest.top = y - D2D_BASEDELTA_X;
         dest.right = (x + sz.width) - D2D_BASEDELTA_X;
         dest.bottom = (y + sz.height) - D2D_BASEDELTA_X;
 
+        d2d_sync_transform(c);
         dummy_ID2D1RenderTarget_DrawBitmap(c->target, b, &dest, 1.0f,
                 dummy_D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, NULL);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
         dummy_GpCachedBitmap* cb = (dummy_GpCachedBitmap*) hCachedImage;
 
+        gdix_sync_transform(c);
         gdix_vtable->fn_DrawCachedBitmap(c->graphics, cb, (INT)x, (INT)y);
     }
+
+    WD_EVENT_END("wdBitBltCachedImage");
+}
+
+/* Destructor of the icon copies kept by display lists. */
+static void
+wd_destroy_icon_copy(void* icon)
+{
+    DestroyIcon((HICON) icon);
 }
 
 void
 wdBitBltHICON(WD_HCANVAS hCanvas, HICON hIcon,
               const WD_RECT* pDestRect, const WD_RECT* pSourceRect)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_BITBLTHICON);
+        /* Unlike our resources, the icon may be destroyed behind our back. */
+        wd_dlist_h_owned(CopyIcon(hIcon), wd_destroy_icon_copy);
+        wd_dlist_rect_opt(pDestRect);
+        wd_dlist_rect_opt(pSourceRect);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_BITBLTHICON);
+        wd_capture_h(hCanvas);
+        wd_capture_rect_opt(pDestRect);
+        wd_capture_rect_opt(pSourceRect);
+        wd_capture_end();
+    }
+
+    /* Cull before we convert the icon into a bitmap. */
+    if(wd_cull(hCanvas, pDestRect->x0, pDestRect->y0, pDestRect->x1, pDestRect->y1, 0.0f))
+        return;
+
+    WD_EVENT_BEGIN("wdBitBltHICON");
+
+    if(ops_enabled()) {
+        WD_TRACE("wdBitBltHICON: Not supported by the custom back-end.");
+    } else if(d2d_enabled()) {
         IWICBitmap* bitmap;
         IWICFormatConverter* converter;
         HRESULT hr;
@@ -151,7 +271,9 @@ wdBitBltHICON(WD_HCANVAS hCanvas, HICON hIcon,
             goto err_Initialize;
         }
 
+        WD_CAPTURE_SUSPEND();
         wdBitBltImage(hCanvas, (WD_HIMAGE) converter, pDestRect, pSourceRect);
+        WD_CAPTURE_RESUME();
 
 err_Initialize:
         IWICFormatConverter_Release(converter);
@@ -167,11 +289,16 @@ err_CreateBitmapFromHICON:
         if(status != 0) {
             WD_TRACE("wdBitBltHICON: GdipCreateBitmapFromHICON() failed. "
                      "[%d]", status);
+            WD_EVENT_END("wdBitBltHICON");
             return;
         }
+        WD_CAPTURE_SUSPEND();
         wdBitBltImage(hCanvas, (WD_HIMAGE) b, pDestRect, pSourceRect);
+        WD_CAPTURE_RESUME();
         gdix_vtable->fn_DisposeImage(b);
     }
+
+    WD_EVENT_END("wdBitBltHICON");
 }
 
 
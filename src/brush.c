@@ -22,14 +22,25 @@
  */
 
 #include "misc.h"
+#include "backend-ops.h"
 #include "backend-d2d.h"
 #include "backend-gdix.h"
+#include "capture.h"
+#include "dlist.h"
+#include "path.h"
 
 
-WD_HBRUSH
-wdCreateSolidBrush(WD_HCANVAS hCanvas, WD_COLOR color)
+static WD_HBRUSH
+wdCreateSolidBrushImpl(WD_HCANVAS hCanvas, WD_COLOR color)
 {
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        void* b;
+
+        b = wd_backend_ops->fnCreateSolidBrush(ops_canvas(hCanvas), color);
+        if(b == NULL)
+            WD_TRACE("wdCreateSolidBrush: WD_BACKEND_OPS::fnCreateSolidBrush() failed.");
+        return (WD_HBRUSH) b;
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1SolidColorBrush* b;
         dummy_D2D1_COLOR_F clr;
@@ -58,20 +69,72 @@ wdCreateSolidBrush(WD_HCANVAS hCanvas, WD_COLOR color)
     }
 }
 
-void
-wdDestroyBrush(WD_HBRUSH hBrush)
+WD_HBRUSH
+wdCreateSolidBrush(WD_HCANVAS hCanvas, WD_COLOR color)
 {
-    if(d2d_enabled()) {
+    WD_HBRUSH b;
+
+    b = wdCreateSolidBrushImpl(hCanvas, color);
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_CREATESOLIDBRUSH);
+        wd_capture_h_new(b);
+        wd_capture_h(hCanvas);
+        wd_capture_c(color);
+        wd_capture_end();
+    }
+
+    return b;
+}
+
+static void
+wdDestroyBrushImpl(void* hBrush)
+{
+    if(ops_enabled()) {
+        wd_backend_ops->fnDestroyBrush(hBrush);
+    } else if(d2d_enabled()) {
         dummy_ID2D1Brush_Release((dummy_ID2D1Brush*) hBrush);
     } else {
-        gdix_vtable->fn_DeleteBrush((void*) hBrush);
+        gdix_vtable->fn_DeleteBrush(hBrush);
+    }
+}
+
+void
+wdDestroyBrush(WD_HBRUSH hBrush)
+{
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DESTROYBRUSH);
+        wd_capture_h_free(hBrush);
+        wd_capture_end();
     }
+
+    if(wd_dlist_defer_destroy(hBrush, wdDestroyBrushImpl))
+        return;
+    wdDestroyBrushImpl((void*) hBrush);
 }
 
 void
 wdSetSolidBrushColor(WD_HBRUSH hBrush, WD_COLOR color)
 {
-    if(d2d_enabled()) {
+    /* Brushes are not bound to the canvas being recorded, so we record any
+     * change during a recording. Unlike the painting, the color is still
+     * changed right away. */
+    if(wd_dlist_current != NULL) {
+        wd_dlist_op(WD_DL_SETSOLIDBRUSHCOLOR);
+        wd_dlist_h(hBrush);
+        wd_dlist_c(color);
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_SETSOLIDBRUSHCOLOR);
+        wd_capture_h(hBrush);
+        wd_capture_c(color);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        wd_backend_ops->fnSetSolidBrushColor((void*) hBrush, color);
+    } else if(d2d_enabled()) {
         dummy_D2D1_COLOR_F clr;
 
         d2d_init_color(&clr, color);
@@ -83,13 +146,35 @@ wdSetSolidBrushColor(WD_HBRUSH hBrush, WD_COLOR color)
     }
 }
 
-WD_HBRUSH
-wdCreateLinearGradientBrushEx(WD_HCANVAS hCanvas, float x0, float y0, float x1, float y1,
+static void
+wd_capture_gradient_stops(const WD_COLOR* colors, const float* offsets, UINT numStops)
+{
+    UINT i;
+
+    wd_capture_u(numStops);
+    for(i = 0; i < numStops; i++) {
+        wd_capture_c(colors[i]);
+        wd_capture_f(offsets[i]);
+    }
+}
+
+static WD_HBRUSH
+wdCreateLinearGradientBrushExImpl(WD_HCANVAS hCanvas, float x0, float y0, float x1, float y1,
     const WD_COLOR* colors, const float* offsets, UINT numStops)
 {
     if(numStops < 2)
         return NULL;
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        void* b;
+
+        b = wd_backend_ops->fnCreateLinearGradientBrush(ops_canvas(hCanvas),
+                    x0, y0, x1, y1, colors, offsets, numStops);
+        if(b == NULL) {
+            WD_TRACE("wdCreateLinearGradientBrushEx: "
+                     "WD_BACKEND_OPS::fnCreateLinearGradientBrush() failed.");
+        }
+        return (WD_HBRUSH) b;
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
 
         HRESULT hr;
@@ -151,6 +236,29 @@ wdCreateLinearGradientBrushEx(WD_HCANVAS hCanvas, float x0, float y0, float x1,
     return NULL;
 }
 
+WD_HBRUSH
+wdCreateLinearGradientBrushEx(WD_HCANVAS hCanvas, float x0, float y0, float x1, float y1,
+    const WD_COLOR* colors, const float* offsets, UINT numStops)
+{
+    WD_HBRUSH b;
+
+    b = wdCreateLinearGradientBrushExImpl(hCanvas, x0, y0, x1, y1, colors, offsets, numStops);
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_CREATELINEARBRUSH);
+        wd_capture_h_new(b);
+        wd_capture_h(hCanvas);
+        wd_capture_f(x0);
+        wd_capture_f(y0);
+        wd_capture_f(x1);
+        wd_capture_f(y1);
+        wd_capture_gradient_stops(colors, offsets, numStops);
+        wd_capture_end();
+    }
+
+    return b;
+}
+
 WD_HBRUSH
 wdCreateLinearGradientBrush(WD_HCANVAS hCanvas, float x0, float y0,
     WD_COLOR color0, float x1, float y1, WD_COLOR color1)
@@ -160,13 +268,23 @@ wdCreateLinearGradientBrush(WD_HCANVAS hCanvas, float x0, float y0,
     return wdCreateLinearGradientBrushEx(hCanvas, x0, y0, x1, y1, colors, offsets, 2);
 }
 
-WD_HBRUSH
-wdCreateRadialGradientBrushEx(WD_HCANVAS hCanvas, float cx, float cy, float r,
+static WD_HBRUSH
+wdCreateRadialGradientBrushExImpl(WD_HCANVAS hCanvas, float cx, float cy, float r,
     float fx, float fy, const WD_COLOR* colors, const float* offsets, UINT numStops)
 {
     if(numStops < 2)
         return NULL;
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        void* b;
+
+        b = wd_backend_ops->fnCreateRadialGradientBrush(ops_canvas(hCanvas),
+                    cx, cy, r, fx, fy, colors, offsets, numStops);
+        if(b == NULL) {
+            WD_TRACE("wdCreateRadialGradientBrushEx: "
+                     "WD_BACKEND_OPS::fnCreateRadialGradientBrush() failed.");
+        }
+        return (WD_HBRUSH) b;
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
 
         HRESULT hr;
@@ -211,12 +329,14 @@ wdCreateRadialGradientBrushEx(WD_HCANVAS hCanvas, float cx, float cy, float r,
         rect.y0 = cy - r;
         rect.x1 = cx + r;
         rect.y1 = cy + r;
+        WD_CAPTURE_SUSPEND();
         p = wdCreateRoundedRectPath(hCanvas, &rect, r);
 
         int status;
         dummy_GpPathGradient* grad;
-        status = gdix_vtable->fn_CreatePathGradientFromPath((void*)p, &grad);
+        status = gdix_vtable->fn_CreatePathGradientFromPath(wd_path_backend(p), &grad);
         wdDestroyPath(p);
+        WD_CAPTURE_RESUME();
         if(status != 0) {
             WD_TRACE("wdCreateRadialGradientBrushEx: "
                      "GdipCreatePathGradientFromPath() failed. [%d]", status);
@@ -247,6 +367,30 @@ wdCreateRadialGradientBrushEx(WD_HCANVAS hCanvas, float cx, float cy, float r,
     return NULL;
 }
 
+WD_HBRUSH
+wdCreateRadialGradientBrushEx(WD_HCANVAS hCanvas, float cx, float cy, float r,
+    float fx, float fy, const WD_COLOR* colors, const float* offsets, UINT numStops)
+{
+    WD_HBRUSH b;
+
+    b = wdCreateRadialGradientBrushExImpl(hCanvas, cx, cy, r, fx, fy, colors, offsets, numStops);
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_CREATERADIALBRUSH);
+        wd_capture_h_new(b);
+        wd_capture_h(hCanvas);
+        wd_capture_f(cx);
+        wd_capture_f(cy);
+        wd_capture_f(r);
+        wd_capture_f(fx);
+        wd_capture_f(fy);
+        wd_capture_gradient_stops(colors, offsets, numStops);
+        wd_capture_end();
+    }
+
+    return b;
+}
+
 WD_HBRUSH
 wdCreateRadialGradientBrush(WD_HCANVAS hCanvas, float cx, float cy, float r,
     WD_COLOR color0, WD_COLOR color1)
@@ -22,26 +22,42 @@
  */
 
 #include "misc.h"
+#include "backend-ops.h"
 #include "backend-d2d.h"
 #include "backend-wic.h"
 #include "backend-gdix.h"
+#include "capture.h"
+#include "dlist.h"
 
 
-WD_HCACHEDIMAGE
-wdCreateCachedImage(WD_HCANVAS hCanvas, WD_HIMAGE hImage)
+static WD_HCACHEDIMAGE
+wdCreateCachedImageImpl(WD_HCANVAS hCanvas, WD_HIMAGE hImage)
 {
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        void* ci;
+
+        ci = wd_backend_ops->fnCreateCachedImage(c->canvas, (void*) hImage);
+        if(ci == NULL) {
+            WD_TRACE("wdCreateCachedImage: "
+                     "WD_BACKEND_OPS::fnCreateCachedImage() failed.");
+        }
+        return (WD_HCACHEDIMAGE) ci;
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1Bitmap* b;
         HRESULT hr;
 
+        WD_EVENT_BEGIN("ID2D1RenderTarget::CreateBitmapFromWicBitmap");
         hr = dummy_ID2D1RenderTarget_CreateBitmapFromWicBitmap(c->target,
                 (IWICBitmapSource*) hImage, NULL, &b);
+        WD_EVENT_END("ID2D1RenderTarget::CreateBitmapFromWicBitmap");
         if(FAILED(hr)) {
             WD_TRACE_HR("wdCreateCachedImage: "
                         "ID2D1RenderTarget::CreateBitmapFromWicBitmap() failed.");
             return NULL;
         }
+        d2d_stats_upload(c, b);
 
         return (WD_HCACHEDIMAGE) b;
     } else {
@@ -61,12 +77,46 @@ wdCreateCachedImage(WD_HCANVAS hCanvas, WD_HIMAGE hImage)
     }
 }
 
-void
-wdDestroyCachedImage(WD_HCACHEDIMAGE hCachedImage)
+WD_HCACHEDIMAGE
+wdCreateCachedImage(WD_HCANVAS hCanvas, WD_HIMAGE hImage)
 {
-    if(d2d_enabled()) {
+    WD_HCACHEDIMAGE ci;
+
+    ci = wdCreateCachedImageImpl(hCanvas, hImage);
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_CREATECACHEDIMAGE);
+        wd_capture_h_new(ci);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hImage);
+        wd_capture_end();
+    }
+
+    return ci;
+}
+
+static void
+wdDestroyCachedImageImpl(void* hCachedImage)
+{
+    if(ops_enabled()) {
+        wd_backend_ops->fnDestroyCachedImage(hCachedImage);
+    } else if(d2d_enabled()) {
         dummy_ID2D1Bitmap_Release((dummy_ID2D1Bitmap*) hCachedImage);
     } else {
         gdix_vtable->fn_DeleteCachedBitmap((dummy_GpCachedBitmap*) hCachedImage);
     }
 }
+
+void
+wdDestroyCachedImage(WD_HCACHEDIMAGE hCachedImage)
+{
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DESTROYCACHEDIMAGE);
+        wd_capture_h_free(hCachedImage);
+        wd_capture_end();
+    }
+
+    if(wd_dlist_defer_destroy(hCachedImage, wdDestroyCachedImageImpl))
+        return;
+    wdDestroyCachedImageImpl((void*) hCachedImage);
+}
@@ -22,19 +22,39 @@
  */
 
 #include "misc.h"
+#include "backend-ops.h"
+#include "backend-sw.h"
 #include "backend-d2d.h"
 #include "backend-gdix.h"
+#include "canvas.h"
+#include "capture.h"
+#include "dlist.h"
 #include "lock.h"
+#include "path.h"
 
 
-WD_HCANVAS
-wdCreateCanvasWithPaintStruct(HWND hWnd, PAINTSTRUCT* pPS, DWORD dwFlags)
+static BOOL wdResizeCanvasImpl(WD_HCANVAS hCanvas, UINT uWidth, UINT uHeight);
+static void wdDestroyCanvasImpl(WD_HCANVAS hCanvas);
+
+
+static WD_HCANVAS
+wdCreateCanvasWithPaintStructImpl(HWND hWnd, PAINTSTRUCT* pPS, DWORD dwFlags)
 {
     RECT rect;
 
     GetClientRect(hWnd, &rect);
 
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        ops_canvas_t* c;
+
+        c = ops_canvas_alloc(pPS->hdc, rect.right - rect.left,
+                    rect.bottom - rect.top, dwFlags);
+        if(c == NULL) {
+            WD_TRACE("wdCreateCanvasWithPaintStruct: ops_canvas_alloc() failed.");
+            return NULL;
+        }
+        return (WD_HCANVAS) c;
+    } else if(d2d_enabled()) {
         dummy_D2D1_RENDER_TARGET_PROPERTIES props = {
             dummy_D2D1_RENDER_TARGET_TYPE_DEFAULT,
             { dummy_DXGI_FORMAT_B8G8R8A8_UNORM, dummy_D2D1_ALPHA_MODE_PREMULTIPLIED },
@@ -44,6 +64,7 @@ wdCreateCanvasWithPaintStruct(HWND hWnd, PAINTSTRUCT* pPS, DWORD dwFlags)
             dummy_D2D1_FEATURE_LEVEL_DEFAULT
         };
         dummy_D2D1_HWND_RENDER_TARGET_PROPERTIES props2;
+        dummy_ID2D1Factory* factory;
         d2d_canvas_t* c;
         dummy_ID2D1HwndRenderTarget* target;
         HRESULT hr;
@@ -53,10 +74,12 @@ wdCreateCanvasWithPaintStruct(HWND hWnd, PAINTSTRUCT* pPS, DWORD dwFlags)
         props2.pixelSize.height = rect.bottom - rect.top;
         props2.presentOptions = dummy_D2D1_PRESENT_OPTIONS_NONE;
 
-        wd_lock();
         /* Note ID2D1HwndRenderTarget is implicitly double-buffered. */
-        hr = dummy_ID2D1Factory_CreateHwndRenderTarget(d2d_factory, &props, &props2, &target);
-        wd_unlock();
+        WD_EVENT_BEGIN("ID2D1Factory::CreateHwndRenderTarget");
+        factory = d2d_lock_factory(WD_LOCKSITE_CREATEHWNDRENDERTARGET);
+        hr = dummy_ID2D1Factory_CreateHwndRenderTarget(factory, &props, &props2, &target);
+        d2d_unlock_factory();
+        WD_EVENT_END("ID2D1Factory::CreateHwndRenderTarget");
         if(FAILED(hr)) {
             WD_TRACE_HR("wdCreateCanvasWithPaintStruct: "
                         "ID2D1Factory::CreateHwndRenderTarget() failed.");
@@ -64,7 +87,7 @@ wdCreateCanvasWithPaintStruct(HWND hWnd, PAINTSTRUCT* pPS, DWORD dwFlags)
         }
 
         c = d2d_canvas_alloc((dummy_ID2D1RenderTarget*)target, D2D_CANVASTYPE_HWND,
-                    rect.right, (dwFlags & WD_CANVAS_LAYOUTRTL));
+                    rect.right, rect.bottom, dwFlags);
         if(c == NULL) {
             WD_TRACE("wdCreateCanvasWithPaintStruct: d2d_canvas_alloc() failed.");
             dummy_ID2D1RenderTarget_Release((dummy_ID2D1RenderTarget*)target);
@@ -76,23 +99,46 @@ wdCreateCanvasWithPaintStruct(HWND hWnd, PAINTSTRUCT* pPS, DWORD dwFlags)
 
         return (WD_HCANVAS) c;
     } else {
+        BOOL use_cache = (dwFlags & WD_CANVAS_CACHED);
         BOOL use_doublebuffer = (dwFlags & WD_CANVAS_DOUBLEBUFFER);
+        const RECT* buffer_rect = NULL;
         gdix_canvas_t* c;
 
-        c = gdix_canvas_alloc(pPS->hdc, (use_doublebuffer ? &pPS->rcPaint : NULL),
-                    rect.right, (dwFlags & WD_CANVAS_LAYOUTRTL));
+        /* The back buffer of a cached canvas covers whole client area (and
+         * not just the invalidated rect), so it can be used for next WM_PAINT
+         * as the Direct2D one. */
+        if(use_cache)
+            buffer_rect = &rect;
+        else if(use_doublebuffer)
+            buffer_rect = &pPS->rcPaint;
+
+        c = gdix_canvas_alloc(pPS->hdc, buffer_rect, rect.right, dwFlags);
         if(c == NULL) {
             WD_TRACE("wdCreateCanvasWithPaintStruct: gdix_canvas_alloc() failed.");
             return NULL;
         }
+        if(use_cache  &&  c->buffer.dc != NULL)
+            c->hwnd = hWnd;
         return (WD_HCANVAS) c;
     }
 }
 
-WD_HCANVAS
-wdCreateCanvasWithHDC(HDC hDC, const RECT* pRect, DWORD dwFlags)
+static WD_HCANVAS
+wdCreateCanvasWithHDCImpl(HDC hDC, const RECT* pRect, DWORD dwFlags)
 {
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        ops_canvas_t* c;
+
+        c = ops_canvas_alloc(hDC, pRect->right - pRect->left,
+                    pRect->bottom - pRect->top, dwFlags);
+        if(c == NULL) {
+            WD_TRACE("wdCreateCanvasWithHDC: ops_canvas_alloc() failed.");
+            return NULL;
+        }
+        if(sw_enabled())
+            sw_canvas_set_origin(c->canvas, pRect->left, pRect->top);
+        return (WD_HCANVAS) c;
+    } else if(d2d_enabled()) {
         dummy_D2D1_RENDER_TARGET_PROPERTIES props = {
             dummy_D2D1_RENDER_TARGET_TYPE_DEFAULT,
             { dummy_DXGI_FORMAT_B8G8R8A8_UNORM, dummy_D2D1_ALPHA_MODE_PREMULTIPLIED },
@@ -101,13 +147,16 @@ wdCreateCanvasWithHDC(HDC hDC, const RECT* pRect, DWORD dwFlags)
                         0 : dummy_D2D1_RENDER_TARGET_USAGE_GDI_COMPATIBLE),
             dummy_D2D1_FEATURE_LEVEL_DEFAULT
         };
+        dummy_ID2D1Factory* factory;
         d2d_canvas_t* c;
         dummy_ID2D1DCRenderTarget* target;
         HRESULT hr;
 
-        wd_lock();
-        hr = dummy_ID2D1Factory_CreateDCRenderTarget(d2d_factory, &props, &target);
-        wd_unlock();
+        WD_EVENT_BEGIN("ID2D1Factory::CreateDCRenderTarget");
+        factory = d2d_lock_factory(WD_LOCKSITE_CREATEDCRENDERTARGET);
+        hr = dummy_ID2D1Factory_CreateDCRenderTarget(factory, &props, &target);
+        d2d_unlock_factory();
+        WD_EVENT_END("ID2D1Factory::CreateDCRenderTarget");
         if(FAILED(hr)) {
             WD_TRACE_HR("wdCreateCanvasWithHDC: "
                         "ID2D1Factory::CreateDCRenderTarget() failed.");
@@ -122,12 +171,16 @@ wdCreateCanvasWithHDC(HDC hDC, const RECT* pRect, DWORD dwFlags)
         }
 
         c = d2d_canvas_alloc((dummy_ID2D1RenderTarget*)target, D2D_CANVASTYPE_DC,
-                pRect->right - pRect->left, (dwFlags & WD_CANVAS_LAYOUTRTL));
+                pRect->right - pRect->left, pRect->bottom - pRect->top, dwFlags);
         if(c == NULL) {
             WD_TRACE("wdCreateCanvasWithHDC: d2d_canvas_alloc() failed.");
             goto err_d2d_canvas_alloc;
         }
 
+        c->dc = hDC;
+        c->dc_origin.x = pRect->left;
+        c->dc_origin.y = pRect->top;
+
         /* make sure text anti-aliasing is clear type */
         dummy_ID2D1RenderTarget_SetTextAntialiasMode(c->target, dummy_D2D1_TEXT_ANTIALIAS_MODE_CLEARTYPE);
 
@@ -143,7 +196,7 @@ err_CreateDCRenderTarget:
         gdix_canvas_t* c;
 
         c = gdix_canvas_alloc(hDC, (use_doublebuffer ? pRect : NULL),
-                pRect->right - pRect->left, (dwFlags & WD_CANVAS_LAYOUTRTL));
+                pRect->right - pRect->left, dwFlags);
         if(c == NULL) {
             WD_TRACE("wdCreateCanvasWithHDC: gdix_canvas_alloc() failed.");
             return NULL;
@@ -152,88 +205,650 @@ err_CreateDCRenderTarget:
     }
 }
 
+/* Canvases created with WD_CANVAS_CACHED, at most one per window. The
+ * canvas survives wdDestroyCanvas() and is handed out again for the next
+ * WM_PAINT of the window, unless its wdEndPaint() has failed (e.g. with
+ * D2DERR_RECREATE_TARGET).
+ *
+ * The windows are subclassed (see wd_cache_subclass_proc()), so their
+ * canvases are destroyed on WM_NCDESTROY. If that is not possible, entries
+ * of destroyed windows are dropped when the cache is searched next time. */
+typedef struct wd_cache_entry_tag wd_cache_entry_t;
+struct wd_cache_entry_tag {
+    HWND hwnd;
+    WD_HCANVAS canvas;
+    DWORD flags;
+    LONG width;
+    LONG height;
+    BOOL in_use;
+};
+
+static wd_cache_entry_t* wd_cache = NULL;
+static UINT wd_cache_count = 0;
+static UINT wd_cache_capacity = 0;
+
+/* Window subclassing of COMCTL32.DLL. The DLL is loaded on the first use and
+ * never unloaded: windows may stay subclassed even after wdTerminate(), as
+ * only the thread of a window can remove its subclass. */
+typedef LRESULT (CALLBACK* wd_SUBCLASSPROC)(HWND, UINT, WPARAM, LPARAM, UINT_PTR, DWORD_PTR);
+
+static BOOL wd_subclass_loaded = FALSE;
+static BOOL (WINAPI* wd_fn_SetWindowSubclass)(HWND, wd_SUBCLASSPROC, UINT_PTR, DWORD_PTR) = NULL;
+static BOOL (WINAPI* wd_fn_RemoveWindowSubclass)(HWND, wd_SUBCLASSPROC, UINT_PTR) = NULL;
+static LRESULT (WINAPI* wd_fn_DefSubclassProc)(HWND, UINT, WPARAM, LPARAM) = NULL;
+
+/* Returns TRUE if the canvas is kept in the cache, i.e. it must not be
+ * destroyed. */
+static BOOL
+wd_cache_release(WD_HCANVAS hCanvas)
+{
+    BYTE* state = wd_canvas_cache_state(hCanvas);
+    BOOL keep = FALSE;
+    UINT i;
+
+    if(*state == WD_CACHESTATE_NONE)
+        return FALSE;
+
+    wd_lock(WD_LOCKSITE_CANVASCACHE);
+    for(i = 0; i < wd_cache_count; i++) {
+        if(wd_cache[i].canvas == hCanvas) {
+            if(*state == WD_CACHESTATE_VALID) {
+                wd_cache[i].in_use = FALSE;
+                keep = TRUE;
+            } else {
+                wd_cache[i] = wd_cache[--wd_cache_count];
+            }
+            break;
+        }
+    }
+    wd_unlock();
+
+    return keep;
+}
+
+/* Destroys the cached canvases of the window. A canvas which is being painted
+ * just leaves the cache, so wdDestroyCanvas() really destroys it. */
+static void
+wd_cache_evict(HWND hWnd)
+{
+    WD_HCANVAS dead[8];
+    UINT dead_count;
+    UINT i;
+
+    do {
+        dead_count = 0;
+
+        wd_lock(WD_LOCKSITE_CANVASCACHE);
+        i = 0;
+        while(i < wd_cache_count  &&  dead_count < WD_SIZEOF_ARRAY(dead)) {
+            wd_cache_entry_t* e = &wd_cache[i];
+
+            if(e->hwnd == hWnd) {
+                if(!e->in_use)
+                    dead[dead_count++] = e->canvas;
+                *e = wd_cache[--wd_cache_count];
+                continue;
+            }
+            i++;
+        }
+        wd_unlock();
+
+        for(i = 0; i < dead_count; i++)
+            wdDestroyCanvasImpl(dead[i]);
+    } while(dead_count == WD_SIZEOF_ARRAY(dead));
+}
+
+static LRESULT CALLBACK
+wd_cache_subclass_proc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
+                       UINT_PTR id, DWORD_PTR data)
+{
+    if(uMsg == WM_NCDESTROY) {
+        wd_cache_evict(hWnd);
+        wd_fn_RemoveWindowSubclass(hWnd, wd_cache_subclass_proc, 0);
+    }
+
+    return wd_fn_DefSubclassProc(hWnd, uMsg, wParam, lParam);
+}
+
+/* Has to be called with the lock held. */
+static void
+wd_cache_load_subclass_api(void)
+{
+    HMODULE dll;
+
+    wd_subclass_loaded = TRUE;
+
+    dll = wd_load_system_dll(_T("COMCTL32.DLL"));
+    if(dll == NULL) {
+        WD_TRACE_ERR("wd_cache_load_subclass_api: "
+                     "wd_load_system_dll(COMCTL32.DLL) failed.");
+        return;
+    }
+
+    wd_fn_SetWindowSubclass = (BOOL (WINAPI*)(HWND, wd_SUBCLASSPROC, UINT_PTR, DWORD_PTR))
+                GetProcAddress(dll, "SetWindowSubclass");
+    wd_fn_RemoveWindowSubclass = (BOOL (WINAPI*)(HWND, wd_SUBCLASSPROC, UINT_PTR))
+                GetProcAddress(dll, "RemoveWindowSubclass");
+    wd_fn_DefSubclassProc = (LRESULT (WINAPI*)(HWND, UINT, WPARAM, LPARAM))
+                GetProcAddress(dll, "DefSubclassProc");
+
+    if(wd_fn_SetWindowSubclass == NULL  ||  wd_fn_RemoveWindowSubclass == NULL  ||
+       wd_fn_DefSubclassProc == NULL)
+    {
+        WD_TRACE("wd_cache_load_subclass_api: Subclassing API not available.");
+        wd_fn_SetWindowSubclass = NULL;
+        FreeLibrary(dll);
+    }
+}
+
+static WD_HCANVAS
+wd_cache_get(HWND hWnd, PAINTSTRUCT* pPS, DWORD dwFlags)
+{
+    WD_HCANVAS dead[8];
+    UINT dead_count = 0;
+    wd_cache_entry_t* entry = NULL;
+    WD_HCANVAS c;
+    RECT rect;
+    UINT i;
+
+    GetClientRect(hWnd, &rect);
+
+    wd_lock(WD_LOCKSITE_CANVASCACHE);
+    i = 0;
+    while(i < wd_cache_count) {
+        wd_cache_entry_t* e = &wd_cache[i];
+
+        if(!e->in_use  &&  dead_count < WD_SIZEOF_ARRAY(dead)  &&
+           (!IsWindow(e->hwnd)  ||  (e->hwnd == hWnd  &&  e->flags != dwFlags)))
+        {
+            dead[dead_count++] = e->canvas;
+            *e = wd_cache[--wd_cache_count];
+            continue;
+        }
+
+        if(e->hwnd == hWnd  &&  e->flags == dwFlags)
+            entry = e;
+        i++;
+    }
+
+    /* Nested painting of the window gets an ordinary canvas. */
+    if(entry != NULL  &&  entry->in_use) {
+        wd_unlock();
+        while(dead_count > 0)
+            wdDestroyCanvasImpl(dead[--dead_count]);
+        return wdCreateCanvasWithPaintStructImpl(hWnd, pPS, dwFlags & ~WD_CANVAS_CACHED);
+    }
+
+    if(entry != NULL) {
+        BOOL resize = (entry->width != rect.right  ||  entry->height != rect.bottom);
+
+        entry->in_use = TRUE;
+        entry->width = rect.right;
+        entry->height = rect.bottom;
+        c = entry->canvas;
+        wd_unlock();
+
+        if(resize  &&  !wdResizeCanvasImpl(c, rect.right, rect.bottom)) {
+            WD_TRACE("wd_cache_get: wdResizeCanvasImpl() failed.");
+            *wd_canvas_cache_state(c) = WD_CACHESTATE_INVALID;
+            wd_cache_release(c);
+            wdDestroyCanvasImpl(c);
+            c = NULL;
+        }
+    } else {
+        wd_unlock();
+        c = NULL;
+    }
+
+    while(dead_count > 0)
+        wdDestroyCanvasImpl(dead[--dead_count]);
+    if(c != NULL)
+        return c;
+
+    c = wdCreateCanvasWithPaintStructImpl(hWnd, pPS, dwFlags);
+    if(c == NULL)
+        return NULL;
+
+    wd_lock(WD_LOCKSITE_CANVASCACHE);
+    if(wd_cache_count >= wd_cache_capacity) {
+        UINT capacity = (wd_cache_capacity > 0 ? wd_cache_capacity * 2 : 8);
+        wd_cache_entry_t* cache;
+
+        cache = (wd_cache_entry_t*) realloc(wd_cache, capacity * sizeof(wd_cache_entry_t));
+        if(cache == NULL) {
+            /* Not fatal: The canvas just is not cached. */
+            WD_TRACE("wd_cache_get: realloc() failed.");
+            wd_unlock();
+            return c;
+        }
+        wd_cache = cache;
+        wd_cache_capacity = capacity;
+    }
+    entry = &wd_cache[wd_cache_count++];
+    entry->hwnd = hWnd;
+    entry->canvas = c;
+    entry->flags = dwFlags;
+    entry->width = rect.right;
+    entry->height = rect.bottom;
+    entry->in_use = TRUE;
+    *wd_canvas_cache_state(c) = WD_CACHESTATE_VALID;
+    if(!wd_subclass_loaded)
+        wd_cache_load_subclass_api();
+    wd_unlock();
+
+    /* We are in WM_PAINT, i.e. in the thread of the window, as the
+     * subclassing requires. (Subclassing the window again is harmless.) */
+    if(wd_fn_SetWindowSubclass != NULL  &&
+       !wd_fn_SetWindowSubclass(hWnd, wd_cache_subclass_proc, 0, 0))
+        WD_TRACE_ERR("wd_cache_get: SetWindowSubclass() failed.");
+
+    return c;
+}
+
 void
-wdDestroyCanvas(WD_HCANVAS hCanvas)
+wd_canvas_cache_fini(void)
+{
+    UINT i;
+
+    for(i = 0; i < wd_cache_count; i++) {
+        if(wd_cache[i].in_use)
+            WD_TRACE("wd_canvas_cache_fini: Logical error: Canvas still in use.");
+        wdDestroyCanvasImpl(wd_cache[i].canvas);
+
+        /* Fails for windows of other threads; their subclass procedure then
+         * just finds nothing to evict. */
+        if(wd_fn_RemoveWindowSubclass != NULL)
+            wd_fn_RemoveWindowSubclass(wd_cache[i].hwnd, wd_cache_subclass_proc, 0);
+    }
+
+    free(wd_cache);
+    wd_cache = NULL;
+    wd_cache_count = 0;
+    wd_cache_capacity = 0;
+}
+
+static void
+wd_capture_create_canvas(WD_HCANVAS hCanvas, DWORD dwFlags, const RECT* pRect)
+{
+    wd_capture_begin(WD_CAP_CREATECANVAS);
+    wd_capture_h_new(hCanvas);
+    wd_capture_u(dwFlags);
+    wd_capture_u(pRect->right - pRect->left);
+    wd_capture_u(pRect->bottom - pRect->top);
+    wd_capture_end();
+}
+
+WD_HCANVAS
+wdCreateCanvasWithPaintStruct(HWND hWnd, PAINTSTRUCT* pPS, DWORD dwFlags)
+{
+    WD_HCANVAS c;
+
+    /* Custom back-ends have no notion of windows. */
+    if(ops_enabled())
+        dwFlags &= ~WD_CANVAS_CACHED;
+
+    if(dwFlags & WD_CANVAS_CACHED)
+        c = wd_cache_get(hWnd, pPS, dwFlags);
+    else
+        c = wdCreateCanvasWithPaintStructImpl(hWnd, pPS, dwFlags);
+
+    if(WD_CAPTURE_ACTIVE()) {
+        RECT rect;
+
+        GetClientRect(hWnd, &rect);
+        wd_capture_create_canvas(c, dwFlags, &rect);
+    }
+
+    return c;
+}
+
+WD_HCANVAS
+wdCreateCanvasWithHDC(HDC hDC, const RECT* pRect, DWORD dwFlags)
+{
+    WD_HCANVAS c;
+
+    c = wdCreateCanvasWithHDCImpl(hDC, pRect, dwFlags);
+
+    if(WD_CAPTURE_ACTIVE())
+        wd_capture_create_canvas(c, dwFlags, pRect);
+
+    return c;
+}
+
+static WD_HCANVAS
+wdCreateCanvasWithBufferImpl(void* pBits, UINT uWidth, UINT uHeight,
+                             UINT uStride, DWORD dwFlags)
+{
+    void* canvas;
+    ops_canvas_t* c;
+
+    if(!sw_enabled()) {
+        WD_TRACE("wdCreateCanvasWithBuffer: Not supported by the back-end.");
+        return NULL;
+    }
+
+    canvas = sw_canvas_create_with_buffer(pBits, uWidth, uHeight, uStride);
+    if(canvas == NULL) {
+        WD_TRACE("wdCreateCanvasWithBuffer: sw_canvas_create_with_buffer() failed.");
+        return NULL;
+    }
+
+    c = ops_canvas_wrap(canvas, uWidth, uHeight, dwFlags);
+    if(c == NULL) {
+        WD_TRACE("wdCreateCanvasWithBuffer: ops_canvas_wrap() failed.");
+        return NULL;
+    }
+    return (WD_HCANVAS) c;
+}
+
+WD_HCANVAS
+wdCreateCanvasWithBuffer(void* pBits, UINT uWidth, UINT uHeight,
+                         UINT uStride, DWORD dwFlags)
 {
-    if(d2d_enabled()) {
+    WD_HCANVAS c;
+
+    c = wdCreateCanvasWithBufferImpl(pBits, uWidth, uHeight, uStride, dwFlags);
+
+    if(WD_CAPTURE_ACTIVE()) {
+        RECT rect = { 0, 0, (LONG) uWidth, (LONG) uHeight };
+        wd_capture_create_canvas(c, dwFlags, &rect);
+    }
+
+    return c;
+}
+
+static void
+wdDestroyCanvasImpl(WD_HCANVAS hCanvas)
+{
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        ops_canvas_free(c);
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
 
         /* Check for common logical errors. */
-        if(c->clip_layer != NULL  ||  (c->flags & D2D_CANVASFLAG_RECTCLIP))
+        if(c->clip_count > 0)
             WD_TRACE("wdDestroyCanvas: Logical error: Canvas has dangling clip.");
+        if(c->state_count > 0)
+            WD_TRACE("wdDestroyCanvas: Logical error: Unpaired wdSaveState()/wdRestoreState().");
         if(c->gdi_interop != NULL)
             WD_TRACE("wdDestroyCanvas: Logical error: Unpaired wdStartGdi()/wdEndGdi().");
 
-        dummy_ID2D1RenderTarget_Release(c->target);
-        free(c);
+        d2d_canvas_free(c);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+        gdix_canvas_free(c);
+    }
+}
 
-        gdix_vtable->fn_DeleteStringFormat(c->string_format);
-        gdix_vtable->fn_DeletePen(c->pen);
-        gdix_vtable->fn_DeleteGraphics(c->graphics);
-
-        if(c->real_dc != NULL) {
-            HBITMAP mem_bmp;
+void
+wdDestroyCanvas(WD_HCANVAS hCanvas)
+{
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DESTROYCANVAS);
+        wd_capture_h_free(hCanvas);
+        wd_capture_end();
+    }
 
-            mem_bmp = SelectObject(c->dc, c->orig_bmp);
-            DeleteObject(mem_bmp);
-            DeleteObject(c->dc);
-        }
+    if(wd_cache_release(hCanvas))
+        return;
 
-        free(c);
-    }
+    wdDestroyCanvasImpl(hCanvas);
 }
 
 void
 wdBeginPaint(WD_HCANVAS hCanvas)
 {
-    if(d2d_enabled()) {
+    wd_stats_t* stats = wd_canvas_stats(hCanvas);
+    UINT64 t0 = wd_ticks();
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_BEGINPAINT);
+        wd_capture_h(hCanvas);
+        wd_capture_end();
+    }
+
+    WD_EVENT_BEGIN("wdBeginPaint");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        wd_backend_ops->fnBeginPaint(c->canvas);
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1RenderTarget_BeginDraw(c->target);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+
+        /* Cached canvas: The DC of the previous WM_PAINT is gone. */
+        if(c->hwnd != NULL  &&  c->real_dc == NULL) {
+            c->real_dc = GetDC(c->hwnd);
+            c->own_real_dc = TRUE;
+            c->dc_layout = SetLayout(c->real_dc, 0);
+        }
+
         SetLayout(c->dc, 0);
     }
+
+    /* Lock usage of this thread until wdEndPaint() is attributed to the
+     * canvas. */
+    stats->lock_acquisitions_mark = wd_lock_thread_stats.acquisitions;
+    stats->lock_wait_ticks_mark = wd_lock_thread_stats.wait_ticks;
+    stats->begin_paint_ticks += wd_ticks() - t0;
+
+    WD_EVENT_END("wdBeginPaint");
 }
 
 BOOL
 wdEndPaint(WD_HCANVAS hCanvas)
 {
-    if(d2d_enabled()) {
+    wd_stats_t* stats = wd_canvas_stats(hCanvas);
+    UINT64 t0 = wd_ticks();
+    BOOL ret;
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_ENDPAINT);
+        wd_capture_h(hCanvas);
+        wd_capture_end();
+    }
+
+    WD_EVENT_BEGIN("wdEndPaint");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_reset_state(c);
+        if(c->dirty.partial  &&  wd_backend_ops->fnEndPaintRects != NULL) {
+            ret = wd_backend_ops->fnEndPaintRects(c->canvas,
+                        c->dirty.rects, c->dirty.count);
+        } else {
+            ret = wd_backend_ops->fnEndPaint(c->canvas);
+        }
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        int saved_dc = 0;
         HRESULT hr;
 
-        d2d_reset_clip(c);
+        d2d_reset_state(c);
 
+        /* The DC render target copies itself to the DC in EndDraw(). Clip
+         * the DC so only the dirty rectangles get copied. (Other targets
+         * cannot present partially.) */
+        if(c->dirty.partial  &&  c->type == D2D_CANVASTYPE_DC) {
+            saved_dc = SaveDC(c->dc);
+            wd_dirty_clip_dc(&c->dirty, c->dc, c->dc_origin.x, c->dc_origin.y);
+        }
+
+        WD_EVENT_BEGIN("ID2D1RenderTarget::EndDraw");
         hr = dummy_ID2D1RenderTarget_EndDraw(c->target, NULL, NULL);
+        WD_EVENT_END("ID2D1RenderTarget::EndDraw");
+        if(saved_dc != 0)
+            RestoreDC(c->dc, saved_dc);
         if(FAILED(hr)) {
             if(hr != D2DERR_RECREATE_TARGET)
                 WD_TRACE_HR("wdEndPaint: ID2D1RenderTarget::EndDraw() failed.");
-            return FALSE;
+            ret = FALSE;
+        } else {
+            ret = TRUE;
         }
-        return TRUE;
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
 
-        /* If double-buffering, blit the memory DC to the display DC. */
-        if(c->real_dc != NULL)
-            BitBlt(c->real_dc, c->x, c->y, c->cx, c->cy, c->dc, 0, 0, SRCCOPY);
+        gdix_reset_state(c);
+
+        /* If double-buffering, blit the memory DC to the display DC. Note
+         * the memory DC has its viewport origin set so that its logical
+         * coordinates match those of the display DC. */
+        if(c->real_dc != NULL) {
+            WD_EVENT_BEGIN("BitBlt");
+            if(c->dirty.partial) {
+                UINT i;
+
+                for(i = 0; i < c->dirty.count; i++) {
+                    const RECT* r = &c->dirty.rects[i];
+                    int x0 = WD_MAX(r->left, c->x);
+                    int y0 = WD_MAX(r->top, c->y);
+                    int x1 = WD_MIN(r->right, c->x + c->cx);
+                    int y1 = WD_MIN(r->bottom, c->y + c->cy);
+
+                    if(x0 < x1  &&  y0 < y1)
+                        BitBlt(c->real_dc, x0, y0, x1 - x0, y1 - y0, c->dc, x0, y0, SRCCOPY);
+                }
+            } else {
+                BitBlt(c->real_dc, c->x, c->y, c->cx, c->cy, c->dc, c->x, c->y, SRCCOPY);
+            }
+            WD_EVENT_END("BitBlt");
+        }
 
         SetLayout(c->real_dc, c->dc_layout);
 
-        /* For GDI+, disable caching. */
-        return FALSE;
+        /* Only a canvas with its own window-sized buffer may be cached. */
+        if(c->hwnd != NULL) {
+            if(c->own_real_dc)
+                ReleaseDC(c->hwnd, c->real_dc);
+            c->real_dc = NULL;
+            c->own_real_dc = FALSE;
+            ret = TRUE;
+        } else {
+            ret = FALSE;
+        }
+    }
+
+    stats->lock_acquisitions += wd_lock_thread_stats.acquisitions - stats->lock_acquisitions_mark;
+    stats->lock_wait_ticks += wd_lock_thread_stats.wait_ticks - stats->lock_wait_ticks_mark;
+    stats->paints++;
+    stats->end_paint_ticks += wd_ticks() - t0;
+
+    /* Dirty rectangles are per paint. */
+    wd_dirty_reset(wd_canvas_dirty(hCanvas));
+
+    /* The canvas cannot be reused (see wd_cache_release()). */
+    if(!ret  &&  *wd_canvas_cache_state(hCanvas) == WD_CACHESTATE_VALID)
+        *wd_canvas_cache_state(hCanvas) = WD_CACHESTATE_INVALID;
+
+    WD_EVENT_END("wdEndPaint");
+    return ret;
+}
+
+/* Dirty rectangles are in pixels of the canvas, mirrored for
+ * WD_CANVAS_LAYOUTRTL the same way as the painting. */
+static void
+wd_add_dirty_rect(WD_HCANVAS hCanvas, const RECT* pRect)
+{
+    RECT r = *pRect;
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        if(c->rtl) {
+            r.left = (LONG) c->width - pRect->right;
+            r.right = (LONG) c->width - pRect->left;
+        }
+        wd_dirty_add(&c->dirty, &r);
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+
+        if(c->flags & D2D_CANVASFLAG_RTL) {
+            r.left = (LONG) c->width - pRect->right;
+            r.right = (LONG) c->width - pRect->left;
+        }
+        wd_dirty_add(&c->dirty, &r);
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+
+        /* The GDI+ back-end mirrors around (width-1)/2 (see
+         * gdix_base_transform()): Take one more pixel to be sure. */
+        if(c->rtl) {
+            r.left = (LONG) c->width - 1 - pRect->right;
+            r.right = (LONG) c->width - pRect->left;
+        }
+        wd_dirty_add(&c->dirty, &r);
     }
 }
 
-BOOL
-wdResizeCanvas(WD_HCANVAS hCanvas, UINT uWidth, UINT uHeight)
+void
+wdAddDirtyRect(WD_HCANVAS hCanvas, const RECT* pRect)
+{
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_ADDDIRTYRECT);
+        wd_capture_h(hCanvas);
+        wd_capture_i(pRect->left);
+        wd_capture_i(pRect->top);
+        wd_capture_i(pRect->right);
+        wd_capture_i(pRect->bottom);
+        wd_capture_end();
+    }
+
+    wd_add_dirty_rect(hCanvas, pRect);
+}
+
+void
+wdSetDirtyRegion(WD_HCANVAS hCanvas, const RECT* pRects, UINT uCount)
+{
+    UINT i;
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_SETDIRTYREGION);
+        wd_capture_h(hCanvas);
+        wd_capture_u(uCount);
+        for(i = 0; i < uCount; i++) {
+            wd_capture_i(pRects[i].left);
+            wd_capture_i(pRects[i].top);
+            wd_capture_i(pRects[i].right);
+            wd_capture_i(pRects[i].bottom);
+        }
+        wd_capture_end();
+    }
+
+    wd_dirty_reset(wd_canvas_dirty(hCanvas));
+    for(i = 0; i < uCount; i++)
+        wd_add_dirty_rect(hCanvas, &pRects[i]);
+}
+
+static BOOL
+wdResizeCanvasImpl(WD_HCANVAS hCanvas, UINT uWidth, UINT uHeight)
 {
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        WD_MATRIX user;
+
+        if(!wd_backend_ops->fnResizeCanvas(c->canvas, uWidth, uHeight)) {
+            WD_TRACE("wdResizeCanvas: WD_BACKEND_OPS::fnResizeCanvas() failed.");
+            return FALSE;
+        }
+
+        /* In RTL mode, the base transformation depends on the width. */
+        ops_get_user_transform(c, &user);
+        c->width = uWidth;
+        ops_set_user_transform(c, &user);
+
+        c->viewport.x1 = (float) uWidth;
+        c->viewport.y1 = (float) uHeight;
+        return TRUE;
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         if(c->type == D2D_CANVASTYPE_HWND) {
             dummy_D2D1_SIZE_U size = { uWidth, uHeight };
+            dummy_D2D1_MATRIX_3X2_F user;
             HRESULT hr;
 
             hr = dummy_ID2D1HwndRenderTarget_Resize(c->hwnd_target, &size);
@@ -243,18 +858,12 @@ wdResizeCanvas(WD_HCANVAS hCanvas, UINT uWidth, UINT uHeight)
                 return FALSE;
             }
 
-            /* In RTL mode, we have to update the transformation matrix
-             * accordingly. */
-            if(c->flags & D2D_CANVASFLAG_RTL) {
-                dummy_D2D1_MATRIX_3X2_F m;
-
-                dummy_ID2D1RenderTarget_GetTransform(c->target, &m);
-                m._31 = m._11 * (float)(uWidth - c->width);
-                m._32 = m._12 * (float)(uWidth - c->width);
-                dummy_ID2D1RenderTarget_SetTransform(c->target, &m);
-
-                c->width = uWidth;
-            }
+            /* The size bounds the culling (see d2d_visible_bounds()) and,
+             * in RTL mode, the base transformation depends on the width. */
+            d2d_get_user_transform(c, &user);
+            c->width = uWidth;
+            c->height = uHeight;
+            d2d_set_user_transform(c, &user);
             return TRUE;
         } else {
             /* Operation not supported. */
@@ -262,17 +871,131 @@ wdResizeCanvas(WD_HCANVAS hCanvas, UINT uWidth, UINT uHeight)
             return FALSE;
         }
     } else {
-        /* Actually we should never be here as GDI+ back-end never allows
-         * caching of the canvas so there is no need to ever resize it. */
-        WD_TRACE("wdResizeCanvas: Not supported (GDI+ back-end).");
-        return FALSE;
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+
+        if(gdix_canvas_resize(c, uWidth, uHeight) != 0) {
+            WD_TRACE("wdResizeCanvas: gdix_canvas_resize() failed.");
+            return FALSE;
+        }
+        return TRUE;
+    }
+}
+
+BOOL
+wdResizeCanvas(WD_HCANVAS hCanvas, UINT uWidth, UINT uHeight)
+{
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_RESIZECANVAS);
+        wd_capture_h(hCanvas);
+        wd_capture_u(uWidth);
+        wd_capture_u(uHeight);
+        wd_capture_end();
+    }
+
+    return wdResizeCanvasImpl(hCanvas, uWidth, uHeight);
+}
+
+static BOOL
+wdRebindCanvasToHDCImpl(WD_HCANVAS hCanvas, HDC hDC, const RECT* pRect)
+{
+    UINT width = pRect->right - pRect->left;
+    UINT height = pRect->bottom - pRect->top;
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        WD_MATRIX user;
+
+        if(wd_backend_ops->fnRebindCanvas == NULL) {
+            WD_TRACE("wdRebindCanvasToHDC: Not supported by the back-end.");
+            return FALSE;
+        }
+        if(!wd_backend_ops->fnRebindCanvas(c->canvas, hDC, width, height)) {
+            WD_TRACE("wdRebindCanvasToHDC: WD_BACKEND_OPS::fnRebindCanvas() failed.");
+            return FALSE;
+        }
+        if(sw_enabled())
+            sw_canvas_set_origin(c->canvas, pRect->left, pRect->top);
+
+        /* In RTL mode, the base transformation depends on the width. */
+        ops_get_user_transform(c, &user);
+        c->width = width;
+        ops_set_user_transform(c, &user);
+
+        c->viewport.x1 = (float) width;
+        c->viewport.y1 = (float) height;
+        return TRUE;
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        dummy_D2D1_MATRIX_3X2_F user;
+        HRESULT hr;
+
+        if(c->type != D2D_CANVASTYPE_DC) {
+            WD_TRACE("wdRebindCanvasToHDC: Not supported (not ID2D1DCRenderTarget).");
+            return FALSE;
+        }
+
+        hr = dummy_ID2D1DCRenderTarget_BindDC((dummy_ID2D1DCRenderTarget*) c->target, hDC, pRect);
+        if(FAILED(hr)) {
+            WD_TRACE_HR("wdRebindCanvasToHDC: ID2D1DCRenderTarget::BindDC() failed.");
+            return FALSE;
+        }
+
+        c->dc = hDC;
+        c->dc_origin.x = pRect->left;
+        c->dc_origin.y = pRect->top;
+
+        /* In RTL mode, the base transformation depends on the width. */
+        d2d_get_user_transform(c, &user);
+        c->width = width;
+        c->height = height;
+        d2d_set_user_transform(c, &user);
+        return TRUE;
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+
+        if(gdix_canvas_rebind(c, hDC, pRect) != 0) {
+            WD_TRACE("wdRebindCanvasToHDC: gdix_canvas_rebind() failed.");
+            return FALSE;
+        }
+        return TRUE;
+    }
+}
+
+BOOL
+wdRebindCanvasToHDC(WD_HCANVAS hCanvas, HDC hDC, const RECT* pRect)
+{
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_REBINDCANVAS);
+        wd_capture_h(hCanvas);
+        wd_capture_i(pRect->left);
+        wd_capture_i(pRect->top);
+        wd_capture_i(pRect->right);
+        wd_capture_i(pRect->bottom);
+        wd_capture_end();
     }
+
+    return wdRebindCanvasToHDCImpl(hCanvas, hDC, pRect);
 }
 
 HDC
 wdStartGdi(WD_HCANVAS hCanvas, BOOL bKeepContents)
 {
-    if(d2d_enabled()) {
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_STARTGDI);
+        wd_capture_h(hCanvas);
+        wd_capture_u(bKeepContents);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        if(wd_backend_ops->fnStartGdi == NULL) {
+            WD_TRACE("wdStartGdi: Not supported by the custom back-end.");
+            return NULL;
+        }
+        return wd_backend_ops->fnStartGdi(c->canvas, bKeepContents);
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1GdiInteropRenderTarget* gdi_interop;
         dummy_D2D1_DC_INITIALIZE_MODE init_mode;
@@ -325,7 +1048,18 @@ wdStartGdi(WD_HCANVAS hCanvas, BOOL bKeepContents)
 void
 wdEndGdi(WD_HCANVAS hCanvas, HDC hDC)
 {
-    if(d2d_enabled()) {
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_ENDGDI);
+        wd_capture_h(hCanvas);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        if(wd_backend_ops->fnEndGdi != NULL)
+            wd_backend_ops->fnEndGdi(c->canvas, hDC);
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
 
         dummy_ID2D1GdiInteropRenderTarget_ReleaseDC(c->gdi_interop, NULL);
@@ -343,7 +1077,23 @@ wdEndGdi(WD_HCANVAS hCanvas, HDC hDC)
 void
 wdClear(WD_HCANVAS hCanvas, WD_COLOR color)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_CLEAR);
+        wd_dlist_c(color);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_CLEAR);
+        wd_capture_h(hCanvas);
+        wd_capture_c(color);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        wd_backend_ops->fnClear(c->canvas, color);
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_D2D1_COLOR_F clr;
 
@@ -358,82 +1108,340 @@ wdClear(WD_HCANVAS hCanvas, WD_COLOR color)
 void
 wdSetClip(WD_HCANVAS hCanvas, const WD_RECT* pRect, const WD_HPATH hPath)
 {
-    if(d2d_enabled()) {
-        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_SETCLIP);
+        wd_dlist_rect_opt(pRect);
+        wd_dlist_h(hPath);
+        return;
+    }
 
-        d2d_reset_clip(c);
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_SETCLIP);
+        wd_capture_h(hCanvas);
+        wd_capture_rect_opt(pRect);
+        wd_capture_h(hPath);
+        wd_capture_end();
+    }
 
-        if(hPath != NULL) {
-            dummy_ID2D1PathGeometry* g = (dummy_ID2D1PathGeometry*) hPath;
-            dummy_D2D1_LAYER_PARAMETERS layer_params;
-            HRESULT hr;
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
 
-            hr = dummy_ID2D1RenderTarget_CreateLayer(c->target, NULL, &c->clip_layer);
-            if(FAILED(hr)) {
-                WD_TRACE_HR("wdSetClip: ID2D1RenderTarget::CreateLayer() failed.");
-                return;
-            }
+        ops_reset_clip(c);
 
-            if(pRect != NULL) {
-                layer_params.contentBounds.left = pRect->x0;
-                layer_params.contentBounds.top = pRect->y0;
-                layer_params.contentBounds.right = pRect->x1;
-                layer_params.contentBounds.bottom = pRect->y1;
-            } else {
-                layer_params.contentBounds.left = FLT_MIN;
-                layer_params.contentBounds.top = FLT_MIN;
-                layer_params.contentBounds.right = FLT_MAX;
-                layer_params.contentBounds.bottom = FLT_MAX;
-            }
-            layer_params.geometricMask = (dummy_ID2D1Geometry*) g;
-            layer_params.maskAntialiasMode = dummy_D2D1_ANTIALIAS_MODE_PER_PRIMITIVE;
-            layer_params.maskTransform._11 = 1.0f;
-            layer_params.maskTransform._12 = 0.0f;
-            layer_params.maskTransform._21 = 0.0f;
-            layer_params.maskTransform._22 = 1.0f;
-            layer_params.maskTransform._31 = 0.0f;
-            layer_params.maskTransform._32 = 0.0f;
-            layer_params.opacity = 1.0f;
-            layer_params.opacityBrush = NULL;
-            layer_params.layerOptions = dummy_D2D1_LAYER_OPTIONS_NONE;
-
-            dummy_ID2D1RenderTarget_PushLayer(c->target, &layer_params, c->clip_layer);
-        } else if(pRect != NULL) {
-            dummy_ID2D1RenderTarget_PushAxisAlignedClip(c->target,
-                    (const dummy_D2D1_RECT_F*) pRect, dummy_D2D1_ANTIALIAS_MODE_PER_PRIMITIVE);
-            c->flags |= D2D_CANVASFLAG_RECTCLIP;
-        }
+        if(pRect != NULL  ||  hPath != NULL)
+            ops_push_clip(c, pRect, wd_path_backend(hPath));
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+
+        d2d_reset_clip(c);
+
+        if(hPath != NULL)
+            d2d_push_clip_path(c, (dummy_ID2D1Geometry*) wd_path_backend(hPath), pRect);
+        else if(pRect != NULL)
+            d2d_push_clip_rect(c, pRect);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
         int mode;
 
-        if(pRect == NULL  &&  hPath == NULL) {
-            gdix_vtable->fn_ResetClip(c->graphics);
+        gdix_reset_clip(c);
+
+        if(pRect == NULL  &&  hPath == NULL)
             return;
-        }
+
+        /* Remember the unclipped state so wdPopClip() can get back to it. */
+        if(gdix_save_clip(c, pRect) != 0)
+            return;
+
+        gdix_sync_transform(c);
 
         mode = dummy_CombineModeReplace;
 
         if(pRect != NULL) {
             gdix_vtable->fn_SetClipRect(c->graphics, pRect->x0, pRect->y0,
-                             pRect->x1, pRect->y1, mode);
+                             pRect->x1 - pRect->x0, pRect->y1 - pRect->y0, mode);
             mode = dummy_CombineModeIntersect;
         }
 
         if(hPath != NULL)
-            gdix_vtable->fn_SetClipPath(c->graphics, (void*) hPath, mode);
+            gdix_vtable->fn_SetClipPath(c->graphics, wd_path_backend(hPath), mode);
+    }
+}
+
+void
+wdPushClipRect(WD_HCANVAS hCanvas, const WD_RECT* pRect)
+{
+    if(pRect == NULL) {
+        WD_TRACE("wdPushClipRect: Invalid pRect");
+        return;
+    }
+
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_PUSHCLIPRECT);
+        wd_dlist_rect(pRect);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_PUSHCLIPRECT);
+        wd_capture_h(hCanvas);
+        wd_capture_rect_opt(pRect);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        ops_push_clip(c, pRect, NULL);
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        d2d_push_clip_rect(c, pRect);
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+
+        if(gdix_save_clip(c, pRect) != 0)
+            return;
+
+        gdix_sync_transform(c);
+        gdix_vtable->fn_SetClipRect(c->graphics, pRect->x0, pRect->y0,
+                pRect->x1 - pRect->x0, pRect->y1 - pRect->y0, dummy_CombineModeIntersect);
+    }
+}
+
+void
+wdPushClipPath(WD_HCANVAS hCanvas, const WD_HPATH hPath, const WD_RECT* pRect)
+{
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_PUSHCLIPPATH);
+        wd_dlist_h(hPath);
+        wd_dlist_rect_opt(pRect);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_PUSHCLIPPATH);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hPath);
+        wd_capture_rect_opt(pRect);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        ops_push_clip(c, pRect, wd_path_backend(hPath));
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        d2d_push_clip_path(c, (dummy_ID2D1Geometry*) wd_path_backend(hPath), pRect);
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+
+        if(gdix_save_clip(c, pRect) != 0)
+            return;
+
+        gdix_sync_transform(c);
+        if(pRect != NULL) {
+            gdix_vtable->fn_SetClipRect(c->graphics, pRect->x0, pRect->y0,
+                    pRect->x1 - pRect->x0, pRect->y1 - pRect->y0, dummy_CombineModeIntersect);
+        }
+        gdix_vtable->fn_SetClipPath(c->graphics, wd_path_backend(hPath), dummy_CombineModeIntersect);
+    }
+}
+
+void
+wdPopClip(WD_HCANVAS hCanvas)
+{
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_POPCLIP);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_POPCLIP);
+        wd_capture_h(hCanvas);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        ops_pop_clip(c);
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        d2d_pop_clip(c);
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+        gdix_restore_clip(c);
+    }
+}
+
+void
+wdGetCullStats(WD_HCANVAS hCanvas, WD_CULLSTATS* pStats)
+{
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        pStats->uTested = c->cull_tested;
+        pStats->uCulled = c->cull_culled;
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+
+        pStats->uTested = c->cull_tested;
+        pStats->uCulled = c->cull_culled;
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+
+        pStats->uTested = c->cull_tested;
+        pStats->uCulled = c->cull_culled;
+    }
+}
+
+void
+wdResetCullStats(WD_HCANVAS hCanvas)
+{
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        c->cull_tested = 0;
+        c->cull_culled = 0;
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+
+        c->cull_tested = 0;
+        c->cull_culled = 0;
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+
+        c->cull_tested = 0;
+        c->cull_culled = 0;
+    }
+}
+
+void
+wdGetCanvasStats(WD_HCANVAS hCanvas, WD_CANVAS_STATS* pStats)
+{
+    wd_stats_t* stats = wd_canvas_stats(hCanvas);
+    int i;
+
+    for(i = 0; i < WD_PRIMITIVE_COUNT; i++)
+        pStats->uDrawCalls[i] = stats->draw_calls[i];
+    if(ops_enabled())
+        pStats->uCulledCalls = ((ops_canvas_t*) hCanvas)->cull_culled;
+    else if(d2d_enabled())
+        pStats->uCulledCalls = ((d2d_canvas_t*) hCanvas)->cull_culled;
+    else
+        pStats->uCulledCalls = ((gdix_canvas_t*) hCanvas)->cull_culled;
+    pStats->uBitmapUploads = stats->bitmap_uploads;
+    pStats->uBitmapUploadBytes = stats->bitmap_upload_bytes;
+    pStats->uGeometriesCreated = stats->geometries;
+    pStats->uLayersCreated = stats->layers;
+    pStats->uTextLayoutsCreated = stats->text_layouts;
+    pStats->uLockAcquisitions = stats->lock_acquisitions;
+    pStats->uLockWaitMicroseconds = wd_ticks_to_us(stats->lock_wait_ticks);
+    pStats->uPaintCount = stats->paints;
+    pStats->uBeginPaintMicroseconds = wd_ticks_to_us(stats->begin_paint_ticks);
+    pStats->uEndPaintMicroseconds = wd_ticks_to_us(stats->end_paint_ticks);
+}
+
+void
+wdResetCanvasStats(WD_HCANVAS hCanvas)
+{
+    wd_stats_t* stats = wd_canvas_stats(hCanvas);
+    UINT64 acquisitions_mark = stats->lock_acquisitions_mark;
+    UINT64 wait_ticks_mark = stats->lock_wait_ticks_mark;
+
+    /* Keep the marks so a reset in the middle of painting works. */
+    memset(stats, 0, sizeof(wd_stats_t));
+    stats->lock_acquisitions_mark = acquisitions_mark;
+    stats->lock_wait_ticks_mark = wait_ticks_mark;
+
+    wdResetCullStats(hCanvas);
+}
+
+void
+wdSaveState(WD_HCANVAS hCanvas)
+{
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_SAVESTATE);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_SAVESTATE);
+        wd_capture_h(hCanvas);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        ops_save_state(c);
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        d2d_save_state(c);
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+        gdix_save_state(c);
+    }
+}
+
+void
+wdRestoreState(WD_HCANVAS hCanvas)
+{
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_RESTORESTATE);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_RESTORESTATE);
+        wd_capture_h(hCanvas);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        ops_restore_state(c);
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        d2d_restore_state(c);
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+        gdix_restore_state(c);
     }
 }
 
 void
 wdRotateWorld(WD_HCANVAS hCanvas, float cx, float cy, float fAngle)
 {
-    if(d2d_enabled()) {
+    float a_rads = fAngle * (WD_PI / 180.0f);
+    float a_sin = sinf(a_rads);
+    float a_cos = cosf(a_rads);
+
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_ROTATEWORLD);
+        wd_dlist_f(cx);
+        wd_dlist_f(cy);
+        wd_dlist_f(fAngle);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_ROTATEWORLD);
+        wd_capture_h(hCanvas);
+        wd_capture_f(cx);
+        wd_capture_f(cy);
+        wd_capture_f(fAngle);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        WD_MATRIX m;
+
+        m.m11 = a_cos;  m.m12 = a_sin;
+        m.m21 = -a_sin; m.m22 = a_cos;
+        m.dx = cx - cx*a_cos + cy*a_sin;
+        m.dy = cy - cx*a_sin - cy*a_cos;
+        ops_apply_transform(c, &m);
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_D2D1_MATRIX_3X2_F m;
-        float a_rads = fAngle * (WD_PI / 180.0f);
-        float a_sin = sinf(a_rads);
-        float a_cos = cosf(a_rads);
 
         m._11 = a_cos;  m._12 = a_sin;
         m._21 = -a_sin; m._22 = a_cos;
@@ -442,27 +1450,52 @@ wdRotateWorld(WD_HCANVAS hCanvas, float cx, float cy, float fAngle)
         d2d_apply_transform(c, &m);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+        WD_MATRIX m;
 
-        gdix_vtable->fn_TranslateWorldTransform(c->graphics, cx, cy, dummy_MatrixOrderPrepend);
-        gdix_vtable->fn_RotateWorldTransform(c->graphics, fAngle, dummy_MatrixOrderPrepend);
-        gdix_vtable->fn_TranslateWorldTransform(c->graphics, -cx, -cy, dummy_MatrixOrderPrepend);
+        m.m11 = a_cos;  m.m12 = a_sin;
+        m.m21 = -a_sin; m.m22 = a_cos;
+        m.dx = cx - cx*a_cos + cy*a_sin;
+        m.dy = cy - cx*a_sin - cy*a_cos;
+        gdix_apply_transform(c, &m);
     }
 }
 
 void
 wdTranslateWorld(WD_HCANVAS hCanvas, float dx, float dy)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_TRANSLATEWORLD);
+        wd_dlist_f(dx);
+        wd_dlist_f(dy);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_TRANSLATEWORLD);
+        wd_capture_h(hCanvas);
+        wd_capture_f(dx);
+        wd_capture_f(dy);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        c->matrix.dx += dx;
+        c->matrix.dy += dy;
+        c->matrix_dirty = TRUE;
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
-        dummy_D2D1_MATRIX_3X2_F m;
 
-        dummy_ID2D1RenderTarget_GetTransform(c->target, &m);
-        m._31 += dx;
-        m._32 += dy;
-        dummy_ID2D1RenderTarget_SetTransform(c->target, &m);
+        c->matrix._31 += dx;
+        c->matrix._32 += dy;
+        c->flags |= D2D_CANVASFLAG_MATRIXDIRTY;
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
-        gdix_vtable->fn_TranslateWorldTransform(c->graphics, dx, dy, dummy_MatrixOrderAppend);
+
+        c->matrix.dx += dx;
+        c->matrix.dy += dy;
+        c->matrix_dirty = TRUE;
     }
 }
 
@@ -470,47 +1503,54 @@ void
 wdTransformWorld(WD_HCANVAS hCanvas, const WD_MATRIX* pMatrix)
 {
     if(pMatrix == NULL) {
-        WD_TRACE("wdSetWorldTransform: Invalid pMatrix");
+        WD_TRACE("wdTransformWorld: Invalid pMatrix");
         return;
     }
-    if(d2d_enabled()) {
-        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
 
-        dummy_D2D1_MATRIX_3X2_F m;
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_TRANSFORMWORLD);
+        wd_dlist_matrix(pMatrix);
+        return;
+    }
 
-        m._11 = pMatrix->m11;
-        m._12 = pMatrix->m12;
-        m._21 = pMatrix->m21;
-        m._22 = pMatrix->m22;
-        m._31 = pMatrix->dx;
-        m._32 = pMatrix->dy;
-        d2d_apply_transform(c, &m);
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_TRANSFORMWORLD);
+        wd_capture_h(hCanvas);
+        wd_capture_matrix(pMatrix);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        ops_apply_transform(c, pMatrix);
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        d2d_apply_transform(c, (const dummy_D2D1_MATRIX_3X2_F*) pMatrix);
     } else {
-        int status;
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
-
-        dummy_GpMatrix* matrix;
-        status = gdix_vtable->fn_CreateMatrix2(pMatrix->m11, pMatrix->m12,
-                                               pMatrix->m21, pMatrix->m22,
-                                               pMatrix->dx, pMatrix->dy, &matrix);
-        if(status != 0) {
-            WD_TRACE_ERR_("wdSetWorldTransform: GdpiCreateMatrix2() failed", status);
-            return;
-        }
-        status = gdix_vtable->fn_MultiplyWorldTransform(c->graphics, matrix, dummy_MatrixOrderPrepend);
-        if(status != 0) {
-            WD_TRACE_ERR_("wdSetWorldTransform: MultiplyWorldTransform() failed", status);
-            gdix_delete_matrix(matrix);
-            return;
-        }
-        gdix_delete_matrix(matrix);
+        gdix_apply_transform(c, pMatrix);
     }
 }
 
 void
 wdResetWorld(WD_HCANVAS hCanvas)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_RESETWORLD);
+        wd_dlist_current->absolute = TRUE;
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_RESETWORLD);
+        wd_capture_h(hCanvas);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        ops_reset_transform(c);
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         d2d_reset_transform(c);
     } else {
@@ -519,3 +1559,52 @@ wdResetWorld(WD_HCANVAS hCanvas)
     }
 }
 
+void
+wdGetWorldTransform(WD_HCANVAS hCanvas, WD_MATRIX* pMatrix)
+{
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        ops_get_user_transform(c, pMatrix);
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        d2d_get_user_transform(c, (dummy_D2D1_MATRIX_3X2_F*) pMatrix);
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+        gdix_get_user_transform(c, pMatrix);
+    }
+}
+
+void
+wdSetWorldTransform(WD_HCANVAS hCanvas, const WD_MATRIX* pMatrix)
+{
+    /* (wdResetWorld() is captured on its own.) */
+    if(pMatrix == NULL) {
+        wdResetWorld(hCanvas);
+        return;
+    }
+
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_SETWORLDTRANSFORM);
+        wd_dlist_matrix(pMatrix);
+        wd_dlist_current->absolute = TRUE;
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_SETWORLDTRANSFORM);
+        wd_capture_h(hCanvas);
+        wd_capture_matrix(pMatrix);
+        wd_capture_end();
+    }
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        ops_set_user_transform(c, pMatrix);
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        d2d_set_user_transform(c, (const dummy_D2D1_MATRIX_3X2_F*) pMatrix);
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+        gdix_set_user_transform(c, pMatrix);
+    }
+}
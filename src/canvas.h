@@ -0,0 +1,194 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef WD_CANVAS_H
+#define WD_CANVAS_H
+
+#include "misc.h"
+#include "backend-ops.h"
+#include "backend-d2d.h"
+#include "backend-gdix.h"
+
+
+static inline wd_stats_t*
+wd_canvas_stats(WD_HCANVAS hCanvas)
+{
+    if(ops_enabled())
+        return &((ops_canvas_t*) hCanvas)->stats;
+    else if(d2d_enabled())
+        return &((d2d_canvas_t*) hCanvas)->stats;
+    else
+        return &((gdix_canvas_t*) hCanvas)->stats;
+}
+
+static inline wd_dirty_t*
+wd_canvas_dirty(WD_HCANVAS hCanvas)
+{
+    if(ops_enabled())
+        return &((ops_canvas_t*) hCanvas)->dirty;
+    else if(d2d_enabled())
+        return &((d2d_canvas_t*) hCanvas)->dirty;
+    else
+        return &((gdix_canvas_t*) hCanvas)->dirty;
+}
+
+/* Life cycle of a canvas created with WD_CANVAS_CACHED. */
+#define WD_CACHESTATE_NONE      0   /* Not managed by the canvas cache. */
+#define WD_CACHESTATE_VALID     1   /* wdDestroyCanvas() keeps it for reuse. */
+#define WD_CACHESTATE_INVALID   2   /* wdEndPaint() failed, it has to go. */
+
+static inline BYTE*
+wd_canvas_cache_state(WD_HCANVAS hCanvas)
+{
+    if(ops_enabled())
+        return &((ops_canvas_t*) hCanvas)->cache_state;
+    else if(d2d_enabled())
+        return &((d2d_canvas_t*) hCanvas)->cache_state;
+    else
+        return &((gdix_canvas_t*) hCanvas)->cache_state;
+}
+
+/* Destroys all canvases kept for WD_CANVAS_CACHED. */
+void wd_canvas_cache_fini(void);
+
+#define WD_STATS_DRAWCALL(hCanvas, prim)                                        \
+            do { wd_canvas_stats(hCanvas)->draw_calls[(prim)]++; } while(0)
+
+/* Batches (like wdFillRects()) count every item. */
+#define WD_STATS_DRAWCALLS(hCanvas, prim, n)                                    \
+            do { wd_canvas_stats(hCanvas)->draw_calls[(prim)] += (n); } while(0)
+
+
+/* How much to inflate bounds of a stroked primitive so that everything the
+ * stroke may paint is included. (Half of the width would be enough for round
+ * joins and flat caps; square caps and miter joins of rectangles stick out
+ * by up to sqrt(2) times more.) */
+#define WD_CULL_STROKE(width)       ((width) * 0.75f)
+
+/* Pies have an arbitrarily sharp corner in the center, and so may have
+ * polylines. Their miter joins stick out by up to half the width times the
+ * miter limit (see wd_strokestyle_miter_limit()). */
+#define WD_CULL_STROKE_MITER(width, miter_limit)                            \
+            ((width) * 0.5f * WD_MAX((miter_limit), 1.5f))
+
+
+/* For canvases created with WD_CANVAS_CULLING: Returns TRUE if the rectangle
+ * (in world coordinates, inflated by the given amount) is completely outside
+ * of the visible area, so the caller may skip painting altogether. */
+static inline BOOL
+wd_cull(WD_HCANVAS hCanvas, float x0, float y0, float x1, float y1, float inflate)
+{
+    WD_RECT visible;
+    BOOL culled;
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        if(!c->culling)
+            return FALSE;
+
+        ops_visible_bounds(c, &visible);
+        culled = wd_bounds_invisible(&c->matrix, &visible,
+                        x0, y0, x1, y1, inflate);
+        c->cull_tested++;
+        if(culled)
+            c->cull_culled++;
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+
+        if(!(c->flags & D2D_CANVASFLAG_CULLING))
+            return FALSE;
+
+        d2d_visible_bounds(c, &visible);
+        culled = wd_bounds_invisible((const WD_MATRIX*) &c->matrix, &visible,
+                        x0, y0, x1, y1, inflate);
+        c->cull_tested++;
+        if(culled)
+            c->cull_culled++;
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+
+        if(!c->culling)
+            return FALSE;
+
+        gdix_visible_bounds(c, &visible);
+        culled = wd_bounds_invisible(&c->matrix, &visible,
+                        x0, y0, x1, y1, inflate);
+        c->cull_tested++;
+        if(culled)
+            c->cull_culled++;
+    }
+
+    return culled;
+}
+
+/* Batches use this to avoid computing their bounds for nothing. */
+static inline BOOL
+wd_cull_enabled(WD_HCANVAS hCanvas)
+{
+    if(ops_enabled())
+        return ((ops_canvas_t*) hCanvas)->culling;
+    else if(d2d_enabled())
+        return (((d2d_canvas_t*) hCanvas)->flags & D2D_CANVASFLAG_CULLING) != 0;
+    else
+        return ((gdix_canvas_t*) hCanvas)->culling;
+}
+
+/* World transform of the canvas and the device-space bounds of its visible
+ * area, i.e. what wd_cull() tests against. */
+static inline void
+wd_canvas_visible(WD_HCANVAS hCanvas, WD_MATRIX* m, WD_RECT* visible)
+{
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        memcpy(m, &c->matrix, sizeof(WD_MATRIX));
+        ops_visible_bounds(c, visible);
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+
+        /* (D2D1_MATRIX_3X2_F and WD_MATRIX are binary compatible.) */
+        memcpy(m, &c->matrix, sizeof(WD_MATRIX));
+        d2d_visible_bounds(c, visible);
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+
+        memcpy(m, &c->matrix, sizeof(WD_MATRIX));
+        gdix_visible_bounds(c, visible);
+    }
+}
+
+/* Count of the clips pushed on the canvas (wdSetClip() counts as one). */
+static inline UINT
+wd_canvas_clip_depth(WD_HCANVAS hCanvas)
+{
+    if(ops_enabled())
+        return ((ops_canvas_t*) hCanvas)->clip_count;
+    else if(d2d_enabled())
+        return ((d2d_canvas_t*) hCanvas)->clip_count;
+    else
+        return ((gdix_canvas_t*) hCanvas)->clip_count;
+}
+
+
+#endif  /* WD_CANVAS_H */
@@ -0,0 +1,680 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "capture.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+volatile int wd_capture_enabled = 0;
+WD_THREAD_LOCAL int wd_capture_suspended = 0;
+
+/* Everything below is guarded by wd_capture_lock. */
+static CRITICAL_SECTION wd_capture_lock;
+static BOOL wd_capture_lock_initialized = FALSE;
+
+static FILE* wd_capture_file_handle = NULL;
+static LONGLONG wd_capture_last_ts;
+static LONGLONG wd_capture_freq;
+
+/* The record being built. It is written out as a whole by wd_capture_end(),
+ * so blobs it refers to can be written before it. */
+static BYTE* wd_capture_buf = NULL;
+static size_t wd_capture_buf_len = 0;
+static size_t wd_capture_buf_alloc = 0;
+static BYTE wd_capture_op;
+
+
+/*****************************
+ ***  Hash Table of Keys   ***
+ *****************************/
+
+/* Open-addressing table mapping object pointers to their handle IDs, and
+ * (with a dummy value) the set of blob hashes written so far. */
+typedef struct wd_capture_map_tag wd_capture_map_t;
+struct wd_capture_map_tag {
+    UINT64* keys;       /* 0 = empty slot, 1 = deleted slot */
+    UINT* values;
+    UINT alloc;         /* Always a power of 2. */
+    UINT used;          /* Including the deleted slots. */
+};
+
+#define WD_CAPTURE_KEY_EMPTY        0
+#define WD_CAPTURE_KEY_DELETED      1
+
+static wd_capture_map_t wd_capture_handles;
+static wd_capture_map_t wd_capture_blobs;
+static UINT wd_capture_next_id;
+
+
+static UINT
+wd_capture_map_slot(const wd_capture_map_t* map, UINT64 key)
+{
+    UINT64 h = key * 0x9e3779b97f4a7c15ULL;
+    return (UINT) (h >> 32) & (map->alloc - 1);
+}
+
+static void
+wd_capture_map_fini(wd_capture_map_t* map)
+{
+    free(map->keys);
+    free(map->values);
+    memset(map, 0, sizeof(wd_capture_map_t));
+}
+
+/* Returns pointer to the value of the key, or NULL if not present. */
+static UINT*
+wd_capture_map_find(wd_capture_map_t* map, UINT64 key)
+{
+    UINT i;
+
+    if(map->alloc == 0)
+        return NULL;
+
+    i = wd_capture_map_slot(map, key);
+    while(map->keys[i] != WD_CAPTURE_KEY_EMPTY) {
+        if(map->keys[i] == key)
+            return &map->values[i];
+        i = (i + 1) & (map->alloc - 1);
+    }
+    return NULL;
+}
+
+static int
+wd_capture_map_insert(wd_capture_map_t* map, UINT64 key, UINT value)
+{
+    UINT i;
+
+    /* Keep at least a quarter of the slots empty. */
+    if(4 * (map->used + 1) > 3 * map->alloc) {
+        wd_capture_map_t old = *map;
+        UINT alloc = (map->alloc > 0 ? map->alloc * 2 : 256);
+        UINT j;
+
+        map->keys = (UINT64*) calloc(alloc, sizeof(UINT64));
+        map->values = (UINT*) malloc(alloc * sizeof(UINT));
+        if(map->keys == NULL  ||  map->values == NULL) {
+            free(map->keys);
+            free(map->values);
+            *map = old;
+            return -1;
+        }
+        map->alloc = alloc;
+        map->used = 0;
+
+        for(j = 0; j < old.alloc; j++) {
+            if(old.keys[j] > WD_CAPTURE_KEY_DELETED)
+                wd_capture_map_insert(map, old.keys[j], old.values[j]);
+        }
+        free(old.keys);
+        free(old.values);
+    }
+
+    i = wd_capture_map_slot(map, key);
+    while(map->keys[i] > WD_CAPTURE_KEY_DELETED)
+        i = (i + 1) & (map->alloc - 1);
+    if(map->keys[i] == WD_CAPTURE_KEY_EMPTY)
+        map->used++;
+    map->keys[i] = key;
+    map->values[i] = value;
+    return 0;
+}
+
+static void
+wd_capture_map_remove(wd_capture_map_t* map, UINT64 key)
+{
+    UINT* value = wd_capture_map_find(map, key);
+
+    if(value != NULL)
+        map->keys[value - map->values] = WD_CAPTURE_KEY_DELETED;
+}
+
+
+/**************************
+ ***  Record Building   ***
+ **************************/
+
+UINT64
+wd_capture_hash(const BYTE* data, size_t size)
+{
+    UINT64 h = 0xcbf29ce484222325ULL;
+    size_t i;
+
+    for(i = 0; i < size; i++) {
+        h ^= data[i];
+        h *= 0x100000001b3ULL;
+    }
+
+    /* Keep the values used as the special keys in wd_capture_map_t free. */
+    if(h <= WD_CAPTURE_KEY_DELETED)
+        h += 2;
+    return h;
+}
+
+static void
+wd_capture_put(const void* data, size_t size)
+{
+    if(wd_capture_buf_len + size > wd_capture_buf_alloc) {
+        size_t alloc = WD_MAX(wd_capture_buf_alloc * 2, wd_capture_buf_len + size);
+        BYTE* buf;
+
+        buf = (BYTE*) realloc(wd_capture_buf, alloc);
+        if(buf == NULL) {
+            WD_TRACE("wd_capture_put: realloc() failed.");
+            return;
+        }
+        wd_capture_buf = buf;
+        wd_capture_buf_alloc = alloc;
+    }
+
+    memcpy(wd_capture_buf + wd_capture_buf_len, data, size);
+    wd_capture_buf_len += size;
+}
+
+/* Encodes the varint into the buffer, returns its length. */
+static int
+wd_capture_varint(BYTE buf[10], UINT64 v)
+{
+    int n = 0;
+
+    while(v >= 0x80) {
+        buf[n++] = (BYTE) (v | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = (BYTE) v;
+    return n;
+}
+
+static void
+wd_capture_u64(UINT64 v)
+{
+    BYTE buf[10];
+    wd_capture_put(buf, wd_capture_varint(buf, v));
+}
+
+static void
+wd_capture_le32(DWORD v)
+{
+    BYTE buf[4] = { (BYTE) v, (BYTE) (v >> 8), (BYTE) (v >> 16), (BYTE) (v >> 24) };
+    wd_capture_put(buf, 4);
+}
+
+static void
+wd_capture_le64(UINT64 v)
+{
+    wd_capture_le32((DWORD) v);
+    wd_capture_le32((DWORD) (v >> 32));
+}
+
+/* Writes a whole record (bypassing the record buffer) into the file. The
+ * payload is given in two parts to avoid copying of large blobs. */
+static void
+wd_capture_write_record(BYTE op, UINT64 dt, const BYTE* head, size_t head_size,
+                        const BYTE* data, size_t data_size)
+{
+    BYTE hdr[1 + 10 + 10];
+    int n = 0;
+
+    hdr[n++] = op;
+    n += wd_capture_varint(hdr + n, dt);
+    n += wd_capture_varint(hdr + n, head_size + data_size);
+    fwrite(hdr, 1, n, wd_capture_file_handle);
+    if(head_size > 0)
+        fwrite(head, 1, head_size, wd_capture_file_handle);
+    if(data_size > 0)
+        fwrite(data, 1, data_size, wd_capture_file_handle);
+}
+
+void
+wd_capture_begin(BYTE op)
+{
+    EnterCriticalSection(&wd_capture_lock);
+    wd_capture_op = op;
+    wd_capture_buf_len = 0;
+}
+
+void
+wd_capture_end(void)
+{
+    if(wd_capture_file_handle != NULL) {
+        LARGE_INTEGER now;
+        UINT64 dt;
+
+        QueryPerformanceCounter(&now);
+        dt = (UINT64) (now.QuadPart - wd_capture_last_ts) * 1000000 / wd_capture_freq;
+        /* Advance by the microseconds accounted for only, so the rounding
+         * errors do not accumulate. */
+        wd_capture_last_ts += (LONGLONG) (dt * wd_capture_freq / 1000000);
+
+        wd_capture_write_record(wd_capture_op, dt, wd_capture_buf, wd_capture_buf_len, NULL, 0);
+    }
+    LeaveCriticalSection(&wd_capture_lock);
+}
+
+void
+wd_capture_u(UINT v)
+{
+    wd_capture_u64(v);
+}
+
+void
+wd_capture_i(int v)
+{
+    wd_capture_u64(((UINT) v << 1) ^ (UINT) (v >> 31));
+}
+
+void
+wd_capture_f(float f)
+{
+    DWORD v;
+
+    memcpy(&v, &f, sizeof(DWORD));
+    wd_capture_le32(v);
+}
+
+void
+wd_capture_c(WD_COLOR c)
+{
+    wd_capture_le32(c);
+}
+
+void
+wd_capture_rect(const WD_RECT* rect)
+{
+    wd_capture_f(rect->x0);
+    wd_capture_f(rect->y0);
+    wd_capture_f(rect->x1);
+    wd_capture_f(rect->y1);
+}
+
+void
+wd_capture_rect_opt(const WD_RECT* rect)
+{
+    if(rect != NULL) {
+        wd_capture_u(1);
+        wd_capture_rect(rect);
+    } else {
+        wd_capture_u(0);
+    }
+}
+
+void
+wd_capture_matrix(const WD_MATRIX* matrix)
+{
+    wd_capture_f(matrix->m11);
+    wd_capture_f(matrix->m12);
+    wd_capture_f(matrix->m21);
+    wd_capture_f(matrix->m22);
+    wd_capture_f(matrix->dx);
+    wd_capture_f(matrix->dy);
+}
+
+void
+wd_capture_matrix_opt(const WD_MATRIX* matrix)
+{
+    if(matrix != NULL) {
+        wd_capture_u(1);
+        wd_capture_matrix(matrix);
+    } else {
+        wd_capture_u(0);
+    }
+}
+
+void
+wd_capture_str(const WCHAR* str, int len)
+{
+    int i;
+
+    if(len < 0)
+        len = (int) wcslen(str);
+
+    wd_capture_u(len);
+    for(i = 0; i < len; i++) {
+        BYTE buf[2] = { (BYTE) str[i], (BYTE) (str[i] >> 8) };
+        wd_capture_put(buf, 2);
+    }
+}
+
+void
+wd_capture_h(const void* handle)
+{
+    UINT* id;
+
+    if(handle == NULL) {
+        wd_capture_u(0);
+        return;
+    }
+
+    id = wd_capture_map_find(&wd_capture_handles, (UINT64) (UINT_PTR) handle);
+    /* Objects created before the capture has started are unknown. The replay
+     * sees them as NULL. */
+    wd_capture_u(id != NULL ? *id : 0);
+}
+
+void
+wd_capture_h_new(const void* handle)
+{
+    UINT id;
+
+    if(handle == NULL) {
+        wd_capture_u(0);
+        return;
+    }
+
+    id = wd_capture_next_id++;
+    if(wd_capture_map_insert(&wd_capture_handles, (UINT64) (UINT_PTR) handle, id) != 0) {
+        WD_TRACE("wd_capture_h_new: wd_capture_map_insert() failed.");
+        id = 0;
+    }
+    wd_capture_u(id);
+}
+
+void
+wd_capture_h_free(const void* handle)
+{
+    wd_capture_h(handle);
+    if(handle != NULL)
+        wd_capture_map_remove(&wd_capture_handles, (UINT64) (UINT_PTR) handle);
+}
+
+void
+wd_capture_blob(const BYTE* data, size_t size)
+{
+    UINT64 hash = wd_capture_hash(data, size);
+
+    if(wd_capture_file_handle != NULL  &&
+       wd_capture_map_find(&wd_capture_blobs, hash) == NULL)
+    {
+        BYTE hdr[8];
+        int i;
+
+        for(i = 0; i < 8; i++)
+            hdr[i] = (BYTE) (hash >> (8 * i));
+        wd_capture_write_record(WD_CAP_BLOB, 0, hdr, sizeof(hdr), data, size);
+
+        if(wd_capture_map_insert(&wd_capture_blobs, hash, 1) != 0)
+            WD_TRACE("wd_capture_blob: wd_capture_map_insert() failed.");
+    }
+
+    wd_capture_le64(hash);
+}
+
+
+/*********************************
+ ***  Image Source Capturing   ***
+ *********************************/
+
+static FILE*
+wd_capture_fopen(const WCHAR* path, const char* mode)
+{
+#ifdef _WIN32
+    WCHAR wmode[8];
+    int i;
+
+    for(i = 0; mode[i] != '\0'  &&  i < 7; i++)
+        wmode[i] = (WCHAR) mode[i];
+    wmode[i] = L'\0';
+    return _wfopen(path, wmode);
+#else
+    char buffer[1024];
+
+    if(wcstombs(buffer, path, sizeof(buffer)) >= sizeof(buffer))
+        return NULL;
+    return fopen(buffer, mode);
+#endif
+}
+
+/* Reads everything from the callback into a growing buffer. */
+static BYTE*
+wd_capture_read_all(int (*fn_read)(void*, BYTE*, size_t), void* ctx, size_t* p_size)
+{
+    BYTE* data = NULL;
+    size_t size = 0;
+    size_t alloc = 0;
+
+    while(1) {
+        int n;
+
+        if(size == alloc) {
+            BYTE* tmp;
+
+            alloc = (alloc > 0 ? alloc * 2 : 64 * 1024);
+            tmp = (BYTE*) realloc(data, alloc);
+            if(tmp == NULL) {
+                WD_TRACE("wd_capture_read_all: realloc() failed.");
+                free(data);
+                *p_size = 0;
+                return NULL;
+            }
+            data = tmp;
+        }
+
+        n = fn_read(ctx, data + size, alloc - size);
+        if(n <= 0)
+            break;
+        size += n;
+    }
+
+    *p_size = size;
+    return data;
+}
+
+static int
+wd_capture_fread(void* ctx, BYTE* buf, size_t size)
+{
+    return (int) fread(buf, 1, size, (FILE*) ctx);
+}
+
+static int
+wd_capture_stream_read(void* ctx, BYTE* buf, size_t size)
+{
+    ULONG n = 0;
+    HRESULT hr;
+
+    hr = IStream_Read((IStream*) ctx, buf, (ULONG) size, &n);
+    if(FAILED(hr))
+        return -1;
+    return (int) n;
+}
+
+BYTE*
+wd_capture_read_file(const WCHAR* path, size_t* p_size)
+{
+    FILE* f;
+    BYTE* data;
+
+    f = wd_capture_fopen(path, "rb");
+    if(f == NULL) {
+        WD_TRACE("wd_capture_read_file: Cannot open the image file.");
+        *p_size = 0;
+        return NULL;
+    }
+
+    data = wd_capture_read_all(wd_capture_fread, f, p_size);
+    fclose(f);
+    return data;
+}
+
+BYTE*
+wd_capture_read_stream(IStream* stream, size_t* p_size)
+{
+    LARGE_INTEGER zero;
+    LARGE_INTEGER pos;
+    ULARGE_INTEGER old_pos;
+    BYTE* data;
+    HRESULT hr;
+
+    zero.QuadPart = 0;
+    hr = IStream_Seek(stream, zero, STREAM_SEEK_CUR, &old_pos);
+    if(FAILED(hr)) {
+        WD_TRACE_HR("wd_capture_read_stream: IStream::Seek() failed.");
+        *p_size = 0;
+        return NULL;
+    }
+
+    data = wd_capture_read_all(wd_capture_stream_read, stream, p_size);
+
+    pos.QuadPart = (LONGLONG) old_pos.QuadPart;
+    IStream_Seek(stream, pos, STREAM_SEEK_SET, NULL);
+    return data;
+}
+
+void
+wd_capture_hbitmap(HBITMAP bmp, int alpha_mode)
+{
+    BITMAP bmp_desc;
+    BITMAPINFO bmp_info;
+    BYTE* bits = NULL;
+    UINT width = 0;
+    UINT height = 0;
+    UINT stride;
+    HDC dc;
+    int format;
+
+    if(GetObject(bmp, sizeof(BITMAP), &bmp_desc) != 0) {
+        width = (UINT) bmp_desc.bmWidth;
+        height = (UINT) bmp_desc.bmHeight;
+    }
+    stride = width * 4;
+
+    if(stride * height > 0)
+        bits = (BYTE*) calloc(stride, height);
+
+    if(bits != NULL) {
+        memset(&bmp_info, 0, sizeof(BITMAPINFO));
+        bmp_info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmp_info.bmiHeader.biWidth = (LONG) width;
+        bmp_info.bmiHeader.biHeight = (LONG) height;     /* bottom-up */
+        bmp_info.bmiHeader.biPlanes = 1;
+        bmp_info.bmiHeader.biBitCount = 32;
+        bmp_info.bmiHeader.biCompression = BI_RGB;
+
+        dc = GetDC(NULL);
+        GetDIBits(dc, bmp, 0, height, bits, &bmp_info, DIB_RGB_COLORS);
+        ReleaseDC(NULL, dc);
+
+        if(alpha_mode == WD_ALPHA_IGNORE) {
+            UINT i;
+
+            for(i = 3; i < stride * height; i += 4)
+                bits[i] = 0xff;
+        }
+    } else {
+        width = 0;
+        height = 0;
+        stride = 0;
+    }
+
+    if(alpha_mode == WD_ALPHA_USE_PREMULTIPLIED)
+        format = WD_PIXELFORMAT_B8G8R8A8_PREMULTIPLIED;
+    else
+        format = WD_PIXELFORMAT_B8G8R8A8;
+
+    wd_capture_u(width);
+    wd_capture_u(height);
+    wd_capture_u(stride);
+    wd_capture_u(format);
+    wd_capture_blob(bits, stride * height);
+    wd_capture_u(0);
+
+    free(bits);
+}
+
+
+/********************
+ ***  Public API  ***
+ ********************/
+
+BOOL
+wdStartCapture(const WCHAR* pszPath)
+{
+    LARGE_INTEGER freq;
+    FILE* f;
+    BYTE hdr[8 + 10 + 10];
+    int n;
+
+    if(!wd_capture_lock_initialized) {
+        InitializeCriticalSection(&wd_capture_lock);
+        wd_capture_lock_initialized = TRUE;
+    }
+
+    wdStopCapture();
+
+    f = wd_capture_fopen(pszPath, "wb");
+    if(f == NULL) {
+        WD_TRACE("wdStartCapture: Cannot open the file.");
+        return FALSE;
+    }
+
+    memcpy(hdr, WD_CAP_MAGIC, 8);
+    n = 8;
+    n += wd_capture_varint(hdr + n, WD_CAP_VERSION);
+    n += wd_capture_varint(hdr + n, (UINT64) wdBackend());
+    if(fwrite(hdr, 1, n, f) != (size_t) n) {
+        WD_TRACE("wdStartCapture: Writing the header failed.");
+        fclose(f);
+        return FALSE;
+    }
+
+    QueryPerformanceFrequency(&freq);
+
+    EnterCriticalSection(&wd_capture_lock);
+    wd_capture_file_handle = f;
+    wd_capture_freq = freq.QuadPart;
+    QueryPerformanceCounter(&freq);
+    wd_capture_last_ts = freq.QuadPart;
+    wd_capture_next_id = 1;
+    wd_capture_enabled = 1;
+    LeaveCriticalSection(&wd_capture_lock);
+
+    return TRUE;
+}
+
+BOOL
+wdStopCapture(void)
+{
+    BOOL ret = TRUE;
+
+    if(!wd_capture_lock_initialized)
+        return TRUE;
+
+    EnterCriticalSection(&wd_capture_lock);
+    wd_capture_enabled = 0;
+    if(wd_capture_file_handle != NULL) {
+        if(fclose(wd_capture_file_handle) != 0) {
+            WD_TRACE("wdStopCapture: Writing the file failed.");
+            ret = FALSE;
+        }
+        wd_capture_file_handle = NULL;
+    }
+    wd_capture_map_fini(&wd_capture_handles);
+    wd_capture_map_fini(&wd_capture_blobs);
+    free(wd_capture_buf);
+    wd_capture_buf = NULL;
+    wd_capture_buf_len = 0;
+    wd_capture_buf_alloc = 0;
+    LeaveCriticalSection(&wd_capture_lock);
+
+    return ret;
+}
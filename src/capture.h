@@ -0,0 +1,233 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef WD_CAPTURE_H
+#define WD_CAPTURE_H
+
+#include "misc.h"
+
+#include <objidl.h>
+
+
+/* Capture file format
+ * -------------------
+ *
+ * The file starts with the 8-byte magic WD_CAP_MAGIC, followed by a varint
+ * format version (WD_CAP_VERSION) and a varint back-end (WD_BACKEND_xxx) of
+ * the capturing process.
+ *
+ * Then a sequence of records follows. Each record is:
+ *   - opcode (one byte, WD_CAP_xxx),
+ *   - microseconds elapsed since the previous record (varint),
+ *   - length of the payload in bytes (varint),
+ *   - the payload.
+ *
+ * The payload is a sequence of these primitives, as described for each
+ * opcode below:
+ *   u      unsigned varint (LEB128)
+ *   i      signed varint (zig-zag encoded, then as 'u')
+ *   f      float (4 bytes, little endian IEEE 754)
+ *   c      WD_COLOR (4 bytes, little endian)
+ *   h      handle (u): 0 for NULL, otherwise an ID unique among the objects
+ *          alive at the time. IDs are never reused within a capture.
+ *   r      WD_RECT (4 x f)
+ *   r?     optional WD_RECT: u 0 for NULL; or 1 followed by r
+ *   m      WD_MATRIX (6 x f)
+ *   m?     optional WD_MATRIX: u 0 for NULL; or 1 followed by m
+ *   s      string: u count of UTF-16 code units, then 2 bytes per unit
+ *   x      content hash (8 bytes, little endian) of a blob
+ *
+ * Images are not stored in the records which create them. Instead, the
+ * pixels (or the encoded image file) are written once per content as a
+ * WD_CAP_BLOB record preceding the first record referring to it, and the
+ * records refer to it via its hash. Trace of an application which keeps
+ * re-creating the same images therefore stays small.
+ */
+
+#define WD_CAP_MAGIC            "WDCAPTUR"
+#define WD_CAP_VERSION          1
+
+#define WD_CAP_BLOB                     1   /* x, bytes till the end */
+#define WD_CAP_CREATECANVAS             2   /* h:canvas, u:flags, u:width, u:height */
+#define WD_CAP_DESTROYCANVAS            3   /* h:canvas */
+#define WD_CAP_BEGINPAINT               4   /* h:canvas */
+#define WD_CAP_ENDPAINT                 5   /* h:canvas */
+#define WD_CAP_RESIZECANVAS             6   /* h:canvas, u:width, u:height */
+#define WD_CAP_STARTGDI                 7   /* h:canvas, u:keep_contents */
+#define WD_CAP_ENDGDI                   8   /* h:canvas */
+#define WD_CAP_CLEAR                    9   /* h:canvas, c */
+#define WD_CAP_SETCLIP                 10   /* h:canvas, r?, h:path */
+#define WD_CAP_PUSHCLIPRECT            11   /* h:canvas, r? */
+#define WD_CAP_PUSHCLIPPATH            12   /* h:canvas, h:path, r? */
+#define WD_CAP_POPCLIP                 13   /* h:canvas */
+#define WD_CAP_ROTATEWORLD             14   /* h:canvas, f:cx, f:cy, f:angle */
+#define WD_CAP_TRANSLATEWORLD          15   /* h:canvas, f:dx, f:dy */
+#define WD_CAP_TRANSFORMWORLD          16   /* h:canvas, m */
+#define WD_CAP_RESETWORLD              17   /* h:canvas */
+#define WD_CAP_SETWORLDTRANSFORM       18   /* h:canvas, m */
+#define WD_CAP_SAVESTATE               19   /* h:canvas */
+#define WD_CAP_RESTORESTATE            20   /* h:canvas */
+#define WD_CAP_IMAGEFROMBUFFER         21   /* h:image, u:width, u:height, u:stride, u:format,
+                                             * x:pixels, u:palette_size, palette_size x c */
+#define WD_CAP_IMAGEFROMENCODED        22   /* h:image, x:file (empty if unreadable) */
+#define WD_CAP_DESTROYIMAGE            23   /* h:image */
+#define WD_CAP_CREATECACHEDIMAGE       24   /* h:cached_image, h:canvas, h:image */
+#define WD_CAP_DESTROYCACHEDIMAGE      25   /* h:cached_image */
+#define WD_CAP_CREATESOLIDBRUSH        26   /* h:brush, h:canvas, c */
+#define WD_CAP_CREATELINEARBRUSH       27   /* h:brush, h:canvas, f:x0, f:y0, f:x1, f:y1,
+                                             * u:count, count x (c, f:offset) */
+#define WD_CAP_CREATERADIALBRUSH       28   /* h:brush, h:canvas, f:cx, f:cy, f:r, f:fx, f:fy,
+                                             * u:count, count x (c, f:offset) */
+#define WD_CAP_DESTROYBRUSH            29   /* h:brush */
+#define WD_CAP_SETSOLIDBRUSHCOLOR      30   /* h:brush, c */
+#define WD_CAP_CREATESTROKESTYLE       31   /* h:style, u:dash_style, u:line_cap, u:line_join */
+#define WD_CAP_CREATESTROKESTYLECUSTOM 32   /* h:style, u:count, count x f, u:line_cap, u:line_join */
+#define WD_CAP_DESTROYSTROKESTYLE      33   /* h:style */
+#define WD_CAP_CREATEPATH              34   /* h:path, h:canvas */
+#define WD_CAP_DESTROYPATH             35   /* h:path */
+#define WD_CAP_OPENPATHSINK            36   /* h:sink, h:path */
+#define WD_CAP_CLOSEPATHSINK           37   /* h:sink */
+#define WD_CAP_BEGINFIGURE             38   /* h:sink, f:x, f:y */
+#define WD_CAP_ENDFIGURE               39   /* h:sink, u:close */
+#define WD_CAP_ADDLINE                 40   /* h:sink, f:x, f:y */
+#define WD_CAP_ADDARC                  41   /* h:sink, f:cx, f:cy, f:sweep */
+#define WD_CAP_ADDBEZIER               42   /* h:sink, 6 x f */
+#define WD_CAP_CREATEFONT              43   /* h:font, 5 x i (lfHeight ... lfWeight),
+                                             * 8 x u (lfItalic ... lfPitchAndFamily), s:face */
+#define WD_CAP_DESTROYFONT             44   /* h:font */
+#define WD_CAP_FONTMETRICS             45   /* h:font */
+#define WD_CAP_DRAWELLIPSEARC          46   /* h:canvas, h:brush, f:cx, f:cy, f:rx, f:ry,
+                                             * f:base, f:sweep, f:width, h:style */
+#define WD_CAP_DRAWELLIPSEPIE          47   /* (as WD_CAP_DRAWELLIPSEARC) */
+#define WD_CAP_DRAWELLIPSE             48   /* h:canvas, h:brush, f:cx, f:cy, f:rx, f:ry,
+                                             * f:width, h:style */
+#define WD_CAP_DRAWLINE                49   /* h:canvas, h:brush, f:x0, f:y0, f:x1, f:y1,
+                                             * f:width, h:style */
+#define WD_CAP_DRAWPATH                50   /* h:canvas, h:brush, h:path, f:width, h:style */
+#define WD_CAP_DRAWRECT                51   /* (as WD_CAP_DRAWLINE) */
+#define WD_CAP_FILLELLIPSE             52   /* h:canvas, h:brush, f:cx, f:cy, f:rx, f:ry */
+#define WD_CAP_FILLELLIPSEPIE          53   /* h:canvas, h:brush, f:cx, f:cy, f:rx, f:ry,
+                                             * f:base, f:sweep */
+#define WD_CAP_FILLPATH                54   /* h:canvas, h:brush, h:path */
+#define WD_CAP_FILLRECT                55   /* h:canvas, h:brush, f:x0, f:y0, f:x1, f:y1 */
+#define WD_CAP_BITBLTIMAGE             56   /* h:canvas, h:image, r?:dest, r?:source */
+#define WD_CAP_BITBLTCACHEDIMAGE       57   /* h:canvas, h:cached_image, f:x, f:y */
+#define WD_CAP_BITBLTHICON             58   /* h:canvas, r?:dest, r?:source (the icon itself
+                                             * is not captured) */
+#define WD_CAP_DRAWSTRING              59   /* h:canvas, h:font, r, s, h:brush, u:flags */
+#define WD_CAP_MEASURESTRING           60   /* h:canvas, h:font, r, s, u:flags */
+#define WD_CAP_ADDDIRTYRECT            61   /* h:canvas, 4 x i (left, top, right, bottom) */
+#define WD_CAP_SETDIRTYREGION          62   /* h:canvas, u:count, count x 4 x i */
+#define WD_CAP_REBINDCANVAS            63   /* h:canvas, 4 x i (left, top, right, bottom) */
+#define WD_CAP_DRAWRECTS               64   /* h:canvas, h:brush, u:count, count x r,
+                                             * f:width, h:style */
+#define WD_CAP_DRAWLINES               65   /* h:canvas, h:brush, u:count, count x 4 x f,
+                                             * f:width, h:style */
+#define WD_CAP_DRAWPOLYLINE            66   /* h:canvas, h:brush, u:count, count x 2 x f,
+                                             * f:width, h:style */
+#define WD_CAP_FILLRECTS               67   /* h:canvas, h:brush, u:count, count x r */
+#define WD_CAP_FILLELLIPSES            68   /* h:canvas, h:brush, u:count, count x 4 x f */
+#define WD_CAP_ADDLINES                69   /* h:sink, u:count, count x 2 x f */
+#define WD_CAP_ADDBEZIERS              70   /* h:sink, u:count, count x 6 x f */
+#define WD_CAP_GETPATHBOUNDS           71   /* h:path */
+#define WD_CAP_CLONEPATH               72   /* h:path, h:canvas, h:source */
+#define WD_CAP_TRANSFORMPATH           73   /* h:path, m */
+#define WD_CAP_FILLCONTAINSPOINT       74   /* h:path, f:x, f:y, u:rule */
+#define WD_CAP_STROKECONTAINSPOINT     75   /* h:path, f:x, f:y, f:width, h:style */
+#define WD_CAP_FLATTENPATH             76   /* h:path, f:tolerance, m? */
+#define WD_CAP_DRAWPOLYLINEDECIMATED   77   /* h:canvas, h:brush, u:count, count x 2 x f,
+                                             * f:width, u:mode */
+#define WD_CAP_REALIZEPATHFILL         78   /* h:fill, h:canvas, h:path, f:tolerance */
+#define WD_CAP_DESTROYREALIZEDFILL     79   /* h:fill */
+#define WD_CAP_FILLREALIZEDPATH        80   /* h:canvas, h:brush, h:fill */
+#define WD_CAP_CREATESTROKESTYLEEX     81   /* h:style, u:count, count x f, u:line_cap, u:line_join,
+                                             * f:miter_limit */
+#define WD_CAP_WIDENPATH               82   /* h:path, h:canvas, h:source, f:width, h:style,
+                                             * f:tolerance */
+#define WD_CAP_COUNT                   83
+
+
+/* Capturing is off by default. When off, each instrumented call costs a
+ * single load and branch.
+ *
+ * A captured public function may call other public functions internally.
+ * Such nested calls must not be recorded (the replay would repeat them)
+ * unless the outer function is not captured itself (like the convenience
+ * wrappers). Code doing that has to wrap the nested calls in
+ * WD_CAPTURE_SUSPEND() and WD_CAPTURE_RESUME(). */
+extern volatile int wd_capture_enabled;
+extern WD_THREAD_LOCAL int wd_capture_suspended;
+
+#define WD_CAPTURE_ACTIVE()     (wd_capture_enabled  &&  !wd_capture_suspended)
+#define WD_CAPTURE_SUSPEND()    (wd_capture_suspended++)
+#define WD_CAPTURE_RESUME()     (wd_capture_suspended--)
+
+
+/* A record is written by wd_capture_begin(), followed by the primitives of
+ * its payload, and finished by wd_capture_end(). Records of concurrent
+ * threads are serialized by a lock held in between. */
+void wd_capture_begin(BYTE op);
+void wd_capture_end(void);
+
+void wd_capture_u(UINT v);
+void wd_capture_i(int v);
+void wd_capture_f(float f);
+void wd_capture_c(WD_COLOR c);
+void wd_capture_rect(const WD_RECT* rect);
+void wd_capture_rect_opt(const WD_RECT* rect);
+void wd_capture_matrix(const WD_MATRIX* matrix);
+void wd_capture_matrix_opt(const WD_MATRIX* matrix);
+void wd_capture_str(const WCHAR* str, int len);
+
+/* Handle of an existing object. */
+void wd_capture_h(const void* handle);
+/* Handle of a newly created object: assigns it a new ID. */
+void wd_capture_h_new(const void* handle);
+/* Handle of an object being destroyed: forgets its ID. */
+void wd_capture_h_free(const void* handle);
+
+/* Writes the blob unless written already, and refers to it by its hash. */
+void wd_capture_blob(const BYTE* data, size_t size);
+
+/* Path sinks have no handle of their own; and with GDI+ the sink data are
+ * the path itself. An odd key keeps them apart from any real object. */
+#define WD_CAPTURE_SINK(pSink)  ((const void*) ((const BYTE*) (pSink)->pData + 1))
+
+
+/* Helpers reading the contents of image sources, to be passed to
+ * wd_capture_blob() and freed then. They do not need the record to be
+ * started, so the reading can happen outside of the lock (and the stream
+ * can be read before the decoder consumes it; its position is preserved).
+ * On failure, NULL with zero size is returned. */
+BYTE* wd_capture_read_file(const WCHAR* path, size_t* p_size);
+BYTE* wd_capture_read_stream(IStream* stream, size_t* p_size);
+
+/* Captures pixels of the bitmap as the arguments of WD_CAP_IMAGEFROMBUFFER
+ * following the image handle. */
+void wd_capture_hbitmap(HBITMAP bmp, int alpha_mode);
+
+/* Content hash (64-bit FNV-1a) used for the blobs. */
+UINT64 wd_capture_hash(const BYTE* data, size_t size);
+
+
+#endif  /* WD_CAPTURE_H */
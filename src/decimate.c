@@ -0,0 +1,410 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "decimate.h"
+
+#if defined __SSE2__  ||  defined _M_X64  ||  (defined _M_IX86_FP  &&  _M_IX86_FP >= 2)
+    #define WD_DECIMATE_SSE2    1
+    #include <emmintrin.h>
+#endif
+
+
+/* Columns per pixel. The min/max decimation is exact for aliased lines
+ * with whole pixel columns, but the anti-aliased ones of a dense series
+ * cover the column width with many segments, which three segments per
+ * pixel cannot imitate well. A quarter of a pixel gets close. */
+#define WD_DECIMATE_SUBCOLUMNS  4.0f
+
+/* Scaled device x is clamped into this range before it is turned into a
+ * column, so it fits into an int (and NaN ends up somewhere defined). */
+#define WD_DECIMATE_XMAX        1.0e9f
+
+
+void
+wd_decimate_init(wd_decimate_t* d)
+{
+    memset(d, 0, sizeof(wd_decimate_t));
+}
+
+void
+wd_decimate_fini(wd_decimate_t* d)
+{
+    free(d->points);
+    free(d->device);
+}
+
+static BOOL
+wd_decimate_reserve(wd_decimate_t* d, UINT n)
+{
+    if(d->count + n > d->capacity) {
+        UINT capacity = (d->capacity > 0 ? d->capacity * 2 : 1024);
+        WD_POINT* points;
+        WD_POINT* device;
+
+        if(d->error)
+            return FALSE;
+
+        while(capacity < d->count + n)
+            capacity *= 2;
+
+        points = (WD_POINT*) realloc(d->points, capacity * sizeof(WD_POINT));
+        if(points == NULL)
+            goto err;
+        d->points = points;
+        device = (WD_POINT*) realloc(d->device, capacity * sizeof(WD_POINT));
+        if(device == NULL)
+            goto err;
+        d->device = device;
+        d->capacity = capacity;
+    }
+
+    return TRUE;
+
+err:
+    WD_TRACE("wd_decimate_reserve: realloc() failed.");
+    d->error = TRUE;
+    return FALSE;
+}
+
+static inline int
+wd_decimate_column(float x)
+{
+    /* (The order of WD_MAX() and WD_MIN() matches what the SSE2 code does
+     * with NaN.) */
+    x *= WD_DECIMATE_SUBCOLUMNS;
+    x = WD_MAX(x, -WD_DECIMATE_XMAX);
+    x = WD_MIN(x, WD_DECIMATE_XMAX);
+    return (int) floorf(x);
+}
+
+/* The run of points in the current pixel column. */
+typedef struct wd_decimate_run_tag wd_decimate_run_t;
+struct wd_decimate_run_tag {
+    int column;
+    UINT first;
+    UINT last;
+    UINT top;
+    UINT bottom;
+    float y_top;
+    float y_bottom;
+};
+
+static void
+wd_decimate_emit(wd_decimate_t* d, const WD_POINT* points, const WD_MATRIX* m,
+                 const wd_decimate_run_t* run)
+{
+    UINT index[4];
+    UINT i, n = 0;
+
+    index[n++] = run->first;
+    index[n++] = WD_MIN(run->top, run->bottom);
+    index[n++] = WD_MAX(run->top, run->bottom);
+    index[n++] = run->last;
+
+    if(!wd_decimate_reserve(d, n))
+        return;
+
+    for(i = 0; i < n; i++) {
+        const WD_POINT* pt = &points[index[i]];
+        WD_POINT* dev = &d->device[d->count];
+
+        if(i > 0  &&  index[i] == index[i-1])
+            continue;
+
+        d->points[d->count] = *pt;
+        dev->x = pt->x * m->m11 + pt->y * m->m21 + m->dx;
+        dev->y = pt->x * m->m12 + pt->y * m->m22 + m->dy;
+        d->count++;
+    }
+}
+
+static inline void
+wd_decimate_start(wd_decimate_run_t* run, UINT i, int column, float y)
+{
+    run->column = column;
+    run->first = i;
+    run->last = i;
+    run->top = i;
+    run->bottom = i;
+    run->y_top = y;
+    run->y_bottom = y;
+}
+
+static inline void
+wd_decimate_step(wd_decimate_t* d, const WD_POINT* points, const WD_MATRIX* m,
+                 wd_decimate_run_t* run, UINT i, float x, float y)
+{
+    int column = wd_decimate_column(x);
+
+    if(column != run->column) {
+        wd_decimate_emit(d, points, m, run);
+        wd_decimate_start(run, i, column, y);
+        return;
+    }
+
+    run->last = i;
+    if(y < run->y_top) {
+        run->y_top = y;
+        run->top = i;
+    }
+    if(y > run->y_bottom) {
+        run->y_bottom = y;
+        run->bottom = i;
+    }
+}
+
+void
+wd_decimate_minmax(wd_decimate_t* d, const WD_POINT* points, UINT n,
+                   const WD_MATRIX* m)
+{
+    wd_decimate_run_t run;
+    UINT i;
+
+    if(n == 0)
+        return;
+
+    wd_decimate_start(&run, 0,
+            wd_decimate_column(points[0].x * m->m11 + points[0].y * m->m21 + m->dx),
+            points[0].x * m->m12 + points[0].y * m->m22 + m->dy);
+    i = 1;
+
+#ifdef WD_DECIMATE_SSE2
+    {
+        __m128 m11 = _mm_set1_ps(m->m11);
+        __m128 m12 = _mm_set1_ps(m->m12);
+        __m128 m21 = _mm_set1_ps(m->m21);
+        __m128 m22 = _mm_set1_ps(m->m22);
+        __m128 dx = _mm_set1_ps(m->dx);
+        __m128 dy = _mm_set1_ps(m->dy);
+        __m128 sub = _mm_set1_ps(WD_DECIMATE_SUBCOLUMNS);
+        __m128 xmin = _mm_set1_ps(-WD_DECIMATE_XMAX);
+        __m128 xmax = _mm_set1_ps(WD_DECIMATE_XMAX);
+
+        /* Four points at a time. Most of the blocks of a dense series lie in
+         * a single column, and they only need the minimum and the maximum
+         * of y; the others go through the scalar steps. */
+        for(; i + 4 <= n; i += 4) {
+            __m128 p01 = _mm_loadu_ps(&points[i].x);
+            __m128 p23 = _mm_loadu_ps(&points[i+2].x);
+            __m128 x = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2,0,2,0));
+            __m128 y = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3,1,3,1));
+            __m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m11), _mm_mul_ps(y, m21)), dx);
+            __m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m12), _mm_mul_ps(y, m22)), dy);
+            __m128 cx = _mm_min_ps(_mm_max_ps(_mm_mul_ps(tx, sub), xmin), xmax);
+            __m128i column = _mm_cvttps_epi32(cx);
+            float ys[4];
+            float xs[4];
+            int j;
+
+            /* Truncation to floor: Subtract one where it has rounded up. */
+            column = _mm_add_epi32(column,
+                        _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(column), cx)));
+
+            if(_mm_movemask_epi8(_mm_cmpeq_epi32(column, _mm_set1_epi32(run.column))) == 0xffff) {
+                __m128 lo = _mm_min_ps(ty, _mm_shuffle_ps(ty, ty, _MM_SHUFFLE(2,3,0,1)));
+                __m128 hi = _mm_max_ps(ty, _mm_shuffle_ps(ty, ty, _MM_SHUFFLE(2,3,0,1)));
+
+                lo = _mm_min_ps(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(1,0,3,2)));
+                hi = _mm_max_ps(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(1,0,3,2)));
+
+                run.last = i + 3;
+                if(_mm_cvtss_f32(lo) < run.y_top  ||  _mm_cvtss_f32(hi) > run.y_bottom) {
+                    /* Find which of them, the same way as the scalar code. */
+                    _mm_storeu_ps(ys, ty);
+                    for(j = 0; j < 4; j++) {
+                        if(ys[j] < run.y_top) {
+                            run.y_top = ys[j];
+                            run.top = i + j;
+                        }
+                        if(ys[j] > run.y_bottom) {
+                            run.y_bottom = ys[j];
+                            run.bottom = i + j;
+                        }
+                    }
+                }
+            } else {
+                _mm_storeu_ps(xs, tx);
+                _mm_storeu_ps(ys, ty);
+                for(j = 0; j < 4; j++)
+                    wd_decimate_step(d, points, m, &run, i + j, xs[j], ys[j]);
+            }
+        }
+    }
+#endif
+
+    for(; i < n; i++) {
+        wd_decimate_step(d, points, m, &run, i,
+                    points[i].x * m->m11 + points[i].y * m->m21 + m->dx,
+                    points[i].x * m->m12 + points[i].y * m->m22 + m->dy);
+    }
+
+    wd_decimate_emit(d, points, m, &run);
+}
+
+/* Index of the point in (a, b) farthest from the line through points a and
+ * b, if it is farther than the tolerance; or zero. */
+static UINT
+wd_decimate_farthest(const WD_POINT* dev, UINT a, UINT b, float tolerance)
+{
+    float ax = dev[a].x;
+    float ay = dev[a].y;
+    float vx = dev[b].x - ax;
+    float vy = dev[b].y - ay;
+    float len2 = vx * vx + vy * vy;
+    float limit;
+    float best = 0.0f;
+    UINT best_i = 0;
+    UINT i = a + 1;
+
+    if(len2 < 1e-12f) {
+        /* The ends (almost) coincide: Measure the distance from them. */
+        for(; i < b; i++) {
+            float dx = dev[i].x - ax;
+            float dy = dev[i].y - ay;
+            float d2 = dx * dx + dy * dy;
+
+            if(d2 > best) {
+                best = d2;
+                best_i = i;
+            }
+        }
+        return (best > tolerance * tolerance ? best_i : 0);
+    }
+
+    /* Compare |cross(v, p - a)| (the distance times |v|) instead of the
+     * distance itself. */
+    limit = tolerance * sqrtf(len2);
+
+#ifdef WD_DECIMATE_SSE2
+    if(b - i >= 8) {
+        __m128 vax = _mm_set1_ps(ax);
+        __m128 vay = _mm_set1_ps(ay);
+        __m128 vvx = _mm_set1_ps(vx);
+        __m128 vvy = _mm_set1_ps(vy);
+        __m128 sign = _mm_set1_ps(-0.0f);
+        __m128 vbest = _mm_setzero_ps();
+        __m128i vbest_i = _mm_setzero_si128();
+        __m128i vi = _mm_setr_epi32((int) i, (int) i + 1, (int) i + 2, (int) i + 3);
+        __m128i four = _mm_set1_epi32(4);
+        float bests[4];
+        int best_is[4];
+        int j;
+
+        for(; i + 4 <= b; i += 4) {
+            __m128 p01 = _mm_loadu_ps(&dev[i].x);
+            __m128 p23 = _mm_loadu_ps(&dev[i+2].x);
+            __m128 x = _mm_sub_ps(_mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2,0,2,0)), vax);
+            __m128 y = _mm_sub_ps(_mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3,1,3,1)), vay);
+            __m128 cross = _mm_andnot_ps(sign,
+                        _mm_sub_ps(_mm_mul_ps(vvx, y), _mm_mul_ps(vvy, x)));
+            __m128 gt = _mm_cmpgt_ps(cross, vbest);
+
+            vbest = _mm_max_ps(vbest, cross);
+            vbest_i = _mm_or_si128(_mm_and_si128(_mm_castps_si128(gt), vi),
+                        _mm_andnot_si128(_mm_castps_si128(gt), vbest_i));
+            vi = _mm_add_epi32(vi, four);
+        }
+
+        _mm_storeu_ps(bests, vbest);
+        _mm_storeu_si128((__m128i*) best_is, vbest_i);
+        for(j = 0; j < 4; j++) {
+            if(bests[j] > best  ||  (bests[j] == best  &&  bests[j] > 0.0f  &&
+                                     (UINT) best_is[j] < best_i)) {
+                best = bests[j];
+                best_i = (UINT) best_is[j];
+            }
+        }
+    }
+#endif
+
+    for(; i < b; i++) {
+        float cross = WD_ABS(vx * (dev[i].y - ay) - vy * (dev[i].x - ax));
+
+        if(cross > best) {
+            best = cross;
+            best_i = i;
+        }
+    }
+
+    return (best > limit ? best_i : 0);
+}
+
+void
+wd_decimate_rdp(wd_decimate_t* d, float tolerance)
+{
+    UINT* stack;
+    BYTE* keep;
+    UINT n_stack = 0;
+    UINT i, j;
+
+    if(d->error  ||  d->count < 3)
+        return;
+
+    /* Each split pushes two ranges and there are at most count - 2 splits. */
+    stack = (UINT*) malloc(2 * d->count * sizeof(UINT));
+    keep = (BYTE*) malloc(d->count);
+    if(stack == NULL  ||  keep == NULL) {
+        /* Not fatal: Just keep all the points. */
+        WD_TRACE("wd_decimate_rdp: malloc() failed.");
+        free(stack);
+        free(keep);
+        return;
+    }
+
+    memset(keep, 0, d->count);
+    keep[0] = 1;
+    keep[d->count - 1] = 1;
+    stack[n_stack++] = 0;
+    stack[n_stack++] = d->count - 1;
+
+    while(n_stack > 0) {
+        UINT b = stack[--n_stack];
+        UINT a = stack[--n_stack];
+        UINT k;
+
+        if(b - a < 2)
+            continue;
+
+        k = wd_decimate_farthest(d->device, a, b, tolerance);
+        if(k == 0)
+            continue;
+
+        keep[k] = 1;
+        stack[n_stack++] = a;
+        stack[n_stack++] = k;
+        stack[n_stack++] = k;
+        stack[n_stack++] = b;
+    }
+
+    for(i = 0, j = 0; i < d->count; i++) {
+        if(keep[i]) {
+            d->points[j] = d->points[i];
+            d->device[j] = d->device[i];
+            j++;
+        }
+    }
+    d->count = j;
+
+    free(stack);
+    free(keep);
+}
@@ -0,0 +1,57 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef WD_DECIMATE_H
+#define WD_DECIMATE_H
+
+#include "misc.h"
+
+
+/* Decimation of polylines for wdDrawPolylineDecimated(). The result is a
+ * subset of the original points (in the original order), kept both in the
+ * original coordinates and in device space. */
+typedef struct wd_decimate_tag wd_decimate_t;
+struct wd_decimate_tag {
+    WD_POINT* points;
+    WD_POINT* device;
+    UINT count;
+    UINT capacity;
+    BOOL error;         /* Set when an allocation has failed. */
+};
+
+void wd_decimate_init(wd_decimate_t* d);
+void wd_decimate_fini(wd_decimate_t* d);
+
+/* Keeps the first, the last, the topmost and the bottommost point of each
+ * run of consecutive points falling into the same column (a quarter of a
+ * pixel wide, after the transformation by the matrix). */
+void wd_decimate_minmax(wd_decimate_t* d, const WD_POINT* points, UINT n,
+                        const WD_MATRIX* m);
+
+/* Ramer-Douglas-Peucker simplification of the result in place: drops the
+ * points which are within the tolerance (in pixels) of the line through
+ * the kept ones around them. */
+void wd_decimate_rdp(wd_decimate_t* d, float tolerance);
+
+
+#endif  /* WD_DECIMATE_H */
@@ -0,0 +1,124 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "dirty.h"
+
+
+static inline UINT64
+wd_dirty_area(const RECT* r)
+{
+    return (UINT64) (r->right - r->left) * (UINT64) (r->bottom - r->top);
+}
+
+static inline void
+wd_dirty_union(RECT* res, const RECT* a, const RECT* b)
+{
+    res->left = WD_MIN(a->left, b->left);
+    res->top = WD_MIN(a->top, b->top);
+    res->right = WD_MAX(a->right, b->right);
+    res->bottom = WD_MAX(a->bottom, b->bottom);
+}
+
+void
+wd_dirty_add(wd_dirty_t* dirty, const RECT* rect)
+{
+    RECT r = *rect;
+    BOOL merged;
+    UINT i;
+
+    dirty->partial = TRUE;
+    if(r.left >= r.right  ||  r.top >= r.bottom)
+        return;
+
+    do {
+        merged = FALSE;
+
+        /* Merge with any rectangle which overlaps (or touches) the new one
+         * so much the union is not bigger than both apart. */
+        for(i = 0; i < dirty->count; i++) {
+            RECT u;
+
+            wd_dirty_union(&u, &r, &dirty->rects[i]);
+            if(wd_dirty_area(&u) <= wd_dirty_area(&r) + wd_dirty_area(&dirty->rects[i])) {
+                r = u;
+                dirty->rects[i] = dirty->rects[--dirty->count];
+                merged = TRUE;
+                break;
+            }
+        }
+
+        /* If there is no room, merge with the one adding the least area. */
+        if(!merged  &&  dirty->count >= WD_DIRTY_MAX) {
+            UINT64 best_waste = 0;
+            UINT best = 0;
+
+            for(i = 0; i < dirty->count; i++) {
+                RECT u;
+                UINT64 waste;
+
+                wd_dirty_union(&u, &r, &dirty->rects[i]);
+                waste = wd_dirty_area(&u) - wd_dirty_area(&r) - wd_dirty_area(&dirty->rects[i]);
+                if(i == 0  ||  waste < best_waste) {
+                    best_waste = waste;
+                    best = i;
+                }
+            }
+
+            wd_dirty_union(&r, &r, &dirty->rects[best]);
+            dirty->rects[best] = dirty->rects[--dirty->count];
+            merged = TRUE;
+        }
+    } while(merged);
+
+    dirty->rects[dirty->count++] = r;
+}
+
+void
+wd_dirty_clip_dc(const wd_dirty_t* dirty, HDC dc, int dx, int dy)
+{
+    HRGN rgn;
+    UINT i;
+
+    rgn = CreateRectRgn(0, 0, 0, 0);
+    if(rgn == NULL) {
+        WD_TRACE_ERR("wd_dirty_clip_dc: CreateRectRgn() failed.");
+        return;
+    }
+
+    for(i = 0; i < dirty->count; i++) {
+        const RECT* r = &dirty->rects[i];
+        HRGN tmp;
+
+        tmp = CreateRectRgn(r->left + dx, r->top + dy, r->right + dx, r->bottom + dy);
+        if(tmp == NULL) {
+            WD_TRACE_ERR("wd_dirty_clip_dc: CreateRectRgn() failed.");
+            DeleteObject(rgn);
+            return;
+        }
+        CombineRgn(rgn, rgn, tmp, RGN_OR);
+        DeleteObject(tmp);
+    }
+
+    ExtSelectClipRgn(dc, rgn, RGN_AND);
+    DeleteObject(rgn);
+}
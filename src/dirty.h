@@ -0,0 +1,60 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef WD_DIRTY_H
+#define WD_DIRTY_H
+
+#include "misc.h"
+
+
+/* Dirty rectangles of a canvas (see wdAddDirtyRect()). Overlapping ones are
+ * merged as they are added, and when there are too many, the two which
+ * merge with the least waste are, so the presentation does a few
+ * reasonably sized blits.
+ *
+ * The rectangles are in the device coordinates of the canvas (already
+ * mirrored for WD_CANVAS_LAYOUTRTL). */
+#define WD_DIRTY_MAX    8
+
+typedef struct wd_dirty_tag wd_dirty_t;
+struct wd_dirty_tag {
+    BOOL partial;       /* FALSE: Present everything (the default). */
+    UINT count;
+    RECT rects[WD_DIRTY_MAX];
+};
+
+static inline void
+wd_dirty_reset(wd_dirty_t* dirty)
+{
+    dirty->partial = FALSE;
+    dirty->count = 0;
+}
+
+void wd_dirty_add(wd_dirty_t* dirty, const RECT* rect);
+
+/* Intersects the clip region of the DC with the dirty rectangles, offset by
+ * (dx, dy). The caller is supposed to save the DC state beforehand. */
+void wd_dirty_clip_dc(const wd_dirty_t* dirty, HDC dc, int dx, int dy);
+
+
+#endif  /* WD_DIRTY_H */
@@ -0,0 +1,754 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "dlist.h"
+#include "canvas.h"
+#include "capture.h"
+#include "lock.h"
+
+
+WD_THREAD_LOCAL wd_dlist_t* wd_dlist_current = NULL;
+
+/* Handles retained by all the lists, with the number of lists referring to
+ * each. Protected by the lock (WD_LOCKSITE_DISPLAYLIST). */
+static wd_dlist_table_t wd_dlist_retained = { NULL, 0, 0 };
+
+
+static inline UINT
+wd_dlist_hash(const void* handle, UINT capacity)
+{
+    /* The lowest bits are zero due to the alignment. */
+    UINT h = (UINT) ((UINT_PTR) handle >> 3) * 2654435769U;
+
+    return (h ^ (h >> 16)) & (capacity - 1);
+}
+
+/* Returns the slot of the handle, or the empty slot where it belongs. The
+ * table must not be full. */
+static wd_dlist_res_t*
+wd_dlist_table_find(const wd_dlist_table_t* table, const void* handle)
+{
+    UINT i = wd_dlist_hash(handle, table->capacity);
+
+    while(table->slots[i].handle != NULL  &&  table->slots[i].handle != handle)
+        i = (i + 1) & (table->capacity - 1);
+    return &table->slots[i];
+}
+
+/* Returns the (possibly new, zeroed) slot of the handle, or NULL if the
+ * table cannot grow. */
+static wd_dlist_res_t*
+wd_dlist_table_insert(wd_dlist_table_t* table, const void* handle)
+{
+    wd_dlist_res_t* r;
+
+    /* Keep the load factor at most 1/2. */
+    if(2 * (table->count + 1) > table->capacity) {
+        wd_dlist_table_t t;
+        UINT i;
+
+        t.capacity = (table->capacity > 0) ? table->capacity * 2 : 16;
+        t.count = table->count;
+        t.slots = (wd_dlist_res_t*) calloc(t.capacity, sizeof(wd_dlist_res_t));
+        if(t.slots == NULL) {
+            WD_TRACE("wd_dlist_table_insert: calloc() failed.");
+            return NULL;
+        }
+
+        for(i = 0; i < table->capacity; i++) {
+            if(table->slots[i].handle != NULL)
+                *wd_dlist_table_find(&t, table->slots[i].handle) = table->slots[i];
+        }
+
+        free(table->slots);
+        *table = t;
+    }
+
+    r = wd_dlist_table_find(table, handle);
+    if(r->handle == NULL) {
+        r->handle = handle;
+        r->refs = 0;
+        r->destroy = NULL;
+        table->count++;
+    }
+    return r;
+}
+
+static void
+wd_dlist_table_remove(wd_dlist_table_t* table, wd_dlist_res_t* r)
+{
+    UINT mask = table->capacity - 1;
+    UINT i = (UINT) (r - table->slots);
+    UINT j = i;
+
+    /* Move back any following slot whose probing passes the hole. */
+    while(1) {
+        UINT k;
+
+        j = (j + 1) & mask;
+        if(table->slots[j].handle == NULL)
+            break;
+        k = wd_dlist_hash(table->slots[j].handle, table->capacity);
+        if((j > i) ? (k <= i  ||  k > j) : (k <= i  &&  k > j)) {
+            table->slots[i] = table->slots[j];
+            i = j;
+        }
+    }
+    table->slots[i].handle = NULL;
+
+    table->count--;
+    if(table->count == 0) {
+        free(table->slots);
+        table->slots = NULL;
+        table->capacity = 0;
+    }
+}
+
+void
+wd_dlist_retain(const void* handle, void (*destroy)(void*))
+{
+    wd_dlist_t* dl = wd_dlist_current;
+    wd_dlist_res_t* r;
+    wd_dlist_res_t* g;
+
+    if(dl->error)
+        return;
+
+    if(handle == NULL) {
+        /* Only wd_dlist_h_owned() passes NULL here: the copy has failed. */
+        WD_TRACE("wd_dlist_retain: Cannot copy the resource.");
+        dl->error = TRUE;
+        return;
+    }
+
+    r = wd_dlist_table_insert(&dl->resources, handle);
+    if(r == NULL) {
+        dl->error = TRUE;
+        return;
+    }
+    if(r->refs > 0)
+        return;
+
+    wd_lock(WD_LOCKSITE_DISPLAYLIST);
+    g = wd_dlist_table_insert(&wd_dlist_retained, handle);
+    if(g != NULL) {
+        g->refs++;
+        if(destroy != NULL)
+            g->destroy = destroy;
+    }
+    wd_unlock();
+
+    if(g == NULL) {
+        dl->error = TRUE;
+        return;
+    }
+    r->refs = 1;
+}
+
+/* Releases all the handles of the list, destroying those it has been the
+ * last user of. */
+static void
+wd_dlist_release_all(wd_dlist_t* dl)
+{
+    wd_dlist_res_t* r;
+    UINT i;
+
+    if(dl->resources.count == 0)
+        return;
+
+    wd_lock(WD_LOCKSITE_DISPLAYLIST);
+    for(i = 0; i < dl->resources.capacity; i++) {
+        r = &dl->resources.slots[i];
+        if(r->handle != NULL  &&  r->refs > 0) {
+            wd_dlist_res_t* g = wd_dlist_table_find(&wd_dlist_retained, r->handle);
+
+            g->refs--;
+            if(g->refs == 0) {
+                r->destroy = g->destroy;
+                wd_dlist_table_remove(&wd_dlist_retained, g);
+            }
+        }
+    }
+    wd_unlock();
+
+    /* The destructors may need the lock for themselves. */
+    for(i = 0; i < dl->resources.capacity; i++) {
+        r = &dl->resources.slots[i];
+        if(r->handle != NULL  &&  r->destroy != NULL)
+            r->destroy((void*) r->handle);
+    }
+
+    free(dl->resources.slots);
+    dl->resources.slots = NULL;
+    dl->resources.count = 0;
+    dl->resources.capacity = 0;
+}
+
+BOOL
+wd_dlist_defer_destroy(const void* handle, void (*destroy)(void*))
+{
+    BOOL deferred = FALSE;
+
+    wd_lock(WD_LOCKSITE_DISPLAYLIST);
+    if(wd_dlist_retained.count > 0  &&  handle != NULL) {
+        wd_dlist_res_t* g = wd_dlist_table_find(&wd_dlist_retained, handle);
+
+        if(g->handle != NULL) {
+            g->destroy = destroy;
+            deferred = TRUE;
+        }
+    }
+    wd_unlock();
+
+    return deferred;
+}
+
+
+
+BYTE*
+wd_dlist_grow(wd_dlist_t* dl, size_t n)
+{
+    size_t capacity;
+    BYTE* buffer;
+    BYTE* p;
+
+    if(dl->error)
+        return NULL;
+
+    capacity = (dl->capacity > 0) ? dl->capacity * 2 : 256;
+    while(capacity < dl->size + n)
+        capacity *= 2;
+
+    buffer = (BYTE*) realloc(dl->buffer, capacity);
+    if(buffer == NULL) {
+        WD_TRACE("wd_dlist_grow: realloc() failed.");
+        dl->error = TRUE;
+        return NULL;
+    }
+
+    dl->buffer = buffer;
+    dl->capacity = capacity;
+
+    p = dl->buffer + dl->size;
+    dl->size += n;
+    return p;
+}
+
+void
+wd_dlist_rect(const WD_RECT* rect)
+{
+    BYTE* p = wd_dlist_reserve(sizeof(WD_RECT));
+    if(p != NULL)
+        memcpy(p, rect, sizeof(WD_RECT));
+}
+
+void
+wd_dlist_rect_opt(const WD_RECT* rect)
+{
+    BYTE* p = wd_dlist_reserve((rect != NULL) ? 1 + sizeof(WD_RECT) : 1);
+    if(p != NULL) {
+        if(rect != NULL) {
+            p[0] = 1;
+            memcpy(p + 1, rect, sizeof(WD_RECT));
+        } else {
+            p[0] = 0;
+        }
+    }
+}
+
+void
+wd_dlist_matrix(const WD_MATRIX* matrix)
+{
+    BYTE* p = wd_dlist_reserve(sizeof(WD_MATRIX));
+    if(p != NULL)
+        memcpy(p, matrix, sizeof(WD_MATRIX));
+}
+
+void
+wd_dlist_str(const WCHAR* str, int len)
+{
+    wd_dlist_t* dl = wd_dlist_current;
+    size_t pad;
+    BYTE* p;
+
+    if(len < 0)
+        len = (int) wcslen(str);
+
+    wd_dlist_u((UINT) len);
+    pad = (dl->size & (sizeof(WCHAR) - 1));
+    p = wd_dlist_reserve(pad + len * sizeof(WCHAR));
+    if(p != NULL)
+        memcpy(p + pad, str, len * sizeof(WCHAR));
+}
+
+void
+wd_dlist_array(const void* items, UINT count, size_t item_size)
+{
+    wd_dlist_t* dl = wd_dlist_current;
+    size_t pad;
+    BYTE* p;
+
+    wd_dlist_u(count);
+    pad = (sizeof(float) - (dl->size & (sizeof(float) - 1))) & (sizeof(float) - 1);
+    p = wd_dlist_reserve(pad + count * item_size);
+    if(p != NULL)
+        memcpy(p + pad, items, count * item_size);
+}
+
+
+/* Readers of the command arguments. */
+
+static inline const void*
+wd_dlist_read_h(const BYTE** pp)
+{
+    const void* h;
+    memcpy((void*) &h, *pp, sizeof(const void*));
+    *pp += sizeof(const void*);
+    return h;
+}
+
+static inline float
+wd_dlist_read_f(const BYTE** pp)
+{
+    float f;
+    memcpy(&f, *pp, sizeof(float));
+    *pp += sizeof(float);
+    return f;
+}
+
+static inline UINT
+wd_dlist_read_u(const BYTE** pp)
+{
+    UINT u;
+    memcpy(&u, *pp, sizeof(UINT));
+    *pp += sizeof(UINT);
+    return u;
+}
+
+/* Returns NULL or the rect copied into the storage. */
+static inline const WD_RECT*
+wd_dlist_read_rect_opt(const BYTE** pp, WD_RECT* storage)
+{
+    if(*(*pp)++ == 0)
+        return NULL;
+
+    memcpy(storage, *pp, sizeof(WD_RECT));
+    *pp += sizeof(WD_RECT);
+    return storage;
+}
+
+static inline void
+wd_dlist_read_matrix(const BYTE** pp, WD_MATRIX* matrix)
+{
+    memcpy(matrix, *pp, sizeof(WD_MATRIX));
+    *pp += sizeof(WD_MATRIX);
+}
+
+static const WCHAR*
+wd_dlist_read_str(const BYTE** pp, const BYTE* buffer, int* p_len)
+{
+    const WCHAR* str;
+    UINT len;
+
+    len = wd_dlist_read_u(pp);
+    *pp += ((*pp - buffer) & (sizeof(WCHAR) - 1));
+    str = (const WCHAR*) *pp;
+    *pp += len * sizeof(WCHAR);
+    *p_len = (int) len;
+    return str;
+}
+
+static const void*
+wd_dlist_read_array(const BYTE** pp, const BYTE* buffer, size_t item_size, UINT* p_count)
+{
+    const void* items;
+    UINT count;
+
+    count = wd_dlist_read_u(pp);
+    *pp += (sizeof(float) - ((*pp - buffer) & (sizeof(float) - 1))) & (sizeof(float) - 1);
+    items = (const void*) *pp;
+    *pp += count * item_size;
+    *p_count = count;
+    return items;
+}
+
+
+BOOL
+wdBeginRecording(WD_HCANVAS hCanvas)
+{
+    wd_dlist_t* dl;
+
+    if(wd_dlist_current != NULL) {
+        WD_TRACE("wdBeginRecording: Already recording on this thread.");
+        return FALSE;
+    }
+
+    dl = (wd_dlist_t*) malloc(sizeof(wd_dlist_t));
+    if(dl == NULL) {
+        WD_TRACE("wdBeginRecording: malloc() failed.");
+        return FALSE;
+    }
+
+    dl->canvas = hCanvas;
+    dl->buffer = NULL;
+    dl->size = 0;
+    dl->capacity = 0;
+    dl->resources.slots = NULL;
+    dl->resources.count = 0;
+    dl->resources.capacity = 0;
+    dl->error = FALSE;
+    dl->absolute = FALSE;
+
+    wd_dlist_current = dl;
+    return TRUE;
+}
+
+WD_HDISPLAYLIST
+wdEndRecording(WD_HCANVAS hCanvas)
+{
+    wd_dlist_t* dl = wd_dlist_current;
+
+    if(dl == NULL  ||  dl->canvas != hCanvas) {
+        WD_TRACE("wdEndRecording: Not recording the canvas.");
+        return NULL;
+    }
+
+    wd_dlist_current = NULL;
+    dl->canvas = NULL;
+
+    if(dl->error) {
+        WD_TRACE("wdEndRecording: Recording has failed.");
+        wdDestroyDisplayList((WD_HDISPLAYLIST) dl);
+        return NULL;
+    }
+
+    /* The list is typically replayed many times and kept for long: do not
+     * waste the slack of the growing. */
+    if(dl->size < dl->capacity) {
+        BYTE* buffer;
+
+        if(dl->size > 0) {
+            buffer = (BYTE*) realloc(dl->buffer, dl->size);
+            if(buffer != NULL) {
+                dl->buffer = buffer;
+                dl->capacity = dl->size;
+            }
+        } else {
+            free(dl->buffer);
+            dl->buffer = NULL;
+            dl->capacity = 0;
+        }
+    }
+
+    return (WD_HDISPLAYLIST) dl;
+}
+
+void
+wdDestroyDisplayList(WD_HDISPLAYLIST hList)
+{
+    wd_dlist_t* dl = (wd_dlist_t*) hList;
+
+    if(dl == NULL)
+        return;
+
+    wd_dlist_release_all(dl);
+    free(dl->buffer);
+    free(dl);
+}
+
+void
+wdReplay(WD_HCANVAS hCanvas, WD_HDISPLAYLIST hList, const WD_MATRIX* pMatrix)
+{
+    wd_dlist_t* dl = (wd_dlist_t*) hList;
+    const BYTE* p = dl->buffer;
+    const BYTE* end = dl->buffer + dl->size;
+    WD_MATRIX base;
+    WD_MATRIX m;
+    WD_RECT r0, r1;
+    const WD_RECT* pr0;
+    const WD_RECT* pr1;
+    const void* h0;
+    const void* h1;
+    const WCHAR* str;
+    const void* items;
+    UINT count;
+    int len;
+    float f[7];
+    int i;
+    BYTE op;
+    UINT depth = 0;
+    UINT clip_base;
+
+    WD_EVENT_BEGIN("wdReplay");
+
+    wdSaveState(hCanvas);
+    if(pMatrix != NULL)
+        wdTransformWorld(hCanvas, pMatrix);
+
+    /* The clips of the caller stay below anything the list sets or pops. */
+    clip_base = wd_canvas_clip_depth(hCanvas);
+
+    /* wdResetWorld() and wdSetWorldTransform() in the list are relative to
+     * the transformation the list is replayed with. */
+    if(dl->absolute)
+        wdGetWorldTransform(hCanvas, &base);
+
+    while(p < end) {
+        op = *p++;
+        switch(op) {
+            case WD_DL_CLEAR:
+                wdClear(hCanvas, (WD_COLOR) wd_dlist_read_u(&p));
+                break;
+
+            case WD_DL_SETCLIP:
+                /* Not wdSetClip(), which would discard the caller's clips
+                 * too. */
+                pr0 = wd_dlist_read_rect_opt(&p, &r0);
+                h0 = wd_dlist_read_h(&p);
+                for(i = (int) (wd_canvas_clip_depth(hCanvas) - clip_base); i > 0; i--)
+                    wdPopClip(hCanvas);
+                if(h0 != NULL)
+                    wdPushClipPath(hCanvas, (WD_HPATH) h0, pr0);
+                else if(pr0 != NULL)
+                    wdPushClipRect(hCanvas, pr0);
+                break;
+
+            case WD_DL_PUSHCLIPRECT:
+                memcpy(&r0, p, sizeof(WD_RECT));
+                p += sizeof(WD_RECT);
+                wdPushClipRect(hCanvas, &r0);
+                break;
+
+            case WD_DL_PUSHCLIPPATH:
+                h0 = wd_dlist_read_h(&p);
+                pr0 = wd_dlist_read_rect_opt(&p, &r0);
+                wdPushClipPath(hCanvas, (WD_HPATH) h0, pr0);
+                break;
+
+            case WD_DL_POPCLIP:
+                if(wd_canvas_clip_depth(hCanvas) > clip_base)
+                    wdPopClip(hCanvas);
+                break;
+
+            case WD_DL_ROTATEWORLD:
+                f[0] = wd_dlist_read_f(&p);
+                f[1] = wd_dlist_read_f(&p);
+                f[2] = wd_dlist_read_f(&p);
+                wdRotateWorld(hCanvas, f[0], f[1], f[2]);
+                break;
+
+            case WD_DL_TRANSLATEWORLD:
+                f[0] = wd_dlist_read_f(&p);
+                f[1] = wd_dlist_read_f(&p);
+                wdTranslateWorld(hCanvas, f[0], f[1]);
+                break;
+
+            case WD_DL_TRANSFORMWORLD:
+                wd_dlist_read_matrix(&p, &m);
+                wdTransformWorld(hCanvas, &m);
+                break;
+
+            case WD_DL_RESETWORLD:
+                wdSetWorldTransform(hCanvas, &base);
+                break;
+
+            case WD_DL_SETWORLDTRANSFORM:
+                wd_dlist_read_matrix(&p, &m);
+                wd_matrix_mult(&m, &m, &base);
+                wdSetWorldTransform(hCanvas, &m);
+                break;
+
+            case WD_DL_SAVESTATE:
+                wdSaveState(hCanvas);
+                depth++;
+                break;
+
+            case WD_DL_RESTORESTATE:
+                /* Never restore the state saved above. */
+                if(depth > 0) {
+                    wdRestoreState(hCanvas);
+                    depth--;
+                }
+                break;
+
+            case WD_DL_SETSOLIDBRUSHCOLOR:
+                h0 = wd_dlist_read_h(&p);
+                wdSetSolidBrushColor((WD_HBRUSH) h0, (WD_COLOR) wd_dlist_read_u(&p));
+                break;
+
+            case WD_DL_DRAWELLIPSEARC:
+            case WD_DL_DRAWELLIPSEPIE:
+                h0 = wd_dlist_read_h(&p);
+                for(i = 0; i < 7; i++)
+                    f[i] = wd_dlist_read_f(&p);
+                h1 = wd_dlist_read_h(&p);
+                if(op == WD_DL_DRAWELLIPSEARC)
+                    wdDrawEllipseArcStyled(hCanvas, (WD_HBRUSH) h0, f[0], f[1], f[2], f[3],
+                                f[4], f[5], f[6], (WD_HSTROKESTYLE) h1);
+                else
+                    wdDrawEllipsePieStyled(hCanvas, (WD_HBRUSH) h0, f[0], f[1], f[2], f[3],
+                                f[4], f[5], f[6], (WD_HSTROKESTYLE) h1);
+                break;
+
+            case WD_DL_DRAWELLIPSE:
+                h0 = wd_dlist_read_h(&p);
+                for(i = 0; i < 5; i++)
+                    f[i] = wd_dlist_read_f(&p);
+                h1 = wd_dlist_read_h(&p);
+                wdDrawEllipseStyled(hCanvas, (WD_HBRUSH) h0, f[0], f[1], f[2], f[3],
+                            f[4], (WD_HSTROKESTYLE) h1);
+                break;
+
+            case WD_DL_DRAWLINE:
+            case WD_DL_DRAWRECT:
+                h0 = wd_dlist_read_h(&p);
+                for(i = 0; i < 5; i++)
+                    f[i] = wd_dlist_read_f(&p);
+                h1 = wd_dlist_read_h(&p);
+                if(op == WD_DL_DRAWLINE)
+                    wdDrawLineStyled(hCanvas, (WD_HBRUSH) h0, f[0], f[1], f[2], f[3],
+                                f[4], (WD_HSTROKESTYLE) h1);
+                else
+                    wdDrawRectStyled(hCanvas, (WD_HBRUSH) h0, f[0], f[1], f[2], f[3],
+                                f[4], (WD_HSTROKESTYLE) h1);
+                break;
+
+            case WD_DL_DRAWPATH:
+                h0 = wd_dlist_read_h(&p);
+                h1 = wd_dlist_read_h(&p);
+                f[0] = wd_dlist_read_f(&p);
+                wdDrawPathStyled(hCanvas, (WD_HBRUSH) h0, (WD_HPATH) h1, f[0],
+                            (WD_HSTROKESTYLE) wd_dlist_read_h(&p));
+                break;
+
+            case WD_DL_FILLELLIPSE:
+                h0 = wd_dlist_read_h(&p);
+                for(i = 0; i < 4; i++)
+                    f[i] = wd_dlist_read_f(&p);
+                wdFillEllipse(hCanvas, (WD_HBRUSH) h0, f[0], f[1], f[2], f[3]);
+                break;
+
+            case WD_DL_FILLELLIPSEPIE:
+                h0 = wd_dlist_read_h(&p);
+                for(i = 0; i < 6; i++)
+                    f[i] = wd_dlist_read_f(&p);
+                wdFillEllipsePie(hCanvas, (WD_HBRUSH) h0, f[0], f[1], f[2], f[3], f[4], f[5]);
+                break;
+
+            case WD_DL_FILLPATH:
+                h0 = wd_dlist_read_h(&p);
+                h1 = wd_dlist_read_h(&p);
+                wdFillPath(hCanvas, (WD_HBRUSH) h0, (WD_HPATH) h1);
+                break;
+
+            case WD_DL_FILLREALIZEDPATH:
+                h0 = wd_dlist_read_h(&p);
+                h1 = wd_dlist_read_h(&p);
+                wdFillRealizedPath(hCanvas, (WD_HBRUSH) h0, (WD_HREALIZEDFILL) h1);
+                break;
+
+            case WD_DL_FILLRECT:
+                h0 = wd_dlist_read_h(&p);
+                for(i = 0; i < 4; i++)
+                    f[i] = wd_dlist_read_f(&p);
+                wdFillRect(hCanvas, (WD_HBRUSH) h0, f[0], f[1], f[2], f[3]);
+                break;
+
+            case WD_DL_BITBLTIMAGE:
+            case WD_DL_BITBLTHICON:
+                h0 = wd_dlist_read_h(&p);
+                pr0 = wd_dlist_read_rect_opt(&p, &r0);
+                pr1 = wd_dlist_read_rect_opt(&p, &r1);
+                if(op == WD_DL_BITBLTIMAGE)
+                    wdBitBltImage(hCanvas, (WD_HIMAGE) h0, pr0, pr1);
+                else
+                    wdBitBltHICON(hCanvas, (HICON) h0, pr0, pr1);
+                break;
+
+            case WD_DL_BITBLTCACHEDIMAGE:
+                h0 = wd_dlist_read_h(&p);
+                f[0] = wd_dlist_read_f(&p);
+                f[1] = wd_dlist_read_f(&p);
+                wdBitBltCachedImage(hCanvas, (WD_HCACHEDIMAGE) h0, f[0], f[1]);
+                break;
+
+            case WD_DL_DRAWSTRING:
+                h0 = wd_dlist_read_h(&p);
+                memcpy(&r0, p, sizeof(WD_RECT));
+                p += sizeof(WD_RECT);
+                str = wd_dlist_read_str(&p, dl->buffer, &len);
+                h1 = wd_dlist_read_h(&p);
+                wdDrawString(hCanvas, (WD_HFONT) h0, &r0, str, len, (WD_HBRUSH) h1,
+                            (DWORD) wd_dlist_read_u(&p));
+                break;
+
+            case WD_DL_DRAWRECTS:
+            case WD_DL_DRAWLINES:
+            case WD_DL_DRAWPOLYLINE:
+                h0 = wd_dlist_read_h(&p);
+                items = wd_dlist_read_array(&p, dl->buffer,
+                            (op == WD_DL_DRAWRECTS) ? sizeof(WD_RECT) : sizeof(WD_POINT), &count);
+                if(op == WD_DL_DRAWLINES)
+                    count /= 2;
+                f[0] = wd_dlist_read_f(&p);
+                h1 = wd_dlist_read_h(&p);
+                if(op == WD_DL_DRAWRECTS)
+                    wdDrawRectsStyled(hCanvas, (WD_HBRUSH) h0, (const WD_RECT*) items, count,
+                                f[0], (WD_HSTROKESTYLE) h1);
+                else if(op == WD_DL_DRAWLINES)
+                    wdDrawLinesStyled(hCanvas, (WD_HBRUSH) h0, (const WD_POINT*) items, count,
+                                f[0], (WD_HSTROKESTYLE) h1);
+                else
+                    wdDrawPolylineStyled(hCanvas, (WD_HBRUSH) h0, (const WD_POINT*) items, count,
+                                f[0], (WD_HSTROKESTYLE) h1);
+                break;
+
+            case WD_DL_FILLRECTS:
+                h0 = wd_dlist_read_h(&p);
+                items = wd_dlist_read_array(&p, dl->buffer, sizeof(WD_RECT), &count);
+                wdFillRects(hCanvas, (WD_HBRUSH) h0, (const WD_RECT*) items, count);
+                break;
+
+            case WD_DL_FILLELLIPSES:
+                h0 = wd_dlist_read_h(&p);
+                items = wd_dlist_read_array(&p, dl->buffer, sizeof(WD_ELLIPSE), &count);
+                wdFillEllipses(hCanvas, (WD_HBRUSH) h0, (const WD_ELLIPSE*) items, count);
+                break;
+
+            default:
+                /* Cannot happen: the list is written only by us. */
+                WD_TRACE("wdReplay: Corrupted display list.");
+                p = end;
+                break;
+        }
+    }
+
+    /* Revert whatever the list has left on the canvas. */
+    while(depth > 0) {
+        wdRestoreState(hCanvas);
+        depth--;
+    }
+    wdRestoreState(hCanvas);
+
+    WD_EVENT_END("wdReplay");
+}
@@ -0,0 +1,209 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef WD_DLIST_H
+#define WD_DLIST_H
+
+#include "misc.h"
+
+#include <string.h>
+
+
+/* Display list (see wdBeginRecording()). It is a single growing buffer of
+ * commands, each an opcode (one byte, WD_DL_xxx) followed by its arguments
+ * as listed below, in their native binary representation and with no
+ * alignment:
+ *   h      handle (void*)
+ *   f      float
+ *   u      UINT
+ *   c      WD_COLOR
+ *   r      WD_RECT (4 x f)
+ *   r?     optional WD_RECT: one byte 0 for NULL; or 1 followed by r
+ *   m      WD_MATRIX (6 x f)
+ *   s      string: u count of WCHARs, a padding byte if needed to align the
+ *          WCHARs to their size (relative to the start of the buffer), then
+ *          the WCHARs
+ *   a      array (of WD_RECT, WD_POINT or WD_ELLIPSE): u count of items,
+ *          padding to align them to a float (as with s), then the items
+ *
+ * The canvas is not stored: it is the one passed to wdReplay().
+ *
+ * Every handle stored in the list is retained (see wd_dlist_h()), so the
+ * list stays valid when the application destroys the resource.
+ */
+
+#define WD_DL_CLEAR                 1   /* c */
+#define WD_DL_SETCLIP               2   /* r?, h:path */
+#define WD_DL_PUSHCLIPRECT          3   /* r */
+#define WD_DL_PUSHCLIPPATH          4   /* h:path, r? */
+#define WD_DL_POPCLIP               5
+#define WD_DL_ROTATEWORLD           6   /* f:cx, f:cy, f:angle */
+#define WD_DL_TRANSLATEWORLD        7   /* f:dx, f:dy */
+#define WD_DL_TRANSFORMWORLD        8   /* m */
+#define WD_DL_RESETWORLD            9
+#define WD_DL_SETWORLDTRANSFORM    10   /* m */
+#define WD_DL_SAVESTATE            11
+#define WD_DL_RESTORESTATE         12
+#define WD_DL_SETSOLIDBRUSHCOLOR   13   /* h:brush, c */
+#define WD_DL_DRAWELLIPSEARC       14   /* h:brush, f:cx, f:cy, f:rx, f:ry,
+                                         * f:base, f:sweep, f:width, h:style */
+#define WD_DL_DRAWELLIPSEPIE       15   /* (as WD_DL_DRAWELLIPSEARC) */
+#define WD_DL_DRAWELLIPSE          16   /* h:brush, f:cx, f:cy, f:rx, f:ry, f:width, h:style */
+#define WD_DL_DRAWLINE             17   /* h:brush, f:x0, f:y0, f:x1, f:y1, f:width, h:style */
+#define WD_DL_DRAWPATH             18   /* h:brush, h:path, f:width, h:style */
+#define WD_DL_DRAWRECT             19   /* (as WD_DL_DRAWLINE) */
+#define WD_DL_FILLELLIPSE          20   /* h:brush, f:cx, f:cy, f:rx, f:ry */
+#define WD_DL_FILLELLIPSEPIE       21   /* h:brush, f:cx, f:cy, f:rx, f:ry, f:base, f:sweep */
+#define WD_DL_FILLPATH             22   /* h:brush, h:path */
+#define WD_DL_FILLRECT             23   /* h:brush, f:x0, f:y0, f:x1, f:y1 */
+#define WD_DL_BITBLTIMAGE          24   /* h:image, r?:dest, r?:source */
+#define WD_DL_BITBLTCACHEDIMAGE    25   /* h:cached_image, f:x, f:y */
+#define WD_DL_BITBLTHICON          26   /* h:icon, r?:dest, r?:source */
+#define WD_DL_DRAWSTRING           27   /* h:font, r, s, h:brush, u:flags */
+#define WD_DL_DRAWRECTS            28   /* h:brush, a:rects, f:width, h:style */
+#define WD_DL_DRAWLINES            29   /* h:brush, a:points (two per line), f:width, h:style */
+#define WD_DL_DRAWPOLYLINE         30   /* h:brush, a:points, f:width, h:style */
+#define WD_DL_FILLRECTS            31   /* h:brush, a:rects */
+#define WD_DL_FILLELLIPSES         32   /* h:brush, a:ellipses */
+#define WD_DL_FILLREALIZEDPATH     33   /* h:brush, h:fill */
+
+
+/* Hash table of handles (open addressing, linear probing). It is used for
+ * the handles of each list, and for the handles retained by all the lists
+ * together (with their reference counts). */
+typedef struct wd_dlist_res_tag wd_dlist_res_t;
+struct wd_dlist_res_tag {
+    const void* handle;     /* NULL for an empty slot. */
+    UINT refs;
+    void (*destroy)(void*); /* Set once the resource is left to the lists. */
+};
+
+typedef struct wd_dlist_table_tag wd_dlist_table_t;
+struct wd_dlist_table_tag {
+    wd_dlist_res_t* slots;
+    UINT count;
+    UINT capacity;          /* Zero or a power of two. */
+};
+
+typedef struct wd_dlist_tag wd_dlist_t;
+struct wd_dlist_tag {
+    WD_HCANVAS canvas;      /* While being recorded. */
+    BYTE* buffer;
+    size_t size;
+    size_t capacity;
+    wd_dlist_table_t resources;
+    BOOL error;             /* Set when an allocation has failed. */
+    BOOL absolute;          /* Has WD_DL_RESETWORLD or WD_DL_SETWORLDTRANSFORM. */
+};
+
+/* Recording in progress on the current thread, if any. */
+extern WD_THREAD_LOCAL wd_dlist_t* wd_dlist_current;
+
+/* Every public function painting on a canvas (or changing its state) checks
+ * this first. If TRUE, it appends its command and returns without doing
+ * anything else: the call is not captured, counted nor culled, as all that
+ * happens when the list is replayed. */
+#define WD_DLIST_RECORDING(hCanvas)                                             \
+        (wd_dlist_current != NULL  &&  wd_dlist_current->canvas == (hCanvas))
+
+/* Returns NULL (and marks the list as failed) if the buffer cannot grow. */
+BYTE* wd_dlist_grow(wd_dlist_t* dl, size_t n);
+
+static inline BYTE*
+wd_dlist_reserve(size_t n)
+{
+    wd_dlist_t* dl = wd_dlist_current;
+    BYTE* p;
+
+    if(dl->size + n > dl->capacity)
+        return wd_dlist_grow(dl, n);
+
+    p = dl->buffer + dl->size;
+    dl->size += n;
+    return p;
+}
+
+static inline void
+wd_dlist_op(BYTE op)
+{
+    BYTE* p = wd_dlist_reserve(1);
+    if(p != NULL)
+        *p = op;
+}
+
+/* Retains the handle (if not NULL) until the list is destroyed. */
+void wd_dlist_retain(const void* handle, void (*destroy)(void*));
+
+static inline void
+wd_dlist_h(const void* handle)
+{
+    BYTE* p = wd_dlist_reserve(sizeof(const void*));
+    if(p != NULL)
+        memcpy(p, &handle, sizeof(const void*));
+    if(handle != NULL)
+        wd_dlist_retain(handle, NULL);
+}
+
+/* For a handle the application does not destroy through us (i.e. a copy of
+ * an icon): the lists own it, and the last one calls the destructor. */
+static inline void
+wd_dlist_h_owned(const void* handle, void (*destroy)(void*))
+{
+    BYTE* p = wd_dlist_reserve(sizeof(const void*));
+    if(p != NULL)
+        memcpy(p, &handle, sizeof(const void*));
+    wd_dlist_retain(handle, destroy);
+}
+
+static inline void
+wd_dlist_f(float f)
+{
+    BYTE* p = wd_dlist_reserve(sizeof(float));
+    if(p != NULL)
+        memcpy(p, &f, sizeof(float));
+}
+
+static inline void
+wd_dlist_u(UINT u)
+{
+    BYTE* p = wd_dlist_reserve(sizeof(UINT));
+    if(p != NULL)
+        memcpy(p, &u, sizeof(UINT));
+}
+
+#define wd_dlist_c(color)   wd_dlist_u((UINT) (color))
+
+void wd_dlist_rect(const WD_RECT* rect);
+void wd_dlist_rect_opt(const WD_RECT* rect);
+void wd_dlist_matrix(const WD_MATRIX* matrix);
+void wd_dlist_str(const WCHAR* str, int len);
+void wd_dlist_array(const void* items, UINT count, size_t item_size);
+
+/* Called by wdDestroyBrush() and others. If any display list still refers to
+ * the handle, the destructor is remembered to be called by the last list
+ * releasing it, and TRUE is returned. Otherwise the caller destroys the
+ * handle right away. */
+BOOL wd_dlist_defer_destroy(const void* handle, void (*destroy)(void*));
+
+
+#endif  /* WD_DLIST_H */
@@ -22,159 +22,419 @@
  */
 
 #include "misc.h"
+#include "backend-ops.h"
 #include "backend-d2d.h"
 #include "backend-gdix.h"
+#include "canvas.h"
+#include "capture.h"
+#include "decimate.h"
+#include "dlist.h"
 #include "lock.h"
+#include "path.h"
+#include "strokestyle.h"
 
 
 void
 wdDrawEllipseArcStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, float cx, float cy, float rx, float ry,
           float fBaseAngle, float fSweepAngle, float fStrokeWidth, WD_HSTROKESTYLE hStrokeStyle)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_DRAWELLIPSEARC);
+        wd_dlist_h(hBrush);
+        wd_dlist_f(cx);
+        wd_dlist_f(cy);
+        wd_dlist_f(rx);
+        wd_dlist_f(ry);
+        wd_dlist_f(fBaseAngle);
+        wd_dlist_f(fSweepAngle);
+        wd_dlist_f(fStrokeWidth);
+        wd_dlist_h(hStrokeStyle);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DRAWELLIPSEARC);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_f(cx);
+        wd_capture_f(cy);
+        wd_capture_f(rx);
+        wd_capture_f(ry);
+        wd_capture_f(fBaseAngle);
+        wd_capture_f(fSweepAngle);
+        wd_capture_f(fStrokeWidth);
+        wd_capture_h(hStrokeStyle);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_PIE);
+
+    if(wd_cull(hCanvas, cx - rx, cy - ry, cx + rx, cy + ry, WD_CULL_STROKE(fStrokeWidth)))
+        return;
+
+    WD_EVENT_BEGIN("wdDrawEllipseArcStyled");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnDrawEllipseArc(c->canvas, (void*) hBrush, cx, cy, rx, ry,
+                    fBaseAngle, fSweepAngle, fStrokeWidth, wd_strokestyle_backend(hStrokeStyle));
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
         dummy_ID2D1Geometry* g;
-        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*)hStrokeStyle;
+        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*) wd_strokestyle_backend(hStrokeStyle);
 
         g = d2d_create_arc_geometry(cx, cy, rx, ry, fBaseAngle, fSweepAngle, FALSE);
         if(g == NULL) {
             WD_TRACE("wdDrawArc: d2d_create_arc_geometry() failed.");
+            WD_EVENT_END("wdDrawEllipseArcStyled");
             return;
         }
+        c->stats.geometries++;
 
+        d2d_sync_transform(c);
         dummy_ID2D1RenderTarget_DrawGeometry(c->target, g, b, fStrokeWidth, s);
         dummy_ID2D1Geometry_Release(g);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
-        gdix_strokestyle_t* s = (gdix_strokestyle_t*)hStrokeStyle;
+        gdix_strokestyle_t* s = (gdix_strokestyle_t*) wd_strokestyle_backend(hStrokeStyle);
         dummy_GpBrush* b = (dummy_GpBrush*)hBrush;
         float dx = 2.0f * rx;
         float dy = 2.0f * ry;
 
         gdix_setpen(c->pen, b, fStrokeWidth, s);
 
+        gdix_sync_transform(c);
         gdix_vtable->fn_DrawArc(c->graphics, c->pen, cx - rx, cy - ry, dx, dy,
                      fBaseAngle, fSweepAngle);
     }
+
+    WD_EVENT_END("wdDrawEllipseArcStyled");
 }
 
 void
 wdDrawEllipseStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, float cx, float cy, float rx, float ry,
              float fStrokeWidth, WD_HSTROKESTYLE hStrokeStyle)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_DRAWELLIPSE);
+        wd_dlist_h(hBrush);
+        wd_dlist_f(cx);
+        wd_dlist_f(cy);
+        wd_dlist_f(rx);
+        wd_dlist_f(ry);
+        wd_dlist_f(fStrokeWidth);
+        wd_dlist_h(hStrokeStyle);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DRAWELLIPSE);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_f(cx);
+        wd_capture_f(cy);
+        wd_capture_f(rx);
+        wd_capture_f(ry);
+        wd_capture_f(fStrokeWidth);
+        wd_capture_h(hStrokeStyle);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_ELLIPSE);
+
+    if(wd_cull(hCanvas, cx - rx, cy - ry, cx + rx, cy + ry, WD_CULL_STROKE(fStrokeWidth)))
+        return;
+
+    WD_EVENT_BEGIN("wdDrawEllipseStyled");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnDrawEllipse(c->canvas, (void*) hBrush, cx, cy, rx, ry,
+                    fStrokeWidth, wd_strokestyle_backend(hStrokeStyle));
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
         dummy_D2D1_ELLIPSE e = { { cx, cy }, rx, ry };
-        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*)hStrokeStyle;
+        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*) wd_strokestyle_backend(hStrokeStyle);
 
+        d2d_sync_transform(c);
         dummy_ID2D1RenderTarget_DrawEllipse(c->target, &e, b, fStrokeWidth, s);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
-        gdix_strokestyle_t* s = (gdix_strokestyle_t*)hStrokeStyle;
+        gdix_strokestyle_t* s = (gdix_strokestyle_t*) wd_strokestyle_backend(hStrokeStyle);
         dummy_GpBrush* b = (dummy_GpBrush*)hBrush;
         float dx = 2.0f * rx;
         float dy = 2.0f * ry;
 
         gdix_setpen(c->pen, b, fStrokeWidth, s);
 
+        gdix_sync_transform(c);
         gdix_vtable->fn_DrawEllipse(c->graphics, (void*)c->pen,
                 cx - rx, cy - ry, dx, dy);
     }
+
+    WD_EVENT_END("wdDrawEllipseStyled");
 }
 
 void
 wdDrawLineStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
            float x0, float y0, float x1, float y1, float fStrokeWidth, WD_HSTROKESTYLE hStrokeStyle)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_DRAWLINE);
+        wd_dlist_h(hBrush);
+        wd_dlist_f(x0);
+        wd_dlist_f(y0);
+        wd_dlist_f(x1);
+        wd_dlist_f(y1);
+        wd_dlist_f(fStrokeWidth);
+        wd_dlist_h(hStrokeStyle);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DRAWLINE);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_f(x0);
+        wd_capture_f(y0);
+        wd_capture_f(x1);
+        wd_capture_f(y1);
+        wd_capture_f(fStrokeWidth);
+        wd_capture_h(hStrokeStyle);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_LINE);
+
+    if(wd_cull(hCanvas, x0, y0, x1, y1, WD_CULL_STROKE(fStrokeWidth)))
+        return;
+
+    WD_EVENT_BEGIN("wdDrawLineStyled");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnDrawLine(c->canvas, (void*) hBrush, x0, y0, x1, y1,
+                    fStrokeWidth, wd_strokestyle_backend(hStrokeStyle));
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
         dummy_D2D1_POINT_2F pt0 = { x0, y0 };
         dummy_D2D1_POINT_2F pt1 = { x1, y1 };
-        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*)hStrokeStyle;
+        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*) wd_strokestyle_backend(hStrokeStyle);
 
+        d2d_sync_transform(c);
         dummy_ID2D1RenderTarget_DrawLine(c->target, pt0, pt1, b, fStrokeWidth, s);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
-        gdix_strokestyle_t* s = (gdix_strokestyle_t*)hStrokeStyle;
+        gdix_strokestyle_t* s = (gdix_strokestyle_t*) wd_strokestyle_backend(hStrokeStyle);
         dummy_GpBrush* b = (dummy_GpBrush*)hBrush;
 
         gdix_setpen(c->pen, b, fStrokeWidth, s);
 
+        gdix_sync_transform(c);
         gdix_vtable->fn_DrawLine(c->graphics, c->pen, x0, y0, x1, y1);
     }
+
+    WD_EVENT_END("wdDrawLineStyled");
 }
 
 void
 wdDrawPathStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, const WD_HPATH hPath,
             float fStrokeWidth, WD_HSTROKESTYLE hStrokeStyle)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_DRAWPATH);
+        wd_dlist_h(hBrush);
+        wd_dlist_h(hPath);
+        wd_dlist_f(fStrokeWidth);
+        wd_dlist_h(hStrokeStyle);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DRAWPATH);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_h(hPath);
+        wd_capture_f(fStrokeWidth);
+        wd_capture_h(hStrokeStyle);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_PATH);
+
+    WD_EVENT_BEGIN("wdDrawPathStyled");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnDrawPath(c->canvas, (void*) hBrush, wd_path_backend(hPath),
+                    fStrokeWidth, wd_strokestyle_backend(hStrokeStyle));
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
-        dummy_ID2D1Geometry* g = (dummy_ID2D1Geometry*) hPath;
+        dummy_ID2D1Geometry* g = (dummy_ID2D1Geometry*) wd_path_backend(hPath);
         dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
-        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*)hStrokeStyle;
+        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*) wd_strokestyle_backend(hStrokeStyle);
 
+        d2d_sync_transform(c);
         dummy_ID2D1RenderTarget_DrawGeometry(c->target, g, b, fStrokeWidth, s);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
-        gdix_strokestyle_t* s = (gdix_strokestyle_t*)hStrokeStyle;
+        gdix_strokestyle_t* s = (gdix_strokestyle_t*) wd_strokestyle_backend(hStrokeStyle);
         dummy_GpBrush* b = (dummy_GpBrush*)hBrush;
 
         gdix_setpen(c->pen, b, fStrokeWidth, s);
 
-        gdix_vtable->fn_DrawPath(c->graphics, (void*)c->pen, (void*)hPath);
+        gdix_sync_transform(c);
+        gdix_vtable->fn_DrawPath(c->graphics, (void*)c->pen, wd_path_backend(hPath));
     }
+
+    WD_EVENT_END("wdDrawPathStyled");
 }
 
 void
 wdDrawEllipsePieStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, float cx, float cy, float rx, float ry,
                 float fBaseAngle, float fSweepAngle, float fStrokeWidth, WD_HSTROKESTYLE hStrokeStyle)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_DRAWELLIPSEPIE);
+        wd_dlist_h(hBrush);
+        wd_dlist_f(cx);
+        wd_dlist_f(cy);
+        wd_dlist_f(rx);
+        wd_dlist_f(ry);
+        wd_dlist_f(fBaseAngle);
+        wd_dlist_f(fSweepAngle);
+        wd_dlist_f(fStrokeWidth);
+        wd_dlist_h(hStrokeStyle);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DRAWELLIPSEPIE);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_f(cx);
+        wd_capture_f(cy);
+        wd_capture_f(rx);
+        wd_capture_f(ry);
+        wd_capture_f(fBaseAngle);
+        wd_capture_f(fSweepAngle);
+        wd_capture_f(fStrokeWidth);
+        wd_capture_h(hStrokeStyle);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_PIE);
+
+    if(wd_cull(hCanvas, cx - rx, cy - ry, cx + rx, cy + ry,
+               WD_CULL_STROKE_MITER(fStrokeWidth, wd_strokestyle_miter_limit(hStrokeStyle))))
+        return;
+
+    WD_EVENT_BEGIN("wdDrawEllipsePieStyled");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnDrawEllipsePie(c->canvas, (void*) hBrush, cx, cy, rx, ry,
+                    fBaseAngle, fSweepAngle, fStrokeWidth, wd_strokestyle_backend(hStrokeStyle));
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
         dummy_ID2D1Geometry* g;
-        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*)hStrokeStyle;
+        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*) wd_strokestyle_backend(hStrokeStyle);
 
         g = d2d_create_arc_geometry(cx, cy, rx, ry, fBaseAngle, fSweepAngle, TRUE);
         if(g == NULL) {
             WD_TRACE("wdDrawPie: d2d_create_arc_geometry() failed.");
+            WD_EVENT_END("wdDrawEllipsePieStyled");
             return;
         }
+        c->stats.geometries++;
 
+        d2d_sync_transform(c);
         dummy_ID2D1RenderTarget_DrawGeometry(c->target, g, b, fStrokeWidth, s);
         dummy_ID2D1Geometry_Release(g);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
-        gdix_strokestyle_t* s = (gdix_strokestyle_t*)hStrokeStyle;
+        gdix_strokestyle_t* s = (gdix_strokestyle_t*) wd_strokestyle_backend(hStrokeStyle);
         dummy_GpBrush* b = (dummy_GpBrush*)hBrush;
         float dx = 2.0f * rx;
         float dy = 2.0f * ry;
 
         gdix_setpen(c->pen, b, fStrokeWidth, s);
 
+        gdix_sync_transform(c);
         gdix_vtable->fn_DrawPie(c->graphics, c->pen, cx - rx, cy - ry, dx, dy,
                                 fBaseAngle, fSweepAngle);
     }
+
+    WD_EVENT_END("wdDrawEllipsePieStyled");
 }
 
 void
 wdDrawRectStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
            float x0, float y0, float x1, float y1, float fStrokeWidth, WD_HSTROKESTYLE hStrokeStyle)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_DRAWRECT);
+        wd_dlist_h(hBrush);
+        wd_dlist_f(x0);
+        wd_dlist_f(y0);
+        wd_dlist_f(x1);
+        wd_dlist_f(y1);
+        wd_dlist_f(fStrokeWidth);
+        wd_dlist_h(hStrokeStyle);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DRAWRECT);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_f(x0);
+        wd_capture_f(y0);
+        wd_capture_f(x1);
+        wd_capture_f(y1);
+        wd_capture_f(fStrokeWidth);
+        wd_capture_h(hStrokeStyle);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_RECT);
+
+    if(wd_cull(hCanvas, x0, y0, x1, y1, WD_CULL_STROKE(fStrokeWidth)))
+        return;
+
+    WD_EVENT_BEGIN("wdDrawRectStyled");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnDrawRect(c->canvas, (void*) hBrush, x0, y0, x1, y1,
+                    fStrokeWidth, wd_strokestyle_backend(hStrokeStyle));
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
         dummy_D2D1_RECT_F r = { x0, y0, x1, y1 };
-        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*)hStrokeStyle;
+        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*) wd_strokestyle_backend(hStrokeStyle);
 
+        d2d_sync_transform(c);
         dummy_ID2D1RenderTarget_DrawRectangle(c->target, &r, b, fStrokeWidth, s);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
-        gdix_strokestyle_t* s = (gdix_strokestyle_t*)hStrokeStyle;
+        gdix_strokestyle_t* s = (gdix_strokestyle_t*) wd_strokestyle_backend(hStrokeStyle);
         dummy_GpBrush* b = (dummy_GpBrush*)hBrush;
         float tmp;
 
@@ -184,6 +444,352 @@ wdDrawRectStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
 
         gdix_setpen(c->pen, b, fStrokeWidth, s);
 
+        gdix_sync_transform(c);
         gdix_vtable->fn_DrawRectangle(c->graphics, c->pen, x0, y0, x1 - x0, y1 - y0);
     }
+
+    WD_EVENT_END("wdDrawRectStyled");
+}
+
+void
+wdDrawRectsStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, const WD_RECT* pRects,
+            UINT uCount, float fStrokeWidth, WD_HSTROKESTYLE hStrokeStyle)
+{
+    UINT i;
+
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_DRAWRECTS);
+        wd_dlist_h(hBrush);
+        wd_dlist_array(pRects, uCount, sizeof(WD_RECT));
+        wd_dlist_f(fStrokeWidth);
+        wd_dlist_h(hStrokeStyle);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DRAWRECTS);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_u(uCount);
+        for(i = 0; i < uCount; i++)
+            wd_capture_rect(&pRects[i]);
+        wd_capture_f(fStrokeWidth);
+        wd_capture_h(hStrokeStyle);
+        wd_capture_end();
+    }
+
+    if(uCount == 0)
+        return;
+
+    WD_STATS_DRAWCALLS(hCanvas, WD_PRIMITIVE_RECT, uCount);
+
+    if(wd_cull_enabled(hCanvas)) {
+        WD_RECT b;
+
+        wd_bounds_rects(pRects, uCount, &b);
+        if(wd_cull(hCanvas, b.x0, b.y0, b.x1, b.y1, WD_CULL_STROKE(fStrokeWidth)))
+            return;
+    }
+
+    WD_EVENT_BEGIN("wdDrawRectsStyled");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        for(i = 0; i < uCount; i++) {
+            wd_backend_ops->fnDrawRect(c->canvas, (void*) hBrush,
+                        pRects[i].x0, pRects[i].y0, pRects[i].x1, pRects[i].y1,
+                        fStrokeWidth, wd_strokestyle_backend(hStrokeStyle));
+        }
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
+        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*) wd_strokestyle_backend(hStrokeStyle);
+
+        /* D2D has no batch for this. (WD_RECT and D2D1_RECT_F are binary
+         * compatible.) */
+        d2d_sync_transform(c);
+        for(i = 0; i < uCount; i++) {
+            dummy_ID2D1RenderTarget_DrawRectangle(c->target,
+                        (const dummy_D2D1_RECT_F*) &pRects[i], b, fStrokeWidth, s);
+        }
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+        gdix_strokestyle_t* s = (gdix_strokestyle_t*) wd_strokestyle_backend(hStrokeStyle);
+        dummy_GpBrush* b = (dummy_GpBrush*)hBrush;
+        dummy_GpRectF gp_rects[GDIX_RECT_CHUNK];
+        UINT n;
+
+        gdix_setpen(c->pen, b, fStrokeWidth, s);
+
+        gdix_sync_transform(c);
+        for(i = 0; i < uCount; i += n) {
+            n = WD_MIN(uCount - i, GDIX_RECT_CHUNK);
+            gdix_init_rects(gp_rects, pRects + i, n);
+            gdix_vtable->fn_DrawRectangles(c->graphics, c->pen, gp_rects, (INT) n);
+        }
+    }
+
+    WD_EVENT_END("wdDrawRectsStyled");
+}
+
+void
+wdDrawLinesStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, const WD_POINT* pPoints,
+            UINT uCount, float fStrokeWidth, WD_HSTROKESTYLE hStrokeStyle)
+{
+    UINT i;
+
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_DRAWLINES);
+        wd_dlist_h(hBrush);
+        wd_dlist_array(pPoints, 2 * uCount, sizeof(WD_POINT));
+        wd_dlist_f(fStrokeWidth);
+        wd_dlist_h(hStrokeStyle);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DRAWLINES);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_u(uCount);
+        for(i = 0; i < 2 * uCount; i++) {
+            wd_capture_f(pPoints[i].x);
+            wd_capture_f(pPoints[i].y);
+        }
+        wd_capture_f(fStrokeWidth);
+        wd_capture_h(hStrokeStyle);
+        wd_capture_end();
+    }
+
+    if(uCount == 0)
+        return;
+
+    WD_STATS_DRAWCALLS(hCanvas, WD_PRIMITIVE_LINE, uCount);
+
+    if(wd_cull_enabled(hCanvas)) {
+        WD_RECT b;
+
+        wd_bounds_points(pPoints, 2 * uCount, &b);
+        if(wd_cull(hCanvas, b.x0, b.y0, b.x1, b.y1, WD_CULL_STROKE(fStrokeWidth)))
+            return;
+    }
+
+    WD_EVENT_BEGIN("wdDrawLinesStyled");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        for(i = 0; i < 2 * uCount; i += 2) {
+            wd_backend_ops->fnDrawLine(c->canvas, (void*) hBrush,
+                        pPoints[i].x, pPoints[i].y, pPoints[i+1].x, pPoints[i+1].y,
+                        fStrokeWidth, wd_strokestyle_backend(hStrokeStyle));
+        }
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
+        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*) wd_strokestyle_backend(hStrokeStyle);
+        dummy_D2D1_POINT_2F pt0;
+        dummy_D2D1_POINT_2F pt1;
+
+        d2d_sync_transform(c);
+        for(i = 0; i < 2 * uCount; i += 2) {
+            pt0.x = pPoints[i].x;
+            pt0.y = pPoints[i].y;
+            pt1.x = pPoints[i+1].x;
+            pt1.y = pPoints[i+1].y;
+            dummy_ID2D1RenderTarget_DrawLine(c->target, pt0, pt1, b, fStrokeWidth, s);
+        }
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+        gdix_strokestyle_t* s = (gdix_strokestyle_t*) wd_strokestyle_backend(hStrokeStyle);
+        dummy_GpBrush* b = (dummy_GpBrush*)hBrush;
+
+        /* GdipDrawLines() would connect them, but the pen at least is set
+         * up only once. */
+        gdix_setpen(c->pen, b, fStrokeWidth, s);
+
+        gdix_sync_transform(c);
+        for(i = 0; i < 2 * uCount; i += 2) {
+            gdix_vtable->fn_DrawLine(c->graphics, c->pen,
+                        pPoints[i].x, pPoints[i].y, pPoints[i+1].x, pPoints[i+1].y);
+        }
+    }
+
+    WD_EVENT_END("wdDrawLinesStyled");
+}
+
+/* wdDrawPolylineStyled() after the display list and capture hooks. */
+static void
+wd_draw_polyline(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, const WD_POINT* pPoints,
+                 UINT uCount, float fStrokeWidth, WD_HSTROKESTYLE hStrokeStyle)
+{
+    UINT i;
+
+    if(uCount < 2)
+        return;
+
+    WD_STATS_DRAWCALLS(hCanvas, WD_PRIMITIVE_LINE, uCount - 1);
+
+    if(wd_cull_enabled(hCanvas)) {
+        WD_RECT b;
+
+        /* Miter joins may stick out more than the caps. */
+        wd_bounds_points(pPoints, uCount, &b);
+        if(wd_cull(hCanvas, b.x0, b.y0, b.x1, b.y1,
+                   WD_CULL_STROKE_MITER(fStrokeWidth, wd_strokestyle_miter_limit(hStrokeStyle))))
+            return;
+    }
+
+    WD_EVENT_BEGIN("wdDrawPolylineStyled");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        void* path;
+        void* sink;
+
+        path = wd_backend_ops->fnCreatePath(c->canvas);
+        if(path == NULL) {
+            WD_TRACE("wdDrawPolylineStyled: WD_BACKEND_OPS::fnCreatePath() failed.");
+            WD_EVENT_END("wdDrawPolylineStyled");
+            return;
+        }
+        c->stats.geometries++;
+
+        sink = wd_backend_ops->fnOpenPathSink(path);
+        if(sink == NULL) {
+            WD_TRACE("wdDrawPolylineStyled: WD_BACKEND_OPS::fnOpenPathSink() failed.");
+            wd_backend_ops->fnDestroyPath(path);
+            WD_EVENT_END("wdDrawPolylineStyled");
+            return;
+        }
+        wd_backend_ops->fnBeginFigure(sink, pPoints[0].x, pPoints[0].y);
+        for(i = 1; i < uCount; i++)
+            wd_backend_ops->fnAddLine(sink, pPoints[i].x, pPoints[i].y);
+        wd_backend_ops->fnEndFigure(sink, FALSE);
+        wd_backend_ops->fnClosePathSink(sink);
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnDrawPath(c->canvas, (void*) hBrush, path,
+                    fStrokeWidth, wd_strokestyle_backend(hStrokeStyle));
+        wd_backend_ops->fnDestroyPath(path);
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
+        dummy_ID2D1Geometry* g;
+        dummy_ID2D1StrokeStyle* s = (dummy_ID2D1StrokeStyle*) wd_strokestyle_backend(hStrokeStyle);
+
+        g = d2d_create_polyline_geometry(pPoints, uCount);
+        if(g == NULL) {
+            WD_TRACE("wdDrawPolylineStyled: d2d_create_polyline_geometry() failed.");
+            WD_EVENT_END("wdDrawPolylineStyled");
+            return;
+        }
+        c->stats.geometries++;
+
+        d2d_sync_transform(c);
+        dummy_ID2D1RenderTarget_DrawGeometry(c->target, g, b, fStrokeWidth, s);
+        dummy_ID2D1Geometry_Release(g);
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+        gdix_strokestyle_t* s = (gdix_strokestyle_t*) wd_strokestyle_backend(hStrokeStyle);
+        dummy_GpBrush* b = (dummy_GpBrush*)hBrush;
+
+        gdix_setpen(c->pen, b, fStrokeWidth, s);
+
+        /* WD_POINT and GpPointF are binary compatible. */
+        gdix_sync_transform(c);
+        gdix_vtable->fn_DrawLines(c->graphics, c->pen,
+                    (const dummy_GpPointF*) pPoints, (INT) uCount);
+    }
+
+    WD_EVENT_END("wdDrawPolylineStyled");
+}
+
+void
+wdDrawPolylineStyled(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, const WD_POINT* pPoints,
+            UINT uCount, float fStrokeWidth, WD_HSTROKESTYLE hStrokeStyle)
+{
+    UINT i;
+
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_DRAWPOLYLINE);
+        wd_dlist_h(hBrush);
+        wd_dlist_array(pPoints, uCount, sizeof(WD_POINT));
+        wd_dlist_f(fStrokeWidth);
+        wd_dlist_h(hStrokeStyle);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DRAWPOLYLINE);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_u(uCount);
+        for(i = 0; i < uCount; i++) {
+            wd_capture_f(pPoints[i].x);
+            wd_capture_f(pPoints[i].y);
+        }
+        wd_capture_f(fStrokeWidth);
+        wd_capture_h(hStrokeStyle);
+        wd_capture_end();
+    }
+
+    wd_draw_polyline(hCanvas, hBrush, pPoints, uCount, fStrokeWidth, hStrokeStyle);
+}
+
+/* Max. distance of the dropped points from the polyline in WD_DECIMATE_RDP
+ * mode, in device pixels. */
+#define WD_DECIMATE_TOLERANCE   0.25f
+
+void
+wdDrawPolylineDecimated(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, const WD_POINT* pPoints,
+            UINT uCount, float fStrokeWidth, UINT uMode)
+{
+    wd_decimate_t d;
+    WD_MATRIX m;
+    WD_RECT visible;
+    UINT i;
+
+    /* When recording, the decimated polyline is what gets recorded (by
+     * wdDrawPolylineStyled() below). */
+    if(!WD_DLIST_RECORDING(hCanvas)  &&  WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DRAWPOLYLINEDECIMATED);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_u(uCount);
+        for(i = 0; i < uCount; i++) {
+            wd_capture_f(pPoints[i].x);
+            wd_capture_f(pPoints[i].y);
+        }
+        wd_capture_f(fStrokeWidth);
+        wd_capture_u(uMode);
+        wd_capture_end();
+    }
+
+    if(uCount < 2)
+        return;
+
+    wd_canvas_visible(hCanvas, &m, &visible);
+
+    wd_decimate_init(&d);
+    wd_decimate_minmax(&d, pPoints, uCount, &m);
+    if(uMode == WD_DECIMATE_RDP)
+        wd_decimate_rdp(&d, WD_DECIMATE_TOLERANCE);
+
+    if(!d.error) {
+        pPoints = d.points;
+        uCount = d.count;
+    } else {
+        WD_TRACE("wdDrawPolylineDecimated: Out of memory, drawing all the points.");
+    }
+
+    if(WD_DLIST_RECORDING(hCanvas))
+        wdDrawPolylineStyled(hCanvas, hBrush, pPoints, uCount, fStrokeWidth, NULL);
+    else
+        wd_draw_polyline(hCanvas, hBrush, pPoints, uCount, fStrokeWidth, NULL);
+
+    wd_decimate_fini(&d);
 }
@@ -22,50 +22,232 @@
  */
 
 #include "misc.h"
+#include "backend-ops.h"
 #include "backend-d2d.h"
 #include "backend-gdix.h"
+#include "backend-sw.h"
+#include "canvas.h"
+#include "capture.h"
+#include "dlist.h"
 #include "lock.h"
+#include "path.h"
 
 
 void
 wdFillEllipse(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, float cx, float cy, float rx, float ry)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_FILLELLIPSE);
+        wd_dlist_h(hBrush);
+        wd_dlist_f(cx);
+        wd_dlist_f(cy);
+        wd_dlist_f(rx);
+        wd_dlist_f(ry);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_FILLELLIPSE);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_f(cx);
+        wd_capture_f(cy);
+        wd_capture_f(rx);
+        wd_capture_f(ry);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_ELLIPSE);
+
+    if(wd_cull(hCanvas, cx - rx, cy - ry, cx + rx, cy + ry, 0.0f))
+        return;
+
+    WD_EVENT_BEGIN("wdFillEllipse");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnFillEllipse(c->canvas, (void*) hBrush, cx, cy, rx, ry);
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
         dummy_D2D1_ELLIPSE e = { { cx, cy }, rx, ry };
 
+        d2d_sync_transform(c);
         dummy_ID2D1RenderTarget_FillEllipse(c->target, &e, b);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
         float dx = 2.0f * rx;
         float dy = 2.0f * ry;
 
+        gdix_sync_transform(c);
         gdix_vtable->fn_FillEllipse(c->graphics, (void*) hBrush, cx - rx, cy - ry, dx, dy);
     }
+
+    WD_EVENT_END("wdFillEllipse");
 }
 
 void
 wdFillPath(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, const WD_HPATH hPath)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_FILLPATH);
+        wd_dlist_h(hBrush);
+        wd_dlist_h(hPath);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_FILLPATH);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_h(hPath);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_PATH);
+
+    WD_EVENT_BEGIN("wdFillPath");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnFillPath(c->canvas, (void*) hBrush, wd_path_backend(hPath));
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        dummy_ID2D1Geometry* g = (dummy_ID2D1Geometry*) wd_path_backend(hPath);
+        dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
+
+        d2d_sync_transform(c);
+        dummy_ID2D1RenderTarget_FillGeometry(c->target, g, b, NULL);
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+
+        gdix_sync_transform(c);
+        gdix_vtable->fn_FillPath(c->graphics, (void*) hBrush, wd_path_backend(hPath));
+    }
+
+    WD_EVENT_END("wdFillPath");
+}
+
+/* Whether the world transformation m differs from the one r of a realized
+ * fill only by a translation of whole device pixels, and by how much. */
+static BOOL
+wd_realized_offset(const WD_MATRIX* m, const WD_MATRIX* r, int* dx, int* dy)
+{
+    float fx = m->dx - r->dx;
+    float fy = m->dy - r->dy;
+
+    if(m->m11 != r->m11  ||  m->m12 != r->m12  ||  m->m21 != r->m21  ||  m->m22 != r->m22)
+        return FALSE;
+    if(!(WD_ABS(fx) < 1e6f  &&  WD_ABS(fy) < 1e6f))
+        return FALSE;
+
+    *dx = (int) floorf(fx + 0.5f);
+    *dy = (int) floorf(fy + 0.5f);
+    return (WD_ABS(fx - (float) *dx) < (1.0f / 256.0f)  &&
+            WD_ABS(fy - (float) *dy) < (1.0f / 256.0f));
+}
+
+void
+wdFillRealizedPath(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, WD_HREALIZEDFILL hFill)
+{
+    const wd_realized_t* r = (const wd_realized_t*) hFill;
+
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_FILLREALIZEDPATH);
+        wd_dlist_h(hBrush);
+        wd_dlist_h(hFill);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_FILLREALIZEDPATH);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_h(hFill);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_PATH);
+
+    if(wd_cull(hCanvas, r->bounds.x0, r->bounds.y0, r->bounds.x1, r->bounds.y1, 0.0f))
+        return;
+
+    WD_EVENT_BEGIN("wdFillRealizedPath");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        int dx, dy;
+
+        ops_sync_transform(c);
+        /* (Only the software back-end records the spans.) */
+        if(r->has_spans  &&  wd_realized_offset(&c->matrix, &r->matrix, &dx, &dy))
+            sw_canvas_fill_spans(c->canvas, (void*) hBrush, &r->spans, dx, dy);
+        else
+            wd_backend_ops->fnFillPath(c->canvas, (void*) hBrush, r->path->backend);
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
-        dummy_ID2D1Geometry* g = (dummy_ID2D1Geometry*) hPath;
+        dummy_ID2D1Geometry* g = (dummy_ID2D1Geometry*) r->path->backend;
         dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
 
+        d2d_sync_transform(c);
         dummy_ID2D1RenderTarget_FillGeometry(c->target, g, b, NULL);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
 
-        gdix_vtable->fn_FillPath(c->graphics, (void*) hBrush, (void*) hPath);
+        gdix_sync_transform(c);
+        gdix_vtable->fn_FillPath(c->graphics, (void*) hBrush, r->path->backend);
     }
+
+    WD_EVENT_END("wdFillRealizedPath");
 }
 
 void
 wdFillEllipsePie(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, float cx, float cy, float rx, float ry,
           float fBaseAngle, float fSweepAngle)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_FILLELLIPSEPIE);
+        wd_dlist_h(hBrush);
+        wd_dlist_f(cx);
+        wd_dlist_f(cy);
+        wd_dlist_f(rx);
+        wd_dlist_f(ry);
+        wd_dlist_f(fBaseAngle);
+        wd_dlist_f(fSweepAngle);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_FILLELLIPSEPIE);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_f(cx);
+        wd_capture_f(cy);
+        wd_capture_f(rx);
+        wd_capture_f(ry);
+        wd_capture_f(fBaseAngle);
+        wd_capture_f(fSweepAngle);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_PIE);
+
+    if(wd_cull(hCanvas, cx - rx, cy - ry, cx + rx, cy + ry, 0.0f))
+        return;
+
+    WD_EVENT_BEGIN("wdFillEllipsePie");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnFillEllipsePie(c->canvas, (void*) hBrush, cx, cy, rx, ry,
+                    fBaseAngle, fSweepAngle);
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
         dummy_ID2D1Geometry* g;
@@ -73,9 +255,12 @@ wdFillEllipsePie(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, float cx, float cy, float
         g = d2d_create_arc_geometry(cx, cy, rx, ry, fBaseAngle, fSweepAngle, TRUE);
         if(g == NULL) {
             WD_TRACE("wdFillPie: d2d_create_arc_geometry() failed.");
+            WD_EVENT_END("wdFillEllipsePie");
             return;
         }
+        c->stats.geometries++;
 
+        d2d_sync_transform(c);
         dummy_ID2D1RenderTarget_FillGeometry(c->target, g, b, NULL);
         dummy_ID2D1Geometry_Release(g);
     } else {
@@ -83,20 +268,57 @@ wdFillEllipsePie(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, float cx, float cy, float
         float dx = 2.0f * rx;
         float dy = 2.0f * ry;
 
+        gdix_sync_transform(c);
         gdix_vtable->fn_FillPie(c->graphics, (void*) hBrush,
                 cx - rx, cy - ry, dx, dy, fBaseAngle, fSweepAngle);
     }
+
+    WD_EVENT_END("wdFillEllipsePie");
 }
 
 void
 wdFillRect(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
            float x0, float y0, float x1, float y1)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_FILLRECT);
+        wd_dlist_h(hBrush);
+        wd_dlist_f(x0);
+        wd_dlist_f(y0);
+        wd_dlist_f(x1);
+        wd_dlist_f(y1);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_FILLRECT);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_f(x0);
+        wd_capture_f(y0);
+        wd_capture_f(x1);
+        wd_capture_f(y1);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_RECT);
+
+    if(wd_cull(hCanvas, x0, y0, x1, y1, 0.0f))
+        return;
+
+    WD_EVENT_BEGIN("wdFillRect");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnFillRect(c->canvas, (void*) hBrush, x0, y0, x1, y1);
+    } else if(d2d_enabled()) {
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
         dummy_D2D1_RECT_F r = { x0, y0, x1, y1 };
 
+        d2d_sync_transform(c);
         dummy_ID2D1RenderTarget_FillRectangle(c->target, &r, b);
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
@@ -106,8 +328,165 @@ wdFillRect(WD_HCANVAS hCanvas, WD_HBRUSH hBrush,
         if(x0 > x1) { tmp = x0; x0 = x1; x1 = tmp; }
         if(y0 > y1) { tmp = y0; y0 = y1; y1 = tmp; }
 
+        gdix_sync_transform(c);
         gdix_vtable->fn_FillRectangle(c->graphics, (void*) hBrush,
                 x0, y0, x1 - x0, y1 - y0);
     }
+
+    WD_EVENT_END("wdFillRect");
+}
+
+
+void
+wdFillRects(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, const WD_RECT* pRects, UINT uCount)
+{
+    UINT i;
+
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_FILLRECTS);
+        wd_dlist_h(hBrush);
+        wd_dlist_array(pRects, uCount, sizeof(WD_RECT));
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_FILLRECTS);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_u(uCount);
+        for(i = 0; i < uCount; i++)
+            wd_capture_rect(&pRects[i]);
+        wd_capture_end();
+    }
+
+    if(uCount == 0)
+        return;
+
+    WD_STATS_DRAWCALLS(hCanvas, WD_PRIMITIVE_RECT, uCount);
+
+    if(wd_cull_enabled(hCanvas)) {
+        WD_RECT b;
+
+        wd_bounds_rects(pRects, uCount, &b);
+        if(wd_cull(hCanvas, b.x0, b.y0, b.x1, b.y1, 0.0f))
+            return;
+    }
+
+    WD_EVENT_BEGIN("wdFillRects");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        for(i = 0; i < uCount; i++) {
+            wd_backend_ops->fnFillRect(c->canvas, (void*) hBrush,
+                        pRects[i].x0, pRects[i].y0, pRects[i].x1, pRects[i].y1);
+        }
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
+
+        /* D2D has no batch for this. (WD_RECT and D2D1_RECT_F are binary
+         * compatible.) */
+        d2d_sync_transform(c);
+        for(i = 0; i < uCount; i++) {
+            dummy_ID2D1RenderTarget_FillRectangle(c->target,
+                        (const dummy_D2D1_RECT_F*) &pRects[i], b);
+        }
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+        dummy_GpRectF gp_rects[GDIX_RECT_CHUNK];
+        UINT n;
+
+        gdix_sync_transform(c);
+        for(i = 0; i < uCount; i += n) {
+            n = WD_MIN(uCount - i, GDIX_RECT_CHUNK);
+            gdix_init_rects(gp_rects, pRects + i, n);
+            gdix_vtable->fn_FillRectangles(c->graphics, (void*) hBrush, gp_rects, (INT) n);
+        }
+    }
+
+    WD_EVENT_END("wdFillRects");
 }
 
+void
+wdFillEllipses(WD_HCANVAS hCanvas, WD_HBRUSH hBrush, const WD_ELLIPSE* pEllipses, UINT uCount)
+{
+    UINT i;
+
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_FILLELLIPSES);
+        wd_dlist_h(hBrush);
+        wd_dlist_array(pEllipses, uCount, sizeof(WD_ELLIPSE));
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_FILLELLIPSES);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hBrush);
+        wd_capture_u(uCount);
+        for(i = 0; i < uCount; i++) {
+            wd_capture_f(pEllipses[i].cx);
+            wd_capture_f(pEllipses[i].cy);
+            wd_capture_f(pEllipses[i].rx);
+            wd_capture_f(pEllipses[i].ry);
+        }
+        wd_capture_end();
+    }
+
+    if(uCount == 0)
+        return;
+
+    WD_STATS_DRAWCALLS(hCanvas, WD_PRIMITIVE_ELLIPSE, uCount);
+
+    if(wd_cull_enabled(hCanvas)) {
+        const WD_ELLIPSE* e = pEllipses;
+        WD_RECT b = { e->cx - e->rx, e->cy - e->ry, e->cx + e->rx, e->cy + e->ry };
+
+        for(i = 1; i < uCount; i++) {
+            e = &pEllipses[i];
+            b.x0 = WD_MIN(b.x0, e->cx - e->rx);
+            b.y0 = WD_MIN(b.y0, e->cy - e->ry);
+            b.x1 = WD_MAX(b.x1, e->cx + e->rx);
+            b.y1 = WD_MAX(b.y1, e->cy + e->ry);
+        }
+        if(wd_cull(hCanvas, b.x0, b.y0, b.x1, b.y1, 0.0f))
+            return;
+    }
+
+    WD_EVENT_BEGIN("wdFillEllipses");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+
+        ops_sync_transform(c);
+        for(i = 0; i < uCount; i++) {
+            wd_backend_ops->fnFillEllipse(c->canvas, (void*) hBrush,
+                        pEllipses[i].cx, pEllipses[i].cy, pEllipses[i].rx, pEllipses[i].ry);
+        }
+    } else if(d2d_enabled()) {
+        d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
+        dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
+
+        /* WD_ELLIPSE and D2D1_ELLIPSE are binary compatible. */
+        d2d_sync_transform(c);
+        for(i = 0; i < uCount; i++) {
+            dummy_ID2D1RenderTarget_FillEllipse(c->target,
+                        (const dummy_D2D1_ELLIPSE*) &pEllipses[i], b);
+        }
+    } else {
+        gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
+        dummy_GpBrush* b = (dummy_GpBrush*) hBrush;
+        const WD_ELLIPSE* e;
+
+        gdix_sync_transform(c);
+        for(i = 0; i < uCount; i++) {
+            e = &pEllipses[i];
+            gdix_vtable->fn_FillEllipse(c->graphics, b, e->cx - e->rx, e->cy - e->ry,
+                        2.0f * e->rx, 2.0f * e->ry);
+        }
+    }
+
+    WD_EVENT_END("wdFillEllipses");
+}
@@ -22,9 +22,12 @@
  */
 
 #include "misc.h"
+#include "backend-ops.h"
 #include "backend-d2d.h"
 #include "backend-dwrite.h"
 #include "backend-gdix.h"
+#include "capture.h"
+#include "dlist.h"
 #include "lock.h"
 
 static void
@@ -42,10 +45,19 @@ wd_get_default_gui_fontface(WCHAR buffer[LF_FACESIZE])
 }
 
 
-WD_HFONT
-wdCreateFont(const LOGFONTW* pLogFont)
+static WD_HFONT
+wdCreateFontImpl(const LOGFONTW* pLogFont)
 {
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        void* f;
+
+        f = wd_backend_ops->fnCreateFont(pLogFont);
+        if(f == NULL) {
+            WD_TRACE("wdCreateFont: WD_BACKEND_OPS::fnCreateFont(%S) failed.",
+                     pLogFont->lfFaceName);
+        }
+        return (WD_HFONT) f;
+    } else if(d2d_enabled()) {
         static WCHAR no_locale[] = L"";
         static WCHAR enus_locale[] = L"en-us";
 
@@ -127,6 +139,38 @@ wdCreateFont(const LOGFONTW* pLogFont)
     }
 }
 
+WD_HFONT
+wdCreateFont(const LOGFONTW* pLogFont)
+{
+    WD_HFONT f;
+
+    f = wdCreateFontImpl(pLogFont);
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_CREATEFONT);
+        wd_capture_h_new(f);
+        wd_capture_i(pLogFont->lfHeight);
+        wd_capture_i(pLogFont->lfWidth);
+        wd_capture_i(pLogFont->lfEscapement);
+        wd_capture_i(pLogFont->lfOrientation);
+        wd_capture_i(pLogFont->lfWeight);
+        wd_capture_u(pLogFont->lfItalic);
+        wd_capture_u(pLogFont->lfUnderline);
+        wd_capture_u(pLogFont->lfStrikeOut);
+        wd_capture_u(pLogFont->lfCharSet);
+        wd_capture_u(pLogFont->lfOutPrecision);
+        wd_capture_u(pLogFont->lfClipPrecision);
+        wd_capture_u(pLogFont->lfQuality);
+        wd_capture_u(pLogFont->lfPitchAndFamily);
+        wd_capture_str(pLogFont->lfFaceName,
+                       (int) wcsnlen(pLogFont->lfFaceName, LF_FACESIZE));
+        wd_capture_end();
+    }
+
+    return f;
+}
+
+/* Captured as the wdCreateFont() it makes. */
 WD_HFONT
 wdCreateFontWithGdiHandle(HFONT hGdiFont)
 {
@@ -139,10 +183,12 @@ wdCreateFontWithGdiHandle(HFONT hGdiFont)
     return wdCreateFont(&lf);
 }
 
-void
-wdDestroyFont(WD_HFONT hFont)
+static void
+wdDestroyFontImpl(void* hFont)
 {
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        wd_backend_ops->fnDestroyFont(hFont);
+    } else if(d2d_enabled()) {
         dwrite_font_t* font = (dwrite_font_t*) hFont;
 
         dummy_IDWriteTextFormat_Release(font->tf);
@@ -152,9 +198,29 @@ wdDestroyFont(WD_HFONT hFont)
     }
 }
 
+void
+wdDestroyFont(WD_HFONT hFont)
+{
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DESTROYFONT);
+        wd_capture_h_free(hFont);
+        wd_capture_end();
+    }
+
+    if(wd_dlist_defer_destroy(hFont, wdDestroyFontImpl))
+        return;
+    wdDestroyFontImpl((void*) hFont);
+}
+
 void
 wdFontMetrics(WD_HFONT hFont, WD_FONTMETRICS* pMetrics)
 {
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_FONTMETRICS);
+        wd_capture_h(hFont);
+        wd_capture_end();
+    }
+
     if(hFont == NULL) {
         /* Treat NULL as "no font". This simplifies paint code when font
          * creation fails. */
@@ -162,7 +228,9 @@ wdFontMetrics(WD_HFONT hFont, WD_FONTMETRICS* pMetrics)
         goto err;
     }
 
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        wd_backend_ops->fnFontMetrics((void*) hFont, pMetrics);
+    } else if(d2d_enabled()) {
         dwrite_font_t* font = (dwrite_font_t*) hFont;
         float factor;
 
@@ -22,23 +22,30 @@
  */
 
 #include "misc.h"
+#include "backend-ops.h"
 #include "backend-d2d.h"
 #include "backend-wic.h"
 #include "backend-gdix.h"
+#include "capture.h"
+#include "dlist.h"
 #include "lock.h"
 #include "memstream.h"
 
 
+/* Captured as the wdCreateImageFromHBITMAPWithAlpha() it makes. */
 WD_HIMAGE
 wdCreateImageFromHBITMAP(HBITMAP hBmp)
 {
     return wdCreateImageFromHBITMAPWithAlpha(hBmp, 0);
 }
 
-WD_HIMAGE
-wdCreateImageFromHBITMAPWithAlpha(HBITMAP hBmp, int alphaMode)
+static WD_HIMAGE
+wdCreateImageFromHBITMAPWithAlphaImpl(HBITMAP hBmp, int alphaMode)
 {
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        WD_TRACE("wdCreateImageFromHBITMAP: Not supported by the custom back-end.");
+        return NULL;
+    } else if(d2d_enabled()) {
         IWICBitmap* bitmap;
         IWICBitmapSource* converted_bitmap;
         WICBitmapAlphaChannelOption alpha_option;
@@ -95,9 +102,39 @@ wdCreateImageFromHBITMAPWithAlpha(HBITMAP hBmp, int alphaMode)
 }
 
 WD_HIMAGE
-wdLoadImageFromFile(const WCHAR* pszPath)
+wdCreateImageFromHBITMAPWithAlpha(HBITMAP hBmp, int alphaMode)
+{
+    WD_HIMAGE img;
+
+    img = wdCreateImageFromHBITMAPWithAlphaImpl(hBmp, alphaMode);
+
+    /* The bitmap is captured as its pixels. */
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_IMAGEFROMBUFFER);
+        wd_capture_h_new(img);
+        wd_capture_hbitmap(hBmp, alphaMode);
+        wd_capture_end();
+    }
+
+    return img;
+}
+
+static WD_HIMAGE
+wdLoadImageFromFileImpl(const WCHAR* pszPath)
 {
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        void* img;
+
+        if(wd_backend_ops->fnLoadImageFromFile == NULL) {
+            WD_TRACE("wdLoadImageFromFile: Not supported by the custom back-end.");
+            return NULL;
+        }
+
+        img = wd_backend_ops->fnLoadImageFromFile(pszPath);
+        if(img == NULL)
+            WD_TRACE("wdLoadImageFromFile: WD_BACKEND_OPS::fnLoadImageFromFile() failed.");
+        return (WD_HIMAGE) img;
+    } else if(d2d_enabled()) {
         IWICBitmapDecoder* decoder;
         IWICBitmapFrameDecode* bitmap;
         IWICBitmapSource* converted_bitmap = NULL;
@@ -148,9 +185,43 @@ err_CreateDecoderFromFilename:
 }
 
 WD_HIMAGE
-wdLoadImageFromIStream(IStream* pStream)
+wdLoadImageFromFile(const WCHAR* pszPath)
+{
+    WD_HIMAGE img;
+
+    img = wdLoadImageFromFileImpl(pszPath);
+
+    if(WD_CAPTURE_ACTIVE()) {
+        BYTE* data;
+        size_t size;
+
+        data = wd_capture_read_file(pszPath, &size);
+        wd_capture_begin(WD_CAP_IMAGEFROMENCODED);
+        wd_capture_h_new(img);
+        wd_capture_blob(data, size);
+        wd_capture_end();
+        free(data);
+    }
+
+    return img;
+}
+
+static WD_HIMAGE
+wdLoadImageFromIStreamImpl(IStream* pStream)
 {
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        void* img;
+
+        if(wd_backend_ops->fnLoadImageFromIStream == NULL) {
+            WD_TRACE("wdLoadImageFromIStream: Not supported by the custom back-end.");
+            return NULL;
+        }
+
+        img = wd_backend_ops->fnLoadImageFromIStream(pStream);
+        if(img == NULL)
+            WD_TRACE("wdLoadImageFromIStream: WD_BACKEND_OPS::fnLoadImageFromIStream() failed.");
+        return (WD_HIMAGE) img;
+    } else if(d2d_enabled()) {
         IWICBitmapDecoder* decoder;
         IWICBitmapFrameDecode* bitmap;
         IWICBitmapSource* converted_bitmap = NULL;
@@ -200,6 +271,32 @@ err_CreateDecoderFromFilename:
     }
 }
 
+WD_HIMAGE
+wdLoadImageFromIStream(IStream* pStream)
+{
+    WD_HIMAGE img;
+    BYTE* data = NULL;
+    size_t size = 0;
+    BOOL capture = WD_CAPTURE_ACTIVE();
+
+    /* Read the stream before the decoder consumes it. */
+    if(capture)
+        data = wd_capture_read_stream(pStream, &size);
+
+    img = wdLoadImageFromIStreamImpl(pStream);
+
+    if(capture) {
+        wd_capture_begin(WD_CAP_IMAGEFROMENCODED);
+        wd_capture_h_new(img);
+        wd_capture_blob(data, size);
+        wd_capture_end();
+        free(data);
+    }
+
+    return img;
+}
+
+/* Captured as the wdLoadImageFromIStream() it makes. */
 WD_HIMAGE
 wdLoadImageFromResource(HINSTANCE hInstance, const WCHAR* pszResType,
                         const WCHAR* pszResName)
@@ -223,20 +320,44 @@ wdLoadImageFromResource(HINSTANCE hInstance, const WCHAR* pszResType,
     return img;
 }
 
-void
-wdDestroyImage(WD_HIMAGE hImage)
+static void
+wdDestroyImageImpl(void* hImage)
 {
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        wd_backend_ops->fnDestroyImage(hImage);
+    } else if(d2d_enabled()) {
         IWICBitmapSource_Release((IWICBitmapSource*) hImage);
     } else {
         gdix_vtable->fn_DisposeImage((dummy_GpImage*) hImage);
     }
 }
 
+void
+wdDestroyImage(WD_HIMAGE hImage)
+{
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DESTROYIMAGE);
+        wd_capture_h_free(hImage);
+        wd_capture_end();
+    }
+
+    if(wd_dlist_defer_destroy(hImage, wdDestroyImageImpl))
+        return;
+    wdDestroyImageImpl((void*) hImage);
+}
+
 void
 wdGetImageSize(WD_HIMAGE hImage, UINT* puWidth, UINT* puHeight)
 {
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        UINT w, h;
+
+        wd_backend_ops->fnGetImageSize((void*) hImage, &w, &h);
+        if(puWidth != NULL)
+            *puWidth = w;
+        if(puHeight != NULL)
+            *puHeight = h;
+    } else if(d2d_enabled()) {
         UINT w, h;
 
         IWICBitmapSource_GetSize((IWICBitmapSource*) hImage, &w, &h);
@@ -342,8 +463,8 @@ colormap_buffer_to_bitmap_data(UINT width, UINT height,
     }
 }
 
-WD_HIMAGE
-wdCreateImageFromBuffer(UINT uWidth, UINT uHeight, UINT srcStride, const BYTE* pBuffer,
+static WD_HIMAGE
+wdCreateImageFromBufferImpl(UINT uWidth, UINT uHeight, UINT srcStride, const BYTE* pBuffer,
                         int pixelFormat, const COLORREF* cPalette, UINT uPaletteSize)
 {
     WD_HIMAGE b = NULL;
@@ -352,7 +473,15 @@ wdCreateImageFromBuffer(UINT uWidth, UINT uHeight, UINT srcStride, const BYTE* p
     IWICBitmapLock *bitmap_lock = NULL;
     dummy_GpBitmapData bitmapData;
 
-    if (d2d_enabled()) {
+    if(ops_enabled()) {
+        /* Convert into a temporary buffer the back-end makes its copy of. */
+        dstStride = uWidth * 4;
+        scan0 = (BYTE*) malloc((size_t) dstStride * uHeight);
+        if(scan0 == NULL) {
+            WD_TRACE("wdCreateImageFromBuffer: malloc() failed.");
+            return NULL;
+        }
+    } else if (d2d_enabled()) {
         IWICBitmap* bitmap = NULL;
         HRESULT hr;
         WICRect rect = { 0, 0, uWidth, uHeight };
@@ -390,8 +519,10 @@ wdCreateImageFromBuffer(UINT uWidth, UINT uHeight, UINT srcStride, const BYTE* p
         dummy_GpBitmap *bitmap = NULL;
         dummy_GpRectI rect = { 0, 0, uWidth, uHeight };
 
+        /* The conversion below always writes 4 bytes per pixel, so the
+         * opaque formats have to use 32bppRGB rather than 24bppRGB. */
         if (pixelFormat == WD_PIXELFORMAT_R8G8B8 || pixelFormat == WD_PIXELFORMAT_PALETTE)
-            format = dummy_PixelFormat24bppRGB;
+            format = dummy_PixelFormat32bppRGB;
         else if (pixelFormat == WD_PIXELFORMAT_R8G8B8A8)
             format = dummy_PixelFormat32bppARGB;
         else
@@ -441,7 +572,12 @@ wdCreateImageFromBuffer(UINT uWidth, UINT uHeight, UINT srcStride, const BYTE* p
             break;
     }
 
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        b = (WD_HIMAGE) wd_backend_ops->fnCreateImage(uWidth, uHeight, dstStride, scan0);
+        if(b == NULL)
+            WD_TRACE("wdCreateImageFromBuffer: WD_BACKEND_OPS::fnCreateImage() failed.");
+        free(scan0);
+    } else if(d2d_enabled()) {
         IWICBitmapLock_Release(bitmap_lock);
     } else {
         gdix_vtable->fn_BitmapUnlockBits((dummy_GpBitmap*) b, &bitmapData);
@@ -449,3 +585,41 @@ wdCreateImageFromBuffer(UINT uWidth, UINT uHeight, UINT srcStride, const BYTE* p
 
     return b;
 }
+
+WD_HIMAGE
+wdCreateImageFromBuffer(UINT uWidth, UINT uHeight, UINT srcStride, const BYTE* pBuffer,
+                        int pixelFormat, const COLORREF* cPalette, UINT uPaletteSize)
+{
+    WD_HIMAGE img;
+
+    img = wdCreateImageFromBufferImpl(uWidth, uHeight, srcStride, pBuffer,
+                        pixelFormat, cPalette, uPaletteSize);
+
+    if(WD_CAPTURE_ACTIVE()) {
+        UINT bytes_per_pixel;
+        size_t size = 0;
+        UINT i;
+
+        switch(pixelFormat) {
+            case WD_PIXELFORMAT_PALETTE:    bytes_per_pixel = 1; break;
+            case WD_PIXELFORMAT_R8G8B8:     bytes_per_pixel = 3; break;
+            default:                        bytes_per_pixel = 4; break;
+        }
+        if(uHeight > 0)
+            size = (size_t) srcStride * (uHeight - 1) + (size_t) uWidth * bytes_per_pixel;
+
+        wd_capture_begin(WD_CAP_IMAGEFROMBUFFER);
+        wd_capture_h_new(img);
+        wd_capture_u(uWidth);
+        wd_capture_u(uHeight);
+        wd_capture_u(srcStride);
+        wd_capture_u(pixelFormat);
+        wd_capture_blob(pBuffer, size);
+        wd_capture_u(cPalette != NULL ? uPaletteSize : 0);
+        for(i = 0; cPalette != NULL  &&  i < uPaletteSize; i++)
+            wd_capture_c(cPalette[i]);
+        wd_capture_end();
+    }
+
+    return img;
+}
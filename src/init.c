@@ -1,20 +1,311 @@
 #include "misc.h"
+#include "backend-ops.h"
+#include "backend-sw.h"
 #include "backend-d2d.h"
 #include "backend-dwrite.h"
 #include "backend-wic.h"
 #include "backend-gdix.h"
+#include "canvas.h"
 #include "lock.h"
+#include "stats.h"
+
+
+void (*wd_fn_lock)(void) = NULL;
+void (*wd_fn_unlock)(void) = NULL;
+
+wd_lock_stat_t wd_lock_stats[WD_LOCKSITE_COUNT];
+WD_THREAD_LOCAL wd_lock_stat_t wd_lock_thread_stats;
+
+static DWORD wd_preinit_flags = 0;
+
+#if !defined WD_D2D_ONLY  &&  !defined WD_GDIPLUS_ONLY
+/* Custom back-end to be installed by wd_init_core_api() (see
+ * wdInitializeWithBackend()). */
+static const WD_BACKEND_OPS* wd_pending_ops = NULL;
+#endif
+
+
+void
+wdPreInitialize(void (*fnLock)(void), void (*fnUnlock)(void), DWORD dwFlags)
+{
+    wd_fn_lock = fnLock;
+    wd_fn_unlock = fnUnlock;
+    wd_preinit_flags = dwFlags;
+}
+
+
+static int
+wd_init_core_api(void)
+{
+#if defined WD_D2D_ONLY  ||  defined WD_GDIPLUS_ONLY
+    if(wd_preinit_flags & WD_USE_SOFTWARE) {
+        WD_TRACE("wd_init_core_api: WD_USE_SOFTWARE not supported by single back-end build.");
+        return -1;
+    }
+#else
+    if(wd_pending_ops != NULL)
+        return ops_init(wd_pending_ops);
+    if(wd_preinit_flags & WD_USE_SOFTWARE)
+        return ops_init(&sw_backend_ops);
+#endif
+
+#ifndef WD_GDIPLUS_ONLY
+    if(!(wd_preinit_flags & WD_DISABLE_D2D)) {
+        if(d2d_init(wd_preinit_flags) == 0)
+            return 0;
+    }
+#endif
+
+#ifndef WD_D2D_ONLY
+    if(!(wd_preinit_flags & WD_DISABLE_GDIPLUS)) {
+        if(gdix_init() == 0)
+            return 0;
+    }
+#endif
+
+    WD_TRACE("wd_init_core_api: No back-end available.");
+    return -1;
+}
+
+static void
+wd_fini_core_api(void)
+{
+    wd_canvas_cache_fini();
+
+    if(ops_enabled())
+        ops_fini();
+    else if(d2d_enabled())
+        d2d_fini();
+    else
+        gdix_fini();
+}
+
+static int
+wd_init_image_api(void)
+{
+    /* GDI+ and custom back-ends have their own image API. */
+    if(ops_enabled()  ||  !d2d_enabled())
+        return 0;
+
+    return wic_init();
+}
+
+static void
+wd_fini_image_api(void)
+{
+    if(!ops_enabled()  &&  d2d_enabled())
+        wic_fini();
+}
+
+static int
+wd_init_string_api(void)
+{
+    /* GDI+ and custom back-ends have their own string API. */
+    if(ops_enabled()  ||  !d2d_enabled())
+        return 0;
+
+    return dwrite_init();
+}
+
+static void
+wd_fini_string_api(void)
+{
+    if(!ops_enabled()  &&  d2d_enabled())
+        dwrite_fini();
+}
+
+
+static const struct {
+    int (*fn_init)(void);
+    void (*fn_fini)(void);
+} wd_modules[] = {
+    { wd_init_core_api,     wd_fini_core_api },
+    { wd_init_image_api,    wd_fini_image_api },
+    { wd_init_string_api,   wd_fini_string_api }
+};
+
+#define WD_MOD_COUNT        WD_SIZEOF_ARRAY(wd_modules)
+
+#define WD_MOD_COREAPI      0
+#define WD_MOD_IMAGEAPI     1
+#define WD_MOD_STRINGAPI    2
+
+static UINT wd_init_counter[WD_MOD_COUNT] = { 0 };
+
+
+static void
+wd_want_modules(DWORD flags, BOOL want[WD_MOD_COUNT])
+{
+    want[WD_MOD_COREAPI] = TRUE;
+    want[WD_MOD_IMAGEAPI] = (flags & WD_INIT_IMAGEAPI) ? TRUE : FALSE;
+    want[WD_MOD_STRINGAPI] = (flags & WD_INIT_STRINGAPI) ? TRUE : FALSE;
+}
+
+/* Has to be called with the lock held. */
+static BOOL
+wd_initialize_locked(DWORD dwFlags)
+{
+    BOOL want[WD_MOD_COUNT];
+    int i;
+
+    wd_want_modules(dwFlags, want);
+
+    for(i = 0; i < (int) WD_MOD_COUNT; i++) {
+        if(!want[i])
+            continue;
+
+        if(wd_init_counter[i] == 0) {
+            if(wd_modules[i].fn_init() != 0)
+                goto fail;
+        }
+        wd_init_counter[i]++;
+    }
+
+    return TRUE;
+
+fail:
+    /* Undo initializations made by this call. */
+    while(--i >= 0) {
+        if(!want[i])
+            continue;
+
+        wd_init_counter[i]--;
+        if(wd_init_counter[i] == 0)
+            wd_modules[i].fn_fini();
+    }
+
+    return FALSE;
+}
+
+BOOL
+wdInitialize(DWORD dwFlags)
+{
+    BOOL ret;
+
+    wd_lock(WD_LOCKSITE_INIT);
+    ret = wd_initialize_locked(dwFlags);
+    wd_unlock();
+    return ret;
+}
+
+BOOL
+wdInitializeWithBackend(const WD_BACKEND_OPS* pOps)
+{
+#if defined WD_D2D_ONLY  ||  defined WD_GDIPLUS_ONLY
+    WD_TRACE("wdInitializeWithBackend: Not supported by single back-end build.");
+    return FALSE;
+#else
+    BOOL ret;
+
+    if(pOps == NULL  ||  pOps->cbSize < sizeof(WD_BACKEND_OPS)) {
+        WD_TRACE("wdInitializeWithBackend: Invalid pOps.");
+        return FALSE;
+    }
+
+    wd_lock(WD_LOCKSITE_INIT);
+
+    /* Only one back-end may be in use at a time. */
+    if(wd_init_counter[WD_MOD_COREAPI] > 0  &&  wd_backend_ops != pOps) {
+        WD_TRACE("wdInitializeWithBackend: Already initialized with another back-end.");
+        wd_unlock();
+        return FALSE;
+    }
+
+    wd_pending_ops = pOps;
+    ret = wd_initialize_locked(WD_INIT_COREAPI);
+    wd_pending_ops = NULL;
+
+    wd_unlock();
+    return ret;
+#endif
+}
+
+void
+wdTerminate(DWORD dwFlags)
+{
+    BOOL want[WD_MOD_COUNT];
+    int i;
+
+    wd_want_modules(dwFlags, want);
+
+    wd_lock(WD_LOCKSITE_INIT);
+
+    /* Terminate in the reverse order as the core has to go last. */
+    for(i = (int) WD_MOD_COUNT - 1; i >= 0; i--) {
+        if(!want[i]  ||  wd_init_counter[i] == 0)
+            continue;
+
+        wd_init_counter[i]--;
+        if(wd_init_counter[i] == 0)
+            wd_modules[i].fn_fini();
+    }
+
+    wd_unlock();
+}
+
 
 int
 wdBackend(void)
 {
-    if(d2d_enabled()) {
+    if(sw_enabled())
+        return WD_BACKEND_SOFTWARE;
+    if(ops_enabled())
+        return WD_BACKEND_CUSTOM;
+
+    /* Not d2d_enabled(): that is constant in single back-end builds. */
+#ifndef WD_GDIPLUS_ONLY
+    if(d2d_factory != NULL) {
         return WD_BACKEND_D2D;
-    } 
-    
+    }
+#endif
+
+#ifndef WD_D2D_ONLY
     if(gdix_enabled()) {
         return WD_BACKEND_GDIPLUS;
     }
-    
+#endif
+
   return -1;
 }
+
+
+UINT64
+wd_ticks_to_us(UINT64 ticks)
+{
+    static UINT64 freq = 0;
+
+    if(freq == 0) {
+        LARGE_INTEGER f;
+
+        QueryPerformanceFrequency(&f);
+        freq = (UINT64) f.QuadPart;
+    }
+
+    /* Split to avoid overflow for long waits. */
+    return (ticks / freq) * 1000000 + ((ticks % freq) * 1000000) / freq;
+}
+
+void
+wdGetLockStats(UINT uSite, WD_LOCKSTATS* pStats)
+{
+    if(uSite >= WD_LOCKSITE_COUNT) {
+        WD_TRACE("wdGetLockStats: Invalid uSite.");
+        memset(pStats, 0, sizeof(WD_LOCKSTATS));
+        return;
+    }
+
+    if(wd_fn_lock != NULL)
+        wd_fn_lock();
+    pStats->uAcquisitions = wd_lock_stats[uSite].acquisitions;
+    pStats->uWaitMicroseconds = wd_ticks_to_us(wd_lock_stats[uSite].wait_ticks);
+    wd_unlock();
+}
+
+void
+wdResetLockStats(void)
+{
+    if(wd_fn_lock != NULL)
+        wd_fn_lock();
+    memset(wd_lock_stats, 0, sizeof(wd_lock_stats));
+    wd_unlock();
+}
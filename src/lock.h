@@ -31,11 +31,36 @@ extern void (*wd_fn_lock)(void);
 extern void (*wd_fn_unlock)(void);
 
 
+/* Per-site statistics for wdGetLockStats(). The counters are only updated
+ * while holding the lock so they need no further synchronization. */
+typedef struct wd_lock_stat_tag wd_lock_stat_t;
+struct wd_lock_stat_tag {
+    UINT64 acquisitions;
+    UINT64 wait_ticks;
+};
+
+extern wd_lock_stat_t wd_lock_stats[WD_LOCKSITE_COUNT];
+
+/* Totals of the calling thread, over all sites. Used to attribute the lock
+ * usage to the canvas painted by the thread (see wdGetCanvasStats()). */
+extern WD_THREAD_LOCAL wd_lock_stat_t wd_lock_thread_stats;
+
+
 static inline void
-wd_lock(void)
+wd_lock(int site)
 {
-    if(wd_fn_lock != NULL)
+    if(wd_fn_lock != NULL) {
+        LARGE_INTEGER t0, t1;
+
+        QueryPerformanceCounter(&t0);
         wd_fn_lock();
+        QueryPerformanceCounter(&t1);
+
+        wd_lock_stats[site].acquisitions++;
+        wd_lock_stats[site].wait_ticks += (UINT64) (t1.QuadPart - t0.QuadPart);
+        wd_lock_thread_stats.acquisitions++;
+        wd_lock_thread_stats.wait_ticks += (UINT64) (t1.QuadPart - t0.QuadPart);
+    }
 }
 
 static inline void
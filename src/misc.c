@@ -105,3 +105,122 @@ wd_load_system_dll(const TCHAR* dll_name)
 
     return dll;
 }
+
+void
+wd_matrix_mult(WD_MATRIX* res, const WD_MATRIX* a, const WD_MATRIX* b)
+{
+    WD_MATRIX tmp;
+
+    tmp.m11 = a->m11 * b->m11 + a->m12 * b->m21;
+    tmp.m12 = a->m11 * b->m12 + a->m12 * b->m22;
+    tmp.m21 = a->m21 * b->m11 + a->m22 * b->m21;
+    tmp.m22 = a->m21 * b->m12 + a->m22 * b->m22;
+    tmp.dx = a->dx * b->m11 + a->dy * b->m21 + b->dx;
+    tmp.dy = a->dx * b->m12 + a->dy * b->m22 + b->dy;
+    memcpy(res, &tmp, sizeof(WD_MATRIX));
+}
+
+BOOL
+wd_matrix_invert(const WD_MATRIX* m, WD_MATRIX* res)
+{
+    float det = m->m11 * m->m22 - m->m12 * m->m21;
+
+    if(WD_ABS(det) < 1e-12f)
+        return FALSE;
+
+    res->m11 = m->m22 / det;
+    res->m12 = -m->m12 / det;
+    res->m21 = -m->m21 / det;
+    res->m22 = m->m11 / det;
+    res->dx = (m->m21 * m->dy - m->m22 * m->dx) / det;
+    res->dy = (m->m12 * m->dx - m->m11 * m->dy) / det;
+    return TRUE;
+}
+
+void
+wd_bounds_transform(const WD_MATRIX* m, const WD_RECT* rect, WD_RECT* bounds)
+{
+    float x[4] = { rect->x0, rect->x1, rect->x0, rect->x1 };
+    float y[4] = { rect->y0, rect->y0, rect->y1, rect->y1 };
+    int i;
+
+    for(i = 0; i < 4; i++) {
+        float tx = x[i] * m->m11 + y[i] * m->m21 + m->dx;
+        float ty = x[i] * m->m12 + y[i] * m->m22 + m->dy;
+        x[i] = tx;
+        y[i] = ty;
+    }
+
+    bounds->x0 = WD_MIN(WD_MIN(x[0], x[1]), WD_MIN(x[2], x[3]));
+    bounds->y0 = WD_MIN(WD_MIN(y[0], y[1]), WD_MIN(y[2], y[3]));
+    bounds->x1 = WD_MAX(WD_MAX(x[0], x[1]), WD_MAX(x[2], x[3]));
+    bounds->y1 = WD_MAX(WD_MAX(y[0], y[1]), WD_MAX(y[2], y[3]));
+}
+
+void
+wd_bounds_rects(const WD_RECT* rects, UINT count, WD_RECT* bounds)
+{
+    UINT i;
+
+    bounds->x0 = WD_MIN(rects[0].x0, rects[0].x1);
+    bounds->y0 = WD_MIN(rects[0].y0, rects[0].y1);
+    bounds->x1 = WD_MAX(rects[0].x0, rects[0].x1);
+    bounds->y1 = WD_MAX(rects[0].y0, rects[0].y1);
+
+    for(i = 1; i < count; i++) {
+        bounds->x0 = WD_MIN(bounds->x0, WD_MIN(rects[i].x0, rects[i].x1));
+        bounds->y0 = WD_MIN(bounds->y0, WD_MIN(rects[i].y0, rects[i].y1));
+        bounds->x1 = WD_MAX(bounds->x1, WD_MAX(rects[i].x0, rects[i].x1));
+        bounds->y1 = WD_MAX(bounds->y1, WD_MAX(rects[i].y0, rects[i].y1));
+    }
+}
+
+void
+wd_bounds_points(const WD_POINT* points, UINT count, WD_RECT* bounds)
+{
+    UINT i;
+
+    bounds->x0 = points[0].x;
+    bounds->y0 = points[0].y;
+    bounds->x1 = points[0].x;
+    bounds->y1 = points[0].y;
+
+    for(i = 1; i < count; i++) {
+        bounds->x0 = WD_MIN(bounds->x0, points[i].x);
+        bounds->y0 = WD_MIN(bounds->y0, points[i].y);
+        bounds->x1 = WD_MAX(bounds->x1, points[i].x);
+        bounds->y1 = WD_MAX(bounds->y1, points[i].y);
+    }
+}
+
+void
+wd_bounds_intersect(WD_RECT* res, const WD_RECT* a, const WD_RECT* b)
+{
+    res->x0 = WD_MAX(a->x0, b->x0);
+    res->y0 = WD_MAX(a->y0, b->y0);
+    res->x1 = WD_MIN(a->x1, b->x1);
+    res->y1 = WD_MIN(a->y1, b->y1);
+
+    if(res->x1 < res->x0)
+        res->x1 = res->x0;
+    if(res->y1 < res->y0)
+        res->y1 = res->y0;
+}
+
+BOOL
+wd_bounds_invisible(const WD_MATRIX* m, const WD_RECT* visible,
+                    float x0, float y0, float x1, float y1, float inflate)
+{
+    WD_RECT rect;
+    WD_RECT bounds;
+
+    rect.x0 = WD_MIN(x0, x1) - inflate;
+    rect.y0 = WD_MIN(y0, y1) - inflate;
+    rect.x1 = WD_MAX(x0, x1) + inflate;
+    rect.y1 = WD_MAX(y0, y1) + inflate;
+    wd_bounds_transform(m, &rect, &bounds);
+
+    /* Allow one more pixel for anti-aliasing. */
+    return (bounds.x1 + 1.0f <= visible->x0  ||  bounds.x0 - 1.0f >= visible->x1  ||
+            bounds.y1 + 1.0f <= visible->y0  ||  bounds.y0 - 1.0f >= visible->y1);
+}
@@ -32,6 +32,7 @@
 #include <malloc.h>
 
 #include "wdl.h"
+#include "trace.h"
 
 
 /***********************
@@ -77,6 +78,36 @@ static void no_log(const char* fmt, ...) {}
 /* Safer LoadLibrary() replacement for system DLLs. */
 HMODULE wd_load_system_dll(const TCHAR* dll_name);
 
+/* res = a * b (i.e. a is applied first). res may alias a or b. */
+void wd_matrix_mult(WD_MATRIX* res, const WD_MATRIX* a, const WD_MATRIX* b);
+
+/* Returns FALSE (leaving res untouched) if the matrix is singular. res must
+ * not alias m. */
+BOOL wd_matrix_invert(const WD_MATRIX* m, WD_MATRIX* res);
+
+/* Axis-aligned bounds of the rectangle transformed by the matrix. */
+void wd_bounds_transform(const WD_MATRIX* m, const WD_RECT* rect, WD_RECT* bounds);
+
+/* Bounds of the rectangles (which need not be normalized) or of the points.
+ * The count must not be zero. */
+void wd_bounds_rects(const WD_RECT* rects, UINT count, WD_RECT* bounds);
+void wd_bounds_points(const WD_POINT* points, UINT count, WD_RECT* bounds);
+
+/* Intersection of two bounds. Empty result is normalized to zero size. */
+void wd_bounds_intersect(WD_RECT* res, const WD_RECT* a, const WD_RECT* b);
+
+/* Returns TRUE if the rectangle (in world coordinates, inflated by the given
+ * amount) transformed by the matrix misses the visible bounds (in device
+ * coordinates). */
+BOOL wd_bounds_invisible(const WD_MATRIX* m, const WD_RECT* visible,
+                         float x0, float y0, float x1, float y1, float inflate);
+
+
+#ifdef _MSC_VER
+    #define WD_THREAD_LOCAL     __declspec(thread)
+#else
+    #define WD_THREAD_LOCAL     __thread
+#endif
 
 #ifdef _MSC_VER
     /* MSVC does not understand "inline" when building as pure C (not C++).
@@ -22,42 +22,159 @@
  */
 
 #include "misc.h"
+#include "backend-ops.h"
 #include "backend-d2d.h"
 #include "backend-gdix.h"
+#include "backend-sw.h"
+#include "canvas.h"
+#include "capture.h"
+#include "dlist.h"
 #include "lock.h"
+#include "path.h"
+#include "strokestyle.h"
 
 
-WD_HPATH
-wdCreatePath(WD_HCANVAS hCanvas)
+/* With D2D, the fill mode is set when the sink gets opened. */
+static void*
+wdCreatePathImpl(WD_HCANVAS hCanvas, UINT fill_mode)
 {
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        void* p;
+
+        p = wd_backend_ops->fnCreatePath(ops_canvas(hCanvas));
+        if(p == NULL) {
+            WD_TRACE("wdCreatePath: WD_BACKEND_OPS::fnCreatePath() failed.");
+            return NULL;
+        }
+
+        if(fill_mode == WD_FILL_WINDING) {
+            if(wd_backend_ops->fnSetPathFillMode != NULL)
+                wd_backend_ops->fnSetPathFillMode(p, fill_mode);
+            else
+                WD_TRACE("wdCreatePath: Fill mode not supported by the back-end.");
+        }
+
+        if(hCanvas != NULL)
+            ((ops_canvas_t*) hCanvas)->stats.geometries++;
+        return p;
+    } else if(d2d_enabled()) {
+        dummy_ID2D1Factory* factory;
         dummy_ID2D1PathGeometry* g;
         HRESULT hr;
 
-        wd_lock();
-        hr = dummy_ID2D1Factory_CreatePathGeometry(d2d_factory, &g);
-        wd_unlock();
+        WD_EVENT_BEGIN("ID2D1Factory::CreatePathGeometry");
+        factory = d2d_lock_factory(WD_LOCKSITE_CREATEPATHGEOMETRY);
+        hr = dummy_ID2D1Factory_CreatePathGeometry(factory, &g);
+        d2d_unlock_factory();
+        WD_EVENT_END("ID2D1Factory::CreatePathGeometry");
         if(FAILED(hr)) {
             WD_TRACE_HR("wdCreatePath: "
                         "ID2D1Factory::CreatePathGeometry() failed.");
             return NULL;
         }
 
-        return (WD_HPATH) g;
+        if(hCanvas != NULL)
+            ((d2d_canvas_t*) hCanvas)->stats.geometries++;
+        return (void*) g;
     } else {
         dummy_GpPath* p;
         int status;
 
-        status = gdix_vtable->fn_CreatePath(dummy_FillModeAlternate, &p);
+        status = gdix_vtable->fn_CreatePath((fill_mode == WD_FILL_WINDING ?
+                    dummy_FillModeWinding : dummy_FillModeAlternate), &p);
         if(status != 0) {
             WD_TRACE("wdCreatePath: GdipCreatePath() failed. [%d]", status);
             return NULL;
         }
 
-        return (WD_HPATH) p;
+        if(hCanvas != NULL)
+            ((gdix_canvas_t*) hCanvas)->stats.geometries++;
+        return p;
+    }
+}
+
+static void
+wdDestroyPathImpl(void* backend)
+{
+    if(ops_enabled()) {
+        wd_backend_ops->fnDestroyPath(backend);
+    } else if(d2d_enabled()) {
+        dummy_ID2D1PathGeometry_Release((dummy_ID2D1PathGeometry*) backend);
+    } else {
+        gdix_vtable->fn_DeletePath((dummy_GpPath*) backend);
     }
 }
 
+static wd_path_t*
+wd_path_alloc(WD_HCANVAS hCanvas, UINT fill_mode, const char* func_name)
+{
+    wd_path_t* p;
+
+    p = (wd_path_t*) malloc(sizeof(wd_path_t));
+    if(p == NULL) {
+        WD_TRACE("%s: malloc() failed.", func_name);
+        return NULL;
+    }
+
+    p->backend = wdCreatePathImpl(hCanvas, fill_mode);
+    if(p->backend == NULL) {
+        free(p);
+        return NULL;
+    }
+
+    p->sink = NULL;
+    p->fill_mode = fill_mode;
+    sw_path_init(&p->retained);
+    sw_poly_init(&p->flat);
+    sw_poly_init(&p->outline);
+    p->flat_valid = FALSE;
+    p->outline_valid = FALSE;
+    return p;
+}
+
+static void
+wd_path_free(wd_path_t* p)
+{
+    wdDestroyPathImpl(p->backend);
+    sw_path_fini(&p->retained);
+    sw_poly_fini(&p->flat);
+    sw_poly_fini(&p->outline);
+    free(p);
+}
+
+/* Destructor for wd_dlist_defer_destroy(). */
+static void
+wd_path_destroy(void* p)
+{
+    wd_path_free((wd_path_t*) p);
+}
+
+static inline void
+wd_path_invalidate(wd_path_t* p)
+{
+    p->flat_valid = FALSE;
+    p->outline_valid = FALSE;
+}
+
+WD_HPATH
+wdCreatePath(WD_HCANVAS hCanvas)
+{
+    wd_path_t* p;
+
+    p = wd_path_alloc(hCanvas, WD_FILL_ALTERNATE, "wdCreatePath");
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_CREATEPATH);
+        wd_capture_h_new(p);
+        wd_capture_h(hCanvas);
+        wd_capture_end();
+    }
+
+    return (WD_HPATH) p;
+}
+
+/* Note the helpers below get captured as the path building calls they make. */
+
 WD_HPATH
 wdCreatePolygonPath(WD_HCANVAS hCanvas, const WD_POINT* pPoints, UINT uCount)
 {
@@ -71,7 +188,6 @@ wdCreatePolygonPath(WD_HCANVAS hCanvas, const WD_POINT* pPoints, UINT uCount)
 
     if(uCount > 0) {
         WD_PATHSINK sink;
-        UINT i;
 
         if(!wdOpenPathSink(&sink, p)) {
             WD_TRACE("wdCreatePolygonPath: wdOpenPathSink() failed.");
@@ -80,8 +196,7 @@ wdCreatePolygonPath(WD_HCANVAS hCanvas, const WD_POINT* pPoints, UINT uCount)
         }
 
         wdBeginFigure(&sink, pPoints[0].x, pPoints[0].y);
-        for(i = 1; i < uCount; i++)
-            wdAddLine(&sink, pPoints[i].x, pPoints[i].y);
+        wdAddLines(&sink, pPoints + 1, uCount - 1);
         wdEndFigure(&sink, TRUE);
 
         wdClosePathSink(&sink);
@@ -138,18 +253,37 @@ wdCreateRoundedRectPath(WD_HCANVAS hCanvas, const WD_RECT* prc, float r)
 void
 wdDestroyPath(WD_HPATH hPath)
 {
-    if(d2d_enabled()) {
-        dummy_ID2D1PathGeometry_Release((dummy_ID2D1PathGeometry*) hPath);
-    } else {
-        gdix_vtable->fn_DeletePath((dummy_GpPath*) hPath);
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DESTROYPATH);
+        wd_capture_h_free(hPath);
+        wd_capture_end();
     }
+
+    if(wd_dlist_defer_destroy(hPath, wd_path_destroy))
+        return;
+    wd_path_free((wd_path_t*) hPath);
 }
 
-BOOL
-wdOpenPathSink(WD_PATHSINK* pSink, WD_HPATH hPath)
+
+/* The xxxImpl() functions below only talk to the back-end: they do not capture
+ * nor retain anything. wd_path_build() uses them to feed retained commands to
+ * a new back-end path. */
+
+static BOOL
+wdOpenPathSinkImpl(WD_PATHSINK* pSink, wd_path_t* p)
 {
-    if(d2d_enabled()) {
-        dummy_ID2D1PathGeometry* g = (dummy_ID2D1PathGeometry*) hPath;
+    if(ops_enabled()) {
+        void* sink;
+
+        sink = wd_backend_ops->fnOpenPathSink(p->backend);
+        if(sink == NULL) {
+            WD_TRACE("wdOpenPathSink: WD_BACKEND_OPS::fnOpenPathSink() failed.");
+            return FALSE;
+        }
+
+        p->sink = sink;
+    } else if(d2d_enabled()) {
+        dummy_ID2D1PathGeometry* g = (dummy_ID2D1PathGeometry*) p->backend;
         dummy_ID2D1GeometrySink* s;
         HRESULT hr;
 
@@ -159,66 +293,281 @@ wdOpenPathSink(WD_PATHSINK* pSink, WD_HPATH hPath)
             return FALSE;
         }
 
-        pSink->pData = (void*) s;
-        return TRUE;
+        if(p->fill_mode == WD_FILL_WINDING)
+            dummy_ID2D1GeometrySink_SetFillMode(s, dummy_D2D1_FILL_MODE_WINDING);
+
+        p->sink = (void*) s;
     } else {
         /* GDI+ doesn't have any concept of path sink as Direct2D does, it
          * operates directly with the path object. */
-        pSink->pData = (void*) hPath;
-        return TRUE;
+        p->sink = NULL;
     }
+
+    pSink->pData = (void*) p;
+    pSink->ptEnd.x = 0.0f;
+    pSink->ptEnd.y = 0.0f;
+    return TRUE;
 }
 
-void
-wdClosePathSink(WD_PATHSINK* pSink)
+static void
+wdClosePathSinkImpl(WD_PATHSINK* pSink)
 {
-    if(d2d_enabled()) {
-        dummy_ID2D1GeometrySink* s = (dummy_ID2D1GeometrySink*) pSink->pData;
+    wd_path_t* p = (wd_path_t*) pSink->pData;
+
+    if(ops_enabled()) {
+        wd_backend_ops->fnClosePathSink(p->sink);
+    } else if(d2d_enabled()) {
+        dummy_ID2D1GeometrySink* s = (dummy_ID2D1GeometrySink*) p->sink;
         dummy_ID2D1GeometrySink_Close(s);
         dummy_ID2D1GeometrySink_Release(s);
     } else {
         /* noop */
     }
+
+    p->sink = NULL;
 }
 
-void
-wdBeginFigure(WD_PATHSINK* pSink, float x, float y)
+static void
+wdBeginFigureImpl(WD_PATHSINK* pSink, float x, float y)
 {
-    if(d2d_enabled()) {
-        dummy_ID2D1GeometrySink* s = (dummy_ID2D1GeometrySink*) pSink->pData;
+    wd_path_t* p = (wd_path_t*) pSink->pData;
+
+    if(ops_enabled()) {
+        wd_backend_ops->fnBeginFigure(p->sink, x, y);
+    } else if(d2d_enabled()) {
+        dummy_ID2D1GeometrySink* s = (dummy_ID2D1GeometrySink*) p->sink;
         dummy_D2D1_POINT_2F pt = { x, y };
 
         dummy_ID2D1GeometrySink_BeginFigure(s, pt, dummy_D2D1_FIGURE_BEGIN_FILLED);
     } else {
-        gdix_vtable->fn_StartPathFigure(pSink->pData);
+        gdix_vtable->fn_StartPathFigure((dummy_GpPath*) p->backend);
     }
 
     pSink->ptEnd.x = x;
     pSink->ptEnd.y = y;
 }
 
-void
-wdEndFigure(WD_PATHSINK* pSink, BOOL bCloseFigure)
+static void
+wdEndFigureImpl(WD_PATHSINK* pSink, BOOL bCloseFigure)
 {
-    if(d2d_enabled()) {
-        dummy_ID2D1GeometrySink_EndFigure((dummy_ID2D1GeometrySink*) pSink->pData,
+    wd_path_t* p = (wd_path_t*) pSink->pData;
+
+    if(ops_enabled()) {
+        wd_backend_ops->fnEndFigure(p->sink, bCloseFigure);
+    } else if(d2d_enabled()) {
+        dummy_ID2D1GeometrySink_EndFigure((dummy_ID2D1GeometrySink*) p->sink,
                 (bCloseFigure ? dummy_D2D1_FIGURE_END_CLOSED : dummy_D2D1_FIGURE_END_OPEN));
     } else {
         if(bCloseFigure)
-            gdix_vtable->fn_ClosePathFigure(pSink->pData);
+            gdix_vtable->fn_ClosePathFigure((dummy_GpPath*) p->backend);
+    }
+}
+
+/* GDI+ has no notion of a current point: each GdipAddPathLine2() or
+ * GdipAddPathBeziers() call has to begin with the point where the previous
+ * segment has ended. */
+static void
+gdix_add_path_points(WD_PATHSINK* pSink, const WD_POINT* pPoints, UINT uCount,
+                     int (WINAPI* fn_add)(dummy_GpPath*, const dummy_GpPointF*, INT))
+{
+    dummy_GpPath* path = (dummy_GpPath*) ((wd_path_t*) pSink->pData)->backend;
+    dummy_GpPointF gp_points[1 + GDIX_PATH_CHUNK];
+    UINT i, n;
+
+    gp_points[0].x = pSink->ptEnd.x;
+    gp_points[0].y = pSink->ptEnd.y;
+
+    /* (WD_POINT and GpPointF are binary compatible.) */
+    for(i = 0; i < uCount; i += n) {
+        n = WD_MIN(uCount - i, GDIX_PATH_CHUNK);
+        memcpy(gp_points + 1, pPoints + i, n * sizeof(dummy_GpPointF));
+        fn_add(path, gp_points, (INT) (n + 1));
+        gp_points[0] = gp_points[n];
+    }
+}
+
+static void
+wdAddLinesImpl(WD_PATHSINK* pSink, const WD_POINT* pPoints, UINT uCount)
+{
+    wd_path_t* p = (wd_path_t*) pSink->pData;
+    UINT i;
+
+    if(ops_enabled()) {
+        for(i = 0; i < uCount; i++)
+            wd_backend_ops->fnAddLine(p->sink, pPoints[i].x, pPoints[i].y);
+    } else if(d2d_enabled()) {
+        /* (WD_POINT and D2D1_POINT_2F are binary compatible.) */
+        dummy_ID2D1GeometrySink_AddLines((dummy_ID2D1GeometrySink*) p->sink,
+                    (const dummy_D2D1_POINT_2F*) pPoints, uCount);
+    } else {
+        gdix_add_path_points(pSink, pPoints, uCount, gdix_vtable->fn_AddPathLine2);
+    }
+
+    pSink->ptEnd = pPoints[uCount - 1];
+}
+
+static void
+wdAddBeziersImpl(WD_PATHSINK* pSink, const WD_POINT* pPoints, UINT uCount)
+{
+    wd_path_t* p = (wd_path_t*) pSink->pData;
+    UINT i;
+
+    if(ops_enabled()) {
+        const WD_POINT* pt;
+
+        for(i = 0; i < uCount; i++) {
+            pt = pPoints + 3 * i;
+            wd_backend_ops->fnAddBezier(p->sink,
+                        pt[0].x, pt[0].y, pt[1].x, pt[1].y, pt[2].x, pt[2].y);
+        }
+    } else if(d2d_enabled()) {
+        /* (D2D1_BEZIER_SEGMENT is just three D2D1_POINT_2F in a row.) */
+        dummy_ID2D1GeometrySink_AddBeziers((dummy_ID2D1GeometrySink*) p->sink,
+                    (const dummy_D2D1_BEZIER_SEGMENT*) pPoints, uCount);
+    } else {
+        gdix_add_path_points(pSink, pPoints, 3 * uCount, gdix_vtable->fn_AddPathBeziers);
     }
+
+    pSink->ptEnd = pPoints[3 * uCount - 1];
+}
+
+/* Feeds the commands into the (empty) back-end path. Runs of lines and curves
+ * go as one wdAddLinesImpl() or wdAddBeziersImpl() call. */
+static BOOL
+wd_path_build(wd_path_t* p, const sw_path_t* src)
+{
+    WD_PATHSINK sink;
+    const WD_POINT* pt = src->points;
+    BOOL open = FALSE;
+    UINT i, n;
+
+    if(!wdOpenPathSinkImpl(&sink, p))
+        return FALSE;
+
+    for(i = 0; i < src->cmd_count; i += n) {
+        n = 1;
+        switch(src->cmds[i]) {
+            case SW_CMD_MOVE:
+                if(open)
+                    wdEndFigureImpl(&sink, FALSE);
+                wdBeginFigureImpl(&sink, pt->x, pt->y);
+                pt++;
+                open = TRUE;
+                break;
+
+            case SW_CMD_LINE:
+                while(i + n < src->cmd_count  &&  src->cmds[i + n] == SW_CMD_LINE)
+                    n++;
+                wdAddLinesImpl(&sink, pt, n);
+                pt += n;
+                break;
+
+            case SW_CMD_CUBIC:
+                while(i + n < src->cmd_count  &&  src->cmds[i + n] == SW_CMD_CUBIC)
+                    n++;
+                wdAddBeziersImpl(&sink, pt, n);
+                pt += 3 * n;
+                break;
+
+            case SW_CMD_CLOSE:
+                if(open)
+                    wdEndFigureImpl(&sink, TRUE);
+                open = FALSE;
+                break;
+        }
+    }
+
+    if(open)
+        wdEndFigureImpl(&sink, FALSE);
+    wdClosePathSinkImpl(&sink);
+    return TRUE;
+}
+
+BOOL
+wdOpenPathSink(WD_PATHSINK* pSink, WD_HPATH hPath)
+{
+    BOOL ret;
+
+    wd_path_invalidate((wd_path_t*) hPath);
+    ret = wdOpenPathSinkImpl(pSink, (wd_path_t*) hPath);
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_OPENPATHSINK);
+        wd_capture_h_new(ret ? WD_CAPTURE_SINK(pSink) : NULL);
+        wd_capture_h(hPath);
+        wd_capture_end();
+    }
+
+    return ret;
+}
+
+void
+wdClosePathSink(WD_PATHSINK* pSink)
+{
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_CLOSEPATHSINK);
+        wd_capture_h_free(WD_CAPTURE_SINK(pSink));
+        wd_capture_end();
+    }
+
+    wd_path_invalidate((wd_path_t*) pSink->pData);
+    wdClosePathSinkImpl(pSink);
+}
+
+void
+wdBeginFigure(WD_PATHSINK* pSink, float x, float y)
+{
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_BEGINFIGURE);
+        wd_capture_h(WD_CAPTURE_SINK(pSink));
+        wd_capture_f(x);
+        wd_capture_f(y);
+        wd_capture_end();
+    }
+
+    sw_path_move_to(&((wd_path_t*) pSink->pData)->retained, x, y);
+    wdBeginFigureImpl(pSink, x, y);
+}
+
+void
+wdEndFigure(WD_PATHSINK* pSink, BOOL bCloseFigure)
+{
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_ENDFIGURE);
+        wd_capture_h(WD_CAPTURE_SINK(pSink));
+        wd_capture_u(bCloseFigure);
+        wd_capture_end();
+    }
+
+    if(bCloseFigure)
+        sw_path_close(&((wd_path_t*) pSink->pData)->retained);
+    wdEndFigureImpl(pSink, bCloseFigure);
 }
 
 void
 wdAddLine(WD_PATHSINK* pSink, float x, float y)
 {
-    if(d2d_enabled()) {
-        dummy_ID2D1GeometrySink* s = (dummy_ID2D1GeometrySink*) pSink->pData;
+    wd_path_t* p = (wd_path_t*) pSink->pData;
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_ADDLINE);
+        wd_capture_h(WD_CAPTURE_SINK(pSink));
+        wd_capture_f(x);
+        wd_capture_f(y);
+        wd_capture_end();
+    }
+
+    sw_path_line_to(&p->retained, x, y);
+
+    if(ops_enabled()) {
+        wd_backend_ops->fnAddLine(p->sink, x, y);
+    } else if(d2d_enabled()) {
+        dummy_ID2D1GeometrySink* s = (dummy_ID2D1GeometrySink*) p->sink;
         dummy_D2D1_POINT_2F pt = { x, y };
 
         dummy_ID2D1GeometrySink_AddLine(s, pt);
     } else {
-        gdix_vtable->fn_AddPathLine(pSink->pData,
+        gdix_vtable->fn_AddPathLine((dummy_GpPath*) p->backend,
                         pSink->ptEnd.x, pSink->ptEnd.y, x, y);
     }
 
@@ -229,6 +578,7 @@ wdAddLine(WD_PATHSINK* pSink, float x, float y)
 void
 wdAddArc(WD_PATHSINK* pSink, float cx, float cy, float fSweepAngle)
 {
+    wd_path_t* p = (wd_path_t*) pSink->pData;
     float ax = pSink->ptEnd.x;
     float ay = pSink->ptEnd.y;
     float xdiff = ax - cx;
@@ -236,6 +586,15 @@ wdAddArc(WD_PATHSINK* pSink, float cx, float cy, float fSweepAngle)
     float r;
     float base_angle;
 
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_ADDARC);
+        wd_capture_h(WD_CAPTURE_SINK(pSink));
+        wd_capture_f(cx);
+        wd_capture_f(cy);
+        wd_capture_f(fSweepAngle);
+        wd_capture_end();
+    }
+
     r = sqrtf(xdiff * xdiff + ydiff * ydiff);
 
     /* Avoid undefined case for atan2f(). */
@@ -244,8 +603,16 @@ wdAddArc(WD_PATHSINK* pSink, float cx, float cy, float fSweepAngle)
 
     base_angle = atan2f(ydiff, xdiff) * (180.0f / WD_PI);
 
-    if(d2d_enabled()) {
-        dummy_ID2D1GeometrySink* s = (dummy_ID2D1GeometrySink*) pSink->pData;
+    sw_path_arc(&p->retained, cx, cy, r, r, base_angle, fSweepAngle, FALSE);
+
+    if(ops_enabled()) {
+        float end_rads = (base_angle + fSweepAngle) * (WD_PI / 180.0f);
+
+        wd_backend_ops->fnAddArc(p->sink, cx, cy, r, base_angle, fSweepAngle);
+        pSink->ptEnd.x = cx + r * cosf(end_rads);
+        pSink->ptEnd.y = cy + r * sinf(end_rads);
+    } else if(d2d_enabled()) {
+        dummy_ID2D1GeometrySink* s = (dummy_ID2D1GeometrySink*) p->sink;
         dummy_D2D1_ARC_SEGMENT arc_seg;
 
         d2d_setup_arc_segment(&arc_seg, cx, cy, r, r, base_angle, fSweepAngle);
@@ -256,7 +623,8 @@ wdAddArc(WD_PATHSINK* pSink, float cx, float cy, float fSweepAngle)
         float d = 2.0f * r;
         float sweep_rads = (base_angle + fSweepAngle) * (WD_PI / 180.0f);
 
-        gdix_vtable->fn_AddPathArc(pSink->pData, cx - r, cy - r, d, d, base_angle, fSweepAngle);
+        gdix_vtable->fn_AddPathArc((dummy_GpPath*) p->backend, cx - r, cy - r, d, d,
+                                   base_angle, fSweepAngle);
         pSink->ptEnd.x = cx + r * cosf(sweep_rads);
         pSink->ptEnd.y = cy + r * sinf(sweep_rads);
     }
@@ -265,16 +633,562 @@ wdAddArc(WD_PATHSINK* pSink, float cx, float cy, float fSweepAngle)
 void
 wdAddBezier(WD_PATHSINK* pSink, float x0, float y0, float x1, float y1, float x2, float y2)
 {
-    if(d2d_enabled()) {
-        dummy_ID2D1GeometrySink* s = (dummy_ID2D1GeometrySink*) pSink->pData;
+    wd_path_t* p = (wd_path_t*) pSink->pData;
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_ADDBEZIER);
+        wd_capture_h(WD_CAPTURE_SINK(pSink));
+        wd_capture_f(x0);
+        wd_capture_f(y0);
+        wd_capture_f(x1);
+        wd_capture_f(y1);
+        wd_capture_f(x2);
+        wd_capture_f(y2);
+        wd_capture_end();
+    }
+
+    sw_path_cubic_to(&p->retained, x0, y0, x1, y1, x2, y2);
+
+    if(ops_enabled()) {
+        wd_backend_ops->fnAddBezier(p->sink, x0, y0, x1, y1, x2, y2);
+    } else if(d2d_enabled()) {
+        dummy_ID2D1GeometrySink* s = (dummy_ID2D1GeometrySink*) p->sink;
         dummy_D2D1_BEZIER_SEGMENT bezier_seg;
 
         d2d_setup_bezier_segment(&bezier_seg, x0, y0, x1, y1, x2, y2);
         dummy_ID2D1GeometrySink_AddBezier(s, &bezier_seg);
     } else {
-        gdix_vtable->fn_AddPathBezier(pSink->pData, pSink->ptEnd.x, pSink->ptEnd.y,
+        gdix_vtable->fn_AddPathBezier((dummy_GpPath*) p->backend, pSink->ptEnd.x, pSink->ptEnd.y,
                                       x0, y0, x1, y1, x2, y2);
     }
     pSink->ptEnd.x = x2;
     pSink->ptEnd.y = y2;
 }
+
+void
+wdAddLines(WD_PATHSINK* pSink, const WD_POINT* pPoints, UINT uCount)
+{
+    UINT i;
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_ADDLINES);
+        wd_capture_h(WD_CAPTURE_SINK(pSink));
+        wd_capture_u(uCount);
+        for(i = 0; i < uCount; i++) {
+            wd_capture_f(pPoints[i].x);
+            wd_capture_f(pPoints[i].y);
+        }
+        wd_capture_end();
+    }
+
+    if(uCount == 0)
+        return;
+
+    sw_path_lines_to(&((wd_path_t*) pSink->pData)->retained, pPoints, uCount);
+    wdAddLinesImpl(pSink, pPoints, uCount);
+}
+
+void
+wdAddBeziers(WD_PATHSINK* pSink, const WD_POINT* pPoints, UINT uCount)
+{
+    UINT i;
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_ADDBEZIERS);
+        wd_capture_h(WD_CAPTURE_SINK(pSink));
+        wd_capture_u(uCount);
+        for(i = 0; i < 3 * uCount; i++) {
+            wd_capture_f(pPoints[i].x);
+            wd_capture_f(pPoints[i].y);
+        }
+        wd_capture_end();
+    }
+
+    if(uCount == 0)
+        return;
+
+    sw_path_cubics_to(&((wd_path_t*) pSink->pData)->retained, pPoints, uCount);
+    wdAddBeziersImpl(pSink, pPoints, uCount);
+}
+
+BOOL
+wdGetPathBounds(WD_HPATH hPath, WD_RECT* pRect)
+{
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_GETPATHBOUNDS);
+        wd_capture_h(hPath);
+        wd_capture_end();
+    }
+
+    return sw_path_bounds(&((const wd_path_t*) hPath)->retained, pRect);
+}
+
+WD_HPATH
+wdClonePath(WD_HCANVAS hCanvas, WD_HPATH hPath)
+{
+    const wd_path_t* src = (const wd_path_t*) hPath;
+    wd_path_t* p;
+
+    p = wd_path_alloc(hCanvas, src->fill_mode, "wdClonePath");
+    if(p != NULL) {
+        sw_path_append(&p->retained, &src->retained);
+        if(p->retained.error  ||  !wd_path_build(p, &p->retained)) {
+            WD_TRACE("wdClonePath: Failed to build the path.");
+            wd_path_free(p);
+            p = NULL;
+        }
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_CLONEPATH);
+        wd_capture_h_new(p);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hPath);
+        wd_capture_end();
+    }
+
+    return (WD_HPATH) p;
+}
+
+BOOL
+wdTransformPath(WD_HPATH hPath, const WD_MATRIX* pMatrix)
+{
+    wd_path_t* p = (wd_path_t*) hPath;
+    wd_path_t tmp;
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_TRANSFORMPATH);
+        wd_capture_h(hPath);
+        wd_capture_matrix(pMatrix);
+        wd_capture_end();
+    }
+
+    /* Back-end paths are immutable once their sink has been closed (and
+     * D2D has no way to transform them in place anyway), so build a new one
+     * from the transformed commands and swap it in. */
+    sw_path_init(&tmp.retained);
+    sw_path_append(&tmp.retained, &p->retained);
+    if(tmp.retained.error) {
+        WD_TRACE("wdTransformPath: Out of memory.");
+        goto err;
+    }
+    sw_path_transform(&tmp.retained, pMatrix);
+
+    tmp.backend = wdCreatePathImpl(NULL, p->fill_mode);
+    if(tmp.backend == NULL)
+        goto err;
+    tmp.sink = NULL;
+    tmp.fill_mode = p->fill_mode;
+    if(!wd_path_build(&tmp, &tmp.retained)) {
+        WD_TRACE("wdTransformPath: Failed to build the path.");
+        wdDestroyPathImpl(tmp.backend);
+        goto err;
+    }
+
+    wdDestroyPathImpl(p->backend);
+    sw_path_fini(&p->retained);
+    p->backend = tmp.backend;
+    p->retained = tmp.retained;
+    wd_path_invalidate(p);
+    return TRUE;
+
+err:
+    sw_path_fini(&tmp.retained);
+    return FALSE;
+}
+
+/* Flattening tolerance of the hit testing; the default of D2D. */
+#define WD_HITTEST_TOLERANCE    0.25f
+
+static BOOL
+wd_path_flatten_cached(wd_path_t* p)
+{
+    if(!p->flat_valid) {
+        sw_poly_reset(&p->flat);
+        sw_poly_flatten(&p->flat, &p->retained, WD_HITTEST_TOLERANCE);
+        if(p->flat.error) {
+            WD_TRACE("wd_path_flatten_cached: Out of memory.");
+            return FALSE;
+        }
+        sw_poly_bounds(&p->flat, &p->flat_bounds);
+        p->flat_valid = TRUE;
+    }
+
+    return TRUE;
+}
+
+static inline BOOL
+wd_outside_bounds(const WD_RECT* bounds, float x, float y, float margin)
+{
+    return (x < bounds->x0 - margin  ||  x > bounds->x1 + margin  ||
+            y < bounds->y0 - margin  ||  y > bounds->y1 + margin);
+}
+
+BOOL
+wdPathFillContainsPoint(WD_HPATH hPath, float x, float y, UINT fillRule)
+{
+    wd_path_t* p = (wd_path_t*) hPath;
+    int winding;
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_FILLCONTAINSPOINT);
+        wd_capture_h(hPath);
+        wd_capture_f(x);
+        wd_capture_f(y);
+        wd_capture_u(fillRule);
+        wd_capture_end();
+    }
+
+    if(!wd_path_flatten_cached(p))
+        return FALSE;
+    if(wd_outside_bounds(&p->flat_bounds, x, y, 0.0f))
+        return FALSE;
+
+    winding = sw_poly_winding(&p->flat, x, y);
+    if(fillRule == WD_FILL_WINDING)
+        return (winding != 0);
+    else
+        return ((winding & 1) != 0);
+}
+
+BOOL
+wdPathStrokeContainsPoint(WD_HPATH hPath, float x, float y,
+            float fStrokeWidth, WD_HSTROKESTYLE hStrokeStyle)
+{
+    wd_path_t* p = (wd_path_t*) hPath;
+    LONG style = (hStrokeStyle != NULL ? ((const wd_strokestyle_t*) hStrokeStyle)->serial : 0);
+    sw_stroke_t stroke;
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_STROKECONTAINSPOINT);
+        wd_capture_h(hPath);
+        wd_capture_f(x);
+        wd_capture_f(y);
+        wd_capture_f(fStrokeWidth);
+        wd_capture_h(hStrokeStyle);
+        wd_capture_end();
+    }
+
+    if(!(fStrokeWidth > 0.0f))
+        return FALSE;
+    if(!wd_path_flatten_cached(p))
+        return FALSE;
+
+    /* No part of the stroke (miters and square caps included) gets farther
+     * from the path than this, so most misses need not build the outline. */
+    wd_strokestyle_stroke(hStrokeStyle, fStrokeWidth, &stroke);
+    if(wd_outside_bounds(&p->flat_bounds, x, y,
+                0.5f * fStrokeWidth * WD_MAX(stroke.miter_limit, 1.5f)))
+        return FALSE;
+
+    if(!p->outline_valid  ||  p->outline_width != fStrokeWidth  ||  p->outline_style != style) {
+        sw_poly_t scratch;
+
+        sw_poly_init(&scratch);
+        sw_poly_reset(&p->outline);
+        sw_poly_stroke(&p->outline, &p->flat, &stroke, WD_HITTEST_TOLERANCE, &scratch);
+        sw_poly_fini(&scratch);
+        if(p->outline.error) {
+            WD_TRACE("wdPathStrokeContainsPoint: Out of memory.");
+            p->outline_valid = FALSE;
+            return FALSE;
+        }
+
+        sw_poly_bounds(&p->outline, &p->outline_bounds);
+        p->outline_width = fStrokeWidth;
+        p->outline_style = style;
+        p->outline_valid = TRUE;
+    }
+
+    if(wd_outside_bounds(&p->outline_bounds, x, y, 0.0f))
+        return FALSE;
+
+    /* The stroker emits overlapping pieces, which only the non-zero rule
+     * unites. */
+    return (sw_poly_winding(&p->outline, x, y) != 0);
+}
+
+BOOL
+wdFlattenPath(WD_HPATH hPath, float fTolerance, const WD_MATRIX* pMatrix,
+              WD_FLATTENPATHCALLBACK fnCallback, void* pUserData)
+{
+    wd_path_t* p = (wd_path_t*) hPath;
+    sw_path_t transformed;
+    const sw_path_t* path;
+    sw_poly_t poly;
+    UINT i, start;
+    BOOL ret = TRUE;
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_FLATTENPATH);
+        wd_capture_h(hPath);
+        wd_capture_f(fTolerance);
+        wd_capture_matrix_opt(pMatrix);
+        wd_capture_end();
+    }
+
+    if(!(fTolerance > 0.0f)) {
+        WD_TRACE("wdFlattenPath: Invalid tolerance.");
+        return FALSE;
+    }
+
+    /* Transform the control points rather than the flattened polygon: the
+     * curves stay the same curves under any affine transformation, and the
+     * tolerance then holds in the target space exactly, even for a
+     * non-uniform scaling. */
+    path = &p->retained;
+    sw_path_init(&transformed);
+    if(pMatrix != NULL) {
+        sw_path_append(&transformed, &p->retained);
+        sw_path_transform(&transformed, pMatrix);
+        if(transformed.error) {
+            WD_TRACE("wdFlattenPath: Out of memory.");
+            sw_path_fini(&transformed);
+            return FALSE;
+        }
+        path = &transformed;
+    }
+
+    sw_poly_init(&poly);
+    sw_poly_flatten(&poly, path, fTolerance);
+    sw_path_fini(&transformed);
+    if(poly.error) {
+        WD_TRACE("wdFlattenPath: Out of memory.");
+        sw_poly_fini(&poly);
+        return FALSE;
+    }
+
+    start = 0;
+    for(i = 0; i < poly.contour_count; i++) {
+        if(!fnCallback(pUserData, poly.points + start,
+                       poly.contours[i].end - start, poly.contours[i].closed)) {
+            ret = FALSE;
+            break;
+        }
+        start = poly.contours[i].end;
+    }
+
+    sw_poly_fini(&poly);
+    return ret;
+}
+
+/* Turns the polygon into path commands (and builds the back-end path). */
+static BOOL
+wd_path_set_poly(wd_path_t* p, const sw_poly_t* poly)
+{
+    UINT i, start;
+
+    start = 0;
+    for(i = 0; i < poly->contour_count; i++) {
+        UINT end = poly->contours[i].end;
+
+        if(end > start) {
+            sw_path_move_to(&p->retained, poly->points[start].x, poly->points[start].y);
+            sw_path_lines_to(&p->retained, poly->points + start + 1, end - start - 1);
+            if(poly->contours[i].closed)
+                sw_path_close(&p->retained);
+        }
+        start = end;
+    }
+
+    if(p->retained.error)
+        return FALSE;
+    return wd_path_build(p, &p->retained);
+}
+
+WD_HPATH
+wdWidenPath(WD_HCANVAS hCanvas, WD_HPATH hPath, float fStrokeWidth,
+            WD_HSTROKESTYLE hStrokeStyle, float fTolerance)
+{
+    const wd_path_t* src = (const wd_path_t*) hPath;
+    wd_path_t* p = NULL;
+    sw_stroke_t stroke;
+    sw_poly_t flat;
+    sw_poly_t outline;
+    sw_poly_t scratch;
+    float tolerance;
+
+    if(!(fStrokeWidth > 0.0f)) {
+        WD_TRACE("wdWidenPath: Invalid stroke width.");
+        goto out;
+    }
+
+    tolerance = (fTolerance > 0.0f ? fTolerance : WD_HITTEST_TOLERANCE);
+    wd_strokestyle_stroke(hStrokeStyle, fStrokeWidth, &stroke);
+
+    sw_poly_init(&flat);
+    sw_poly_init(&outline);
+    sw_poly_init(&scratch);
+    sw_poly_flatten(&flat, &src->retained, tolerance);
+    sw_poly_stroke(&outline, &flat, &stroke, tolerance, &scratch);
+    if(flat.error  ||  outline.error) {
+        WD_TRACE("wdWidenPath: Out of memory.");
+        goto end;
+    }
+
+    /* The stroker emits overlapping pieces (and even the outline of a single
+     * segment overlaps itself at inner joins), which only the non-zero rule
+     * unites. */
+    p = wd_path_alloc(hCanvas, WD_FILL_WINDING, "wdWidenPath");
+    if(p != NULL  &&  !wd_path_set_poly(p, &outline)) {
+        WD_TRACE("wdWidenPath: Failed to build the path.");
+        wd_path_free(p);
+        p = NULL;
+    }
+
+end:
+    sw_poly_fini(&scratch);
+    sw_poly_fini(&outline);
+    sw_poly_fini(&flat);
+
+out:
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_WIDENPATH);
+        wd_capture_h_new(p);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hPath);
+        wd_capture_f(fStrokeWidth);
+        wd_capture_h(hStrokeStyle);
+        wd_capture_f(fTolerance);
+        wd_capture_end();
+    }
+
+    return (WD_HPATH) p;
+}
+
+/* Paths larger than this (in device pixels) get no coverage recorded, so
+ * a huge zoomed-in path cannot eat up the memory. */
+#define WD_REALIZE_MAX_AREA     (4096.0f * 4096.0f)
+
+static void
+wd_realized_free(wd_realized_t* r)
+{
+    if(r->path != NULL)
+        wd_path_free(r->path);
+    sw_spans_fini(&r->spans);
+    free(r);
+}
+
+/* Destructor for wd_dlist_defer_destroy(). */
+static void
+wd_realized_destroy(void* r)
+{
+    wd_realized_free((wd_realized_t*) r);
+}
+
+/* Records the coverage of the polygon (in device space) over its bounds. */
+static BOOL
+wd_realized_rasterize(wd_realized_t* r, const sw_poly_t* device, int fill_rule)
+{
+    WD_RECT bounds;
+    sw_rast_t rast;
+    int ret;
+
+    if(!sw_poly_bounds(device, &bounds))
+        return TRUE;
+    if((bounds.x1 - bounds.x0 + 1.0f) * (bounds.y1 - bounds.y0 + 1.0f) > WD_REALIZE_MAX_AREA)
+        return FALSE;
+
+    sw_rast_init(&rast);
+    ret = sw_rasterize_spans(&rast, device, fill_rule,
+                (int) floorf(bounds.x0), (int) floorf(bounds.y0),
+                (int) ceilf(bounds.x1), (int) ceilf(bounds.y1), &r->spans);
+    sw_rast_fini(&rast);
+    return (ret == 0);
+}
+
+WD_HREALIZEDFILL
+wdRealizePathFill(WD_HCANVAS hCanvas, WD_HPATH hPath, float fTolerance)
+{
+    const wd_path_t* src = (const wd_path_t*) hPath;
+    wd_realized_t* r;
+    sw_poly_t poly;
+    WD_RECT visible;
+    float tolerance;
+    float sx, sy, scale;
+
+    r = (wd_realized_t*) malloc(sizeof(wd_realized_t));
+    if(r == NULL) {
+        WD_TRACE("wdRealizePathFill: malloc() failed.");
+        goto out;
+    }
+    r->path = NULL;
+    r->has_spans = FALSE;
+    sw_spans_init(&r->spans);
+
+    /* By default, flatten exactly as wdFillPath() of the software back-end
+     * does, so the realized fill paints the same pixels. */
+    tolerance = (fTolerance > 0.0f ? fTolerance : SW_TOLERANCE);
+
+    /* Flatten in the user space, with the tolerance scaled so that it holds
+     * in the device space. */
+    wd_canvas_visible(hCanvas, &r->matrix, &visible);
+    sx = r->matrix.m11 * r->matrix.m11 + r->matrix.m12 * r->matrix.m12;
+    sy = r->matrix.m21 * r->matrix.m21 + r->matrix.m22 * r->matrix.m22;
+    scale = sqrtf(WD_MAX(sx, sy));
+    if(scale > 1e-6f)
+        tolerance /= scale;
+
+    sw_poly_init(&poly);
+    sw_poly_flatten(&poly, &src->retained, tolerance);
+    if(poly.error) {
+        WD_TRACE("wdRealizePathFill: Out of memory.");
+        goto err;
+    }
+    sw_poly_bounds(&poly, &r->bounds);
+
+    r->path = wd_path_alloc(hCanvas, src->fill_mode, "wdRealizePathFill");
+    if(r->path == NULL)
+        goto err;
+    if(!wd_path_set_poly(r->path, &poly)) {
+        WD_TRACE("wdRealizePathFill: Failed to build the path.");
+        goto err;
+    }
+
+    /* The software back-end can also keep what its rasterizer would compute
+     * for wdFillPath(). The other back-ends have no way to share that. */
+    if(sw_enabled()) {
+        sw_poly_transform(&poly, &r->matrix);
+        if(wd_realized_rasterize(r, &poly, (src->fill_mode == WD_FILL_WINDING ?
+                                            SW_FILL_WINDING : SW_FILL_ALTERNATE))) {
+            r->has_spans = TRUE;
+        } else {
+            sw_spans_fini(&r->spans);
+            sw_spans_init(&r->spans);
+        }
+    }
+
+    sw_poly_fini(&poly);
+    goto out;
+
+err:
+    sw_poly_fini(&poly);
+    wd_realized_free(r);
+    r = NULL;
+
+out:
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_REALIZEPATHFILL);
+        wd_capture_h_new(r);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hPath);
+        wd_capture_f(fTolerance);
+        wd_capture_end();
+    }
+
+    return (WD_HREALIZEDFILL) r;
+}
+
+void
+wdDestroyRealizedFill(WD_HREALIZEDFILL hFill)
+{
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DESTROYREALIZEDFILL);
+        wd_capture_h_free(hFill);
+        wd_capture_end();
+    }
+
+    if(wd_dlist_defer_destroy(hFill, wd_realized_destroy))
+        return;
+    wd_realized_free((wd_realized_t*) hFill);
+}
@@ -0,0 +1,71 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef WD_PATH_H
+#define WD_PATH_H
+
+#include "misc.h"
+#include "swrast.h"
+
+
+/* WD_HPATH points to this structure. Next to the back-end object, it retains
+ * the commands the path has been built from (with arcs turned into Bezier
+ * curves), so wdGetPathBounds(), wdClonePath() and wdTransformPath() need not
+ * ask the back-end. */
+typedef struct wd_path_tag wd_path_t;
+struct wd_path_tag {
+    void* backend;          /* Custom path, ID2D1PathGeometry or GpPath */
+    void* sink;             /* Custom sink or ID2D1GeometrySink, while open */
+    UINT fill_mode;         /* WD_FILL_WINDING for wdWidenPath() results */
+    sw_path_t retained;
+
+    /* Caches for the hit testing, built on demand and dropped whenever the
+     * retained commands change (see wd_path_invalidate()). */
+    sw_poly_t flat;         /* The retained commands, flattened. */
+    WD_RECT flat_bounds;
+    BOOL flat_valid;
+    sw_poly_t outline;      /* Outline of the last stroke hit-tested. */
+    WD_RECT outline_bounds;
+    float outline_width;
+    LONG outline_style;     /* Serial of the stroke style (zero for none). */
+    BOOL outline_valid;
+};
+
+/* WD_HREALIZEDFILL points to this structure (see wdRealizePathFill()). */
+typedef struct wd_realized_tag wd_realized_t;
+struct wd_realized_tag {
+    wd_path_t* path;        /* The path flattened, in the user space. */
+    WD_RECT bounds;         /* Of the flattened path. */
+    WD_MATRIX matrix;       /* World transformation at the time of realization. */
+    sw_spans_t spans;       /* Software back-end: coverage in device pixels. */
+    BOOL has_spans;
+};
+
+static inline void*
+wd_path_backend(WD_HPATH hPath)
+{
+    return (hPath != NULL ? ((const wd_path_t*) hPath)->backend : NULL);
+}
+
+
+#endif  /* WD_PATH_H */
@@ -0,0 +1,509 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "misc.h"
+#include "canvas.h"
+
+
+/* The index keeps all the items in one array. Its prefix [0, n_packed) is
+ * covered by an R-tree packed with the Sort-Tile-Recursive algorithm; the
+ * rest are items inserted since, which the queries just scan. Removed items
+ * of the packed part stay in place as tombstones (with an empty rectangle no
+ * query can hit). Once the scanned items and tombstones grow too many, the
+ * next query packs everything anew. */
+
+#define WD_SPATIAL_FANOUT       16
+#define WD_SPATIAL_SLACK(n)     (64 + (n) / 16)
+
+/* Depth of the tree is at most 8 for 2^32 items, and the traversal keeps at
+ * most (WD_SPATIAL_FANOUT - 1) siblings per level on the stack. */
+#define WD_SPATIAL_STACK        (8 * WD_SPATIAL_FANOUT)
+
+typedef struct wd_spatial_item_tag wd_spatial_item_t;
+struct wd_spatial_item_tag {
+    WD_RECT rect;
+    UINT id;
+};
+
+/* Children of a node are nodes [first, first + count) of the level below, or
+ * items [first, first + count) for the leaf level. */
+typedef struct wd_spatial_node_tag wd_spatial_node_t;
+struct wd_spatial_node_tag {
+    WD_RECT bounds;
+    UINT first;
+    UINT count;
+};
+
+typedef struct wd_spatial_tag wd_spatial_t;
+struct wd_spatial_tag {
+    wd_spatial_item_t* items;
+    UINT n_items;
+    UINT n_packed;
+    UINT n_dead;            /* Tombstones in [0, n_packed) */
+    UINT capacity;
+
+    /* All levels, leaves first; the root is the last node. */
+    wd_spatial_node_t* nodes;
+    UINT n_nodes;
+    UINT n_leaves;
+    UINT node_capacity;
+};
+
+
+static inline BOOL
+wd_spatial_overlap(const WD_RECT* a, const WD_RECT* b)
+{
+    return (a->x0 <= b->x1  &&  b->x0 <= a->x1  &&  a->y0 <= b->y1  &&  b->y0 <= a->y1);
+}
+
+static inline void
+wd_spatial_normalize(WD_RECT* dst, const WD_RECT* src)
+{
+    dst->x0 = WD_MIN(src->x0, src->x1);
+    dst->y0 = WD_MIN(src->y0, src->y1);
+    dst->x1 = WD_MAX(src->x0, src->x1);
+    dst->y1 = WD_MAX(src->y0, src->y1);
+}
+
+/* Whether no coordinate is infinite or NaN. (It looks at the bits, as
+ * -ffast-math lets the compiler assume every float is finite.) */
+static BOOL
+wd_spatial_finite(const WD_RECT* rect)
+{
+    UINT32 bits[4];
+    int i;
+
+    memcpy(bits, rect, sizeof(bits));
+    for(i = 0; i < 4; i++) {
+        if((bits[i] & 0x7f800000) == 0x7f800000)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* The rectangle of tombstones. */
+static void
+wd_spatial_kill(WD_RECT* rect)
+{
+    rect->x0 = FLT_MAX;
+    rect->y0 = FLT_MAX;
+    rect->x1 = -FLT_MAX;
+    rect->y1 = -FLT_MAX;
+}
+
+static inline BOOL
+wd_spatial_dead(const WD_RECT* rect)
+{
+    return (rect->x0 > rect->x1);
+}
+
+static int
+wd_spatial_cmp_item_x(const void* a, const void* b)
+{
+    float ca = ((const wd_spatial_item_t*) a)->rect.x0 + ((const wd_spatial_item_t*) a)->rect.x1;
+    float cb = ((const wd_spatial_item_t*) b)->rect.x0 + ((const wd_spatial_item_t*) b)->rect.x1;
+    return (ca < cb) ? -1 : (ca > cb) ? +1 : 0;
+}
+
+static int
+wd_spatial_cmp_item_y(const void* a, const void* b)
+{
+    float ca = ((const wd_spatial_item_t*) a)->rect.y0 + ((const wd_spatial_item_t*) a)->rect.y1;
+    float cb = ((const wd_spatial_item_t*) b)->rect.y0 + ((const wd_spatial_item_t*) b)->rect.y1;
+    return (ca < cb) ? -1 : (ca > cb) ? +1 : 0;
+}
+
+static int
+wd_spatial_cmp_node_x(const void* a, const void* b)
+{
+    float ca = ((const wd_spatial_node_t*) a)->bounds.x0 + ((const wd_spatial_node_t*) a)->bounds.x1;
+    float cb = ((const wd_spatial_node_t*) b)->bounds.x0 + ((const wd_spatial_node_t*) b)->bounds.x1;
+    return (ca < cb) ? -1 : (ca > cb) ? +1 : 0;
+}
+
+static int
+wd_spatial_cmp_node_y(const void* a, const void* b)
+{
+    float ca = ((const wd_spatial_node_t*) a)->bounds.y0 + ((const wd_spatial_node_t*) a)->bounds.y1;
+    float cb = ((const wd_spatial_node_t*) b)->bounds.y0 + ((const wd_spatial_node_t*) b)->bounds.y1;
+    return (ca < cb) ? -1 : (ca > cb) ? +1 : 0;
+}
+
+/* Sort-Tile-Recursive: Sorts the n elements by x, cuts them into vertical
+ * slices of whole groups, and sorts each slice by y. Consecutive groups of
+ * WD_SPATIAL_FANOUT elements then make compact nodes. */
+static void
+wd_spatial_str(void* elems, UINT n, size_t size,
+               int (*cmp_x)(const void*, const void*),
+               int (*cmp_y)(const void*, const void*))
+{
+    UINT n_groups = (n + WD_SPATIAL_FANOUT - 1) / WD_SPATIAL_FANOUT;
+    UINT n_slices = (UINT) ceil(sqrt((double) n_groups));
+    UINT slice = ((n_groups + n_slices - 1) / n_slices) * WD_SPATIAL_FANOUT;
+    UINT i;
+
+    qsort(elems, n, size, cmp_x);
+    for(i = 0; i < n; i += slice)
+        qsort((BYTE*) elems + i * size, WD_MIN(slice, n - i), size, cmp_y);
+}
+
+/* Drops the tombstones and packs all the items into a new tree. */
+static BOOL
+wd_spatial_pack(wd_spatial_t* s)
+{
+    UINT i, j, n;
+    UINT level_first, level_count;
+
+    /* Compact the items. */
+    for(i = 0, j = 0; i < s->n_items; i++) {
+        if(!wd_spatial_dead(&s->items[i].rect)) {
+            if(i != j)
+                s->items[j] = s->items[i];
+            j++;
+        }
+    }
+    s->n_items = j;
+    s->n_packed = 0;
+    s->n_dead = 0;
+    s->n_nodes = 0;
+    s->n_leaves = 0;
+
+    if(s->n_items == 0)
+        return TRUE;
+
+    /* Reserve the nodes of all the levels: each node groups (at most)
+     * WD_SPATIAL_FANOUT nodes of the level below. */
+    n = 0;
+    for(i = s->n_items; i > 1; i = (i + WD_SPATIAL_FANOUT - 1) / WD_SPATIAL_FANOUT)
+        n += (i + WD_SPATIAL_FANOUT - 1) / WD_SPATIAL_FANOUT;
+    if(n == 0)
+        n = 1;
+    if(n > s->node_capacity) {
+        wd_spatial_node_t* nodes;
+
+        nodes = (wd_spatial_node_t*) realloc(s->nodes, n * sizeof(wd_spatial_node_t));
+        if(nodes == NULL) {
+            WD_TRACE("wd_spatial_pack: realloc() failed.");
+            return FALSE;
+        }
+        s->nodes = nodes;
+        s->node_capacity = n;
+    }
+
+    /* Leaves. */
+    wd_spatial_str(s->items, s->n_items, sizeof(wd_spatial_item_t),
+                   wd_spatial_cmp_item_x, wd_spatial_cmp_item_y);
+    for(i = 0; i < s->n_items; i += WD_SPATIAL_FANOUT) {
+        wd_spatial_node_t* node = &s->nodes[s->n_nodes++];
+
+        node->first = i;
+        node->count = WD_MIN(WD_SPATIAL_FANOUT, s->n_items - i);
+        node->bounds = s->items[i].rect;
+        for(j = i + 1; j < i + node->count; j++) {
+            node->bounds.x0 = WD_MIN(node->bounds.x0, s->items[j].rect.x0);
+            node->bounds.y0 = WD_MIN(node->bounds.y0, s->items[j].rect.y0);
+            node->bounds.x1 = WD_MAX(node->bounds.x1, s->items[j].rect.x1);
+            node->bounds.y1 = WD_MAX(node->bounds.y1, s->items[j].rect.y1);
+        }
+    }
+    s->n_leaves = s->n_nodes;
+
+    /* Upper levels, until there is a single root. */
+    level_first = 0;
+    level_count = s->n_nodes;
+    while(level_count > 1) {
+        UINT next_first = s->n_nodes;
+
+        wd_spatial_str(s->nodes + level_first, level_count, sizeof(wd_spatial_node_t),
+                       wd_spatial_cmp_node_x, wd_spatial_cmp_node_y);
+        for(i = 0; i < level_count; i += WD_SPATIAL_FANOUT) {
+            wd_spatial_node_t* node = &s->nodes[s->n_nodes++];
+            const wd_spatial_node_t* child = &s->nodes[level_first + i];
+
+            node->first = level_first + i;
+            node->count = WD_MIN(WD_SPATIAL_FANOUT, level_count - i);
+            node->bounds = child[0].bounds;
+            for(j = 1; j < node->count; j++) {
+                node->bounds.x0 = WD_MIN(node->bounds.x0, child[j].bounds.x0);
+                node->bounds.y0 = WD_MIN(node->bounds.y0, child[j].bounds.y0);
+                node->bounds.x1 = WD_MAX(node->bounds.x1, child[j].bounds.x1);
+                node->bounds.y1 = WD_MAX(node->bounds.y1, child[j].bounds.y1);
+            }
+        }
+
+        level_first = next_first;
+        level_count = s->n_nodes - next_first;
+    }
+
+    s->n_packed = s->n_items;
+    return TRUE;
+}
+
+static BOOL
+wd_spatial_reserve(wd_spatial_t* s, UINT n)
+{
+    if(s->n_items + n > s->capacity) {
+        UINT capacity = (s->capacity > 0 ? s->capacity * 2 : 256);
+        wd_spatial_item_t* items;
+
+        while(capacity < s->n_items + n)
+            capacity *= 2;
+
+        items = (wd_spatial_item_t*) realloc(s->items, capacity * sizeof(wd_spatial_item_t));
+        if(items == NULL) {
+            WD_TRACE("wd_spatial_reserve: realloc() failed.");
+            return FALSE;
+        }
+
+        s->items = items;
+        s->capacity = capacity;
+    }
+
+    return TRUE;
+}
+
+/* Filter of the visible-set query: the item (or node) bounds, transformed
+ * into device space, have to hit the visible area. */
+typedef struct wd_spatial_view_tag wd_spatial_view_t;
+struct wd_spatial_view_tag {
+    WD_MATRIX matrix;
+    WD_RECT visible;
+};
+
+static UINT
+wd_spatial_query(wd_spatial_t* s, const WD_RECT* rect, const wd_spatial_view_t* view,
+                 UINT* ids, UINT max_ids)
+{
+    UINT stack[WD_SPATIAL_STACK];
+    UINT n_stack = 0;
+    UINT n = 0;
+    UINT i;
+
+    if(s->n_items - s->n_packed + s->n_dead > WD_SPATIAL_SLACK(s->n_packed)) {
+        /* If this fails, we still have the old tree and the scanned items. */
+        wd_spatial_pack(s);
+    }
+
+    #define WD_SPATIAL_HIT(r)                                                   \
+            (wd_spatial_overlap((r), rect)  &&  (view == NULL  ||               \
+                !wd_bounds_invisible(&view->matrix, &view->visible,             \
+                        (r)->x0, (r)->y0, (r)->x1, (r)->y1, 0.0f)))
+
+    if(s->n_nodes > 0)
+        stack[n_stack++] = s->n_nodes - 1;
+
+    while(n_stack > 0) {
+        const wd_spatial_node_t* node = &s->nodes[stack[--n_stack]];
+
+        if(!WD_SPATIAL_HIT(&node->bounds))
+            continue;
+
+        if(node - s->nodes < (ptrdiff_t) s->n_leaves) {
+            for(i = node->first; i < node->first + node->count; i++) {
+                if(WD_SPATIAL_HIT(&s->items[i].rect)) {
+                    if(n < max_ids)
+                        ids[n] = s->items[i].id;
+                    n++;
+                }
+            }
+        } else {
+            for(i = node->first; i < node->first + node->count; i++)
+                stack[n_stack++] = i;
+        }
+    }
+
+    for(i = s->n_packed; i < s->n_items; i++) {
+        if(WD_SPATIAL_HIT(&s->items[i].rect)) {
+            if(n < max_ids)
+                ids[n] = s->items[i].id;
+            n++;
+        }
+    }
+
+    #undef WD_SPATIAL_HIT
+
+    return n;
+}
+
+
+WD_HSPATIALINDEX
+wdCreateSpatialIndex(const UINT* pIds, const WD_RECT* pRects, UINT uCount)
+{
+    wd_spatial_t* s;
+    UINT i;
+
+    for(i = 0; i < uCount; i++) {
+        if(!wd_spatial_finite(&pRects[i])) {
+            WD_TRACE("wdCreateSpatialIndex: Rectangle %u is not finite.", i);
+            return NULL;
+        }
+    }
+
+    s = (wd_spatial_t*) malloc(sizeof(wd_spatial_t));
+    if(s == NULL) {
+        WD_TRACE("wdCreateSpatialIndex: malloc() failed.");
+        return NULL;
+    }
+    memset(s, 0, sizeof(wd_spatial_t));
+
+    if(uCount > 0) {
+        if(!wd_spatial_reserve(s, uCount))
+            goto err;
+
+        for(i = 0; i < uCount; i++) {
+            wd_spatial_normalize(&s->items[i].rect, &pRects[i]);
+            s->items[i].id = pIds[i];
+        }
+        s->n_items = uCount;
+
+        if(!wd_spatial_pack(s))
+            goto err;
+    }
+
+    return (WD_HSPATIALINDEX) s;
+
+err:
+    free(s->items);
+    free(s);
+    return NULL;
+}
+
+void
+wdDestroySpatialIndex(WD_HSPATIALINDEX hIndex)
+{
+    wd_spatial_t* s = (wd_spatial_t*) hIndex;
+
+    free(s->items);
+    free(s->nodes);
+    free(s);
+}
+
+BOOL
+wdInsertSpatialIndexItem(WD_HSPATIALINDEX hIndex, UINT uId, const WD_RECT* pRect)
+{
+    wd_spatial_t* s = (wd_spatial_t*) hIndex;
+
+    if(!wd_spatial_finite(pRect)) {
+        WD_TRACE("wdInsertSpatialIndexItem: Rectangle is not finite.");
+        return FALSE;
+    }
+
+    if(!wd_spatial_reserve(s, 1))
+        return FALSE;
+
+    wd_spatial_normalize(&s->items[s->n_items].rect, pRect);
+    s->items[s->n_items].id = uId;
+    s->n_items++;
+    return TRUE;
+}
+
+BOOL
+wdRemoveSpatialIndexItem(WD_HSPATIALINDEX hIndex, UINT uId, const WD_RECT* pRect)
+{
+    wd_spatial_t* s = (wd_spatial_t*) hIndex;
+    UINT stack[WD_SPATIAL_STACK];
+    UINT n_stack = 0;
+    WD_RECT rect;
+    UINT i;
+
+    wd_spatial_normalize(&rect, pRect);
+
+    /* The scanned items: Move the last one into the gap. */
+    for(i = s->n_packed; i < s->n_items; i++) {
+        if(s->items[i].id == uId  &&  memcmp(&s->items[i].rect, &rect, sizeof(WD_RECT)) == 0) {
+            s->items[i] = s->items[s->n_items - 1];
+            s->n_items--;
+            return TRUE;
+        }
+    }
+
+    /* The packed items: Find it through the tree and leave a tombstone. */
+    if(s->n_nodes > 0)
+        stack[n_stack++] = s->n_nodes - 1;
+
+    while(n_stack > 0) {
+        const wd_spatial_node_t* node = &s->nodes[stack[--n_stack]];
+
+        if(!wd_spatial_overlap(&node->bounds, &rect))
+            continue;
+
+        if(node - s->nodes < (ptrdiff_t) s->n_leaves) {
+            for(i = node->first; i < node->first + node->count; i++) {
+                wd_spatial_item_t* item = &s->items[i];
+
+                if(item->id == uId  &&  memcmp(&item->rect, &rect, sizeof(WD_RECT)) == 0) {
+                    wd_spatial_kill(&item->rect);
+                    s->n_dead++;
+                    return TRUE;
+                }
+            }
+        } else {
+            for(i = node->first; i < node->first + node->count; i++)
+                stack[n_stack++] = i;
+        }
+    }
+
+    return FALSE;
+}
+
+UINT
+wdQuerySpatialIndexPoint(WD_HSPATIALINDEX hIndex, float x, float y, UINT* pIds, UINT uMaxIds)
+{
+    WD_RECT rect = { x, y, x, y };
+
+    return wd_spatial_query((wd_spatial_t*) hIndex, &rect, NULL, pIds, uMaxIds);
+}
+
+UINT
+wdQuerySpatialIndexRect(WD_HSPATIALINDEX hIndex, const WD_RECT* pRect, UINT* pIds, UINT uMaxIds)
+{
+    WD_RECT rect;
+
+    wd_spatial_normalize(&rect, pRect);
+    return wd_spatial_query((wd_spatial_t*) hIndex, &rect, NULL, pIds, uMaxIds);
+}
+
+UINT
+wdQuerySpatialIndexVisible(WD_HSPATIALINDEX hIndex, WD_HCANVAS hCanvas,
+                           UINT* pIds, UINT uMaxIds)
+{
+    wd_spatial_view_t view;
+    WD_MATRIX inverse;
+    WD_RECT rect;
+
+    wd_canvas_visible(hCanvas, &view.matrix, &view.visible);
+
+    /* The world-space bounds of the visible area (grown by the pixel which
+     * wd_bounds_invisible() allows for anti-aliasing) prune the tree; the
+     * exact test in device space then drops what misses it under rotations
+     * or skews. */
+    if(!wd_matrix_invert(&view.matrix, &inverse))
+        return 0;
+    rect.x0 = view.visible.x0 - 1.0f;
+    rect.y0 = view.visible.y0 - 1.0f;
+    rect.x1 = view.visible.x1 + 1.0f;
+    rect.y1 = view.visible.y1 + 1.0f;
+    wd_bounds_transform(&inverse, &rect, &rect);
+
+    return wd_spatial_query((wd_spatial_t*) hIndex, &rect, &view, pIds, uMaxIds);
+}
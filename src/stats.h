@@ -0,0 +1,66 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef WD_STATS_H
+#define WD_STATS_H
+
+#include "misc.h"
+
+
+/* Per-canvas counters for wdGetCanvasStats(). A canvas is used by a single
+ * thread at a time, so these are plain increments, cheap enough to be always
+ * on. Times are kept in QueryPerformanceCounter() ticks. */
+typedef struct wd_stats_tag wd_stats_t;
+struct wd_stats_tag {
+    UINT draw_calls[WD_PRIMITIVE_COUNT];
+    UINT bitmap_uploads;
+    UINT64 bitmap_upload_bytes;
+    UINT geometries;
+    UINT layers;
+    UINT text_layouts;
+    UINT64 lock_acquisitions;
+    UINT64 lock_wait_ticks;
+    UINT paints;
+    UINT64 begin_paint_ticks;
+    UINT64 end_paint_ticks;
+
+    /* Snapshot of wd_lock_thread_stats taken by wdBeginPaint(). */
+    UINT64 lock_acquisitions_mark;
+    UINT64 lock_wait_ticks_mark;
+};
+
+
+static inline UINT64
+wd_ticks(void)
+{
+    LARGE_INTEGER t;
+
+    QueryPerformanceCounter(&t);
+    return (UINT64) t.QuadPart;
+}
+
+/* Converts QueryPerformanceCounter() ticks to microseconds. */
+UINT64 wd_ticks_to_us(UINT64 ticks);
+
+
+#endif  /* WD_STATS_H */
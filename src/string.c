@@ -22,9 +22,13 @@
  */
 
 #include "misc.h"
+#include "backend-ops.h"
 #include "backend-d2d.h"
 #include "backend-dwrite.h"
 #include "backend-gdix.h"
+#include "canvas.h"
+#include "capture.h"
+#include "dlist.h"
 #include "lock.h"
 
 
@@ -33,36 +37,89 @@ wdDrawString(WD_HCANVAS hCanvas, WD_HFONT hFont, const WD_RECT* pRect,
              const WCHAR* pszText, int iTextLength, WD_HBRUSH hBrush,
              DWORD dwFlags)
 {
-    if(d2d_enabled()) {
+    if(WD_DLIST_RECORDING(hCanvas)) {
+        wd_dlist_op(WD_DL_DRAWSTRING);
+        wd_dlist_h(hFont);
+        wd_dlist_rect(pRect);
+        wd_dlist_str(pszText, iTextLength);
+        wd_dlist_h(hBrush);
+        wd_dlist_u(dwFlags);
+        return;
+    }
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DRAWSTRING);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hFont);
+        wd_capture_rect(pRect);
+        wd_capture_str(pszText, iTextLength);
+        wd_capture_h(hBrush);
+        wd_capture_u(dwFlags);
+        wd_capture_end();
+    }
+
+    WD_STATS_DRAWCALL(hCanvas, WD_PRIMITIVE_STRING);
+
+    /* With WD_STR_NOCLIP, the text may overflow the rectangle anywhere. */
+    if(!(dwFlags & WD_STR_NOCLIP)  &&
+       wd_cull(hCanvas, pRect->x0, pRect->y0, pRect->x1, pRect->y1, 0.0f))
+        return;
+
+    WD_EVENT_BEGIN("wdDrawString");
+
+    if(ops_enabled()) {
+        ops_canvas_t* c = (ops_canvas_t*) hCanvas;
+        WD_RECT r;
+
+        /* Text itself must not get mirrored. */
+        if(c->rtl) {
+            ops_rtl_transform(c);
+            r.x0 = (float) c->width - pRect->x1;
+            r.x1 = (float) c->width - pRect->x0;
+        } else {
+            r.x0 = pRect->x0;
+            r.x1 = pRect->x1;
+        }
+        r.y0 = pRect->y0;
+        r.y1 = pRect->y1;
+
+        ops_sync_transform(c);
+        wd_backend_ops->fnDrawString(c->canvas, (void*) hFont, &r, pszText,
+                    iTextLength, (void*) hBrush, dwFlags);
+
+        if(c->rtl)
+            ops_rtl_transform(c);
+    } else if(d2d_enabled()) {
         dwrite_font_t* font = (dwrite_font_t*) hFont;
         dummy_D2D1_POINT_2F origin = { pRect->x0, pRect->y0 };
         d2d_canvas_t* c = (d2d_canvas_t*) hCanvas;
         dummy_ID2D1Brush* b = (dummy_ID2D1Brush*) hBrush;
         dummy_IDWriteTextLayout* layout;
-        dummy_D2D1_MATRIX_3X2_F old_matrix;
 
+        WD_EVENT_BEGIN("IDWriteFactory::CreateTextLayout");
         layout = dwrite_create_text_layout(font->tf, pRect, pszText, iTextLength, dwFlags);
+        WD_EVENT_END("IDWriteFactory::CreateTextLayout");
         if(layout == NULL) {
             WD_TRACE("wdDrawString: dwrite_create_text_layout() failed.");
+            WD_EVENT_END("wdDrawString");
             return;
         }
+        c->stats.text_layouts++;
 
         if(c->flags & D2D_CANVASFLAG_RTL) {
-            d2d_disable_rtl_transform(c, &old_matrix);
+            d2d_disable_rtl_transform(c);
             origin.x = (float)c->width - pRect->x1;
 
             dummy_IDWriteTextLayout_SetReadingDirection(layout,
                     dummy_DWRITE_READING_DIRECTION_RIGHT_TO_LEFT);
+        } else {
+            d2d_sync_transform(c);
         }
 
         dummy_ID2D1RenderTarget_DrawTextLayout(c->target, origin, layout, b,
                 (dwFlags & WD_STR_NOCLIP) ? 0 : dummy_D2D1_DRAW_TEXT_OPTIONS_CLIP);
 
         dummy_IDWriteTextLayout_Release(layout);
-
-        if(c->flags & D2D_CANVASFLAG_RTL) {
-            dummy_ID2D1RenderTarget_SetTransform(c->target, &old_matrix);
-        }
     } else {
         gdix_canvas_t* c = (gdix_canvas_t*) hCanvas;
         dummy_GpRectF r;
@@ -80,12 +137,15 @@ wdDrawString(WD_HCANVAS hCanvas, WD_HFONT hFont, const WD_RECT* pRect,
         r.h = pRect->y1 - pRect->y0;
 
         gdix_canvas_apply_string_flags(c, dwFlags);
+        gdix_sync_transform(c);
         gdix_vtable->fn_DrawString(c->graphics, pszText, iTextLength,
                 f, &r, c->string_format, b);
 
         if(c->rtl)
             gdix_rtl_transform(c);
     }
+
+    WD_EVENT_END("wdDrawString");
 }
 
 void
@@ -93,16 +153,36 @@ wdMeasureString(WD_HCANVAS hCanvas, WD_HFONT hFont, const WD_RECT* pRect,
                 const WCHAR* pszText, int iTextLength, WD_RECT* pResult,
                 DWORD dwFlags)
 {
-    if(d2d_enabled()) {
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_MEASURESTRING);
+        wd_capture_h(hCanvas);
+        wd_capture_h(hFont);
+        wd_capture_rect(pRect);
+        wd_capture_str(pszText, iTextLength);
+        wd_capture_u(dwFlags);
+        wd_capture_end();
+    }
+
+    WD_EVENT_BEGIN("wdMeasureString");
+
+    if(ops_enabled()) {
+        wd_backend_ops->fnMeasureString(ops_canvas(hCanvas), (void*) hFont, pRect,
+                    pszText, iTextLength, pResult, dwFlags);
+    } else if(d2d_enabled()) {
         dwrite_font_t* font = (dwrite_font_t*) hFont;
         dummy_IDWriteTextLayout* layout;
         dummy_DWRITE_TEXT_METRICS tm;
 
+        WD_EVENT_BEGIN("IDWriteFactory::CreateTextLayout");
         layout = dwrite_create_text_layout(font->tf, pRect, pszText, iTextLength, dwFlags);
+        WD_EVENT_END("IDWriteFactory::CreateTextLayout");
         if(layout == NULL) {
             WD_TRACE("wdMeasureString: dwrite_create_text_layout() failed.");
+            WD_EVENT_END("wdMeasureString");
             return;
         }
+        if(hCanvas != NULL)
+            ((d2d_canvas_t*) hCanvas)->stats.text_layouts++;
 
         dummy_IDWriteTextLayout_GetMetrics(layout, &tm);
 
@@ -123,13 +203,14 @@ wdMeasureString(WD_HCANVAS hCanvas, WD_HFONT hFont, const WD_RECT* pRect,
             c = (gdix_canvas_t*) hCanvas;
         } else {
             screen_dc = GetDCEx(NULL, NULL, DCX_CACHE);
-            c = gdix_canvas_alloc(screen_dc, NULL, pRect->x1 - pRect->x0, FALSE);
+            c = gdix_canvas_alloc(screen_dc, NULL, pRect->x1 - pRect->x0, 0);
             if(c == NULL) {
                 WD_TRACE("wdMeasureString: gdix_canvas_alloc() failed.");
                 pResult->x0 = 0.0f;
                 pResult->y0 = 0.0f;
                 pResult->x1 = 0.0f;
                 pResult->y1 = 0.0f;
+                WD_EVENT_END("wdMeasureString");
                 return;
             }
         }
@@ -161,6 +242,8 @@ wdMeasureString(WD_HCANVAS hCanvas, WD_HFONT hFont, const WD_RECT* pRect,
         pResult->x1 = br.x + br.w;
         pResult->y1 = br.y + br.h;
     }
+
+    WD_EVENT_END("wdMeasureString");
 }
 
 float
@@ -24,36 +24,59 @@
 
 #include "misc.h"
 #include "lock.h"
+#include "backend-ops.h"
 #include "backend-d2d.h"
 #include "backend-gdix.h"
+#include "capture.h"
+#include "dlist.h"
+#include "strokestyle.h"
 
 
-static WD_HSTROKESTYLE
-wdCreateStrokeStyleImpl(UINT dashStyle, const float* dashes, UINT dashesCount, UINT lineCap, UINT lineJoin)
+static void*
+wdCreateStrokeStyleImpl(UINT dashStyle, const float* dashes, UINT dashesCount,
+                        UINT lineCap, UINT lineJoin, float miterLimit)
 {
-    if(d2d_enabled()) {
+    if(ops_enabled()) {
+        void* s;
+
+        s = wd_backend_ops->fnCreateStrokeStyle(dashes, dashesCount, lineCap, lineJoin);
+        if(s == NULL) {
+            WD_TRACE("wdCreateStrokeStyleImpl: "
+                     "WD_BACKEND_OPS::fnCreateStrokeStyle() failed.");
+            return NULL;
+        }
+
+        if(miterLimit != WD_MITER_LIMIT) {
+            if(wd_backend_ops->fnSetStrokeStyleMiterLimit != NULL)
+                wd_backend_ops->fnSetStrokeStyleMiterLimit(s, miterLimit);
+            else
+                WD_TRACE("wdCreateStrokeStyleImpl: Miter limit not supported by the back-end.");
+        }
+        return s;
+    } else if(d2d_enabled()) {
         HRESULT hr;
         dummy_D2D1_STROKE_STYLE_PROPERTIES p;
         dummy_ID2D1StrokeStyle *s;
+        dummy_ID2D1Factory* factory;
 
         p.startCap = lineCap;
         p.endCap = lineCap;
         p.dashCap = lineCap;
         p.lineJoin = lineJoin;
-        p.miterLimit = 1.0f;
+        p.miterLimit = miterLimit;
         p.dashStyle = dashStyle;
         p.dashOffset = 0.0f;
 
-        wd_lock();
-        hr = dummy_ID2D1Factory_CreateStrokeStyle(d2d_factory, &p, dashes, dashesCount, &s);
-        wd_unlock();
+        factory = d2d_lock_factory(WD_LOCKSITE_CREATESTROKESTYLE);
+        hr = dummy_ID2D1Factory_CreateStrokeStyle(factory, &p, dashes, dashesCount, &s);
+        d2d_unlock_factory();
         if (FAILED(hr)) {
             WD_TRACE_HR("wdCreateStrokeStyleImpl: "
                         "ID2D1Factory::CreateStrokeStyle() failed.");
             return NULL;
         }
 
-        return (WD_HSTROKESTYLE)s;
+        return (void*) s;
     }
     else {
         gdix_strokestyle_t* s;
@@ -68,11 +91,84 @@ wdCreateStrokeStyleImpl(UINT dashStyle, const float* dashes, UINT dashesCount, U
         s->dashStyle = dashStyle;
         s->lineCap = lineCap;
         s->lineJoin = lineJoin;
+        s->miterLimit = miterLimit;
         s->dashesCount = dashesCount;
         if(dashesCount > 0)
             memcpy(s->dashes, dashes, dashesCount * sizeof(float));
 
-        return (WD_HSTROKESTYLE)s;
+        return (void*) s;
+    }
+}
+
+static void
+wdDestroyStrokeStyleImpl(void* backend)
+{
+    if(ops_enabled()) {
+        wd_backend_ops->fnDestroyStrokeStyle(backend);
+    } else if(d2d_enabled()) {
+        dummy_ID2D1StrokeStyle_Release((dummy_ID2D1StrokeStyle*) backend);
+    } else {
+        free((gdix_strokestyle_t*) backend);
+    }
+}
+
+static void
+wd_strokestyle_free(void* s)
+{
+    wdDestroyStrokeStyleImpl(wd_strokestyle_backend((WD_HSTROKESTYLE) s));
+    free(s);
+}
+
+static WD_HSTROKESTYLE
+wd_strokestyle_alloc(UINT dashStyle, const float* dashes, UINT dashesCount,
+                     UINT lineCap, UINT lineJoin, float miterLimit)
+{
+    static LONG last_serial = 0;
+    wd_strokestyle_t* s;
+
+    s = (wd_strokestyle_t*) malloc(
+            WD_OFFSETOF(wd_strokestyle_t, dashes) + dashesCount * sizeof(float));
+    if(s == NULL) {
+        WD_TRACE("wd_strokestyle_alloc: malloc() failed.");
+        return NULL;
+    }
+
+    s->backend = wdCreateStrokeStyleImpl(dashStyle, dashes, dashesCount,
+                                         lineCap, lineJoin, miterLimit);
+    if(s->backend == NULL) {
+        free(s);
+        return NULL;
+    }
+
+    s->serial = InterlockedIncrement(&last_serial);
+    s->line_cap = lineCap;
+    s->line_join = lineJoin;
+    s->miter_limit = miterLimit;
+    s->dash_count = dashesCount;
+    if(dashesCount > 0)
+        memcpy(s->dashes, dashes, dashesCount * sizeof(float));
+
+    return (WD_HSTROKESTYLE) s;
+}
+
+void
+wd_strokestyle_stroke(WD_HSTROKESTYLE hStrokeStyle, float width, sw_stroke_t* stroke)
+{
+    const wd_strokestyle_t* s = (const wd_strokestyle_t*) hStrokeStyle;
+
+    stroke->width = width;
+    if(s != NULL) {
+        stroke->line_cap = s->line_cap;
+        stroke->line_join = s->line_join;
+        stroke->miter_limit = s->miter_limit;
+        stroke->dashes = s->dashes;
+        stroke->dash_count = s->dash_count;
+    } else {
+        stroke->line_cap = WD_LINECAP_FLAT;
+        stroke->line_join = WD_LINEJOIN_MITER;
+        stroke->miter_limit = WD_MITER_LIMIT;
+        stroke->dashes = NULL;
+        stroke->dash_count = 0;
     }
 }
 
@@ -101,23 +197,84 @@ wdCreateStrokeStyle(UINT dashStyle, UINT lineCap, UINT lineJoin)
         { 5, pattern_dash_dot_dot, WD_SIZEOF_ARRAY(pattern_dash_dot_dot) }
     };
 
-    return wdCreateStrokeStyleImpl(style_data[dashStyle].style_id,
+    WD_HSTROKESTYLE s;
+
+    s = wd_strokestyle_alloc(style_data[dashStyle].style_id,
                 style_data[dashStyle].pattern, style_data[dashStyle].pattern_size,
-                lineCap, lineJoin);
+                lineCap, lineJoin, WD_MITER_LIMIT);
+
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_CREATESTROKESTYLE);
+        wd_capture_h_new(s);
+        wd_capture_u(dashStyle);
+        wd_capture_u(lineCap);
+        wd_capture_u(lineJoin);
+        wd_capture_end();
+    }
+
+    return s;
 }
 
 WD_HSTROKESTYLE 
 wdCreateStrokeStyleCustom(const float* dashes, UINT dashesCount, UINT lineCap, UINT lineJoin)
 {
-    return wdCreateStrokeStyleImpl(5 /* CUSTOM */, dashes, dashesCount, lineCap, lineJoin);
+    WD_HSTROKESTYLE s;
+
+    s = wd_strokestyle_alloc(5 /* CUSTOM */, dashes, dashesCount, lineCap, lineJoin, WD_MITER_LIMIT);
+
+    if(WD_CAPTURE_ACTIVE()) {
+        UINT i;
+
+        wd_capture_begin(WD_CAP_CREATESTROKESTYLECUSTOM);
+        wd_capture_h_new(s);
+        wd_capture_u(dashesCount);
+        for(i = 0; i < dashesCount; i++)
+            wd_capture_f(dashes[i]);
+        wd_capture_u(lineCap);
+        wd_capture_u(lineJoin);
+        wd_capture_end();
+    }
+
+    return s;
+}
+
+WD_HSTROKESTYLE
+wdCreateStrokeStyleEx(const float* dashes, UINT dashesCount, UINT lineCap, UINT lineJoin,
+                      float fMiterLimit)
+{
+    WD_HSTROKESTYLE s;
+
+    /* D2D requires at least 1.0; shorter miters would cut into the line. */
+    s = wd_strokestyle_alloc((dashesCount > 0 ? 5 /* CUSTOM */ : 0 /* SOLID */),
+                dashes, dashesCount, lineCap, lineJoin, WD_MAX(fMiterLimit, 1.0f));
+
+    if(WD_CAPTURE_ACTIVE()) {
+        UINT i;
+
+        wd_capture_begin(WD_CAP_CREATESTROKESTYLEEX);
+        wd_capture_h_new(s);
+        wd_capture_u(dashesCount);
+        for(i = 0; i < dashesCount; i++)
+            wd_capture_f(dashes[i]);
+        wd_capture_u(lineCap);
+        wd_capture_u(lineJoin);
+        wd_capture_f(fMiterLimit);
+        wd_capture_end();
+    }
+
+    return s;
 }
 
 void
 wdDestroyStrokeStyle(WD_HSTROKESTYLE hStrokeStyle)
 {
-    if(d2d_enabled()) {
-        dummy_ID2D1StrokeStyle_Release((dummy_ID2D1StrokeStyle*) hStrokeStyle);
-    } else {
-        free((gdix_strokestyle_t*) hStrokeStyle);
+    if(WD_CAPTURE_ACTIVE()) {
+        wd_capture_begin(WD_CAP_DESTROYSTROKESTYLE);
+        wd_capture_h_free(hStrokeStyle);
+        wd_capture_end();
     }
+
+    if(wd_dlist_defer_destroy(hStrokeStyle, wd_strokestyle_free))
+        return;
+    wd_strokestyle_free((void*) hStrokeStyle);
 }
@@ -0,0 +1,68 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef WD_STROKESTYLE_H
+#define WD_STROKESTYLE_H
+
+#include "misc.h"
+#include "swrast.h"
+
+
+/* WD_HSTROKESTYLE points to this structure. Next to the back-end object, it
+ * keeps what the style has been created from, so the CPU stroker (see
+ * wdPathStrokeContainsPoint()) can honor it whatever the back-end is. */
+typedef struct wd_strokestyle_tag wd_strokestyle_t;
+struct wd_strokestyle_tag {
+    void* backend;          /* Custom style, ID2D1StrokeStyle or gdix_strokestyle_t */
+    LONG serial;            /* Unique for the process lifetime; keys caches. */
+    UINT line_cap;
+    UINT line_join;
+    float miter_limit;
+    UINT dash_count;
+    float dashes[1];
+};
+
+static inline void*
+wd_strokestyle_backend(WD_HSTROKESTYLE hStrokeStyle)
+{
+    return (hStrokeStyle != NULL ? ((const wd_strokestyle_t*) hStrokeStyle)->backend : NULL);
+}
+
+/* Miter limit the style paints with, or 1.0 if it has no miter joins. NULL
+ * style means miter joins limited by WD_MITER_LIMIT. */
+static inline float
+wd_strokestyle_miter_limit(WD_HSTROKESTYLE hStrokeStyle)
+{
+    const wd_strokestyle_t* s = (const wd_strokestyle_t*) hStrokeStyle;
+
+    if(s == NULL)
+        return WD_MITER_LIMIT;
+    return (s->line_join == WD_LINEJOIN_MITER ? s->miter_limit : 1.0f);
+}
+
+/* Describes the stroke for sw_poly_stroke(). NULL style means solid line with
+ * flat caps and miter joins (limited by WD_MITER_LIMIT), as with the back-ends. */
+void wd_strokestyle_stroke(WD_HSTROKESTYLE hStrokeStyle, float width, sw_stroke_t* stroke);
+
+
+#endif  /* WD_STROKESTYLE_H */
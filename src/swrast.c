@@ -0,0 +1,1670 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "swrast.h"
+
+/* Define SW_NO_SSE2 to build the portable code only (the tests compare it
+ * with the SSE2 code). */
+#if !defined SW_NO_SSE2  &&  (defined __SSE2__  ||  defined _M_X64  ||  \
+                              (defined _M_IX86_FP  &&  _M_IX86_FP >= 2))
+    #define SW_SSE2     1
+    #include <emmintrin.h>
+#endif
+
+
+/*************************
+ ***  Path Primitives  ***
+ *************************/
+
+void
+sw_path_init(sw_path_t* path)
+{
+    memset(path, 0, sizeof(sw_path_t));
+}
+
+void
+sw_path_fini(sw_path_t* path)
+{
+    free(path->cmds);
+    free(path->points);
+}
+
+void
+sw_path_reset(sw_path_t* path)
+{
+    path->cmd_count = 0;
+    path->point_count = 0;
+    path->error = FALSE;
+}
+
+/* Makes room for n_cmds more commands with n points in total. */
+static BOOL
+sw_path_reserve(sw_path_t* path, UINT n_cmds, UINT n)
+{
+    if(path->error)
+        return FALSE;
+
+    if(path->cmd_count + n_cmds > path->cmd_capacity) {
+        UINT capacity = (path->cmd_capacity > 0 ? path->cmd_capacity * 2 : 16);
+        BYTE* cmds;
+
+        while(capacity < path->cmd_count + n_cmds)
+            capacity *= 2;
+
+        cmds = (BYTE*) realloc(path->cmds, capacity);
+        if(cmds == NULL) {
+            WD_TRACE("sw_path_reserve: realloc() failed.");
+            path->error = TRUE;
+            return FALSE;
+        }
+
+        path->cmds = cmds;
+        path->cmd_capacity = capacity;
+    }
+
+    if(path->point_count + n > path->point_capacity) {
+        UINT capacity = (path->point_capacity > 0 ? path->point_capacity * 2 : 32);
+        WD_POINT* points;
+
+        while(capacity < path->point_count + n)
+            capacity *= 2;
+
+        points = (WD_POINT*) realloc(path->points, capacity * sizeof(WD_POINT));
+        if(points == NULL) {
+            WD_TRACE("sw_path_reserve: realloc() failed.");
+            path->error = TRUE;
+            return FALSE;
+        }
+
+        path->points = points;
+        path->point_capacity = capacity;
+    }
+
+    return TRUE;
+}
+
+static void
+sw_path_add(sw_path_t* path, BYTE cmd, const WD_POINT* points, UINT n)
+{
+    if(!sw_path_reserve(path, 1, n))
+        return;
+
+    path->cmds[path->cmd_count++] = cmd;
+    if(n > 0) {
+        memcpy(path->points + path->point_count, points, n * sizeof(WD_POINT));
+        path->point_count += n;
+        path->current = points[n-1];
+    }
+}
+
+void
+sw_path_move_to(sw_path_t* path, float x, float y)
+{
+    WD_POINT pt = { x, y };
+    sw_path_add(path, SW_CMD_MOVE, &pt, 1);
+}
+
+void
+sw_path_line_to(sw_path_t* path, float x, float y)
+{
+    WD_POINT pt = { x, y };
+    sw_path_add(path, SW_CMD_LINE, &pt, 1);
+}
+
+void
+sw_path_cubic_to(sw_path_t* path, float x1, float y1,
+                 float x2, float y2, float x3, float y3)
+{
+    WD_POINT pts[3];
+
+    pts[0].x = x1;
+    pts[0].y = y1;
+    pts[1].x = x2;
+    pts[1].y = y2;
+    pts[2].x = x3;
+    pts[2].y = y3;
+    sw_path_add(path, SW_CMD_CUBIC, pts, 3);
+}
+
+void
+sw_path_close(sw_path_t* path)
+{
+    sw_path_add(path, SW_CMD_CLOSE, NULL, 0);
+}
+
+/* Appends n commands of the same kind, each taking k points. */
+static void
+sw_path_add_n(sw_path_t* path, BYTE cmd, UINT k, const WD_POINT* points, UINT n)
+{
+    if(n == 0  ||  !sw_path_reserve(path, n, k * n))
+        return;
+
+    memset(path->cmds + path->cmd_count, cmd, n);
+    path->cmd_count += n;
+    memcpy(path->points + path->point_count, points, k * n * sizeof(WD_POINT));
+    path->point_count += k * n;
+    path->current = points[k * n - 1];
+}
+
+void
+sw_path_lines_to(sw_path_t* path, const WD_POINT* points, UINT n)
+{
+    sw_path_add_n(path, SW_CMD_LINE, 1, points, n);
+}
+
+void
+sw_path_cubics_to(sw_path_t* path, const WD_POINT* points, UINT n)
+{
+    sw_path_add_n(path, SW_CMD_CUBIC, 3, points, n);
+}
+
+void
+sw_path_arc(sw_path_t* path, float cx, float cy, float rx, float ry,
+            float base_angle, float sweep_angle, BOOL move)
+{
+    float a0 = base_angle * (WD_PI / 180.0f);
+    float sweep = sweep_angle * (WD_PI / 180.0f);
+    float step, k, x, y;
+    int i, n;
+
+    if(sweep > 2.0f * WD_PI)
+        sweep = 2.0f * WD_PI;
+    else if(sweep < -2.0f * WD_PI)
+        sweep = -2.0f * WD_PI;
+
+    /* Each Bezier curve spans at most 90 degrees. */
+    n = (int) ceilf(WD_ABS(sweep) / (0.5f * WD_PI) - 0.001f);
+    if(n < 1)
+        n = 1;
+    step = sweep / (float) n;
+    k = (4.0f / 3.0f) * (float) tan((double) (step / 4.0f));
+
+    x = cx + rx * cosf(a0);
+    y = cy + ry * sinf(a0);
+    if(move  ||  path->cmd_count == 0) {
+        sw_path_move_to(path, x, y);
+    } else if(WD_ABS(x - path->current.x) > 0.001f  ||
+              WD_ABS(y - path->current.y) > 0.001f) {
+        sw_path_line_to(path, x, y);
+    }
+
+    for(i = 0; i < n; i++) {
+        float a1 = a0 + step;
+        float c0 = cosf(a0);
+        float s0 = sinf(a0);
+        float c1 = cosf(a1);
+        float s1 = sinf(a1);
+
+        sw_path_cubic_to(path,
+                cx + rx * (c0 - k * s0), cy + ry * (s0 + k * c0),
+                cx + rx * (c1 + k * s1), cy + ry * (s1 - k * c1),
+                cx + rx * c1, cy + ry * s1);
+        a0 = a1;
+    }
+}
+
+void
+sw_path_rect(sw_path_t* path, float x0, float y0, float x1, float y1)
+{
+    sw_path_move_to(path, x0, y0);
+    sw_path_line_to(path, x1, y0);
+    sw_path_line_to(path, x1, y1);
+    sw_path_line_to(path, x0, y1);
+    sw_path_close(path);
+}
+
+void
+sw_path_ellipse(sw_path_t* path, float cx, float cy, float rx, float ry)
+{
+    sw_path_arc(path, cx, cy, rx, ry, 0.0f, 360.0f, TRUE);
+    sw_path_close(path);
+}
+
+void
+sw_path_append(sw_path_t* path, const sw_path_t* src)
+{
+    if(src->error) {
+        path->error = TRUE;
+        return;
+    }
+    if(src->cmd_count == 0  ||  !sw_path_reserve(path, src->cmd_count, src->point_count))
+        return;
+
+    memcpy(path->cmds + path->cmd_count, src->cmds, src->cmd_count);
+    path->cmd_count += src->cmd_count;
+    memcpy(path->points + path->point_count, src->points,
+           src->point_count * sizeof(WD_POINT));
+    path->point_count += src->point_count;
+    path->current = src->current;
+}
+
+void
+sw_path_transform(sw_path_t* path, const WD_MATRIX* m)
+{
+    UINT i;
+
+    for(i = 0; i < path->point_count; i++) {
+        WD_POINT* pt = &path->points[i];
+        float x = pt->x * m->m11 + pt->y * m->m21 + m->dx;
+        float y = pt->x * m->m12 + pt->y * m->m22 + m->dy;
+
+        pt->x = x;
+        pt->y = y;
+    }
+
+    if(path->point_count > 0)
+        path->current = path->points[path->point_count - 1];
+}
+
+/* Extends [*p_min, *p_max] by the extremes of the 1D cubic Bezier curve with
+ * the given coordinates of the control points, i.e. by its values at the
+ * roots of the derivative in (0, 1). The end points are handled by the caller. */
+static void
+sw_cubic_extremes(float p0, float p1, float p2, float p3, float* p_min, float* p_max)
+{
+    /* B'(t) / 3 = a*t^2 + b*t + c */
+    float a = -p0 + 3.0f * (p1 - p2) + p3;
+    float b = 2.0f * (p0 - 2.0f * p1 + p2);
+    float c = p1 - p0;
+    float t[2];
+    int i, n = 0;
+
+    /* The control points inside the current range cannot extend it. */
+    if(p1 >= *p_min  &&  p1 <= *p_max  &&  p2 >= *p_min  &&  p2 <= *p_max)
+        return;
+
+    if(WD_ABS(a) < 1e-6f) {
+        if(WD_ABS(b) > 1e-6f)
+            t[n++] = -c / b;
+    } else {
+        float d = b * b - 4.0f * a * c;
+
+        if(d >= 0.0f) {
+            d = sqrtf(d);
+            t[n++] = (-b + d) / (2.0f * a);
+            t[n++] = (-b - d) / (2.0f * a);
+        }
+    }
+
+    for(i = 0; i < n; i++) {
+        float u, v;
+
+        if(t[i] <= 0.0f  ||  t[i] >= 1.0f)
+            continue;
+
+        u = 1.0f - t[i];
+        v = u * u * u * p0 + 3.0f * t[i] * u * (u * p1 + t[i] * p2) + t[i] * t[i] * t[i] * p3;
+        if(v < *p_min)
+            *p_min = v;
+        if(v > *p_max)
+            *p_max = v;
+    }
+}
+
+BOOL
+sw_path_bounds(const sw_path_t* path, WD_RECT* bounds)
+{
+    const WD_POINT* pt = path->points;
+    WD_POINT start, current;
+    UINT i;
+
+    if(path->point_count == 0) {
+        bounds->x0 = 0.0f;
+        bounds->y0 = 0.0f;
+        bounds->x1 = 0.0f;
+        bounds->y1 = 0.0f;
+        return FALSE;
+    }
+
+    /* The end points of all segments first ... */
+    bounds->x0 = bounds->x1 = pt[0].x;
+    bounds->y0 = bounds->y1 = pt[0].y;
+    for(i = 0; i < path->cmd_count; i++) {
+        switch(path->cmds[i]) {
+            case SW_CMD_MOVE:
+            case SW_CMD_LINE:   pt += 1; break;
+            case SW_CMD_CUBIC:  pt += 3; break;
+            default:            continue;
+        }
+
+        bounds->x0 = WD_MIN(bounds->x0, pt[-1].x);
+        bounds->y0 = WD_MIN(bounds->y0, pt[-1].y);
+        bounds->x1 = WD_MAX(bounds->x1, pt[-1].x);
+        bounds->y1 = WD_MAX(bounds->y1, pt[-1].y);
+    }
+
+    /* ... then whatever the curves bulge out of them. */
+    pt = path->points;
+    start = current = pt[0];
+    for(i = 0; i < path->cmd_count; i++) {
+        switch(path->cmds[i]) {
+            case SW_CMD_MOVE:
+                start = current = pt[0];
+                pt += 1;
+                break;
+
+            case SW_CMD_LINE:
+                current = pt[0];
+                pt += 1;
+                break;
+
+            case SW_CMD_CUBIC:
+                sw_cubic_extremes(current.x, pt[0].x, pt[1].x, pt[2].x, &bounds->x0, &bounds->x1);
+                sw_cubic_extremes(current.y, pt[0].y, pt[1].y, pt[2].y, &bounds->y0, &bounds->y1);
+                current = pt[2];
+                pt += 3;
+                break;
+
+            case SW_CMD_CLOSE:
+                current = start;
+                break;
+        }
+    }
+
+    return TRUE;
+}
+
+
+/***********************
+ ***  Flat Polygons  ***
+ ***********************/
+
+void
+sw_poly_init(sw_poly_t* poly)
+{
+    memset(poly, 0, sizeof(sw_poly_t));
+}
+
+void
+sw_poly_fini(sw_poly_t* poly)
+{
+    free(poly->points);
+    free(poly->contours);
+}
+
+void
+sw_poly_reset(sw_poly_t* poly)
+{
+    poly->point_count = 0;
+    poly->contour_count = 0;
+    poly->error = FALSE;
+}
+
+static inline UINT
+sw_poly_contour_start(const sw_poly_t* poly, UINT i)
+{
+    return (i > 0 ? poly->contours[i-1].end : 0);
+}
+
+/* Makes room for n more points. */
+static BOOL
+sw_poly_reserve(sw_poly_t* poly, UINT n)
+{
+    if(poly->point_count + n > poly->point_capacity) {
+        UINT capacity = (poly->point_capacity > 0 ? poly->point_capacity * 2 : 64);
+        WD_POINT* points;
+
+        if(poly->error)
+            return FALSE;
+
+        while(capacity < poly->point_count + n)
+            capacity *= 2;
+
+        points = (WD_POINT*) realloc(poly->points, capacity * sizeof(WD_POINT));
+        if(points == NULL) {
+            WD_TRACE("sw_poly_reserve: realloc() failed.");
+            poly->error = TRUE;
+            return FALSE;
+        }
+
+        poly->points = points;
+        poly->point_capacity = capacity;
+    }
+
+    return TRUE;
+}
+
+static void
+sw_poly_add_point(sw_poly_t* poly, float x, float y)
+{
+    if(poly->point_count >= poly->point_capacity  &&  !sw_poly_reserve(poly, 1))
+        return;
+
+    poly->points[poly->point_count].x = x;
+    poly->points[poly->point_count].y = y;
+    poly->point_count++;
+}
+
+/* Adds the point unless it is (almost) the same as the previous one of the
+ * current contour. */
+static void
+sw_poly_add_distinct_point(sw_poly_t* poly, float x, float y, float eps)
+{
+    UINT start = sw_poly_contour_start(poly, poly->contour_count);
+
+    if(poly->point_count > start) {
+        const WD_POINT* last = &poly->points[poly->point_count - 1];
+
+        if(WD_ABS(x - last->x) <= eps  &&  WD_ABS(y - last->y) <= eps)
+            return;
+    }
+
+    sw_poly_add_point(poly, x, y);
+}
+
+/* Ends the current contour, i.e. the points added since the previous one. */
+static void
+sw_poly_end_contour(sw_poly_t* poly, BOOL closed)
+{
+    if(poly->point_count == sw_poly_contour_start(poly, poly->contour_count))
+        return;
+
+    if(poly->contour_count >= poly->contour_capacity) {
+        UINT capacity = (poly->contour_capacity > 0 ? poly->contour_capacity * 2 : 8);
+        sw_contour_t* contours;
+
+        if(poly->error)
+            return;
+
+        contours = (sw_contour_t*) realloc(poly->contours, capacity * sizeof(sw_contour_t));
+        if(contours == NULL) {
+            WD_TRACE("sw_poly_end_contour: realloc() failed.");
+            poly->error = TRUE;
+            return;
+        }
+
+        poly->contours = contours;
+        poly->contour_capacity = capacity;
+    }
+
+    poly->contours[poly->contour_count].end = poly->point_count;
+    poly->contours[poly->contour_count].closed = closed;
+    poly->contour_count++;
+}
+
+/* Beyond this, the polygon may be farther than the tolerance from the curve;
+ * but only if the curve bends by about 10^8 times the tolerance. */
+#define SW_CUBIC_MAX_STEPS      16384
+
+/* Count of uniform steps to flatten the cubic curve within the tolerance. */
+static UINT
+sw_cubic_steps(const WD_POINT* p0, const WD_POINT* p, float tolerance)
+{
+    float ddx0 = p0->x - 2.0f * p[0].x + p[1].x;
+    float ddy0 = p0->y - 2.0f * p[0].y + p[1].y;
+    float ddx1 = p[0].x - 2.0f * p[1].x + p[2].x;
+    float ddy1 = p[0].y - 2.0f * p[1].y + p[2].y;
+    float dd = sqrtf(WD_MAX(ddx0 * ddx0 + ddy0 * ddy0, ddx1 * ddx1 + ddy1 * ddy1));
+    float n;
+
+    /* Wang's formula: The distance of the curve from its chords is at most
+     * 3/4 * dd / n^2 for n uniform steps. */
+    n = ceilf(sqrtf(0.75f * dd / tolerance));
+    if(!(n >= 1.0f))        /* (Also catches NaN.) */
+        return 1;
+    if(n > (float) SW_CUBIC_MAX_STEPS)
+        return SW_CUBIC_MAX_STEPS;
+    return (UINT) n;
+}
+
+static void
+sw_poly_add_cubic(sw_poly_t* poly, const WD_POINT* p0, const WD_POINT* p,
+                  float tolerance)
+{
+    UINT n = sw_cubic_steps(p0, p, tolerance);
+    float inv_n = 1.0f / (float) n;
+    WD_POINT* out;
+    float ax, ay, bx, by, cx, cy;
+    UINT i = 1;
+
+    if(!sw_poly_reserve(poly, n))
+        return;
+    out = poly->points + poly->point_count;
+
+    /* The power basis: B(t) = ((a * t + b) * t + c) * t + p0. Unlike forward
+     * differencing, it does not accumulate rounding errors over the steps. */
+    cx = 3.0f * (p[0].x - p0->x);
+    cy = 3.0f * (p[0].y - p0->y);
+    bx = 3.0f * (p[1].x - p[0].x) - cx;
+    by = 3.0f * (p[1].y - p[0].y) - cy;
+    ax = p[2].x - p0->x - cx - bx;
+    ay = p[2].y - p0->y - cy - by;
+
+#ifdef SW_SSE2
+    /* Two points, i.e. (x, y, x, y), at a time. */
+    if(n > 2) {
+        __m128 a = _mm_setr_ps(ax, ay, ax, ay);
+        __m128 b = _mm_setr_ps(bx, by, bx, by);
+        __m128 c = _mm_setr_ps(cx, cy, cx, cy);
+        __m128 d = _mm_setr_ps(p0->x, p0->y, p0->x, p0->y);
+        __m128 k = _mm_setr_ps(1.0f, 1.0f, 2.0f, 2.0f);
+        __m128 two = _mm_set1_ps(2.0f);
+        __m128 scale = _mm_set1_ps(inv_n);
+
+        for(; i + 1 < n; i += 2) {
+            __m128 t = _mm_mul_ps(k, scale);
+            __m128 v = _mm_add_ps(_mm_mul_ps(a, t), b);
+
+            v = _mm_add_ps(_mm_mul_ps(v, t), c);
+            v = _mm_add_ps(_mm_mul_ps(v, t), d);
+            _mm_storeu_ps(&out[i-1].x, v);
+            k = _mm_add_ps(k, two);
+        }
+    }
+#endif
+    for(; i < n; i++) {
+        float t = (float) i * inv_n;
+
+        out[i-1].x = ((ax * t + bx) * t + cx) * t + p0->x;
+        out[i-1].y = ((ay * t + by) * t + cy) * t + p0->y;
+    }
+
+    /* The end point exactly. */
+    out[n-1] = p[2];
+    poly->point_count += n;
+}
+
+void
+sw_poly_flatten(sw_poly_t* poly, const sw_path_t* path, float tolerance)
+{
+    const WD_POINT* pt = path->points;
+    WD_POINT current = { 0.0f, 0.0f };
+    BOOL open = FALSE;
+    UINT i;
+
+    for(i = 0; i < path->cmd_count; i++) {
+        switch(path->cmds[i]) {
+            case SW_CMD_MOVE:
+                if(open)
+                    sw_poly_end_contour(poly, FALSE);
+                sw_poly_add_point(poly, pt->x, pt->y);
+                current = *pt;
+                pt++;
+                open = TRUE;
+                break;
+
+            case SW_CMD_LINE:
+                sw_poly_add_point(poly, pt->x, pt->y);
+                current = *pt;
+                pt++;
+                open = TRUE;
+                break;
+
+            case SW_CMD_CUBIC:
+                sw_poly_add_cubic(poly, &current, pt, tolerance);
+                current = pt[2];
+                pt += 3;
+                open = TRUE;
+                break;
+
+            case SW_CMD_CLOSE:
+                if(open) {
+                    sw_poly_end_contour(poly, TRUE);
+                    open = FALSE;
+                }
+                break;
+        }
+    }
+
+    if(open)
+        sw_poly_end_contour(poly, FALSE);
+}
+
+void
+sw_poly_transform(sw_poly_t* poly, const WD_MATRIX* m)
+{
+    UINT i;
+
+    for(i = 0; i < poly->point_count; i++) {
+        WD_POINT* pt = &poly->points[i];
+        float x = pt->x * m->m11 + pt->y * m->m21 + m->dx;
+        float y = pt->x * m->m12 + pt->y * m->m22 + m->dy;
+
+        pt->x = x;
+        pt->y = y;
+    }
+}
+
+BOOL
+sw_poly_bounds(const sw_poly_t* poly, WD_RECT* bounds)
+{
+    UINT i;
+
+    if(poly->point_count == 0) {
+        bounds->x0 = 0.0f;
+        bounds->y0 = 0.0f;
+        bounds->x1 = 0.0f;
+        bounds->y1 = 0.0f;
+        return FALSE;
+    }
+
+    bounds->x0 = bounds->x1 = poly->points[0].x;
+    bounds->y0 = bounds->y1 = poly->points[0].y;
+    for(i = 1; i < poly->point_count; i++) {
+        bounds->x0 = WD_MIN(bounds->x0, poly->points[i].x);
+        bounds->y0 = WD_MIN(bounds->y0, poly->points[i].y);
+        bounds->x1 = WD_MAX(bounds->x1, poly->points[i].x);
+        bounds->y1 = WD_MAX(bounds->y1, poly->points[i].y);
+    }
+
+    return TRUE;
+}
+
+/* Contribution of the edge a -> b to the winding number around (x, y): the
+ * edge counts if it crosses the horizontal line through the point on its
+ * right side (the end points included only at the top). */
+static inline int
+sw_edge_winding(const WD_POINT* a, const WD_POINT* b, float x, float y)
+{
+    float cross = (b->x - a->x) * (y - a->y) - (x - a->x) * (b->y - a->y);
+
+    if(a->y <= y) {
+        if(b->y > y  &&  cross > 0.0f)
+            return +1;
+    } else {
+        if(b->y <= y  &&  cross < 0.0f)
+            return -1;
+    }
+
+    return 0;
+}
+
+int
+sw_poly_winding(const sw_poly_t* poly, float x, float y)
+{
+    const WD_POINT* pts = poly->points;
+    int winding = 0;
+    UINT i, c;
+
+    for(c = 0; c < poly->contour_count; c++) {
+        UINT start = sw_poly_contour_start(poly, c);
+        UINT end = poly->contours[c].end;
+
+        if(end - start < 2)
+            continue;
+
+        i = start;
+#ifdef SW_SSE2
+        if(end - start > 4) {
+            __m128 vx = _mm_set1_ps(x);
+            __m128 vy = _mm_set1_ps(y);
+            __m128 zero = _mm_setzero_ps();
+            __m128i acc = _mm_setzero_si128();
+            int sum[4];
+
+            /* Four edges at a time, from points[i .. i+3] to points[i+1 .. i+4].
+             * The comparison masks are -1 where true, so subtracting the
+             * upward mask and adding the downward one does the counting. */
+            for(; i + 4 < end; i += 4) {
+                __m128 a01 = _mm_loadu_ps(&pts[i].x);
+                __m128 a23 = _mm_loadu_ps(&pts[i+2].x);
+                __m128 b01 = _mm_loadu_ps(&pts[i+1].x);
+                __m128 b23 = _mm_loadu_ps(&pts[i+3].x);
+                __m128 ax = _mm_shuffle_ps(a01, a23, _MM_SHUFFLE(2,0,2,0));
+                __m128 ay = _mm_shuffle_ps(a01, a23, _MM_SHUFFLE(3,1,3,1));
+                __m128 bx = _mm_shuffle_ps(b01, b23, _MM_SHUFFLE(2,0,2,0));
+                __m128 by = _mm_shuffle_ps(b01, b23, _MM_SHUFFLE(3,1,3,1));
+                __m128 cross = _mm_sub_ps(
+                        _mm_mul_ps(_mm_sub_ps(bx, ax), _mm_sub_ps(vy, ay)),
+                        _mm_mul_ps(_mm_sub_ps(vx, ax), _mm_sub_ps(by, ay)));
+                __m128 a_le = _mm_cmple_ps(ay, vy);
+                __m128 b_le = _mm_cmple_ps(by, vy);
+                __m128 up = _mm_and_ps(_mm_andnot_ps(b_le, a_le), _mm_cmpgt_ps(cross, zero));
+                __m128 down = _mm_and_ps(_mm_andnot_ps(a_le, b_le), _mm_cmplt_ps(cross, zero));
+
+                acc = _mm_sub_epi32(acc, _mm_castps_si128(up));
+                acc = _mm_add_epi32(acc, _mm_castps_si128(down));
+            }
+
+            _mm_storeu_si128((__m128i*) sum, acc);
+            winding += sum[0] + sum[1] + sum[2] + sum[3];
+        }
+#endif
+        for(; i + 1 < end; i++)
+            winding += sw_edge_winding(&pts[i], &pts[i+1], x, y);
+        winding += sw_edge_winding(&pts[end-1], &pts[start], x, y);
+    }
+
+    return winding;
+}
+
+
+/******************
+ ***  Stroking  ***
+ ******************/
+
+typedef struct sw_stroker_tag sw_stroker_t;
+struct sw_stroker_tag {
+    sw_poly_t* poly;
+    float hw;           /* Half of the width. */
+    UINT line_cap;
+    UINT line_join;
+    float miter_limit;
+    float tolerance;
+};
+
+static void
+sw_direction(const WD_POINT* a, const WD_POINT* b, WD_POINT* d)
+{
+    float dx = b->x - a->x;
+    float dy = b->y - a->y;
+    float len = sqrtf(dx * dx + dy * dy);
+
+    d->x = dx / len;
+    d->y = dy / len;
+}
+
+static inline void
+sw_stroke_point(sw_stroker_t* s, const WD_POINT* p, float dx, float dy)
+{
+    sw_poly_add_point(s->poly, p->x + dx, p->y + dy);
+}
+
+/* Adds points on the arc around p, starting at p + (vx, vy) and rotating by
+ * the angle (in radians). The end points are not added. */
+static void
+sw_stroke_arc(sw_stroker_t* s, const WD_POINT* p, float vx, float vy, float angle)
+{
+    float step, c, sn, x, y;
+    int i, n;
+
+    if(s->tolerance < s->hw)
+        step = 2.0f * (float) acos((double) (1.0f - s->tolerance / s->hw));
+    else
+        step = 0.5f * WD_PI;
+
+    n = (int) ceilf(WD_ABS(angle) / step);
+    if(n < 2)
+        return;
+
+    c = cosf(angle / (float) n);
+    sn = sinf(angle / (float) n);
+    x = vx;
+    y = vy;
+    for(i = 1; i < n; i++) {
+        float t = x * c - y * sn;
+
+        y = x * sn + y * c;
+        x = t;
+        sw_stroke_point(s, p, x, y);
+    }
+}
+
+/* Adds the cap at the end p of a line going in the direction d, i.e. the
+ * points between p + n and p - n where n is the (scaled) normal of d. */
+static void
+sw_stroke_cap(sw_stroker_t* s, const WD_POINT* p, float dx, float dy)
+{
+    float nx = -dy * s->hw;
+    float ny = dx * s->hw;
+    float ex = dx * s->hw;
+    float ey = dy * s->hw;
+
+    switch(s->line_cap) {
+        case WD_LINECAP_SQUARE:
+            sw_stroke_point(s, p, nx + ex, ny + ey);
+            sw_stroke_point(s, p, -nx + ex, -ny + ey);
+            break;
+
+        case WD_LINECAP_ROUND:
+            sw_stroke_arc(s, p, nx, ny, -WD_PI);
+            break;
+
+        case WD_LINECAP_TRIANGLE:
+            sw_stroke_point(s, p, ex, ey);
+            break;
+
+        default:    /* WD_LINECAP_FLAT */
+            break;
+    }
+}
+
+/* Adds the offset points of the side (on the side of the normal) at the
+ * vertex p between segments of directions d0 and d1. */
+static void
+sw_stroke_join(sw_stroker_t* s, const WD_POINT* p, const WD_POINT* d0, const WD_POINT* d1)
+{
+    float hw = s->hw;
+    float n0x = -d0->y * hw;
+    float n0y = d0->x * hw;
+    float n1x = -d1->y * hw;
+    float n1y = d1->x * hw;
+    float cross = d0->x * d1->y - d0->y * d1->x;
+    float dot = d0->x * d1->x + d0->y * d1->y;
+
+    if(dot > 0.9999f) {
+        /* (Almost) straight: Typically a flattened curve. */
+        sw_stroke_point(s, p, 0.5f * (n0x + n1x), 0.5f * (n0y + n1y));
+        return;
+    }
+
+    if(cross > 0.0f) {
+        /* Inner side: Going through the vertex keeps the overlap of the two
+         * segments filled with the non-zero rule. */
+        sw_stroke_point(s, p, n0x, n0y);
+        sw_stroke_point(s, p, 0.0f, 0.0f);
+        sw_stroke_point(s, p, n1x, n1y);
+        return;
+    }
+
+    /* Outer side. */
+    sw_stroke_point(s, p, n0x, n0y);
+    switch(s->line_join) {
+        case WD_LINEJOIN_ROUND:
+            sw_stroke_arc(s, p, n0x, n0y, -WD_ABS(atan2f(cross, dot)));
+            break;
+
+        case WD_LINEJOIN_MITER:
+        {
+            float bx = n0x + n1x;
+            float by = n0y + n1y;
+            float blen = sqrtf(bx * bx + by * by);
+            float cos_half;
+
+            if(blen < 0.0001f * hw)
+                break;      /* Turning back: Same as bevel. */
+
+            bx /= blen;
+            by /= blen;
+            cos_half = (n0x * bx + n0y * by) / hw;
+            if(cos_half * s->miter_limit >= 1.0f) {
+                sw_stroke_point(s, p, bx * hw / cos_half, by * hw / cos_half);
+            } else {
+                /* Clip the miter at miter_limit * hw from the vertex. */
+                float lim = s->miter_limit * hw;
+                float t0 = (lim - (n0x * bx + n0y * by)) / (d0->x * bx + d0->y * by);
+                float t1 = (lim - (n1x * bx + n1y * by)) / -(d1->x * bx + d1->y * by);
+
+                sw_stroke_point(s, p, n0x + d0->x * t0, n0y + d0->y * t0);
+                sw_stroke_point(s, p, n1x - d1->x * t1, n1y - d1->y * t1);
+            }
+            break;
+        }
+
+        default:    /* WD_LINEJOIN_BEVEL */
+            break;
+    }
+    sw_stroke_point(s, p, n1x, n1y);
+}
+
+/* Open polyline of n distinct points: One contour going along one side,
+ * around the end cap, back along the other side and around the start cap. */
+static void
+sw_stroke_open(sw_stroker_t* s, const WD_POINT* pts, UINT n)
+{
+    float hw = s->hw;
+    WD_POINT d0, d1, first;
+    UINT i;
+
+    if(n == 1) {
+        /* A dot: Only the caps make it visible. */
+        if(s->line_cap == WD_LINECAP_FLAT)
+            return;
+        sw_stroke_point(s, &pts[0], 0.0f, hw);
+        sw_stroke_cap(s, &pts[0], 1.0f, 0.0f);
+        sw_stroke_point(s, &pts[0], 0.0f, -hw);
+        sw_stroke_cap(s, &pts[0], -1.0f, 0.0f);
+        sw_poly_end_contour(s->poly, TRUE);
+        return;
+    }
+
+    sw_direction(&pts[0], &pts[1], &first);
+    sw_stroke_point(s, &pts[0], -first.y * hw, first.x * hw);
+    d0 = first;
+    for(i = 1; i < n - 1; i++) {
+        sw_direction(&pts[i], &pts[i+1], &d1);
+        sw_stroke_join(s, &pts[i], &d0, &d1);
+        d0 = d1;
+    }
+
+    sw_stroke_point(s, &pts[n-1], -d0.y * hw, d0.x * hw);
+    sw_stroke_cap(s, &pts[n-1], d0.x, d0.y);
+    sw_stroke_point(s, &pts[n-1], d0.y * hw, -d0.x * hw);
+
+    d0.x = -d0.x;
+    d0.y = -d0.y;
+    for(i = n - 2; i >= 1; i--) {
+        sw_direction(&pts[i], &pts[i-1], &d1);
+        sw_stroke_join(s, &pts[i], &d0, &d1);
+        d0 = d1;
+    }
+
+    sw_stroke_point(s, &pts[0], first.y * hw, -first.x * hw);
+    sw_stroke_cap(s, &pts[0], -first.x, -first.y);
+    sw_poly_end_contour(s->poly, TRUE);
+}
+
+/* Closed polygon of n distinct points: Two contours, one for each side,
+ * going in opposite directions. */
+static void
+sw_stroke_closed(sw_stroker_t* s, const WD_POINT* pts, UINT n)
+{
+    WD_POINT d0, d1;
+    UINT i;
+
+    sw_direction(&pts[n-1], &pts[0], &d0);
+    for(i = 0; i < n; i++) {
+        sw_direction(&pts[i], &pts[(i+1) % n], &d1);
+        sw_stroke_join(s, &pts[i], &d0, &d1);
+        d0 = d1;
+    }
+    sw_poly_end_contour(s->poly, TRUE);
+
+    sw_direction(&pts[1], &pts[0], &d0);
+    for(i = n; i > 0; i--) {
+        sw_direction(&pts[i % n], &pts[i-1], &d1);
+        sw_stroke_join(s, &pts[i % n], &d0, &d1);
+        d0 = d1;
+    }
+    sw_poly_end_contour(s->poly, TRUE);
+}
+
+/* Copies contours of src into dst without repeated points. */
+static void
+sw_poly_copy_distinct(sw_poly_t* dst, const sw_poly_t* src, float eps)
+{
+    UINT i, j, start;
+
+    for(i = 0; i < src->contour_count; i++) {
+        UINT end = src->contours[i].end;
+        BOOL closed = src->contours[i].closed;
+        UINT first = dst->point_count;
+
+        start = sw_poly_contour_start(src, i);
+        for(j = start; j < end; j++)
+            sw_poly_add_distinct_point(dst, src->points[j].x, src->points[j].y, eps);
+
+        if(closed  &&  dst->point_count - first >= 2) {
+            const WD_POINT* a = &dst->points[first];
+            const WD_POINT* b = &dst->points[dst->point_count - 1];
+
+            if(WD_ABS(a->x - b->x) <= eps  &&  WD_ABS(a->y - b->y) <= eps)
+                dst->point_count--;
+        }
+        sw_poly_end_contour(dst, (closed  &&  dst->point_count - first >= 2));
+    }
+}
+
+/* Splits contours of src into open contours of dst, one for each dash. */
+static void
+sw_poly_dash(sw_poly_t* dst, const sw_poly_t* src, const sw_stroke_t* stroke, float eps)
+{
+    /* An odd pattern is used twice so dashes and spaces alternate. */
+    UINT cycle = (stroke->dash_count % 2 != 0 ? 2 * stroke->dash_count : stroke->dash_count);
+    UINT i, j;
+
+    for(i = 0; i < src->contour_count; i++) {
+        UINT start = sw_poly_contour_start(src, i);
+        UINT n = src->contours[i].end - start;
+        UINT seg_count = (src->contours[i].closed ? n : n - 1);
+        const WD_POINT* pts = src->points + start;
+        UINT k = 0;
+        float left = stroke->dashes[0] * stroke->width;
+        BOOL on = TRUE;
+
+        sw_poly_add_point(dst, pts[0].x, pts[0].y);
+        for(j = 0; j < seg_count; j++) {
+            const WD_POINT* a = &pts[j];
+            const WD_POINT* b = &pts[(j+1) % n];
+            float dx = b->x - a->x;
+            float dy = b->y - a->y;
+            float len = sqrtf(dx * dx + dy * dy);
+            float pos = 0.0f;
+
+            while(len - pos > left) {
+                float t;
+
+                pos += left;
+                t = pos / len;
+                if(on) {
+                    sw_poly_add_distinct_point(dst, a->x + dx * t, a->y + dy * t, eps);
+                    sw_poly_end_contour(dst, FALSE);
+                } else {
+                    sw_poly_add_point(dst, a->x + dx * t, a->y + dy * t);
+                }
+
+                on = !on;
+                k = (k + 1) % cycle;
+                left = stroke->dashes[k % stroke->dash_count] * stroke->width;
+            }
+
+            left -= len - pos;
+            if(on)
+                sw_poly_add_distinct_point(dst, b->x, b->y, eps);
+        }
+
+        if(on)
+            sw_poly_end_contour(dst, FALSE);
+    }
+}
+
+void
+sw_poly_stroke(sw_poly_t* poly, const sw_poly_t* src, const sw_stroke_t* stroke,
+               float tolerance, sw_poly_t* scratch)
+{
+    sw_stroker_t s;
+    float eps = 0.01f * tolerance;
+    float pattern = 0.0f;
+    UINT i;
+
+    if(!(stroke->width > 0.0f))
+        return;
+
+    s.poly = poly;
+    s.hw = 0.5f * stroke->width;
+    s.line_cap = stroke->line_cap;
+    s.line_join = stroke->line_join;
+    s.miter_limit = WD_MAX(stroke->miter_limit, 1.0f);
+    s.tolerance = tolerance;
+
+    for(i = 0; i < stroke->dash_count; i++)
+        pattern += stroke->dashes[i];
+
+    sw_poly_reset(scratch);
+    if(pattern > 0.0f)
+        sw_poly_dash(scratch, src, stroke, eps);
+    else
+        sw_poly_copy_distinct(scratch, src, eps);
+
+    for(i = 0; i < scratch->contour_count; i++) {
+        UINT start = sw_poly_contour_start(scratch, i);
+        UINT n = scratch->contours[i].end - start;
+
+        if(scratch->contours[i].closed)
+            sw_stroke_closed(&s, scratch->points + start, n);
+        else
+            sw_stroke_open(&s, scratch->points + start, n);
+    }
+
+    if(scratch->error)
+        poly->error = TRUE;
+}
+
+
+/********************
+ ***  Rasterizer  ***
+ ********************/
+
+/* The rasterizer computes the exact area of each pixel covered by the
+ * polygon: Every edge adds to the pixels it crosses the signed area between
+ * itself and the right pixel border, and to the first pixel on the right of
+ * them the rest of its height. The prefix sum over a row then yields the
+ * (winding-weighted) coverage of each pixel, without any sub-sampling. */
+
+void
+sw_rast_init(sw_rast_t* rast)
+{
+    memset(rast, 0, sizeof(sw_rast_t));
+}
+
+void
+sw_rast_fini(sw_rast_t* rast)
+{
+    free(rast->edges);
+    free(rast->active);
+    free(rast->acc);
+    free(rast->coverage);
+}
+
+static void
+sw_rast_add_edge(sw_rast_t* rast, float xa, float ya, float xb, float yb)
+{
+    sw_edge_t* e;
+    float dir = 1.0f;
+
+    if(ya == yb)
+        return;
+
+    /* Edges right of the clip box do not change any pixel inside it. */
+    if(xa >= rast->clip_x1  &&  xb >= rast->clip_x1)
+        return;
+
+    if(ya > yb) {
+        float tmp;
+
+        tmp = xa; xa = xb; xb = tmp;
+        tmp = ya; ya = yb; yb = tmp;
+        dir = -1.0f;
+    }
+
+    if(yb <= rast->clip_y0  ||  ya >= rast->clip_y1)
+        return;
+
+    /* Edges left of the clip box cover it all to their right, which is
+     * the same as if they were on its left border. */
+    xa = WD_MIN(WD_MAX(xa, rast->clip_x0), rast->clip_x1);
+    xb = WD_MIN(WD_MAX(xb, rast->clip_x0), rast->clip_x1);
+
+    if(rast->edge_count >= rast->edge_capacity) {
+        UINT capacity = (rast->edge_capacity > 0 ? rast->edge_capacity * 2 : 64);
+        sw_edge_t* edges;
+        UINT* active;
+
+        if(rast->error)
+            return;
+
+        edges = (sw_edge_t*) realloc(rast->edges, capacity * sizeof(sw_edge_t));
+        if(edges == NULL) {
+            WD_TRACE("sw_rast_add_edge: realloc() failed.");
+            rast->error = TRUE;
+            return;
+        }
+        rast->edges = edges;
+
+        active = (UINT*) realloc(rast->active, capacity * sizeof(UINT));
+        if(active == NULL) {
+            WD_TRACE("sw_rast_add_edge: realloc() failed.");
+            rast->error = TRUE;
+            return;
+        }
+        rast->active = active;
+
+        rast->edge_capacity = capacity;
+    }
+
+    e = &rast->edges[rast->edge_count++];
+    e->x0 = xa - rast->clip_x0;
+    e->y0 = ya;
+    e->y1 = yb;
+    e->dxdy = (xb - xa) / (yb - ya);
+    e->dir = dir;
+}
+
+/* Splits the line where it crosses the left or right border of the clip
+ * box, so that no part of it gets distorted by sw_rast_add_edge(). */
+static void
+sw_rast_add_line(sw_rast_t* rast, const WD_POINT* a, const WD_POINT* b)
+{
+    float border[2];
+    float xa = a->x, ya = a->y;
+    int i;
+
+    /* Split in the order in which the line crosses the borders. */
+    if(xa <= b->x) {
+        border[0] = rast->clip_x0;
+        border[1] = rast->clip_x1;
+    } else {
+        border[0] = rast->clip_x1;
+        border[1] = rast->clip_x0;
+    }
+
+    for(i = 0; i < 2; i++) {
+        float x = border[i];
+
+        if((xa < x  &&  b->x > x)  ||  (xa > x  &&  b->x < x)) {
+            float y = ya + (x - xa) * (b->y - ya) / (b->x - xa);
+
+            sw_rast_add_edge(rast, xa, ya, x, y);
+            xa = x;
+            ya = y;
+        }
+    }
+
+    sw_rast_add_edge(rast, xa, ya, b->x, b->y);
+}
+
+static int
+sw_edge_cmp(const void* a, const void* b)
+{
+    float ya = ((const sw_edge_t*) a)->y0;
+    float yb = ((const sw_edge_t*) b)->y0;
+
+    return (ya < yb ? -1 : (ya > yb ? 1 : 0));
+}
+
+/* Adds the edge part (xa at the top, xb at the bottom of the part) of the
+ * height d (negative for upward edges) to the accumulation buffer. */
+static void
+sw_rast_accumulate(float* acc, float xa, float xb, float d, int* xmin, int* xmax)
+{
+    float x0 = WD_MIN(xa, xb);
+    float x1 = WD_MAX(xa, xb);
+    float x0f = floorf(x0);
+    int x0i = (int) x0f;
+    int x1i = (int) ceilf(x1);
+
+    if(x0i < *xmin)
+        *xmin = x0i;
+
+    if(x1i <= x0i + 1) {
+        /* Within a single pixel. */
+        float xm = 0.5f * (xa + xb) - x0f;
+
+        acc[x0i] += d - d * xm;
+        acc[x0i + 1] += d * xm;
+        if(x0i + 1 > *xmax)
+            *xmax = x0i + 1;
+    } else {
+        float s = 1.0f / (x1 - x0);
+        float f0 = x0 - x0f;
+        float a0 = 0.5f * s * (1.0f - f0) * (1.0f - f0);
+        float f1 = x1 - (float) x1i + 1.0f;
+        float am = 0.5f * s * f1 * f1;
+        int xi;
+
+        acc[x0i] += d * a0;
+        if(x1i == x0i + 2) {
+            acc[x0i + 1] += d * (1.0f - a0 - am);
+        } else {
+            float a1 = s * (1.5f - f0);
+            float a2 = a1 + (float) (x1i - x0i - 3) * s;
+
+            acc[x0i + 1] += d * (a1 - a0);
+            for(xi = x0i + 2; xi < x1i - 1; xi++)
+                acc[xi] += d * s;
+            acc[x1i - 1] += d * (1.0f - a2 - am);
+        }
+        acc[x1i] += d * am;
+        if(x1i > *xmax)
+            *xmax = x1i;
+    }
+}
+
+static inline BYTE
+sw_coverage(float a, int fill_rule)
+{
+    a = WD_ABS(a);
+    if(a > 1.0f) {
+        if(fill_rule == SW_FILL_WINDING) {
+            a = 1.0f;
+        } else {
+            a -= 2.0f * floorf(0.5f * a);
+            if(a > 1.0f)
+                a = 2.0f - a;
+        }
+    }
+
+    return (BYTE) (a * 255.0f + 0.5f);
+}
+
+int
+sw_rasterize(sw_rast_t* rast, const sw_poly_t* poly, int fill_rule,
+             int x0, int y0, int x1, int y1, sw_span_fn fn, void* ctx)
+{
+    UINT width;
+    UINT i, j, start, next, active_count;
+    float ymax;
+    int y, y_start, y_end;
+
+    if(x1 <= x0  ||  y1 <= y0)
+        return 0;
+
+    width = (UINT) (x1 - x0);
+    rast->clip_x0 = (float) x0;
+    rast->clip_x1 = (float) x1;
+    rast->clip_y0 = (float) y0;
+    rast->clip_y1 = (float) y1;
+    rast->edge_count = 0;
+    rast->error = FALSE;
+
+    start = 0;
+    for(i = 0; i < poly->contour_count; i++) {
+        UINT end = poly->contours[i].end;
+        const WD_POINT* pts = poly->points;
+
+        if(end - start >= 2) {
+            for(j = start; j < end - 1; j++)
+                sw_rast_add_line(rast, &pts[j], &pts[j+1]);
+            sw_rast_add_line(rast, &pts[end-1], &pts[start]);
+        }
+        start = end;
+    }
+
+    if(rast->error)
+        return -1;
+    if(rast->edge_count == 0)
+        return 0;
+
+    /* The accumulation buffer is kept zeroed between the calls. */
+    if(width + 2 > rast->row_capacity) {
+        free(rast->acc);
+        free(rast->coverage);
+        rast->acc = (float*) calloc(width + 2, sizeof(float));
+        rast->coverage = (BYTE*) malloc(width + 2);
+        if(rast->acc == NULL  ||  rast->coverage == NULL) {
+            WD_TRACE("sw_rasterize: malloc() failed.");
+            free(rast->acc);
+            free(rast->coverage);
+            rast->acc = NULL;
+            rast->coverage = NULL;
+            rast->row_capacity = 0;
+            return -1;
+        }
+        rast->row_capacity = width + 2;
+    }
+
+    qsort(rast->edges, rast->edge_count, sizeof(sw_edge_t), sw_edge_cmp);
+
+    ymax = rast->edges[0].y1;
+    for(i = 1; i < rast->edge_count; i++) {
+        if(rast->edges[i].y1 > ymax)
+            ymax = rast->edges[i].y1;
+    }
+    y_start = WD_MAX(y0, (int) floorf(rast->edges[0].y0));
+    y_end = WD_MIN(y1, (int) ceilf(ymax));
+
+    next = 0;
+    active_count = 0;
+    for(y = y_start; y < y_end; y++) {
+        float* acc = rast->acc;
+        BYTE* coverage = rast->coverage;
+        float row_y0 = (float) y;
+        float row_y1 = (float) (y + 1);
+        int xmin = (int) width + 2;
+        int xmax = -1;
+        int x, x_last, x_end;
+        float sum;
+
+        while(next < rast->edge_count  &&  rast->edges[next].y0 < row_y1)
+            rast->active[active_count++] = next++;
+
+        i = 0;
+        while(i < active_count) {
+            const sw_edge_t* e = &rast->edges[rast->active[i]];
+            float ya = WD_MAX(e->y0, row_y0);
+            float yb = WD_MIN(e->y1, row_y1);
+
+            if(yb > ya) {
+                float xa = e->x0 + (ya - e->y0) * e->dxdy;
+                float xb = e->x0 + (yb - e->y0) * e->dxdy;
+
+                xa = WD_MIN(WD_MAX(xa, 0.0f), (float) width);
+                xb = WD_MIN(WD_MAX(xb, 0.0f), (float) width);
+                sw_rast_accumulate(acc, xa, xb, (yb - ya) * e->dir, &xmin, &xmax);
+            }
+
+            if(e->y1 <= row_y1)
+                rast->active[i] = rast->active[--active_count];
+            else
+                i++;
+        }
+
+        if(xmax < 0)
+            continue;
+
+        sum = 0.0f;
+        x_last = WD_MIN(xmax, (int) width - 1);
+        for(x = xmin; x <= x_last; x++) {
+            sum += acc[x];
+            acc[x] = 0.0f;
+            coverage[x] = sw_coverage(sum, fill_rule);
+        }
+        for(; x <= xmax; x++)
+            acc[x] = 0.0f;
+
+        /* The shape may continue up to the right border of the clip box. */
+        x_end = x_last + 1;
+        if(x_end < (int) width  &&  sw_coverage(sum, fill_rule) != 0) {
+            memset(coverage + x_end, sw_coverage(sum, fill_rule), width - x_end);
+            x_end = (int) width;
+        }
+
+        if(x_end > xmin)
+            fn(ctx, y, x0 + xmin, x0 + x_end, coverage + xmin);
+    }
+
+    return 0;
+}
+
+void
+sw_spans_init(sw_spans_t* spans)
+{
+    memset(spans, 0, sizeof(sw_spans_t));
+}
+
+void
+sw_spans_fini(sw_spans_t* spans)
+{
+    free(spans->spans);
+    free(spans->coverage);
+}
+
+static void
+sw_spans_record(void* ctx, int y, int x0, int x1, BYTE* coverage)
+{
+    sw_spans_t* spans = (sw_spans_t*) ctx;
+    sw_span_t* span;
+    UINT n;
+
+    while(x0 < x1  &&  coverage[0] == 0) {
+        coverage++;
+        x0++;
+    }
+    while(x1 > x0  &&  coverage[x1 - x0 - 1] == 0)
+        x1--;
+    if(x0 >= x1  ||  spans->error)
+        return;
+    n = (UINT) (x1 - x0);
+
+    if(spans->span_count >= spans->span_capacity) {
+        UINT capacity = (spans->span_capacity > 0 ? spans->span_capacity * 2 : 64);
+        sw_span_t* tmp;
+
+        tmp = (sw_span_t*) realloc(spans->spans, capacity * sizeof(sw_span_t));
+        if(tmp == NULL) {
+            WD_TRACE("sw_spans_record: realloc() failed.");
+            spans->error = TRUE;
+            return;
+        }
+        spans->spans = tmp;
+        spans->span_capacity = capacity;
+    }
+
+    if(spans->coverage_size + n > spans->coverage_capacity) {
+        UINT capacity = (spans->coverage_capacity > 0 ? spans->coverage_capacity * 2 : 4096);
+        BYTE* tmp;
+
+        while(capacity < spans->coverage_size + n)
+            capacity *= 2;
+        tmp = (BYTE*) realloc(spans->coverage, capacity);
+        if(tmp == NULL) {
+            WD_TRACE("sw_spans_record: realloc() failed.");
+            spans->error = TRUE;
+            return;
+        }
+        spans->coverage = tmp;
+        spans->coverage_capacity = capacity;
+    }
+
+    span = &spans->spans[spans->span_count++];
+    span->y = y;
+    span->x0 = x0;
+    span->x1 = x1;
+    span->offset = spans->coverage_size;
+    memcpy(spans->coverage + spans->coverage_size, coverage, n);
+    spans->coverage_size += n;
+}
+
+int
+sw_rasterize_spans(sw_rast_t* rast, const sw_poly_t* poly, int fill_rule,
+                   int x0, int y0, int x1, int y1, sw_spans_t* spans)
+{
+    if(sw_rasterize(rast, poly, fill_rule, x0, y0, x1, y1, sw_spans_record, spans) != 0)
+        return -1;
+    return (spans->error ? -1 : 0);
+}
+
+
+/*********************
+ ***  Compositing  ***
+ *********************/
+
+/* Exact x / 255 (rounded) for x <= 255 * 255, both in the SIMD code and
+ * in the plain C one, so the results do not depend on the path taken. */
+static inline UINT32
+sw_scale(UINT32 p, UINT k)
+{
+    UINT32 rb = (p & 0x00ff00ff) * k + 0x00800080;
+    UINT32 ag = ((p >> 8) & 0x00ff00ff) * k + 0x00800080;
+
+    rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+    ag = (ag + ((ag >> 8) & 0x00ff00ff)) & 0xff00ff00;
+    return rb | ag;
+}
+
+static inline UINT32
+sw_add_saturate(UINT32 a, UINT32 b)
+{
+    UINT32 rb = (a & 0x00ff00ff) + (b & 0x00ff00ff);
+    UINT32 ag = ((a >> 8) & 0x00ff00ff) + ((b >> 8) & 0x00ff00ff);
+
+    rb |= ((rb >> 8) & 0x00010001) * 0xff;
+    ag |= ((ag >> 8) & 0x00010001) * 0xff;
+    return (rb & 0x00ff00ff) | ((ag & 0x00ff00ff) << 8);
+}
+
+static inline UINT32
+sw_over(UINT32 dst, UINT32 src, UINT coverage)
+{
+    if(coverage != 255)
+        src = sw_scale(src, coverage);
+    return sw_add_saturate(src, sw_scale(dst, 255 - (src >> 24)));
+}
+
+UINT32
+sw_premultiply(WD_COLOR color)
+{
+    UINT a = WD_AVALUE(color);
+
+    return (a << 24) | (sw_scale(color, a) & 0x00ffffff);
+}
+
+#ifdef SW_SSE2
+static inline __m128i
+sw_div255_epi16(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/* Expands 4 coverage bytes to the 16-bit channels of 2 + 2 pixels. */
+static inline void
+sw_expand_coverage(UINT32 c4, __m128i* lo, __m128i* hi)
+{
+    __m128i v = _mm_cvtsi32_si128((int) c4);
+
+    v = _mm_unpacklo_epi8(v, _mm_setzero_si128());
+    v = _mm_unpacklo_epi16(v, v);
+    *lo = _mm_unpacklo_epi32(v, v);
+    *hi = _mm_unpackhi_epi32(v, v);
+}
+
+/* Source-over of two pixels in 16-bit channels. */
+static inline __m128i
+sw_over_epi16(__m128i dst, __m128i src, __m128i coverage)
+{
+    __m128i alpha;
+
+    src = sw_div255_epi16(_mm_mullo_epi16(src, coverage));
+    alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, 0xff), 0xff);
+    alpha = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+    return _mm_add_epi16(src, sw_div255_epi16(_mm_mullo_epi16(dst, alpha)));
+}
+#endif
+
+void
+sw_blend_solid(UINT32* dst, UINT32 color, const BYTE* coverage, int n)
+{
+    BOOL opaque = ((color >> 24) == 255);
+    int i = 0;
+
+#ifdef SW_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i color4 = _mm_set1_epi32((int) color);
+    __m128i src = _mm_unpacklo_epi8(color4, zero);
+
+    for(; i + 4 <= n; i += 4) {
+        __m128i d, lo, hi, clo, chi;
+        UINT32 c4;
+
+        memcpy(&c4, coverage + i, 4);
+        if(c4 == 0)
+            continue;
+        if(c4 == 0xffffffff  &&  opaque) {
+            _mm_storeu_si128((__m128i*) (dst + i), color4);
+            continue;
+        }
+
+        sw_expand_coverage(c4, &clo, &chi);
+        d = _mm_loadu_si128((const __m128i*) (dst + i));
+        lo = sw_over_epi16(_mm_unpacklo_epi8(d, zero), src, clo);
+        hi = sw_over_epi16(_mm_unpackhi_epi8(d, zero), src, chi);
+        _mm_storeu_si128((__m128i*) (dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for(; i < n; i++) {
+        if(coverage[i] == 0)
+            continue;
+        if(coverage[i] == 255  &&  opaque)
+            dst[i] = color;
+        else
+            dst[i] = sw_over(dst[i], color, coverage[i]);
+    }
+}
+
+void
+sw_blend_span(UINT32* dst, const UINT32* src, const BYTE* coverage, int n)
+{
+    int i = 0;
+
+#ifdef SW_SSE2
+    __m128i zero = _mm_setzero_si128();
+
+    for(; i + 4 <= n; i += 4) {
+        __m128i s, d, lo, hi, clo, chi;
+        UINT32 c4;
+
+        memcpy(&c4, coverage + i, 4);
+        if(c4 == 0)
+            continue;
+
+        sw_expand_coverage(c4, &clo, &chi);
+        s = _mm_loadu_si128((const __m128i*) (src + i));
+        d = _mm_loadu_si128((const __m128i*) (dst + i));
+        lo = sw_over_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), clo);
+        hi = sw_over_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), chi);
+        _mm_storeu_si128((__m128i*) (dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for(; i < n; i++) {
+        if(coverage[i] != 0)
+            dst[i] = sw_over(dst[i], src[i], coverage[i]);
+    }
+}
+
+void
+sw_blend_copy(UINT32* dst, UINT32 color, const BYTE* coverage, int n)
+{
+    int i;
+
+    for(i = 0; i < n; i++) {
+        UINT k = coverage[i];
+
+        if(k == 255)
+            dst[i] = color;
+        else if(k != 0)
+            dst[i] = sw_add_saturate(sw_scale(color, k), sw_scale(dst[i], 255 - k));
+    }
+}
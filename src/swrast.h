@@ -0,0 +1,247 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef WD_SWRAST_H
+#define WD_SWRAST_H
+
+#include "misc.h"
+
+
+/* The rasterizer of the software back-end (see backend-sw.h). It knows
+ * nothing about canvases or brushes: paths are flattened into polygons,
+ * strokes are turned into polygons, and polygons into rows of coverage
+ * which the caller composites with sw_blend_solid() or sw_blend_span().
+ *
+ * Pixels are 32-bit pre-multiplied BGRA, i.e. 0xAARRGGBB in a UINT32. */
+
+
+/*************************
+ ***  Path Primitives  ***
+ *************************/
+
+#define SW_CMD_MOVE     0   /* 1 point */
+#define SW_CMD_LINE     1   /* 1 point */
+#define SW_CMD_CUBIC    2   /* 3 points */
+#define SW_CMD_CLOSE    3   /* 0 points */
+
+/* Path as recorded by the path sink. Arcs are stored as cubic Bezier
+ * curves, so the path stays exact under any affine transformation. */
+typedef struct sw_path_tag sw_path_t;
+struct sw_path_tag {
+    BYTE* cmds;
+    UINT cmd_count;
+    UINT cmd_capacity;
+    WD_POINT* points;
+    UINT point_count;
+    UINT point_capacity;
+    WD_POINT current;
+    int fill_rule;      /* SW_FILL_xxx; sw_path_init() sets SW_FILL_ALTERNATE. */
+    BOOL error;         /* Set when an allocation has failed. */
+};
+
+void sw_path_init(sw_path_t* path);
+void sw_path_fini(sw_path_t* path);
+void sw_path_reset(sw_path_t* path);
+
+void sw_path_move_to(sw_path_t* path, float x, float y);
+void sw_path_line_to(sw_path_t* path, float x, float y);
+void sw_path_cubic_to(sw_path_t* path, float x1, float y1,
+                      float x2, float y2, float x3, float y3);
+void sw_path_close(sw_path_t* path);
+
+/* Bulk variants of sw_path_line_to() and sw_path_cubic_to(), taking n and
+ * 3 * n points respectively. */
+void sw_path_lines_to(sw_path_t* path, const WD_POINT* points, UINT n);
+void sw_path_cubics_to(sw_path_t* path, const WD_POINT* points, UINT n);
+
+/* Elliptic arc (angles in degrees, as in wdDrawEllipseArc()). If move is
+ * set, it starts a new figure; otherwise it continues the current one. */
+void sw_path_arc(sw_path_t* path, float cx, float cy, float rx, float ry,
+                 float base_angle, float sweep_angle, BOOL move);
+
+void sw_path_rect(sw_path_t* path, float x0, float y0, float x1, float y1);
+void sw_path_ellipse(sw_path_t* path, float cx, float cy, float rx, float ry);
+
+void sw_path_append(sw_path_t* path, const sw_path_t* src);
+void sw_path_transform(sw_path_t* path, const WD_MATRIX* matrix);
+
+/* Exact bounding box of the path, curves included. Returns FALSE (and an empty
+ * rectangle at the origin) if the path has no points. */
+BOOL sw_path_bounds(const sw_path_t* path, WD_RECT* bounds);
+
+
+/***********************
+ ***  Flat Polygons  ***
+ ***********************/
+
+typedef struct sw_contour_tag sw_contour_t;
+struct sw_contour_tag {
+    UINT end;           /* Index after the last point of the contour. */
+    BOOL closed;
+};
+
+/* Contours made of straight segments only. For filling, every contour is
+ * closed implicitly; the closed flag matters only for stroking. */
+typedef struct sw_poly_tag sw_poly_t;
+struct sw_poly_tag {
+    WD_POINT* points;
+    UINT point_count;
+    UINT point_capacity;
+    sw_contour_t* contours;
+    UINT contour_count;
+    UINT contour_capacity;
+    BOOL error;         /* Set when an allocation has failed. */
+};
+
+void sw_poly_init(sw_poly_t* poly);
+void sw_poly_fini(sw_poly_t* poly);
+void sw_poly_reset(sw_poly_t* poly);
+
+/* Appends the path, with curves flattened so that no point of them is
+ * farther than the tolerance from the polygon. */
+#define SW_TOLERANCE    0.2f    /* Default; max. error in device pixels. */
+
+void sw_poly_flatten(sw_poly_t* poly, const sw_path_t* path, float tolerance);
+
+void sw_poly_transform(sw_poly_t* poly, const WD_MATRIX* matrix);
+
+/* Returns FALSE (and an empty rectangle at the origin) if there are no points. */
+BOOL sw_poly_bounds(const sw_poly_t* poly, WD_RECT* bounds);
+
+/* Winding number of all the contours (each closed implicitly) around the
+ * point: odd means inside for SW_FILL_ALTERNATE, non-zero for SW_FILL_WINDING. */
+int sw_poly_winding(const sw_poly_t* poly, float x, float y);
+
+typedef struct sw_stroke_tag sw_stroke_t;
+struct sw_stroke_tag {
+    float width;
+    UINT line_cap;          /* WD_LINECAP_xxx */
+    UINT line_join;         /* WD_LINEJOIN_xxx */
+    float miter_limit;      /* In the units of half the width. */
+    const float* dashes;    /* In the units of the width. */
+    UINT dash_count;        /* Zero for solid lines. */
+};
+
+/* Appends the outline of the stroke of all contours of the source polygon
+ * to the target one, to be filled with SW_FILL_WINDING. The tolerance is
+ * used for round joins and caps. The scratch polygon is used for the dashes. */
+void sw_poly_stroke(sw_poly_t* poly, const sw_poly_t* src, const sw_stroke_t* stroke,
+                    float tolerance, sw_poly_t* scratch);
+
+
+/********************
+ ***  Rasterizer  ***
+ ********************/
+
+#define SW_FILL_ALTERNATE   0   /* Even-odd rule, as for paths in D2D and GDI+. */
+#define SW_FILL_WINDING     1   /* Non-zero rule. */
+
+/* Called for each row touched by the polygon with the coverage of pixels
+ * x0 .. x1-1. The callback may modify the coverage buffer. */
+typedef void (*sw_span_fn)(void* ctx, int y, int x0, int x1, BYTE* coverage);
+
+typedef struct sw_edge_tag sw_edge_t;
+struct sw_edge_tag {
+    float x0;       /* x at y0, relative to the left of the clip box. */
+    float y0;       /* y0 < y1 */
+    float y1;
+    float dxdy;
+    float dir;      /* +1.0f downwards, -1.0f upwards */
+};
+
+/* Scratch buffers, reused from call to call. */
+typedef struct sw_rast_tag sw_rast_t;
+struct sw_rast_tag {
+    sw_edge_t* edges;
+    UINT edge_count;
+    UINT edge_capacity;
+    UINT* active;
+    float* acc;
+    BYTE* coverage;
+    UINT row_capacity;
+    BOOL error;         /* Set when an allocation has failed. */
+
+    /* Clip box of the current sw_rasterize() call. */
+    float clip_x0;
+    float clip_x1;
+    float clip_y0;
+    float clip_y1;
+};
+
+void sw_rast_init(sw_rast_t* rast);
+void sw_rast_fini(sw_rast_t* rast);
+
+/* Computes the exact area coverage of every pixel of the clip box
+ * (x0, y0, x1, y1) by the polygon (in device coordinates) and hands it over
+ * row by row to the callback. Returns -1 on allocation failure. */
+int sw_rasterize(sw_rast_t* rast, const sw_poly_t* poly, int fill_rule,
+                 int x0, int y0, int x1, int y1, sw_span_fn fn, void* ctx);
+
+
+/* Coverage rows recorded by sw_rasterize_spans(), to be painted again later,
+ * possibly shifted by whole pixels (the coverage does not change then). */
+typedef struct sw_span_tag sw_span_t;
+struct sw_span_tag {
+    int y;
+    int x0;
+    int x1;
+    UINT offset;        /* Of the coverage of x0 in sw_spans_t::coverage. */
+};
+
+typedef struct sw_spans_tag sw_spans_t;
+struct sw_spans_tag {
+    sw_span_t* spans;
+    UINT span_count;
+    UINT span_capacity;
+    BYTE* coverage;
+    UINT coverage_size;
+    UINT coverage_capacity;
+    BOOL error;         /* Set when an allocation has failed. */
+};
+
+void sw_spans_init(sw_spans_t* spans);
+void sw_spans_fini(sw_spans_t* spans);
+
+/* Like sw_rasterize() but appends the rows to the span list instead of
+ * handing them over to a callback. Pixels without any coverage at either end
+ * of a row are not stored. */
+int sw_rasterize_spans(sw_rast_t* rast, const sw_poly_t* poly, int fill_rule,
+                       int x0, int y0, int x1, int y1, sw_spans_t* spans);
+
+
+/*********************
+ ***  Compositing  ***
+ *********************/
+
+UINT32 sw_premultiply(WD_COLOR color);
+
+/* Source-over compositing of n pixels, each weighted by its coverage. */
+void sw_blend_solid(UINT32* dst, UINT32 color, const BYTE* coverage, int n);
+void sw_blend_span(UINT32* dst, const UINT32* src, const BYTE* coverage, int n);
+
+/* Source compositing (the color replaces the destination) of n pixels,
+ * each weighted by its coverage. */
+void sw_blend_copy(UINT32* dst, UINT32 color, const BYTE* coverage, int n);
+
+
+#endif  /* WD_SWRAST_H */
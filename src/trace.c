@@ -0,0 +1,313 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "misc.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+    #include <time.h>
+    #include <unistd.h>
+#endif
+
+
+#ifndef WD_THREAD_LOCAL
+    #ifdef _MSC_VER
+        #define WD_THREAD_LOCAL     __declspec(thread)
+    #else
+        #define WD_THREAD_LOCAL     __thread
+    #endif
+#endif
+
+/* Each ring is written only by its owner thread. The head is published with
+ * a release store so that wd_trace_dump() never sees an event which is not
+ * fully written (unless it has been overwritten since, which is acceptable
+ * for a diagnostic tool). */
+#ifdef _MSC_VER
+    /* MSVC gives volatile accesses acquire/release semantics. */
+    #define WD_TRACE_LOAD(ptr)          (*(ptr))
+    #define WD_TRACE_STORE(ptr, val)    (*(ptr) = (val))
+    #define WD_TRACE_CAS(ptr, old, val)                                         \
+            (InterlockedCompareExchangePointer((void* volatile*)(ptr), (val), (old)) == (old))
+    #define WD_TRACE_INC(ptr)           InterlockedIncrement((volatile LONG*)(ptr))
+#else
+    #define WD_TRACE_LOAD(ptr)          __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+    #define WD_TRACE_STORE(ptr, val)    __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+    #define WD_TRACE_CAS(ptr, old, val)                                         \
+            __sync_bool_compare_and_swap((ptr), (old), (val))
+    #define WD_TRACE_INC(ptr)           __sync_add_and_fetch((ptr), 1)
+#endif
+
+
+typedef struct wd_trace_rec_tag wd_trace_rec_t;
+struct wd_trace_rec_tag {
+    const char* name;
+    wd_trace_ts_t ts;
+    char phase;
+};
+
+typedef struct wd_trace_ring_tag wd_trace_ring_t;
+struct wd_trace_ring_tag {
+    wd_trace_ring_t* volatile next;
+    unsigned long tid;
+    volatile unsigned head;     /* Count of events ever written. */
+    volatile unsigned tail;     /* Events below this are forgotten. */
+    wd_trace_rec_t recs[WD_TRACE_RING_SIZE];
+};
+
+
+volatile int wd_trace_enabled = 0;
+
+/* List of rings of all threads which have ever recorded anything. The rings
+ * are never freed as the threads keep pointers to them; a thread which has
+ * exited still contributes its events to the dump. */
+static wd_trace_ring_t* volatile wd_trace_rings = NULL;
+
+static WD_THREAD_LOCAL wd_trace_ring_t* wd_trace_ring = NULL;
+
+
+static wd_trace_ts_t
+wd_trace_now(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER t;
+
+    QueryPerformanceCounter(&t);
+    return (wd_trace_ts_t) t.QuadPart;
+#else
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (wd_trace_ts_t) t.tv_sec * 1000000000 + (wd_trace_ts_t) t.tv_nsec;
+#endif
+}
+
+static double
+wd_trace_to_us(wd_trace_ts_t ts)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq;
+
+    QueryPerformanceFrequency(&freq);
+    return (double) ts * 1000000.0 / (double) freq.QuadPart;
+#else
+    return (double) ts / 1000.0;
+#endif
+}
+
+static unsigned long
+wd_trace_pid(void)
+{
+#ifdef _WIN32
+    return (unsigned long) GetCurrentProcessId();
+#else
+    return (unsigned long) getpid();
+#endif
+}
+
+static wd_trace_ring_t*
+wd_trace_ring_alloc(void)
+{
+    static volatile long tid_counter = 0;
+    wd_trace_ring_t* ring;
+    wd_trace_ring_t* next;
+
+    ring = (wd_trace_ring_t*) malloc(sizeof(wd_trace_ring_t));
+    if(ring == NULL)
+        return NULL;
+
+    memset(ring, 0, sizeof(wd_trace_ring_t));
+#ifdef _WIN32
+    (void) tid_counter;
+    ring->tid = (unsigned long) GetCurrentThreadId();
+#else
+    ring->tid = (unsigned long) WD_TRACE_INC(&tid_counter);
+#endif
+
+    do {
+        next = WD_TRACE_LOAD(&wd_trace_rings);
+        ring->next = next;
+    } while(!WD_TRACE_CAS(&wd_trace_rings, next, ring));
+
+    return ring;
+}
+
+void
+wd_trace_event(const char* name, char phase)
+{
+    wd_trace_ring_t* ring = wd_trace_ring;
+    wd_trace_rec_t* rec;
+    unsigned head;
+
+    if(ring == NULL) {
+        ring = wd_trace_ring_alloc();
+        if(ring == NULL)
+            return;
+        wd_trace_ring = ring;
+    }
+
+    head = ring->head;
+    rec = &ring->recs[head & (WD_TRACE_RING_SIZE - 1)];
+    rec->name = name;
+    rec->ts = wd_trace_now();
+    rec->phase = phase;
+    WD_TRACE_STORE(&ring->head, head + 1);
+}
+
+void
+wd_trace_enable(int enable)
+{
+    wd_trace_enabled = (enable ? 1 : 0);
+}
+
+void
+wd_trace_reset(void)
+{
+    wd_trace_ring_t* ring;
+
+    for(ring = WD_TRACE_LOAD(&wd_trace_rings); ring != NULL; ring = ring->next)
+        ring->tail = WD_TRACE_LOAD(&ring->head);
+}
+
+static void
+wd_trace_dump_name(FILE* f, const char* name)
+{
+    fputc('"', f);
+    for(; *name != '\0'; name++) {
+        if(*name == '"'  ||  *name == '\\')
+            fputc('\\', f);
+        if((unsigned char) *name >= 0x20)
+            fputc(*name, f);
+    }
+    fputc('"', f);
+}
+
+int
+wd_trace_dump(FILE* f)
+{
+    unsigned long pid = wd_trace_pid();
+    wd_trace_ring_t* ring;
+    wd_trace_ts_t origin = 0;
+    int have_origin = 0;
+    int first = 1;
+
+    /* Find the oldest event so the timestamps start at zero. */
+    for(ring = WD_TRACE_LOAD(&wd_trace_rings); ring != NULL; ring = ring->next) {
+        unsigned head = WD_TRACE_LOAD(&ring->head);
+        unsigned tail = ring->tail;
+
+        if(head - tail > WD_TRACE_RING_SIZE)
+            tail = head - WD_TRACE_RING_SIZE;
+        if(tail != head) {
+            wd_trace_ts_t ts = ring->recs[tail & (WD_TRACE_RING_SIZE - 1)].ts;
+            if(!have_origin  ||  ts < origin) {
+                origin = ts;
+                have_origin = 1;
+            }
+        }
+    }
+
+    fputs("{\"traceEvents\":[", f);
+
+    for(ring = WD_TRACE_LOAD(&wd_trace_rings); ring != NULL; ring = ring->next) {
+        unsigned head = WD_TRACE_LOAD(&ring->head);
+        unsigned tail = ring->tail;
+        unsigned depth = 0;
+        unsigned i;
+
+        if(head - tail > WD_TRACE_RING_SIZE)
+            tail = head - WD_TRACE_RING_SIZE;
+
+        for(i = tail; i != head; i++) {
+            const wd_trace_rec_t* rec = &ring->recs[i & (WD_TRACE_RING_SIZE - 1)];
+
+            /* Skip ends whose begins have been overwritten already. */
+            if(rec->phase == WD_TRACE_PHASE_END) {
+                if(depth == 0)
+                    continue;
+                depth--;
+            } else {
+                depth++;
+            }
+
+            fputs(first ? "\n" : ",\n", f);
+            first = 0;
+            fputs("{\"name\":", f);
+            wd_trace_dump_name(f, rec->name);
+            fprintf(f, ",\"cat\":\"wd\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%lu,\"tid\":%lu}",
+                    rec->phase, wd_trace_to_us(rec->ts - origin), pid, ring->tid);
+        }
+    }
+
+    fputs("\n],\"displayTimeUnit\":\"ns\"}\n", f);
+    return (ferror(f) ? -1 : 0);
+}
+
+
+void
+wdEnableTrace(BOOL bEnable)
+{
+    wd_trace_enable(bEnable);
+}
+
+void
+wdResetTrace(void)
+{
+    wd_trace_reset();
+}
+
+BOOL
+wdDumpTrace(const WCHAR* pszPath)
+{
+    FILE* f;
+    int err;
+
+#ifdef _WIN32
+    f = _wfopen(pszPath, L"w");
+#else
+    {
+        char buffer[1024];
+
+        if(wcstombs(buffer, pszPath, sizeof(buffer)) >= sizeof(buffer))
+            f = NULL;
+        else
+            f = fopen(buffer, "w");
+    }
+#endif
+    if(f == NULL) {
+        WD_TRACE("wdDumpTrace: Cannot open the file.");
+        return FALSE;
+    }
+
+    err = wd_trace_dump(f);
+    if(fclose(f) != 0)
+        err = -1;
+    if(err != 0) {
+        WD_TRACE("wdDumpTrace: Writing the file failed.");
+        return FALSE;
+    }
+
+    return TRUE;
+}
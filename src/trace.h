@@ -0,0 +1,81 @@
+/*
+ * WinDrawLib
+ * Copyright (c) 2015-2016 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef WD_TRACE_H
+#define WD_TRACE_H
+
+/* The event recorder and the exporter do not depend on <windows.h>, so they
+ * work on any platform. (Only the public wrappers like wdDumpTrace() take
+ * Win32 types.) */
+#include <stdio.h>
+
+
+#ifdef _MSC_VER
+    typedef unsigned __int64 wd_trace_ts_t;
+#else
+    #include <stdint.h>
+    typedef uint64_t wd_trace_ts_t;
+#endif
+
+
+/* Maximal count of events remembered per thread. Older events are
+ * overwritten. Must be a power of two. */
+#define WD_TRACE_RING_SIZE      4096
+
+#define WD_TRACE_PHASE_BEGIN    'B'
+#define WD_TRACE_PHASE_END      'E'
+
+
+extern volatile int wd_trace_enabled;
+
+/* Records an event into the ring buffer of the calling thread. The name must
+ * be a string with a static lifetime, only the pointer is stored. */
+void wd_trace_event(const char* name, char phase);
+
+/* Enables or disables the recording. */
+void wd_trace_enable(int enable);
+
+/* Forgets all recorded events. */
+void wd_trace_reset(void);
+
+/* Writes all recorded events as Chrome trace event JSON (loadable by
+ * chrome://tracing or Perfetto). Returns 0 on success. */
+int wd_trace_dump(FILE* f);
+
+
+/* Instrumentation of the public API and of the expensive back-end calls.
+ * When tracing is disabled, each of these costs a single load and branch. */
+#define WD_EVENT_BEGIN(name)                                                    \
+            do {                                                                \
+                if(wd_trace_enabled)                                            \
+                    wd_trace_event((name), WD_TRACE_PHASE_BEGIN);               \
+            } while(0)
+
+#define WD_EVENT_END(name)                                                      \
+            do {                                                                \
+                if(wd_trace_enabled)                                            \
+                    wd_trace_event((name), WD_TRACE_PHASE_END);                 \
+            } while(0)
+
+
+#endif  /* WD_TRACE_H */
@@ -0,0 +1,161 @@
+/*
+ * Tests of WD_CANVAS_CACHED on top of the Direct2D and GDI+ stand-ins: The
+ * cached canvas of a window is handed out again after the window is resized,
+ * with the world transformation of the application kept and the culling
+ * following the new size, and it is destroyed together with the window.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+#include "standin.h"
+
+
+static WD_HCANVAS
+begin_paint(HWND win, PAINTSTRUCT* ps, DWORD flags)
+{
+    WD_HCANVAS canvas;
+
+    memset(ps, 0, sizeof(PAINTSTRUCT));
+    ps->hdc = GetDC(win);
+    GetClientRect(win, &ps->rcPaint);
+
+    canvas = wdCreateCanvasWithPaintStruct(win, ps, flags);
+    if(canvas != NULL)
+        wdBeginPaint(canvas);
+    return canvas;
+}
+
+static void
+end_paint(HWND win, PAINTSTRUCT* ps, WD_HCANVAS canvas)
+{
+    TEST_CHECK(wdEndPaint(canvas));
+    wdDestroyCanvas(canvas);
+    ReleaseDC(win, ps->hdc);
+}
+
+/* Fills a rectangle spanning x0 ... x1 and returns whether it has been
+ * culled. */
+static BOOL
+culled(WD_HCANVAS canvas, WD_HBRUSH brush, float x0, float x1)
+{
+    WD_CULLSTATS before;
+    WD_CULLSTATS after;
+
+    wdGetCullStats(canvas, &before);
+    wdFillRect(canvas, brush, x0, 10.0f, x1, 30.0f);
+    wdGetCullStats(canvas, &after);
+    return (after.uCulled > before.uCulled);
+}
+
+static void
+check_transform(WD_HCANVAS canvas, const WD_MATRIX* expected, const char* what)
+{
+    WD_MATRIX m;
+
+    wdGetWorldTransform(canvas, &m);
+    TEST_CHECK_MSG(memcmp(&m, expected, sizeof(WD_MATRIX)) == 0,
+                   "%s: world transform [%g %g %g %g %g %g], expected "
+                   "[%g %g %g %g %g %g]", what, (double) m.m11, (double) m.m12,
+                   (double) m.m21, (double) m.m22, (double) m.dx, (double) m.dy,
+                   (double) expected->m11, (double) expected->m12,
+                   (double) expected->m21, (double) expected->m22,
+                   (double) expected->dx, (double) expected->dy);
+}
+
+static void
+test_window(HWND win, DWORD flags)
+{
+    PAINTSTRUCT ps;
+    WD_HCANVAS first;
+    WD_HCANVAS canvas;
+    WD_HBRUSH brush;
+    WD_MATRIX matrix;
+    UINT64 calls;
+
+    flags |= WD_CANVAS_CACHED | WD_CANVAS_CULLING;
+
+    MoveWindow(win, 0, 0, 200, 100, FALSE);
+    first = begin_paint(win, &ps, flags);
+    if(first == NULL) {
+        TEST_CHECK_MSG(0, "Cannot create the canvas.");
+        return;
+    }
+    wdTranslateWorld(first, 10.0f, 20.0f);
+    wdGetWorldTransform(first, &matrix);
+    brush = wdCreateSolidBrush(first, WD_RGB(255, 0, 0));
+    TEST_CHECK(!culled(first, brush, 150.0f, 180.0f));
+    TEST_CHECK(culled(first, brush, 220.0f, 250.0f));
+    wdDestroyBrush(brush);
+    end_paint(win, &ps, first);
+
+    /* Grow. */
+    MoveWindow(win, 0, 0, 400, 150, FALSE);
+    canvas = begin_paint(win, &ps, flags);
+    TEST_CHECK_MSG(canvas == first, "The canvas has not been cached.");
+    if(canvas == NULL)
+        return;
+    check_transform(canvas, &matrix, "grown");
+    brush = wdCreateSolidBrush(canvas, WD_RGB(255, 0, 0));
+    TEST_CHECK(!culled(canvas, brush, 300.0f, 350.0f));
+    TEST_CHECK(culled(canvas, brush, 450.0f, 500.0f));
+    wdDestroyBrush(brush);
+    end_paint(win, &ps, canvas);
+
+    /* Shrink. */
+    MoveWindow(win, 0, 0, 120, 150, FALSE);
+    canvas = begin_paint(win, &ps, flags);
+    TEST_CHECK_MSG(canvas == first, "The canvas has not been cached.");
+    if(canvas == NULL)
+        return;
+    check_transform(canvas, &matrix, "shrunk");
+    brush = wdCreateSolidBrush(canvas, WD_RGB(255, 0, 0));
+    TEST_CHECK(!culled(canvas, brush, 50.0f, 80.0f));
+    TEST_CHECK(culled(canvas, brush, 150.0f, 200.0f));
+    wdDestroyBrush(brush);
+    end_paint(win, &ps, canvas);
+
+    /* The canvas has to go away with the window, not with some later
+     * WM_PAINT. */
+    calls = standin_calls;
+    DestroyWindow(win);
+    TEST_CHECK_MSG(standin_calls > calls,
+                   "The canvas has not been destroyed with the window.");
+}
+
+static void
+test_backend(const char* name, DWORD preinit_flags, int backend, UINT_PTR win)
+{
+    printf("%s\n", name);
+
+    wdPreInitialize(NULL, NULL, preinit_flags);
+    if(!wdInitialize(0)  ||  wdBackend() != backend) {
+        TEST_CHECK_MSG(0, "%s: Cannot initialize the back-end.", name);
+        return;
+    }
+
+    test_window((HWND) (win + 1), 0);
+    test_window((HWND) (win + 2), WD_CANVAS_LAYOUTRTL);
+
+    /* Canvases of live windows are destroyed by wdTerminate(). */
+    {
+        PAINTSTRUCT ps;
+        WD_HCANVAS canvas;
+
+        canvas = begin_paint((HWND) (win + 3), &ps, WD_CANVAS_CACHED);
+        if(canvas != NULL)
+            end_paint((HWND) (win + 3), &ps, canvas);
+    }
+
+    wdTerminate(0);
+    wdPreInitialize(NULL, NULL, 0);
+}
+
+int
+main(int argc, char** argv)
+{
+    test_backend("Direct2D", 0, WD_BACKEND_D2D, 0x100);
+    test_backend("GDI+", WD_DISABLE_D2D, WD_BACKEND_GDIPLUS, 0x200);
+    return test_result("cache");
+}
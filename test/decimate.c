@@ -0,0 +1,227 @@
+/*
+ * Tests of wdDrawPolylineDecimated() with the software back-end: Time series
+ * are painted both decimated and with all the points (wdDrawPolylineStyled()),
+ * and the pixels are compared with each other and with a reference painted
+ * with all the points at SS times the resolution and scaled down.
+ *
+ * The reference is needed for the dense series: With many points per pixel,
+ * the anti-aliased edges of the overlapping segments add up, so painting all
+ * the points makes the edges darker than they are (at SS times the resolution
+ * the edges are SS times thinner) and single pixels differ a lot from the
+ * decimated polyline. What is checked for them is the mean difference from
+ * the reference, which may not be much worse than with all the points. The
+ * sparse series have to stay within the limits documented in wdl.h.
+ *
+ * Usage: decimate [-v]
+ *
+ * With -v, the differences of each case are reported.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+
+
+#define W               256
+#define H               128
+#define SS              4
+
+/* The limits documented with wdDrawPolylineDecimated() for the sparse
+ * series (out of 255): WD_DECIMATE_MINMAX changes nothing, WD_DECIMATE_RDP
+ * moves the edges by a quarter of a pixel at most. */
+#define MAX_DIFF_MINMAX 0
+#define MAX_DIFF_RDP    64
+
+/* How much farther (out of 255, on average over all the pixels) the
+ * decimated dense series may be from the reference than all the points. */
+#define MEAN_SLACK_MINMAX   1.0
+#define MEAN_SLACK_RDP      3.0
+
+
+static int verbose = 0;
+static unsigned random_state = 12345;
+
+static float
+random_unit(void)
+{
+    random_state = random_state * 1103515245U + 12345U;
+    return (float) ((random_state >> 8) & 0xffff) / 65535.0f - 0.5f;
+}
+
+/* Random walk, many points per pixel. */
+static void
+gen_walk(WD_POINT* points, UINT n)
+{
+    float y = H / 2;
+    UINT i;
+
+    for(i = 0; i < n; i++) {
+        y += random_unit() * 3.0f;
+        if(y < 8.0f)
+            y = 8.0f;
+        else if(y > H - 8)
+            y = (float) (H - 8);
+        points[i].x = 4.0f + (float) i * (W - 8) / (float) n;
+        points[i].y = y;
+    }
+}
+
+/* Noisy sine, many points per pixel. */
+static void
+gen_noisy_sine(WD_POINT* points, UINT n)
+{
+    UINT i;
+
+    for(i = 0; i < n; i++) {
+        float x = (float) i / (float) n;
+
+        points[i].x = 4.0f + x * (W - 8);
+        points[i].y = H / 2 + 40.0f * sinf(x * 20.0f) + 10.0f * random_unit();
+    }
+}
+
+/* Smooth sine, several pixels per point. */
+static void
+gen_sine(WD_POINT* points, UINT n)
+{
+    UINT i;
+
+    for(i = 0; i < n; i++) {
+        float x = (float) i / (float) n;
+
+        points[i].x = 4.0f + x * (W - 8);
+        points[i].y = H / 2 + 50.0f * sinf(x * 9.0f);
+    }
+}
+
+/* Paints the polyline with all the points (mode -1) or decimated, magnified
+ * ss times. */
+static void
+paint(test_canvas_t* tc, const WD_POINT* points, UINT n, float width,
+      float scale, float ss, int mode)
+{
+    WD_HBRUSH brush;
+    WD_MATRIX m = { 0 };
+
+    m.m11 = scale * ss;
+    m.m22 = ss;
+
+    wdBeginPaint(tc->canvas);
+    wdClear(tc->canvas, WD_RGB(255, 255, 255));
+    wdSetWorldTransform(tc->canvas, &m);
+    brush = wdCreateSolidBrush(tc->canvas, WD_RGB(0, 0, 0));
+    if(mode < 0)
+        wdDrawPolylineStyled(tc->canvas, brush, points, n, width, NULL);
+    else
+        wdDrawPolylineDecimated(tc->canvas, brush, points, n, width, (UINT) mode);
+    wdDestroyBrush(brush);
+    wdEndPaint(tc->canvas);
+}
+
+/* Mean difference of the (gray) pixels from the reference, out of 255. */
+static double
+mean_diff(const test_canvas_t* tc, const float* ref)
+{
+    double sum = 0.0;
+    UINT i;
+
+    for(i = 0; i < W * H; i++)
+        sum += fabs((double) (tc->pixels[i] & 0xff) - (double) ref[i]);
+    return sum / (W * H);
+}
+
+static void
+test_case(const char* name, void (*gen)(WD_POINT*, UINT), UINT n, float width,
+          float scale, BOOL sparse)
+{
+    static const char* mode_names[] = { "minmax", "rdp" };
+    static const int max_diff[] = { MAX_DIFF_MINMAX, MAX_DIFF_RDP };
+    static const double mean_slack[] = { MEAN_SLACK_MINMAX, MEAN_SLACK_RDP };
+    test_canvas_t full;
+    test_canvas_t decimated;
+    test_canvas_t big;
+    WD_POINT* points;
+    float* ref;
+    double full_mean;
+    UINT x, y, i;
+    int mode;
+
+    points = (WD_POINT*) malloc(n * sizeof(WD_POINT));
+    ref = (float*) calloc(W * H, sizeof(float));
+    if(points == NULL  ||  ref == NULL  ||  test_canvas_init(&full, W, H, 0) != 0  ||
+       test_canvas_init(&decimated, W, H, 0) != 0  ||
+       test_canvas_init(&big, W * SS, H * SS, 0) != 0)
+    {
+        fprintf(stderr, "Out of memory.\n");
+        exit(1);
+    }
+    gen(points, n);
+
+    paint(&big, points, n, width, scale, (float) SS, -1);
+    for(y = 0; y < H * SS; y++) {
+        for(x = 0; x < W * SS; x++)
+            ref[(y / SS) * W + x / SS] += (float) (big.pixels[y * W * SS + x] & 0xff);
+    }
+    for(i = 0; i < W * H; i++)
+        ref[i] /= (float) (SS * SS);
+
+    paint(&full, points, n, width, scale, 1.0f, -1);
+    full_mean = mean_diff(&full, ref);
+
+    for(mode = WD_DECIMATE_MINMAX; mode <= WD_DECIMATE_RDP; mode++) {
+        double mean;
+        int diff;
+
+        paint(&decimated, points, n, width, scale, 1.0f, mode);
+        mean = mean_diff(&decimated, ref);
+        diff = test_canvas_maxdiff(&decimated, &full);
+
+        if(verbose) {
+            printf("%-12s %-6s width %g, scale %g: max. difference %d, "
+                   "mean difference from the reference %.2f (all the points "
+                   "%.2f)\n", name, mode_names[mode], (double) width,
+                   (double) scale, diff, mean, full_mean);
+        }
+        if(!sparse) {
+            TEST_CHECK_MSG(mean <= full_mean + mean_slack[mode],
+                           "%s (%s, width %g, scale %g): mean difference from "
+                           "the reference %.2f, with all the points %.2f",
+                           name, mode_names[mode], (double) width,
+                           (double) scale, mean, full_mean);
+        } else {
+            TEST_CHECK_MSG(diff <= max_diff[mode],
+                           "%s (%s, width %g, scale %g): max. difference %d",
+                           name, mode_names[mode], (double) width,
+                           (double) scale, diff);
+        }
+    }
+
+    test_canvas_fini(&big);
+    test_canvas_fini(&decimated);
+    test_canvas_fini(&full);
+    free(ref);
+    free(points);
+}
+
+int
+main(int argc, char** argv)
+{
+    if(argc > 1  &&  strcmp(argv[1], "-v") == 0)
+        verbose = 1;
+
+    test_init_software();
+
+    test_case("walk", gen_walk, 50000, 1.0f, 1.0f, FALSE);
+    test_case("walk", gen_walk, 50000, 3.0f, 1.0f, FALSE);
+    test_case("walk", gen_walk, 5000, 1.0f, 1.0f, FALSE);
+    test_case("noisy-sine", gen_noisy_sine, 50000, 1.0f, 1.0f, FALSE);
+    test_case("noisy-sine", gen_noisy_sine, 20000, 2.0f, 0.5f, FALSE);
+    test_case("sine", gen_sine, 500, 1.0f, 1.0f, TRUE);
+    test_case("sine", gen_sine, 2000, 1.5f, 1.0f, TRUE);
+
+    test_fini_software();
+    return test_result("decimate");
+}
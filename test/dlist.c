@@ -0,0 +1,315 @@
+/*
+ * Tests of display lists (see wdBeginRecording()) with the software back-end:
+ * A replayed list has to paint what the direct calls paint, even after the
+ * application has destroyed all the resources the list uses. (Run it under
+ * AddressSanitizer to catch any use after free.) The clips of the list stay
+ * within those of the caller.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+
+
+#define W       96
+#define H       96
+
+#define BRUSHES 200
+
+
+typedef struct resources_tag resources_t;
+struct resources_tag {
+    WD_HBRUSH brush;
+    WD_HBRUSH brush2;
+    WD_HPATH path;
+    WD_HSTROKESTYLE style;
+    WD_HIMAGE image;
+    WD_HCACHEDIMAGE cached_image;
+    WD_HREALIZEDFILL fill;
+    WD_HFONT font;
+};
+
+static BOOL
+create_resources(WD_HCANVAS canvas, resources_t* res)
+{
+    static const float dashes[] = { 3.0f, 2.0f };
+    UINT32 pixels[4 * 4];
+    WD_PATHSINK sink;
+    LOGFONTW lf;
+    int i;
+
+    for(i = 0; i < 16; i++)
+        pixels[i] = ((i + i / 4) & 1) ? 0xff20c040 : 0xffe0e0e0;
+
+    memset(&lf, 0, sizeof(LOGFONTW));
+    lf.lfHeight = -12;
+    wcscpy(lf.lfFaceName, L"Tahoma");
+
+    memset(res, 0, sizeof(resources_t));
+    res->brush = wdCreateSolidBrush(canvas, WD_RGB(0, 0, 160));
+    res->brush2 = wdCreateSolidBrush(canvas, WD_RGB(200, 0, 0));
+    res->path = wdCreatePath(canvas);
+    res->style = wdCreateStrokeStyleEx(dashes, 2, WD_LINECAP_ROUND, WD_LINEJOIN_ROUND, 4.0f);
+    res->image = wdCreateImageFromBuffer(4, 4, 4 * 4, (BYTE*) pixels,
+                        WD_PIXELFORMAT_B8G8R8A8, NULL, 0);
+    res->font = wdCreateFont(&lf);
+    if(res->brush == NULL  ||  res->brush2 == NULL  ||  res->path == NULL  ||
+       res->style == NULL  ||  res->image == NULL  ||  res->font == NULL)
+        return FALSE;
+
+    if(!wdOpenPathSink(&sink, res->path))
+        return FALSE;
+    wdBeginFigure(&sink, 10.0f, 60.0f);
+    wdAddBezier(&sink, 20.0f, 30.0f, 50.0f, 90.0f, 70.0f, 50.0f);
+    wdAddArc(&sink, 60.0f, 60.0f, 180.0f);
+    wdEndFigure(&sink, TRUE);
+    wdClosePathSink(&sink);
+
+    res->cached_image = wdCreateCachedImage(canvas, res->image);
+    res->fill = wdRealizePathFill(canvas, res->path, 0.0f);
+    return (res->cached_image != NULL  &&  res->fill != NULL);
+}
+
+static void
+destroy_resources(resources_t* res)
+{
+    if(res->fill != NULL)
+        wdDestroyRealizedFill(res->fill);
+    if(res->cached_image != NULL)
+        wdDestroyCachedImage(res->cached_image);
+    if(res->font != NULL)
+        wdDestroyFont(res->font);
+    if(res->image != NULL)
+        wdDestroyImage(res->image);
+    if(res->style != NULL)
+        wdDestroyStrokeStyle(res->style);
+    if(res->path != NULL)
+        wdDestroyPath(res->path);
+    if(res->brush2 != NULL)
+        wdDestroyBrush(res->brush2);
+    if(res->brush != NULL)
+        wdDestroyBrush(res->brush);
+}
+
+static void
+paint(WD_HCANVAS canvas, const resources_t* res)
+{
+    WD_RECT rect = { 4.0f, 4.0f, 40.0f, 20.0f };
+    WD_RECT dst = { 50.0f, 4.0f, 90.0f, 30.0f };
+    WD_RECT clip = { 0.0f, 0.0f, 96.0f, 96.0f };
+
+    wdFillRect(canvas, res->brush, 2.0f, 70.0f, 30.0f, 90.0f);
+    wdSetSolidBrushColor(res->brush2, WD_RGB(0, 150, 0));
+    wdDrawPathStyled(canvas, res->brush2, res->path, 3.0f, res->style);
+    wdSetSolidBrushColor(res->brush2, WD_RGB(200, 0, 0));
+    wdDrawLineStyled(canvas, res->brush2, 5.0f, 40.0f, 90.0f, 45.0f, 2.0f, res->style);
+    wdBitBltImage(canvas, res->image, &dst, NULL);
+    wdBitBltCachedImage(canvas, res->cached_image, 40.0f, 70.0f);
+    wdDrawString(canvas, res->font, &rect, L"Text", -1, res->brush, 0);
+
+    wdSaveState(canvas);
+    wdTranslateWorld(canvas, 20.0f, 10.0f);
+    wdPushClipPath(canvas, res->path, &clip);
+    wdFillRect(canvas, res->brush2, 0.0f, 0.0f, 96.0f, 96.0f);
+    wdPopClip(canvas);
+    wdRestoreState(canvas);
+
+    wdTranslateWorld(canvas, 30.0f, 30.0f);
+    wdFillRealizedPath(canvas, res->brush, res->fill);
+}
+
+static WD_HDISPLAYLIST
+record(WD_HCANVAS canvas, const resources_t* res)
+{
+    WD_HDISPLAYLIST list;
+
+    if(!wdBeginRecording(canvas))
+        return NULL;
+    paint(canvas, res);
+    list = wdEndRecording(canvas);
+    TEST_CHECK(list != NULL);
+    return list;
+}
+
+static void
+replay(test_canvas_t* tc, WD_HDISPLAYLIST list)
+{
+    wdBeginPaint(tc->canvas);
+    wdClear(tc->canvas, WD_RGB(255, 255, 255));
+    wdReplay(tc->canvas, list, NULL);
+    wdEndPaint(tc->canvas);
+}
+
+/* Many resources shared by lists which are destroyed in another order. */
+static void
+test_many(test_canvas_t* tc)
+{
+    WD_HBRUSH brushes[BRUSHES];
+    WD_HDISPLAYLIST all;
+    WD_HDISPLAYLIST odd;
+    int i;
+
+    for(i = 0; i < BRUSHES; i++)
+        brushes[i] = wdCreateSolidBrush(tc->canvas, WD_RGB(i, 0, 0));
+
+    wdBeginRecording(tc->canvas);
+    for(i = 0; i < BRUSHES; i++)
+        wdFillRect(tc->canvas, brushes[i], (float) (i % 96), 0.0f, 96.0f, 96.0f);
+    all = wdEndRecording(tc->canvas);
+
+    wdBeginRecording(tc->canvas);
+    for(i = 1; i < BRUSHES; i += 2)
+        wdFillRect(tc->canvas, brushes[i], (float) (i % 96), 0.0f, 96.0f, 96.0f);
+    odd = wdEndRecording(tc->canvas);
+
+    TEST_CHECK(all != NULL  &&  odd != NULL);
+    if(all == NULL  ||  odd == NULL)
+        return;
+
+    for(i = BRUSHES - 1; i >= 0; i -= 3)
+        wdDestroyBrush(brushes[i]);
+    replay(tc, all);
+    wdDestroyDisplayList(all);
+    for(i = BRUSHES - 2; i >= 0; i -= 3)
+        wdDestroyBrush(brushes[i]);
+    replay(tc, odd);
+    for(i = BRUSHES - 3; i >= 0; i -= 3)
+        wdDestroyBrush(brushes[i]);
+    replay(tc, odd);
+    wdDestroyDisplayList(odd);
+}
+
+/* wdSetClip() and wdPopClip() in a list replace and pop only the list's own
+ * clips, never those of the caller. */
+static void
+test_clip(test_canvas_t* tc, test_canvas_t* expected)
+{
+    WD_RECT outer = { 10.0f, 10.0f, 60.0f, 60.0f };
+    WD_RECT inner = { 40.0f, 40.0f, 90.0f, 90.0f };
+    WD_HBRUSH brush;
+    WD_HDISPLAYLIST list;
+    int diff;
+
+    brush = wdCreateSolidBrush(expected->canvas, WD_RGB(0, 0, 160));
+    wdBeginPaint(expected->canvas);
+    wdResetWorld(expected->canvas);
+    wdClear(expected->canvas, WD_RGB(255, 255, 255));
+    wdPushClipRect(expected->canvas, &outer);
+    wdPushClipRect(expected->canvas, &inner);
+    wdFillRect(expected->canvas, brush, 0.0f, 0.0f, 96.0f, 96.0f);
+    wdPopClip(expected->canvas);
+    wdSetSolidBrushColor(brush, WD_RGB(0, 150, 0));
+    wdFillRect(expected->canvas, brush, 0.0f, 0.0f, 96.0f, 15.0f);
+    wdSetSolidBrushColor(brush, WD_RGB(200, 0, 0));
+    wdFillRect(expected->canvas, brush, 0.0f, 0.0f, 30.0f, 30.0f);
+    wdPopClip(expected->canvas);
+    wdEndPaint(expected->canvas);
+    wdDestroyBrush(brush);
+
+    brush = wdCreateSolidBrush(tc->canvas, WD_RGB(0, 0, 0));
+    wdBeginRecording(tc->canvas);
+    wdSetSolidBrushColor(brush, WD_RGB(0, 0, 160));
+    wdSetClip(tc->canvas, &inner, NULL);
+    wdFillRect(tc->canvas, brush, 0.0f, 0.0f, 96.0f, 96.0f);
+    wdSetClip(tc->canvas, NULL, NULL);
+    wdSetSolidBrushColor(brush, WD_RGB(0, 150, 0));
+    wdFillRect(tc->canvas, brush, 0.0f, 0.0f, 96.0f, 15.0f);
+    wdPopClip(tc->canvas);
+    wdSetClip(tc->canvas, &inner, NULL);
+    list = wdEndRecording(tc->canvas);
+    TEST_CHECK(list != NULL);
+    if(list == NULL) {
+        wdDestroyBrush(brush);
+        return;
+    }
+
+    wdBeginPaint(tc->canvas);
+    wdResetWorld(tc->canvas);
+    wdClear(tc->canvas, WD_RGB(255, 255, 255));
+    wdPushClipRect(tc->canvas, &outer);
+    wdReplay(tc->canvas, list, NULL);
+    wdSetSolidBrushColor(brush, WD_RGB(200, 0, 0));
+    wdFillRect(tc->canvas, brush, 0.0f, 0.0f, 30.0f, 30.0f);
+    wdPopClip(tc->canvas);
+    wdEndPaint(tc->canvas);
+    wdDestroyBrush(brush);
+    wdDestroyDisplayList(list);
+
+    diff = test_canvas_maxdiff(tc, expected);
+    TEST_CHECK_MSG(diff == 0, "replay with wdSetClip() differs by %d", diff);
+}
+
+int
+main(int argc, char** argv)
+{
+    test_canvas_t expected;
+    test_canvas_t tc;
+    resources_t res;
+    WD_HDISPLAYLIST list;
+    WD_HDISPLAYLIST list2;
+    int diff;
+
+    test_init_software();
+
+    if(test_canvas_init(&expected, W, H, 0) != 0  ||  test_canvas_init(&tc, W, H, 0) != 0) {
+        fprintf(stderr, "Cannot create the canvases.\n");
+        return 1;
+    }
+
+    /* What the list has to paint. */
+    if(!create_resources(expected.canvas, &res)) {
+        fprintf(stderr, "Cannot create the resources.\n");
+        return 1;
+    }
+    wdBeginPaint(expected.canvas);
+    wdClear(expected.canvas, WD_RGB(255, 255, 255));
+    paint(expected.canvas, &res);
+    wdEndPaint(expected.canvas);
+    destroy_resources(&res);
+
+    /* Record two lists using the same resources, and destroy the resources
+     * right away. */
+    if(!create_resources(tc.canvas, &res)) {
+        fprintf(stderr, "Cannot create the resources.\n");
+        return 1;
+    }
+    list = record(tc.canvas, &res);
+    list2 = record(tc.canvas, &res);
+    destroy_resources(&res);
+    if(list == NULL  ||  list2 == NULL)
+        return test_result("dlist");
+
+    replay(&tc, list);
+    diff = test_canvas_maxdiff(&tc, &expected);
+    TEST_CHECK_MSG(diff == 0, "replay differs from direct painting by %d", diff);
+
+    /* Replaying is repeatable. */
+    replay(&tc, list);
+    diff = test_canvas_maxdiff(&tc, &expected);
+    TEST_CHECK_MSG(diff == 0, "second replay differs by %d", diff);
+
+    /* The resources are still alive for the other list. */
+    wdDestroyDisplayList(list);
+    replay(&tc, list2);
+    diff = test_canvas_maxdiff(&tc, &expected);
+    TEST_CHECK_MSG(diff == 0, "replay of the other list differs by %d", diff);
+    wdDestroyDisplayList(list2);
+
+    /* Resources outliving the lists are destroyed as usual. (LeakSanitizer
+     * checks nothing is left behind in any of the cases.) */
+    if(create_resources(tc.canvas, &res)) {
+        list = record(tc.canvas, &res);
+        wdDestroyDisplayList(list);
+    }
+    destroy_resources(&res);
+
+    test_many(&tc);
+    test_clip(&tc, &expected);
+
+    test_canvas_fini(&tc);
+    test_canvas_fini(&expected);
+    test_fini_software();
+    return test_result("dlist");
+}
@@ -0,0 +1,175 @@
+/*
+ * Tests of the curve flattening of the software rasterizer (sw_poly_flatten()):
+ * Every point of each curve, computed exactly, has to be within the tolerance
+ * from the chord approximating its part of the curve.
+ *
+ * Usage: flatten [OUTPUT]
+ *
+ * With OUTPUT, all the flattened points are written there as raw floats. The
+ * test is built twice, with and without the SSE2 code of swrast.c (see
+ * SW_NO_SSE2), and the outputs have to be the same byte for byte.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "test.h"
+#include "swrast.h"
+
+
+#define CURVES          2000
+#define SAMPLES         32      /* Per chord. */
+
+/* Slack for the rounding of the float computation, for coordinates up to
+ * about 1000. */
+#define EPSILON         1e-3
+
+
+static unsigned random_state = 12345;
+
+/* Deterministic, so both builds flatten the same curves. */
+static float
+random_coord(float range)
+{
+    random_state = random_state * 1103515245U + 12345U;
+    return ((float) ((random_state >> 8) & 0xffff) / 65535.0f - 0.5f) * 2.0f * range;
+}
+
+static void
+cubic_point(const WD_POINT* p, double t, double* x, double* y)
+{
+    double u = 1.0 - t;
+    double b0 = u * u * u;
+    double b1 = 3.0 * u * u * t;
+    double b2 = 3.0 * u * t * t;
+    double b3 = t * t * t;
+
+    *x = b0 * (double) p[0].x + b1 * (double) p[1].x +
+         b2 * (double) p[2].x + b3 * (double) p[3].x;
+    *y = b0 * (double) p[0].y + b1 * (double) p[1].y +
+         b2 * (double) p[2].y + b3 * (double) p[3].y;
+}
+
+static double
+segment_distance(double x, double y, const WD_POINT* a, const WD_POINT* b)
+{
+    double ax = a->x;
+    double ay = a->y;
+    double dx = (double) b->x - ax;
+    double dy = (double) b->y - ay;
+    double len2 = dx * dx + dy * dy;
+    double s = 0.0;
+
+    if(len2 > 0.0) {
+        s = ((x - ax) * dx + (y - ay) * dy) / len2;
+        if(s < 0.0)
+            s = 0.0;
+        else if(s > 1.0)
+            s = 1.0;
+    }
+
+    dx = ax + s * dx - x;
+    dy = ay + s * dy - y;
+    return sqrt(dx * dx + dy * dy);
+}
+
+/* Flattens the curve p[0] ... p[3] and checks it. */
+static void
+test_curve(const WD_POINT* p, float tolerance, FILE* out)
+{
+    sw_path_t path;
+    sw_poly_t poly;
+    double max_error = 0.0;
+    UINT n;
+    UINT i, j;
+
+    sw_path_init(&path);
+    sw_path_move_to(&path, p[0].x, p[0].y);
+    sw_path_cubic_to(&path, p[1].x, p[1].y, p[2].x, p[2].y, p[3].x, p[3].y);
+    sw_poly_init(&poly);
+    sw_poly_flatten(&poly, &path, tolerance);
+    if(path.error  ||  poly.error) {
+        TEST_CHECK_MSG(0, "Out of memory.");
+        goto out;
+    }
+
+    /* The start point, then the end of each uniform step. */
+    n = poly.point_count - 1;
+    TEST_CHECK(poly.contour_count == 1  &&  n >= 1);
+    TEST_CHECK(poly.points[0].x == p[0].x  &&  poly.points[0].y == p[0].y);
+    TEST_CHECK(poly.points[n].x == p[3].x  &&  poly.points[n].y == p[3].y);
+
+    for(i = 0; i < n; i++) {
+        for(j = 0; j <= SAMPLES; j++) {
+            double t = ((double) i + (double) j / SAMPLES) / n;
+            double x, y, e;
+
+            cubic_point(p, t, &x, &y);
+            e = segment_distance(x, y, &poly.points[i], &poly.points[i+1]);
+            if(e > max_error)
+                max_error = e;
+        }
+    }
+
+    TEST_CHECK_MSG(max_error <= (double) tolerance + EPSILON,
+                   "curve [%g %g, %g %g, %g %g, %g %g]: error %g with %u steps, "
+                   "tolerance %g", (double) p[0].x, (double) p[0].y,
+                   (double) p[1].x, (double) p[1].y, (double) p[2].x,
+                   (double) p[2].y, (double) p[3].x, (double) p[3].y,
+                   max_error, n, (double) tolerance);
+
+    if(out != NULL)
+        fwrite(poly.points, sizeof(WD_POINT), poly.point_count, out);
+
+out:
+    sw_poly_fini(&poly);
+    sw_path_fini(&path);
+}
+
+int
+main(int argc, char** argv)
+{
+    static const float tolerances[] = { 0.01f, 0.1f, SW_TOLERANCE, 1.0f };
+    static const float ranges[] = { 0.5f, 10.0f, 100.0f, 500.0f };
+    static const WD_POINT special[][4] = {
+        { { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } },                /* Point */
+        { { 0, 0 }, { 10, 10 }, { 20, 20 }, { 30, 30 } },           /* Line */
+        { { 0, 0 }, { 30, 30 }, { 10, 10 }, { 20, 20 } },           /* Line back and forth */
+        { { 0, 0 }, { 100, 100 }, { 0, 100 }, { 100, 0 } },         /* Cusp */
+        { { 0, 0 }, { 300, 200 }, { -200, 200 }, { 100, 0 } },      /* Loop */
+        { { 0, 0 }, { 0, 500 }, { 500, -500 }, { 500, 0 } }         /* S-curve */
+    };
+    FILE* out = NULL;
+    WD_POINT p[4];
+    int i, k;
+
+    if(argc > 1) {
+        out = fopen(argv[1], "wb");
+        if(out == NULL) {
+            fprintf(stderr, "%s: Cannot open.\n", argv[1]);
+            return 1;
+        }
+    }
+
+    for(i = 0; i < (int) WD_SIZEOF_ARRAY(special); i++) {
+        for(k = 0; k < (int) WD_SIZEOF_ARRAY(tolerances); k++)
+            test_curve(special[i], tolerances[k], out);
+    }
+
+    for(i = 0; i < CURVES; i++) {
+        float range = ranges[i % WD_SIZEOF_ARRAY(ranges)];
+
+        for(k = 0; k < 4; k++) {
+            p[k].x = random_coord(range);
+            p[k].y = random_coord(range);
+        }
+        test_curve(p, tolerances[(i / WD_SIZEOF_ARRAY(ranges)) % WD_SIZEOF_ARRAY(tolerances)], out);
+    }
+
+    if(out != NULL  &&  fclose(out) != 0) {
+        fprintf(stderr, "%s: Write error.\n", argv[1]);
+        return 1;
+    }
+
+    return test_result("flatten");
+}
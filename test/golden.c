@@ -0,0 +1,366 @@
+/*
+ * Golden-image tests of the software back-end.
+ *
+ * Each scene is painted into a memory buffer (see wdCreateCanvasWithBuffer())
+ * and compared with the reference image golden/<scene>.ppm. A difference of
+ * up to GOLDEN_TOLERANCE in any channel is accepted, so rounding differences
+ * between compilers (and between the SSE2 and scalar code) do not matter.
+ *
+ * Usage: golden [--update] DIR [SCENE]
+ *
+ * With --update, the reference images in DIR are (re)written instead. Check
+ * them by eye before committing them.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+
+#define GOLDEN_W            96
+#define GOLDEN_H            96
+#define GOLDEN_TOLERANCE    2
+
+
+static WD_HPATH
+star_path(WD_HCANVAS canvas, float cx, float cy, float r)
+{
+    WD_POINT points[5];
+    int i;
+
+    /* Self-intersecting: The center is a hole with the even-odd rule. */
+    for(i = 0; i < 5; i++) {
+        float a = (float) (i * 4) * 3.14159265f / 5.0f - 3.14159265f / 2.0f;
+        points[i].x = cx + r * cosf(a);
+        points[i].y = cy + r * sinf(a);
+    }
+    return wdCreatePolygonPath(canvas, points, 5);
+}
+
+static WD_HPATH
+curve_path(WD_HCANVAS canvas)
+{
+    WD_HPATH path;
+    WD_PATHSINK sink;
+
+    path = wdCreatePath(canvas);
+    if(path == NULL  ||  !wdOpenPathSink(&sink, path))
+        return path;
+    wdBeginFigure(&sink, 10.0f, 80.0f);
+    wdAddBezier(&sink, 20.0f, 10.0f, 60.0f, 100.0f, 86.0f, 20.0f);
+    wdAddArc(&sink, 70.0f, 20.0f, 180.0f);
+    wdAddLine(&sink, 40.0f, 40.0f);
+    wdEndFigure(&sink, TRUE);
+    wdClosePathSink(&sink);
+    return path;
+}
+
+static void
+scene_fills(WD_HCANVAS canvas)
+{
+    WD_RECT rrect = { 52.0f, 8.5f, 90.0f, 40.0f };
+    WD_HBRUSH brush;
+    WD_HPATH path;
+
+    brush = wdCreateSolidBrush(canvas, WD_ARGB(255, 200, 40, 40));
+    wdFillRect(canvas, brush, 4.0f, 4.0f, 40.0f, 30.0f);
+    wdSetSolidBrushColor(brush, WD_ARGB(160, 40, 120, 220));
+    wdFillRect(canvas, brush, 20.3f, 16.7f, 48.6f, 44.2f);
+    wdFillEllipse(canvas, brush, 24.0f, 68.0f, 18.0f, 11.5f);
+    wdSetSolidBrushColor(brush, WD_ARGB(200, 30, 160, 60));
+    wdFillEllipsePie(canvas, brush, 70.0f, 70.0f, 20.0f, 20.0f, 30.0f, 250.0f);
+
+    path = wdCreateRoundedRectPath(canvas, &rrect, 7.0f);
+    wdSetSolidBrushColor(brush, WD_ARGB(255, 230, 170, 20));
+    wdFillPath(canvas, brush, path);
+    wdDestroyPath(path);
+
+    path = star_path(canvas, 70.0f, 70.0f, 16.0f);
+    wdSetSolidBrushColor(brush, WD_ARGB(180, 90, 20, 140));
+    wdFillPath(canvas, brush, path);
+    wdDestroyPath(path);
+
+    wdDestroyBrush(brush);
+}
+
+static void
+scene_strokes(WD_HCANVAS canvas)
+{
+    static const UINT caps[3] = { WD_LINECAP_FLAT, WD_LINECAP_SQUARE, WD_LINECAP_ROUND };
+    static const UINT joins[3] = { WD_LINEJOIN_MITER, WD_LINEJOIN_BEVEL, WD_LINEJOIN_ROUND };
+    static const float dashes[4] = { 3.0f, 1.0f, 0.5f, 1.0f };
+    WD_HBRUSH brush;
+    WD_HSTROKESTYLE style;
+    WD_HPATH path;
+    int i;
+
+    brush = wdCreateSolidBrush(canvas, WD_RGB(20, 20, 20));
+
+    for(i = 0; i < 3; i++) {
+        WD_POINT zigzag[4];
+        float y = 8.0f + 12.0f * (float) i;
+
+        style = wdCreateStrokeStyle(WD_DASHSTYLE_SOLID, caps[i], WD_LINEJOIN_MITER);
+        wdDrawLineStyled(canvas, brush, 8.0f, y, 36.0f, y + 4.0f, 5.0f, style);
+        wdDestroyStrokeStyle(style);
+
+        style = wdCreateStrokeStyle(WD_DASHSTYLE_SOLID, WD_LINECAP_FLAT, joins[i]);
+        zigzag[0].x = 48.0f;  zigzag[0].y = y + 6.0f;
+        zigzag[1].x = 60.0f;  zigzag[1].y = y - 2.0f;
+        zigzag[2].x = 72.0f;  zigzag[2].y = y + 6.0f;
+        zigzag[3].x = 88.0f;  zigzag[3].y = y;
+        wdDrawPolylineStyled(canvas, brush, zigzag, 4, 4.0f, style);
+        wdDestroyStrokeStyle(style);
+    }
+
+    style = wdCreateStrokeStyle(WD_DASHSTYLE_DASHDOT, WD_LINECAP_ROUND, WD_LINEJOIN_ROUND);
+    wdSetSolidBrushColor(brush, WD_ARGB(200, 200, 30, 30));
+    wdDrawEllipseStyled(canvas, brush, 26.0f, 70.0f, 18.0f, 14.0f, 3.0f, style);
+    wdDestroyStrokeStyle(style);
+
+    style = wdCreateStrokeStyleEx(dashes, 4, WD_LINECAP_SQUARE, WD_LINEJOIN_MITER, 2.0f);
+    path = star_path(canvas, 70.0f, 70.0f, 18.0f);
+    wdSetSolidBrushColor(brush, WD_ARGB(220, 30, 90, 200));
+    wdDrawPathStyled(canvas, brush, path, 2.5f, style);
+    wdDestroyPath(path);
+    wdDestroyStrokeStyle(style);
+
+    wdDestroyBrush(brush);
+}
+
+static void
+scene_gradients(WD_HCANVAS canvas)
+{
+    static const WD_COLOR colors[3] = {
+        WD_RGB(255, 0, 0), WD_ARGB(128, 0, 255, 0), WD_RGB(0, 0, 255)
+    };
+    static const float offsets[3] = { 0.0f, 0.3f, 1.0f };
+    WD_HBRUSH brush;
+    WD_HPATH path;
+
+    brush = wdCreateLinearGradientBrush(canvas, 4.0f, 4.0f, WD_RGB(255, 255, 0),
+                44.0f, 30.0f, WD_RGB(0, 128, 255));
+    wdFillRect(canvas, brush, 4.0f, 4.0f, 92.0f, 30.0f);
+    wdDestroyBrush(brush);
+
+    brush = wdCreateLinearGradientBrushEx(canvas, 10.0f, 40.0f, 40.0f, 90.0f,
+                colors, offsets, 3);
+    wdFillEllipse(canvas, brush, 24.0f, 64.0f, 20.0f, 26.0f);
+    wdDestroyBrush(brush);
+
+    brush = wdCreateRadialGradientBrushEx(canvas, 70.0f, 64.0f, 22.0f,
+                62.0f, 56.0f, colors, offsets, 3);
+    path = curve_path(canvas);
+    wdFillPath(canvas, brush, path);
+    wdDestroyPath(path);
+    wdDestroyBrush(brush);
+
+    brush = wdCreateRadialGradientBrush(canvas, 70.0f, 64.0f, 12.0f,
+                WD_ARGB(255, 255, 255, 255), WD_ARGB(0, 255, 255, 255));
+    wdFillCircle(canvas, brush, 70.0f, 64.0f, 14.0f);
+    wdDestroyBrush(brush);
+}
+
+static void
+scene_images(WD_HCANVAS canvas)
+{
+    BYTE buffer[8 * 8 * 4];
+    WD_HIMAGE image;
+    WD_RECT dst;
+    WD_RECT src;
+    int x, y;
+
+    /* Checkerboard with a translucent diagonal. */
+    for(y = 0; y < 8; y++) {
+        for(x = 0; x < 8; x++) {
+            BYTE* p = &buffer[(y * 8 + x) * 4];
+            BYTE v = ((x + y) & 1) ? 220 : 40;
+
+            p[0] = v;
+            p[1] = (BYTE) (x * 32);
+            p[2] = (BYTE) (y * 32);
+            p[3] = (x == y) ? 96 : 255;
+        }
+    }
+
+    image = wdCreateImageFromBuffer(8, 8, 8 * 4, buffer,
+                WD_PIXELFORMAT_R8G8B8A8, NULL, 0);
+    if(image == NULL) {
+        TEST_CHECK(image != NULL);
+        return;
+    }
+
+    /* Aligned and unscaled. */
+    dst.x0 = 4.0f;  dst.y0 = 4.0f;  dst.x1 = 12.0f;  dst.y1 = 12.0f;
+    wdBitBltImage(canvas, image, &dst, NULL);
+
+    /* Scaled up. */
+    dst.x0 = 20.0f;  dst.y0 = 4.0f;  dst.x1 = 92.0f;  dst.y1 = 40.0f;
+    wdBitBltImage(canvas, image, &dst, NULL);
+
+    /* Part of it, at a fractional position. */
+    src.x0 = 2.0f;  src.y0 = 2.0f;  src.x1 = 6.0f;  src.y1 = 7.0f;
+    dst.x0 = 4.5f;  dst.y0 = 48.25f;  dst.x1 = 40.5f;  dst.y1 = 90.0f;
+    wdBitBltImage(canvas, image, &dst, &src);
+
+    /* Rotated. */
+    wdRotateWorld(canvas, 68.0f, 68.0f, 30.0f);
+    dst.x0 = 52.0f;  dst.y0 = 52.0f;  dst.x1 = 84.0f;  dst.y1 = 84.0f;
+    wdBitBltImage(canvas, image, &dst, NULL);
+    wdResetWorld(canvas);
+
+    wdDestroyImage(image);
+}
+
+static void
+scene_clips(WD_HCANVAS canvas)
+{
+    WD_RECT aligned = { 4.0f, 4.0f, 44.0f, 44.0f };
+    WD_RECT unaligned = { 52.3f, 4.6f, 91.5f, 43.2f };
+    WD_RECT inner = { 0.0f, 60.0f, 96.0f, 84.0f };
+    WD_HBRUSH brush;
+    WD_HPATH path;
+
+    brush = wdCreateSolidBrush(canvas, WD_ARGB(255, 40, 140, 40));
+
+    wdPushClipRect(canvas, &aligned);
+    wdFillCircle(canvas, brush, 24.0f, 24.0f, 28.0f);
+    wdPopClip(canvas);
+
+    wdPushClipRect(canvas, &unaligned);
+    wdSetSolidBrushColor(brush, WD_ARGB(200, 200, 60, 20));
+    wdFillCircle(canvas, brush, 72.0f, 24.0f, 28.0f);
+    wdPopClip(canvas);
+
+    /* Path clip, with a nested rectangle. */
+    path = star_path(canvas, 48.0f, 70.0f, 24.0f);
+    wdPushClipPath(canvas, path, NULL);
+    wdSetSolidBrushColor(brush, WD_ARGB(255, 30, 60, 200));
+    wdFillRect(canvas, brush, 0.0f, 44.0f, 96.0f, 96.0f);
+    wdPushClipRect(canvas, &inner);
+    wdSetSolidBrushColor(brush, WD_ARGB(160, 240, 200, 20));
+    wdFillRect(canvas, brush, 0.0f, 64.0f, 96.0f, 80.0f);
+    wdPopClip(canvas);
+    wdPopClip(canvas);
+    wdDestroyPath(path);
+
+    wdDestroyBrush(brush);
+}
+
+static void
+scene_transforms(WD_HCANVAS canvas)
+{
+    WD_MATRIX skew = { 1.0f, 0.0f, 0.4f, 1.0f, 0.0f, 0.0f };
+    WD_HBRUSH brush;
+    WD_HPATH path;
+
+    brush = wdCreateSolidBrush(canvas, WD_ARGB(220, 20, 120, 180));
+
+    wdSaveState(canvas);
+    wdRotateWorld(canvas, 28.0f, 28.0f, 35.0f);
+    wdFillRect(canvas, brush, 12.0f, 16.0f, 44.0f, 40.0f);
+    wdSetSolidBrushColor(brush, WD_RGB(0, 0, 0));
+    wdDrawRect(canvas, brush, 12.0f, 16.0f, 44.0f, 40.0f, 2.0f);
+    wdRestoreState(canvas);
+
+    wdSaveState(canvas);
+    wdTranslateWorld(canvas, 50.0f, 0.0f);
+    wdTransformWorld(canvas, &skew);
+    wdSetSolidBrushColor(brush, WD_ARGB(200, 200, 40, 120));
+    wdFillEllipse(canvas, brush, 20.0f, 26.0f, 14.0f, 18.0f);
+    wdRestoreState(canvas);
+
+    wdSaveState(canvas);
+    wdTranslateWorld(canvas, 4.0f, 46.0f);
+    wdTransformWorld(canvas, &skew);
+    {
+        WD_MATRIX scale = { 0.5f, 0.0f, 0.0f, 0.5f, 0.0f, 0.0f };
+        wdTransformWorld(canvas, &scale);
+    }
+    path = curve_path(canvas);
+    wdSetSolidBrushColor(brush, WD_ARGB(255, 60, 160, 60));
+    wdFillPath(canvas, brush, path);
+    wdSetSolidBrushColor(brush, WD_RGB(0, 0, 0));
+    wdDrawPath(canvas, brush, path, 1.5f);
+    wdDestroyPath(path);
+    wdRestoreState(canvas);
+
+    wdDestroyBrush(brush);
+}
+
+
+static const struct {
+    const char* name;
+    void (*fn_paint)(WD_HCANVAS canvas);
+    DWORD flags;
+} scenes[] = {
+    { "fills",      scene_fills,        0 },
+    { "strokes",    scene_strokes,      0 },
+    { "gradients",  scene_gradients,    0 },
+    { "images",     scene_images,       0 },
+    { "clips",      scene_clips,        0 },
+    { "transforms", scene_transforms,   0 },
+    { "rtl",        scene_fills,        WD_CANVAS_LAYOUTRTL }
+};
+
+
+int
+main(int argc, char** argv)
+{
+    const char* dir;
+    const char* only = NULL;
+    BOOL update = FALSE;
+    int argi = 1;
+    UINT i;
+
+    if(argi < argc  &&  strcmp(argv[argi], "--update") == 0) {
+        update = TRUE;
+        argi++;
+    }
+    if(argi >= argc) {
+        fprintf(stderr, "Usage: golden [--update] DIR [SCENE]\n");
+        return 2;
+    }
+    dir = argv[argi++];
+    if(argi < argc)
+        only = argv[argi];
+
+    test_init_software();
+
+    for(i = 0; i < sizeof(scenes) / sizeof(scenes[0]); i++) {
+        test_canvas_t tc;
+        char path[1024];
+        int diff;
+
+        if(only != NULL  &&  strcmp(only, scenes[i].name) != 0)
+            continue;
+
+        if(test_canvas_init(&tc, GOLDEN_W, GOLDEN_H, scenes[i].flags) != 0) {
+            TEST_CHECK_MSG(0, "%s: Cannot create the canvas.", scenes[i].name);
+            continue;
+        }
+
+        wdBeginPaint(tc.canvas);
+        wdClear(tc.canvas, WD_RGB(255, 255, 255));
+        scenes[i].fn_paint(tc.canvas);
+        TEST_CHECK(wdEndPaint(tc.canvas));
+
+        snprintf(path, sizeof(path), "%s/%s.ppm", dir, scenes[i].name);
+        if(update) {
+            TEST_CHECK_MSG(test_canvas_save(&tc, path) == 0,
+                        "%s: Cannot save.", path);
+        } else {
+            diff = test_canvas_compare(&tc, path);
+            TEST_CHECK_MSG(diff >= 0  &&  diff <= GOLDEN_TOLERANCE,
+                        "%s: Differs by %d (tolerance %d).", scenes[i].name,
+                        diff, GOLDEN_TOLERANCE);
+        }
+
+        test_canvas_fini(&tc);
+    }
+
+    test_fini_software();
+    return test_result("golden");
+}
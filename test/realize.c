@@ -0,0 +1,128 @@
+/*
+ * Tests of wdRealizePathFill() with the software back-end: With the default
+ * tolerance, wdFillRealizedPath() has to paint what wdFillPath() paints, both
+ * when the recorded coverage is reused (the same transformation, or one moved
+ * by whole pixels) and when the flattened path is filled again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+
+
+#define W               128
+#define H               128
+#define MAX_DIFF        1
+
+
+/* Circles and curves small enough for the flattening to be visible. */
+static WD_HPATH
+curve_path(WD_HCANVAS canvas)
+{
+    WD_HPATH path;
+    WD_PATHSINK sink;
+
+    path = wdCreatePath(canvas);
+    if(path == NULL  ||  !wdOpenPathSink(&sink, path))
+        return path;
+    wdBeginFigure(&sink, 10.0f, 20.0f);
+    wdAddArc(&sink, 20.0f, 20.0f, 360.0f);
+    wdEndFigure(&sink, TRUE);
+    wdBeginFigure(&sink, 5.0f, 50.0f);
+    wdAddBezier(&sink, 15.0f, 0.0f, 40.0f, 70.0f, 55.0f, 30.0f);
+    wdAddBezier(&sink, 50.0f, 55.0f, 20.0f, 40.0f, 5.0f, 55.0f);
+    wdEndFigure(&sink, TRUE);
+    wdClosePathSink(&sink);
+    return path;
+}
+
+static void
+set_transform(WD_HCANVAS canvas, float scale, float dx, float dy)
+{
+    WD_MATRIX m = { 0 };
+
+    m.m11 = scale;
+    m.m22 = scale;
+    m.dx = dx;
+    m.dy = dy;
+    wdSetWorldTransform(canvas, &m);
+}
+
+/* Realizes the path under the transformation (scale, dx0, dy0), and then
+ * compares wdFillRealizedPath() with wdFillPath() under (scale, dx1, dy1). */
+static void
+test_case(const char* name, float scale, float dx0, float dy0, float dx1, float dy1)
+{
+    test_canvas_t tc;
+    test_canvas_t expected;
+    WD_HPATH path;
+    WD_HBRUSH brush;
+    WD_HREALIZEDFILL fill;
+    int diff;
+
+    if(test_canvas_init(&tc, W, H, 0) != 0) {
+        TEST_CHECK_MSG(0, "%s: Cannot create the canvas.", name);
+        return;
+    }
+    expected = tc;
+    expected.pixels = (UINT32*) malloc(W * H * sizeof(UINT32));
+    path = curve_path(tc.canvas);
+    brush = wdCreateSolidBrush(tc.canvas, WD_RGB(0, 0, 160));
+    if(expected.pixels == NULL  ||  path == NULL  ||  brush == NULL) {
+        TEST_CHECK_MSG(0, "%s: Out of resources.", name);
+        goto out;
+    }
+
+    wdBeginPaint(tc.canvas);
+
+    set_transform(tc.canvas, scale, dx0, dy0);
+    fill = wdRealizePathFill(tc.canvas, path, 0.0f);
+    TEST_CHECK_MSG(fill != NULL, "%s: wdRealizePathFill() failed.", name);
+
+    set_transform(tc.canvas, scale, dx1, dy1);
+    wdClear(tc.canvas, WD_RGB(255, 255, 255));
+    wdFillPath(tc.canvas, brush, path);
+    memcpy(expected.pixels, tc.pixels, W * H * sizeof(UINT32));
+
+    if(fill != NULL) {
+        wdClear(tc.canvas, WD_RGB(255, 255, 255));
+        wdFillRealizedPath(tc.canvas, brush, fill);
+        wdDestroyRealizedFill(fill);
+    }
+
+    wdEndPaint(tc.canvas);
+
+    diff = test_canvas_maxdiff(&tc, &expected);
+    TEST_CHECK_MSG(diff <= MAX_DIFF, "%s: differs from wdFillPath() by %d",
+                   name, diff);
+    printf("%s: max. difference %d\n", name, diff);
+
+out:
+    if(brush != NULL)
+        wdDestroyBrush(brush);
+    if(path != NULL)
+        wdDestroyPath(path);
+    free(expected.pixels);
+    test_canvas_fini(&tc);
+}
+
+int
+main(int argc, char** argv)
+{
+    test_init_software();
+
+    /* The recorded coverage is painted. */
+    test_case("same", 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    test_case("moved", 1.0f, 3.0f, 5.0f, 40.0f, 61.0f);
+    test_case("scaled", 2.0f, 1.0f, 2.0f, 1.0f, 2.0f);
+    test_case("scaled-moved", 2.0f, 1.0f, 2.0f, -7.0f, 10.0f);
+
+    /* The flattened path is filled. */
+    test_case("subpixel", 1.0f, 0.0f, 0.0f, 20.25f, 30.5f);
+    test_case("scaled-subpixel", 2.0f, 0.0f, 0.0f, 0.5f, 0.5f);
+
+    test_fini_software();
+    return test_result("realize");
+}
@@ -0,0 +1,90 @@
+/*
+ * Tests of the spatial index rejecting rectangles which are not finite. The
+ * test builds its own copy of spatial.c with -ffast-math (as the library is
+ * built with GCC and MSVC), which lets the compiler assume there is no NaN
+ * and no infinity at all.
+ */
+
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+
+static float
+float_from_bits(UINT32 bits)
+{
+    float f;
+
+    memcpy(&f, &bits, sizeof(float));
+    return f;
+}
+
+/* Every coordinate of a good rectangle replaced in turn with the value. */
+static void
+test_value(WD_HSPATIALINDEX index, const char* name, float value)
+{
+    static const WD_RECT good = { 10.0f, 10.0f, 20.0f, 20.0f };
+    UINT ids[1] = { 1 };
+    int i;
+
+    for(i = 0; i < 4; i++) {
+        WD_RECT rect = good;
+        WD_HSPATIALINDEX tmp;
+
+        ((float*) &rect)[i] = value;
+
+        TEST_CHECK_MSG(!wdInsertSpatialIndexItem(index, 100 + i, &rect),
+                       "wdInsertSpatialIndexItem() accepted %s as coordinate %d.",
+                       name, i);
+
+        tmp = wdCreateSpatialIndex(ids, &rect, 1);
+        TEST_CHECK_MSG(tmp == NULL,
+                       "wdCreateSpatialIndex() accepted %s as coordinate %d.",
+                       name, i);
+        if(tmp != NULL)
+            wdDestroySpatialIndex(tmp);
+    }
+}
+
+int
+main(int argc, char** argv)
+{
+    static const UINT ids[] = { 1, 2, 3 };
+    static const WD_RECT rects[] = {
+        { 0.0f, 0.0f, 10.0f, 10.0f },
+        { 5.0f, 5.0f, 15.0f, 15.0f },
+        { -FLT_MAX, -FLT_MAX, FLT_MAX, FLT_MAX }
+    };
+    WD_RECT all = { -FLT_MAX, -FLT_MAX, FLT_MAX, FLT_MAX };
+    WD_RECT small = { FLT_MIN, -FLT_MIN, 1e-42f, 0.0f };
+    WD_HSPATIALINDEX index;
+    UINT found[8];
+    UINT n;
+
+    index = wdCreateSpatialIndex(ids, rects, 3);
+    if(index == NULL) {
+        TEST_CHECK_MSG(0, "wdCreateSpatialIndex() failed.");
+        return test_result("spatial");
+    }
+
+    test_value(index, "NaN", float_from_bits(0x7fc00000));
+    test_value(index, "-NaN", float_from_bits(0xffc00000));
+    test_value(index, "signaling NaN", float_from_bits(0x7f800001));
+    test_value(index, "+Inf", float_from_bits(0x7f800000));
+    test_value(index, "-Inf", float_from_bits(0xff800000));
+
+    /* Huge and denormal coordinates are fine. */
+    TEST_CHECK(wdInsertSpatialIndexItem(index, 4, &all));
+    TEST_CHECK(wdInsertSpatialIndexItem(index, 5, &small));
+
+    /* Nothing rejected made it into the index. */
+    n = wdQuerySpatialIndexRect(index, &all, found, 8);
+    TEST_CHECK_MSG(n == 5, "The index has %u items, expected 5.", n);
+    n = wdQuerySpatialIndexPoint(index, 15.0f, 15.0f, found, 8);
+    TEST_CHECK_MSG(n == 3, "Point query found %u items, expected 3.", n);
+
+    wdDestroySpatialIndex(index);
+    return test_result("spatial");
+}
@@ -0,0 +1,197 @@
+/*
+ * Helpers shared by the tests.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+
+
+int test_failures = 0;
+
+
+void
+test_fail(const char* file, int line, const char* fmt, ...)
+{
+    va_list args;
+
+    fprintf(stderr, "%s:%d: check failed: ", file, line);
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+
+    test_failures++;
+}
+
+int
+test_result(const char* name)
+{
+    if(test_failures > 0) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, test_failures);
+        return 1;
+    }
+
+    printf("%s: OK\n", name);
+    return 0;
+}
+
+
+void
+test_init_software(void)
+{
+    wdPreInitialize(NULL, NULL, WD_USE_SOFTWARE);
+    if(!wdInitialize(WD_INIT_IMAGEAPI)  ||  wdBackend() != WD_BACKEND_SOFTWARE) {
+        fprintf(stderr, "Cannot initialize the software back-end.\n");
+        exit(1);
+    }
+}
+
+void
+test_fini_software(void)
+{
+    wdTerminate(WD_INIT_IMAGEAPI);
+    wdPreInitialize(NULL, NULL, 0);
+}
+
+
+int
+test_canvas_init(test_canvas_t* tc, UINT width, UINT height, DWORD flags)
+{
+    tc->width = width;
+    tc->height = height;
+    tc->pixels = (UINT32*) calloc(width * height, sizeof(UINT32));
+    if(tc->pixels == NULL)
+        return -1;
+
+    tc->canvas = wdCreateCanvasWithBuffer(tc->pixels, width, height,
+                        width * sizeof(UINT32), flags);
+    if(tc->canvas == NULL) {
+        free(tc->pixels);
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+test_canvas_fini(test_canvas_t* tc)
+{
+    wdDestroyCanvas(tc->canvas);
+    free(tc->pixels);
+}
+
+static int
+test_pixel_diff(UINT32 a, UINT32 b)
+{
+    int maxdiff = 0;
+    int shift;
+
+    for(shift = 0; shift < 32; shift += 8) {
+        int d = abs((int) ((a >> shift) & 0xff) - (int) ((b >> shift) & 0xff));
+        if(d > maxdiff)
+            maxdiff = d;
+    }
+    return maxdiff;
+}
+
+int
+test_canvas_maxdiff(const test_canvas_t* a, const test_canvas_t* b)
+{
+    int maxdiff = 0;
+    UINT i;
+
+    for(i = 0; i < a->width * a->height; i++) {
+        int d = test_pixel_diff(a->pixels[i], b->pixels[i]);
+        if(d > maxdiff)
+            maxdiff = d;
+    }
+    return maxdiff;
+}
+
+
+int
+test_canvas_save(const test_canvas_t* tc, const char* path)
+{
+    FILE* f;
+    UINT i;
+
+    for(i = 0; i < tc->width * tc->height; i++) {
+        if((tc->pixels[i] >> 24) != 0xff) {
+            fprintf(stderr, "%s: Not opaque.\n", path);
+            return -1;
+        }
+    }
+
+    f = fopen(path, "wb");
+    if(f == NULL) {
+        fprintf(stderr, "%s: Cannot open.\n", path);
+        return -1;
+    }
+
+    fprintf(f, "P6\n%u %u\n255\n", tc->width, tc->height);
+    for(i = 0; i < tc->width * tc->height; i++) {
+        UINT32 p = tc->pixels[i];
+        fputc((p >> 16) & 0xff, f);
+        fputc((p >> 8) & 0xff, f);
+        fputc(p & 0xff, f);
+    }
+
+    if(fclose(f) != 0) {
+        fprintf(stderr, "%s: Write error.\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+int
+test_canvas_compare(const test_canvas_t* tc, const char* path)
+{
+    FILE* f;
+    unsigned width, height, maxval;
+    int maxdiff = 0;
+    UINT i;
+
+    f = fopen(path, "rb");
+    if(f == NULL) {
+        fprintf(stderr, "%s: Cannot open.\n", path);
+        return -1;
+    }
+
+    /* The header as written by test_canvas_save(): a single whitespace
+     * after the maximal value, no comments. */
+    if(fscanf(f, "P6 %u %u %u", &width, &height, &maxval) != 3  ||
+       fgetc(f) == EOF  ||  maxval != 255  ||
+       width != tc->width  ||  height != tc->height)
+    {
+        fprintf(stderr, "%s: Not a %ux%u PPM image.\n", path, tc->width, tc->height);
+        fclose(f);
+        return -1;
+    }
+
+    for(i = 0; i < tc->width * tc->height; i++) {
+        int r, g, b;
+        UINT32 p;
+        int d;
+
+        r = fgetc(f);
+        g = fgetc(f);
+        b = fgetc(f);
+        if(b == EOF) {
+            fprintf(stderr, "%s: Truncated.\n", path);
+            fclose(f);
+            return -1;
+        }
+
+        p = 0xff000000 | ((UINT32) r << 16) | ((UINT32) g << 8) | (UINT32) b;
+        d = test_pixel_diff(tc->pixels[i], p);
+        if(d > maxdiff)
+            maxdiff = d;
+    }
+
+    fclose(f);
+    return maxdiff;
+}
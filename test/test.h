@@ -0,0 +1,68 @@
+/*
+ * Helpers shared by the tests.
+ *
+ * Every test is a standalone program built on top of the portable build of
+ * the library (see bench/CMakeLists.txt). It reports each failed check on
+ * stderr and exits with a non-zero status if any has failed.
+ */
+
+#ifndef WDTEST_TEST_H
+#define WDTEST_TEST_H
+
+#include <windows.h>
+
+#include <wdl.h>
+
+
+extern int test_failures;
+
+#define TEST_CHECK(cond)                                                    \
+    do {                                                                    \
+        if(!(cond))                                                         \
+            test_fail(__FILE__, __LINE__, "%s", #cond);                     \
+    } while(0)
+
+#define TEST_CHECK_MSG(cond, ...)                                           \
+    do {                                                                    \
+        if(!(cond))                                                         \
+            test_fail(__FILE__, __LINE__, __VA_ARGS__);                     \
+    } while(0)
+
+void test_fail(const char* file, int line, const char* fmt, ...);
+
+/* Returns the exit status of the test. */
+int test_result(const char* name);
+
+
+/* Initializes the library with the software back-end. */
+void test_init_software(void);
+void test_fini_software(void);
+
+/* Canvas painting into its own buffer of 32-bit pre-multiplied BGRA pixels
+ * (see wdCreateCanvasWithBuffer()). */
+typedef struct test_canvas_tag test_canvas_t;
+struct test_canvas_tag {
+    WD_HCANVAS canvas;
+    UINT width;
+    UINT height;
+    UINT32* pixels;
+};
+
+int test_canvas_init(test_canvas_t* tc, UINT width, UINT height, DWORD flags);
+void test_canvas_fini(test_canvas_t* tc);
+
+/* Largest difference of any channel of any pixel. */
+int test_canvas_maxdiff(const test_canvas_t* a, const test_canvas_t* b);
+
+
+/* Images are stored as binary PPM (P6). Only opaque images can be saved;
+ * the alpha is checked by test_canvas_save(). */
+int test_canvas_save(const test_canvas_t* tc, const char* path);
+
+/* Compares the canvas with the image. Returns the largest difference of any
+ * channel of any pixel, or -1 if the image cannot be read or its size does
+ * not match. */
+int test_canvas_compare(const test_canvas_t* tc, const char* path);
+
+
+#endif  /* WDTEST_TEST_H */
@@ -0,0 +1,486 @@
+/*
+ * Tests of the event tracer (see trace.h): Several threads record events,
+ * enough for their ring buffers to wrap around, and the output of
+ * wdDumpTrace() has to be valid JSON with the begin and end events of each
+ * thread balanced and properly nested.
+ */
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "trace.h"
+
+
+#define THREADS         4
+#define ITERATIONS      1500    /* 6 events each, more than WD_TRACE_RING_SIZE */
+#define MAX_DEPTH       16
+
+#define TRACE_PATH      "test-trace.json"
+#define TRACE_WPATH     L"test-trace.json"
+
+
+static void*
+worker(void* param)
+{
+    test_canvas_t tc;
+    WD_HBRUSH brush;
+    int i;
+
+    if(test_canvas_init(&tc, 32, 32, 0) != 0) {
+        TEST_CHECK_MSG(0, "Cannot create the canvas.");
+        return NULL;
+    }
+    brush = wdCreateSolidBrush(tc.canvas, WD_RGB(255, 0, 0));
+
+    wdBeginPaint(tc.canvas);
+    for(i = 0; i < ITERATIONS; i++) {
+        /* Library events nested in our own one. */
+        wd_trace_event("test.outer", WD_TRACE_PHASE_BEGIN);
+        wdFillRect(tc.canvas, brush, 1.0f, 1.0f, 8.0f, 8.0f);
+        wdDrawLine(tc.canvas, brush, 0.0f, 0.0f, 31.0f, 17.0f, 1.0f);
+        wd_trace_event("test.outer", WD_TRACE_PHASE_END);
+    }
+    wdEndPaint(tc.canvas);
+
+    wdDestroyBrush(brush);
+    test_canvas_fini(&tc);
+    return NULL;
+}
+
+
+/**********************
+ ***  JSON Checking ***
+ **********************/
+
+/* A strict parser of RFC 8259 JSON; it just says whether the input is valid.
+ * Members of the objects in the "traceEvents" array are remembered so the
+ * events can be checked. */
+
+typedef struct event_tag event_t;
+struct event_tag {
+    char name[64];
+    char ph;
+    double ts;
+    unsigned long tid;
+};
+
+typedef struct parser_tag parser_t;
+struct parser_tag {
+    const char* pos;
+    event_t* events;
+    int event_count;
+    int event_capacity;
+};
+
+static int parse_value(parser_t* p, char* str, size_t str_size, double* num);
+
+static void
+skip_ws(parser_t* p)
+{
+    while(*p->pos == ' '  ||  *p->pos == '\t'  ||  *p->pos == '\n'  ||  *p->pos == '\r')
+        p->pos++;
+}
+
+static int
+parse_string(parser_t* p, char* str, size_t str_size)
+{
+    size_t len = 0;
+
+    if(*p->pos != '"')
+        return -1;
+    p->pos++;
+
+    while(*p->pos != '"') {
+        char c = *p->pos;
+
+        if((unsigned char) c < 0x20)
+            return -1;
+        if(c == '\\') {
+            p->pos++;
+            c = *p->pos;
+            if(c == 'u') {
+                int i;
+                for(i = 1; i <= 4; i++) {
+                    if(!isxdigit((unsigned char) p->pos[i]))
+                        return -1;
+                }
+                p->pos += 4;
+                c = '?';
+            } else if(strchr("\"\\/bfnrt", c) == NULL  ||  c == '\0') {
+                return -1;
+            }
+        }
+        if(str != NULL  &&  len + 1 < str_size)
+            str[len++] = c;
+        p->pos++;
+    }
+    p->pos++;
+
+    if(str != NULL)
+        str[len] = '\0';
+    return 0;
+}
+
+static int
+parse_number(parser_t* p, double* num)
+{
+    const char* start = p->pos;
+
+    if(*p->pos == '-')
+        p->pos++;
+    if(*p->pos == '0') {
+        p->pos++;
+    } else if(isdigit((unsigned char) *p->pos)) {
+        while(isdigit((unsigned char) *p->pos))
+            p->pos++;
+    } else {
+        return -1;
+    }
+    if(*p->pos == '.') {
+        p->pos++;
+        if(!isdigit((unsigned char) *p->pos))
+            return -1;
+        while(isdigit((unsigned char) *p->pos))
+            p->pos++;
+    }
+    if(*p->pos == 'e'  ||  *p->pos == 'E') {
+        p->pos++;
+        if(*p->pos == '+'  ||  *p->pos == '-')
+            p->pos++;
+        if(!isdigit((unsigned char) *p->pos))
+            return -1;
+        while(isdigit((unsigned char) *p->pos))
+            p->pos++;
+    }
+
+    if(num != NULL)
+        *num = strtod(start, NULL);
+    return 0;
+}
+
+/* If event is not NULL, its known members are filled in. */
+static int
+parse_object(parser_t* p, event_t* event)
+{
+    p->pos++;   /* '{' */
+    skip_ws(p);
+    if(*p->pos == '}') {
+        p->pos++;
+        return 0;
+    }
+
+    while(1) {
+        char key[32];
+        char str[64];
+        double num = 0.0;
+
+        skip_ws(p);
+        if(parse_string(p, key, sizeof(key)) != 0)
+            return -1;
+        skip_ws(p);
+        if(*p->pos != ':')
+            return -1;
+        p->pos++;
+        skip_ws(p);
+
+        str[0] = '\0';
+        if(parse_value(p, str, sizeof(str), &num) != 0)
+            return -1;
+        if(event != NULL) {
+            if(strcmp(key, "name") == 0)
+                strcpy(event->name, str);
+            else if(strcmp(key, "ph") == 0)
+                event->ph = str[0];
+            else if(strcmp(key, "ts") == 0)
+                event->ts = num;
+            else if(strcmp(key, "tid") == 0)
+                event->tid = (unsigned long) num;
+        }
+
+        skip_ws(p);
+        if(*p->pos == '}') {
+            p->pos++;
+            return 0;
+        }
+        if(*p->pos != ',')
+            return -1;
+        p->pos++;
+    }
+}
+
+static int
+parse_array(parser_t* p, BOOL events)
+{
+    p->pos++;   /* '[' */
+    skip_ws(p);
+    if(*p->pos == ']') {
+        p->pos++;
+        return 0;
+    }
+
+    while(1) {
+        skip_ws(p);
+        if(events) {
+            event_t* e;
+
+            if(*p->pos != '{')
+                return -1;
+            if(p->event_count >= p->event_capacity) {
+                p->event_capacity = (p->event_capacity > 0 ? 2 * p->event_capacity : 1024);
+                p->events = (event_t*) realloc(p->events, p->event_capacity * sizeof(event_t));
+                if(p->events == NULL)
+                    return -1;
+            }
+            e = &p->events[p->event_count++];
+            memset(e, 0, sizeof(event_t));
+            if(parse_object(p, e) != 0)
+                return -1;
+        } else {
+            if(parse_value(p, NULL, 0, NULL) != 0)
+                return -1;
+        }
+
+        skip_ws(p);
+        if(*p->pos == ']') {
+            p->pos++;
+            return 0;
+        }
+        if(*p->pos != ',')
+            return -1;
+        p->pos++;
+    }
+}
+
+static int
+parse_value(parser_t* p, char* str, size_t str_size, double* num)
+{
+    switch(*p->pos) {
+        case '{':   return parse_object(p, NULL);
+        case '[':   return parse_array(p, FALSE);
+        case '"':   return parse_string(p, str, str_size);
+        case 't':   if(strncmp(p->pos, "true", 4) != 0) return -1; p->pos += 4; return 0;
+        case 'f':   if(strncmp(p->pos, "false", 5) != 0) return -1; p->pos += 5; return 0;
+        case 'n':   if(strncmp(p->pos, "null", 4) != 0) return -1; p->pos += 4; return 0;
+        default:    return parse_number(p, num);
+    }
+}
+
+/* The top level object, with the events in "traceEvents". */
+static int
+parse_trace(parser_t* p)
+{
+    BOOL have_events = FALSE;
+
+    skip_ws(p);
+    if(*p->pos != '{')
+        return -1;
+    p->pos++;
+
+    while(1) {
+        char key[32];
+
+        skip_ws(p);
+        if(parse_string(p, key, sizeof(key)) != 0)
+            return -1;
+        skip_ws(p);
+        if(*p->pos != ':')
+            return -1;
+        p->pos++;
+        skip_ws(p);
+
+        if(strcmp(key, "traceEvents") == 0) {
+            if(*p->pos != '['  ||  parse_array(p, TRUE) != 0)
+                return -1;
+            have_events = TRUE;
+        } else if(parse_value(p, NULL, 0, NULL) != 0) {
+            return -1;
+        }
+
+        skip_ws(p);
+        if(*p->pos == '}')
+            break;
+        if(*p->pos != ',')
+            return -1;
+        p->pos++;
+    }
+    p->pos++;
+
+    skip_ws(p);
+    return (have_events  &&  *p->pos == '\0') ? 0 : -1;
+}
+
+static char*
+read_file(const char* path)
+{
+    FILE* f;
+    char* buffer;
+    long size;
+
+    f = fopen(path, "rb");
+    if(f == NULL)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    buffer = (char*) malloc(size + 1);
+    if(buffer != NULL) {
+        if(fread(buffer, 1, size, f) != (size_t) size) {
+            free(buffer);
+            buffer = NULL;
+        } else {
+            buffer[size] = '\0';
+        }
+    }
+    fclose(f);
+    return buffer;
+}
+
+/* Dumps the trace and parses it. Returns the count of events, or -1. */
+static int
+dump_and_parse(parser_t* p)
+{
+    char* json;
+
+    p->event_count = 0;
+
+    if(!wdDumpTrace(TRACE_WPATH)) {
+        TEST_CHECK_MSG(0, "wdDumpTrace() failed.");
+        return -1;
+    }
+
+    json = read_file(TRACE_PATH);
+    if(json == NULL) {
+        TEST_CHECK_MSG(0, "Cannot read %s.", TRACE_PATH);
+        return -1;
+    }
+
+    p->pos = json;
+    if(parse_trace(p) != 0) {
+        TEST_CHECK_MSG(0, "Invalid JSON at offset %ld.", (long) (p->pos - json));
+        free(json);
+        return -1;
+    }
+
+    free(json);
+    return p->event_count;
+}
+
+
+/* Checks per thread that the ends match the begins, in the LIFO order, and
+ * that the timestamps do not go back. With wrapped rings, only the ends of
+ * the overwritten begins may be missing from the full ring. */
+static void
+check_events(const parser_t* p, int expected_threads, BOOL wrapped)
+{
+    unsigned long tids[THREADS + 1];
+    int tid_count = 0;
+    int t, i;
+
+    for(i = 0; i < p->event_count; i++) {
+        for(t = 0; t < tid_count; t++) {
+            if(tids[t] == p->events[i].tid)
+                break;
+        }
+        if(t == tid_count) {
+            if(tid_count >= THREADS + 1) {
+                TEST_CHECK_MSG(0, "Too many threads in the trace.");
+                return;
+            }
+            tids[tid_count++] = p->events[i].tid;
+        }
+    }
+    TEST_CHECK_MSG(tid_count == expected_threads, "%d threads in the trace, expected %d.",
+                tid_count, expected_threads);
+
+    for(t = 0; t < tid_count; t++) {
+        const char* stack[MAX_DEPTH];
+        int depth = 0;
+        int count = 0;
+        double ts = -1.0;
+        BOOL outer = FALSE;
+
+        for(i = 0; i < p->event_count; i++) {
+            const event_t* e = &p->events[i];
+
+            if(e->tid != tids[t])
+                continue;
+            count++;
+
+            TEST_CHECK_MSG(e->ts >= ts, "Time goes back in thread %lu.", tids[t]);
+            ts = e->ts;
+
+            if(e->ph == 'B') {
+                if(depth >= MAX_DEPTH) {
+                    TEST_CHECK_MSG(0, "Nesting too deep in thread %lu.", tids[t]);
+                    break;
+                }
+                stack[depth++] = e->name;
+                if(strcmp(e->name, "test.outer") == 0)
+                    outer = TRUE;
+            } else if(e->ph == 'E') {
+                if(depth == 0) {
+                    TEST_CHECK_MSG(0, "Unbalanced end of %s in thread %lu.", e->name, tids[t]);
+                    break;
+                }
+                depth--;
+                TEST_CHECK_MSG(strcmp(stack[depth], e->name) == 0,
+                            "End of %s closes %s in thread %lu.", e->name,
+                            stack[depth], tids[t]);
+            } else {
+                TEST_CHECK_MSG(0, "Unknown phase '%c'.", e->ph);
+            }
+        }
+
+        TEST_CHECK_MSG(depth == 0, "%d events left open in thread %lu.", depth, tids[t]);
+        TEST_CHECK_MSG(count <= WD_TRACE_RING_SIZE, "%d events in thread %lu.", count, tids[t]);
+        TEST_CHECK_MSG(!wrapped  ||  count >= WD_TRACE_RING_SIZE - MAX_DEPTH,
+                    "Only %d events in thread %lu.", count, tids[t]);
+        TEST_CHECK_MSG(outer, "No test.outer events in thread %lu.", tids[t]);
+    }
+}
+
+
+int
+main(int argc, char** argv)
+{
+    pthread_t threads[THREADS];
+    parser_t parser;
+    int i;
+
+    memset(&parser, 0, sizeof(parser));
+    test_init_software();
+
+    wdEnableTrace(TRUE);
+    for(i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, worker, NULL);
+    for(i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+    wdEnableTrace(FALSE);
+
+    /* The rings have wrapped around, so each keeps just its last events. */
+    if(dump_and_parse(&parser) > 0)
+        check_events(&parser, THREADS, TRUE);
+    TEST_CHECK_MSG(parser.event_count <= THREADS * WD_TRACE_RING_SIZE,
+                "%d events in the trace.", parser.event_count);
+
+    /* No events after the reset; new ones from a new thread only. */
+    wdResetTrace();
+    TEST_CHECK(dump_and_parse(&parser) == 0);
+
+    wdEnableTrace(TRUE);
+    pthread_create(&threads[0], NULL, worker, NULL);
+    pthread_join(threads[0], NULL);
+    wdEnableTrace(FALSE);
+    if(dump_and_parse(&parser) > 0)
+        check_events(&parser, 1, TRUE);
+
+    free(parser.events);
+    remove(TRACE_PATH);
+    test_fini_software();
+    return test_result("trace");
+}
@@ -0,0 +1,200 @@
+/*
+ * Tests of wdWidenPath() with the software back-end: For each combination of
+ * caps, joins, dashes and miter limits, the filled outline has to paint what
+ * wdDrawPathStyled() paints, and hit testing it has to agree with
+ * wdPathStrokeContainsPoint() on the original path. The tip of a sharp join
+ * is checked against the miter limit as well.
+ *
+ * Usage: widen [-v]
+ *
+ * With -v, the differences of each case are reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+
+
+#define W               128
+#define H               128
+
+#define WIDTH           8.0f
+
+/* The software back-end flattens with SW_TOLERANCE (0.2 pixels) when
+ * stroking. Widened with the same tolerance, the outline is the same one. */
+#define TOLERANCE       0.2f
+
+/* The pieces of the widened outline are the same polygons the stroke is
+ * rasterized from, so at most the rounding of the coordinates differs. */
+#define MAX_DIFF        2
+
+/* The sharp join of the path at (50, 30): The sides meet at the angle of
+ * about 41 degrees, so the miter sticks out 2.85 half-widths (11.4 pixels)
+ * beyond the vertex. The point below is 9 pixels above it. */
+#define TIP_X           50.0f
+#define TIP_Y           21.0f
+#define TIP_MITER       2.85f
+
+
+static int verbose = 0;
+
+static WD_HPATH
+create_path(WD_HCANVAS canvas)
+{
+    WD_HPATH path;
+    WD_PATHSINK sink;
+
+    path = wdCreatePath(canvas);
+    if(path == NULL)
+        return NULL;
+    if(!wdOpenPathSink(&sink, path)) {
+        wdDestroyPath(path);
+        return NULL;
+    }
+
+    /* Open figure with the sharp join, a blunt one and a curve. */
+    wdBeginFigure(&sink, 20.0f, 110.0f);
+    wdAddLine(&sink, TIP_X, 30.0f);
+    wdAddLine(&sink, 80.0f, 110.0f);
+    wdAddLine(&sink, 110.0f, 80.0f);
+    wdAddBezier(&sink, 120.0f, 40.0f, 90.0f, 10.0f, 70.0f, 20.0f);
+    wdEndFigure(&sink, FALSE);
+
+    /* Closed figure with an arc. */
+    wdBeginFigure(&sink, 10.0f, 20.0f);
+    wdAddLine(&sink, 30.0f, 10.0f);
+    wdAddArc(&sink, 20.0f, 30.0f, 120.0f);
+    wdEndFigure(&sink, TRUE);
+
+    wdClosePathSink(&sink);
+    return path;
+}
+
+static void
+run_case(test_canvas_t* stroked, test_canvas_t* filled, WD_HPATH path,
+         WD_HBRUSH brush, WD_HSTROKESTYLE style, float miter_limit,
+         const char* name)
+{
+    WD_HPATH widened;
+    WD_HPATH hit_widened;
+    int diff;
+    int mismatches = 0;
+    BOOL tip;
+    int x, y;
+
+    widened = wdWidenPath(filled->canvas, path, WIDTH, style, TOLERANCE);
+    hit_widened = wdWidenPath(filled->canvas, path, WIDTH, style, 0.0f);
+    TEST_CHECK_MSG(widened != NULL  &&  hit_widened != NULL,
+                   "%s: wdWidenPath() failed", name);
+    if(widened == NULL  ||  hit_widened == NULL)
+        goto out;
+
+    wdBeginPaint(stroked->canvas);
+    wdClear(stroked->canvas, WD_RGB(255, 255, 255));
+    wdDrawPathStyled(stroked->canvas, brush, path, WIDTH, style);
+    wdEndPaint(stroked->canvas);
+
+    wdBeginPaint(filled->canvas);
+    wdClear(filled->canvas, WD_RGB(255, 255, 255));
+    wdFillPath(filled->canvas, brush, widened);
+    wdEndPaint(filled->canvas);
+
+    diff = test_canvas_maxdiff(stroked, filled);
+    TEST_CHECK_MSG(diff <= MAX_DIFF, "%s: the fill differs by %d", name, diff);
+
+    /* Widened with the default tolerance, the outline is the one hit testing
+     * the stroke builds, so the two have to agree on every point. */
+    for(y = 0; y < H; y++) {
+        for(x = 0; x < W; x++) {
+            float px = (float) x + 0.5f;
+            float py = (float) y + 0.5f;
+
+            if(wdPathStrokeContainsPoint(path, px, py, WIDTH, style) !=
+               wdPathFillContainsPoint(hit_widened, px, py, WD_FILL_WINDING))
+                mismatches++;
+        }
+    }
+    TEST_CHECK_MSG(mismatches == 0, "%s: %d points hit differently", name, mismatches);
+
+    tip = wdPathStrokeContainsPoint(path, TIP_X, TIP_Y, WIDTH, style);
+    TEST_CHECK_MSG(tip == (miter_limit > TIP_MITER), "%s: tip of the miter %s",
+                   name, tip ? "hit" : "missed");
+    TEST_CHECK_MSG(tip == wdPathFillContainsPoint(hit_widened, TIP_X, TIP_Y, WD_FILL_WINDING),
+                   "%s: tip of the widened miter differs", name);
+
+    if(verbose)
+        printf("%-32s diff %3d, mismatches %d\n", name, diff, mismatches);
+
+out:
+    if(hit_widened != NULL)
+        wdDestroyPath(hit_widened);
+    if(widened != NULL)
+        wdDestroyPath(widened);
+}
+
+int
+main(int argc, char** argv)
+{
+    static const char* cap_names[] = { "flat", "square", "round", "triangle" };
+    static const char* join_names[] = { "miter", "bevel", "round" };
+    static const float miter_limits[] = { 1.0f, 2.0f, WD_MITER_LIMIT, 40.0f };
+    static const float dashes[] = { 12.0f, 5.0f, 3.0f, 5.0f };
+    test_canvas_t stroked;
+    test_canvas_t filled;
+    WD_HPATH path;
+    WD_HBRUSH brush;
+    UINT cap, join, dashed, i;
+
+    if(argc > 1  &&  strcmp(argv[1], "-v") == 0)
+        verbose = 1;
+
+    test_init_software();
+
+    if(test_canvas_init(&stroked, W, H, 0) != 0  ||  test_canvas_init(&filled, W, H, 0) != 0) {
+        fprintf(stderr, "Cannot create the canvases.\n");
+        return 1;
+    }
+    path = create_path(stroked.canvas);
+    brush = wdCreateSolidBrush(stroked.canvas, WD_RGB(0, 0, 160));
+    if(path == NULL  ||  brush == NULL) {
+        fprintf(stderr, "Cannot create the resources.\n");
+        return 1;
+    }
+
+    run_case(&stroked, &filled, path, brush, NULL, WD_MITER_LIMIT, "default");
+
+    for(cap = WD_LINECAP_FLAT; cap <= WD_LINECAP_TRIANGLE; cap++) {
+        for(join = WD_LINEJOIN_MITER; join <= WD_LINEJOIN_ROUND; join++) {
+            for(dashed = 0; dashed <= 1; dashed++) {
+                UINT n = (join == WD_LINEJOIN_MITER ? 4 : 1);
+
+                for(i = 0; i < n; i++) {
+                    float limit = (join == WD_LINEJOIN_MITER ? miter_limits[i] : WD_MITER_LIMIT);
+                    WD_HSTROKESTYLE style;
+                    char name[64];
+
+                    sprintf(name, "%s/%s/%s/%g", cap_names[cap], join_names[join],
+                            dashed ? "dash" : "solid", (double) limit);
+                    style = wdCreateStrokeStyleEx(dashes, dashed ? 4 : 0, cap, join, limit);
+                    TEST_CHECK_MSG(style != NULL, "%s: wdCreateStrokeStyleEx() failed", name);
+                    if(style == NULL)
+                        continue;
+
+                    /* Only miter joins reach the tip. */
+                    run_case(&stroked, &filled, path, brush, style,
+                             (join == WD_LINEJOIN_MITER ? limit : 1.0f), name);
+                    wdDestroyStrokeStyle(style);
+                }
+            }
+        }
+    }
+
+    wdDestroyBrush(brush);
+    wdDestroyPath(path);
+    test_canvas_fini(&filled);
+    test_canvas_fini(&stroked);
+    test_fini_software();
+    return test_result("widen");
+}
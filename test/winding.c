@@ -0,0 +1,358 @@
+/*
+ * Tests of the winding numbers of the software rasterizer (sw_poly_winding())
+ * and of the hit testing built on top of them (wdPathFillContainsPoint() and
+ * wdPathStrokeContainsPoint()):
+ *
+ * Random polygons with integer vertices are checked against a plain
+ * computation in doubles, which is exact for them. Their contours have from
+ * 2 to 12 points, so the SSE2 code is run for any count of the remaining
+ * edges, with none (5 points) up to three (8 points) left to the scalar code.
+ * Shapes with known winding numbers are then hit tested through the API with
+ * both fill rules, and strokes with each of the caps.
+ *
+ * Usage: winding [OUTPUT]
+ *
+ * With OUTPUT, the winding numbers of random polygons with arbitrary float
+ * vertices are written there as raw ints. The test is built twice, with and
+ * without the SSE2 code of swrast.c (see SW_NO_SSE2), and the outputs have
+ * to be the same byte for byte.
+ */
+
+#include <stdio.h>
+
+#include "test.h"
+#include "swrast.h"
+
+
+#define POLYGONS        500
+#define CONTOURS        4       /* At most, per polygon. */
+#define MAX_POINTS      12      /* Per contour. */
+#define QUERIES         200     /* Per polygon. */
+#define RANGE           100
+
+
+static unsigned random_state = 12345;
+
+/* Deterministic, so both builds test the same polygons. */
+static unsigned
+random_int(unsigned n)
+{
+    random_state = random_state * 1103515245U + 12345U;
+    return ((random_state >> 8) & 0xffff) % n;
+}
+
+static float
+random_coord(void)
+{
+    random_state = random_state * 1103515245U + 12345U;
+    return ((float) ((random_state >> 8) & 0xffff) / 65535.0f - 0.5f) * 2.0f * RANGE;
+}
+
+/* The rule of sw_poly_winding(): Edges crossing the horizontal line through
+ * the point on its right count, upward +1 and downward -1, with their end
+ * points included only at the top. */
+static int
+reference_winding(const WD_POINT* points, const UINT* counts, UINT contours,
+                  double x, double y)
+{
+    int winding = 0;
+    UINT c, i;
+
+    for(c = 0; c < contours; c++) {
+        const WD_POINT* pts = points;
+
+        for(i = 0; i < counts[c]; i++) {
+            const WD_POINT* a = &pts[i];
+            const WD_POINT* b = &pts[(i + 1) % counts[c]];
+            double ax = a->x, ay = a->y;
+            double bx = b->x, by = b->y;
+            double cross = (bx - ax) * (y - ay) - (x - ax) * (by - ay);
+
+            if(ay <= y  &&  by > y  &&  cross > 0.0)
+                winding++;
+            else if(ay > y  &&  by <= y  &&  cross < 0.0)
+                winding--;
+        }
+        points += counts[c];
+    }
+
+    return winding;
+}
+
+static void
+build_poly(sw_poly_t* poly, const WD_POINT* points, const UINT* counts, UINT contours)
+{
+    sw_path_t path;
+    UINT c;
+
+    sw_path_init(&path);
+    for(c = 0; c < contours; c++) {
+        sw_path_move_to(&path, points[0].x, points[0].y);
+        sw_path_lines_to(&path, points + 1, counts[c] - 1);
+        sw_path_close(&path);
+        points += counts[c];
+    }
+    sw_poly_reset(poly);
+    sw_poly_flatten(poly, &path, SW_TOLERANCE);
+    TEST_CHECK(!path.error  &&  !poly->error);
+    sw_path_fini(&path);
+}
+
+/* Random polygon; with integer vertices if exact is set. */
+static UINT
+random_polygon(WD_POINT* points, UINT* counts, BOOL exact)
+{
+    UINT contours = 1 + random_int(CONTOURS);
+    UINT c, i, n = 0;
+
+    for(c = 0; c < contours; c++) {
+        counts[c] = 2 + random_int(MAX_POINTS - 1);
+        for(i = 0; i < counts[c]; i++) {
+            if(exact) {
+                points[n].x = (float) random_int(2 * RANGE + 1) - RANGE;
+                points[n].y = (float) random_int(2 * RANGE + 1) - RANGE;
+            } else {
+                points[n].x = random_coord();
+                points[n].y = random_coord();
+            }
+            n++;
+        }
+    }
+
+    return contours;
+}
+
+static void
+test_random(FILE* out)
+{
+    WD_POINT points[CONTOURS * MAX_POINTS];
+    UINT counts[CONTOURS];
+    sw_poly_t poly;
+    UINT contours;
+    int i, q;
+
+    sw_poly_init(&poly);
+
+    /* Integer vertices. The queries are often at the height of a vertex or
+     * right on an edge, where only the exact rule decides. */
+    for(i = 0; i < POLYGONS; i++) {
+        contours = random_polygon(points, counts, TRUE);
+        build_poly(&poly, points, counts, contours);
+        for(q = 0; q < QUERIES; q++) {
+            float x = (float) random_int(4 * RANGE + 1) * 0.5f - RANGE;
+            float y = (float) random_int(4 * RANGE + 1) * 0.5f - RANGE;
+            int winding = sw_poly_winding(&poly, x, y);
+            int expected = reference_winding(points, counts, contours, x, y);
+
+            TEST_CHECK_MSG(winding == expected, "polygon %d, point [%g %g]: "
+                           "winding %d, expected %d", i, (double) x, (double) y,
+                           winding, expected);
+            if(out != NULL)
+                fwrite(&winding, sizeof(int), 1, out);
+        }
+    }
+
+    /* Arbitrary vertices, for the comparison of the builds only. */
+    for(i = 0; i < POLYGONS; i++) {
+        contours = random_polygon(points, counts, FALSE);
+        build_poly(&poly, points, counts, contours);
+        for(q = 0; q < QUERIES; q++) {
+            float x = random_coord();
+            float y = random_coord();
+            int winding = sw_poly_winding(&poly, x, y);
+
+            if(out != NULL)
+                fwrite(&winding, sizeof(int), 1, out);
+        }
+    }
+
+    sw_poly_fini(&poly);
+}
+
+static WD_HPATH
+create_polygon_path(WD_HCANVAS canvas, const WD_POINT* points, const UINT* counts,
+                    UINT contours)
+{
+    WD_HPATH path;
+    WD_PATHSINK sink;
+    UINT c;
+
+    path = wdCreatePath(canvas);
+    if(path == NULL  ||  !wdOpenPathSink(&sink, path)) {
+        TEST_CHECK_MSG(0, "Cannot create the path.");
+        if(path != NULL)
+            wdDestroyPath(path);
+        return NULL;
+    }
+
+    for(c = 0; c < contours; c++) {
+        wdBeginFigure(&sink, points[0].x, points[0].y);
+        wdAddLines(&sink, points + 1, counts[c] - 1);
+        wdEndFigure(&sink, TRUE);
+        points += counts[c];
+    }
+    wdClosePathSink(&sink);
+    return path;
+}
+
+typedef struct hit_tag hit_t;
+struct hit_tag {
+    float x;
+    float y;
+    BOOL alternate;     /* Inside with WD_FILL_ALTERNATE. */
+    BOOL winding;       /* Inside with WD_FILL_WINDING. */
+};
+
+static void
+check_fill(WD_HPATH path, const hit_t* hits, UINT n, const char* name)
+{
+    UINT i;
+
+    for(i = 0; i < n; i++) {
+        TEST_CHECK_MSG(wdPathFillContainsPoint(path, hits[i].x, hits[i].y,
+                            WD_FILL_ALTERNATE) == hits[i].alternate,
+                       "%s: point [%g %g] with WD_FILL_ALTERNATE", name,
+                       (double) hits[i].x, (double) hits[i].y);
+        TEST_CHECK_MSG(wdPathFillContainsPoint(path, hits[i].x, hits[i].y,
+                            WD_FILL_WINDING) == hits[i].winding,
+                       "%s: point [%g %g] with WD_FILL_WINDING", name,
+                       (double) hits[i].x, (double) hits[i].y);
+    }
+}
+
+static void
+test_fill(WD_HCANVAS canvas)
+{
+    /* Pentagram: the pentagon in the center is wound twice. */
+    static const WD_POINT star[] = {
+        { 50, 0 }, { 79, 90 }, { 2, 35 }, { 98, 35 }, { 21, 90 }
+    };
+    static const UINT star_counts[] = { 5 };
+    static const hit_t star_hits[] = {
+        { 50, 50, FALSE, TRUE },    /* Center */
+        { 50, 10, TRUE, TRUE },     /* Top spike */
+        { 10, 37, TRUE, TRUE },     /* Left spike */
+        { 50, 80, FALSE, FALSE },   /* Between the bottom spikes */
+        { 90, 80, FALSE, FALSE },
+        { 200, 50, FALSE, FALSE }
+    };
+
+    /* Octagon around a hexagon and around a reversed heptagon, so the
+     * contours have 6 to 8 points. */
+    static const WD_POINT nested[] = {
+        { 30, 0 }, { 70, 0 }, { 100, 30 }, { 100, 70 },
+        { 70, 100 }, { 30, 100 }, { 0, 70 }, { 0, 30 },
+        { 20, 30 }, { 30, 20 }, { 40, 20 }, { 45, 30 }, { 40, 40 }, { 20, 40 },
+        { 80, 60 }, { 70, 55 }, { 60, 60 }, { 55, 70 }, { 60, 80 }, { 70, 85 }, { 80, 80 }
+    };
+    static const UINT nested_counts[] = { 8, 6, 7 };
+    static const hit_t nested_hits[] = {
+        { 50, 50, TRUE, TRUE },     /* Octagon only */
+        { 32, 30, FALSE, TRUE },    /* Hexagon: wound twice */
+        { 70, 70, FALSE, FALSE },   /* Heptagon: wound once each way */
+        { 2, 2, FALSE, FALSE },     /* Cut corner of the octagon */
+        { 99, 50, TRUE, TRUE }
+    };
+
+    WD_HPATH path;
+
+    path = create_polygon_path(canvas, star, star_counts, WD_SIZEOF_ARRAY(star_counts));
+    if(path != NULL) {
+        check_fill(path, star_hits, WD_SIZEOF_ARRAY(star_hits), "pentagram");
+        wdDestroyPath(path);
+    }
+
+    path = create_polygon_path(canvas, nested, nested_counts, WD_SIZEOF_ARRAY(nested_counts));
+    if(path != NULL) {
+        check_fill(path, nested_hits, WD_SIZEOF_ARRAY(nested_hits), "nested");
+        wdDestroyPath(path);
+    }
+}
+
+static void
+test_stroke(WD_HCANVAS canvas)
+{
+    static const WD_POINT line[] = { { 0, 50 }, { 100, 50 } };
+    static const struct {
+        UINT line_cap;
+        float x;
+        float y;
+        BOOL hit;
+    } hits[] = {
+        { WD_LINECAP_FLAT, 50, 54, TRUE },
+        { WD_LINECAP_FLAT, 50, 56, FALSE },
+        { WD_LINECAP_FLAT, -1, 50, FALSE },
+        { WD_LINECAP_SQUARE, -4, 54, TRUE },
+        { WD_LINECAP_SQUARE, -6, 50, FALSE },
+        { WD_LINECAP_ROUND, -4, 50, TRUE },
+        { WD_LINECAP_ROUND, -4, 54, FALSE },    /* Out of the radius */
+        { WD_LINECAP_TRIANGLE, -4, 50, TRUE },
+        { WD_LINECAP_TRIANGLE, -2, 54, FALSE }
+    };
+    WD_HPATH path;
+    WD_PATHSINK sink;
+    UINT i;
+
+    path = wdCreatePath(canvas);
+    if(path == NULL  ||  !wdOpenPathSink(&sink, path)) {
+        TEST_CHECK_MSG(0, "Cannot create the path.");
+        if(path != NULL)
+            wdDestroyPath(path);
+        return;
+    }
+    wdBeginFigure(&sink, line[0].x, line[0].y);
+    wdAddLine(&sink, line[1].x, line[1].y);
+    wdEndFigure(&sink, FALSE);
+    wdClosePathSink(&sink);
+
+    for(i = 0; i < WD_SIZEOF_ARRAY(hits); i++) {
+        WD_HSTROKESTYLE style;
+
+        style = wdCreateStrokeStyle(WD_DASHSTYLE_SOLID, hits[i].line_cap, WD_LINEJOIN_MITER);
+        TEST_CHECK(style != NULL);
+        if(style == NULL)
+            continue;
+        TEST_CHECK_MSG(wdPathStrokeContainsPoint(path, hits[i].x, hits[i].y,
+                            10.0f, style) == hits[i].hit,
+                       "cap %u, point [%g %g]: expected %s", hits[i].line_cap,
+                       (double) hits[i].x, (double) hits[i].y,
+                       hits[i].hit ? "hit" : "miss");
+        wdDestroyStrokeStyle(style);
+    }
+
+    wdDestroyPath(path);
+}
+
+int
+main(int argc, char** argv)
+{
+    test_canvas_t tc;
+    FILE* out = NULL;
+
+    if(argc > 1) {
+        out = fopen(argv[1], "wb");
+        if(out == NULL) {
+            fprintf(stderr, "%s: Cannot open.\n", argv[1]);
+            return 1;
+        }
+    }
+
+    test_random(out);
+
+    if(out != NULL  &&  fclose(out) != 0) {
+        fprintf(stderr, "%s: Write error.\n", argv[1]);
+        return 1;
+    }
+
+    test_init_software();
+    if(test_canvas_init(&tc, 16, 16, 0) != 0) {
+        fprintf(stderr, "Cannot create the canvas.\n");
+        return 1;
+    }
+    test_fill(tc.canvas);
+    test_stroke(tc.canvas);
+    test_canvas_fini(&tc);
+    test_fini_software();
+
+    return test_result("winding");
+}